@@ -103,7 +103,8 @@ enum CPUT_GPA_INSTRUMENTATION_STRINGS{
 };
 #endif // CPUT_GPA_INSTRUMENTATION
 
-#ifndef nullptr
+// Only for pre-C++11 compilers, redefining the keyword breaks <thread> in newer libstdc++
+#if !defined(nullptr) && (defined(_MSC_VER) || __cplusplus < 201103L)
 #define nullptr NULL
 #endif
 
@@ -231,6 +232,7 @@ typedef enum CPUTResult
 //
     CPUT_WARNING_SHADER_INPUT_SLOT_NOT_MATCHED,
     CPUT_WARNING_NO_ASSETS_LOADED,
+    CPUT_WARNING_NOT_FINISHED,        // multi-step work (e.g. CPUTAssetLoader main thread steps) wants to be called again
 //
 // just an error
 //
@@ -354,6 +356,13 @@ static int gRefCount = 0;
 #define SAFE_DELETE_ARRAY(p){if((p)){HEAPCHECK; delete[](p);    (p)=NULL;HEAPCHECK; }}
 #define UNREFERENCED_PARAMETER(P) (P)
 
+// Per-thread static storage for plain pointers/PODs (VS2013 has no thread_local)
+#ifdef _MSC_VER
+#define CPUT_THREAD_LOCAL __declspec(thread)
+#else
+#define CPUT_THREAD_LOCAL __thread
+#endif
+
 // CPUT data types
 //-----------------------------------------------------------------------------
 #define CPUTSUCCESS(returnCode) ((returnCode) < 0xF0000000)
@@ -425,6 +434,9 @@ enum CPUT_DATA_FORMAT_TYPE
 
     CPUT_CHAR=11,
     CPUT_BOOL=12,
+
+    CPUT_F16=13,
+    CPUT_SNORM8=14, // signed 8 bit, the shader sees -1..1
 };
 
 // Corresponding sizes (in bytes) that match CPUT_DATA_FORMAT_TYPE
@@ -449,6 +461,9 @@ const int CPUT_DATA_FORMAT_SIZE[] =
 
         1, //CPUT_CHAR
         1, //CPUT_BOOL
+
+        2, //CPUT_F16
+        1, //CPUT_SNORM8
 };
 
 //-----------------------------------------------------------------------------
@@ -602,6 +617,14 @@ struct CPUTModelConstantBuffer
     float4  BoundingBoxCenterObjectSpace;
     float4  BoundingBoxHalfObjectSpace;
 };
+// Per-instance world matrices for instanced draws, see CPUTInstanceGroup. The instanced
+// draw sets cbPerModelValues.World to identity, so the usual WorldViewProjection and
+// LightWorldViewProjection become the view-projections the instance's world is multiplied by.
+#define CPUT_MAX_INSTANCES_PER_DRAW 512
+struct CPUTInstanceConstantBuffer
+{
+    float4x4 InstanceWorld[CPUT_MAX_INSTANCES_PER_DRAW];
+};
 struct CPUTAnimationConstantBuffer
 {
     float4x4    SkinMatrix[255];
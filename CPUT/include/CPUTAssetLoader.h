@@ -0,0 +1,121 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef CPUTASSETLOADER_H
+#define CPUTASSETLOADER_H
+
+/*
+    Background asset loading.
+
+    A load is split in two steps:
+
+    - the worker task runs on one of the loader threads. It does everything that doesn't touch
+      the graphics API or the asset library: file reads, parsing, filling a CPUTSceneCache.
+    - the main thread task runs inside ProcessMainThreadWork(), which the application calls
+      once a frame from the render thread with a time budget. This is where the resources are
+      created. A main thread task that returns CPUT_WARNING_NOT_FINISHED is called again
+      (on the same frame if there is budget left, otherwise on the next one), so big loads can
+      be spread over several frames.
+
+    Submit() returns a CPUTLoadRequest handle that can be polled for its state. Worker tasks run
+    in parallel, but main thread tasks run in the order the requests were submitted, so a request
+    can rely on everything submitted before it being complete.
+*/
+
+#include "CPUT.h"
+#include "CPUTRefCount.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum CPUT_LOAD_STATE
+{
+    CPUT_LOAD_QUEUED,       // waiting for a loader thread
+    CPUT_LOAD_WORKING,      // worker task is running
+    CPUT_LOAD_FINALIZING,   // waiting for, or running, the main thread task
+    CPUT_LOAD_COMPLETE,
+    CPUT_LOAD_FAILED,
+};
+
+typedef std::function<CPUTResult()> CPUTLoadTask;
+
+class CPUTLoadRequest : public CPUTRefCount
+{
+    friend class CPUTAssetLoader;
+
+public:
+    CPUT_LOAD_STATE GetState() const { return (CPUT_LOAD_STATE)mState.load(); }
+    bool            IsDone() const   { CPUT_LOAD_STATE state = GetState(); return state == CPUT_LOAD_COMPLETE || state == CPUT_LOAD_FAILED; }
+
+    // Result of the last task that ran, only meaningful once IsDone()
+    CPUTResult      GetResult() const { return mResult; }
+
+protected:
+    CPUTLoadRequest(const CPUTLoadTask &workerTask, const CPUTLoadTask &mainThreadTask)
+        : mWorkerTask(workerTask), mMainThreadTask(mainThreadTask), mState(CPUT_LOAD_QUEUED), mResult(CPUT_SUCCESS) {}
+    ~CPUTLoadRequest() {}
+
+    CPUTLoadTask     mWorkerTask;
+    CPUTLoadTask     mMainThreadTask;
+    std::atomic<int> mState;
+    CPUTResult       mResult;
+};
+
+class CPUTAssetLoader
+{
+public:
+    static CPUTAssetLoader *GetAssetLoader();
+
+    // Stops the loader threads and cancels anything still queued. Call from the main thread.
+    static void             DeleteAssetLoader();
+
+    // Either task may be empty. The returned request must be released by the caller.
+    CPUTLoadRequest *Submit(const CPUTLoadTask &workerTask, const CPUTLoadTask &mainThreadTask);
+
+    // Runs main thread tasks, in submission order, until budgetMilliseconds is used up or the
+    // next request's worker task hasn't finished yet. At least one step runs per call (if one
+    // is ready) so loading always makes progress.
+    void             ProcessMainThreadWork(double budgetMilliseconds);
+
+    // True when no request is queued or in flight
+    bool             IsIdle();
+
+protected:
+    CPUTAssetLoader();
+    ~CPUTAssetLoader();
+
+    void StartThreads();
+    void WorkerThread();
+
+    static CPUTAssetLoader          *mpAssetLoader;
+
+    std::vector<std::thread>         mThreads;
+    std::mutex                       mMutex;
+    std::condition_variable          mWorkAvailable;
+    std::deque<CPUTLoadRequest*>     mWorkerQueue;
+    std::deque<CPUTLoadRequest*>     mRequests;     // everything not done yet, in submission order
+    bool                             mbShutdown;
+
+private:
+    CPUTAssetLoader(const CPUTAssetLoader &);
+    CPUTAssetLoader & operator=(const CPUTAssetLoader &);
+};
+
+#endif // CPUTASSETLOADER_H
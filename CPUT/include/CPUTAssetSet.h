@@ -20,8 +20,10 @@
 #include "CPUTRefCount.h"
 #include "CPUTNullNode.h"
 #include "CPUTCamera.h"
+#include <vector>
 
 class CPUTRenderNode;
+class CPUTInstanceGroup;
 class CPUTNullNode;
 class CPUTRenderParameters;
 
@@ -35,6 +37,11 @@ protected:
     CPUTCamera      *mpFirstCamera;
     UINT             mCameraCount;
 
+    // Models sharing meshes and materials. RenderRecursive() draws them with one instanced
+    // draw per mesh when the render parameters have a per-instance constant buffer.
+    std::vector<CPUTInstanceGroup*> mInstanceGroups;
+    void               BuildInstanceGroups();
+
     CPUTAssetSet();
     ~CPUTAssetSet(); // Destructor is not public.  Must release instead of delete.
 
@@ -48,9 +55,13 @@ public:
     void               SetRoot( CPUTNullNode *pRoot) { SAFE_RELEASE(mpRootNode); mpRootNode = pRoot; }
     CPUTCamera        *GetFirstCamera() { if(mpFirstCamera){mpFirstCamera->AddRef();} return mpFirstCamera; } // TODO: Consider supporting indexed access to each asset type
     void               RenderRecursive(CPUTRenderParameters &renderParams, int materialIndex=0);
+    // Picks each model's level of detail for pCamera, see CPUTModel::SelectLod()
+    void               SelectLods(CPUTCamera *pCamera, float lodScale);
     void               UpdateRecursive( float deltaSeconds );
     CPUTResult LoadAssetSet(std::string name, int numSystemMaterials=0, std::string *pSystemMaterialNames=NULL);
     void               GetBoundingBox(float3 *pCenter, float3 *pHalf);
+    UINT               GetInstanceGroupCount() { return (UINT)mInstanceGroups.size(); }
+    CPUTInstanceGroup *GetInstanceGroup(UINT index) { return mInstanceGroups[index]; }
 };
 
 #endif // #ifndef __CPUTASSETSET_H__
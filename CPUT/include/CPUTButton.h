@@ -68,6 +68,8 @@ public:
 
     // draw
     virtual void Draw(CPUTGUIVertex *pVertexBufferMirror, UINT *pInsertIndex, UINT pMaxBufferSize);
+    virtual bool IsGeometryDirty();
+    virtual void ClearGeometryDirty();
 
     void SetDimensions(int width, int height);
 
@@ -78,6 +78,8 @@ public:
 
     // CPUTCheckboxDX11    
     virtual void Draw(CPUTGUIVertex *pVertexBufferMirror, UINT *pInsertIndex, UINT pMaxBufferSize);
+    virtual bool IsGeometryDirty();
+    virtual void ClearGeometryDirty();
 
 
 protected:
@@ -38,69 +38,54 @@
 
 #include "CPUT.h"
 #include <algorithm> // for std::transform
+#include <vector>
+
+/*
+    Names and values are not copied out of the file. CPUTConfigFile keeps the file contents
+    around as an arena, NUL-terminates every name and value in place while parsing, and the
+    entries simply point into it. Entries of all blocks live in one array in file order and
+    each block owns a small open-addressed hash table (also shared in one array) for name
+    lookups. Everything stays valid for the lifetime of the CPUTConfigFile.
+*/
 
 //-----------------------------------------------------------------------------
 class CPUTConfigEntry
 {
 private:
-    std::string szName;
-    std::string szValue;
+    const char *mpName;
+    const char *mpValue;
+    UINT        mNameLength;
+    UINT        mValueLength;
+    UINT        mNameHash;
 
     friend class CPUTConfigBlock;
     friend class CPUTConfigFile;
 
 public:
-    CPUTConfigEntry() {}
-    CPUTConfigEntry(const std::string &name, const std::string &value): szName(name), szValue(value){};
+    CPUTConfigEntry() : mpName(""), mpValue(""), mNameLength(0), mValueLength(0), mNameHash(0) {}
 
-    static const CPUTConfigEntry  &sNullConfigValue;
+    static const CPUTConfigEntry  sNullConfigValue;
 
-    const std::string & NameAsString(void){ return  szName;};
-    const std::string & ValueAsString(void){ return szValue; }
-    bool IsValid(void){ return !szName.empty(); }
+    std::string NameAsString(void){ return std::string(mpName, mNameLength); }
+    std::string ValueAsString(void){ return std::string(mpValue, mValueLength); }
+    const char *NameAsCString(void){ return mpName; }
+    const char *ValueAsCString(void){ return mpValue; }
+    UINT ValueLength(void){ return mValueLength; }
+    bool IsValid(void){ return mNameLength != 0; }
 
-    float ValueAsFloat(void)
-    {
-        float fValue=0;
-        int retVal;
-        retVal = sscanf(szValue.c_str(), "%g", &fValue ); // float (regular float, or E exponentially notated float)
-        ASSERT(0!=retVal, "ValueAsFloat - value specified is not a float");
-        return fValue;
-    }
-    int ValueAsInt(void)
-    {
-        int nValue=0;
-        int retVal;
-        retVal = sscanf(szValue.c_str(), "%d", &nValue ); // signed int (NON-hex)
-        ASSERT(0!=retVal, "ValueAsInt - value specified is not a signed int");
-        return nValue;
-    }
-    UINT ValueAsUint(void)
-    {
-        UINT nValue=0;
-        int retVal;
-        retVal = sscanf(szValue.c_str(), "%u", &nValue ); // unsigned int
-        ASSERT(0!=retVal, "ValueAsUint - value specified is not a UINT");
-        return nValue;
-    }
+    float ValueAsFloat(void);
+    int ValueAsInt(void);
+    UINT ValueAsUint(void);
     bool ValueAsBool(void)
     {
-        return  (szValue.compare("true") == 0) || 
-                (szValue.compare("1") == 0) || 
-                (szValue.compare("t") == 0);
-    }
-    UINT ValueAsHex32(void)
-    {
-        UINT nValue = 0;
-        int retVal;
-        retVal = sscanf(szValue.c_str(), "%x", &nValue ); // unsigned int
-        ASSERT(0!=retVal, "ValueAsUint - value specified is not a hex");
-        return nValue;
+        return  (mValueLength == 4 && memcmp(mpValue, "true", 4) == 0) ||
+                (mValueLength == 1 && (mpValue[0] == '1' || mpValue[0] == 't'));
     }
-    
+    UINT ValueAsHex32(void);
+
     void ValueAsString(std::string *stringOut)
     {
-        *stringOut = szValue;
+        stringOut->assign(mpValue, mValueLength);
     }
 
     void ValueAsFloatArray(float *pFloats, int count);
@@ -115,18 +100,23 @@ public:
     CPUTConfigBlock();
     ~CPUTConfigBlock();
 
-    CPUTConfigEntry *AddValue(const std::string &szName, const std::string &szValue);
     CPUTConfigEntry *GetValue(int nValueIndex);
     CPUTConfigEntry *GetValueByName(const std::string &szName);
-    const std::string &GetName(void);
-    int GetNameValue(void);
+    CPUTConfigEntry *GetValueByName(const char *szName);
+    std::string GetName(void);
     int ValueCount(void);
     bool IsValid();
 private:
-    CPUTConfigEntry mpValues[64];
-    CPUTConfigEntry mName;
-    std::string     mszName;
-    int             mnValueCount;
+    CPUTConfigEntry *FindValue(const char *pName, UINT nameLength);
+
+    const char      *mpName;
+    UINT             mNameLength;
+    CPUTConfigEntry *mpValues;      // points into CPUTConfigFile::mEntries
+    const UINT      *mpSlots;       // points into CPUTConfigFile::mSlots, (entry index + 1) or 0 if empty
+    UINT             mSlotMask;
+    int              mnFirstValue;
+    int              mnValueCount;
+    UINT             mnSlotOffset;
 };
 
 //-----------------------------------------------------------------------------
@@ -137,16 +127,32 @@ public:
     ~CPUTConfigFile();
 
     CPUTResult LoadFile(const std::string &szFilename);
+    CPUTResult LoadFromMemory(char *pContents, UINT sizeInBytes);
+
+    // Pre-parsed image of the file for the scene cache (see CPUTSceneCache.h)
+    void       SaveBinary(std::vector<char> *pImage);
+    CPUTResult LoadBinary(const char *pImage, UINT sizeInBytes);
     CPUTConfigBlock *GetBlock(int nBlockIndex);
     CPUTConfigBlock *GetBlockByName(const std::string &szBlockName);
+    CPUTConfigBlock *GetBlockByName(const char *szBlockName);
     int BlockCount(void);
 
 private:
     CPUTConfigFile(const CPUTConfigFile &);
     CPUTConfigFile & operator=(const CPUTConfigFile &);
 
-    CPUTConfigBlock    *mpBlocks;
-    int                 mnBlockCount;
+    void Release();
+    void CloseBlock(CPUTConfigBlock *pBlock);
+    CPUTConfigBlock *FindBlock(const char *pName, UINT nameLength);
+    void FixupBlockPointers();
+
+    char                           *mpFileContents;
+    UINT                            mnContentsSize;
+    std::vector<CPUTConfigBlock>    mBlocks;
+    std::vector<CPUTConfigEntry>    mEntries;
+    std::vector<UINT>               mSlots;
+    UINT                            mBlockSlotOffset;
+    UINT                            mBlockSlotMask;
 };
 
 #endif //#ifndef __CPUTCONFIGBLOCK_H__
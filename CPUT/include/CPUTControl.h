@@ -122,7 +122,14 @@ public:
     // buffer management
     virtual void Draw(CPUTGUIVertex *pVertexBufferMirror, UINT *pInsertIndex, UINT pMaxBufferSize) {return;}
 
+    // Set whenever what Draw() writes may have changed (quads recalculated, enabled, shown/hidden).
+    // The GUI controller only redraws dirty controls. Controls with text children include theirs.
+    virtual bool IsGeometryDirty() { return mbGeometryDirty; }
+    virtual void ClearGeometryDirty() { mbGeometryDirty = false; }
+    void MarkGeometryDirty() { mbGeometryDirty = true; }
+
 protected:
+    bool                    mbGeometryDirty;
     bool                    mControlVisible;
     bool                    mControlAutoArranged;
     void                    SetFocus(bool focused) { mHasFocus = focused; };
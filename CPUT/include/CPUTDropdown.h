@@ -95,6 +95,8 @@ public:
     
     // Draw
     virtual void Draw(CPUTGUIVertex *pVertexBufferMirror, UINT *pInsertIndex, UINT pMaxBufferSize);
+    virtual bool IsGeometryDirty();
+    virtual void ClearGeometryDirty();
 
     // Register assets
     static CPUTResult RegisterStaticResources();
@@ -19,6 +19,8 @@
 
 #include "CPUT.h"
 #include "CPUTRefCount.h"
+#include <unordered_map>
+#include <vector>
 class CPUTTexture;
 #define CPUT_MAX_NUMBER_OF_CHARACTERS 256
 
@@ -93,9 +95,37 @@ public:
 
     void LayoutText(CPUTGUIVertex *pVtxBuffer, int *pWidth, int *pHeight, const std::string& text, int tlx, int tly);
 
-    void SetFontScale(float scale) { mFontScale = scale; }
+    void SetFontScale(float scale)
+    {
+        if (scale != mFontScale) {
+            mFontScale = scale;
+            mLayoutCache.clear(); // cached layouts are in scaled units
+        }
+    }
 
 protected:
+    //
+    // A character of laid out text. Positions are relative to the top left corner passed to LayoutText.
+    //
+    struct GlyphPlacement
+    {
+        const BMFontChars *pChar;
+        int                x;
+        int                kernAmount;
+        int                line;
+    };
+
+    struct TextLayout
+    {
+        std::vector<GlyphPlacement> glyphs;
+        int                         width;
+        int                         height;
+    };
+
+    void              BuildLookupTables();
+    int               FindKerningAmount(uint32_t first, uint32_t second) const;
+    const TextLayout &GetTextLayout(const std::string &text);
+
     BMFontInfo         *mpFontInfo;
     BMFontCommon       *mpFontCommon;
     BMFontPages        *mpFontPages;
@@ -105,6 +135,17 @@ protected:
     uint32_t            mNumKerningPairs;
     float               mFontScale;
 
+    // Text is laid out a byte at a time, so every character id that can be looked up fits in the table
+    const BMFontChars  *mpGlyphTable[CPUT_MAX_NUMBER_OF_CHARACTERS];
+
+    // Open addressed kerning pair table, key is (first << 32) | second
+    std::vector<uint64_t> mKerningKeys;
+    std::vector<int16_t>  mKerningAmounts;
+    uint32_t              mKerningShift;
+
+    // Layouts of recently used strings at the current font scale
+    std::unordered_map<std::string, TextLayout> mLayoutCache;
+
     ~CPUTFont();
 
 private:
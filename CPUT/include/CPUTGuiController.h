@@ -29,6 +29,16 @@
 
 class CPUTFont;
 
+// What the last Update() did to the GUI vertex buffer
+struct CPUTGuiUpdateStats
+{
+    UINT controlsDrawn;     // controls whose Draw() ran
+    UINT verticesWritten;   // into the mirror buffer
+    UINT bytesUploaded;
+    UINT uploadCount;       // ranges uploaded
+    bool repacked;          // every control was laid out again
+};
+
 class CPUTGuiController:public CPUTEventHandler
 {
  
@@ -79,6 +89,7 @@ public:
     //e.g. when updating text controls.
     void ControlModified();
     void RecalculateLayout();
+    const CPUTGuiUpdateStats &GetUpdateStats() const { return mUpdateStats; }
 
     CPUTResult CreateButton(const std::string pButtonText, CPUTControlID controlID, CPUTControlID panelID, CPUTButton **ppButton=NULL);
     CPUTResult CreateSlider(const std::string pSliderText, CPUTControlID controlID, CPUTControlID panelID, CPUTSlider **ppSlider=NULL, float scale = 1.0f);
@@ -89,9 +100,12 @@ public:
 protected:
     virtual void UpdateConstantBuffer()=0;
     virtual CPUTResult UpdateUberBuffers() = 0;
+
+    // Uploads numVertices of the mirror buffer from firstVertex. APIs that don't override it get the whole buffer instead.
+    virtual CPUTResult UpdateUberBufferRange(UINT firstVertex, UINT numVertices) { UNREFERENCED_PARAMETER(firstVertex); UNREFERENCED_PARAMETER(numVertices); return CPUT_ERROR_NOT_IMPLEMENTED; }
     
     bool mRecalculate;
-    bool mUpdateBuffers;
+    bool mUpdateBuffers;    // lay every control out again instead of redrawing the dirty ones in place
     
     struct Panel
     {
@@ -117,6 +131,26 @@ protected:
 
     CPUTGUIVertex              *mpMirrorBuffer;
     UINT                        mUberBufferIndex;   
+
+    // Each control owns a range of the mirror buffer, in draw order. A dirty control is drawn
+    // into the scratch buffer and copied over its range, and only that range is uploaded.
+    // Unused vertices at the end of a range are zero, i.e. degenerate triangles.
+    struct ControlRange
+    {
+        CPUTControl *pControl;
+        UINT         offset;
+        UINT         capacity;
+        UINT         count;     // vertices written the last time it was drawn
+        UINT         redraws;   // since it was laid out
+    };
+    std::vector<ControlRange>   mControlRanges;
+    std::vector<CPUTControl*>   mDrawOrder;
+    std::vector<std::pair<UINT, UINT> > mUploadSpans;  // [first, end) vertices changed this frame
+    CPUTGUIVertex              *mpScratchBuffer;
+    CPUTMouseState              mLastMouseState;
+    CPUTGuiUpdateStats          mUpdateStats;
+
+    void RepackControls();
 private:
     CPUTGuiController(const CPUTGuiController &);
     CPUTGuiController & operator=(const CPUTGuiController &);
@@ -0,0 +1,49 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CPUTHASH_H
+#define CPUTHASH_H
+
+#include <stdint.h>
+#include <string.h>
+
+// 64 bit multiply/xorshift, a word at a time. For cache keys: it only has to notice that the
+// data changed, it isn't meant to resist anyone. The cooked textures, the shader cache and the
+// OGL program cache keep these on disk, so changing it invalidates all of them.
+// Needs nothing from the rest of CPUT, so tools and tests can use it on their own.
+inline uint64_t CPUTHash64(const void *pData, uint64_t size)
+{
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    uint64_t h = size * m;
+    const unsigned char *p = (const unsigned char *)pData;
+    for (; size >= 8; p += 8, size -= 8)
+    {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        w *= m; w ^= w >> 47; w *= m;
+        h ^= w; h *= m;
+    }
+    if (size > 0)
+    {
+        uint64_t w = 0;
+        memcpy(&w, p, (size_t)size);
+        h ^= w; h *= m;
+    }
+    h ^= h >> 47; h *= m; h ^= h >> 47;
+    return h;
+}
+
+#endif // CPUTHASH_H
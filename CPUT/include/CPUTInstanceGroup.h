@@ -0,0 +1,63 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef __CPUTINSTANCEGROUP_H__
+#define __CPUTINSTANCEGROUP_H__
+
+#include "CPUT.h"
+#include <vector>
+
+class CPUTModel;
+class CPUTRenderParameters;
+
+// Models of an asset set that share all their meshes and materials (e.g. the same .mdl placed
+// many times), drawn with one instanced draw per mesh instead of one draw per model.
+// Every frame the visible members' world matrices go into $cbPerInstanceValues, up to
+// CPUT_MAX_INSTANCES_PER_DRAW at a time; each batch is uploaded once and drawn with every mesh.
+// cbPerModelValues is set up once with an identity world.
+//
+// A material takes part by naming an InstancedMaterial in its .mtl. That variant's vertex shader
+// reads its world matrix from InstanceWorld[SV_InstanceID] (see VSMainInstanced in fence.fx).
+// Meshes whose material has no variant, and APIs without DrawInstanced, draw the members one at a time.
+class CPUTInstanceGroup
+{
+public:
+    CPUTInstanceGroup(CPUTModel *pFirstModel);
+    ~CPUTInstanceGroup();
+
+    bool       Accepts(const CPUTModel *pModel) const;
+    void       AddModel(CPUTModel *pModel);
+    UINT       GetModelCount() const { return (UINT)mModels.size(); }
+    CPUTModel *GetModel(UINT index) { return mModels[index]; }
+
+    // Members outside the camera's frustum are skipped, as in CPUTModel::Render(). Members
+    // share their levels of detail too, each level gets its own instanced draws.
+    void       Render(CPUTRenderParameters &renderParams, int materialIndex);
+    UINT       GetVisibleCount() const { return (UINT)mVisibleModels.size(); }
+
+protected:
+    std::vector<CPUTModel*> mModels;        // AddRef'd, mModels[0] supplies the meshes and materials
+    std::vector<CPUTModel*> mVisibleModels; // this frame's
+    std::vector<float4x4>   mVisibleWorld;
+    std::vector<int>        mInstancedMeshes; // this frame's meshes with an instanced material
+
+    void       UpdateGroupConstants(CPUTRenderParameters &renderParams);
+
+private:
+    CPUTInstanceGroup(const CPUTInstanceGroup &);
+    CPUTInstanceGroup & operator=(const CPUTInstanceGroup &);
+};
+
+#endif // __CPUTINSTANCEGROUP_H__
@@ -0,0 +1,98 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef CPUTLOD_H
+#define CPUTLOD_H
+
+/*
+    Discrete levels of detail for .mdl models. Level 0 is the model itself; level N is a
+    file next to it named <model>_lodN.mdl (see CPUTLodFileName()) with the same meshes in
+    the same order and about half the triangles of level N-1. Extras/MeshCook -lod writes
+    them with CPUTMeshSimplifier. CPUTModel loads whatever levels it finds and
+    CPUTScene::SelectLods() picks one per model each frame.
+
+    A level is picked by the size of the model's bounding sphere on screen, as a fraction
+    of the view's height: level 1 below CPUT_LOD_SCREEN_SIZE, level 2 below half of that and
+    so on. Each level is allowed CPUT_LOD_ERROR of the model's radius at level 1, doubling
+    per level, which at the switch is about a pixel at 1080p. To keep a model that sits
+    right at a threshold from popping back and forth, a level is only left once the size
+    is CPUT_LOD_HYSTERESIS past the threshold.
+*/
+
+#include "CPUTMath.h"
+#include <float.h>
+#include <algorithm>
+#include <string>
+
+const int   CPUT_MAX_LOD_COUNT   = 4;       // level 0 included
+const float CPUT_LOD_SCREEN_SIZE = 0.5f;    // fraction of the view height where level 1 starts
+const float CPUT_LOD_HYSTERESIS  = 0.1f;
+const float CPUT_LOD_ERROR       = 0.005f;  // fraction of the bounding radius, at level 1
+
+// "Asset/plant.mdl" -> "Asset/plant_lod1.mdl"
+inline std::string CPUTLodFileName(const std::string &modelFileName, int lod)
+{
+    size_t dot = modelFileName.rfind('.');
+    size_t slash = modelFileName.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    {
+        dot = modelFileName.size();
+    }
+    return modelFileName.substr(0, dot) + "_lod" + cput_to_string(lod) + modelFileName.substr(dot);
+}
+
+// Height of a sphere on screen as a fraction of the view's height. Uses the distance
+// rather than the depth, so turning the camera doesn't change it. Works for orthographic
+// projections too (w doesn't depend on the distance there).
+inline float CPUTLodScreenSize(const float3 &center, float radius, const float3 &cameraPosition, const float4x4 &projection)
+{
+    const float distance = (center - cameraPosition).length();
+    if (distance <= radius)
+    {
+        return FLT_MAX;
+    }
+    const float w = distance * fabsf(projection.r2.w) + projection.r3.w;
+    return w > 0.0f ? radius * fabsf(projection.r1.y) / w : FLT_MAX;
+}
+
+// Screen size below which level lod (>= 1) is used
+inline float CPUTLodThreshold(int lod, float lodScale)
+{
+    return CPUT_LOD_SCREEN_SIZE * lodScale / (float)(1 << (lod - 1));
+}
+
+// Level for a screen size, starting from the one used last. lodScale moves the
+// thresholds: 2 keeps full detail up to twice as close, 0 turns LOD off.
+inline int CPUTLodSelect(float screenSize, int currentLod, int lodCount, float lodScale)
+{
+    if (lodScale <= 0.0f || lodCount <= 1)
+    {
+        return 0;
+    }
+    int lod = std::min(std::max(currentLod, 0), lodCount - 1);
+    while (lod + 1 < lodCount && screenSize < CPUTLodThreshold(lod + 1, lodScale) * (1.0f - CPUT_LOD_HYSTERESIS))
+    {
+        lod++;
+    }
+    while (lod > 0 && screenSize > CPUTLodThreshold(lod, lodScale) * (1.0f + CPUT_LOD_HYSTERESIS))
+    {
+        lod--;
+    }
+    return lod;
+}
+
+#endif // CPUTLOD_H
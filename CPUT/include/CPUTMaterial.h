@@ -63,6 +63,7 @@ protected:
     CPUTConfigBlock          *mpConfigBlock;
     CPUTRenderStateBlock *mpRenderStateBlock;
     ConstantBufferDescription        mConstantBuffer;
+    CPUTMaterial         *mpInstancedMaterial; // .mtl "InstancedMaterial", same look drawn with instancing
 
     // Destructor is not public.  Must release instead of delete.
     virtual ~CPUTMaterial(){};
@@ -70,7 +71,8 @@ protected:
     CPUTMaterial() :
 	      mMaterialName("not initialized"),
         mpConfigBlock(NULL),
-	    mpRenderStateBlock(NULL)
+	    mpRenderStateBlock(NULL),
+        mpInstancedMaterial(NULL)
     {
     };
     
@@ -84,6 +86,10 @@ public:
     }
     std::string              *GetMaterialName() { return &mMaterialName; }
     virtual void          SetRenderStates();
+
+    // The variant whose vertex shader takes its world matrix from cbPerInstanceValues.InstanceWorld[SV_InstanceID].
+    // NULL when the material has none, and models using it are drawn one at a time. Not AddRef'd.
+    CPUTMaterial         *GetInstancedMaterial() { return mpInstancedMaterial; }
     virtual CPUTResult    LoadMaterial(
         const std::string   &fileName,
                             CPUT_SHADER_MACRO* pShaderMacros=NULL
@@ -19,6 +19,7 @@
 
 #include "CPUTRefCount.h"
 #include <fstream>
+#include <vector>
 #include "CPUT.h"
 #include "CPUTOSServices.h"
 
@@ -65,6 +66,8 @@ enum eCPUT_VERTEX_ELEMENT_TYPE : UINT
     tWCHAR,     // 13 wchar_t  = 2 bytes
     tFLOAT,     // 14 float  = 4 bytes
     tDOUBLE,    // 15 double  = 8 bytes
+    tHALF,      // 16 half float  = 2 bytes
+    tSNORM8,    // 17 signed __int8 read as -1..1  = 1 byte
 
     // add new ones here
     tINVALID = 255
@@ -120,6 +123,12 @@ inline CPUT_DATA_FORMAT_TYPE CPUT_FILE_ELEMENT_TYPE_TO_CPUT_TYPE_CONVERT(eCPUT_V
     case eCPUT_VERTEX_ELEMENT_TYPE::tDOUBLE: // double  = 8 bytes 
         return CPUT_DATA_FORMAT_TYPE::CPUT_DOUBLE;
         break;
+    case eCPUT_VERTEX_ELEMENT_TYPE::tHALF:   // half float  = 2 bytes
+        return CPUT_DATA_FORMAT_TYPE::CPUT_F16;
+        break;
+    case eCPUT_VERTEX_ELEMENT_TYPE::tSNORM8: // signed normalized __int8  = 1 byte
+        return CPUT_DATA_FORMAT_TYPE::CPUT_SNORM8;
+        break;
     default:
         return CPUT_DATA_FORMAT_TYPE::CPUT_UNKNOWN;
         break;
@@ -146,7 +155,7 @@ struct CPUTVertexElementDesc
     UINT                          mElementSizeInBytes;   // # bytes of this element
     UINT                          mOffset;   // what is the offset within the vertex data
 
-    void Read(CPUTFileSystem::CPUTOSifstream &meshFile);
+    void Read(CPUTFileSystem::iCPUTifstream &meshFile);
 };
 
 //-----------------------------------------------------------------------------
@@ -156,7 +165,7 @@ struct CPUTRawMeshData
     UINT                       mVertexCount;
     char                      *mpVertices;
     UINT                       mIndexCount;
-    UINT                      *mpIndices; // TODO: what about 16-bit indices?  Use void*?
+    UINT                      *mpIndices; // always 32 bit in memory, mIndexType is the file / upload format
     UINT                       mFormatDescriptorCount;
     CPUTVertexElementDesc     *mpElements;
     uint64_t                   mTotalVerticesSizeInBytes;
@@ -190,7 +199,8 @@ struct CPUTRawMeshData
     }
 
     void Allocate(uint32_t numElements);
-    bool Read(CPUTFileSystem::CPUTOSifstream &mdlfile);
+    bool Read(CPUTFileSystem::iCPUTifstream &mdlfile);
+    void Write(std::vector<char> *pOutput) const;
 
 private:
 
@@ -232,6 +242,11 @@ public:
     static CPUTMesh* Create();
     virtual ~CPUTMesh(){}
     virtual void Draw() = 0;
+
+    // Draws instanceCount copies, the vertex shader tells them apart with SV_InstanceID.
+    // Only called when CanDrawInstanced() says the API implements it.
+    virtual bool CanDrawInstanced() { return false; }
+    virtual void DrawInstanced(UINT instanceCount) { UNREFERENCED_PARAMETER(instanceCount); }
     // TODO: ? Change from virtual to #ifdef-controlled redirect to platform versions?
     // TODO: Use CPUT_MAPPED_SUBRESOURCE ??
 #ifdef CPUT_FOR_DX11
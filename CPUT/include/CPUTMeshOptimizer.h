@@ -0,0 +1,99 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CPUTMESHOPTIMIZER_H
+#define CPUTMESHOPTIMIZER_H
+
+/*
+    Rewrites the meshes of a .mdl (as CPUTRawMeshData) so the GPU does less work drawing
+    them. It runs while a model loads when SetLoadFlags() asks for it, or ahead of time in
+    Extras/MeshCook, which writes .mdl files that load without any of this work.
+
+    The steps, in the order Optimize() runs them:
+
+    - quantize: normals, tangents and binormals become 4 x snorm8. Texture coordinates
+      become 2 x half float when they stay within +-CPUT_MESH_HALF_UV_RANGE; past that a
+      half is off by more than half a texel of a 1024 texture, so tiled UVs stay float.
+      Positions and skinning data are left alone. The input layout follows from the new
+      element types, shaders still read float2 / float3.
+    - weld: vertices that are the same byte for byte (after quantizing) become one.
+    - vertex cache: triangles are reordered for the post-transform cache with Forsyth's
+      linear-speed algorithm (scored for a 32 entry LRU cache).
+    - vertex fetch: vertices are renumbered in the order the triangles first use them, so
+      the vertex buffer is read front to back. Unreferenced vertices are dropped.
+    - 16 bit indices: mIndexType becomes tUINT16 when there are at most 65536 vertices.
+      mpIndices stays 32 bit; the DX11 loader narrows them at upload and MeshCook in the
+      file. The OpenGL mesh arena only packs 32 bit indices, so OGL uploads them as is.
+
+    The loader draws every .mdl mesh as an indexed triangle list whatever its mTopology
+    says (FBXConvert writes "strip"), so the reordering steps assume the same.
+*/
+
+#include "CPUTMesh.h"
+
+enum CPUT_MESH_OPTIMIZE_FLAGS
+{
+    CPUT_MESH_OPTIMIZE_NONE         = 0,
+    CPUT_MESH_OPTIMIZE_QUANTIZE     = 0x01,
+    CPUT_MESH_OPTIMIZE_WELD         = 0x02,
+    CPUT_MESH_OPTIMIZE_VERTEX_CACHE = 0x04,
+    CPUT_MESH_OPTIMIZE_VERTEX_FETCH = 0x08,
+    CPUT_MESH_OPTIMIZE_INDEX16      = 0x10,
+    CPUT_MESH_OPTIMIZE_ALL          = 0x1F,
+};
+
+const float CPUT_MESH_HALF_UV_RANGE   = 2.0f;
+const UINT  CPUT_MESH_ACMR_CACHE_SIZE = 16;   // FIFO entries ComputeACMR() models by default
+
+struct CPUTMeshOptimizerStats
+{
+    UINT  mVertexCountBefore;
+    UINT  mVertexCountAfter;
+    UINT  mStrideBefore;        // bytes per vertex
+    UINT  mStrideAfter;
+    UINT  mIndexSizeBefore;     // bytes per index
+    UINT  mIndexSizeAfter;
+    float mACMRBefore;
+    float mACMRAfter;
+};
+
+class CPUTMeshOptimizer
+{
+public:
+    static CPUTResult Optimize(CPUTRawMeshData &mesh, UINT flags, CPUTMeshOptimizerStats *pStats = NULL);
+
+    // The steps on their own. Quantize returns false when no element could be packed.
+    static bool QuantizeVertices(CPUTRawMeshData &mesh);
+    static void WeldVertices(CPUTRawMeshData &mesh);
+    static void OptimizeVertexCache(UINT *pIndices, UINT indexCount, UINT vertexCount);
+    static void OptimizeVertexFetch(CPUTRawMeshData &mesh);
+
+    // Average cache miss ratio: vertices transformed per triangle with a FIFO cache of
+    // cacheSize entries. 3 means no reuse at all, a regular grid can get close to 0.5.
+    static float ComputeACMR(const UINT *pIndices, UINT indexCount, UINT vertexCount, UINT cacheSize = CPUT_MESH_ACMR_CACHE_SIZE);
+
+    // What CPUTModel::LoadModelPayload() runs on each mesh it reads, nothing by default
+    static void SetLoadFlags(UINT flags) { mLoadFlags = flags; }
+    static UINT GetLoadFlags()           { return mLoadFlags; }
+
+    static uint16_t FloatToHalf(float value);
+    static float    HalfToFloat(uint16_t value);
+
+protected:
+    static UINT mLoadFlags;
+};
+
+#endif // CPUTMESHOPTIMIZER_H
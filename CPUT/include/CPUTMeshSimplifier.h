@@ -0,0 +1,58 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CPUTMESHSIMPLIFIER_H
+#define CPUTMESHSIMPLIFIER_H
+
+/*
+    Reduces the triangle count of a CPUTRawMeshData for coarser levels of detail (see
+    CPUTLod.h), by quadric error edge collapse (Garland & Heckbert, "Surface Simplification
+    Using Quadric Error Metrics").
+
+    Every collapse moves a vertex onto one of its neighbours, so no new vertices are made
+    and the attributes of the ones that stay are used as they are. That also means a
+    quantized mesh (CPUTMeshOptimizer) can be simplified, only positions have to be float.
+    The surface is the mesh's positions: vertices at the same place (UV seams, hard edges,
+    both faces of a double sided card) move together. When a position collapses, each of
+    its vertices goes to the vertex at the new position with the closest attributes.
+    Positions are classified before anything moves:
+
+    - manifold (every edge has a triangle on both sides): can collapse onto any neighbour.
+    - border (on one open edge loop, e.g. a hole or the rim of a leaf): only onto the next
+      position along the loop, so the outline keeps its shape.
+    - anything else (edges shared by more than two triangles, loops touching) is locked.
+
+    Open edges and attribute seams also add planes through the edge to the error, which
+    keeps the outline of cards and the seams in place.
+
+    Collapses that would flip a triangle are skipped. The mesh stays an indexed triangle
+    list; vertices no longer used are dropped.
+*/
+
+#include "CPUTMesh.h"
+#include <float.h>
+
+class CPUTMeshSimplifier
+{
+public:
+    // Collapses edges, cheapest first, until at most targetIndexCount indices are left or
+    // the next collapse would move the surface by more than maxError (in the mesh's units).
+    // Returns the largest error of the collapses made, 0 if the mesh is unchanged (e.g. no
+    // float3 positions).
+    static float Simplify(CPUTRawMeshData &mesh, UINT targetIndexCount, float maxError = FLT_MAX);
+};
+
+#endif // CPUTMESHSIMPLIFIER_H
@@ -38,20 +38,31 @@ protected:
 	CPUTMaterial ***mpMaterial;
 
     int             mMeshCount;
+    int             mLodCount;     // 1 when there are no <model>_lodN.mdl files, see CPUTLod.h
+    int             mLod;          // picked by SelectLod()
+    std::vector<CPUTMesh*> mLodMeshes; // mMeshCount per level, from level 1 up
     bool            mIsRenderable;
+    bool            mIsDrawnInstanced; // CPUTAssetSet draws it as part of a CPUTInstanceGroup
     float3          mBoundingBoxCenterObjectSpace;
     float3          mBoundingBoxHalfObjectSpace;
     float3          mBoundingBoxCenterWorldSpace;
     float3          mBoundingBoxHalfWorldSpace;
 	static DrawModelCallBackFunc mDrawModelCallBackFunc;
 
+    // Reads the meshes of a .mdl (from the scene cache if it's there). Fails quietly
+    // with CPUT_ERROR_FILE_NOT_FOUND, missing LOD files are normal.
+    CPUTResult      LoadMeshes(const std::string &FileName, std::vector<CPUTMesh*> *pMeshes);
+
     CPUTSkeleton *mSkeleton;
     CPUTModel():
         mMeshCount(0),
         mpMaterialCount(NULL),
 		mpMaterial(NULL),
         mpMesh(NULL),
+        mLodCount(1),
+        mLod(0),
         mIsRenderable(true),
+        mIsDrawnInstanced(false),
         mBoundingBoxCenterObjectSpace(0.0f),
         mBoundingBoxHalfObjectSpace(0.0f),
         mBoundingBoxCenterWorldSpace(0.0f),
@@ -68,12 +79,33 @@ public:
     {
         return index < mMeshCount ? mpMesh[index] : NULL;
     }
+    // The mesh to draw at the current level of detail
+    CPUTMesh* GetLodMesh(const int index) const { return GetMeshForLod(index, mLod); }
+    CPUTMesh* GetMeshForLod(const int index, const int lod) const
+    {
+        if (index >= mMeshCount)
+        {
+            return NULL;
+        }
+        return lod > 0 && lod < mLodCount ? mLodMeshes[(lod - 1) * mMeshCount + index] : mpMesh[index];
+    }
+    int                GetLod() const { return mLod; }
+    int                GetLodCount() const { return mLodCount; }
+    // Picks the level for how big the model's bounding sphere is in pCamera's view (see
+    // CPUTLodSelect()). Brings the world space bounds up to date.
+    void               SelectLod(CPUTCamera *pCamera, float lodScale);
     void Render(CPUTRenderParameters &renderParams, int materialIndex);
 	static			   void SetDrawModelCallBack(DrawModelCallBackFunc Func){mDrawModelCallBackFunc = Func;}
 
     virtual void       UpdateRecursive(float deltaSeconds);
     bool               IsRenderable() { return mIsRenderable; }
     void               SetRenderable(bool isRenderable) { mIsRenderable = isRenderable; }
+
+    // Skinned models need their own skinning constants, so they are never instanced
+    bool               IsInstanceable() const { return mSkeleton == NULL && mMeshCount > 0; }
+    bool               SharesMeshesAndMaterials(const CPUTModel *pOther) const;
+    bool               IsDrawnInstanced() const { return mIsDrawnInstanced; }
+    void               SetDrawnInstanced(bool isDrawnInstanced) { mIsDrawnInstanced = isDrawnInstanced; }
     virtual bool       IsModel() { return true; }
     CPUT_NODE_TYPE     GetNodeType() { return CPUT_NODE_MODEL;};
 
@@ -84,6 +116,7 @@ public:
     //CPUTMesh          *GetMesh( UINT ii ) { return mpMesh[ii]; }
     virtual CPUTResult LoadModel(CPUTConfigBlock *pBlock, int *pParentID, CPUTModel *pMasterModel=NULL, int numSystemMaterials=0, std::string *pSystemMaterialNames=NULL);
     CPUTResult         LoadModelPayload(const std::string &File);
+    CPUTResult         LoadLodPayloads(const std::string &File);
 
     virtual void       SetMaterial(UINT ii, CPUTMaterial **pMaterial, int numEffects);
     UINT GetMaterialIndex(int meshIndex, int index);
@@ -44,6 +44,8 @@ namespace CPUTFileSystem
     CPUTResult DoesDirectoryExist(const std::string &path);
     CPUTResult OpenFile(const std::string &fileName, FILE **pFilePointer);
 	CPUTResult ReadFileContents(const std::string &fileName, UINT *psizeInBytes, void **ppData, bool bAddTerminator = false, bool bLoadAsBinary = false);
+    // The modification time is in 100 ns units, so an edit within the same second still changes it
+    CPUTResult GetFileInfo(const std::string &fileName, uint64_t *pSizeInBytes, uint64_t *pModifiedTime);
 
     CPUTResult TranslateFileError(int err);
 
@@ -113,6 +115,70 @@ namespace CPUTFileSystem
         std::ifstream mStream;
     };
 
+    // Reads from a block of memory the caller keeps alive, with the same eof/fail
+    // behaviour as std::ifstream so file parsers can run on preloaded data.
+    class CPUTmemifstream : public iCPUTifstream
+    {
+    public:
+        CPUTmemifstream(const char *pData, uint64_t sizeInBytes) : iCPUTifstream(""),
+            mpData(pData), mSize(sizeInBytes), mPosition(0), mbEOF(false), mbFail(pData == NULL) {}
+
+        bool fail() { return mbFail; }
+        bool good() { return !mbFail && !mbEOF; }
+        bool eof()  { return mbEOF; }
+        void read (char* s, int64_t n)
+        {
+            uint64_t available = mSize - mPosition;
+            if ((uint64_t)n > available)
+            {
+                n = (int64_t)available;
+                mbEOF = mbFail = true;
+            }
+            if (n > 0)
+            {
+                memcpy(s, mpData + mPosition, (size_t)n);
+                mPosition += n;
+            }
+        }
+        void close() { mpData = NULL; mSize = mPosition = 0; }
+
+    protected:
+        const char *mpData;
+        uint64_t    mSize;
+        uint64_t    mPosition;
+        bool        mbEOF;
+        bool        mbFail;
+    };
+
+    // Read-only view of a whole file. Where the OS allows it the file is mapped
+    // straight out of the page cache, so nothing is copied and other processes
+    // reading the same file share the pages. If mapping isn't possible the
+    // contents are read into a heap buffer instead; callers can't tell the
+    // difference. The data stays valid until Close() or destruction.
+    class CPUTFileView
+    {
+    public:
+        CPUTFileView() : mpData(NULL), mSize(0), mpMapping(NULL), mpBuffer(NULL) {}
+        ~CPUTFileView() { Close(); }
+
+        // bSequential hints that the file is going to be read front to back once
+        CPUTResult Open(const std::string &fileName, bool bSequential = true);
+        void       Close();
+
+        const char *GetData() const  { return mpData; }
+        uint64_t    GetSize() const  { return mSize; }
+        bool        IsMapped() const { return mpMapping != NULL; }
+
+    private:
+        CPUTFileView(const CPUTFileView &);
+        CPUTFileView & operator=(const CPUTFileView &);
+
+        const char *mpData;
+        uint64_t    mSize;
+        void       *mpMapping; // start of the mapped view, NULL when the file was read into mpBuffer
+        char       *mpBuffer;
+    };
+
 #ifdef CPUT_USE_ANDROID_ASSET_MANAGER
 #define CPUTOSifstream CPUTandroidifstream
 #else
@@ -17,27 +17,78 @@
 #ifndef CPUTPARSER_H
 #define CPUTPARSER_H
 
-#include <map>
 #include <string>
+#include <vector>
+#include <limits.h>
+#include <float.h>
+
+// What the variable a CommandOption points to is
+enum CPUT_COMMAND_OPTION_TYPE
+{
+    CPUT_COMMAND_OPTION_FLAG,       // bool: true when given, "-name:false" or "-name:0" turn it off
+    CPUT_COMMAND_OPTION_INT,        // int
+    CPUT_COMMAND_OPTION_UINT,       // unsigned int
+    CPUT_COMMAND_OPTION_DOUBLE,     // double
+    CPUT_COMMAND_OPTION_STRING,     // std::string
+};
+
+// One entry of the schema CommandParser::ApplyOptions() takes. The variable holds the
+// default; it is only written when the parameter is given with a valid value.
+struct CommandOption
+{
+    const char               *mpName;
+    CPUT_COMMAND_OPTION_TYPE  mType;
+    void                     *mpValue;
+    double                    mMin;     // numbers outside [mMin, mMax] are rejected
+    double                    mMax;
+
+    static CommandOption Flag(const char *pName, bool *pValue);
+    static CommandOption Int(const char *pName, int *pValue, int minValue = INT_MIN, int maxValue = INT_MAX);
+    static CommandOption UInt(const char *pName, unsigned int *pValue, unsigned int minValue = 0, unsigned int maxValue = UINT_MAX);
+    static CommandOption Double(const char *pName, double *pValue, double minValue = -DBL_MAX, double maxValue = DBL_MAX);
+    static CommandOption String(const char *pName, std::string *pValue);
+};
 
 class CommandParser {
 public:
+    CommandParser() : mInParameter(false) {}
     ~CommandParser();
-    void ParseConfigurationOptions(std::string arguments, std::string delimiter = "-");
-    void ParseConfigurationOptions(int argc, char **argv, std::string delimiter = "-");
+    void ParseConfigurationOptions(const std::string &arguments, const std::string &delimiter = "-");
+    void ParseConfigurationOptions(int argc, char **argv, const std::string &delimiter = "-");
     void CleanConfigurationOptions(void);
 
-    void AddParameter(std::string paramName, std::string paramValue);
-    bool GetParameter(std::string arg);
-    bool GetParameter(std::string arg, double *pOut);
-    bool GetParameter(std::string arg, int *pOut);
-    bool GetParameter(std::string arg, unsigned int *pOut);
-    bool GetParameter(std::string arg, std::string *pOut);
-    bool GetParameter(std::string arg, char *pOut);
+    void AddParameter(const std::string &paramName, const std::string &paramValue);
+    bool GetParameter(const std::string &arg);
+    bool GetParameter(const std::string &arg, double *pOut);
+    bool GetParameter(const std::string &arg, int *pOut);
+    bool GetParameter(const std::string &arg, unsigned int *pOut);
+    bool GetParameter(const std::string &arg, std::string *pOut);
+    bool GetParameter(const std::string &arg, char *pOut);
+
+    // Sets the variable of every option in the schema that was given. Returns false when a
+    // value doesn't parse or is out of range, or a parameter isn't in the schema; pErrors
+    // then gets a line for each.
+    bool ApplyOptions(const CommandOption *pOptions, int optionCount, std::string *pErrors = NULL);
 
 private:
-    std::map<std::string, std::string> m_Arguments;
+    // Offsets into mText, where names and values are NUL terminated
+    struct Parameter
+    {
+        size_t mName;
+        size_t mValue;
+        size_t mValueLength;
+    };
+
+    void        BeginParameter(const char *pWord, size_t length);
+    void        AppendWord(const char *pWord, size_t length);
+    void        EndParameter();
+    void        SortParameters();
+    const char *FindValue(const std::string &arg, size_t *pLength) const;
+
+    std::vector<char>      mText;           // the command line, copied once
+    std::vector<Parameter> mParameters;     // sorted by name, the first of equal names wins
+    std::string            mDelimiter;
+    bool                   mInParameter;    // words are being appended to mParameters.back()
 };
 
 #endif // CPUTPARSER_H
-
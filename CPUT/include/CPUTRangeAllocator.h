@@ -0,0 +1,52 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef CPUTRANGEALLOCATOR_H
+#define CPUTRANGEALLOCATOR_H
+
+#include "CPUT.h"
+#include <map>
+
+// Hands out [offset, offset + count) ranges of a fixed size space, e.g. vertices or indices
+// in a shared buffer. Uses best fit, and freed ranges are merged with their free neighbours,
+// so the space doesn't fragment when meshes are loaded and unloaded in any order.
+// Doesn't know anything about what the space is, so it can be used (and checked) on its own.
+class CPUTRangeAllocator
+{
+public:
+    static const UINT INVALID_OFFSET = 0xFFFFFFFF;
+
+    explicit CPUTRangeAllocator(UINT capacity);
+
+    // Returns INVALID_OFFSET when there is no free block of count units
+    UINT Allocate(UINT count);
+    void Free(UINT offset, UINT count);
+
+    UINT GetCapacity() const       { return mCapacity; }
+    UINT GetFreeCount() const      { return mFreeCount; }
+    UINT GetFreeBlockCount() const { return (UINT)mFreeBlocks.size(); }
+    UINT GetLargestFreeBlock() const;
+    bool IsEmpty() const           { return mFreeCount == mCapacity; }
+
+    // 0 when all the free space is in one block, approaching 1 as it gets split into small pieces
+    float GetFragmentation() const;
+
+protected:
+    UINT                 mCapacity;
+    UINT                 mFreeCount;
+    std::map<UINT, UINT> mFreeBlocks; // offset -> count, never two adjacent blocks
+};
+
+#endif // CPUTRANGEALLOCATOR_H
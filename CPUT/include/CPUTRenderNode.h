@@ -37,9 +37,11 @@ protected:
     CPUTRenderNode     *mpChild;
     CPUTRenderNode     *mpSibling;
     bool                mWorldMatrixDirty;
+    bool                mIsDynamic;   // moves after loading, see IsDynamic()
     float4x4            mWorldMatrix; // transform of this object combined with it's parent(s) transform(s)
     float4x4            mParentMatrix;   // transform of this object relative to it's parent
     std::string             mPrefix;
+    static UINT         sStaticSceneVersion;
     ~CPUTRenderNode(); // Destructor is not public.  Must release instead of delete.
 
     
@@ -181,6 +183,14 @@ public:
     float4x4        *GetWorldMatrix();
     float4x4         GetParentsWorldMatrix();
     void             MarkDirty();
+
+    // Dynamic nodes are expected to move every frame: flagged in the .set ("dynamic = true"),
+    // animated, or below such a node. Everything else is static, and a change to a static
+    // model (moving it, a new level of detail) bumps GetStaticSceneVersion(), so whatever is
+    // drawn from the static models once (e.g. a cached shadow map) knows to redraw.
+    bool             IsDynamic() const { return mIsDynamic || mpCurrentNodeAnimation || mpCurrentAnimation || (mpParent && mpParent->IsDynamic()); }
+    void             SetDynamic(bool isDynamic) { mIsDynamic = isDynamic; sStaticSceneVersion++; }
+    static UINT      GetStaticSceneVersion() { return sStaticSceneVersion; }
     void             AddChild(CPUTRenderNode *pNode);
     void             AddSibling(CPUTRenderNode *pNode);
     virtual void     Update( float deltaSeconds = 0.0f ){}
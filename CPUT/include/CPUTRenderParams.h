@@ -20,6 +20,15 @@
 // TODO:  Change name to CPUTRenderContext?
 class CPUTCamera;
 class CPUTBuffer;
+
+// Which models CPUTAssetSet::RenderRecursive() draws, see CPUTRenderNode::IsDynamic()
+enum CPUT_DRAW_NODES
+{
+    CPUT_DRAW_STATIC_NODES  = 0x1,
+    CPUT_DRAW_DYNAMIC_NODES = 0x2,
+    CPUT_DRAW_ALL_NODES     = 0x3,
+};
+
 class CPUTRenderParameters
 {
 public:
@@ -31,8 +40,11 @@ public:
     CPUTCamera  *mpCamera;
     CPUTCamera  *mpShadowCamera;
     CPUTBuffer  *mpPerModelConstants;
+    CPUTBuffer  *mpPerInstanceConstants; // set to draw asset set instance groups with one draw per mesh
     CPUTBuffer  *mpPerFrameConstants;
     CPUTBuffer  *mpSkinningData;
+    int          mDrawNodes;        // CPUT_DRAW_NODES
+    int          mDrawCount;        // incremented for every mesh draw the scene issues, for stats
 
     CPUTRenderParameters() :
         mShowBoundingBoxes(false),
@@ -41,9 +53,13 @@ public:
         mpCamera(0),
         mpShadowCamera(0),
         mpPerModelConstants(0),
+        mpPerInstanceConstants(0),
         mpPerFrameConstants(0),
-        mpSkinningData(0)
+        mpSkinningData(0),
+        mDrawNodes(CPUT_DRAW_ALL_NODES),
+        mDrawCount(0)
     {}
+    bool DrawsNode(bool isDynamic) const { return (mDrawNodes & (isDynamic ? CPUT_DRAW_DYNAMIC_NODES : CPUT_DRAW_STATIC_NODES)) != 0; }
     ~CPUTRenderParameters(){}
 private:
 };
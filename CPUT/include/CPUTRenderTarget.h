@@ -236,6 +236,7 @@ public:
 
     ID3D11DepthStencilView   *GetDepthBufferView()   { return mpDepthStencilView; }
     ID3D11ShaderResourceView *GetDepthResourceView() { return mpDepthResourceView; }
+    ID3D11Texture2D          *GetDepthTexture()      { return mpDepthTextureDX; }
     UINT                      GetWidth()             { return mWidth; }
     UINT                      GetHeight()            { return mHeight; }
 
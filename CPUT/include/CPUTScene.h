@@ -19,6 +19,7 @@
 
 #include "CPUTAssetSet.h"
 #include "CPUTConfigBlock.h"
+#include "CPUTAssetLoader.h"
 
 #include <string>
 #include <float.h>
@@ -46,8 +47,17 @@ public:
 
     //
     // Loads the asset sets listed in the file. Calculates the bounding box/extents for the scene.
+    // With useSceneCache the parsed files and model payloads are cooked into <sceneFileName>.cache
+    // on the first load and read back from there on later loads (see CPUTSceneCache.h).
     //
-    CPUTResult LoadScene(const std::string &sceneFileName);
+    CPUTResult LoadScene(const std::string &sceneFileName, bool useSceneCache = true);
+
+    //
+    // Same as LoadScene, but reading and parsing happens on a CPUTAssetLoader thread and the asset
+    // sets are created one per CPUTAssetLoader::ProcessMainThreadWork() step. The scene must not be
+    // updated, rendered or deleted until the returned request IsDone(). Release the request when done.
+    //
+    CPUTLoadRequest *LoadSceneAsync(const std::string &sceneFileName, bool useSceneCache = true);
 
     //
     // Adds the given asset set to the scene. Increments reference count of the asset set.
@@ -68,6 +78,12 @@ public:
     //
     void Render(CPUTRenderParameters &renderParameters, int materialIndex=0);
 
+    //
+    // Picks the level of detail of every model for pCamera, before the frame's passes so
+    // the shadow pass draws the same levels. A lodScale of 0 draws full detail everywhere.
+    //
+    void SelectLods(CPUTCamera *pCamera, float lodScale = 1.0f);
+
     //
 	// Update frames
 	//
@@ -120,6 +136,23 @@ protected:
     //
     void CalculateBoundingBox();
 
+    //
+    // Does the actual loading for LoadScene, with or without an active scene cache
+    //
+    CPUTResult LoadSceneAssets(const std::string &sceneFileName);
+
+    //
+    // Parses the scene file and lists the asset sets it references with their asset directories.
+    // Doesn't touch the asset library, so it can run on a loader thread.
+    //
+    CPUTResult ReadSceneFile(const std::string &sceneFileName, const std::string &mediaDirectory,
+                             std::vector<std::string> *pSetFileNames, std::vector<std::string> *pAssetDirectories);
+
+    //
+    // Loads one asset set through the asset library and adds it to the scene
+    //
+    void LoadAssetSet(const std::string &setFileName, const std::string &assetDirectory);
+
     CPUTConfigFile    mSceneFile;
     CPUTAssetSet     *mpAssetSetList[MAX_NUM_ASSETS]; // an stl::vector may be better here
     unsigned int      mNumAssetSets;
@@ -0,0 +1,125 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CPUTSCENECACHE_H
+#define CPUTSCENECACHE_H
+
+/*
+    The scene cache is a single "cooked" file that sits next to a .scene file and holds
+    everything CPUTScene::LoadScene would otherwise read and parse from the individual
+    asset files:
+
+    - CPUT_CACHE_CONFIG entries: pre-parsed CPUTConfigFile images (.scene, .set, .mtl, .rs)
+    - CPUT_CACHE_MODEL  entries: .mdl payloads (vertex/index blobs) read with one read
+
+    Each entry remembers the size and modification time (to 100 ns, see GetFileInfo) of the
+    source it came from, so a stale entry is simply ignored and re-cooked. While a cache is active (see
+    SetActiveCache) the loaders look there first and hand anything they had to load the slow
+    way back via Add(). Save() rewrites the file if anything was added, leaving out the
+    entries whose source was deleted or changed since. It writes a temporary file and renames
+    it over the old one, so a crash while saving leaves the previous cache or none.
+
+    File layout (little endian, every payload 16 byte aligned so the file can be mapped and
+    used in place, which is what Open() does):
+
+        CPUTSceneCacheHeader
+        payload 0 .. payload N-1
+        CPUTSceneCacheDirectoryEntry 0 + path 0 ... (at mDirectoryOffset)
+*/
+
+#include "CPUT.h"
+#include "CPUTOSServices.h"
+#include <map>
+#include <vector>
+
+const UINT CPUT_SCENE_CACHE_MAGIC   = 0x43535043; // 'CPSC'
+const UINT CPUT_SCENE_CACHE_VERSION = 2;          // bump whenever a cached payload format changes
+
+enum CPUT_CACHE_ENTRY_TYPE
+{
+    CPUT_CACHE_CONFIG = 1,
+    CPUT_CACHE_MODEL  = 2,
+};
+
+struct CPUTSceneCacheHeader
+{
+    UINT     mMagic;
+    UINT     mVersion;
+    UINT     mEntryCount;
+    UINT     mReserved;
+    uint64_t mDirectoryOffset;
+};
+
+struct CPUTSceneCacheDirectoryEntry
+{
+    UINT     mType;
+    UINT     mPathLength;   // path characters follow the entry, padded to 8 bytes
+    uint64_t mSourceSize;
+    uint64_t mSourceTime;
+    uint64_t mOffset;
+    uint64_t mSize;
+};
+
+class CPUTSceneCache
+{
+public:
+    CPUTSceneCache();
+    ~CPUTSceneCache();
+
+    // Loads the cache file if there is a valid one. A missing or outdated file is not an
+    // error, the cache just starts out empty.
+    CPUTResult Open(const std::string &cacheFileName);
+    CPUTResult Save();
+    void       Close();
+
+    // Returns the cached payload for sourceFileName if it is still up to date. The data
+    // stays valid until the cache is saved or closed.
+    bool Find(CPUT_CACHE_ENTRY_TYPE type, const std::string &sourceFileName, const char **ppData, UINT *pSizeInBytes);
+    void Add(CPUT_CACHE_ENTRY_TYPE type, const std::string &sourceFileName, const char *pData, UINT sizeInBytes);
+
+    UINT GetHitCount()  { return mHitCount; }
+    UINT GetMissCount() { return mMissCount; }
+
+    // The active cache is per thread, so loader threads can fill their own cache while
+    // the main thread loads through another one
+    static CPUTSceneCache *GetActiveCache() { return mpActiveCache; }
+    static void            SetActiveCache(CPUTSceneCache *pCache) { mpActiveCache = pCache; }
+
+private:
+    CPUTSceneCache(const CPUTSceneCache &);
+    CPUTSceneCache & operator=(const CPUTSceneCache &);
+
+    struct CacheEntry
+    {
+        CPUT_CACHE_ENTRY_TYPE mType;
+        uint64_t              mSourceSize;
+        uint64_t              mSourceTime;
+        const char           *mpData;   // points into mFileView or mOwnedData
+        UINT                  mSize;
+        std::vector<char>     mOwnedData;
+    };
+
+    static CPUT_THREAD_LOCAL CPUTSceneCache *mpActiveCache;
+
+    std::string                        mFileName;
+    CPUTFileSystem::CPUTFileView       mFileView;
+    std::map<std::string, CacheEntry>  mEntries;
+    UINT                               mHitCount;
+    UINT                               mMissCount;
+    bool                               mbDirty;
+};
+
+#endif // CPUTSCENECACHE_H
@@ -0,0 +1,132 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CPUTSHADERCACHE_H
+#define CPUTSHADERCACHE_H
+
+/*
+    Compiled shader bytecode, addressed by what went into it. The key is a 64 bit hash of
+
+        - the compiler's id (compiler version and flags)
+        - entry point, profile and the macros, in order
+        - the contents of the source, and of every file it #includes, recursively
+
+    so two materials asking for the same permutation share one compile, an edited include
+    only invalidates the shaders that use it, and renaming or moving files changes nothing.
+
+    GetBytecode() looks in memory first, then in the cache directory ("<key>.cso", written by
+    earlier runs or by Extras/ShaderCook ahead of time), and only then runs the compiler.
+    Nothing here knows about D3D: the compiler is a CPUTShaderCompiler (CPUTShaderCompilerD3D
+    for DX11), so keys and include tracking can be checked anywhere with a stand-in compiler.
+
+    Includes are found by scanning for #include lines, resolved relative to the including
+    file the way D3D_COMPILE_STANDARD_FILE_INCLUDE does. #if isn't evaluated, so an include in
+    a disabled block still counts; the worst that does is a needless recompile.
+*/
+
+#include "CPUT.h"
+#include <map>
+#include <set>
+#include <vector>
+
+const UINT CPUT_SHADER_CACHE_TAG     = 0x43535043; // 'CPSC'
+const UINT CPUT_SHADER_CACHE_VERSION = 1;          // bump whenever the keys or the file layout change
+
+struct CPUTShaderDefine
+{
+    std::string name;
+    std::string definition;
+
+    CPUTShaderDefine() {}
+    CPUTShaderDefine(const std::string &_name, const std::string &_definition) : name(_name), definition(_definition) {}
+};
+
+struct CPUTShaderCompileRequest
+{
+    std::string                   fileName;   // source file, or the name to report errors under when pSource is set
+    const char                   *pSource;    // NULL to read fileName. Includes are relative to the working directory.
+    std::string                   entryPoint;
+    std::string                   profile;
+    std::vector<CPUTShaderDefine> defines;
+
+    CPUTShaderCompileRequest() : pSource(NULL) {}
+};
+
+class CPUTShaderCompiler
+{
+public:
+    virtual ~CPUTShaderCompiler() {}
+
+    // Goes into every key, so bytecode from another compiler or other flags is never picked up
+    virtual std::string GetCompilerId() = 0;
+
+    // False, with *pErrors filled in, when it doesn't compile
+    virtual bool        Compile(const CPUTShaderCompileRequest &request, std::vector<char> *pBytecode, std::string *pErrors) = 0;
+};
+
+class CPUTShaderCache
+{
+public:
+    // Deletes pCompiler with the cache. The cache directory is off until SetCacheDirectory().
+    explicit CPUTShaderCache(CPUTShaderCompiler *pCompiler);
+    ~CPUTShaderCache();
+
+    // Empty keeps everything in memory
+    void               SetCacheDirectory(const std::string &directory);
+    const std::string &GetCacheDirectory() const { return mCacheDirectory; }
+    std::string        GetBytecodeFileName(uint64_t key) const;
+
+    // Nothing is compiled. pDependencies gets the files the key was made from, source first.
+    CPUTResult         ComputeKey(const CPUTShaderCompileRequest &request, uint64_t *pKey, std::vector<std::string> *pDependencies = NULL);
+
+    // *ppBytecode stays valid until ClearMemory() or the cache goes away
+    CPUTResult         GetBytecode(const CPUTShaderCompileRequest &request, const std::vector<char> **ppBytecode, std::string *pErrors = NULL, uint64_t *pKey = NULL);
+
+    // Forgets file contents and bytecode held in memory, e.g. after shaders were edited.
+    // What is on disk stays; a changed file gets a new key.
+    void               ClearMemory();
+
+    // The names in the #include lines of pSource, in order
+    static void        ScanIncludes(const char *pSource, size_t size, std::vector<std::string> *pIncludes);
+
+    UINT               GetMemoryHitCount() const { return mMemoryHitCount; }
+    UINT               GetDiskHitCount() const   { return mDiskHitCount; }
+    UINT               GetCompileCount() const   { return mCompileCount; }
+
+protected:
+    struct SourceFile
+    {
+        bool                     bFound;
+        uint64_t                 hash;
+        std::vector<std::string> includes;
+    };
+
+    const SourceFile &GetSourceFile(const std::string &fileName);
+    void              AddIncludes(const std::string &directory, const std::vector<std::string> &includes, std::string *pKeyData, std::set<std::string> *pVisited, std::vector<std::string> *pDependencies);
+    bool              LoadBytecode(uint64_t key, std::vector<char> *pBytecode);
+    void              StoreBytecode(uint64_t key, const std::vector<char> &bytecode);
+
+    CPUTShaderCompiler                     *mpCompiler;
+    std::string                             mCompilerId;   // asked once
+    std::string                             mCacheDirectory;
+    std::map<std::string, SourceFile>       mSourceFiles;  // read once per file
+    std::map<uint64_t, std::vector<char> >  mBytecode;
+    UINT                                    mMemoryHitCount;
+    UINT                                    mDiskHitCount;
+    UINT                                    mCompileCount;
+};
+
+#endif // CPUTSHADERCACHE_H
@@ -0,0 +1,59 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef __CPUTSHADOWCACHE_H__
+#define __CPUTSHADOWCACHE_H__
+
+#include "CPUT.h"
+
+class CPUTRenderParameters;
+
+// The render target side of a shadow pass, supplied by the sample for CPUTShadowCache::Render()
+class CPUTShadowCacheTargets
+{
+public:
+    virtual ~CPUTShadowCacheTargets() {}
+
+    // Draws the casters renderParams.mDrawNodes selects into the shadow map, or with bStaticMap
+    // into the map that keeps the static casters. bClear clears the map first.
+    virtual void DrawShadowCasters(CPUTRenderParameters &renderParams, bool bStaticMap, bool bClear) = 0;
+    // Copies the static casters' map over the shadow map
+    virtual void CopyStaticShadowMap() = 0;
+};
+
+// Draws the static shadow casters (see CPUTRenderNode::IsDynamic()) into a map of their own once
+// and copies it into the shadow map, so only the dynamic casters are drawn every frame. Any change
+// to a static node (CPUTRenderNode::GetStaticSceneVersion()) redraws the whole static map; there
+// is a single shadow map and no cascades or tiles that could be redrawn on their own.
+class CPUTShadowCache
+{
+public:
+    CPUTShadowCache();
+
+    // Draws this frame's shadow map. Without bCacheStatic every caster is drawn into it each frame.
+    // renderParams.mDrawCount counts the shadow pass's draws alone.
+    void Render(CPUTRenderParameters &renderParams, bool bCacheStatic, CPUTShadowCacheTargets *pTargets);
+    // For changes the static scene version doesn't see, e.g. a new scene or shadow camera
+    void Invalidate() { mbStaticValid = false; }
+    int  GetDrawCount() const { return mDrawCount; }
+
+protected:
+    UINT mStaticVersion;    // CPUTRenderNode::GetStaticSceneVersion() the static map was drawn at
+    bool mbStaticValid;
+    bool mbHasDynamic;      // dynamic casters were drawn over the copy last frame
+    int  mDrawCount;
+};
+
+#endif // __CPUTSHADOWCACHE_H__
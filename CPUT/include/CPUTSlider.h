@@ -88,6 +88,8 @@ public:
     
     // draw
     virtual void Draw(CPUTGUIVertex *pVertexBufferMirror, UINT *pInsertIndex, UINT pMaxBufferSize);
+    virtual bool IsGeometryDirty();
+    virtual void ClearGeometryDirty();
 
 protected:
         struct LocationGuides
@@ -0,0 +1,77 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CPUTTEXTURECOOKER_H
+#define CPUTTEXTURECOOKER_H
+
+/*
+    Texture cooking turns a source image (.png, .jpg, anything stb_image decodes) into a
+    .dds file next to it, "<source>.cooked.dds", holding the whole mip chain. Loading that
+    is a straight upload: no decode and no glGenerateMipmap at startup. The DDS loaders
+    (LoadTextureS3TC for OGL, DDSTextureLoader for DX11) read it as they would any other
+    .dds.
+
+    Cooked files are 32 bit RGBA, or BC1/BC3 when the cooker is built with DirectXTex
+    (CPUT_TEXTURE_COOKER_DIRECTXTEX). Mips are box filtered; for sRGB textures the
+    filtering is done on linear values.
+
+    DDS header words mReserved1[0..7] (unused by the loaders) identify the source:
+
+        [0]    CPUT_TEXTURE_COOKER_TAG
+        [1]    CPUT_TEXTURE_COOKER_VERSION | flags (sRGB)
+        [2..3] 64 bit hash of the source file contents (CPUTHash64)
+        [4..5] source file size
+        [6..7] source file modification time
+
+    A cooked file is up to date when its size and time match the source, or failing that
+    (e.g. after a fresh checkout), when its hash does. A cooked file without its source
+    (a stripped package) is always used. When the cooked file is stale or missing, the DX11
+    loader cooks the source in memory (CookToMemory) and leaves the file alone.
+*/
+
+#include "CPUT.h"
+#include <vector>
+
+const UINT CPUT_TEXTURE_COOKER_TAG     = 0x43545043; // 'CPTC'
+const UINT CPUT_TEXTURE_COOKER_VERSION = 1;          // bump whenever the cooked output changes
+const UINT CPUT_TEXTURE_COOKER_SRGB    = 0x80000000;
+
+enum CPUT_TEXTURE_COOK_FORMAT
+{
+    CPUT_COOK_RGBA8 = 0,
+    CPUT_COOK_BC1   = 1,  // need CPUT_TEXTURE_COOKER_DIRECTXTEX, RGBA8 is written otherwise
+    CPUT_COOK_BC3   = 2,
+};
+
+class CPUTTextureCooker
+{
+public:
+    static std::string GetCookedFileName(const std::string &sourceFileName);
+
+    // Only the name and extension are looked at, nothing is read
+    static bool IsCookableFile(const std::string &fileName);
+
+    // True when cookedFileName exists and was made from the current contents of
+    // sourceFileName with the same sRGB setting
+    static bool IsCookedFileUpToDate(const std::string &sourceFileName, const std::string &cookedFileName, bool sRGB);
+
+    static CPUTResult Cook(const std::string &sourceFileName, const std::string &cookedFileName, bool sRGB, CPUT_TEXTURE_COOK_FORMAT format);
+
+    // What Cook() writes, built in memory: for a loader whose cooked file is stale
+    static CPUTResult CookToMemory(const std::string &sourceFileName, bool sRGB, CPUT_TEXTURE_COOK_FORMAT format, std::vector<char> *pOutput);
+};
+
+#endif // CPUTTEXTURECOOKER_H
@@ -19,6 +19,7 @@
 
 #include "CPUTAssetLibrary.h"
 #include "CPUTConfigBlock.h"
+#include "CPUTShaderCache.h"
 
 #include <d3d11.h>
 
@@ -56,10 +57,11 @@ protected:
     static std::vector<CPUTAsset<CPUTDomainShaderDX11>> mpDomainShaderList;
 
 public:
-    CPUTAssetLibraryDX11(){}
+    CPUTAssetLibraryDX11() : mpShaderCache(NULL) {}
     virtual ~CPUTAssetLibraryDX11()
     {
         ReleaseAllLibraryLists();
+        SAFE_DELETE(mpShaderCache);
     }
 
     virtual void ReleaseAllLibraryLists();
@@ -96,6 +98,12 @@ public:
  
     CPUTResult CompileShaderFromFile(  const std::string &fileName,   const std::string &shaderMain, const std::string &shaderProfile, ID3DBlob **ppBlob, CPUT_SHADER_MACRO  *pShaderMacros=NULL );
     CPUTResult CompileShaderFromMemory(const char *pShaderSource, const std::string &shaderMain, const std::string &shaderProfile, ID3DBlob **ppBlob, CPUT_SHADER_MACRO  *pShaderMacros=NULL );
+
+    // Bytecode for both of the above, kept in "ShaderCacheDX11/" next to the executable
+    CPUTShaderCache *GetShaderCache();
+
+protected:
+    CPUTShaderCache *mpShaderCache;
 };
 
 #endif // #ifndef __CPUTASSETLIBRARYDX11_H__
@@ -45,6 +45,7 @@ private:
     CPUTMeshDX11  *mpUberBuffer;
 
     CPUTResult UpdateUberBuffers();
+    CPUTResult UpdateUberBufferRange(UINT firstVertex, UINT numVertices);
 
     CPUTGuiControllerDX11();    // singleton
     ~CPUTGuiControllerDX11();
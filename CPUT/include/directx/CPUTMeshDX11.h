@@ -77,6 +77,8 @@ public:
                                   void                  *pIndex
                               );
     void                      Draw();
+    bool                      CanDrawInstanced() { return true; }
+    void                      DrawInstanced(UINT instanceCount);
 
     D3D11_MAPPED_SUBRESOURCE  MapVertices(   CPUTRenderParameters &params, eCPUTMapType type, bool wait=true );
     D3D11_MAPPED_SUBRESOURCE  MapIndices(    CPUTRenderParameters &params, eCPUTMapType type, bool wait=true );
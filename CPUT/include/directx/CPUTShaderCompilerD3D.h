@@ -0,0 +1,45 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _CPUTSHADERCOMPILERD3D_H
+#define _CPUTSHADERCOMPILERD3D_H
+
+#include "CPUTShaderCache.h"
+
+// D3DCompileFromFile / D3DCompile for CPUTShaderCache, with the standard include handler
+class CPUTShaderCompilerD3D : public CPUTShaderCompiler
+{
+public:
+    CPUTShaderCompilerD3D(UINT flags1 = 0, UINT flags2 = 0) : mFlags1(flags1), mFlags2(flags2) {}
+
+    std::string GetCompilerId();
+    bool        Compile(const CPUTShaderCompileRequest &request, std::vector<char> *pBytecode, std::string *pErrors);
+
+    // CPUTAssetLibraryDX11::CompileShaderFromFile adds these after the caller's macros.
+    // Here so Extras/ShaderCook cooks with exactly the same ones.
+    static void AddFileDefines(std::vector<CPUTShaderDefine> *pDefines)
+    {
+        pDefines->push_back(CPUTShaderDefine("_CPUT",     "1"));
+        pDefines->push_back(CPUTShaderDefine("FOG_COLOR", "(float3( 0.89f, 0.92f, 0.88f )*0.5f)"));
+        pDefines->push_back(CPUTShaderDefine("FOG_START", "2000.0f"));
+        pDefines->push_back(CPUTShaderDefine("FOG_END",   "6000.0f"));
+    }
+
+protected:
+    UINT mFlags1;
+    UINT mFlags2;
+};
+
+#endif //_CPUTSHADERCOMPILERD3D_H
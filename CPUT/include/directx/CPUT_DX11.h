@@ -76,6 +76,7 @@ protected:
     //move to sample
     CPUTBuffer            *mpPerFrameConstantBuffer;
     CPUTBuffer            *mpPerModelConstantBuffer;
+    CPUTBuffer            *mpPerInstanceConstantBuffer;
     CPUTBuffer            *mpSkinningDataConstantBuffer;
 
 public:
@@ -93,7 +94,10 @@ public:
         mSwapChainFormat(DXGI_FORMAT_UNKNOWN),
         mbShutdown(false),
         mSyncInterval(1),    // start with vsync on
-        mpPerFrameConstantBuffer(NULL)
+        mpPerFrameConstantBuffer(NULL),
+        mpPerModelConstantBuffer(NULL),
+        mpPerInstanceConstantBuffer(NULL),
+        mpSkinningDataConstantBuffer(NULL)
     {
 		mpTimer = CPUTTimerWin::Create();
         gpSample = this;
@@ -0,0 +1,123 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef CPUTPROGRAMCACHEOGL_H
+#define CPUTPROGRAMCACHEOGL_H
+
+/*
+    Keeps linked programs on disk (glGetProgramBinary) together with what CPUTMaterialOGL
+    reflects from them, so a warm launch neither compiles nor links the shaders and doesn't
+    walk the program's uniforms.
+
+    CPUTShaderOGL::CreateFromFiles gives each shader its source with glShaderSource but leaves
+    the compile to the cache (RegisterShader). CPUTMaterialOGL then asks for its program with
+    LinkProgram(). The key hashes the attached shaders' full sources (version line, stage
+    define, macros and files) with the GL vendor, renderer and version strings:
+
+    - hit: the program is created with glProgramBinary and the reflection is read from the
+      same file. The shaders are never compiled.
+    - miss, or the driver refuses the binary (driver update, other GPU): the shaders are
+      compiled, the program linked, and the material reflects it and calls StoreProgram().
+
+    One file per program, "<key>.glprog" in the cache directory ("ShaderCacheOGL/" next to the
+    executable unless SetCacheDirectory() says otherwise). Contexts that have no program binary
+    formats compile and link every launch, as before.
+*/
+
+#include "CPUT.h"
+#include <map>
+#include <vector>
+
+// What CPUTMaterialOGL::ReadShaderSamplersAndTextures() needs to know about a program.
+// Locations and block indices are looked up by name when it's applied, those are cheap.
+struct CPUTProgramReflectionOGL
+{
+    struct Uniform
+    {
+        std::string name;
+        int         type;
+        int         offset;
+        int         arrayLength;
+    };
+
+    std::vector<std::string> textureNames;   // sampler uniforms
+    std::vector<std::string> imageNames;     // image uniforms, CPUT_SUPPORT_IMAGE_STORE only
+    std::vector<std::string> blockNames;     // uniform blocks, in block index order
+    int                      externalsBlock; // index in blockNames of the material externals, -1 if there are none
+    int                      externalsSize;  // bytes
+    std::vector<Uniform>     externals;      // the externals block's members
+
+    CPUTProgramReflectionOGL() : externalsBlock(-1), externalsSize(0) {}
+};
+
+const UINT CPUT_PROGRAM_CACHE_TAG     = 0x42475043; // 'CPGB'
+const UINT CPUT_PROGRAM_CACHE_VERSION = 1;          // bump whenever the file layout or the reflection changes
+
+class CPUTProgramCacheOGL
+{
+public:
+    static CPUTProgramCacheOGL *GetProgramCache();
+    static void                 DeleteProgramCache();
+
+    CPUTProgramCacheOGL();
+
+    // Disabled, LinkProgram() compiles and links every time and nothing is written
+    void        SetEnabled(bool bEnabled)   { mbEnabled = bEnabled; }
+    bool        IsEnabled() const           { return mbEnabled; }
+    void        SetCacheDirectory(const std::string &directory);
+    std::string GetCacheDirectory();
+
+    // shader has its source but isn't compiled yet. name is only used in error messages.
+    void        RegisterShader(GLuint shader, const std::string &name, uint64_t sourceHash);
+
+    // Compiles a registered shader the first time it's called. False when it doesn't compile.
+    bool        CompileShader(GLuint shader);
+
+    // Returns the linked program for pShaders (numShaders of them, registered), or 0 when
+    // it doesn't link. *pbReflected says whether *pReflection was filled in from the cache;
+    // when it wasn't, reflect the program and pass it to StoreProgram() with *pKey.
+    GLuint      LinkProgram(const GLuint *pShaders, int numShaders, CPUTProgramReflectionOGL *pReflection, bool *pbReflected, uint64_t *pKey);
+    void        StoreProgram(GLuint program, uint64_t key, const CPUTProgramReflectionOGL &reflection);
+
+    // Queries a linked program's reflection from GL, what StoreProgram() wants
+    static void ReflectProgram(GLuint program, CPUTProgramReflectionOGL *pReflection);
+
+    UINT        GetHitCount() const         { return mHitCount; }
+    UINT        GetMissCount() const        { return mMissCount; }
+
+protected:
+    struct Shader
+    {
+        std::string name;
+        uint64_t    hash;
+        bool        bCompiled;
+    };
+
+    bool        IsSupported(); // needs the context, so asked on first use
+    std::string GetProgramFileName(uint64_t key);
+    GLuint      LoadProgram(uint64_t key, CPUTProgramReflectionOGL *pReflection);
+
+    static CPUTProgramCacheOGL *mpProgramCache;
+
+    std::map<GLuint, Shader> mShaders;
+    std::string              mCacheDirectory;
+    uint64_t                 mDriverHash;
+    int                      mSupported;    // -1 until IsSupported() has looked
+    bool                     mbEnabled;
+    UINT                     mHitCount;
+    UINT                     mMissCount;
+};
+
+#endif // CPUTPROGRAMCACHEOGL_H
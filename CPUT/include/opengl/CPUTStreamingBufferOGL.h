@@ -0,0 +1,166 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef CPUTSTREAMINGBUFFEROGL_H
+#define CPUTSTREAMINGBUFFEROGL_H
+
+/*
+    One large GL buffer that per-frame data is written into, instead of every dynamic buffer
+    doing its own glBufferSubData (which can stall when the driver still has the old contents
+    in flight).
+
+    When GL_ARB_buffer_storage is available the buffer is created immutable and mapped once,
+    persistently and coherently, and Allocate() just hands out pointers into the mapping. The
+    space is reused as a ring: everything allocated between two OnFrameStart() calls is one
+    region, closed with a fence, and an allocation only waits when it would overwrite a region
+    whose fence hasn't signalled yet, i.e. when the GPU is more than a ring behind.
+
+    Older contexts fall back to orphaning: each allocation maps its range unsynchronized, and
+    when the ring wraps the storage is re-specified so the driver can hand out fresh memory
+    while the old contents are still being read.
+
+    Uniform buffers aren't copied out of the ring at all when it is persistently mapped:
+    SetUniformData() writes the whole block into this frame's region and points every bind
+    point showing the buffer at it with glBindBufferRange. At the next OnFrameStart() a block
+    that was written in the frame is carried into the new region, one that wasn't is copied
+    back into the buffer's own storage (once) and bound whole again, so no binding ever refers
+    to a region the ring is about to reuse.
+
+    All GL calls go through a CPUTStreamingBufferGL, so the allocator and fence bookkeeping
+    can be run without a context by passing in a fake one.
+*/
+
+#include "CPUT.h"
+#include <deque>
+#include <map>
+#include <vector>
+
+// The GL entry points the streaming buffer uses
+class CPUTStreamingBufferGL
+{
+public:
+    virtual ~CPUTStreamingBufferGL() {}
+
+    // True when the buffer can be mapped persistently (GL 4.4 or GL_ARB_buffer_storage)
+    virtual bool   SupportsPersistentMapping() = 0;
+
+    // Creates the buffer, immutable and persistently mapped (*ppMapped) when bPersistent is set
+    virtual GLuint CreateBuffer(GLsizeiptr sizeBytes, bool bPersistent, void **ppMapped) = 0;
+    virtual void   DeleteBuffer(GLuint buffer, bool bPersistent) = 0;
+
+    // Non persistent path only
+    virtual void  *MapRange(GLuint buffer, GLintptr offset, GLsizeiptr sizeBytes) = 0;
+    virtual void   Unmap(GLuint buffer) = 0;
+    virtual void   Orphan(GLuint buffer, GLsizeiptr sizeBytes) = 0;
+
+    virtual GLsync InsertFence() = 0;
+    // Returns true once the fence has signalled. With bBlock set, waits for it.
+    virtual bool   WaitFence(GLsync fence, bool bBlock) = 0;
+    virtual void   DeleteFence(GLsync fence) = 0;
+
+    virtual void   CopyBuffer(GLuint srcBuffer, GLintptr srcOffset, GLuint dstBuffer, GLintptr dstOffset, GLsizeiptr sizeBytes) = 0;
+
+    // glBindBufferRange(GL_UNIFORM_BUFFER, ...), or glBindBufferBase when sizeBytes is 0
+    virtual void   BindUniformBuffer(GLuint bindPoint, GLuint buffer, GLintptr offset, GLsizeiptr sizeBytes) = 0;
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    virtual UINT   GetUniformOffsetAlignment() = 0;
+};
+
+class CPUTStreamingBufferOGL
+{
+public:
+    static CPUTStreamingBufferOGL *GetStreamingBuffer();
+    static void                    DeleteStreamingBuffer();
+
+    // pGL is owned by the streaming buffer from here on
+    CPUTStreamingBufferOGL(CPUTStreamingBufferGL *pGL, UINT sizeBytes);
+    ~CPUTStreamingBufferOGL();
+
+    // Returns somewhere to write sizeBytes, at *pOffset in GetBufferID(), or NULL when the
+    // request is bigger than the whole buffer. Call EndWrite() before the data is used.
+    void      *Allocate(UINT sizeBytes, UINT alignment, UINT *pOffset);
+    void       EndWrite();
+
+    // Copies pData into the ring and queues a copy from there to dstBuffer
+    CPUTResult Upload(GLuint dstBuffer, UINT dstOffset, UINT sizeBytes, const void *pData);
+
+    // Writes [offset, offset + sizeBytes) of a uniform buffer of bufferSize bytes into the ring
+    // and binds the block there. The rest of the block comes from the buffer's earlier writes,
+    // so the first write of a buffer has to cover all of it (see IsUniformBufferKnown()).
+    // Fails without persistent mapping; the caller then uses Upload().
+    CPUTResult SetUniformData(GLuint buffer, UINT bufferSize, UINT offset, UINT sizeBytes, const void *pData);
+    bool       IsUniformBufferKnown(GLuint buffer) const { return mUniformBuffers.find(buffer) != mUniformBuffers.end(); }
+
+    // Use instead of glBindBufferBase(GL_UNIFORM_BUFFER, ...), binds the block in the ring if it's there
+    void       BindUniformBuffer(GLuint bindPoint, GLuint buffer);
+
+    // Call before deleting a uniform buffer, GL reuses the name. Does nothing when there's no
+    // streaming buffer (any more).
+    static void ForgetUniformBuffer(GLuint buffer);
+
+    // Closes the previous frame's region with a fence and retires the regions the GPU is done with
+    void       OnFrameStart();
+
+    GLuint     GetBufferID() const      { return mBufferID; }
+    UINT       GetSize() const          { return mSize; }
+    bool       IsPersistent() const     { return mbPersistent; }
+    UINT       GetRegionsInFlight() const { return (UINT)mRegions.size(); }
+
+protected:
+    struct Region
+    {
+        UINT   begin;
+        UINT   end;
+        GLsync fence; // NULL until the frame it belongs to is closed
+        Region(UINT b, UINT e) : begin(b), end(e), fence(NULL) {}
+    };
+
+    // A uniform buffer given to SetUniformData()
+    struct UniformBuffer
+    {
+        std::vector<char> contents;  // everything written so far
+        UINT              offset;    // of the block in the ring
+        bool              bInRing;   // bound from the ring, otherwise its own storage is up to date
+        bool              bWritten;  // written since the last OnFrameStart()
+    };
+
+    void CloseRegion();
+    void WaitForRange(UINT begin, UINT end);
+    bool RetireOldestRegion(bool bBlock);
+    bool PlaceUniformBuffer(GLuint buffer, UniformBuffer &uniformBuffer);
+    void WriteBackUniformBuffers(bool bAll);
+    void RebindUniformBuffer(GLuint buffer, const UniformBuffer &uniformBuffer);
+
+    static CPUTStreamingBufferOGL *mpStreamingBuffer;
+
+    CPUTStreamingBufferGL *mpGL;
+    GLuint                 mBufferID;
+    UINT                   mSize;
+    bool                   mbPersistent;
+    char                  *mpMapped;      // persistent mapping, NULL when orphaning
+    bool                   mbRangeMapped; // a non persistent range is waiting for EndWrite()
+    UINT                   mHead;         // next free byte
+    UINT                   mRegionBegin;  // start of the region being written this frame
+    std::deque<Region>     mRegions;      // oldest first
+    UINT                   mUniformAlignment;
+    std::map<GLuint, UniformBuffer> mUniformBuffers;
+    std::vector<GLuint>    mUniformBindings; // buffer bound to each uniform bind point
+
+private:
+    CPUTStreamingBufferOGL(const CPUTStreamingBufferOGL &);
+    CPUTStreamingBufferOGL & operator=(const CPUTStreamingBufferOGL &);
+};
+
+#endif // CPUTSTREAMINGBUFFEROGL_H
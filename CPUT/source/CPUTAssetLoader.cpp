@@ -0,0 +1,208 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "CPUTAssetLoader.h"
+#include <chrono>
+
+CPUTAssetLoader *CPUTAssetLoader::mpAssetLoader = NULL;
+
+// Loading is mostly I/O and parsing, a few threads are plenty and leave the
+// rest of the machine to the app
+const UINT MAX_LOADER_THREADS = 4;
+
+//-----------------------------------------------------------------------------
+CPUTAssetLoader *CPUTAssetLoader::GetAssetLoader()
+{
+    if (NULL == mpAssetLoader)
+    {
+        mpAssetLoader = new CPUTAssetLoader();
+    }
+    return mpAssetLoader;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTAssetLoader::DeleteAssetLoader()
+{
+    SAFE_DELETE(mpAssetLoader);
+}
+
+//-----------------------------------------------------------------------------
+CPUTAssetLoader::CPUTAssetLoader()
+    : mbShutdown(false)
+{
+}
+
+//-----------------------------------------------------------------------------
+CPUTAssetLoader::~CPUTAssetLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mbShutdown = true;
+    }
+    mWorkAvailable.notify_all();
+
+    // Threads finish the task they are running, anything not started yet is dropped
+    for (size_t ii = 0; ii < mThreads.size(); ++ii)
+    {
+        mThreads[ii].join();
+    }
+    mThreads.clear();
+    mWorkerQueue.clear();
+
+    for (size_t ii = 0; ii < mRequests.size(); ++ii)
+    {
+        CPUTLoadRequest *pRequest = mRequests[ii];
+        if (!pRequest->IsDone())
+        {
+            pRequest->mResult = CPUT_WARNING_CANCELED;
+            pRequest->mState  = CPUT_LOAD_FAILED;
+        }
+        pRequest->Release();
+    }
+    mRequests.clear();
+}
+
+//-----------------------------------------------------------------------------
+void CPUTAssetLoader::StartThreads()
+{
+    UINT threadCount = std::thread::hardware_concurrency();
+    threadCount = (threadCount > 1) ? threadCount - 1 : 1; // leave a core for the main thread
+    threadCount = (threadCount < MAX_LOADER_THREADS) ? threadCount : MAX_LOADER_THREADS;
+
+    for (UINT ii = 0; ii < threadCount; ++ii)
+    {
+        mThreads.push_back(std::thread(&CPUTAssetLoader::WorkerThread, this));
+    }
+}
+
+//-----------------------------------------------------------------------------
+void CPUTAssetLoader::WorkerThread()
+{
+    for (;;)
+    {
+        CPUTLoadRequest *pRequest = NULL;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (!mbShutdown && mWorkerQueue.empty())
+            {
+                mWorkAvailable.wait(lock);
+            }
+            if (mbShutdown)
+            {
+                return;
+            }
+            pRequest = mWorkerQueue.front();
+            mWorkerQueue.pop_front();
+        }
+
+        // The loader holds a reference until the main thread retires the request,
+        // so it can't go away while this runs
+        pRequest->mState = CPUT_LOAD_WORKING;
+        CPUTResult result = pRequest->mWorkerTask();
+        pRequest->mResult = result;
+        pRequest->mState  = CPUTFAILED(result) ? CPUT_LOAD_FAILED : CPUT_LOAD_FINALIZING;
+    }
+}
+
+//-----------------------------------------------------------------------------
+CPUTLoadRequest *CPUTAssetLoader::Submit(const CPUTLoadTask &workerTask, const CPUTLoadTask &mainThreadTask)
+{
+    CPUTLoadRequest *pRequest = new CPUTLoadRequest(workerTask, mainThreadTask);
+    pRequest->AddRef(); // the loader's reference, released by ProcessMainThreadWork()
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRequests.push_back(pRequest);
+        if (workerTask)
+        {
+            if (mThreads.empty())
+            {
+                StartThreads();
+            }
+            mWorkerQueue.push_back(pRequest);
+        }
+        else
+        {
+            pRequest->mState = CPUT_LOAD_FINALIZING;
+        }
+    }
+    mWorkAvailable.notify_one();
+
+    return pRequest;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTAssetLoader::ProcessMainThreadWork(double budgetMilliseconds)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    for (;;)
+    {
+        CPUTLoadRequest *pRequest = NULL;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mRequests.empty())
+            {
+                CPUT_LOAD_STATE state = mRequests.front()->GetState();
+                if (state == CPUT_LOAD_FINALIZING || state == CPUT_LOAD_FAILED)
+                {
+                    pRequest = mRequests.front();
+                }
+            }
+        }
+        if (NULL == pRequest)
+        {
+            // Nothing queued, or the oldest request is still on a loader thread
+            return;
+        }
+
+        bool retire = true;
+        if (pRequest->GetState() == CPUT_LOAD_FINALIZING)
+        {
+            CPUTResult result = pRequest->mMainThreadTask ? pRequest->mMainThreadTask() : CPUT_SUCCESS;
+            if (result == CPUT_WARNING_NOT_FINISHED)
+            {
+                retire = false;
+            }
+            else
+            {
+                pRequest->mResult = result;
+                pRequest->mState  = CPUTFAILED(result) ? CPUT_LOAD_FAILED : CPUT_LOAD_COMPLETE;
+            }
+        }
+
+        if (retire)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mRequests.pop_front();
+            }
+            pRequest->Release();
+        }
+
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        if (elapsed >= budgetMilliseconds)
+        {
+            return;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool CPUTAssetLoader::IsIdle()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mRequests.empty();
+}
@@ -24,6 +24,12 @@
 #include "CPUTMaterial.h"
 #include "CPUTRenderStateBlock.h"
 #include "CPUTInputLayoutCache.h"
+#include "CPUTInstanceGroup.h"
+#include <map>
+
+// Fewer members than this aren't worth a group, they are drawn like any other model
+const UINT CPUT_MIN_INSTANCE_GROUP_SIZE = 2;
+
 //-----------------------------------------------------------------------------
 CPUTAssetSet::CPUTAssetSet() :
     mppAssetList(NULL),
@@ -39,6 +45,11 @@ CPUTAssetSet::~CPUTAssetSet()
 {
     SAFE_RELEASE(mpFirstCamera);
 
+    for( UINT ii=0; ii<mInstanceGroups.size(); ii++ )
+    {
+        SAFE_DELETE( mInstanceGroups[ii] );
+    }
+
     // Deleteing the asset set implies recursively releasing all the assets in the hierarchy
     if(mpRootNode && !mpRootNode->ReleaseRecursive() )
     {
@@ -62,9 +73,12 @@ void CPUTAssetSet::RenderRecursive(CPUTRenderParameters &renderParams, int mater
     CPUTRenderStateBlock* pCurrentRenderState = NULL;
     CPUTRenderNode* pCurrent = mpRootNode;
     CPUTInputLayoutCache* pInputLayoutCache = CPUTInputLayoutCache::GetInputLayoutCache();
+    bool drawInstanced = (renderParams.mpPerInstanceConstants != NULL);
     while (pCurrent)
     {
-        if (pCurrent->GetNodeType() == CPUTRenderNode::CPUT_NODE_MODEL)
+        if (pCurrent->GetNodeType() == CPUTRenderNode::CPUT_NODE_MODEL &&
+            !(drawInstanced && ((CPUTModel*)pCurrent)->IsDrawnInstanced()) &&
+            renderParams.DrawsNode(pCurrent->IsDynamic()))
         {
             CPUTModel* pModel = (CPUTModel*)pCurrent;
             pModel->UpdateShaderConstants(renderParams);
@@ -75,11 +89,12 @@ void CPUTAssetSet::RenderRecursive(CPUTRenderParameters &renderParams, int mater
                 if (pMaterial != NULL)
                 {
                     CPUTRenderStateBlock* pRenderStateBlock = pMaterial->GetRenderStateBlock();
-                    CPUTMesh* pMesh = pModel->GetMesh(mesh);
+                    CPUTMesh* pMesh = pModel->GetLodMesh(mesh);
                     SetMaterialStates(pMaterial, pCurrentMaterial);
                     SetRenderStateBlock(pRenderStateBlock, pCurrentRenderState);
                     pInputLayoutCache->Apply(pMesh, pMaterial);
                     pMesh->Draw();
+                    renderParams.mDrawCount++;
                     SAFE_RELEASE(pCurrentMaterial);
                     pCurrentMaterial = pMaterial;
                     SAFE_RELEASE(pCurrentRenderState)
@@ -105,6 +120,73 @@ void CPUTAssetSet::RenderRecursive(CPUTRenderParameters &renderParams, int mater
     }
     SAFE_RELEASE(pCurrentMaterial);
     SAFE_RELEASE(pCurrentRenderState);
+
+    if (drawInstanced)
+    {
+        for (UINT ii = 0; ii < mInstanceGroups.size(); ii++)
+        {
+            mInstanceGroups[ii]->Render(renderParams, materialIndex);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void CPUTAssetSet::SelectLods(CPUTCamera *pCamera, float lodScale)
+{
+    for (UINT ii = 1; ii < mAssetCount; ii++) // 0 is the root node
+    {
+        if (mppAssetList[ii] && mppAssetList[ii]->GetNodeType() == CPUTRenderNode::CPUT_NODE_MODEL)
+        {
+            ((CPUTModel*)mppAssetList[ii])->SelectLod(pCamera, lodScale);
+        }
+    }
+}
+
+// Groups the models that share all their meshes and materials. Models of the same .mdl
+// share their meshes (see LoadAssetSet), so a repeated prop ends up in one group.
+//-----------------------------------------------------------------------------
+void CPUTAssetSet::BuildInstanceGroups()
+{
+    std::vector<CPUTInstanceGroup*> groups;
+    for (UINT ii = 1; ii < mAssetCount; ii++) // 0 is the root node
+    {
+        if (!mppAssetList[ii] || mppAssetList[ii]->GetNodeType() != CPUTRenderNode::CPUT_NODE_MODEL)
+        {
+            continue;
+        }
+        CPUTModel *pModel = (CPUTModel*)mppAssetList[ii];
+        if (!pModel->IsInstanceable())
+        {
+            continue;
+        }
+        UINT group = 0;
+        while (group < groups.size() && !groups[group]->Accepts(pModel))
+        {
+            group++;
+        }
+        if (group < groups.size())
+        {
+            groups[group]->AddModel(pModel);
+        }
+        else
+        {
+            groups.push_back(new CPUTInstanceGroup(pModel));
+        }
+    }
+
+    for (UINT ii = 0; ii < groups.size(); ii++)
+    {
+        if (groups[ii]->GetModelCount() < CPUT_MIN_INSTANCE_GROUP_SIZE)
+        {
+            SAFE_DELETE(groups[ii]);
+            continue;
+        }
+        for (UINT jj = 0; jj < groups[ii]->GetModelCount(); jj++)
+        {
+            groups[ii]->GetModel(jj)->SetDrawnInstanced(true);
+        }
+        mInstanceGroups.push_back(groups[ii]);
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -158,6 +240,7 @@ CPUTResult CPUTAssetSet::LoadAssetSet(std::string name, int numSystemMaterials,
     CPUTAssetLibrary *pAssetLibrary = (CPUTAssetLibrary*)CPUTAssetLibrary::GetAssetLibrary();
 
 	CPUTAnimation *pDefaultAnimation = NULL;
+    std::map<std::string, UINT> firstModelByName; // block index of each .mdl's first model
     for(UINT ii=0; ii<mAssetCount-1; ii++) // Note: -1 because we added one for the root node (we don't load it)
     {
         CPUTConfigBlock *pBlock = ConfigFile.GetBlock(ii);
@@ -200,8 +283,18 @@ CPUTResult CPUTAssetSet::LoadAssetSet(std::string name, int numSystemMaterials,
             CPUTModel *pModel = CPUTModel::Create();
             if( pValue == &CPUTConfigEntry::sNullConfigValue )
             {
-                // Not found.  So, not an instance.
-                pModel->LoadModel(pBlock, &parentIndex, NULL, numSystemMaterials, pSystemMaterialNames);
+                // Not found.  So, not an instance, unless the same .mdl was already loaded in
+                // this set.  Then share its meshes, which also lets them be drawn instanced.
+                std::map<std::string, UINT>::iterator first = firstModelByName.find(name);
+                if( first == firstModelByName.end() )
+                {
+                    pModel->LoadModel(pBlock, &parentIndex, NULL, numSystemMaterials, pSystemMaterialNames);
+                    firstModelByName[name] = ii;
+                }
+                else
+                {
+                    pModel->LoadModel(pBlock, &parentIndex, (CPUTModel*)mppAssetList[first->second+1], numSystemMaterials, pSystemMaterialNames);
+                }
             }
             else
             {
@@ -296,6 +389,8 @@ CPUTResult CPUTAssetSet::LoadAssetSet(std::string name, int numSystemMaterials,
 		mppAssetList[1]->SetAnimation(pDefaultAnimation);
 	}
 	SAFE_RELEASE(pDefaultAnimation);
+
+    BuildInstanceGroups();
     return result;
 }
 
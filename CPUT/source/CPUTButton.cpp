@@ -468,6 +468,23 @@ void CPUTButton::Draw(CPUTGUIVertex *pVertexBufferMirror, UINT *pInsertIndex, UI
         mpButtonText->Draw(pVertexBufferMirror, pInsertIndex, pMaxBufferSize);
 }
 
+// Dirty when the button or its text is
+//--------------------------------------------------------------------------------
+bool CPUTButton::IsGeometryDirty()
+{
+    return mbGeometryDirty || (mpButtonText && mpButtonText->IsGeometryDirty());
+}
+
+//--------------------------------------------------------------------------------
+void CPUTButton::ClearGeometryDirty()
+{
+    mbGeometryDirty = false;
+    if(mpButtonText)
+    {
+        mpButtonText->ClearGeometryDirty();
+    }
+}
+
 
 // Allocates/registers resources used by all buttons
 //--------------------------------------------------------------------------------
@@ -596,6 +613,8 @@ CPUTResult CPUTButton::UnRegisterInstanceResources()
 //--------------------------------------------------------------------------------
 CPUTResult CPUTButton::Resize(int width, int height)
 {
+    mbGeometryDirty = true;
+
     // verify that the new dimensions fit the minimal 'safe' dimensions needed to draw the button
     // or ugly clipping will occur
     int safeWidth=0;
@@ -488,10 +488,29 @@ void CPUTCheckbox::Draw(CPUTGUIVertex *pVertexBufferMirror, UINT *pInsertIndex,
     }
 }
 
+// Dirty when the checkbox or its text is
+//--------------------------------------------------------------------------------
+bool CPUTCheckbox::IsGeometryDirty()
+{
+    return mbGeometryDirty || (mpCheckboxText && mpCheckboxText->IsGeometryDirty());
+}
+
+//--------------------------------------------------------------------------------
+void CPUTCheckbox::ClearGeometryDirty()
+{
+    mbGeometryDirty = false;
+    if(mpCheckboxText)
+    {
+        mpCheckboxText->ClearGeometryDirty();
+    }
+}
+
 // Recalculates the the control's image quads
 //------------------------------------------------------------------------
 void CPUTCheckbox::Recalculate()
 {
+    mbGeometryDirty = true;
+
     // active/idle
     float height = (float) mpCheckboxTextureSizeList[0].height * mScale;
     float width = (float) mpCheckboxTextureSizeList[0].width * mScale;
@@ -16,11 +16,10 @@
 
 #include "CPUTConfigBlock.h"
 #include "CPUTOSServices.h"
-//#include <regex>
+#include "CPUTSceneCache.h"
 #include <string>
-//#include <string.h>
 
-const CPUTConfigEntry  &CPUTConfigEntry::sNullConfigValue = CPUTConfigEntry("", "");
+const CPUTConfigEntry CPUTConfigEntry::sNullConfigValue;
 
 //----------------------------------------------------------------
 static bool iswhite(char ch)
@@ -43,9 +42,9 @@ static void RemoveWhitespace(T &start, T &end)
 }
 
 //----------------------------------------------------------------
-static bool ReadLine(const char **ppStart, const char **ppEnd, const char **ppCur)
+static bool ReadLine(char **ppStart, char **ppEnd, char **ppCur)
 {
-    const char *pCur = *ppCur;
+    char *pCur = *ppCur;
     if (!*pCur) // check for EOF
     {
         return false;
@@ -60,7 +59,7 @@ static bool ReadLine(const char **ppStart, const char **ppEnd, const char **ppCu
     *ppStart = pCur;
 
     // Forward to the end of the line and keep track of last non-whitespace char
-    const char *pEnd = pCur;
+    char *pEnd = pCur;
     for (;;)
     {
         char ch = *pCur++;
@@ -85,9 +84,9 @@ static bool ReadLine(const char **ppStart, const char **ppEnd, const char **ppCu
 }
 
 //----------------------------------------------------------------
-static const char *FindFirst(const char *start, const char *end, char ch)
+static char *FindFirst(char *start, char *end, char ch)
 {
-    const char *p = start;
+    char *p = start;
     while (p < end && *p != ch)
     {
         ++p;
@@ -95,9 +94,9 @@ static const char *FindFirst(const char *start, const char *end, char ch)
     return p;
 }
 
-static const char *FindLast(const char *start, const char *end, char ch)
+static char *FindLast(char *start, char *end, char ch)
 {
-    const char *p = end;
+    char *p = end;
     while (--p >= start && *p != ch)
     {
     }
@@ -106,36 +105,255 @@ static const char *FindLast(const char *start, const char *end, char ch)
 }
 
 //----------------------------------------------------------------
-void CPUTConfigEntry::ValueAsFloatArray(float *pFloats, int count)
+// 32-bit FNV-1a
+static UINT HashName(const char *pName, UINT length)
+{
+    UINT hash = 2166136261u;
+    for (UINT ii = 0; ii < length; ++ii)
+    {
+        hash ^= (unsigned char)pName[ii];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Smallest power of two table that keeps the load factor at or below 1/2
+static UINT SlotCountFor(UINT count)
+{
+    UINT slots = 4;
+    while (slots < count * 2)
+    {
+        slots <<= 1;
+    }
+    return slots;
+}
+
+//----------------------------------------------------------------
+// Number parsing. Values are NUL-terminated in place so the slow paths can
+// hand the text straight to the CRT without making a copy.
+static const double gPow10[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const char *SkipSpaces(const char *p)
+{
+    while (*p == ' ' || *p == '\t')
+    {
+        ++p;
+    }
+    return p;
+}
+
+// Parses one float starting at p. Decimal input with at most 15 significant digits and a
+// small exponent is converted exactly with a single multiply or divide; anything else
+// (long mantissas, huge exponents, inf/nan) falls back to strtod.
+static bool ParseFloat(const char *p, const char **ppEnd, float *pValue)
+{
+    const char *pStart = p;
+    bool negative = false;
+    if (*p == '-' || *p == '+')
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool anyDigits = false;
+
+    while (*p >= '0' && *p <= '9')
+    {
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa) { ++digits; }
+        }
+        else
+        {
+            ++exponent;
+        }
+        anyDigits = true;
+        ++p;
+    }
+    if (*p == '.')
+    {
+        ++p;
+        while (*p >= '0' && *p <= '9')
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa) { ++digits; }
+                --exponent;
+            }
+            anyDigits = true;
+            ++p;
+        }
+    }
+    if (anyDigits && (*p == 'e' || *p == 'E'))
+    {
+        const char *pExp = p + 1;
+        bool negativeExp = false;
+        if (*pExp == '-' || *pExp == '+')
+        {
+            negativeExp = (*pExp == '-');
+            ++pExp;
+        }
+        if (*pExp >= '0' && *pExp <= '9')
+        {
+            int e = 0;
+            while (*pExp >= '0' && *pExp <= '9')
+            {
+                if (e < 10000) { e = e * 10 + (*pExp - '0'); }
+                ++pExp;
+            }
+            exponent += negativeExp ? -e : e;
+            p = pExp;
+        }
+    }
+
+    if (anyDigits && digits <= 15 && exponent >= -22 && exponent <= 22)
+    {
+        double value = (double)mantissa;
+        value = exponent < 0 ? value / gPow10[-exponent] : value * gPow10[exponent];
+        *pValue = (float)(negative ? -value : value);
+        *ppEnd = p;
+        return true;
+    }
+
+    char *pCrtEnd = NULL;
+    double value = strtod(pStart, &pCrtEnd);
+    if (pCrtEnd == pStart)
+    {
+        *ppEnd = pStart;
+        return false;
+    }
+    *pValue = (float)value;
+    *ppEnd = pCrtEnd;
+    return true;
+}
+
+static bool ParseUint(const char *p, int base, UINT *pValue, bool *pNegative)
 {
-    char *szOrigValue = new char [szValue.length()+1];
-	const char *pString = szValue.c_str();
-    strcpy(szOrigValue, pString);
+    p = SkipSpaces(p);
+    *pNegative = false;
+    if (*p == '-' || *p == '+')
+    {
+        *pNegative = (*p == '-');
+        ++p;
+    }
+    if (base == 16 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+    {
+        p += 2;
+    }
 
-	char *szNewValue = NULL;
-    char *szCurrValue = strtok_r(szOrigValue, " ", &szNewValue);
+    UINT value = 0;
+    bool anyDigits = false;
+    for (;; ++p)
+    {
+        UINT digit;
+        if (*p >= '0' && *p <= '9')                     { digit = *p - '0'; }
+        else if (base == 16 && *p >= 'a' && *p <= 'f')  { digit = *p - 'a' + 10; }
+        else if (base == 16 && *p >= 'A' && *p <= 'F')  { digit = *p - 'A' + 10; }
+        else                                            { break; }
+        value = value * base + digit;
+        anyDigits = true;
+    }
+    *pValue = value;
+    return anyDigits;
+}
+
+//----------------------------------------------------------------
+float CPUTConfigEntry::ValueAsFloat(void)
+{
+    float fValue = 0;
+    const char *pEnd;
+    bool parsed = ParseFloat(SkipSpaces(mpValue), &pEnd, &fValue); // float (regular float, or E exponentially notated float)
+    ASSERT(parsed, "ValueAsFloat - value specified is not a float");
+    UNREFERENCED_PARAMETER(parsed);
+    return fValue;
+}
+
+//----------------------------------------------------------------
+int CPUTConfigEntry::ValueAsInt(void)
+{
+    UINT nValue = 0;
+    bool negative;
+    bool parsed = ParseUint(mpValue, 10, &nValue, &negative); // signed int (NON-hex)
+    ASSERT(parsed, "ValueAsInt - value specified is not a signed int");
+    UNREFERENCED_PARAMETER(parsed);
+    return negative ? -(int)nValue : (int)nValue;
+}
+
+//----------------------------------------------------------------
+UINT CPUTConfigEntry::ValueAsUint(void)
+{
+    UINT nValue = 0;
+    bool negative;
+    bool parsed = ParseUint(mpValue, 10, &nValue, &negative); // unsigned int
+    ASSERT(parsed, "ValueAsUint - value specified is not a UINT");
+    UNREFERENCED_PARAMETER(parsed);
+    return negative ? 0u - nValue : nValue;
+}
+
+//----------------------------------------------------------------
+UINT CPUTConfigEntry::ValueAsHex32(void)
+{
+    UINT nValue = 0;
+    bool negative;
+    bool parsed = ParseUint(mpValue, 16, &nValue, &negative); // unsigned int
+    ASSERT(parsed, "ValueAsUint - value specified is not a hex");
+    UNREFERENCED_PARAMETER(parsed);
+    return negative ? 0u - nValue : nValue;
+}
+
+//----------------------------------------------------------------
+void CPUTConfigEntry::ValueAsFloatArray(float *pFloats, int count)
+{
     for(int clear = 0; clear < count; clear++)
     {
         pFloats[clear] = 0.0f;
     }
+
+    // Values are separated by spaces; a token that isn't a number reads as 0 (like atof)
+    const char *pCur = mpValue;
     for(int ii=0;ii<count;++ii)
     {
-        if(szCurrValue == NULL)
+        while (*pCur == ' ')
+        {
+            ++pCur;
+        }
+        if (!*pCur)
         {
-			delete[] szOrigValue;
             return;
         }
-        pFloats[ii] = (float) atof(szCurrValue);
-        szCurrValue = strtok_r(NULL, " ", &szNewValue);
 
+        const char *pEnd;
+        if (!ParseFloat(pCur, &pEnd, &pFloats[ii]))
+        {
+            pFloats[ii] = 0.0f;
+        }
+        while (*pEnd && *pEnd != ' ')
+        {
+            ++pEnd;
+        }
+        pCur = pEnd;
     }
-    
-	delete[] szOrigValue;
 }
 
 //----------------------------------------------------------------
 CPUTConfigBlock::CPUTConfigBlock()
-    : mnValueCount(0)
+    : mpName("")
+    , mNameLength(0)
+    , mpValues(NULL)
+    , mpSlots(NULL)
+    , mSlotMask(0)
+    , mnFirstValue(0)
+    , mnValueCount(0)
+    , mnSlotOffset(0)
 {
 }
 //----------------------------------------------------------------
@@ -143,14 +361,9 @@ CPUTConfigBlock::~CPUTConfigBlock()
 {
 }
 //----------------------------------------------------------------
-const std::string &CPUTConfigBlock::GetName(void)
-{
-    return mszName;
-}
-//----------------------------------------------------------------
-int CPUTConfigBlock::GetNameValue(void)
+std::string CPUTConfigBlock::GetName(void)
 {
-    return mName.ValueAsInt();
+    return std::string(mpName, mNameLength);
 }
 //----------------------------------------------------------------
 CPUTConfigEntry *CPUTConfigBlock::GetValue(int nValueIndex)
@@ -162,34 +375,20 @@ CPUTConfigEntry *CPUTConfigBlock::GetValue(int nValueIndex)
     return &mpValues[nValueIndex];
 }
 //----------------------------------------------------------------
-CPUTConfigEntry *CPUTConfigBlock::AddValue(const std::string &szName, const std::string &szValue )
+CPUTConfigEntry *CPUTConfigBlock::FindValue(const char *pName, UINT nameLength)
 {
-    // TODO: What should we do if it already exists?
-    CPUTConfigEntry *pEntry = &mpValues[mnValueCount++];
-    pEntry->szName  = szName;
-    pEntry->szValue = szValue;
-    return pEntry;
-}
-//----------------------------------------------------------------
-CPUTConfigEntry *CPUTConfigBlock::GetValueByName(const std::string &szName)
-{
-    for(int ii=0; ii<mnValueCount; ++ii)
+    if (mnValueCount > 0)
     {
-        const std::string &valName = mpValues[ii].szName;
-        if(valName.size() != szName.size())
-        {
-            continue;
-        }
-
-        size_t j = 0;
-        while (j < valName.size() && szName[j] == valName[j])
-        {
-            ++j;
-        }
-
-        if (j == valName.size()) // match
+        UINT hash = HashName(pName, nameLength);
+        for (UINT slot = hash & mSlotMask; mpSlots[slot] != 0; slot = (slot + 1) & mSlotMask)
         {
-            return &mpValues[ii];
+            CPUTConfigEntry *pEntry = &mpValues[mpSlots[slot] - 1];
+            if (pEntry->mNameHash == hash &&
+                pEntry->mNameLength == nameLength &&
+                memcmp(pEntry->mpName, pName, nameLength) == 0)
+            {
+                return pEntry;
+            }
         }
     }
 
@@ -197,192 +396,537 @@ CPUTConfigEntry *CPUTConfigBlock::GetValueByName(const std::string &szName)
     return const_cast<CPUTConfigEntry*>(&CPUTConfigEntry::sNullConfigValue);
 }
 //----------------------------------------------------------------
+CPUTConfigEntry *CPUTConfigBlock::GetValueByName(const std::string &szName)
+{
+    return FindValue(szName.c_str(), (UINT)szName.size());
+}
+//----------------------------------------------------------------
+CPUTConfigEntry *CPUTConfigBlock::GetValueByName(const char *szName)
+{
+    return FindValue(szName, (UINT)strlen(szName));
+}
+//----------------------------------------------------------------
 int CPUTConfigBlock::ValueCount(void)
 {
     return mnValueCount;
 }
 //----------------------------------------------------------------
 CPUTConfigFile::CPUTConfigFile()
-    : mnBlockCount(0)
-    , mpBlocks(NULL)
+    : mpFileContents(NULL)
+    , mnContentsSize(0)
+    , mBlockSlotOffset(0)
+    , mBlockSlotMask(0)
 {
 }
 //----------------------------------------------------------------
 CPUTConfigFile::~CPUTConfigFile()
 {
-    if(mpBlocks)
+    Release();
+}
+//----------------------------------------------------------------
+void CPUTConfigFile::Release()
+{
+    if(mpFileContents)
     {
-        delete [] mpBlocks;
-        mpBlocks = 0;
+        delete [] mpFileContents;
+        mpFileContents = NULL;
     }
-    mnBlockCount = 0;
+    mnContentsSize = 0;
+    mBlocks.clear();
+    mEntries.clear();
+    mSlots.clear();
+    mBlockSlotOffset = 0;
+    mBlockSlotMask = 0;
 }
 //----------------------------------------------------------------
 CPUTResult CPUTConfigFile::LoadFile(const std::string &szFilename)
 {
-    int nBytes = 0;
+    CPUTSceneCache *pCache = CPUTSceneCache::GetActiveCache();
+    if (pCache)
+    {
+        const char *pImage;
+        UINT imageSize;
+        if (pCache->Find(CPUT_CACHE_CONFIG, szFilename, &pImage, &imageSize) && CPUTSUCCESS(LoadBinary(pImage, imageSize)))
+        {
+            return CPUT_SUCCESS;
+        }
+    }
+
+    UINT nBytes = 0;
     char *pFileContents = NULL;
-    CPUTResult result = CPUTFileSystem::ReadFileContents(szFilename, (UINT *)&nBytes, (void **)&pFileContents, true);
+    CPUTResult result = CPUTFileSystem::ReadFileContents(szFilename, &nBytes, (void **)&pFileContents, true);
     if(CPUTFAILED(result))
     {
         DEBUG_PRINT("Failed to read file %s\n", szFilename.c_str());
         return result;
     }
-    /*
-    Not sure on compiler support across the board for regular expressions. This would simplify the parsing code
-
-    std::string fileContents(pFileContents);
-    std::smatch m;
-    std::string blockTitle;
-    auto dataStart = fileContents.cbegin();
-    auto dataEnd = fileContents.cend();
-    while( std::regex_search(dataStart, dataEnd, m, std::regex("\\[(.*)\\]([^\\[]*)")) ) {
-        DEBUG_PRINT("match group 1: %s", m[1].str().c_str()); // m[1].str() is the block name
-        DEBUG_PRINT("match group 2: %s", m[2].str().c_str()); // m[2].str() is the block contents
-        dataStart = m.suffix().first;
-//        mnBlockCount++;
-//        blockTitle.assign(m[1]);
-    }
-    */
-    CPUTConfigBlock    *pCurrBlock = NULL;
-    int                 nCurrBlock = 0;
-    
-    /* Count the number of blocks */
-    const char *pCur = pFileContents;
-    const char *pStart, *pEnd;
+    result = LoadFromMemory(pFileContents, nBytes);
+
+    if (pCache && CPUTSUCCESS(result))
+    {
+        std::vector<char> image;
+        SaveBinary(&image);
+        pCache->Add(CPUT_CACHE_CONFIG, szFilename, &image[0], (UINT)image.size());
+    }
+    return result;
+}
+//----------------------------------------------------------------
+// Hashes the entries of the block that was just finished. Duplicate names are
+// dropped (the first one wins) and the survivors are compacted in place, which
+// is cheap because the block's entries are always at the end of mEntries.
+//----------------------------------------------------------------
+void CPUTConfigFile::CloseBlock(CPUTConfigBlock *pBlock)
+{
+    UINT first = (UINT)pBlock->mnFirstValue;
+    UINT count = (UINT)mEntries.size() - first;
+    UINT slotCount = SlotCountFor(count);
+
+    pBlock->mnSlotOffset = (UINT)mSlots.size();
+    pBlock->mSlotMask = slotCount - 1;
+    mSlots.resize(mSlots.size() + slotCount, 0);
+    UINT *pSlots = &mSlots[pBlock->mnSlotOffset];
 
+    UINT write = first;
+    for (UINT ii = first; ii < first + count; ++ii)
+    {
+        CPUTConfigEntry &entry = mEntries[ii];
+        UINT slot = entry.mNameHash & pBlock->mSlotMask;
+        bool dup = false;
+        for (; pSlots[slot] != 0; slot = (slot + 1) & pBlock->mSlotMask)
+        {
+            const CPUTConfigEntry &other = mEntries[first + pSlots[slot] - 1];
+            if (other.mNameHash == entry.mNameHash &&
+                other.mNameLength == entry.mNameLength &&
+                memcmp(other.mpName, entry.mpName, entry.mNameLength) == 0)
+            {
+                dup = true;
+                break;
+            }
+        }
+        if (dup)
+        {
+            continue;
+        }
+        if (write != ii)
+        {
+            mEntries[write] = entry;
+        }
+        pSlots[slot] = write - first + 1;
+        ++write;
+    }
+    mEntries.resize(write);
+    pBlock->mnValueCount = (int)(write - first);
+}
+//----------------------------------------------------------------
+// Takes ownership of pContents, which must be allocated with new[] and
+// NUL-terminated (ReadFileContents with bAddTerminator does both).
+//----------------------------------------------------------------
+CPUTResult CPUTConfigFile::LoadFromMemory(char *pContents, UINT sizeInBytes)
+{
+    Release();
+    mpFileContents = pContents;
+    mnContentsSize = sizeInBytes;
+
+    // Lines ahead of the first block header (or the whole file, if it has no
+    // headers at all) go into an unnamed block 0. The first header names that
+    // block rather than opening a new one.
+    mBlocks.push_back(CPUTConfigBlock());
+    bool haveHeader = false;
+
+    char *pCur = mpFileContents;
+    char *pStart, *pEnd;
     while(ReadLine(&pStart, &pEnd, &pCur))
     {
-        const char *pOpen = FindFirst(pStart, pEnd, '[');
-        const char *pClose = FindLast(pOpen + 1, pEnd, ']');
+        // if the first character in the line is a '#' then skip that line (also skips empty lines)
+        if (pStart == pEnd || *pStart == '#')
+        {
+            continue;
+        }
+
+        char *pOpen = FindFirst(pStart, pEnd, '[');
+        char *pClose = FindLast(pOpen + 1, pEnd, ']');
         if (pOpen < pClose)
         {
             // This line is a valid block header
-            mnBlockCount++;
+            if (haveHeader)
+            {
+                CloseBlock(&mBlocks.back());
+                mBlocks.push_back(CPUTConfigBlock());
+                mBlocks.back().mnFirstValue = (int)mEntries.size();
+            }
+            haveHeader = true;
+
+            CPUTConfigBlock &block = mBlocks.back();
+            *pClose = '\0';
+            block.mpName = pOpen + 1;
+            block.mNameLength = (UINT)(pClose - (pOpen + 1));
+            continue;
+        }
+
+        // It's a value
+        mEntries.push_back(CPUTConfigEntry());
+        CPUTConfigEntry &entry = mEntries.back();
+
+        char *pEquals = FindFirst(pStart, pEnd, '=');
+        if (pEquals == pEnd)
+        {
+            // No value, just a key, save it anyway
+            *pEnd = '\0';
+            entry.mpName = pStart;
+            entry.mNameLength = (UINT)(pEnd - pStart);
+        }
+        else
+        {
+            char *pNameStart = pStart;
+            char *pNameEnd = pEquals;
+            char *pValStart = pEquals + 1;
+            char *pValEnd = pEnd;
+
+            RemoveWhitespace(pNameStart, pNameEnd);
+            RemoveWhitespace(pValStart, pValEnd);
+
+            *pNameEnd = '\0';
+            *pValEnd = '\0';
+            entry.mpName = pNameStart;
+            entry.mNameLength = (UINT)(pNameEnd - pNameStart);
+            entry.mpValue = pValStart;
+            entry.mValueLength = (UINT)(pValEnd - pValStart);
+        }
+        entry.mNameHash = HashName(entry.mpName, entry.mNameLength);
+    }
+    CloseBlock(&mBlocks.back());
+
+    // Block name table, first block wins on duplicates like the linear search used to
+    UINT blockCount = (UINT)mBlocks.size();
+    UINT slotCount = SlotCountFor(blockCount);
+    mBlockSlotOffset = (UINT)mSlots.size();
+    mBlockSlotMask = slotCount - 1;
+    mSlots.resize(mSlots.size() + slotCount, 0);
+    for (UINT ii = 0; ii < blockCount; ++ii)
+    {
+        const CPUTConfigBlock &block = mBlocks[ii];
+        UINT *pSlots = &mSlots[mBlockSlotOffset];
+        UINT slot = HashName(block.mpName, block.mNameLength) & mBlockSlotMask;
+        bool dup = false;
+        for (; pSlots[slot] != 0; slot = (slot + 1) & mBlockSlotMask)
+        {
+            const CPUTConfigBlock &other = mBlocks[pSlots[slot] - 1];
+            if (other.mNameLength == block.mNameLength &&
+                memcmp(other.mpName, block.mpName, block.mNameLength) == 0)
+            {
+                dup = true;
+                break;
+            }
+        }
+        if (!dup)
+        {
+            pSlots[slot] = ii + 1;
         }
     }
 
-    // For files that don't have any blocks, just add the entire file to one block
-    if(mnBlockCount == 0)
+    FixupBlockPointers();
+    return CPUT_SUCCESS;
+}
+
+//----------------------------------------------------------------
+// The arrays are final once loading is done, so the blocks can point straight into them
+//----------------------------------------------------------------
+void CPUTConfigFile::FixupBlockPointers()
+{
+    for (UINT ii = 0; ii < (UINT)mBlocks.size(); ++ii)
     {
-        mnBlockCount   = 1;
+        CPUTConfigBlock &block = mBlocks[ii];
+        block.mpValues = mEntries.empty() ? NULL : &mEntries[0] + block.mnFirstValue;
+        block.mpSlots = &mSlots[block.mnSlotOffset];
     }
+}
 
-    pCur = pFileContents;
-    mpBlocks = new CPUTConfigBlock[mnBlockCount];
-    pCurrBlock = mpBlocks;
+//----------------------------------------------------------------
+// Binary image layout. Strings are stored as offsets into the contents, which
+// are copied verbatim (in-place terminators included) after the tables.
+//----------------------------------------------------------------
+static const UINT CONFIG_IMAGE_NO_STRING = 0xFFFFFFFF;
 
-    /* Find the first block first */
-    while(ReadLine(&pStart, &pEnd, &pCur))
+struct CPUTConfigImageHeader
+{
+    UINT mBlockCount;
+    UINT mEntryCount;
+    UINT mSlotCount;
+    UINT mBlockSlotOffset;
+    UINT mBlockSlotMask;
+    UINT mContentsSize;     // includes a terminating NUL
+};
+
+struct CPUTConfigImageEntry
+{
+    UINT mNameOffset;
+    UINT mNameLength;
+    UINT mValueOffset;
+    UINT mValueLength;
+    UINT mNameHash;
+};
+
+struct CPUTConfigImageBlock
+{
+    UINT mNameOffset;
+    UINT mNameLength;
+    UINT mFirstValue;
+    UINT mValueCount;
+    UINT mSlotOffset;
+    UINT mSlotMask;
+};
+
+// Strings are NUL-terminated in place, so the terminator has to be inside the contents too
+//----------------------------------------------------------------
+static bool IsImageStringValid(const char *pContents, UINT contentsSize, UINT offset, UINT length)
+{
+    if (offset == CONFIG_IMAGE_NO_STRING)
+    {
+        return length == 0;
+    }
+    return (uint64_t)offset + length < contentsSize && pContents[offset + length] == '\0';
+}
+
+// A lookup probes a table until it finds an empty slot, and indexes the table's items with
+// what it finds on the way. Probing only visits every slot if the table size is a power of two.
+//----------------------------------------------------------------
+static bool AreImageSlotsValid(const UINT *pSlots, UINT slotMask, UINT itemCount)
+{
+    if (slotMask & (slotMask + 1))
+    {
+        return false;
+    }
+    bool haveEmptySlot = false;
+    for (UINT ii = 0; ii <= slotMask; ++ii)
     {
-        // if the first character in the line is a '#' then skip that line.
-        const char *pRemark = FindFirst(pStart, pEnd, '#');
-        if (pRemark == pStart)
+        if (pSlots[ii] > itemCount)
         {
-            continue;
+            return false;
         }
+        haveEmptySlot = haveEmptySlot || pSlots[ii] == 0;
+    }
+    return haveEmptySlot;
+}
 
-        const char *pOpen = FindFirst(pStart, pEnd, '[');
-        const char *pClose = FindLast(pOpen + 1, pEnd, ']');
-        if (pOpen < pClose)
+//----------------------------------------------------------------
+void CPUTConfigFile::SaveBinary(std::vector<char> *pImage)
+{
+    CPUTConfigImageHeader header;
+    header.mBlockCount      = (UINT)mBlocks.size();
+    header.mEntryCount      = (UINT)mEntries.size();
+    header.mSlotCount       = (UINT)mSlots.size();
+    header.mBlockSlotOffset = mBlockSlotOffset;
+    header.mBlockSlotMask   = mBlockSlotMask;
+    header.mContentsSize    = mnContentsSize + 1;
+
+    size_t size = sizeof(header) +
+        header.mBlockCount * sizeof(CPUTConfigImageBlock) +
+        header.mEntryCount * sizeof(CPUTConfigImageEntry) +
+        header.mSlotCount  * sizeof(UINT) +
+        header.mContentsSize;
+    pImage->assign(size, 0);
+    char *pCur = &(*pImage)[0];
+
+    memcpy(pCur, &header, sizeof(header));
+    pCur += sizeof(header);
+
+    const char *pContentsEnd = mpFileContents + mnContentsSize;
+    for (UINT ii = 0; ii < header.mBlockCount; ++ii)
+    {
+        const CPUTConfigBlock &block = mBlocks[ii];
+        CPUTConfigImageBlock imageBlock;
+        bool inContents = block.mpName >= mpFileContents && block.mpName < pContentsEnd;
+        imageBlock.mNameOffset = inContents ? (UINT)(block.mpName - mpFileContents) : CONFIG_IMAGE_NO_STRING;
+        imageBlock.mNameLength = block.mNameLength;
+        imageBlock.mFirstValue = (UINT)block.mnFirstValue;
+        imageBlock.mValueCount = (UINT)block.mnValueCount;
+        imageBlock.mSlotOffset = block.mnSlotOffset;
+        imageBlock.mSlotMask   = block.mSlotMask;
+        memcpy(pCur, &imageBlock, sizeof(imageBlock));
+        pCur += sizeof(imageBlock);
+    }
+
+    for (UINT ii = 0; ii < header.mEntryCount; ++ii)
+    {
+        const CPUTConfigEntry &entry = mEntries[ii];
+        CPUTConfigImageEntry imageEntry;
+        bool nameInContents  = entry.mpName  >= mpFileContents && entry.mpName  < pContentsEnd;
+        bool valueInContents = entry.mpValue >= mpFileContents && entry.mpValue < pContentsEnd;
+        imageEntry.mNameOffset  = nameInContents  ? (UINT)(entry.mpName  - mpFileContents) : CONFIG_IMAGE_NO_STRING;
+        imageEntry.mNameLength  = entry.mNameLength;
+        imageEntry.mValueOffset = valueInContents ? (UINT)(entry.mpValue - mpFileContents) : CONFIG_IMAGE_NO_STRING;
+        imageEntry.mValueLength = entry.mValueLength;
+        imageEntry.mNameHash    = entry.mNameHash;
+        memcpy(pCur, &imageEntry, sizeof(imageEntry));
+        pCur += sizeof(imageEntry);
+    }
+
+    if (header.mSlotCount)
+    {
+        memcpy(pCur, &mSlots[0], header.mSlotCount * sizeof(UINT));
+        pCur += header.mSlotCount * sizeof(UINT);
+    }
+
+    memcpy(pCur, mpFileContents, mnContentsSize); // the extra byte was zeroed by assign()
+}
+
+//----------------------------------------------------------------
+CPUTResult CPUTConfigFile::LoadBinary(const char *pImage, UINT sizeInBytes)
+{
+    Release();
+
+    CPUTConfigImageHeader header;
+    if (sizeInBytes < sizeof(header))
+    {
+        return CPUT_ERROR_INVALID_PARAMETER;
+    }
+    memcpy(&header, pImage, sizeof(header));
+
+    uint64_t expectedSize = sizeof(header) +
+        (uint64_t)header.mBlockCount * sizeof(CPUTConfigImageBlock) +
+        (uint64_t)header.mEntryCount * sizeof(CPUTConfigImageEntry) +
+        (uint64_t)header.mSlotCount  * sizeof(UINT) +
+        header.mContentsSize;
+    if (expectedSize != sizeInBytes || header.mBlockCount == 0 || header.mContentsSize == 0 ||
+        (uint64_t)header.mBlockSlotOffset + header.mBlockSlotMask >= header.mSlotCount)
+    {
+        return CPUT_ERROR_INVALID_PARAMETER;
+    }
+
+    const char *pBlocks   = pImage + sizeof(header);
+    const char *pEntries  = pBlocks  + header.mBlockCount * sizeof(CPUTConfigImageBlock);
+    const char *pSlots    = pEntries + header.mEntryCount * sizeof(CPUTConfigImageEntry);
+    const char *pContents = pSlots   + header.mSlotCount  * sizeof(UINT);
+
+    mnContentsSize = header.mContentsSize - 1;
+    mpFileContents = new char[header.mContentsSize];
+    memcpy(mpFileContents, pContents, header.mContentsSize);
+
+    mBlocks.resize(header.mBlockCount);
+    for (UINT ii = 0; ii < header.mBlockCount; ++ii)
+    {
+        CPUTConfigImageBlock imageBlock;
+        memcpy(&imageBlock, pBlocks + ii * sizeof(imageBlock), sizeof(imageBlock));
+        if ((uint64_t)imageBlock.mFirstValue + imageBlock.mValueCount > header.mEntryCount ||
+            (uint64_t)imageBlock.mSlotOffset + imageBlock.mSlotMask >= header.mSlotCount ||
+            !IsImageStringValid(mpFileContents, header.mContentsSize, imageBlock.mNameOffset, imageBlock.mNameLength))
         {
-            // This line is a valid block header
-            pCurrBlock = mpBlocks + nCurrBlock++;
-			pCurrBlock->mszName.assign(pOpen + 1, pClose);
+            Release();
+            return CPUT_ERROR_INVALID_PARAMETER;
         }
-        else if (pStart < pEnd)
+        CPUTConfigBlock &block = mBlocks[ii];
+        if (imageBlock.mNameOffset != CONFIG_IMAGE_NO_STRING)
         {
-            // It's a value
-            if (pCurrBlock == NULL)
-            {
-                continue;
-            }
+            block.mpName = mpFileContents + imageBlock.mNameOffset;
+        }
+        block.mNameLength   = imageBlock.mNameLength;
+        block.mnFirstValue  = (int)imageBlock.mFirstValue;
+        block.mnValueCount  = (int)imageBlock.mValueCount;
+        block.mnSlotOffset  = imageBlock.mSlotOffset;
+        block.mSlotMask     = imageBlock.mSlotMask;
+    }
 
-            const char *pEquals = FindFirst(pStart, pEnd, '=');
-            if (pEquals == pEnd)
-            {
-                // No value, just a key, save it anyway
-                // Optimistically, we assume it's new
-                std::string &name = pCurrBlock->mpValues[pCurrBlock->mnValueCount].szName;
-				name.assign(pStart, pEnd);
-
-                bool dup = false;
-                for(int ii=0;ii<pCurrBlock->mnValueCount;++ii)
-                {
-                    if(!pCurrBlock->mpValues[ii].szName.compare(name))
-                    {
-                        dup = true;
-                        break;
-                    }
-                }
-                if(!dup)
-                {
-                    pCurrBlock->mnValueCount++;
-                }
-            }
-            else
-            {
-                const char *pNameStart = pStart;
-                const char *pNameEnd = pEquals;
-                const char *pValStart = pEquals + 1;
-                const char *pValEnd = pEnd;
-
-                RemoveWhitespace(pNameStart, pNameEnd);
-                RemoveWhitespace(pValStart, pValEnd);
-
-                // Optimistically assume the name is new
-                std::string &name = pCurrBlock->mpValues[pCurrBlock->mnValueCount].szName;
-				name.assign(pNameStart, pNameEnd);
-
-                bool dup = false;
-                for(int ii=0;ii<pCurrBlock->mnValueCount;++ii)
-                {
-                    if(!pCurrBlock->mpValues[ii].szName.compare(name))
-                    {
-                        dup = true;
-                        break;
-                    }
-                }
-                if(!dup)
-                {
-					pCurrBlock->mpValues[pCurrBlock->mnValueCount].szValue.assign(pValStart, pValEnd);
-                    pCurrBlock->mnValueCount++;
-                }
-            }
+    mEntries.resize(header.mEntryCount);
+    for (UINT ii = 0; ii < header.mEntryCount; ++ii)
+    {
+        CPUTConfigImageEntry imageEntry;
+        memcpy(&imageEntry, pEntries + ii * sizeof(imageEntry), sizeof(imageEntry));
+        if (!IsImageStringValid(mpFileContents, header.mContentsSize, imageEntry.mNameOffset, imageEntry.mNameLength) ||
+            !IsImageStringValid(mpFileContents, header.mContentsSize, imageEntry.mValueOffset, imageEntry.mValueLength))
+        {
+            Release();
+            return CPUT_ERROR_INVALID_PARAMETER;
+        }
+        CPUTConfigEntry &entry = mEntries[ii];
+        if (imageEntry.mNameOffset != CONFIG_IMAGE_NO_STRING)
+        {
+            entry.mpName = mpFileContents + imageEntry.mNameOffset;
+        }
+        if (imageEntry.mValueOffset != CONFIG_IMAGE_NO_STRING)
+        {
+            entry.mpValue = mpFileContents + imageEntry.mValueOffset;
+        }
+        entry.mNameLength  = imageEntry.mNameLength;
+        entry.mValueLength = imageEntry.mValueLength;
+        entry.mNameHash    = imageEntry.mNameHash;
+    }
+
+    mSlots.resize(header.mSlotCount);
+    if (header.mSlotCount)
+    {
+        memcpy(&mSlots[0], pSlots, header.mSlotCount * sizeof(UINT));
+    }
+    mBlockSlotOffset = header.mBlockSlotOffset;
+    mBlockSlotMask   = header.mBlockSlotMask;
+
+    // SaveBinary() writes each block's table after the previous one and the block name table
+    // last, so checking that they don't overlap keeps this linear in the image size
+    UINT slotEnd = 0;
+    for (UINT ii = 0; ii < header.mBlockCount; ++ii)
+    {
+        const CPUTConfigBlock &block = mBlocks[ii];
+        if (block.mnSlotOffset < slotEnd || !AreImageSlotsValid(&mSlots[block.mnSlotOffset], block.mSlotMask, (UINT)block.mnValueCount))
+        {
+            Release();
+            return CPUT_ERROR_INVALID_PARAMETER;
         }
+        slotEnd = block.mnSlotOffset + block.mSlotMask + 1;
+    }
+    if (mBlockSlotOffset < slotEnd || !AreImageSlotsValid(&mSlots[mBlockSlotOffset], mBlockSlotMask, header.mBlockCount))
+    {
+        Release();
+        return CPUT_ERROR_INVALID_PARAMETER;
     }
 
-    delete[] pFileContents;
+    FixupBlockPointers();
     return CPUT_SUCCESS;
 }
 
 //----------------------------------------------------------------
 CPUTConfigBlock *CPUTConfigFile::GetBlock(int nBlockIndex)
 {
-    if(nBlockIndex >= mnBlockCount || nBlockIndex < 0)
+    if(nBlockIndex >= (int)mBlocks.size() || nBlockIndex < 0)
     {
         return NULL;
     }
 
-    return &mpBlocks[nBlockIndex];
+    return &mBlocks[nBlockIndex];
 }
 
 //----------------------------------------------------------------
-CPUTConfigBlock *CPUTConfigFile::GetBlockByName(const std::string &szBlockName)
+CPUTConfigBlock *CPUTConfigFile::FindBlock(const char *pName, UINT nameLength)
 {
-    for(int ii=0; ii<mnBlockCount; ++ii)
+    if (mBlocks.empty())
+    {
+        return NULL;
+    }
+
+    const UINT *pSlots = &mSlots[mBlockSlotOffset];
+    for (UINT slot = HashName(pName, nameLength) & mBlockSlotMask; pSlots[slot] != 0; slot = (slot + 1) & mBlockSlotMask)
     {
-        if(mpBlocks[ii].mszName.compare(szBlockName) == 0)
+        CPUTConfigBlock *pBlock = &mBlocks[pSlots[slot] - 1];
+        if (pBlock->mNameLength == nameLength && memcmp(pBlock->mpName, pName, nameLength) == 0)
         {
-            return &mpBlocks[ii];
+            return pBlock;
         }
     }
     return NULL;
 }
 
 //----------------------------------------------------------------
-int CPUTConfigFile::BlockCount(void)
+CPUTConfigBlock *CPUTConfigFile::GetBlockByName(const std::string &szBlockName)
 {
-    return mnBlockCount;
+    return FindBlock(szBlockName.c_str(), (UINT)szBlockName.size());
 }
 
+//----------------------------------------------------------------
+CPUTConfigBlock *CPUTConfigFile::GetBlockByName(const char *szBlockName)
+{
+    return FindBlock(szBlockName, (UINT)strlen(szBlockName));
+}
+
+//----------------------------------------------------------------
+int CPUTConfigFile::BlockCount(void)
+{
+    return (int)mBlocks.size();
+}
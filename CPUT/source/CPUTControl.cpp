@@ -24,7 +24,8 @@ CPUTControl::CPUTControl():mControlVisible(true),
     mControlType(CPUT_CONTROL_UNKNOWN),
     mControlID(0),
     mpCallbackHandler(NULL),
-    mControlState(CPUT_CONTROL_ACTIVE)
+    mControlState(CPUT_CONTROL_ACTIVE),
+    mbGeometryDirty(true)
 {
     mColor.r = mColor.g = mColor.b = mColor.a = 1.0f;
 }
@@ -70,6 +71,7 @@ void CPUTControl::SetControlCallback(CPUTCallbackHandler *pHandler)
 void CPUTControl::SetVisibility(bool bVisible)
 {
     mControlVisible = bVisible;
+    mbGeometryDirty = true;
 }
 
 // visibility state
@@ -118,6 +120,7 @@ void CPUTControl::SetEnable(bool bEnabled)
     {
         mControlState = CPUT_CONTROL_ACTIVE;
     }
+    mbGeometryDirty = true;
 }
 
 // Return bool if the control is enabled/greyed out
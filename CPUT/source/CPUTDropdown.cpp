@@ -778,6 +778,7 @@ void CPUTDropdown::GetDimensions(int &width, int &height)
 //--------------------------------------------------------------------------------
 void CPUTDropdown::Recalculate()
 {
+    mbGeometryDirty = true;
     mpDropdownIdleSizeList;
 
     // calculate height/width of dropdown's interior based on string or button size
@@ -1048,6 +1049,38 @@ void CPUTDropdown::Draw(CPUTGUIVertex *pVertexBufferMirror, UINT *pInsertIndex,
     }
 }
 
+// Dirty when the dropdown, its selection or any of its items is
+//--------------------------------------------------------------------------------
+bool CPUTDropdown::IsGeometryDirty()
+{
+    if(mbGeometryDirty || (mpSelectedItemCopy && mpSelectedItemCopy->IsGeometryDirty()))
+    {
+        return true;
+    }
+    for(UINT i=0;i<mpListOfSelectableItems.size();i++)
+    {
+        if(mpListOfSelectableItems[i]->IsGeometryDirty())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+void CPUTDropdown::ClearGeometryDirty()
+{
+    mbGeometryDirty = false;
+    if(mpSelectedItemCopy)
+    {
+        mpSelectedItemCopy->ClearGeometryDirty();
+    }
+    for(UINT i=0;i<mpListOfSelectableItems.size();i++)
+    {
+        mpListOfSelectableItems[i]->ClearGeometryDirty();
+    }
+}
+
 CPUTDropdown* CPUTDropdown::Create(const std::string controlName, CPUTControlID controlID, CPUTFont * mpFont)
 {
 	return new CPUTDropdown(controlName, controlID, mpFont);
@@ -18,6 +18,12 @@
 #include "CPUTOSServices.h"
 #include <algorithm>
 
+// Empty slot in the kerning table, can't be a real pair as character ids are far below 0xFFFFFFFF
+static const uint64_t KERNING_EMPTY_KEY = ~0ULL;
+
+// Layouts kept per font before the cache is flushed
+static const size_t MAX_CACHED_LAYOUTS = 256;
+
 CPUTFont *CPUTFont::Create(const std::string& FontName, const std::string& AbsolutePathAndFilename)
 {
     CPUTFont *pFont;
@@ -33,8 +39,10 @@ CPUTFont::CPUTFont() :
     mpFontKerningPairs(NULL),
     mNumChars(0),
     mNumKerningPairs(0),
-    mFontScale(0.0f)
+    mFontScale(0.0f),
+    mKerningShift(64)
 {
+    memset(mpGlyphTable, 0, sizeof(mpGlyphTable));
 }
 
 //
@@ -147,34 +155,108 @@ CPUTFont *CPUTFont::LoadBMFont(const std::string & FontName, const std::string &
 
     delete pData;
 
+    pNewFont->BuildLookupTables();
+
     return pNewFont;
 }
 
-void CPUTFont::LayoutText(CPUTGUIVertex *pVtxBuffer, int *pWidth, int *pHeight, const std::string& text, int tlx, int tly)
+//
+// Replaces the linear searches through the char and kerning blocks with direct/hashed lookups.
+// Where the file lists an id or pair twice the later entry wins, like the searches did.
+//
+void CPUTFont::BuildLookupTables()
 {
-    int currentLine = 0;
-    int x = tlx, y = tly;
-    BMFontChars *pPreviousChar = NULL;
+    memset(mpGlyphTable, 0, sizeof(mpGlyphTable));
+    for (uint32_t i = 0; i < mNumChars; i++) {
+        BMFontChars *pChar = (BMFontChars *)(((uint8_t *)(mpFontChars)) + (20 * i));
+        if (pChar->id < CPUT_MAX_NUMBER_OF_CHARACTERS) {
+            mpGlyphTable[pChar->id] = pChar;
+        }
+    }
 
-    *pWidth = x - tlx;
+    // Power of two size with at most 50% load
+    uint32_t tableSize = 16;
+    mKerningShift = 64 - 4;
+    while (tableSize < mNumKerningPairs * 2) {
+        tableSize *= 2;
+        mKerningShift--;
+    }
+    mKerningKeys.assign(tableSize, KERNING_EMPTY_KEY);
+    mKerningAmounts.assign(tableSize, 0);
+
+    for (uint32_t i = 0; i < mNumKerningPairs; i++) {
+        // 10 byte records, so the fields aren't aligned
+        uint32_t first, second;
+        int16_t  amount;
+        const uint8_t *pPair = ((uint8_t *)(mpFontKerningPairs)) + (10 * i);
+        memcpy(&first, pPair, 4);
+        memcpy(&second, pPair + 4, 4);
+        memcpy(&amount, pPair + 8, 2);
+
+        uint64_t key = ((uint64_t)first << 32) | second;
+        uint32_t slot = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> mKerningShift);
+        while (mKerningKeys[slot] != KERNING_EMPTY_KEY && mKerningKeys[slot] != key) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        mKerningKeys[slot]    = key;
+        mKerningAmounts[slot] = amount;
+    }
 
-    for (uint32_t j = 0, index = 0; j < text.length(); j++) {
-        int charIndex = -1;
-        for (uint32_t i = 0; i < mNumChars; i++) {
-            if (((BMFontChars *)(((uint8_t *)(mpFontChars)) + (20 * i)))->id == text[j]) {
-                charIndex = i;
-            }
+    mLayoutCache.clear();
+}
+
+int CPUTFont::FindKerningAmount(uint32_t first, uint32_t second) const
+{
+    if (mNumKerningPairs == 0) {
+        return 0;
+    }
+
+    uint64_t key = ((uint64_t)first << 32) | second;
+    uint32_t mask = (uint32_t)mKerningKeys.size() - 1;
+    for (uint32_t slot = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> mKerningShift); ; slot = (slot + 1) & mask) {
+        if (mKerningKeys[slot] == key) {
+            return mKerningAmounts[slot];
         }
+        if (mKerningKeys[slot] == KERNING_EMPTY_KEY) {
+            return 0;
+        }
+    }
+}
 
-        if (charIndex == -1)
+//
+// Returns where each character of the string goes. GUI labels are laid out again every time
+// their control moves, so the result is cached by string (the cache is per font and scale).
+//
+const CPUTFont::TextLayout &CPUTFont::GetTextLayout(const std::string &text)
+{
+    std::unordered_map<std::string, TextLayout>::iterator it = mLayoutCache.find(text);
+    if (it != mLayoutCache.end()) {
+        return it->second;
+    }
+
+    if (mLayoutCache.size() >= MAX_CACHED_LAYOUTS) {
+        mLayoutCache.clear();
+    }
+    TextLayout &layout = mLayoutCache[text];
+    layout.glyphs.reserve(text.length());
+
+    int currentLine = 0;
+    int x = 0;
+    int width = 0;
+    const BMFontChars *pPreviousChar = NULL;
+
+    for (uint32_t j = 0; j < text.length(); j++) {
+        const BMFontChars *pChar = mpGlyphTable[(uint8_t)text[j]];
+
+        if (pChar == NULL)
         {
             // Handle special characters
             switch (text[j])
             {
                 // Line feed
                 case '\n':
-                    *pWidth = std::max(*pWidth, x - tlx);
-                    x = tlx;
+                    width = std::max(width, x);
+                    x = 0;
                     currentLine++;
                     continue;
 
@@ -185,59 +267,73 @@ void CPUTFont::LayoutText(CPUTGUIVertex *pVtxBuffer, int *pWidth, int *pHeight,
 
                 default:
                     DEBUG_PRINT("Invalid character being searched for value: %d, char: %c\n", (int)text[j], text[j]);
+                    continue;
             }
         }
 
-        BMFontChars *pChar = ((BMFontChars *)(((uint8_t *)(mpFontChars)) + (20 * charIndex)));
-
         int kernAmount = 0;
         if (pPreviousChar != NULL) {
-            for (uint32_t i = 0; i < mNumKerningPairs; i++) {
-                if ((((BMFontKerningPairs *)(((uint8_t *)(mpFontKerningPairs)) + (10 * i)))->first == pPreviousChar->id) &&
-                   (((BMFontKerningPairs *)(((uint8_t *)(mpFontKerningPairs)) + (10 * i)))->second == pChar->id)) {
-                    kernAmount = ((BMFontKerningPairs *)(((uint8_t *)(mpFontKerningPairs)) + (10 * i)))->amount;
-                }
-            }
+            kernAmount = FindKerningAmount(pPreviousChar->id, pChar->id);
         }
         pPreviousChar = pChar;
 
-        GUIColor fontColor;
-        fontColor.r = fontColor.a = fontColor.g = fontColor.b = 1.0f;
+        GlyphPlacement glyph = { pChar, x, kernAmount, currentLine };
+        layout.glyphs.push_back(glyph);
 
-        float texWidth = (float) mpFontCommon->scaleW;
-        float texHeight = (float) mpFontCommon->scaleH;
-        if(pVtxBuffer)
-        {
-            pVtxBuffer[index+0].Pos = float3((float)(x + mFontScale * (0 + pChar->xoffset + kernAmount)), (float)(y + mFontScale * (0 + pChar->yoffset) + mpFontCommon->lineHeight * mFontScale * currentLine), 1.0f);
-            pVtxBuffer[index+0].UV    = float2(pChar->x / texWidth, pChar->y / texHeight);
-            pVtxBuffer[index+0].Color = fontColor;
-
-            pVtxBuffer[index+1].Pos = float3((float)(x + mFontScale * (pChar->width + pChar->xoffset + kernAmount)), float(y + mFontScale * (0 + pChar->yoffset) + mpFontCommon->lineHeight * mFontScale * currentLine), 1.0f);
-            pVtxBuffer[index+1].UV    = float2((pChar->x + pChar->width) / texWidth, pChar->y / texHeight);
-            pVtxBuffer[index+1].Color = fontColor;
-
-            pVtxBuffer[index+2].Pos = float3((float)(x + mFontScale * (0.0f + pChar->xoffset + kernAmount)), (float)(y + mFontScale * (pChar->height + pChar->yoffset) + mpFontCommon->lineHeight * mFontScale * currentLine), 1.0f);
-            pVtxBuffer[index+2].UV    = float2(pChar->x / texWidth, (pChar->y + pChar->height) / texHeight);
-            pVtxBuffer[index+2].Color = fontColor;
+        x += int((pChar->xadvance + kernAmount) * mFontScale);
+    }
 
-            pVtxBuffer[index+3].Pos = float3((float)(x + mFontScale * (pChar->width + pChar->xoffset + kernAmount)), (float)(y + mFontScale * (0 + pChar->yoffset) + mpFontCommon->lineHeight * mFontScale * currentLine), 1.0f);
-            pVtxBuffer[index+3].UV    = float2((pChar->x + pChar->width) / texWidth, pChar->y / texHeight);
-            pVtxBuffer[index+3].Color = fontColor;
+    layout.width  = std::max(width, x);
+    layout.height = int(mpFontCommon->lineHeight * mFontScale * (currentLine + 1));
+    return layout;
+}
 
-            pVtxBuffer[index+4].Pos = float3((float)(x + mFontScale * (pChar->width + pChar->xoffset + kernAmount)), (float)(y + mFontScale * (pChar->height + pChar->yoffset) + mpFontCommon->lineHeight * mFontScale * currentLine), 1.0f);
-            pVtxBuffer[index+4].UV    = float2((pChar->x + pChar->width) / texWidth, (pChar->y + pChar->height) / texHeight);
-            pVtxBuffer[index+4].Color = fontColor;
+void CPUTFont::LayoutText(CPUTGUIVertex *pVtxBuffer, int *pWidth, int *pHeight, const std::string& text, int tlx, int tly)
+{
+    const TextLayout &layout = GetTextLayout(text);
 
-            pVtxBuffer[index+5].Pos = float3((float)(x + mFontScale * (0 + pChar->xoffset + kernAmount)), (float)(y + mFontScale * (pChar->height + pChar->yoffset) + mpFontCommon->lineHeight * mFontScale * currentLine), 1.0f);
-            pVtxBuffer[index+5].UV    = float2(pChar->x / texWidth, (pChar->y + pChar->height) / texHeight);
-            pVtxBuffer[index+5].Color = fontColor;
-        }
-        x += int((pChar->xadvance + kernAmount) * mFontScale);
-        index += 6;
+    *pWidth  = layout.width;
+    *pHeight = layout.height;
+    if (!pVtxBuffer) {
+        return;
     }
 
-    *pWidth = std::max(*pWidth, x - tlx);
-    *pHeight = int(mpFontCommon->lineHeight * mFontScale * (currentLine + 1));
+    GUIColor fontColor;
+    fontColor.r = fontColor.a = fontColor.g = fontColor.b = 1.0f;
+
+    float texWidth = (float) mpFontCommon->scaleW;
+    float texHeight = (float) mpFontCommon->scaleH;
+    for (uint32_t i = 0, index = 0; i < layout.glyphs.size(); i++, index += 6) {
+        const BMFontChars *pChar = layout.glyphs[i].pChar;
+        int kernAmount  = layout.glyphs[i].kernAmount;
+        int currentLine = layout.glyphs[i].line;
+        int x = tlx + layout.glyphs[i].x;
+        int y = tly;
+
+        pVtxBuffer[index+0].Pos = float3((float)(x + mFontScale * (0 + pChar->xoffset + kernAmount)), (float)(y + mFontScale * (0 + pChar->yoffset) + mpFontCommon->lineHeight * mFontScale * currentLine), 1.0f);
+        pVtxBuffer[index+0].UV    = float2(pChar->x / texWidth, pChar->y / texHeight);
+        pVtxBuffer[index+0].Color = fontColor;
+
+        pVtxBuffer[index+1].Pos = float3((float)(x + mFontScale * (pChar->width + pChar->xoffset + kernAmount)), float(y + mFontScale * (0 + pChar->yoffset) + mpFontCommon->lineHeight * mFontScale * currentLine), 1.0f);
+        pVtxBuffer[index+1].UV    = float2((pChar->x + pChar->width) / texWidth, pChar->y / texHeight);
+        pVtxBuffer[index+1].Color = fontColor;
+
+        pVtxBuffer[index+2].Pos = float3((float)(x + mFontScale * (0.0f + pChar->xoffset + kernAmount)), (float)(y + mFontScale * (pChar->height + pChar->yoffset) + mpFontCommon->lineHeight * mFontScale * currentLine), 1.0f);
+        pVtxBuffer[index+2].UV    = float2(pChar->x / texWidth, (pChar->y + pChar->height) / texHeight);
+        pVtxBuffer[index+2].Color = fontColor;
+
+        pVtxBuffer[index+3].Pos = float3((float)(x + mFontScale * (pChar->width + pChar->xoffset + kernAmount)), (float)(y + mFontScale * (0 + pChar->yoffset) + mpFontCommon->lineHeight * mFontScale * currentLine), 1.0f);
+        pVtxBuffer[index+3].UV    = float2((pChar->x + pChar->width) / texWidth, pChar->y / texHeight);
+        pVtxBuffer[index+3].Color = fontColor;
+
+        pVtxBuffer[index+4].Pos = float3((float)(x + mFontScale * (pChar->width + pChar->xoffset + kernAmount)), (float)(y + mFontScale * (pChar->height + pChar->yoffset) + mpFontCommon->lineHeight * mFontScale * currentLine), 1.0f);
+        pVtxBuffer[index+4].UV    = float2((pChar->x + pChar->width) / texWidth, (pChar->y + pChar->height) / texHeight);
+        pVtxBuffer[index+4].Color = fontColor;
+
+        pVtxBuffer[index+5].Pos = float3((float)(x + mFontScale * (0 + pChar->xoffset + kernAmount)), (float)(y + mFontScale * (pChar->height + pChar->yoffset) + mpFontCommon->lineHeight * mFontScale * currentLine), 1.0f);
+        pVtxBuffer[index+5].UV    = float2(pChar->x / texWidth, (pChar->y + pChar->height) / texHeight);
+        pVtxBuffer[index+5].Color = fontColor;
+    }
 }
 
 CPUTFont::~CPUTFont()
@@ -18,6 +18,9 @@
 #include "CPUTFont.h"
 
 const unsigned int CPUT_GUI_BUFFER_MAX = 5000;         // size (in number of verticies) for all GUI control graphics
+const unsigned int CPUT_GUI_RANGE_SLACK_MIN = 6*8;     // room for 8 more characters in a growing control's range
+const unsigned int CPUT_GUI_VOLATILE_REDRAWS = 2;      // controls redrawn this often between layouts get room to grow
+const unsigned int CPUT_GUI_UPLOAD_MERGE_GAP = 6*16;   // dirty ranges closer than this (in vertices) go up in one upload
 
 // Constructor
 //----------------------`-------------------------------------------------------
@@ -33,9 +36,13 @@ mUpdateBuffers(false),
     mHeight(-1),
     mBufferSize(CPUT_GUI_BUFFER_MAX),
     mpMirrorBuffer(NULL),
-    mUberBufferIndex(0)
+    mUberBufferIndex(0),
+    mpScratchBuffer(NULL),
+    mLastMouseState(CPUT_MOUSE_NONE)
 {
     mpMirrorBuffer = new CPUTGUIVertex[CPUT_GUI_BUFFER_MAX];
+    mpScratchBuffer = new CPUTGUIVertex[CPUT_GUI_BUFFER_MAX];
+    memset(&mUpdateStats, 0, sizeof(mUpdateStats));
     CPUTText::RegisterStaticResources();
     CPUTButton::RegisterStaticResources();
     CPUTCheckbox::RegisterStaticResources();
@@ -49,6 +56,7 @@ CPUTGuiController::~CPUTGuiController()
 {
     SAFE_RELEASE(mpFont);
     SAFE_DELETE_ARRAY(mpMirrorBuffer);
+    SAFE_DELETE_ARRAY(mpScratchBuffer);
     DeleteAllControls();
 }
 
@@ -66,6 +74,19 @@ CPUTEventHandledCode CPUTGuiController::HandleMouseEvent(int x, int y, int wheel
         return CPUT_EVENT_PASSTHROUGH;
     }
 
+    std::vector<CPUTControl*> &controlList = mControlPanelIDList[mActiveControlPanelSlotID]->mControlList;
+
+    // a mouse button went down or up, any control may change how it looks (e.g. a button
+    // released outside itself goes back to neutral without handling the event)
+    if(state != mLastMouseState)
+    {
+        mLastMouseState = state;
+        for(UINT i=0; i<controlList.size(); i++)
+        {
+            controlList[i]->MarkGeometryDirty();
+        }
+    }
+
     // walk the list of controls on the screen and see if they are to handle any of these events
     CPUTEventHandledCode EventResult = CPUT_EVENT_PASSTHROUGH;
     for(UINT i=0; i<mControlPanelIDList[mActiveControlPanelSlotID]->mControlList.size(); i++)
@@ -78,6 +99,7 @@ CPUTEventHandledCode CPUTGuiController::HandleMouseEvent(int x, int y, int wheel
             // You need to send a closed event to any remaining dropdowns...
 
             mControlPanelIDList[mActiveControlPanelSlotID]->mControlList[i]->HandleMouseEvent(-1,-1,wheel,state, message);
+            mControlPanelIDList[mActiveControlPanelSlotID]->mControlList[i]->MarkGeometryDirty();
         }
         else
         {
@@ -88,13 +110,14 @@ CPUTEventHandledCode CPUTGuiController::HandleMouseEvent(int x, int y, int wheel
             if( CPUT_EVENT_HANDLED == EventResult)
             {
                 mpFocusControl = mControlPanelIDList[mActiveControlPanelSlotID]->mControlList[i];
-                mUpdateBuffers = true;
+                mpFocusControl->MarkGeometryDirty();
             }
         }
         if(mpFocusControl && !mpFocusControl->HasFocus())
         {
+            // no longer drawn last, Update() lays the controls out again
+            mpFocusControl->MarkGeometryDirty();
             mpFocusControl = NULL;
-            mUpdateBuffers = true;
         }
     }
 
@@ -569,6 +592,7 @@ CPUTResult CPUTGuiController::DeleteControl(CPUTControlID controlID)
 }
 
 
+// Redraws the controls that changed since the last call and uploads only their ranges
 //--------------------------------------------------------------------------------
 void CPUTGuiController::Update()
 {
@@ -579,52 +603,179 @@ void CPUTGuiController::Update()
         RecalculateLayout();
         mRecalculate = false;
     }
-    if(!mUpdateBuffers)
-        return;
-    mUpdateBuffers = false;
+    memset(&mUpdateStats, 0, sizeof(mUpdateStats));
 
     HEAPCHECK;
-    static double timeSinceLastFPSUpdate = 0;
-    static int    framesSinceLastFPSUpdate = 0;
-    static double avgFPS = 0;
-    static CPUT_RECT windowRect = {0, 0, 0, 0};
-
     if( 0 == GetNumberOfControlsInPanel())
     {
         return;
     }
 
+    // the 'focused' control goes last so it stays on top (i.e. dropdowns)
+    std::vector<CPUTControl*> &controlList = mControlPanelIDList[mActiveControlPanelSlotID]->mControlList;
+    mDrawOrder.clear();
+    for(UINT ii=0; ii<controlList.size(); ii++)
+    {
+        if(mpFocusControl != controlList[ii])
+        {
+            mDrawOrder.push_back(controlList[ii]);
+        }
+    }
+    if(mpFocusControl)
+    {
+        mDrawOrder.push_back(mpFocusControl);
+    }
+
+    // controls added, removed or reordered: lay them all out again
+    bool repack = mUpdateBuffers || (mDrawOrder.size() != mControlRanges.size());
+    for(UINT ii=0; !repack && ii<mDrawOrder.size(); ii++)
+    {
+        repack = (mDrawOrder[ii] != mControlRanges[ii].pControl);
+    }
+    mUpdateBuffers = false;
+    if(repack)
+    {
+        RepackControls();
+        HEAPCHECK
+        return;
+    }
 
-    // check and see if any of the controls resized themselves
-    int ControlCount=GetNumberOfControlsInPanel();
+    // redraw the dirty controls in place, merging nearby ranges into one upload
+    mUploadSpans.clear();
+    for(UINT ii=0; ii<mControlRanges.size(); ii++)
+    {
+        ControlRange &range = mControlRanges[ii];
+        if(!range.pControl->IsGeometryDirty())
+        {
+            continue;
+        }
+        range.pControl->ClearGeometryDirty();
 
-    // 'clear' the buffer by resetting the pointer to the head
-    mUberBufferIndex = 0;
+        UINT count = 0;
+        range.pControl->Draw(mpScratchBuffer, &count, mBufferSize);
+        mUpdateStats.controlsDrawn++;
+        if(count > range.capacity)
+        {
+            // outgrew its range
+            RepackControls();
+            HEAPCHECK
+            return;
+        }
+        if(count == range.count && 0 == memcmp(&mpMirrorBuffer[range.offset], mpScratchBuffer, count*sizeof(CPUTGUIVertex)))
+        {
+            continue;
+        }
 
-    int ii=0;
-    while(ii<ControlCount)
+        UINT written = (count > range.count) ? count : range.count;
+        memcpy(&mpMirrorBuffer[range.offset], mpScratchBuffer, count*sizeof(CPUTGUIVertex));
+        if(count < range.count)
+        {
+            memset(&mpMirrorBuffer[range.offset + count], 0, (range.count - count)*sizeof(CPUTGUIVertex));
+        }
+        range.count = count;
+        range.redraws++;
+        mUpdateStats.verticesWritten += written;
+
+        if(!mUploadSpans.empty() && range.offset <= mUploadSpans.back().second + CPUT_GUI_UPLOAD_MERGE_GAP)
+        {
+            mUploadSpans.back().second = range.offset + written;
+        }
+        else
+        {
+            mUploadSpans.push_back(std::make_pair(range.offset, range.offset + written));
+        }
+    }
+
+    //API Specific
+    for(UINT ii=0; ii<mUploadSpans.size(); ii++)
     {
-        CPUTControl *pControl = mControlPanelIDList[mActiveControlPanelSlotID]->mControlList[ii];
+        UINT first = mUploadSpans[ii].first;
+        UINT count = mUploadSpans[ii].second - first;
+        if(CPUTFAILED(UpdateUberBufferRange(first, count)))
+        {
+            // no range uploads on this API, send the whole buffer once
+            UpdateUberBuffers();
+            mUpdateStats.bytesUploaded = mUberBufferIndex*sizeof(CPUTGUIVertex);
+            mUpdateStats.uploadCount = 1;
+            break;
+        }
+        mUpdateStats.bytesUploaded += count*sizeof(CPUTGUIVertex);
+        mUpdateStats.uploadCount++;
+    }
+    HEAPCHECK
+}
+
+// Lays out and draws every control in mDrawOrder, then uploads the whole buffer. Text and
+// controls that were redrawn a few times since the last layout (an FPS counter, a slider
+// being dragged) get room to grow, so their next changes stay in place.
+//--------------------------------------------------------------------------------
+void CPUTGuiController::RepackControls()
+{
+    std::vector<ControlRange> previous;
+    previous.swap(mControlRanges);
+    mControlRanges.resize(mDrawOrder.size());
 
-        // don't draw the focus control - draw it last so it stays on 'top'
-        if(mpFocusControl != pControl)
+    // draw them all back to back, as they always were
+    UINT slack = 0;
+    mUberBufferIndex = 0;
+    for(UINT ii=0; ii<mDrawOrder.size(); ii++)
+    {
+        ControlRange &range = mControlRanges[ii];
+        range.pControl = mDrawOrder[ii];
+        range.pControl->ClearGeometryDirty();
+        range.offset = mUberBufferIndex;
+        range.pControl->Draw(mpMirrorBuffer, &mUberBufferIndex, mBufferSize);
+        range.count = mUberBufferIndex - range.offset;
+        range.redraws = 0;
+
+        bool growing = (CPUT_TEXT == range.pControl->GetType());
+        for(UINT jj=0; jj<previous.size(); jj++)
         {
-            pControl->Draw(mpMirrorBuffer, &mUberBufferIndex, mBufferSize);                    
+            if(previous[jj].pControl == range.pControl)
+            {
+                growing = growing || (previous[jj].redraws >= CPUT_GUI_VOLATILE_REDRAWS);
+                break;
+            }
         }
-        ii++;
-        HEAPCHECK
+        range.capacity = range.count;
+        if(growing)
+        {
+            range.capacity += (range.count/2 > CPUT_GUI_RANGE_SLACK_MIN) ? range.count/2 : CPUT_GUI_RANGE_SLACK_MIN;
+        }
+        slack += range.capacity - range.count;
     }
+    mUpdateStats.controlsDrawn = (UINT)mDrawOrder.size();
+    mUpdateStats.repacked = true;
 
-    // do the 'focused' control last so it stays on top (i.e. dropdowns)
-    if(mpFocusControl)
+    if(mUberBufferIndex + slack > mBufferSize)
+    {
+        // no room to spare, keep them packed
+        for(UINT ii=0; ii<mControlRanges.size(); ii++)
+        {
+            mControlRanges[ii].capacity = mControlRanges[ii].count;
+        }
+    }
+    else if(slack > 0)
     {
-        mpFocusControl->Draw(mpMirrorBuffer, &mUberBufferIndex, mBufferSize);
+        // spread the ranges out, last one first since they only move up
+        UINT end = mUberBufferIndex + slack;
+        for(int ii=(int)mControlRanges.size()-1; ii>=0; ii--)
+        {
+            ControlRange &range = mControlRanges[ii];
+            UINT offset = end - range.capacity;
+            memmove(&mpMirrorBuffer[offset], &mpMirrorBuffer[range.offset], range.count*sizeof(CPUTGUIVertex));
+            memset(&mpMirrorBuffer[offset + range.count], 0, (range.capacity - range.count)*sizeof(CPUTGUIVertex));
+            range.offset = offset;
+            end = offset;
+        }
+        mUberBufferIndex += slack;
     }
-        
+    mUpdateStats.verticesWritten = mUberBufferIndex;
+
     //API Specific
     UpdateUberBuffers();
-    HEAPCHECK
-    return;
+    mUpdateStats.bytesUploaded = mUberBufferIndex*sizeof(CPUTGUIVertex);
+    mUpdateStats.uploadCount = 1;
 }
 
 void CPUTGuiController::ControlModified()
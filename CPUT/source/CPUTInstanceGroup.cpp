@@ -0,0 +1,249 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "CPUTInstanceGroup.h"
+#include "CPUTModel.h"
+#include "CPUTMesh.h"
+#include "CPUTMaterial.h"
+#include "CPUTBuffer.h"
+#include "CPUTCamera.h"
+#include "CPUTRenderStateBlock.h"
+#include "CPUTInputLayoutCache.h"
+#include <algorithm>
+
+//-----------------------------------------------------------------------------
+CPUTInstanceGroup::CPUTInstanceGroup(CPUTModel *pFirstModel)
+{
+    AddModel(pFirstModel);
+}
+
+//-----------------------------------------------------------------------------
+CPUTInstanceGroup::~CPUTInstanceGroup()
+{
+    for (UINT ii = 0; ii < mModels.size(); ii++)
+    {
+        SAFE_RELEASE(mModels[ii]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool CPUTInstanceGroup::Accepts(const CPUTModel *pModel) const
+{
+    return pModel->IsInstanceable() && mModels[0]->SharesMeshesAndMaterials(pModel);
+}
+
+//-----------------------------------------------------------------------------
+void CPUTInstanceGroup::AddModel(CPUTModel *pModel)
+{
+    pModel->AddRef();
+    mModels.push_back(pModel);
+}
+
+// One set of per-model constants for the whole group: with an identity world the
+// shaders' WorldViewProjection is the view-projection the instance world is applied to.
+//-----------------------------------------------------------------------------
+void CPUTInstanceGroup::UpdateGroupConstants(CPUTRenderParameters &renderParams)
+{
+    if (!renderParams.mpPerModelConstants)
+    {
+        return;
+    }
+    CPUTModelConstantBuffer cb;
+    cb.World        = float4x4Identity();
+    cb.NormalMatrix = cb.World;
+    cb.InverseWorld = cb.World;
+    cb.WorldViewProjection = cb.World;
+    cb.LightWorldViewProjection = cb.World;
+
+    CPUTCamera *pCamera = renderParams.mpCamera;
+    if (pCamera)
+    {
+        cb.WorldViewProjection = *pCamera->GetViewMatrix() * *pCamera->GetProjectionMatrix();
+    }
+    CPUTCamera *pShadowCamera = renderParams.mpShadowCamera;
+    if (pShadowCamera)
+    {
+        cb.LightWorldViewProjection = *pShadowCamera->GetViewMatrix() * *pShadowCamera->GetProjectionMatrix();
+    }
+
+    // bounds of everything drawn
+    float3 center(0.0f), half(0.0f);
+    for (UINT ii = 0; ii < mVisibleModels.size(); ii++)
+    {
+        float3 modelCenter, modelHalf;
+        mVisibleModels[ii]->GetBoundsWorldSpace(&modelCenter, &modelHalf);
+        if (ii == 0)
+        {
+            center = modelCenter;
+            half   = modelHalf;
+            continue;
+        }
+        float3 minExtent = Min(center - half, modelCenter - modelHalf);
+        float3 maxExtent = Max(center + half, modelCenter + modelHalf);
+        center = (minExtent + maxExtent) * 0.5f;
+        half   = (maxExtent - minExtent) * 0.5f;
+    }
+    cb.BoundingBoxCenterWorldSpace  = float4(center, 0);
+    cb.BoundingBoxHalfWorldSpace    = float4(half, 0);
+    cb.BoundingBoxCenterObjectSpace = cb.BoundingBoxCenterWorldSpace;
+    cb.BoundingBoxHalfObjectSpace   = cb.BoundingBoxHalfWorldSpace;
+    renderParams.mpPerModelConstants->SetData(0, sizeof(CPUTModelConstantBuffer), &cb);
+}
+
+//-----------------------------------------------------------------------------
+void CPUTInstanceGroup::Render(CPUTRenderParameters &renderParams, int materialIndex)
+{
+    // per instance visibility. Transforming the bounds is most of the cost per instance,
+    // so like CPUTAssetSet::RenderRecursive() they're only brought up to date when culling.
+    CPUTCamera *pCamera = renderParams.mpCamera;
+    bool cull = renderParams.mRenderOnlyVisibleModels && pCamera != NULL;
+    mVisibleModels.clear();
+    mVisibleWorld.clear();
+    for (UINT ii = 0; ii < mModels.size(); ii++)
+    {
+        CPUTModel *pModel = mModels[ii];
+        bool visible = renderParams.DrawsNode(pModel->IsDynamic());
+        if (visible && cull)
+        {
+            float3 center, half;
+            pModel->UpdateBoundsWorldSpace();
+            pModel->GetBoundsWorldSpace(&center, &half);
+            visible = pCamera->mFrustum.IsVisible(center, half);
+        }
+        if (visible)
+        {
+            mVisibleModels.push_back(pModel);
+        }
+    }
+    if (mVisibleModels.empty())
+    {
+        return;
+    }
+
+    // Members at the same level of detail next to each other, one run of draws per level
+    if (mModels[0]->GetLodCount() > 1)
+    {
+        std::stable_sort(mVisibleModels.begin(), mVisibleModels.end(), [](const CPUTModel *pA, const CPUTModel *pB)
+        {
+            return pA->GetLod() < pB->GetLod();
+        });
+    }
+    for (UINT ii = 0; ii < mVisibleModels.size(); ii++)
+    {
+        mVisibleWorld.push_back(*mVisibleModels[ii]->GetWorldMatrix());
+    }
+
+    // The meshes that can be instanced. mModels[0] holds their materials, so the list doesn't need references.
+    CPUTInputLayoutCache *pInputLayoutCache = CPUTInputLayoutCache::GetInputLayoutCache();
+    CPUTModel *pFirst = mModels[0];
+    int meshCount = pFirst->GetMeshCount();
+    bool drawOneByOne = false;
+    mInstancedMeshes.clear();
+    for (int mesh = 0; mesh < meshCount; mesh++)
+    {
+        CPUTMaterial *pMaterial = pFirst->GetMaterial(mesh, materialIndex);
+        if (pMaterial == NULL)
+        {
+            continue;
+        }
+        if (pMaterial->GetInstancedMaterial() && pFirst->GetMesh(mesh)->CanDrawInstanced() && renderParams.mpPerInstanceConstants)
+        {
+            mInstancedMeshes.push_back(mesh);
+        }
+        else
+        {
+            drawOneByOne = true;
+        }
+        SAFE_RELEASE(pMaterial);
+    }
+
+    // Each batch of world matrices is uploaded once and drawn with every instanced mesh
+    if (!mInstancedMeshes.empty())
+    {
+        UpdateGroupConstants(renderParams);
+    }
+    CPUTMaterial *pCurrentMaterial = NULL;
+    CPUTRenderStateBlock *pCurrentRenderState = NULL;
+    for (UINT run = 0; run < mVisibleModels.size() && !mInstancedMeshes.empty(); )
+    {
+        int lod = mVisibleModels[run]->GetLod();
+        UINT runEnd = run + 1;
+        while (runEnd < mVisibleModels.size() && mVisibleModels[runEnd]->GetLod() == lod)
+        {
+            runEnd++;
+        }
+        for (UINT first = run; first < runEnd; first += CPUT_MAX_INSTANCES_PER_DRAW)
+        {
+            UINT count = std::min(runEnd - first, (UINT)CPUT_MAX_INSTANCES_PER_DRAW);
+            renderParams.mpPerInstanceConstants->SetData(0, count * sizeof(float4x4), &mVisibleWorld[first]);
+            for (UINT ii = 0; ii < mInstancedMeshes.size(); ii++)
+            {
+                int mesh = mInstancedMeshes[ii];
+                CPUTMaterial *pMaterial = pFirst->GetMaterial(mesh, materialIndex);
+                CPUTMaterial *pInstancedMaterial = pMaterial->GetInstancedMaterial();
+                CPUTRenderStateBlock *pRenderStateBlock = pInstancedMaterial->GetRenderStateBlock();
+                SetMaterialStates(pInstancedMaterial, pCurrentMaterial);
+                SetRenderStateBlock(pRenderStateBlock, pCurrentRenderState);
+                CPUTMesh *pMesh = pFirst->GetMeshForLod(mesh, lod);
+                pInputLayoutCache->Apply(pMesh, pInstancedMaterial);
+                pMesh->DrawInstanced(count);
+                renderParams.mDrawCount++;
+                pCurrentMaterial = pInstancedMaterial;
+                pCurrentRenderState = pRenderStateBlock;
+                SAFE_RELEASE(pRenderStateBlock);
+                SAFE_RELEASE(pMaterial);
+            }
+        }
+        run = runEnd;
+    }
+
+    if (!drawOneByOne)
+    {
+        return;
+    }
+
+    // meshes that can't be instanced, drawn like CPUTAssetSet::RenderRecursive() does.
+    // The members hold the materials, so the current ones don't need a reference.
+    for (UINT ii = 0; ii < mVisibleModels.size(); ii++)
+    {
+        CPUTModel *pModel = mVisibleModels[ii];
+        pModel->UpdateShaderConstants(renderParams);
+        for (int mesh = 0; mesh < meshCount; mesh++)
+        {
+            CPUTMaterial *pMaterial = pModel->GetMaterial(mesh, materialIndex);
+            if (pMaterial == NULL)
+            {
+                continue;
+            }
+            CPUTMesh *pMesh = pModel->GetLodMesh(mesh);
+            if (pMaterial->GetInstancedMaterial() && pMesh->CanDrawInstanced() && renderParams.mpPerInstanceConstants)
+            {
+                // already drawn above
+                SAFE_RELEASE(pMaterial);
+                continue;
+            }
+            CPUTRenderStateBlock *pRenderStateBlock = pMaterial->GetRenderStateBlock();
+            SetMaterialStates(pMaterial, pCurrentMaterial);
+            SetRenderStateBlock(pRenderStateBlock, pCurrentRenderState);
+            pInputLayoutCache->Apply(pMesh, pMaterial);
+            pMesh->Draw();
+            renderParams.mDrawCount++;
+            pCurrentMaterial = pMaterial;
+            pCurrentRenderState = pRenderStateBlock;
+            SAFE_RELEASE(pRenderStateBlock);
+            SAFE_RELEASE(pMaterial);
+        }
+    }
+}
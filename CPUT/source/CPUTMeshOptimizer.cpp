@@ -0,0 +1,557 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "CPUTMeshOptimizer.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+UINT CPUTMeshOptimizer::mLoadFlags = CPUT_MESH_OPTIMIZE_NONE;
+
+// Forsyth's constants, see "Linear-Speed Vertex Cache Optimisation"
+static const UINT  FORSYTH_CACHE_SIZE          = 32;
+static const float FORSYTH_CACHE_DECAY_POWER   = 1.5f;
+static const float FORSYTH_LAST_TRI_SCORE      = 0.75f;
+static const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+static const UINT  FORSYTH_MAX_VALENCE_SCORE   = 64;   // table size, higher valences are computed
+
+static const UINT  NO_VERTEX = 0xFFFFFFFF;
+
+//-----------------------------------------------------------------------------
+uint16_t CPUTMeshOptimizer::FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign     = (bits >> 16) & 0x8000;
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (exponent == 0xFF)
+    {
+        return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0)); // inf, nan
+    }
+    int halfExponent = (int)exponent - 127 + 15;
+    if (halfExponent >= 31)
+    {
+        return (uint16_t)(sign | 0x7C00);
+    }
+
+    // Round to nearest even, a carry out of the mantissa correctly bumps the exponent
+    uint32_t half, remainder, halfway;
+    if (halfExponent <= 0)
+    {
+        if (halfExponent < -10)
+        {
+            return (uint16_t)sign;
+        }
+        mantissa |= 0x800000;
+        UINT shift = (UINT)(14 - halfExponent);
+        half      = mantissa >> shift;
+        remainder = mantissa & ((1u << shift) - 1);
+        halfway   = 1u << (shift - 1);
+    }
+    else
+    {
+        half      = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+        remainder = mantissa & 0x1FFF;
+        halfway   = 0x1000;
+    }
+    if (remainder > halfway || (remainder == halfway && (half & 1)))
+    {
+        half++;
+    }
+    return (uint16_t)(sign | half);
+}
+
+//-----------------------------------------------------------------------------
+float CPUTMeshOptimizer::HalfToFloat(uint16_t value)
+{
+    uint32_t sign     = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+    uint32_t bits;
+    if (exponent == 0x1F)
+    {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0)
+    {
+        bits = sign;
+    }
+    else
+    {
+        // denormal, normalize it
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400))
+        {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+static int8_t FloatToSnorm8(float value)
+{
+    value = std::max(-1.0f, std::min(1.0f, value));
+    return (int8_t)(value >= 0.0f ? (int)(value * 127.0f + 0.5f) : (int)(value * 127.0f - 0.5f));
+}
+
+//-----------------------------------------------------------------------------
+static bool IsDirection(eCPUT_VERTEX_ELEMENT_SEMANTIC semantic)
+{
+    return semantic == CPUT_VERTEX_ELEMENT_NORMAL || semantic == CPUT_VERTEX_ELEMENT_TANGENT || semantic == CPUT_VERTEX_ELEMENT_BINORMAL;
+}
+
+//-----------------------------------------------------------------------------
+bool CPUTMeshOptimizer::QuantizeVertices(CPUTRawMeshData &mesh)
+{
+    if (mesh.mVertexCount == 0 || mesh.mpVertices == NULL)
+    {
+        return false;
+    }
+
+    // Pick the new type of each element, then lay them out again in the same order
+    const UINT elementCount = mesh.mFormatDescriptorCount;
+    std::vector<CPUTVertexElementDesc> elements(mesh.mpElements, mesh.mpElements + elementCount);
+    bool changed = false;
+    UINT offset = 0;
+    for (UINT ii = 0; ii < elementCount; ii++)
+    {
+        const CPUTVertexElementDesc &source = mesh.mpElements[ii];
+        CPUTVertexElementDesc &element = elements[ii];
+        if (source.mVertexElementType == eCPUT_VERTEX_ELEMENT_TYPE::tFLOAT)
+        {
+            if (IsDirection(source.mVertexElementSemantic) && (source.mElementSizeInBytes == 3 * sizeof(float) || source.mElementSizeInBytes == 4 * sizeof(float)))
+            {
+                element.mVertexElementType  = eCPUT_VERTEX_ELEMENT_TYPE::tSNORM8;
+                element.mElementSizeInBytes = 4;
+            }
+            else if (source.mVertexElementSemantic == CPUT_VERTEX_ELEMENT_TEXTURECOORD && source.mElementSizeInBytes == 2 * sizeof(float))
+            {
+                float range = 0.0f;
+                for (UINT vv = 0; vv < mesh.mVertexCount; vv++)
+                {
+                    float uv[2];
+                    memcpy(uv, mesh.mpVertices + vv * mesh.mStride + source.mOffset, sizeof(uv));
+                    range = std::max(range, std::max(fabsf(uv[0]), fabsf(uv[1])));
+                }
+                if (range <= CPUT_MESH_HALF_UV_RANGE)
+                {
+                    element.mVertexElementType  = eCPUT_VERTEX_ELEMENT_TYPE::tHALF;
+                    element.mElementSizeInBytes = 2 * sizeof(uint16_t);
+                }
+            }
+        }
+        changed |= (element.mVertexElementType != source.mVertexElementType);
+        element.mOffset = offset;
+        offset += element.mElementSizeInBytes;
+    }
+    if (!changed)
+    {
+        return false;
+    }
+
+    // Every packed element is 4 bytes, keep the stride a multiple of 4 for the vertex SRV
+    const UINT stride = (offset + 3) & ~3u;
+    char *pVertices = new char[(size_t)mesh.mVertexCount * stride];
+    memset(pVertices, 0, (size_t)mesh.mVertexCount * stride);
+    for (UINT vv = 0; vv < mesh.mVertexCount; vv++)
+    {
+        const char *pSource = mesh.mpVertices + (size_t)vv * mesh.mStride;
+        char *pDest = pVertices + (size_t)vv * stride;
+        for (UINT ii = 0; ii < elementCount; ii++)
+        {
+            const CPUTVertexElementDesc &source = mesh.mpElements[ii];
+            const CPUTVertexElementDesc &element = elements[ii];
+            if (element.mVertexElementType == eCPUT_VERTEX_ELEMENT_TYPE::tSNORM8)
+            {
+                float value[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                memcpy(value, pSource + source.mOffset, source.mElementSizeInBytes);
+                int8_t packed[4];
+                for (UINT cc = 0; cc < 4; cc++)
+                {
+                    packed[cc] = FloatToSnorm8(value[cc]);
+                }
+                memcpy(pDest + element.mOffset, packed, sizeof(packed));
+            }
+            else if (element.mVertexElementType == eCPUT_VERTEX_ELEMENT_TYPE::tHALF)
+            {
+                float value[2];
+                memcpy(value, pSource + source.mOffset, sizeof(value));
+                uint16_t packed[2] = { FloatToHalf(value[0]), FloatToHalf(value[1]) };
+                memcpy(pDest + element.mOffset, packed, sizeof(packed));
+            }
+            else
+            {
+                memcpy(pDest + element.mOffset, pSource + source.mOffset, source.mElementSizeInBytes);
+            }
+        }
+    }
+
+    delete[] mesh.mpVertices;
+    mesh.mpVertices = pVertices;
+    std::copy(elements.begin(), elements.end(), mesh.mpElements);
+    mesh.mStride = stride;
+    mesh.mPaddingSize = 0;
+    mesh.mTotalVerticesSizeInBytes = (uint64_t)mesh.mVertexCount * stride;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+static uint32_t HashVertex(const char *pVertex, UINT stride)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (UINT ii = 0; ii < stride; ii++)
+    {
+        hash = (hash ^ (uint8_t)pVertex[ii]) * 16777619u;
+    }
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTMeshOptimizer::WeldVertices(CPUTRawMeshData &mesh)
+{
+    const UINT stride = mesh.mStride;
+    if (mesh.mVertexCount == 0 || mesh.mIndexCount == 0)
+    {
+        return;
+    }
+
+    UINT tableSize = 1;
+    while (tableSize < mesh.mVertexCount * 2)
+    {
+        tableSize *= 2;
+    }
+    std::vector<UINT> table(tableSize, NO_VERTEX);  // index of the kept vertex
+    std::vector<UINT> remap(mesh.mVertexCount);
+
+    // Kept vertices are moved down in place; a slot is only written once every vertex
+    // in it has been read, so the comparisons below always see kept vertices.
+    UINT unique = 0;
+    for (UINT vv = 0; vv < mesh.mVertexCount; vv++)
+    {
+        const char *pVertex = mesh.mpVertices + (size_t)vv * stride;
+        UINT slot = HashVertex(pVertex, stride) & (tableSize - 1);
+        while (table[slot] != NO_VERTEX && memcmp(mesh.mpVertices + (size_t)table[slot] * stride, pVertex, stride) != 0)
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] != NO_VERTEX)
+        {
+            remap[vv] = table[slot];
+            continue;
+        }
+        if (unique != vv)
+        {
+            memcpy(mesh.mpVertices + (size_t)unique * stride, pVertex, stride);
+        }
+        table[slot] = unique;
+        remap[vv] = unique++;
+    }
+
+    for (UINT ii = 0; ii < mesh.mIndexCount; ii++)
+    {
+        ASSERT(mesh.mpIndices[ii] < mesh.mVertexCount, "Mesh index out of range");
+        mesh.mpIndices[ii] = remap[mesh.mpIndices[ii]];
+    }
+    mesh.mVertexCount = unique;
+    mesh.mTotalVerticesSizeInBytes = (uint64_t)unique * stride;
+}
+
+//-----------------------------------------------------------------------------
+struct ForsythScores
+{
+    float mCache[FORSYTH_CACHE_SIZE];
+    float mValence[FORSYTH_MAX_VALENCE_SCORE];
+
+    ForsythScores()
+    {
+        for (UINT ii = 0; ii < FORSYTH_CACHE_SIZE; ii++)
+        {
+            // the last triangle's vertices get a fixed score, so it isn't simply drawn again
+            mCache[ii] = (ii < 3) ? FORSYTH_LAST_TRI_SCORE :
+                powf(1.0f - (float)(ii - 3) / (float)(FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+        }
+        mValence[0] = 0.0f;
+        for (UINT ii = 1; ii < FORSYTH_MAX_VALENCE_SCORE; ii++)
+        {
+            mValence[ii] = FORSYTH_VALENCE_BOOST_SCALE * powf((float)ii, -FORSYTH_VALENCE_BOOST_POWER);
+        }
+    }
+
+    float Score(int cachePosition, UINT remainingTriangles) const
+    {
+        if (remainingTriangles == 0)
+        {
+            return -1.0f; // not needed any more
+        }
+        float score = (cachePosition >= 0) ? mCache[cachePosition] : 0.0f;
+        score += (remainingTriangles < FORSYTH_MAX_VALENCE_SCORE) ? mValence[remainingTriangles] :
+            FORSYTH_VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -FORSYTH_VALENCE_BOOST_POWER);
+        return score;
+    }
+};
+
+//-----------------------------------------------------------------------------
+void CPUTMeshOptimizer::OptimizeVertexCache(UINT *pIndices, UINT indexCount, UINT vertexCount)
+{
+    const UINT triangleCount = indexCount / 3;
+    if (triangleCount < 2 || vertexCount == 0)
+    {
+        return;
+    }
+    const ForsythScores scores;
+
+    // Triangles using each vertex; the first mRemaining of a vertex's list are not drawn yet
+    std::vector<UINT> remaining(vertexCount, 0);
+    for (UINT ii = 0; ii < triangleCount * 3; ii++)
+    {
+        ASSERT(pIndices[ii] < vertexCount, "Mesh index out of range");
+        remaining[pIndices[ii]]++;
+    }
+    std::vector<UINT> firstTriangle(vertexCount + 1, 0);
+    for (UINT vv = 0; vv < vertexCount; vv++)
+    {
+        firstTriangle[vv + 1] = firstTriangle[vv] + remaining[vv];
+    }
+    std::vector<UINT> vertexTriangles(triangleCount * 3);
+    std::vector<UINT> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (UINT tt = 0; tt < triangleCount; tt++)
+    {
+        for (UINT cc = 0; cc < 3; cc++)
+        {
+            UINT vertex = pIndices[tt * 3 + cc];
+            vertexTriangles[fill[vertex]++] = tt;
+        }
+    }
+
+    std::vector<int>   cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (UINT vv = 0; vv < vertexCount; vv++)
+    {
+        vertexScore[vv] = scores.Score(-1, remaining[vv]);
+    }
+    std::vector<bool> drawn(triangleCount, false);
+    UINT bestTriangle = 0;
+    float bestScore = -1.0f;
+    for (UINT tt = 0; tt < triangleCount; tt++)
+    {
+        float score = vertexScore[pIndices[tt * 3]] + vertexScore[pIndices[tt * 3 + 1]] + vertexScore[pIndices[tt * 3 + 2]];
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestTriangle = tt;
+        }
+    }
+
+    std::vector<UINT> output(triangleCount * 3);
+    UINT cache[FORSYTH_CACHE_SIZE + 3];
+    UINT cacheCount = 0;
+    UINT nextUndrawn = 0;
+    for (UINT outputTriangle = 0; outputTriangle < triangleCount; outputTriangle++)
+    {
+        if (bestTriangle == NO_VERTEX)
+        {
+            // Nothing in the cache leads anywhere, carry on with the next triangle not drawn yet
+            while (drawn[nextUndrawn])
+            {
+                nextUndrawn++;
+            }
+            bestTriangle = nextUndrawn;
+        }
+        const UINT *pTriangle = pIndices + bestTriangle * 3;
+        memcpy(&output[outputTriangle * 3], pTriangle, 3 * sizeof(UINT));
+        drawn[bestTriangle] = true;
+
+        // Take the triangle off its vertices' lists of triangles to draw
+        for (UINT cc = 0; cc < 3; cc++)
+        {
+            UINT vertex = pTriangle[cc];
+            UINT *pList = &vertexTriangles[firstTriangle[vertex]];
+            UINT count = remaining[vertex];
+            for (UINT ii = 0; ii < count; ii++)
+            {
+                if (pList[ii] == bestTriangle)
+                {
+                    std::swap(pList[ii], pList[count - 1]);
+                    break;
+                }
+            }
+            remaining[vertex] = count - 1;
+        }
+
+        // Its vertices go to the front of the LRU cache
+        UINT newCache[FORSYTH_CACHE_SIZE + 3];
+        UINT newCount = 0;
+        for (UINT cc = 0; cc < 3; cc++)
+        {
+            newCache[newCount++] = pTriangle[cc];
+        }
+        for (UINT ii = 0; ii < cacheCount; ii++)
+        {
+            UINT vertex = cache[ii];
+            if (vertex != pTriangle[0] && vertex != pTriangle[1] && vertex != pTriangle[2])
+            {
+                newCache[newCount++] = vertex;
+            }
+        }
+        for (UINT ii = FORSYTH_CACHE_SIZE; ii < newCount; ii++)
+        {
+            cachePosition[newCache[ii]] = -1;   // fell out
+            vertexScore[newCache[ii]] = scores.Score(-1, remaining[newCache[ii]]);
+        }
+        cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+        memcpy(cache, newCache, cacheCount * sizeof(UINT));
+        for (UINT ii = 0; ii < cacheCount; ii++)
+        {
+            cachePosition[cache[ii]] = (int)ii;
+            vertexScore[cache[ii]] = scores.Score((int)ii, remaining[cache[ii]]);
+        }
+
+        // Only triangles of cached vertices changed score, the best of them is drawn next
+        bestTriangle = NO_VERTEX;
+        bestScore = -1.0f;
+        for (UINT ii = 0; ii < cacheCount; ii++)
+        {
+            UINT vertex = cache[ii];
+            const UINT *pList = &vertexTriangles[firstTriangle[vertex]];
+            for (UINT jj = 0; jj < remaining[vertex]; jj++)
+            {
+                UINT triangle = pList[jj];
+                const UINT *pCorners = pIndices + triangle * 3;
+                float score = vertexScore[pCorners[0]] + vertexScore[pCorners[1]] + vertexScore[pCorners[2]];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = triangle;
+                }
+            }
+        }
+    }
+    memcpy(pIndices, &output[0], triangleCount * 3 * sizeof(UINT));
+}
+
+//-----------------------------------------------------------------------------
+void CPUTMeshOptimizer::OptimizeVertexFetch(CPUTRawMeshData &mesh)
+{
+    if (mesh.mVertexCount == 0 || mesh.mIndexCount == 0)
+    {
+        return;
+    }
+    const UINT stride = mesh.mStride;
+    std::vector<UINT> remap(mesh.mVertexCount, NO_VERTEX);
+    UINT next = 0;
+    for (UINT ii = 0; ii < mesh.mIndexCount; ii++)
+    {
+        UINT &vertex = remap[mesh.mpIndices[ii]];
+        if (vertex == NO_VERTEX)
+        {
+            vertex = next++;
+        }
+        mesh.mpIndices[ii] = vertex;
+    }
+
+    char *pVertices = new char[(size_t)next * stride];
+    for (UINT vv = 0; vv < mesh.mVertexCount; vv++)
+    {
+        if (remap[vv] != NO_VERTEX)
+        {
+            memcpy(pVertices + (size_t)remap[vv] * stride, mesh.mpVertices + (size_t)vv * stride, stride);
+        }
+    }
+    delete[] mesh.mpVertices;
+    mesh.mpVertices = pVertices;
+    mesh.mVertexCount = next;
+    mesh.mTotalVerticesSizeInBytes = (uint64_t)next * stride;
+}
+
+//-----------------------------------------------------------------------------
+float CPUTMeshOptimizer::ComputeACMR(const UINT *pIndices, UINT indexCount, UINT vertexCount, UINT cacheSize)
+{
+    const UINT triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return 0.0f;
+    }
+    // A vertex is in the FIFO when fewer than cacheSize misses happened since its own
+    std::vector<UINT> missedAt(vertexCount, 0);
+    UINT misses = 0;
+    for (UINT ii = 0; ii < triangleCount * 3; ii++)
+    {
+        UINT vertex = pIndices[ii];
+        if (missedAt[vertex] == 0 || misses + 1 - missedAt[vertex] > cacheSize)
+        {
+            missedAt[vertex] = ++misses;
+        }
+    }
+    return (float)misses / (float)triangleCount;
+}
+
+//-----------------------------------------------------------------------------
+CPUTResult CPUTMeshOptimizer::Optimize(CPUTRawMeshData &mesh, UINT flags, CPUTMeshOptimizerStats *pStats)
+{
+    const bool indexed = mesh.mVertexCount > 0 && mesh.mIndexCount >= 3;
+    if (pStats)
+    {
+        pStats->mVertexCountBefore = mesh.mVertexCount;
+        pStats->mStrideBefore      = mesh.mStride;
+        pStats->mIndexSizeBefore   = (mesh.mIndexType == eCPUT_VERTEX_ELEMENT_TYPE::tUINT16) ? sizeof(uint16_t) : sizeof(UINT);
+        pStats->mACMRBefore        = indexed ? ComputeACMR(mesh.mpIndices, mesh.mIndexCount, mesh.mVertexCount) : 0.0f;
+    }
+
+    if (flags & CPUT_MESH_OPTIMIZE_QUANTIZE)
+    {
+        QuantizeVertices(mesh);
+    }
+    if (indexed)
+    {
+        if (flags & CPUT_MESH_OPTIMIZE_WELD)
+        {
+            WeldVertices(mesh);
+        }
+        if (flags & CPUT_MESH_OPTIMIZE_VERTEX_CACHE)
+        {
+            OptimizeVertexCache(mesh.mpIndices, mesh.mIndexCount, mesh.mVertexCount);
+        }
+        if (flags & CPUT_MESH_OPTIMIZE_VERTEX_FETCH)
+        {
+            OptimizeVertexFetch(mesh);
+        }
+        if ((flags & CPUT_MESH_OPTIMIZE_INDEX16) && mesh.mVertexCount <= 0x10000)
+        {
+            mesh.mIndexType = eCPUT_VERTEX_ELEMENT_TYPE::tUINT16;
+        }
+    }
+
+    if (pStats)
+    {
+        pStats->mVertexCountAfter = mesh.mVertexCount;
+        pStats->mStrideAfter      = mesh.mStride;
+        pStats->mIndexSizeAfter   = (mesh.mIndexType == eCPUT_VERTEX_ELEMENT_TYPE::tUINT16) ? sizeof(uint16_t) : sizeof(UINT);
+        pStats->mACMRAfter        = indexed ? ComputeACMR(mesh.mpIndices, mesh.mIndexCount, mesh.mVertexCount) : 0.0f;
+    }
+    return CPUT_SUCCESS;
+}
@@ -0,0 +1,588 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CPUTMeshSimplifier.h"
+#include "CPUTMeshOptimizer.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+static const UINT NO_VERTEX = 0xFFFFFFFF;
+
+// Weight of the planes that keep open borders and attribute seams in place, relative to the
+// surface's. Seams include the outline of double sided cards, which is closed by position.
+static const float BORDER_EDGE_WEIGHT = 10.0f;
+static const float SEAM_EDGE_WEIGHT   = 1.0f;
+
+// A pass stops at the first collapse this much worse than the one that would have met the
+// target, so the cheaper collapses that show up as neighbours change get their turn first
+static const float PASS_ERROR_SLACK = 1.5f;
+
+enum VertexKind
+{
+    KIND_MANIFOLD,
+    KIND_BORDER,
+    KIND_LOCKED,
+    KIND_COUNT
+};
+
+// Can a vertex of the first kind collapse onto a neighbour of the second
+static const bool CAN_COLLAPSE[KIND_COUNT][KIND_COUNT] =
+{
+    { true,  true,  true  },
+    { false, true,  false },
+    { false, false, false },
+};
+
+// Is there a triangle on both sides of an edge between the two kinds
+static const bool HAS_OPPOSITE[KIND_COUNT][KIND_COUNT] =
+{
+    { true,  true,  false },
+    { true,  false, false },
+    { false, false, false },
+};
+
+// Sum of squared distances to a set of weighted planes: p'Ap + 2b'p + c
+struct Quadric
+{
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+    double weight;
+};
+
+struct Collapse
+{
+    UINT  mFrom;    // positions, i.e. remapped vertices
+    UINT  mTo;
+    float mError;
+
+    bool operator<(const Collapse &other) const { return mError < other.mError; }
+};
+
+//-----------------------------------------------------------------------------
+static void AddPlane(Quadric *pQuadric, const float3 &normal, float distance, float weight)
+{
+    const double x = normal.x, y = normal.y, z = normal.z, d = distance, w = weight;
+    pQuadric->a00 += w * x * x;
+    pQuadric->a01 += w * x * y;
+    pQuadric->a02 += w * x * z;
+    pQuadric->a11 += w * y * y;
+    pQuadric->a12 += w * y * z;
+    pQuadric->a22 += w * z * z;
+    pQuadric->b0  += w * x * d;
+    pQuadric->b1  += w * y * d;
+    pQuadric->b2  += w * z * d;
+    pQuadric->c   += w * d * d;
+    pQuadric->weight += w;
+}
+
+//-----------------------------------------------------------------------------
+static void AddQuadric(Quadric *pQuadric, const Quadric &other)
+{
+    pQuadric->a00 += other.a00;
+    pQuadric->a01 += other.a01;
+    pQuadric->a02 += other.a02;
+    pQuadric->a11 += other.a11;
+    pQuadric->a12 += other.a12;
+    pQuadric->a22 += other.a22;
+    pQuadric->b0  += other.b0;
+    pQuadric->b1  += other.b1;
+    pQuadric->b2  += other.b2;
+    pQuadric->c   += other.c;
+    pQuadric->weight += other.weight;
+}
+
+// Squared distance, averaged over the planes by weight
+//-----------------------------------------------------------------------------
+static float QuadricError(const Quadric &q, const float3 &position)
+{
+    const double x = position.x, y = position.y, z = position.z;
+    const double ax = q.a00 * x + q.a01 * y + q.a02 * z;
+    const double ay = q.a01 * x + q.a11 * y + q.a12 * z;
+    const double az = q.a02 * x + q.a12 * y + q.a22 * z;
+    const double error = x * ax + y * ay + z * az + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+    return q.weight > 0.0 ? (float)(fabs(error) / q.weight) : 0.0f;
+}
+
+// For every corner of every triangle the vertex (pRemap[vertex] if given) gets the triangle's
+// next and previous vertex, i.e. its outgoing edges and the fan of triangles around it
+//-----------------------------------------------------------------------------
+static void BuildAdjacency(const UINT *pIndices, UINT indexCount, UINT vertexCount, const UINT *pRemap, std::vector<UINT> *pOffsets, std::vector<UINT> *pData)
+{
+    std::vector<UINT> &offsets = *pOffsets;
+    std::vector<UINT> &data = *pData;
+    offsets.assign(vertexCount + 1, 0);
+    for (UINT ii = 0; ii < indexCount; ii++)
+    {
+        const UINT vertex = pRemap ? pRemap[pIndices[ii]] : pIndices[ii];
+        offsets[vertex + 1] += 2;
+    }
+    for (UINT vv = 0; vv < vertexCount; vv++)
+    {
+        offsets[vv + 1] += offsets[vv];
+    }
+    data.resize(offsets[vertexCount]);
+    std::vector<UINT> cursor(offsets.begin(), offsets.end() - 1);
+    for (UINT tt = 0; tt < indexCount; tt += 3)
+    {
+        for (UINT kk = 0; kk < 3; kk++)
+        {
+            UINT vertex = pIndices[tt + kk];
+            UINT next   = pIndices[tt + (kk + 1) % 3];
+            UINT prev   = pIndices[tt + (kk + 2) % 3];
+            if (pRemap)
+            {
+                vertex = pRemap[vertex];
+                next   = pRemap[next];
+                prev   = pRemap[prev];
+            }
+            data[cursor[vertex]++] = next;
+            data[cursor[vertex]++] = prev;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+static bool HasEdge(const std::vector<UINT> &offsets, const std::vector<UINT> &data, UINT from, UINT to)
+{
+    for (UINT ee = offsets[from]; ee < offsets[from + 1]; ee += 2)
+    {
+        if (data[ee] == to)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Would moving position 'from' to 'to' turn any of the triangles around it over. Triangles
+// that also use 'to' disappear with the collapse and don't count.
+//-----------------------------------------------------------------------------
+static bool FlipsTriangle(const std::vector<UINT> &fanOffsets, const std::vector<UINT> &fan, const std::vector<float3> &positions,
+                          const std::vector<UINT> &collapseTo, UINT from, UINT to)
+{
+    const float3 &source = positions[from];
+    const float3 &target = positions[to];
+    for (UINT ee = fanOffsets[from]; ee < fanOffsets[from + 1]; ee += 2)
+    {
+        // collapses made earlier in the pass may have moved the other two corners
+        const UINT a = collapseTo[fan[ee]];
+        const UINT b = collapseTo[fan[ee + 1]];
+        if (a == to || b == to)
+        {
+            continue;
+        }
+        const float3 before = cross3(positions[a] - source, positions[b] - source);
+        const float3 after  = cross3(positions[a] - target, positions[b] - target);
+        if (dot3(before, after) <= 0.0f)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Everything but the position, as floats, to find the closest vertex when positions merge
+//-----------------------------------------------------------------------------
+static UINT DecodeAttributes(const CPUTRawMeshData &mesh, const CPUTVertexElementDesc *pPosition, std::vector<float> *pAttributes)
+{
+    UINT count = 0;
+    for (UINT ii = 0; ii < mesh.mFormatDescriptorCount; ii++)
+    {
+        const CPUTVertexElementDesc &element = mesh.mpElements[ii];
+        if (&element == pPosition)
+        {
+            continue;
+        }
+        switch (element.mVertexElementType)
+        {
+        case eCPUT_VERTEX_ELEMENT_TYPE::tFLOAT: count += element.mElementSizeInBytes / sizeof(float); break;
+        case eCPUT_VERTEX_ELEMENT_TYPE::tHALF:  count += element.mElementSizeInBytes / sizeof(uint16_t); break;
+        default:                                count += element.mElementSizeInBytes; break;
+        }
+    }
+    pAttributes->resize((size_t)mesh.mVertexCount * count);
+    float *pOut = pAttributes->empty() ? NULL : &(*pAttributes)[0];
+    for (UINT vv = 0; vv < mesh.mVertexCount; vv++)
+    {
+        const char *pVertex = mesh.mpVertices + (size_t)vv * mesh.mStride;
+        for (UINT ii = 0; ii < mesh.mFormatDescriptorCount; ii++)
+        {
+            const CPUTVertexElementDesc &element = mesh.mpElements[ii];
+            if (&element == pPosition)
+            {
+                continue;
+            }
+            const char *pElement = pVertex + element.mOffset;
+            if (element.mVertexElementType == eCPUT_VERTEX_ELEMENT_TYPE::tFLOAT)
+            {
+                for (UINT cc = 0; cc < element.mElementSizeInBytes / sizeof(float); cc++)
+                {
+                    memcpy(pOut++, pElement + cc * sizeof(float), sizeof(float));
+                }
+            }
+            else if (element.mVertexElementType == eCPUT_VERTEX_ELEMENT_TYPE::tHALF)
+            {
+                for (UINT cc = 0; cc < element.mElementSizeInBytes / sizeof(uint16_t); cc++)
+                {
+                    uint16_t half;
+                    memcpy(&half, pElement + cc * sizeof(uint16_t), sizeof(half));
+                    *pOut++ = CPUTMeshOptimizer::HalfToFloat(half);
+                }
+            }
+            else if (element.mVertexElementType == eCPUT_VERTEX_ELEMENT_TYPE::tSNORM8)
+            {
+                for (UINT cc = 0; cc < element.mElementSizeInBytes; cc++)
+                {
+                    *pOut++ = std::max(-1.0f, (int8_t)pElement[cc] / 127.0f);
+                }
+            }
+            else
+            {
+                // indices and such, only equal or not
+                for (UINT cc = 0; cc < element.mElementSizeInBytes; cc++)
+                {
+                    *pOut++ = (uint8_t)pElement[cc];
+                }
+            }
+        }
+    }
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+float CPUTMeshSimplifier::Simplify(CPUTRawMeshData &mesh, UINT targetIndexCount, float maxError)
+{
+    const UINT vertexCount = mesh.mVertexCount;
+    UINT indexCount = mesh.mIndexCount - mesh.mIndexCount % 3;
+    if (vertexCount == 0 || indexCount <= targetIndexCount)
+    {
+        return 0.0f;
+    }
+    const CPUTVertexElementDesc *pPosition = NULL;
+    for (UINT ii = 0; ii < mesh.mFormatDescriptorCount; ii++)
+    {
+        const CPUTVertexElementDesc &element = mesh.mpElements[ii];
+        if (element.mVertexElementSemantic == CPUT_VERTEX_ELEMENT_POSITON &&
+            element.mVertexElementType == eCPUT_VERTEX_ELEMENT_TYPE::tFLOAT && element.mElementSizeInBytes >= 3 * sizeof(float))
+        {
+            pPosition = &element;
+            break;
+        }
+    }
+    if (pPosition == NULL)
+    {
+        return 0.0f;
+    }
+    UINT *pIndices = mesh.mpIndices;
+
+    // Positions scaled into a unit box, so the weights don't depend on the model's units
+    std::vector<float3> positions(vertexCount);
+    float3 minimum(FLT_MAX), maximum(-FLT_MAX);
+    for (UINT vv = 0; vv < vertexCount; vv++)
+    {
+        float position[3];
+        memcpy(position, mesh.mpVertices + (size_t)vv * mesh.mStride + pPosition->mOffset, sizeof(position));
+        positions[vv] = float3(position[0], position[1], position[2]);
+        minimum = Min(minimum, positions[vv]);
+        maximum = Max(maximum, positions[vv]);
+    }
+    const float3 size = maximum - minimum;
+    const float extent = std::max(size.x, std::max(size.y, size.z));
+    if (extent <= 0.0f)
+    {
+        return 0.0f;
+    }
+    const float scale = 1.0f / extent;
+    for (UINT vv = 0; vv < vertexCount; vv++)
+    {
+        positions[vv] = (positions[vv] - minimum) * scale;
+    }
+
+    // Vertices at the same position: remap[] is the first of them, wedge[] links them in a ring.
+    // From here on the surface is made of these positions, the first vertex stands for them.
+    std::vector<UINT> remap(vertexCount), wedge(vertexCount);
+    {
+        std::vector<UINT> order(vertexCount);
+        for (UINT vv = 0; vv < vertexCount; vv++)
+        {
+            order[vv] = vv;
+        }
+        std::sort(order.begin(), order.end(), [&positions](UINT a, UINT b)
+        {
+            const float3 &pa = positions[a], &pb = positions[b];
+            if (pa.x != pb.x) return pa.x < pb.x;
+            if (pa.y != pb.y) return pa.y < pb.y;
+            if (pa.z != pb.z) return pa.z < pb.z;
+            return a < b;
+        });
+        for (UINT first = 0; first < vertexCount; )
+        {
+            UINT last = first + 1;
+            while (last < vertexCount && positions[order[last]] == positions[order[first]])
+            {
+                last++;
+            }
+            for (UINT ii = first; ii < last; ii++)
+            {
+                remap[order[ii]] = order[first];
+                wedge[order[ii]] = order[ii + 1 < last ? ii + 1 : first];
+            }
+            first = last;
+        }
+    }
+    std::vector<float> attributes;
+    const UINT attributeCount = DecodeAttributes(mesh, pPosition, &attributes);
+
+    // Open edges of the surface, a->b without b->a. openOut[a] and openIn[b] are the other end
+    // when there is exactly one, NO_VERTEX when there is none and the vertex itself when there
+    // are several. Only set for positions.
+    std::vector<UINT> fanOffsets, fan;
+    BuildAdjacency(pIndices, indexCount, vertexCount, &remap[0], &fanOffsets, &fan);
+    std::vector<UINT> openOut(vertexCount, NO_VERTEX), openIn(vertexCount, NO_VERTEX);
+    for (UINT a = 0; a < vertexCount; a++)
+    {
+        for (UINT ee = fanOffsets[a]; ee < fanOffsets[a + 1]; ee += 2)
+        {
+            const UINT b = fan[ee];
+            if (!HasEdge(fanOffsets, fan, b, a))
+            {
+                openOut[a] = (openOut[a] == NO_VERTEX) ? b : a;
+                openIn[b]  = (openIn[b] == NO_VERTEX) ? a : b;
+            }
+        }
+    }
+
+    // A position on one open border that passes through it once can move along it, one
+    // without open edges anywhere. The rest (edges with more than two triangles, borders
+    // touching at a point) stay.
+    std::vector<unsigned char> kind(vertexCount, KIND_LOCKED);
+    std::vector<UINT> loop(vertexCount, NO_VERTEX);
+    for (UINT vv = 0; vv < vertexCount; vv++)
+    {
+        const UINT in = openIn[vv], out = openOut[vv];
+        if (remap[vv] != vv)
+        {
+            continue;
+        }
+        if (in == NO_VERTEX && out == NO_VERTEX)
+        {
+            kind[vv] = KIND_MANIFOLD;
+        }
+        else if (in != NO_VERTEX && in != vv && out != NO_VERTEX && out != vv)
+        {
+            kind[vv] = KIND_BORDER;
+            loop[vv] = out;
+        }
+    }
+
+    // Triangle planes weighted by area. Edges that are open, by position (borders) or by
+    // vertex (attribute seams), add a plane through the edge at right angles to the triangle
+    // to hold them in place.
+    std::vector<UINT> edgeOffsets, edges;
+    BuildAdjacency(pIndices, indexCount, vertexCount, NULL, &edgeOffsets, &edges);
+    std::vector<Quadric> quadrics(vertexCount);
+    memset(&quadrics[0], 0, vertexCount * sizeof(Quadric));
+    for (UINT tt = 0; tt < indexCount; tt += 3)
+    {
+        const float3 &p0 = positions[pIndices[tt]];
+        float3 normal = cross3(positions[pIndices[tt + 1]] - p0, positions[pIndices[tt + 2]] - p0);
+        const float length = normal.length();
+        if (length == 0.0f)
+        {
+            continue;
+        }
+        normal = normal * (1.0f / length);
+        const float distance = -dot3(normal, p0);
+        for (UINT kk = 0; kk < 3; kk++)
+        {
+            AddPlane(&quadrics[remap[pIndices[tt + kk]]], normal, distance, 0.5f * length);
+        }
+        for (UINT kk = 0; kk < 3; kk++)
+        {
+            const UINT a = pIndices[tt + kk], b = pIndices[tt + (kk + 1) % 3];
+            if (HasEdge(edgeOffsets, edges, b, a))
+            {
+                continue;
+            }
+            const float3 edge = positions[b] - positions[a];
+            float3 edgeNormal = cross3(edge, normal);
+            const float edgeNormalLength = edgeNormal.length();
+            if (edgeNormalLength == 0.0f)
+            {
+                continue;
+            }
+            edgeNormal = edgeNormal * (1.0f / edgeNormalLength);
+            const bool border = !HasEdge(fanOffsets, fan, remap[b], remap[a]);
+            const float weight = dot3(edge, edge) * (border ? BORDER_EDGE_WEIGHT : SEAM_EDGE_WEIGHT);
+            const float edgeDistance = -dot3(edgeNormal, positions[a]);
+            AddPlane(&quadrics[remap[a]], edgeNormal, edgeDistance, weight);
+            AddPlane(&quadrics[remap[b]], edgeNormal, edgeDistance, weight);
+        }
+    }
+
+    // Passes of independent collapses, cheapest first, until the target or the error limit
+    const float maxErrorSquared = (maxError == FLT_MAX) ? FLT_MAX : (maxError * scale) * (maxError * scale);
+    float resultErrorSquared = 0.0f;
+    std::vector<UINT> collapseTo(vertexCount), vertexRemap(vertexCount);
+    std::vector<unsigned char> collapseLocked(vertexCount);
+    std::vector<Collapse> collapses;
+    for (bool first = true; indexCount > targetIndexCount; first = false)
+    {
+        if (!first)
+        {
+            BuildAdjacency(pIndices, indexCount, vertexCount, &remap[0], &fanOffsets, &fan);
+        }
+
+        collapses.clear();
+        for (UINT tt = 0; tt < indexCount; tt += 3)
+        {
+            for (UINT kk = 0; kk < 3; kk++)
+            {
+                const UINT r0 = remap[pIndices[tt + kk]], r1 = remap[pIndices[tt + (kk + 1) % 3]];
+                const unsigned char k0 = kind[r0], k1 = kind[r1];
+                const bool forward = CAN_COLLAPSE[k0][k1], backward = CAN_COLLAPSE[k1][k0];
+                if (r0 == r1 || (!forward && !backward))
+                {
+                    continue;
+                }
+                // an edge with triangles on both sides is seen twice, take it once
+                if (HAS_OPPOSITE[k0][k1] && r1 > r0)
+                {
+                    continue;
+                }
+                // border positions only move along the border
+                if (k0 == KIND_BORDER && k1 == KIND_BORDER && loop[r0] != r1)
+                {
+                    continue;
+                }
+                const float forwardError  = forward  ? QuadricError(quadrics[r0], positions[r1]) : FLT_MAX;
+                const float backwardError = backward ? QuadricError(quadrics[r1], positions[r0]) : FLT_MAX;
+                Collapse collapse;
+                collapse.mFrom  = forwardError <= backwardError ? r0 : r1;
+                collapse.mTo    = forwardError <= backwardError ? r1 : r0;
+                collapse.mError = std::min(forwardError, backwardError);
+                collapses.push_back(collapse);
+            }
+        }
+        if (collapses.empty())
+        {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end());
+
+        // an edge collapse takes two triangles with it, one on a border
+        const UINT triangleGoal = std::max(1u, (indexCount - targetIndexCount) / 3);
+        const UINT edgeGoal = triangleGoal / 2;
+        const float errorGoal = edgeGoal < collapses.size() ? collapses[edgeGoal].mError * PASS_ERROR_SLACK : FLT_MAX;
+
+        for (UINT vv = 0; vv < vertexCount; vv++)
+        {
+            collapseTo[vv] = vv;
+            vertexRemap[vv] = vv;
+        }
+        memset(&collapseLocked[0], 0, vertexCount);
+        UINT triangleCollapses = 0;
+        UINT collapseCount = 0;
+        for (size_t ii = 0; ii < collapses.size() && triangleCollapses < triangleGoal; ii++)
+        {
+            const Collapse &collapse = collapses[ii];
+            if (collapse.mError > maxErrorSquared || (collapse.mError > errorGoal && triangleCollapses > triangleGoal / 10))
+            {
+                break;
+            }
+            // one collapse per position and pass, the quadrics and fans are only right for those
+            const UINT from = collapse.mFrom, to = collapse.mTo;
+            if (collapseLocked[from] || collapseLocked[to] || FlipsTriangle(fanOffsets, fan, positions, collapseTo, from, to))
+            {
+                continue;
+            }
+
+            AddQuadric(&quadrics[to], quadrics[from]);
+            collapseTo[from] = to;
+
+            // Every vertex at the old position goes to the one at the new position with the
+            // closest attributes: across a seam each side finds its own
+            UINT source = from;
+            do
+            {
+                const float *pSource = attributeCount ? &attributes[(size_t)source * attributeCount] : NULL;
+                float bestDistance = FLT_MAX;
+                UINT target = to;
+                do
+                {
+                    const float *pTarget = attributeCount ? &attributes[(size_t)target * attributeCount] : NULL;
+                    float distance = 0.0f;
+                    for (UINT cc = 0; cc < attributeCount; cc++)
+                    {
+                        distance += (pSource[cc] - pTarget[cc]) * (pSource[cc] - pTarget[cc]);
+                    }
+                    if (distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        vertexRemap[source] = target;
+                    }
+                    target = wedge[target];
+                } while (target != to);
+                source = wedge[source];
+            } while (source != from);
+
+            collapseLocked[from] = 1;
+            collapseLocked[to] = 1;
+            triangleCollapses += (kind[from] == KIND_BORDER) ? 1 : 2;
+            resultErrorSquared = std::max(resultErrorSquared, collapse.mError);
+            collapseCount++;
+        }
+        if (collapseCount == 0)
+        {
+            break;
+        }
+
+        // A loop pointing at a position that went away follows it. When that position collapsed
+        // onto this one, the loop continues where its loop went.
+        for (UINT vv = 0; vv < vertexCount; vv++)
+        {
+            if (loop[vv] != NO_VERTEX)
+            {
+                const UINT next = collapseTo[loop[vv]];
+                const UINT after = loop[loop[vv]];
+                loop[vv] = (next != vv) ? next : (after != NO_VERTEX) ? collapseTo[after] : NO_VERTEX;
+            }
+        }
+
+        // Triangles that lost an edge are dropped
+        UINT written = 0;
+        for (UINT tt = 0; tt < indexCount; tt += 3)
+        {
+            const UINT a = vertexRemap[pIndices[tt]];
+            const UINT b = vertexRemap[pIndices[tt + 1]];
+            const UINT c = vertexRemap[pIndices[tt + 2]];
+            if (remap[a] != remap[b] && remap[b] != remap[c] && remap[c] != remap[a])
+            {
+                pIndices[written++] = a;
+                pIndices[written++] = b;
+                pIndices[written++] = c;
+            }
+        }
+        indexCount = written;
+    }
+
+    mesh.mIndexCount = indexCount;
+    CPUTMeshOptimizer::OptimizeVertexFetch(mesh);
+    return sqrtf(resultErrorSquared) * extent;
+}
@@ -22,6 +22,9 @@
 #include "CPUTBuffer.h"
 #include "CPUTCamera.h"
 #include "CPUTInputLayoutCache.h"
+#include "CPUTSceneCache.h"
+#include "CPUTMeshOptimizer.h"
+#include "CPUTLod.h"
 
 DrawModelCallBackFunc CPUTModel::mDrawModelCallBackFunc = CPUTModel::DrawModelCallBack;
 
@@ -49,6 +52,10 @@ CPUTModel::~CPUTModel()
         SAFE_RELEASE(mpMesh[ii]);
         HEAPCHECK;
     }
+    for (UINT ii = 0; ii < mLodMeshes.size(); ii++)
+    {
+        SAFE_RELEASE(mLodMeshes[ii]);
+    }
 
     SAFE_DELETE_ARRAY(mpMaterialCount);
     SAFE_DELETE_ARRAY(mpMaterial);
@@ -133,6 +140,9 @@ CPUTResult CPUTModel::LoadModel(CPUTConfigBlock *pBlock, int *pParentID, CPUTMod
 
     LoadParentMatrixFromParameterBlock(pBlock);
 
+    // Models that move every frame are kept out of cached static passes (see CPUTRenderNode::IsDynamic())
+    mIsDynamic = pBlock->GetValueByName("dynamic")->ValueAsBool();
+
     // Get the bounding box information
     float3 center(0.0f), half(0.0f);
     pBlock->GetValueByName("BoundingBoxCenter")->ValueAsFloatArray(center.f, 3);
@@ -156,12 +166,19 @@ CPUTResult CPUTModel::LoadModel(CPUTConfigBlock *pBlock, int *pParentID, CPUTMod
 
     if (pMasterModel)
     {
+        mpMesh = new CPUTMesh*[mMeshCount];
         for (int ii = 0; ii < mMeshCount; ii++)
         {
-            mpMesh = new CPUTMesh*[mMeshCount];
             // Reference the master model's mesh.  Don't create a new one.
             mpMesh[ii] = pMasterModel->mpMesh[ii];
             mpMesh[ii]->AddRef();
+            mpMesh[ii]->IncrementInstanceCount();
+        }
+        mLodCount = pMasterModel->mLodCount;
+        mLodMeshes = pMasterModel->mLodMeshes;
+        for (UINT ii = 0; ii < mLodMeshes.size(); ii++)
+        {
+            mLodMeshes[ii]->AddRef();
         }
     }
     else
@@ -170,6 +187,10 @@ CPUTResult CPUTModel::LoadModel(CPUTConfigBlock *pBlock, int *pParentID, CPUTMod
         // TODO: Change to use GetModel()
         result = LoadModelPayload(resolvedPathAndFile);
         ASSERT(CPUTSUCCESS(result), "Failed loading model");
+        if (CPUTSUCCESS(result))
+        {
+            LoadLodPayloads(resolvedPathAndFile);
+        }
     }
 
     mpMaterialCount = new int[mMeshCount];
@@ -236,16 +257,88 @@ CPUTResult CPUTModel::LoadModel(CPUTConfigBlock *pBlock, int *pParentID, CPUTMod
 
 //-----------------------------------------------------------------------------
 CPUTResult CPUTModel::LoadModelPayload(const std::string &FileName)
+{
+    std::vector<CPUTMesh*> pMeshVector;
+    CPUTResult result = LoadMeshes(FileName, &pMeshVector);
+    ASSERT( result != CPUT_ERROR_FILE_NOT_FOUND, "CPUTModel::LoadModelPayload() - Could not find binary model file: " + FileName );
+    if (CPUTFAILED(result))
+    {
+        return result;
+    }
+    if (mpMesh == NULL)
+    {        
+        mMeshCount = pMeshVector.size();
+        mpMesh = new CPUTMesh*[mMeshCount];
+
+    }
+    for (int i = 0; i < mMeshCount; i++)
+    {
+        mpMesh[i] = pMeshVector[i];
+    }
+    return result;
+}
+
+// Loads <model>_lod1.mdl, _lod2.mdl, ... up to the first one that is missing. A level
+// that doesn't have the model's meshes (e.g. left over from an older export) ends the list.
+//-----------------------------------------------------------------------------
+CPUTResult CPUTModel::LoadLodPayloads(const std::string &FileName)
+{
+    for (int lod = 1; lod < CPUT_MAX_LOD_COUNT; lod++)
+    {
+        std::string lodFileName = CPUTLodFileName(FileName, lod);
+        std::vector<CPUTMesh*> meshes;
+        CPUTResult result = LoadMeshes(lodFileName, &meshes);
+        if (CPUTSUCCESS(result) && (int)meshes.size() != mMeshCount)
+        {
+            DEBUG_PRINT("%s has %d meshes instead of %d, ignored\n", lodFileName.c_str(), (int)meshes.size(), mMeshCount);
+            result = CPUT_ERROR_INVALID_PARAMETER;
+        }
+        if (CPUTFAILED(result))
+        {
+            for (UINT ii = 0; ii < meshes.size(); ii++)
+            {
+                SAFE_RELEASE(meshes[ii]);
+            }
+            return result == CPUT_ERROR_FILE_NOT_FOUND ? CPUT_SUCCESS : result;
+        }
+        mLodMeshes.insert(mLodMeshes.end(), meshes.begin(), meshes.end());
+        mLodCount++;
+    }
+    return CPUT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+CPUTResult CPUTModel::LoadMeshes(const std::string &FileName, std::vector<CPUTMesh*> *pMeshes)
 {
     CPUTResult result = CPUT_SUCCESS;
 
-    CPUTFileSystem::CPUTOSifstream file(FileName, std::ios::in | std::ios::binary);
+    // Map the whole payload (or take it from the scene cache) and parse it
+    // from memory instead of issuing many small file reads.
+    const char *pPayload = NULL;
+    UINT payloadSize = 0;
+    CPUTFileSystem::CPUTFileView fileView;
+    CPUTSceneCache *pCache = CPUTSceneCache::GetActiveCache();
+    if (!pCache || !pCache->Find(CPUT_CACHE_MODEL, FileName, &pPayload, &payloadSize))
+    {
+        result = fileView.Open(FileName);
+        if (CPUTFAILED(result))
+        {
+            return result;
+        }
+        pPayload = fileView.GetData();
+        payloadSize = (UINT)fileView.GetSize();
+        if (pCache)
+        {
+            pCache->Add(CPUT_CACHE_MODEL, FileName, pPayload, payloadSize);
+        }
+    }
 
-    ASSERT( !file.fail(), "CPUTModel::LoadModelPayload() - Could not find binary model file: " + FileName );
+    CPUTFileSystem::CPUTmemifstream file(pPayload, payloadSize);
 
     // set up for mesh creation loop
     int meshIndex = 0;
-    std::vector<CPUTMesh*> pMeshVector;
+    std::vector<CPUTMesh*> &pMeshVector = *pMeshes;
+    const UINT optimizeFlags = CPUTMeshOptimizer::GetLoadFlags();
     while(file.good() && !file.eof())
     {
         // TODO: rearrange while() to avoid if(eof).  Should perform only one branch per loop iteration, not two
@@ -256,6 +349,10 @@ CPUTResult CPUTModel::LoadModelPayload(const std::string &FileName)
             // TODO: We check eof at the top of loop.  If it isn't eof there, why is it eof here?
             break;
         }
+        if (optimizeFlags != CPUT_MESH_OPTIMIZE_NONE)
+        {
+            CPUTMeshOptimizer::Optimize(vertexFormatDesc, optimizeFlags);
+        }
         if (!(meshIndex < mMeshCount))
         {
             DEBUG_PRINT("possibly unexpected number of meshes for model");
@@ -354,11 +451,21 @@ CPUTResult CPUTModel::LoadModelPayload(const std::string &FileName)
             }
         }
 
-        // Index buffer
+        // Index buffer. mpIndices is always 32 bit; 16 bit meshes are narrowed for DX11,
+        // the OpenGL mesh arena only packs 32 bit indices.
+        bool narrowIndices = false;
+#ifdef CPUT_FOR_DX11
+        narrowIndices = (vertexFormatDesc.mIndexType == eCPUT_VERTEX_ELEMENT_TYPE::tUINT16);
+#endif
+        std::vector<uint16_t> indices16;
+        if (narrowIndices)
+        {
+            indices16.assign(vertexFormatDesc.mpIndices, vertexFormatDesc.mpIndices + vertexFormatDesc.mIndexCount);
+        }
         CPUTBufferElementInfo indexDataInfo;
-        indexDataInfo.mElementType           = (vertexFormatDesc.mIndexType == eCPUT_VERTEX_ELEMENT_TYPE::tUINT32) ? CPUT_U32 : CPUT_U16;
+        indexDataInfo.mElementType           = narrowIndices ? CPUT_U16 : CPUT_U32;
         indexDataInfo.mElementComponentCount = 1;
-        indexDataInfo.mElementSizeInBytes    = (vertexFormatDesc.mIndexType == eCPUT_VERTEX_ELEMENT_TYPE::tUINT32) ? sizeof(uint32_t) : sizeof(uint16_t);
+        indexDataInfo.mElementSizeInBytes    = narrowIndices ? sizeof(uint16_t) : sizeof(uint32_t);
         indexDataInfo.mOffset                = 0;
         indexDataInfo.mSemanticIndex         = 0;
         indexDataInfo.mpSemanticName         = NULL;
@@ -374,10 +481,16 @@ CPUTResult CPUTModel::LoadModelPayload(const std::string &FileName)
                 (void*)vertexFormatDesc.mpVertices,
                 &indexDataInfo,
                 vertexFormatDesc.mIndexCount,
-                vertexFormatDesc.mpIndices
+                indices16.empty() ? (void*)vertexFormatDesc.mpIndices : (void*)&indices16[0]
             );
             if(CPUTFAILED(result))
             {
+                delete [] pVertexElementInfo;
+                for (UINT ii = 0; ii < pMeshVector.size(); ii++)
+                {
+                    SAFE_RELEASE(pMeshVector[ii]);
+                }
+                pMeshVector.clear();
                 return result;
             }
         }
@@ -387,18 +500,9 @@ CPUTResult CPUTModel::LoadModelPayload(const std::string &FileName)
     }
     ASSERT( file.eof(), "" );
 
-    if (mpMesh == NULL)
-    {        
-        mMeshCount = pMeshVector.size();
-        mpMesh = new CPUTMesh*[mMeshCount];
-
-    }
-    for (int i = 0; i < mMeshCount; i++)
-    {
-        mpMesh[i] = pMeshVector[i];
-    }
     // close file
     file.close();
+    fileView.Close();
     
     return result;
 }
@@ -431,6 +535,30 @@ void CPUTModel::SetMaterial(UINT ii, CPUTMaterial **pMaterial, int numMaterials)
     mpMaterialCount[ii] = numMaterials;
 } 
 
+//-----------------------------------------------------------------------------
+bool CPUTModel::SharesMeshesAndMaterials(const CPUTModel *pOther) const
+{
+    if (mMeshCount != pOther->mMeshCount || mLodMeshes != pOther->mLodMeshes)
+    {
+        return false;
+    }
+    for (int ii = 0; ii < mMeshCount; ii++)
+    {
+        if (mpMesh[ii] != pOther->mpMesh[ii] || mpMaterialCount[ii] != pOther->mpMaterialCount[ii])
+        {
+            return false;
+        }
+        for (int jj = 0; jj < mpMaterialCount[ii]; jj++)
+        {
+            if (mpMaterial[ii][jj] != pOther->mpMaterial[ii][jj])
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 CPUTMaterial* CPUTModel::GetMaterial(int meshIndex, int materialIndex) {
     if (meshIndex < mMeshCount && materialIndex < mpMaterialCount[meshIndex] && mpMaterial[meshIndex][materialIndex] != NULL)
     {
@@ -542,8 +670,30 @@ void CPUTModel::UpdateShaderConstants(CPUTRenderParameters &renderParams)
     }
 }
 
+//-----------------------------------------------------------------------------
+void CPUTModel::SelectLod(CPUTCamera *pCamera, float lodScale)
+{
+    if (mLodCount <= 1)
+    {
+        return;
+    }
+    UpdateBoundsWorldSpace();
+    float screenSize = CPUTLodScreenSize(mBoundingBoxCenterWorldSpace, mBoundingBoxHalfWorldSpace.length(),
+                                         pCamera->GetPositionWS(), *pCamera->GetProjectionMatrix());
+    int lod = CPUTLodSelect(screenSize, mLod, mLodCount, lodScale);
+    if (lod != mLod && !IsDynamic())
+    {
+        sStaticSceneVersion++;
+    }
+    mLod = lod;
+}
+
 void CPUTModel::Render(CPUTRenderParameters &renderParams, int materialIndex)
 {
+    if (!renderParams.DrawsNode(IsDynamic()))
+    {
+        return;
+    }
     CPUTCamera* pCamera = renderParams.mpCamera;
     UpdateBoundsWorldSpace();
     if (renderParams.mDrawModels && !renderParams.mRenderOnlyVisibleModels || !pCamera || pCamera->mFrustum.IsVisible(mBoundingBoxCenterWorldSpace, mBoundingBoxHalfWorldSpace))
@@ -555,7 +705,8 @@ void CPUTModel::Render(CPUTRenderParameters &renderParams, int materialIndex)
             if (materialIndex < mpMaterialCount[ii])
             {
                 CPUTMaterial* pMaterial = mpMaterial[ii][materialIndex];
-                mDrawModelCallBackFunc(this, renderParams, mpMesh[ii], pMaterial, NULL, NULL);
+                mDrawModelCallBackFunc(this, renderParams, GetLodMesh(ii), pMaterial, NULL, NULL);
+                renderParams.mDrawCount++;
             }
         }
     }
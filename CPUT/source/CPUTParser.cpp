@@ -15,29 +15,156 @@
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "CPUTParser.h"
-#include <vector>
-#include <sstream>
+#include <algorithm>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 
 //
 // The Command Parser class will retrieve values from a string and store them internally.
 // An application can then query for different parameters. All of the query functions are
-// guaranteed to not modify the return variable if the parameter was not found.
+// guaranteed to not modify the return variable if the parameter was not found, or if its
+// value isn't a valid number of the type asked for.
+//
+// Parsing makes one pass over the words of the command line. The text is copied once into
+// mText, where the names and values stay; mParameters only holds offsets, sorted by name so
+// a query is a binary search. Numbers are converted straight from that text.
 //
 
+// Whole value or nothing, unlike a stringstream "12abc" isn't 12
+//-----------------------------------------------------------------------------
+static bool ParseInt(const char *pValue, size_t length, int *pOut)
+{
+    if (length == 0)
+    {
+        return false;
+    }
+    char *pEnd;
+    errno = 0;
+    long value = strtol(pValue, &pEnd, 10);
+    if (pEnd != pValue + length || errno == ERANGE || value < INT_MIN || value > INT_MAX)
+    {
+        return false;
+    }
+    *pOut = (int)value;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+static bool ParseUInt(const char *pValue, size_t length, unsigned int *pOut)
+{
+    // strtoul() would quietly wrap negative numbers around
+    if (length == 0 || pValue[0] == '-')
+    {
+        return false;
+    }
+    char *pEnd;
+    errno = 0;
+    unsigned long value = strtoul(pValue, &pEnd, 10);
+    if (pEnd != pValue + length || errno == ERANGE || value > UINT_MAX)
+    {
+        return false;
+    }
+    *pOut = (unsigned int)value;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+static bool ParseDouble(const char *pValue, size_t length, double *pOut)
+{
+    if (length == 0)
+    {
+        return false;
+    }
+    char *pEnd;
+    errno = 0;
+    double value = strtod(pValue, &pEnd);
+    if (pEnd != pValue + length || errno == ERANGE)
+    {
+        return false;
+    }
+    *pOut = value;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+static bool ParseFlag(const char *pValue, size_t length, bool *pOut)
+{
+    if (length == 0 || !strcmp(pValue, "true") || !strcmp(pValue, "1"))
+    {
+        *pOut = true;
+        return true;
+    }
+    if (!strcmp(pValue, "false") || !strcmp(pValue, "0"))
+    {
+        *pOut = false;
+        return true;
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+CommandOption CommandOption::Flag(const char *pName, bool *pValue)
+{
+    CommandOption option = { pName, CPUT_COMMAND_OPTION_FLAG, pValue, 0.0, 0.0 };
+    return option;
+}
+
+//-----------------------------------------------------------------------------
+CommandOption CommandOption::Int(const char *pName, int *pValue, int minValue, int maxValue)
+{
+    CommandOption option = { pName, CPUT_COMMAND_OPTION_INT, pValue, (double)minValue, (double)maxValue };
+    return option;
+}
+
+//-----------------------------------------------------------------------------
+CommandOption CommandOption::UInt(const char *pName, unsigned int *pValue, unsigned int minValue, unsigned int maxValue)
+{
+    CommandOption option = { pName, CPUT_COMMAND_OPTION_UINT, pValue, (double)minValue, (double)maxValue };
+    return option;
+}
+
+//-----------------------------------------------------------------------------
+CommandOption CommandOption::Double(const char *pName, double *pValue, double minValue, double maxValue)
+{
+    CommandOption option = { pName, CPUT_COMMAND_OPTION_DOUBLE, pValue, minValue, maxValue };
+    return option;
+}
+
+//-----------------------------------------------------------------------------
+CommandOption CommandOption::String(const char *pName, std::string *pValue)
+{
+    CommandOption option = { pName, CPUT_COMMAND_OPTION_STRING, pValue, 0.0, 0.0 };
+    return option;
+}
+
 CommandParser::~CommandParser()
 {
     CleanConfigurationOptions();
 }
 
-void CommandParser::ParseConfigurationOptions(int argc, char **argv, std::string delimiter)
+//
+// Every argument that starts with the delimiter begins a parameter, the ones that don't are
+// added to the value of the one before (with a space), or before the first parameter make
+// up "default". So -scene:a.scene and -scene a.scene are the same. A value may hold the
+// delimiter, e.g. -scene:C:/my-scenes/a.scene.
+//
+void CommandParser::ParseConfigurationOptions(int argc, char **argv, const std::string &delimiter)
 {
-    std::string commandLine;
+    CleanConfigurationOptions();
+    mDelimiter = delimiter;
+
+    size_t length = 0;
     for (int i = 0; i < argc; i++) {
-        commandLine.append(argv[i]);
-        commandLine.append(" ");
+        length += strlen(argv[i]) + 1;
     }
+    mText.reserve(length + sizeof("default:"));
 
-    ParseConfigurationOptions(commandLine, delimiter);
+    for (int i = 0; i < argc; i++) {
+        AppendWord(argv[i], strlen(argv[i]));
+    }
+    EndParameter();
+    SortParameters();
 }
 
 //
@@ -45,160 +172,281 @@ void CommandParser::ParseConfigurationOptions(int argc, char **argv, std::string
 // options stored in the configuration list.
 // Arguments need to be like this:
 // <something.exe> --arg1:val1 --arg2:val2
-void CommandParser::ParseConfigurationOptions(std::string arguments, std::string delimiter)
+// The string is split into words at spaces and tabs, then read like argv above, so runs of
+// spaces inside a value become one.
+void CommandParser::ParseConfigurationOptions(const std::string &arguments, const std::string &delimiter)
 {
     CleanConfigurationOptions();
-
-    std::vector<std::string> argumentList;
-
-    size_t pos;
-    size_t nextPos = arguments.find(delimiter.c_str(), 0);
-    if (nextPos > 0) {
-        AddParameter("default", arguments.substr(0, nextPos));
-    }
-
-    //
-    // Break out parameters from command line
-    //
-    while (nextPos != std::string::npos) {
-        pos = nextPos + delimiter.length();
-        nextPos = arguments.find(delimiter.c_str(), pos);
-        argumentList.push_back(arguments.substr(pos, nextPos - pos));
-    }
-
-    //
-    // Remove leading spaces from arguments.
-    //
-    for (std::vector<std::string>::iterator it = argumentList.begin(); it != argumentList.end(); it++) {
-        std::string::size_type pos = it->find_first_not_of(' ');
-        if (pos != std::string::npos) {
-            it->erase(0, pos);
+    mDelimiter = delimiter;
+    mText.reserve(arguments.size() + sizeof("default:"));
+
+    const char *pText = arguments.c_str();
+    const char *pEnd = pText + arguments.size();
+    while (pText < pEnd) {
+        while (pText < pEnd && (*pText == ' ' || *pText == '\t')) {
+            pText++;
         }
-    }
-
-    //
-    // Remove trailing spaces from arguments
-    //
-    for (std::vector<std::string>::iterator it = argumentList.begin(); it != argumentList.end(); it++) {
-        std::string::size_type pos = it->find_last_not_of(' ');
-        if (pos != std::string::npos) {
-            it->erase(pos + 1);
+        const char *pWord = pText;
+        while (pText < pEnd && *pText != ' ' && *pText != '\t') {
+            pText++;
         }
-    }
-
-    //
-    // Split the values from the parameter name
-    //
-    std::string arg;
-    for (std::vector<std::string>::iterator it = argumentList.begin(); it != argumentList.end(); it++) {
-        arg = *it;
-        pos = arg.find_first_of(":", 0);
-        if (pos != std::string::npos) {
-            m_Arguments.insert(std::make_pair(arg.substr(0, pos), arg.substr(pos + 1, std::string::npos)));
-        } else {
-            m_Arguments.insert(std::make_pair(arg.substr(0, pos), ""));
+        if (pText > pWord) {
+            AppendWord(pWord, pText - pWord);
         }
     }
-
-    return;
+    EndParameter();
+    SortParameters();
 }
 
 void CommandParser::CleanConfigurationOptions(void)
 {
-    m_Arguments.clear();
+    mText.clear();
+    mParameters.clear();
+    mInParameter = false;
 
     return;
 }
 
-bool CommandParser::GetParameter(std::string arg)
+// Starts a parameter with the raw "name:value" text, EndParameter() splits it
+void CommandParser::BeginParameter(const char *pWord, size_t length)
 {
-    std::map<std::string, std::string>::iterator it;
+    EndParameter();
+    Parameter parameter = { mText.size(), 0, 0 };
+    mParameters.push_back(parameter);
+    mText.insert(mText.end(), pWord, pWord + length);
+    mInParameter = true;
+}
 
-    it = m_Arguments.find(arg);
-    if (it == m_Arguments.end())
-        return false;
+void CommandParser::AppendWord(const char *pWord, size_t length)
+{
+    const size_t delimiterLength = mDelimiter.length();
+    // a negative number after a name, as in -offset -2, is its value and not a parameter
+    const bool isNumber = mInParameter && length > delimiterLength &&
+        ((pWord[delimiterLength] >= '0' && pWord[delimiterLength] <= '9') || pWord[delimiterLength] == '.');
+    if (delimiterLength > 0 && length >= delimiterLength && !memcmp(pWord, mDelimiter.c_str(), delimiterLength) && !isNumber) {
+        // --name is the same as -name, a delimiter on its own is ignored
+        while (length >= delimiterLength && !memcmp(pWord, mDelimiter.c_str(), delimiterLength)) {
+            pWord += delimiterLength;
+            length -= delimiterLength;
+        }
+        if (length > 0) {
+            BeginParameter(pWord, length);
+        }
+        return;
+    }
 
-    return true;
+    if (!mInParameter) {
+        BeginParameter("default:", strlen("default:"));
+    } else {
+        mText.push_back(' ');
+    }
+    mText.insert(mText.end(), pWord, pWord + length);
 }
 
-bool CommandParser::GetParameter(std::string arg, int *pOut)
+// Splits the text of the parameter being read at the first ':', or at the space AppendWord()
+// put after the name when the value came as the next word, and NUL terminates both halves
+void CommandParser::EndParameter()
 {
-    std::map<std::string, std::string>::iterator it;
-    std::stringstream ss;
-
-    it = m_Arguments.find(arg);
-    if (it == m_Arguments.end())
-        return false;
+    if (!mInParameter) {
+        return;
+    }
+    mInParameter = false;
 
-    ss << it->second;
-    ss >> *pOut;
+    Parameter &parameter = mParameters.back();
+    const size_t end = mText.size();
+    size_t split = parameter.mName;
+    while (split < end && mText[split] != ':' && mText[split] != ' ') {
+        split++;
+    }
+    if (split == end) {
+        parameter.mValue = end;
+        parameter.mValueLength = 0;
+    } else {
+        mText[split] = '\0';
+        size_t value = split + 1;
+        while (value < end && mText[value] == ' ') {
+            value++;
+        }
+        parameter.mValue = value;
+        parameter.mValueLength = end - value;
+    }
+    mText.push_back('\0');
 
-    return true;
+    if (mText[parameter.mName] == '\0') {
+        // ":value" has no name to look it up by
+        mParameters.pop_back();
+    }
 }
 
-bool CommandParser::GetParameter(std::string arg, double *pOut)
+void CommandParser::SortParameters()
 {
-    std::map<std::string, std::string>::iterator it;
-    std::stringstream ss;
-
-    it = m_Arguments.find(arg);
-    if (it == m_Arguments.end())
-        return false;
+    const char *pText = mText.empty() ? NULL : &mText[0];
+    std::stable_sort(mParameters.begin(), mParameters.end(), [pText](const Parameter &a, const Parameter &b) {
+        return strcmp(pText + a.mName, pText + b.mName) < 0;
+    });
+}
 
-    ss << it->second;
-    ss >> *pOut;
+const char *CommandParser::FindValue(const std::string &arg, size_t *pLength) const
+{
+    if (mParameters.empty()) {
+        return NULL;
+    }
+    // lower bound by hand, std::lower_bound() in debug builds of VS2013 also compares the
+    // other way around, which a name can't be with a Parameter
+    const char *pText = &mText[0];
+    const char *pArg = arg.c_str();
+    size_t first = 0;
+    size_t count = mParameters.size();
+    while (count > 0) {
+        size_t half = count / 2;
+        if (strcmp(pText + mParameters[first + half].mName, pArg) < 0) {
+            first += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    if (first == mParameters.size() || strcmp(pText + mParameters[first].mName, pArg) != 0)
+        return NULL;
 
-    return true;
+    *pLength = mParameters[first].mValueLength;
+    return pText + mParameters[first].mValue;
 }
 
-bool CommandParser::GetParameter(std::string arg, unsigned int *pOut)
+bool CommandParser::GetParameter(const std::string &arg)
 {
-    std::map<std::string, std::string>::iterator it;
-    std::stringstream ss;
-
-    it = m_Arguments.find(arg);
-    if (it == m_Arguments.end())
-        return false;
+    size_t length;
+    return FindValue(arg, &length) != NULL;
+}
 
-    ss << it->second;
-    ss >> *pOut;
+bool CommandParser::GetParameter(const std::string &arg, int *pOut)
+{
+    size_t length;
+    const char *pValue = FindValue(arg, &length);
+    return pValue && ParseInt(pValue, length, pOut);
+}
 
-    return true;
+bool CommandParser::GetParameter(const std::string &arg, double *pOut)
+{
+    size_t length;
+    const char *pValue = FindValue(arg, &length);
+    return pValue && ParseDouble(pValue, length, pOut);
 }
 
-bool CommandParser::GetParameter(std::string arg, std::string *pOut)
+bool CommandParser::GetParameter(const std::string &arg, unsigned int *pOut)
 {
-    std::map<std::string, std::string>::iterator it;
-    std::stringstream ss;
+    size_t length;
+    const char *pValue = FindValue(arg, &length);
+    return pValue && ParseUInt(pValue, length, pOut);
+}
 
-    it = m_Arguments.find(arg);
-    if (it == m_Arguments.end())
+bool CommandParser::GetParameter(const std::string &arg, std::string *pOut)
+{
+    size_t length;
+    const char *pValue = FindValue(arg, &length);
+    if (!pValue)
         return false;
 
-    ss << it->second;
-    *pOut = ss.str();
+    pOut->assign(pValue, length);
 
     return true;
 }
 
 // buffer pointed to by pOut must be large enough for data
-bool CommandParser::GetParameter(std::string arg, char *pOut)
+bool CommandParser::GetParameter(const std::string &arg, char *pOut)
 {
-    std::map<std::string, std::string>::iterator it;
-    std::stringstream ss;
-
-    it = m_Arguments.find(arg);
-    if (it == m_Arguments.end())
+    size_t length;
+    const char *pValue = FindValue(arg, &length);
+    if (!pValue)
         return false;
 
-    ss << it->second;
-
-    ss >> pOut;
+    memcpy(pOut, pValue, length + 1);
 
     return true;
 }
 
-void CommandParser::AddParameter(std::string paramName, std::string paramValue)
+void CommandParser::AddParameter(const std::string &paramName, const std::string &paramValue)
 {
-    m_Arguments.insert(std::make_pair(paramName, paramValue));
+    EndParameter();
+    Parameter parameter = { mText.size(), 0, paramValue.size() };
+    mText.insert(mText.end(), paramName.begin(), paramName.end());
+    mText.push_back('\0');
+    parameter.mValue = mText.size();
+    mText.insert(mText.end(), paramValue.begin(), paramValue.end());
+    mText.push_back('\0');
+
+    // after any of the same name, so the first one added still wins
+    const char *pText = &mText[0];
+    std::vector<Parameter>::iterator it = std::upper_bound(mParameters.begin(), mParameters.end(), parameter, [pText](const Parameter &a, const Parameter &b) {
+        return strcmp(pText + a.mName, pText + b.mName) < 0;
+    });
+    mParameters.insert(it, parameter);
+}
+
+bool CommandParser::ApplyOptions(const CommandOption *pOptions, int optionCount, std::string *pErrors)
+{
+    bool valid = true;
+    for (int i = 0; i < optionCount; i++) {
+        const CommandOption &option = pOptions[i];
+        size_t length;
+        const char *pValue = FindValue(option.mpName, &length);
+        if (!pValue)
+            continue;
+
+        bool parsed = false;
+        switch (option.mType) {
+        case CPUT_COMMAND_OPTION_FLAG:
+            parsed = ParseFlag(pValue, length, (bool *)option.mpValue);
+            break;
+        case CPUT_COMMAND_OPTION_INT: {
+            int value;
+            parsed = ParseInt(pValue, length, &value) && value >= option.mMin && value <= option.mMax;
+            if (parsed)
+                *(int *)option.mpValue = value;
+            break;
+        }
+        case CPUT_COMMAND_OPTION_UINT: {
+            unsigned int value;
+            parsed = ParseUInt(pValue, length, &value) && value >= option.mMin && value <= option.mMax;
+            if (parsed)
+                *(unsigned int *)option.mpValue = value;
+            break;
+        }
+        case CPUT_COMMAND_OPTION_DOUBLE: {
+            double value;
+            parsed = ParseDouble(pValue, length, &value) && value >= option.mMin && value <= option.mMax;
+            if (parsed)
+                *(double *)option.mpValue = value;
+            break;
+        }
+        case CPUT_COMMAND_OPTION_STRING:
+            ((std::string *)option.mpValue)->assign(pValue, length);
+            parsed = true;
+            break;
+        }
+
+        if (!parsed) {
+            valid = false;
+            if (pErrors)
+                pErrors->append("invalid value '" + std::string(pValue, length) + "' for " + mDelimiter + option.mpName + "\n");
+        }
+    }
+
+    // parameters nobody asked for are most likely typos
+    for (size_t i = 0; i < mParameters.size(); i++) {
+        const char *pName = &mText[mParameters[i].mName];
+        if (!strcmp(pName, "default"))
+            continue;
+
+        int j = 0;
+        while (j < optionCount && strcmp(pOptions[j].mpName, pName) != 0)
+            j++;
+        if (j == optionCount) {
+            valid = false;
+            if (pErrors)
+                pErrors->append("unknown parameter " + mDelimiter + pName + "\n");
+        }
+    }
+
+    return valid;
 }
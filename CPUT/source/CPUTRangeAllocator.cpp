@@ -0,0 +1,124 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "CPUTRangeAllocator.h"
+
+//-----------------------------------------------------------------------------
+CPUTRangeAllocator::CPUTRangeAllocator(UINT capacity)
+    : mCapacity(capacity),
+      mFreeCount(capacity)
+{
+    if (capacity > 0)
+    {
+        mFreeBlocks[0] = capacity;
+    }
+}
+
+//-----------------------------------------------------------------------------
+UINT CPUTRangeAllocator::Allocate(UINT count)
+{
+    if (0 == count || count > mFreeCount)
+    {
+        return INVALID_OFFSET;
+    }
+
+    // Best fit, an exact fit ends the search early
+    std::map<UINT, UINT>::iterator best = mFreeBlocks.end();
+    for (std::map<UINT, UINT>::iterator it = mFreeBlocks.begin(); it != mFreeBlocks.end(); ++it)
+    {
+        if (it->second >= count && (best == mFreeBlocks.end() || it->second < best->second))
+        {
+            best = it;
+            if (it->second == count)
+            {
+                break;
+            }
+        }
+    }
+    if (best == mFreeBlocks.end())
+    {
+        return INVALID_OFFSET;
+    }
+
+    UINT offset    = best->first;
+    UINT remaining = best->second - count;
+    mFreeBlocks.erase(best);
+    if (remaining > 0)
+    {
+        mFreeBlocks[offset + count] = remaining;
+    }
+    mFreeCount -= count;
+    return offset;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTRangeAllocator::Free(UINT offset, UINT count)
+{
+    if (0 == count)
+    {
+        return;
+    }
+    ASSERT(offset < mCapacity && count <= mCapacity - offset, "CPUTRangeAllocator: freeing a range outside the allocator");
+
+    std::map<UINT, UINT>::iterator next = mFreeBlocks.lower_bound(offset);
+    ASSERT(next == mFreeBlocks.end() || offset + count <= next->first, "CPUTRangeAllocator: freeing a range that is already free");
+
+    // Merge with the block that ends where this one starts
+    if (next != mFreeBlocks.begin())
+    {
+        std::map<UINT, UINT>::iterator prev = next;
+        --prev;
+        ASSERT(prev->first + prev->second <= offset, "CPUTRangeAllocator: freeing a range that is already free");
+        if (prev->first + prev->second == offset)
+        {
+            offset = prev->first;
+            count += prev->second;
+            mFreeCount -= prev->second; // added back below
+            mFreeBlocks.erase(prev);
+        }
+    }
+
+    // And with the one that starts where it ends
+    if (next != mFreeBlocks.end() && next->first == offset + count)
+    {
+        count += next->second;
+        mFreeCount -= next->second;
+        mFreeBlocks.erase(next);
+    }
+
+    mFreeBlocks[offset] = count;
+    mFreeCount += count;
+}
+
+//-----------------------------------------------------------------------------
+UINT CPUTRangeAllocator::GetLargestFreeBlock() const
+{
+    UINT largest = 0;
+    for (std::map<UINT, UINT>::const_iterator it = mFreeBlocks.begin(); it != mFreeBlocks.end(); ++it)
+    {
+        largest = (it->second > largest) ? it->second : largest;
+    }
+    return largest;
+}
+
+//-----------------------------------------------------------------------------
+float CPUTRangeAllocator::GetFragmentation() const
+{
+    if (0 == mFreeCount)
+    {
+        return 0.0f;
+    }
+    return 1.0f - (float)GetLargestFreeBlock() / (float)mFreeCount;
+}
@@ -0,0 +1,142 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// Reading and writing the meshes in a .mdl file. Kept apart from CPUTMesh.cpp, which
+// creates the API's mesh, so tools such as MeshCook can use it without a device.
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "CPUTMesh.h"
+
+//-----------------------------------------------------------------------------
+void CPUTVertexElementDesc::Read(CPUTFileSystem::iCPUTifstream &meshFile)
+{
+    meshFile.read((char*)this, sizeof(*this));
+}
+
+//-----------------------------------------------------------------------------
+void CPUTRawMeshData::Allocate(uint32_t numElements)
+{
+    mVertexCount = numElements;
+    mStride += mPaddingSize; // TODO: move this to stride computation
+    mTotalVerticesSizeInBytes = mVertexCount * mStride;
+    mpVertices = new char[(UINT)mTotalVerticesSizeInBytes];
+    memset( mpVertices, 0, (size_t)mTotalVerticesSizeInBytes );
+}
+
+//-----------------------------------------------------------------------------
+bool CPUTRawMeshData::Read(CPUTFileSystem::iCPUTifstream &modelFile)
+{
+    uint32_t magicCookie;
+    modelFile.read((char*)&magicCookie,sizeof(magicCookie));
+    if( !modelFile.good() ) return false; // TODO: Yuck!  Why do we need to get here to figure out we're done?
+
+    ASSERT( magicCookie == 1234, "Invalid model file." );
+
+    modelFile.read((char*)&mStride,                   sizeof(mStride));
+    modelFile.read((char*)&mPaddingSize,              sizeof(mPaddingSize)); // DWM TODO: What is this?
+    modelFile.read((char*)&mTotalVerticesSizeInBytes, sizeof(mTotalVerticesSizeInBytes));
+    modelFile.read((char*)&mVertexCount,              sizeof(mVertexCount));
+    modelFile.read((char*)&mTopology,                 sizeof(mTopology));
+    modelFile.read((char*)&mBboxCenter,               sizeof(mBboxCenter));
+    modelFile.read((char*)&mBboxHalf,                 sizeof(mBboxHalf));
+
+    // read  format descriptors
+    modelFile.read((char*)&mFormatDescriptorCount, sizeof(mFormatDescriptorCount));
+    ASSERT( modelFile.good(), "Model file bad"  );
+
+    mpElements = new CPUTVertexElementDesc[mFormatDescriptorCount];
+    for( UINT ii=0; ii<mFormatDescriptorCount; ++ii )
+    {
+        mpElements[ii].Read(modelFile);
+    }
+    modelFile.read((char*)&mIndexCount, sizeof(mIndexCount));
+    modelFile.read((char*)&mIndexType, sizeof(mIndexType));
+    ASSERT( modelFile.good(), "Bad model file(1)."  );
+
+    mpIndices = new UINT[mIndexCount];
+    if( mIndexCount != 0 )
+    {
+        if( mIndexType == eCPUT_VERTEX_ELEMENT_TYPE::tUINT16 )
+        {
+            // Written by MeshCook when the mesh has few enough vertices. Widened here, so
+            // mpIndices is always 32 bit; mIndexType still says what to upload.
+            std::vector<uint16_t> indices16(mIndexCount);
+            modelFile.read((char*)&indices16[0], mIndexCount * sizeof(uint16_t));
+            std::copy(indices16.begin(), indices16.end(), mpIndices);
+        }
+        else
+        {
+            modelFile.read((char*)mpIndices, mIndexCount * sizeof(UINT));
+        }
+    }
+    modelFile.read((char*)&magicCookie, sizeof(magicCookie));
+    ASSERT( magicCookie == 1234, "Model file missing magic cookie." );
+    ASSERT( modelFile.good(),    "Bad model file(2)." );
+
+    if ( 0 != mTotalVerticesSizeInBytes )
+    {
+        Allocate(mVertexCount);  // recalculates some things
+        modelFile.read(mpVertices, mTotalVerticesSizeInBytes);
+    }
+    modelFile.read((char*)&magicCookie, sizeof(magicCookie));
+    ASSERT( modelFile.good() && magicCookie == 1234, "Bad model file(3)." );
+
+    return modelFile.good();
+}
+
+//-----------------------------------------------------------------------------
+static void AppendBytes(std::vector<char> *pOutput, const void *pData, size_t size)
+{
+    const char *pBytes = (const char*)pData;
+    pOutput->insert(pOutput->end(), pBytes, pBytes + size);
+}
+
+// Appends the mesh the way Read() expects it, so a .mdl is these back to back
+//-----------------------------------------------------------------------------
+void CPUTRawMeshData::Write(std::vector<char> *pOutput) const
+{
+    const uint32_t magicCookie = 1234;
+    const UINT fileStride = mStride - mPaddingSize; // Allocate() adds the padding back
+    AppendBytes(pOutput, &magicCookie,               sizeof(magicCookie));
+    AppendBytes(pOutput, &fileStride,                sizeof(fileStride));
+    AppendBytes(pOutput, &mPaddingSize,              sizeof(mPaddingSize));
+    AppendBytes(pOutput, &mTotalVerticesSizeInBytes, sizeof(mTotalVerticesSizeInBytes));
+    AppendBytes(pOutput, &mVertexCount,              sizeof(mVertexCount));
+    AppendBytes(pOutput, &mTopology,                 sizeof(mTopology));
+    AppendBytes(pOutput, &mBboxCenter,               sizeof(mBboxCenter));
+    AppendBytes(pOutput, &mBboxHalf,                 sizeof(mBboxHalf));
+
+    AppendBytes(pOutput, &mFormatDescriptorCount, sizeof(mFormatDescriptorCount));
+    AppendBytes(pOutput, mpElements, mFormatDescriptorCount * sizeof(CPUTVertexElementDesc));
+    AppendBytes(pOutput, &mIndexCount, sizeof(mIndexCount));
+    AppendBytes(pOutput, &mIndexType,  sizeof(mIndexType));
+    if( mIndexType == eCPUT_VERTEX_ELEMENT_TYPE::tUINT16 )
+    {
+        ASSERT( mVertexCount <= 0x10000, "Too many vertices for 16 bit indices" );
+        std::vector<uint16_t> indices16(mpIndices, mpIndices + mIndexCount);
+        AppendBytes(pOutput, indices16.empty() ? NULL : &indices16[0], mIndexCount * sizeof(uint16_t));
+    }
+    else
+    {
+        AppendBytes(pOutput, mpIndices, mIndexCount * sizeof(UINT));
+    }
+    AppendBytes(pOutput, &magicCookie, sizeof(magicCookie));
+
+    AppendBytes(pOutput, mpVertices, (size_t)mTotalVerticesSizeInBytes);
+    AppendBytes(pOutput, &magicCookie, sizeof(magicCookie));
+}
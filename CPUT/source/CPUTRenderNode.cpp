@@ -18,6 +18,7 @@
 
 #include "CPUTOSServices.h" // for OutputDebugString();
 
+UINT CPUTRenderNode::sStaticSceneVersion = 0;
 
 // Constructor
 //-----------------------------------------------------------------------------
@@ -25,6 +26,7 @@ CPUTRenderNode::CPUTRenderNode():
     mpParent(NULL),
     mpChild(NULL),
     mpSibling(NULL),
+    mIsDynamic(false),
     mAnimationTime(0.0f),
     mPlaybackSpeed(1.0f),
     mpCurrentNodeAnimation(NULL),
@@ -200,20 +202,20 @@ float4x4 CPUTRenderNode::GetParentsWorldMatrix()
 }
 
 // Recursively visit all sub-nodes in breadth-first mode and mark their
-// cumulative transforms as dirty
+// cumulative transforms as dirty. Siblings don't depend on this node's
+// transform, so they are left alone.
 //-----------------------------------------------------------------------------
 void CPUTRenderNode::MarkDirty()
 {
     mWorldMatrixDirty = true;
-
-    if(mpSibling)
+    if(IsModel() && !IsDynamic())
     {
-        mpSibling->MarkDirty();
+        sStaticSceneVersion++;
     }
 
-    if(mpChild)
+    for(CPUTRenderNode *pChild = mpChild; pChild; pChild = pChild->mpSibling)
     {
-        mpChild->MarkDirty();
+        pChild->MarkDirty();
     }
 }
 
@@ -16,9 +16,216 @@
 
 #include "CPUTScene.h"
 #include "CPUTAssetLibrary.h"
+#include "CPUTAssetLoader.h"
+#include "CPUTSceneCache.h"
+#include "CPUTLod.h"
+#include <chrono>
+#include <memory>
+#include <set>
+
+// State shared by the loader thread and main thread steps of LoadSceneAsync()
+struct CPUTSceneAsyncLoad
+{
+    std::string              sceneFileName;
+    std::string              mediaDirectory;
+    bool                     useSceneCache;
+    CPUTSceneCache           sceneCache; // hands the parsed files from the loader thread to the main thread
+    std::vector<std::string> setFileNames;
+    std::vector<std::string> assetDirectories;
+    size_t                   nextSet;
+    CPUTResult               result;
+    std::chrono::high_resolution_clock::time_point start;
+};
+
+// Parses a .set file and the .mtl files of its models and reads the model
+// payloads, so that creating the set later finds all of it in the active cache.
+// Uses the same paths CPUTAssetSet/CPUTModel/CPUTAssetLibrary build from the
+// asset directory, otherwise the lookups would miss.
+//-----------------------------------------------------------------------------
+static void PreloadAssetSet(const std::string &setFileName, const std::string &assetDirectory)
+{
+    CPUTSceneCache *pCache = CPUTSceneCache::GetActiveCache();
+
+    CPUTConfigFile setFile;
+    if (CPUTFAILED(setFile.LoadFile(setFileName)))
+    {
+        return;
+    }
+
+    std::set<std::string> materialFileNames;
+    for (int ii = 0; ii < setFile.BlockCount(); ++ii)
+    {
+        CPUTConfigBlock *pBlock = setFile.GetBlock(ii);
+        if (pBlock->GetValueByName("type")->ValueAsString() != "model")
+        {
+            continue;
+        }
+
+        // Instances share the meshes of their master and have no payload of their own
+        CPUTConfigEntry *pInstance = pBlock->GetValueByName("instance");
+        if (pInstance == &CPUTConfigEntry::sNullConfigValue || pInstance->ValueAsInt() == ii)
+        {
+            std::string modelFileName;
+            CPUTFileSystem::ResolveAbsolutePathAndFilename(assetDirectory + "Asset/" + pBlock->GetValueByName("name")->ValueAsString() + ".mdl", &modelFileName);
+
+            const char *pPayload;
+            UINT payloadSize;
+            CPUTFileSystem::CPUTFileView fileView;
+            if (!pCache->Find(CPUT_CACHE_MODEL, modelFileName, &pPayload, &payloadSize) &&
+                CPUTSUCCESS(fileView.Open(modelFileName)))
+            {
+                pCache->Add(CPUT_CACHE_MODEL, modelFileName, fileView.GetData(), (UINT)fileView.GetSize());
+            }
+            // and its levels of detail, up to the first that isn't there
+            for (int lod = 1; lod < CPUT_MAX_LOD_COUNT; ++lod)
+            {
+                std::string lodFileName = CPUTLodFileName(modelFileName, lod);
+                if (!pCache->Find(CPUT_CACHE_MODEL, lodFileName, &pPayload, &payloadSize))
+                {
+                    if (CPUTFAILED(fileView.Open(lodFileName)))
+                    {
+                        break;
+                    }
+                    pCache->Add(CPUT_CACHE_MODEL, lodFileName, fileView.GetData(), (UINT)fileView.GetSize());
+                }
+            }
+        }
+
+        int meshCount = pBlock->GetValueByName("meshcount")->ValueAsInt();
+        for (int mesh = 0; mesh < meshCount; ++mesh)
+        {
+            std::string materialList = pBlock->GetValueByName("material" + cput_to_string(mesh))->ValueAsString();
+            std::istringstream materialNames(materialList);
+            std::string materialName;
+            while (materialNames >> materialName)
+            {
+                // System materials ('%') are shared and usually loaded already
+                if (materialName == "NULL" || materialName[0] == '%')
+                {
+                    continue;
+                }
+                std::string materialFileName;
+                CPUTFileSystem::ResolveAbsolutePathAndFilename(assetDirectory + "Material/" + materialName + ".mtl", &materialFileName);
+                if (materialFileNames.insert(materialFileName).second)
+                {
+                    CPUTConfigFile materialFile;
+                    materialFile.LoadFile(materialFileName);
+                }
+            }
+        }
+    }
+}
 
 //-----------------------------------------------------------------------------
-CPUTResult CPUTScene::LoadScene(const std::string &sceneFileName)
+CPUTResult CPUTScene::LoadScene(const std::string &sceneFileName, bool useSceneCache)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    // While the cache is active the config file and model loaders take their
+    // data from it and hand back whatever they had to load from the source files.
+    CPUTSceneCache sceneCache;
+    if (useSceneCache)
+    {
+        sceneCache.Open(sceneFileName + ".cache");
+        CPUTSceneCache::SetActiveCache(&sceneCache);
+    }
+
+    CPUTResult result = LoadSceneAssets(sceneFileName);
+
+    if (useSceneCache)
+    {
+        CPUTSceneCache::SetActiveCache(NULL);
+        sceneCache.Save();
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    DEBUG_PRINT("Loaded scene %s in %.1f ms (scene cache: %u hits, %u misses)\n", sceneFileName.c_str(), ms, sceneCache.GetHitCount(), sceneCache.GetMissCount());
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+CPUTLoadRequest *CPUTScene::LoadSceneAsync(const std::string &sceneFileName, bool useSceneCache)
+{
+    std::shared_ptr<CPUTSceneAsyncLoad> pLoad(new CPUTSceneAsyncLoad());
+    pLoad->sceneFileName  = sceneFileName;
+    pLoad->mediaDirectory = CPUTAssetLibrary::GetAssetLibrary()->GetMediaDirectoryName();
+    pLoad->useSceneCache  = useSceneCache;
+    pLoad->nextSet        = 0;
+    pLoad->result         = CPUT_SUCCESS;
+    pLoad->start          = std::chrono::high_resolution_clock::now();
+
+    CPUTScene *pScene = this;
+
+    // Loader thread: parse the scene, the sets and their materials, and read the
+    // model payloads. Nothing here touches the device or the asset library.
+    CPUTLoadTask workerTask = [pScene, pLoad]() -> CPUTResult
+    {
+        if (pLoad->useSceneCache)
+        {
+            pLoad->sceneCache.Open(pLoad->sceneFileName + ".cache");
+        }
+        CPUTSceneCache::SetActiveCache(&pLoad->sceneCache);
+
+        pLoad->result = pScene->ReadSceneFile(pLoad->sceneFileName, pLoad->mediaDirectory, &pLoad->setFileNames, &pLoad->assetDirectories);
+        for (size_t ii = 0; ii < pLoad->setFileNames.size(); ++ii)
+        {
+            PreloadAssetSet(pLoad->setFileNames[ii], pLoad->assetDirectories[ii]);
+        }
+
+        CPUTSceneCache::SetActiveCache(NULL);
+        return CPUTFAILED(pLoad->result) ? pLoad->result : CPUT_SUCCESS;
+    };
+
+    // Main thread: create one asset set per step so the loader can spread the
+    // resource creation over several frames, then finish up.
+    CPUTLoadTask mainThreadTask = [pScene, pLoad]() -> CPUTResult
+    {
+        if (pLoad->nextSet < pLoad->setFileNames.size())
+        {
+            CPUTSceneCache::SetActiveCache(&pLoad->sceneCache);
+            pScene->LoadAssetSet(pLoad->setFileNames[pLoad->nextSet], pLoad->assetDirectories[pLoad->nextSet]);
+            CPUTSceneCache::SetActiveCache(NULL);
+            ++pLoad->nextSet;
+            return CPUT_WARNING_NOT_FINISHED;
+        }
+
+        if (!pLoad->setFileNames.empty())
+        {
+            pScene->CalculateBoundingBox();
+        }
+        if (pLoad->useSceneCache)
+        {
+            pLoad->sceneCache.Save();
+        }
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - pLoad->start).count();
+        DEBUG_PRINT("Streamed scene %s in %.1f ms (scene cache: %u hits, %u misses)\n", pLoad->sceneFileName.c_str(), ms, pLoad->sceneCache.GetHitCount(), pLoad->sceneCache.GetMissCount());
+        return pLoad->result;
+    };
+
+    return CPUTAssetLoader::GetAssetLoader()->Submit(workerTask, mainThreadTask);
+}
+
+//-----------------------------------------------------------------------------
+CPUTResult CPUTScene::LoadSceneAssets(const std::string &sceneFileName)
+{
+    std::vector<std::string> setFileNames, assetDirectories;
+    CPUTResult result = ReadSceneFile(sceneFileName, CPUTAssetLibrary::GetAssetLibrary()->GetMediaDirectoryName(), &setFileNames, &assetDirectories);
+    if (CPUTFAILED(result) || result == CPUT_WARNING_NO_ASSETS_LOADED) {
+        return result;
+    }
+
+    for (size_t ii = 0; ii < setFileNames.size(); ++ii) {
+        LoadAssetSet(setFileNames[ii], assetDirectories[ii]);
+    }
+
+    CalculateBoundingBox();
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+CPUTResult CPUTScene::ReadSceneFile(const std::string &sceneFileName, const std::string &mediaDirectory, std::vector<std::string> *pSetFileNames, std::vector<std::string> *pAssetDirectories)
 {
     CPUTResult result = CPUT_SUCCESS;
 
@@ -40,8 +247,6 @@ CPUTResult CPUTScene::LoadScene(const std::string &sceneFileName)
         return CPUT_WARNING_NO_ASSETS_LOADED;
     }
 
-    CPUTAssetSet *pAssetSet = NULL;
-    CPUTAssetLibrary *pAssetLibrary = CPUTAssetLibrary::GetAssetLibrary();
     for (int i = 0; i < numAssets; ++i) {
          CPUTConfigEntry *pEntry = pAssetsBlock->GetValue(i);
          if (pEntry == NULL) {
@@ -49,7 +254,7 @@ CPUTResult CPUTScene::LoadScene(const std::string &sceneFileName)
          }
 
          std::string resolvedAssetNameAndPath;
-         CPUTFileSystem::ResolveAbsolutePathAndFilename(pAssetLibrary->GetMediaDirectoryName() + pEntry->NameAsString(), &resolvedAssetNameAndPath);
+         CPUTFileSystem::ResolveAbsolutePathAndFilename(mediaDirectory + pEntry->NameAsString(), &resolvedAssetNameAndPath);
 
          //
          // Extract the set file name off the end of the path
@@ -77,21 +282,27 @@ CPUTResult CPUTScene::LoadScene(const std::string &sceneFileName)
          }
          std::string assetFilePath = resolvedAssetNameAndPath.substr(0, pos);
 
-         pAssetLibrary->SetAssetDirectoryName(assetFilePath);
+         pSetFileNames->push_back(resolvedAssetNameAndPath);
+         pAssetDirectories->push_back(assetFilePath);
+    }
 
-         pAssetSet  = pAssetLibrary->GetAssetSet(resolvedAssetNameAndPath, true); // need to state that this is the fully qualified path name so CPUT will not append a .set extension
-        if (!pAssetSet)
-            DEBUG_PRINT("Failed to load AssetSet\n");// %p", pAssetSet);
-         ASSERT( pAssetSet, "Failed loading" + assetFilePath);
-         mpAssetSetList[mNumAssetSets] = pAssetSet;
-         mNumAssetSets++;
+    return result;
+}
 
-         ASSERT(mNumAssetSets <= MAX_NUM_ASSETS, "Number of Assets in scene file exceeds MAX_NUM_ASSETS");
-    }
+//-----------------------------------------------------------------------------
+void CPUTScene::LoadAssetSet(const std::string &setFileName, const std::string &assetDirectory)
+{
+    CPUTAssetLibrary *pAssetLibrary = CPUTAssetLibrary::GetAssetLibrary();
+    pAssetLibrary->SetAssetDirectoryName(assetDirectory);
 
-    CalculateBoundingBox();
+    CPUTAssetSet *pAssetSet = pAssetLibrary->GetAssetSet(setFileName, true); // need to state that this is the fully qualified path name so CPUT will not append a .set extension
+    if (!pAssetSet)
+        DEBUG_PRINT("Failed to load AssetSet\n");// %p", pAssetSet);
+    ASSERT( pAssetSet, "Failed loading" + assetDirectory);
+    mpAssetSetList[mNumAssetSets] = pAssetSet;
+    mNumAssetSets++;
 
-    return result;
+    ASSERT(mNumAssetSets <= MAX_NUM_ASSETS, "Number of Assets in scene file exceeds MAX_NUM_ASSETS");
 }
 
 //-----------------------------------------------------------------------------
@@ -121,6 +332,13 @@ void CPUTScene::Render(CPUTRenderParameters &renderParameters, int materialIndex
         mpAssetSetList[i]->RenderRecursive(renderParameters, materialIndex);
     }
 }
+void CPUTScene::SelectLods(CPUTCamera *pCamera, float lodScale)
+{
+    for (UINT i = 0; i < mNumAssetSets; ++i)
+    {
+        mpAssetSetList[i]->SelectLods(pCamera, lodScale);
+    }
+}
 void CPUTScene::Update( float dt )
 {
 	for (UINT i = 0; i < mNumAssetSets; ++i)
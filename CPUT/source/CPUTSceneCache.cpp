@@ -0,0 +1,278 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CPUTSceneCache.h"
+#include "CPUTOSServices.h"
+#include <limits.h>
+
+CPUT_THREAD_LOCAL CPUTSceneCache *CPUTSceneCache::mpActiveCache = NULL;
+
+static const uint64_t CACHE_PAYLOAD_ALIGNMENT = 16;
+
+//-----------------------------------------------------------------------------
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+//-----------------------------------------------------------------------------
+CPUTSceneCache::CPUTSceneCache()
+    : mHitCount(0)
+    , mMissCount(0)
+    , mbDirty(false)
+{
+}
+
+//-----------------------------------------------------------------------------
+CPUTSceneCache::~CPUTSceneCache()
+{
+    if (mpActiveCache == this)
+    {
+        mpActiveCache = NULL;
+    }
+    Close();
+}
+
+//-----------------------------------------------------------------------------
+void CPUTSceneCache::Close()
+{
+    mEntries.clear();
+    mFileView.Close();
+    mHitCount = mMissCount = 0;
+    mbDirty = false;
+}
+
+//-----------------------------------------------------------------------------
+CPUTResult CPUTSceneCache::Open(const std::string &cacheFileName)
+{
+    Close();
+    mFileName = cacheFileName;
+
+    // Map the file rather than reading it; only the entries that are hit get paged in
+    if (CPUTFAILED(CPUTFileSystem::DoesFileExist(cacheFileName)) ||
+        CPUTFAILED(mFileView.Open(cacheFileName, false)))
+    {
+        // Nothing cooked yet, everything will be a miss and Save() creates the file
+        return CPUT_SUCCESS;
+    }
+
+    const char *pFileContents = mFileView.GetData();
+    uint64_t fileSize = mFileView.GetSize();
+    const CPUTSceneCacheHeader *pHeader = (const CPUTSceneCacheHeader *)pFileContents;
+    if (fileSize < sizeof(CPUTSceneCacheHeader) ||
+        pHeader->mMagic != CPUT_SCENE_CACHE_MAGIC ||
+        pHeader->mVersion != CPUT_SCENE_CACHE_VERSION ||
+        pHeader->mDirectoryOffset > fileSize)
+    {
+        DEBUG_PRINT("Scene cache %s is invalid or from another version, rebuilding\n", cacheFileName.c_str());
+        mFileView.Close();
+        mbDirty = true;
+        return CPUT_SUCCESS;
+    }
+
+    // Sizes are compared against what is left rather than added to offsets, which a damaged
+    // file could make wrap around
+    const uint64_t directoryOffset = pHeader->mDirectoryOffset;
+    uint64_t position = directoryOffset;
+    for (UINT ii = 0; ii < pHeader->mEntryCount; ++ii)
+    {
+        const CPUTSceneCacheDirectoryEntry *pDirEntry = (const CPUTSceneCacheDirectoryEntry *)(pFileContents + position);
+        if (position > fileSize ||
+            fileSize - position < sizeof(CPUTSceneCacheDirectoryEntry) ||
+            pDirEntry->mPathLength > fileSize - position - sizeof(CPUTSceneCacheDirectoryEntry) ||
+            pDirEntry->mOffset > directoryOffset ||
+            pDirEntry->mSize > directoryOffset - pDirEntry->mOffset ||
+            pDirEntry->mSize > UINT_MAX)
+        {
+            DEBUG_PRINT("Scene cache %s is truncated, rebuilding\n", cacheFileName.c_str());
+            mEntries.clear();
+            mFileView.Close();
+            mbDirty = true;
+            return CPUT_SUCCESS;
+        }
+
+        std::string path(pFileContents + position + sizeof(CPUTSceneCacheDirectoryEntry), pDirEntry->mPathLength);
+        CacheEntry &entry = mEntries[path];
+        entry.mType       = (CPUT_CACHE_ENTRY_TYPE)pDirEntry->mType;
+        entry.mSourceSize = pDirEntry->mSourceSize;
+        entry.mSourceTime = pDirEntry->mSourceTime;
+        entry.mpData      = pFileContents + pDirEntry->mOffset;
+        entry.mSize       = (UINT)pDirEntry->mSize;
+
+        position += AlignUp(sizeof(CPUTSceneCacheDirectoryEntry) + pDirEntry->mPathLength, 8);
+    }
+
+    return CPUT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+bool CPUTSceneCache::Find(CPUT_CACHE_ENTRY_TYPE type, const std::string &sourceFileName, const char **ppData, UINT *pSizeInBytes)
+{
+    std::map<std::string, CacheEntry>::iterator it = mEntries.find(sourceFileName);
+    if (it != mEntries.end() && it->second.mType == type)
+    {
+        uint64_t sourceSize, sourceTime;
+        if (CPUTSUCCESS(CPUTFileSystem::GetFileInfo(sourceFileName, &sourceSize, &sourceTime)) &&
+            sourceSize == it->second.mSourceSize &&
+            sourceTime == it->second.mSourceTime)
+        {
+            *ppData = it->second.mpData;
+            *pSizeInBytes = it->second.mSize;
+            ++mHitCount;
+            return true;
+        }
+    }
+    ++mMissCount;
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTSceneCache::Add(CPUT_CACHE_ENTRY_TYPE type, const std::string &sourceFileName, const char *pData, UINT sizeInBytes)
+{
+    uint64_t sourceSize, sourceTime;
+    if (CPUTFAILED(CPUTFileSystem::GetFileInfo(sourceFileName, &sourceSize, &sourceTime)))
+    {
+        // Can't tell when it goes stale, so don't cache it
+        return;
+    }
+
+    // Fill the entry in place; mpData points into mOwnedData so the entry must not be copied afterwards
+    CacheEntry &entry = mEntries[sourceFileName];
+    entry.mType       = type;
+    entry.mSourceSize = sourceSize;
+    entry.mSourceTime = sourceTime;
+    entry.mOwnedData.assign(pData, pData + sizeInBytes);
+    entry.mpData      = entry.mOwnedData.empty() ? NULL : &entry.mOwnedData[0];
+    entry.mSize       = sizeInBytes;
+    mbDirty = true;
+}
+
+//-----------------------------------------------------------------------------
+CPUTResult CPUTSceneCache::Save()
+{
+    if (!mbDirty || mFileName.empty())
+    {
+        return CPUT_SUCCESS;
+    }
+
+    // Drop entries that can never be hit again: their source was deleted, renamed or changed
+    // and nothing loaded it since (that would have replaced the entry)
+    for (std::map<std::string, CacheEntry>::iterator it = mEntries.begin(); it != mEntries.end();)
+    {
+        uint64_t sourceSize, sourceTime;
+        if (CPUTFAILED(CPUTFileSystem::GetFileInfo(it->first, &sourceSize, &sourceTime)) ||
+            sourceSize != it->second.mSourceSize ||
+            sourceTime != it->second.mSourceTime)
+        {
+            mEntries.erase(it++);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    // Entries loaded from disk point into the view of the file we are about to
+    // overwrite, so give them their own copy and drop the view first
+    if (mFileView.GetData())
+    {
+        for (std::map<std::string, CacheEntry>::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+        {
+            CacheEntry &entry = it->second;
+            if (entry.mOwnedData.empty() && entry.mSize)
+            {
+                entry.mOwnedData.assign(entry.mpData, entry.mpData + entry.mSize);
+                entry.mpData = &entry.mOwnedData[0];
+            }
+        }
+        mFileView.Close();
+    }
+
+    // Write to a temporary and rename, so a crash part way through never leaves a damaged cache
+    const std::string tempFileName = mFileName + ".tmp";
+    FILE *pFile = fopen(tempFileName.c_str(), "wb");
+    if (!pFile)
+    {
+        DEBUG_PRINT("Unable to write scene cache %s\n", tempFileName.c_str());
+        return CPUT_ERROR_FILE_ERROR;
+    }
+
+    static const char padding[CACHE_PAYLOAD_ALIGNMENT] = { 0 };
+    bool ok = true;
+
+    CPUTSceneCacheHeader header;
+    header.mMagic           = CPUT_SCENE_CACHE_MAGIC;
+    header.mVersion         = CPUT_SCENE_CACHE_VERSION;
+    header.mEntryCount      = (UINT)mEntries.size();
+    header.mReserved        = 0;
+    header.mDirectoryOffset = 0; // patched below
+    ok &= fwrite(&header, sizeof(header), 1, pFile) == 1;
+
+    // Payloads
+    uint64_t offset = sizeof(header);
+    std::vector<uint64_t> payloadOffsets;
+    payloadOffsets.reserve(mEntries.size());
+    for (std::map<std::string, CacheEntry>::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+    {
+        uint64_t aligned = AlignUp(offset, CACHE_PAYLOAD_ALIGNMENT);
+        ok &= fwrite(padding, 1, (size_t)(aligned - offset), pFile) == (size_t)(aligned - offset);
+        payloadOffsets.push_back(aligned);
+        if (it->second.mSize)
+        {
+            ok &= fwrite(it->second.mpData, it->second.mSize, 1, pFile) == 1;
+        }
+        offset = aligned + it->second.mSize;
+    }
+
+    // Directory
+    header.mDirectoryOffset = AlignUp(offset, CACHE_PAYLOAD_ALIGNMENT);
+    ok &= fwrite(padding, 1, (size_t)(header.mDirectoryOffset - offset), pFile) == (size_t)(header.mDirectoryOffset - offset);
+    UINT index = 0;
+    for (std::map<std::string, CacheEntry>::iterator it = mEntries.begin(); it != mEntries.end(); ++it, ++index)
+    {
+        CPUTSceneCacheDirectoryEntry dirEntry;
+        dirEntry.mType       = it->second.mType;
+        dirEntry.mPathLength = (UINT)it->first.size();
+        dirEntry.mSourceSize = it->second.mSourceSize;
+        dirEntry.mSourceTime = it->second.mSourceTime;
+        dirEntry.mOffset     = payloadOffsets[index];
+        dirEntry.mSize       = it->second.mSize;
+        ok &= fwrite(&dirEntry, sizeof(dirEntry), 1, pFile) == 1;
+        ok &= fwrite(it->first.c_str(), 1, it->first.size(), pFile) == it->first.size();
+
+        size_t entrySize = sizeof(dirEntry) + it->first.size();
+        size_t pad = (size_t)(AlignUp(entrySize, 8) - entrySize);
+        ok &= fwrite(padding, 1, pad, pFile) == pad;
+    }
+
+    ok &= fseek(pFile, 0, SEEK_SET) == 0;
+    ok &= fwrite(&header, sizeof(header), 1, pFile) == 1;
+    ok &= fclose(pFile) == 0;
+
+    // rename() won't replace an existing file on Windows
+    if (ok)
+    {
+        remove(mFileName.c_str());
+    }
+    if (!ok || 0 != rename(tempFileName.c_str(), mFileName.c_str()))
+    {
+        DEBUG_PRINT("Failed writing scene cache %s\n", mFileName.c_str());
+        remove(tempFileName.c_str());
+        return CPUT_ERROR_FILE_IO_ERROR;
+    }
+    mbDirty = false;
+    return CPUT_SUCCESS;
+}
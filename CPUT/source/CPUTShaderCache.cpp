@@ -0,0 +1,432 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "CPUTShaderCache.h"
+#include "CPUTHash.h"
+#ifdef CPUT_OS_WINDOWS
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+struct BytecodeFileHeader
+{
+    UINT     mTag;
+    UINT     mVersion;
+    uint64_t mKey;
+    UINT     mBytecodeSize; // the bytecode follows the header
+    UINT     mPad;
+};
+
+// Fails harmlessly when it is already there
+static void CreateDirectoryIfMissing(const std::string &directory)
+{
+#ifdef CPUT_OS_WINDOWS
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+}
+
+// Plain stdio rather than CPUTFileSystem, so the cache doesn't pull in the platform file code.
+// Shader sources and bytecode are small enough that a copy doesn't matter.
+static bool ReadWholeFile(const std::string &fileName, std::vector<char> *pContents)
+{
+    FILE *pFile = fopen(fileName.c_str(), "rb");
+    if (!pFile)
+    {
+        return false;
+    }
+    long size = -1;
+    if (0 == fseek(pFile, 0, SEEK_END))
+    {
+        size = ftell(pFile);
+    }
+    bool ok = size >= 0 && 0 == fseek(pFile, 0, SEEK_SET);
+    if (ok)
+    {
+        pContents->resize((size_t)size);
+        ok = size == 0 || fread(&(*pContents)[0], 1, (size_t)size, pFile) == (size_t)size;
+    }
+    fclose(pFile);
+    return ok;
+}
+
+// Up to and including the last separator, empty for a bare file name
+static std::string GetDirectory(const std::string &fileName)
+{
+    size_t separator = fileName.find_last_of("/\\");
+    return (separator == std::string::npos) ? std::string() : fileName.substr(0, separator + 1);
+}
+
+static bool IsAbsolutePath(const std::string &fileName)
+{
+    return !fileName.empty() && (fileName[0] == '/' || fileName[0] == '\\' || (fileName.size() > 1 && fileName[1] == ':'));
+}
+
+// Key fields are separated by a 0, so "ab" + "c" and "a" + "bc" don't collide
+static void AppendKeyString(std::string *pKeyData, const std::string &value)
+{
+    pKeyData->append(value);
+    pKeyData->push_back('\0');
+}
+
+static void AppendKeyHash(std::string *pKeyData, uint64_t hash)
+{
+    pKeyData->append((const char *)&hash, sizeof(hash));
+}
+
+//-----------------------------------------------------------------------------
+CPUTShaderCache::CPUTShaderCache(CPUTShaderCompiler *pCompiler) :
+    mpCompiler(pCompiler),
+    mMemoryHitCount(0),
+    mDiskHitCount(0),
+    mCompileCount(0)
+{
+    mCompilerId = mpCompiler->GetCompilerId();
+}
+
+//-----------------------------------------------------------------------------
+CPUTShaderCache::~CPUTShaderCache()
+{
+    SAFE_DELETE(mpCompiler);
+}
+
+//-----------------------------------------------------------------------------
+void CPUTShaderCache::SetCacheDirectory(const std::string &directory)
+{
+    mCacheDirectory = directory;
+    if (!mCacheDirectory.empty() && mCacheDirectory[mCacheDirectory.size() - 1] != '/' && mCacheDirectory[mCacheDirectory.size() - 1] != '\\')
+    {
+        mCacheDirectory += "/";
+    }
+}
+
+//-----------------------------------------------------------------------------
+std::string CPUTShaderCache::GetBytecodeFileName(uint64_t key) const
+{
+    char name[32];
+    sprintf(name, "%08x%08x.cso", (UINT)(key >> 32), (UINT)key);
+    return mCacheDirectory + name;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTShaderCache::ClearMemory()
+{
+    mSourceFiles.clear();
+    mBytecode.clear();
+}
+
+// Finds #include "name" and #include <name> at the start of a line. Comments are skipped,
+// so are string literals, and a block comment can't hide or fake a directive.
+//-----------------------------------------------------------------------------
+void CPUTShaderCache::ScanIncludes(const char *pSource, size_t size, std::vector<std::string> *pIncludes)
+{
+    const char *p   = pSource;
+    const char *end = pSource + size;
+    bool lineStart  = true; // only whitespace and comments so far on this line
+    while (p < end)
+    {
+        char c = *p;
+        if (c == '\n')
+        {
+            lineStart = true;
+            p++;
+        }
+        else if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v')
+        {
+            p++;
+        }
+        else if (c == '/' && p + 1 < end && p[1] == '/')
+        {
+            while (p < end && *p != '\n')
+            {
+                p++;
+            }
+        }
+        else if (c == '/' && p + 1 < end && p[1] == '*')
+        {
+            p += 2;
+            while (p + 1 < end && !(p[0] == '*' && p[1] == '/'))
+            {
+                p++;
+            }
+            p = (p + 1 < end) ? p + 2 : end;
+        }
+        else if (c == '"')
+        {
+            lineStart = false;
+            for (p++; p < end && *p != '"' && *p != '\n'; p++)
+            {
+                if (*p == '\\' && p + 1 < end)
+                {
+                    p++;
+                }
+            }
+            if (p < end && *p == '"')
+            {
+                p++;
+            }
+        }
+        else if (c == '#' && lineStart)
+        {
+            lineStart = false;
+            for (p++; p < end && (*p == ' ' || *p == '\t'); p++) {}
+            static const char INCLUDE[] = "include";
+            const size_t includeLength = sizeof(INCLUDE) - 1;
+            if ((size_t)(end - p) < includeLength || strncmp(p, INCLUDE, includeLength))
+            {
+                continue;
+            }
+            for (p += includeLength; p < end && (*p == ' ' || *p == '\t'); p++) {}
+            if (p == end || (*p != '"' && *p != '<'))
+            {
+                continue;
+            }
+            const char close = (*p == '"') ? '"' : '>';
+            const char *pName = ++p;
+            while (p < end && *p != close && *p != '\n')
+            {
+                p++;
+            }
+            if (p < end && *p == close)
+            {
+                pIncludes->push_back(std::string(pName, p - pName));
+                p++;
+            }
+        }
+        else
+        {
+            lineStart = false;
+            p++;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+const CPUTShaderCache::SourceFile &CPUTShaderCache::GetSourceFile(const std::string &fileName)
+{
+    std::map<std::string, SourceFile>::iterator it = mSourceFiles.find(fileName);
+    if (it != mSourceFiles.end())
+    {
+        return it->second;
+    }
+    SourceFile &file = mSourceFiles[fileName];
+    file.bFound = false;
+    file.hash   = 0;
+
+    std::vector<char> contents;
+    if (ReadWholeFile(fileName, &contents))
+    {
+        file.bFound = true;
+        file.hash   = CPUTHash64(contents.data(), contents.size());
+        ScanIncludes(contents.data(), contents.size(), &file.includes);
+    }
+    return file;
+}
+
+// Depth first, each file once, in the order the compiler would open them
+//-----------------------------------------------------------------------------
+void CPUTShaderCache::AddIncludes(
+    const std::string              &directory,
+    const std::vector<std::string> &includes,
+    std::string                    *pKeyData,
+    std::set<std::string>          *pVisited,
+    std::vector<std::string>       *pDependencies
+)
+{
+    for (size_t ii = 0; ii < includes.size(); ii++)
+    {
+        const std::string fileName = IsAbsolutePath(includes[ii]) ? includes[ii] : directory + includes[ii];
+        if (!pVisited->insert(fileName).second)
+        {
+            continue;
+        }
+        // The name as written rather than the path, so the key doesn't depend on where the tree is
+        AppendKeyString(pKeyData, includes[ii]);
+        const SourceFile &file = GetSourceFile(fileName);
+        if (!file.bFound)
+        {
+            // Maybe in a disabled #if, if not the compile will say so
+            AppendKeyString(pKeyData, "<missing>");
+            continue;
+        }
+        AppendKeyHash(pKeyData, file.hash);
+        if (pDependencies)
+        {
+            pDependencies->push_back(fileName);
+        }
+        AddIncludes(GetDirectory(fileName), file.includes, pKeyData, pVisited, pDependencies);
+    }
+}
+
+//-----------------------------------------------------------------------------
+CPUTResult CPUTShaderCache::ComputeKey(const CPUTShaderCompileRequest &request, uint64_t *pKey, std::vector<std::string> *pDependencies)
+{
+    std::string keyData;
+    AppendKeyHash(&keyData, ((uint64_t)CPUT_SHADER_CACHE_TAG << 32) | CPUT_SHADER_CACHE_VERSION);
+    AppendKeyString(&keyData, mCompilerId);
+    AppendKeyString(&keyData, request.entryPoint);
+    AppendKeyString(&keyData, request.profile);
+    for (size_t ii = 0; ii < request.defines.size(); ii++)
+    {
+        AppendKeyString(&keyData, request.defines[ii].name);
+        AppendKeyString(&keyData, request.defines[ii].definition);
+    }
+
+    std::set<std::string> visited;
+    if (request.pSource)
+    {
+        const size_t size = strlen(request.pSource);
+        AppendKeyHash(&keyData, CPUTHash64(request.pSource, size));
+        std::vector<std::string> includes;
+        ScanIncludes(request.pSource, size, &includes);
+        AddIncludes(std::string(), includes, &keyData, &visited, pDependencies);
+    }
+    else
+    {
+        const SourceFile &file = GetSourceFile(request.fileName);
+        if (!file.bFound)
+        {
+            return CPUT_ERROR_FILE_NOT_FOUND;
+        }
+        AppendKeyHash(&keyData, file.hash);
+        if (pDependencies)
+        {
+            pDependencies->push_back(request.fileName);
+        }
+        visited.insert(request.fileName);
+        AddIncludes(GetDirectory(request.fileName), file.includes, &keyData, &visited, pDependencies);
+    }
+
+    *pKey = CPUTHash64(keyData.data(), keyData.size());
+    return CPUT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+CPUTResult CPUTShaderCache::GetBytecode(const CPUTShaderCompileRequest &request, const std::vector<char> **ppBytecode, std::string *pErrors, uint64_t *pKey)
+{
+    *ppBytecode = NULL;
+    uint64_t key;
+    CPUTResult result = ComputeKey(request, &key);
+    if (CPUT_SUCCESS != result)
+    {
+        if (pErrors)
+        {
+            *pErrors = "File not found: " + request.fileName;
+        }
+        return result;
+    }
+    if (pKey)
+    {
+        *pKey = key;
+    }
+
+    std::map<uint64_t, std::vector<char> >::iterator it = mBytecode.find(key);
+    if (it != mBytecode.end())
+    {
+        mMemoryHitCount++;
+        *ppBytecode = &it->second;
+        return CPUT_SUCCESS;
+    }
+
+    std::vector<char> bytecode;
+    if (LoadBytecode(key, &bytecode))
+    {
+        mDiskHitCount++;
+    }
+    else
+    {
+        std::string errors;
+        if (!mpCompiler->Compile(request, &bytecode, &errors) || bytecode.empty())
+        {
+            DEBUG_PRINT("CPUTShaderCache: %s (%s) doesn't compile\n%s\n", request.fileName.c_str(), request.entryPoint.c_str(), errors.c_str());
+            if (pErrors)
+            {
+                *pErrors = errors;
+            }
+            return CPUT_ERROR;
+        }
+        mCompileCount++;
+        StoreBytecode(key, bytecode);
+    }
+
+    std::vector<char> &stored = mBytecode[key];
+    stored.swap(bytecode);
+    *ppBytecode = &stored;
+    return CPUT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+bool CPUTShaderCache::LoadBytecode(uint64_t key, std::vector<char> *pBytecode)
+{
+    if (mCacheDirectory.empty())
+    {
+        return false;
+    }
+    std::vector<char> contents;
+    if (!ReadWholeFile(GetBytecodeFileName(key), &contents))
+    {
+        return false;
+    }
+    BytecodeFileHeader header;
+    if (contents.size() < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, contents.data(), sizeof(header));
+    if (header.mTag != CPUT_SHADER_CACHE_TAG || header.mVersion != CPUT_SHADER_CACHE_VERSION || header.mKey != key ||
+        header.mBytecodeSize == 0 || contents.size() != sizeof(header) + header.mBytecodeSize)
+    {
+        return false;
+    }
+    pBytecode->assign(contents.begin() + sizeof(header), contents.end());
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTShaderCache::StoreBytecode(uint64_t key, const std::vector<char> &bytecode)
+{
+    if (mCacheDirectory.empty())
+    {
+        return;
+    }
+    BytecodeFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.mTag          = CPUT_SHADER_CACHE_TAG;
+    header.mVersion      = CPUT_SHADER_CACHE_VERSION;
+    header.mKey          = key;
+    header.mBytecodeSize = (UINT)bytecode.size();
+
+    // Write to a temporary and rename, so another instance never loads half a file
+    CreateDirectoryIfMissing(mCacheDirectory);
+    const std::string fileName = GetBytecodeFileName(key);
+    const std::string tempFileName = fileName + ".tmp";
+    FILE *pFile = fopen(tempFileName.c_str(), "wb");
+    if (!pFile)
+    {
+        DEBUG_PRINT("CPUTShaderCache: unable to write %s\n", tempFileName.c_str());
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, pFile) == 1;
+    ok &= fwrite(&bytecode[0], 1, bytecode.size(), pFile) == bytecode.size();
+    ok &= fclose(pFile) == 0;
+    remove(fileName.c_str());
+    if (!ok || 0 != rename(tempFileName.c_str(), fileName.c_str()))
+    {
+        remove(tempFileName.c_str());
+        DEBUG_PRINT("CPUTShaderCache: unable to write %s\n", fileName.c_str());
+    }
+}
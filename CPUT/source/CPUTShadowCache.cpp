@@ -0,0 +1,65 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "CPUTShadowCache.h"
+#include "CPUTRenderNode.h"
+#include "CPUTRenderParams.h"
+
+//-----------------------------------------------------------------------------
+CPUTShadowCache::CPUTShadowCache() :
+    mStaticVersion(0),
+    mbStaticValid(false),
+    mbHasDynamic(false),
+    mDrawCount(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+void CPUTShadowCache::Render(CPUTRenderParameters &renderParams, bool bCacheStatic, CPUTShadowCacheTargets *pTargets)
+{
+    renderParams.mDrawCount = 0;
+    if (!bCacheStatic)
+    {
+        renderParams.mDrawNodes = CPUT_DRAW_ALL_NODES;
+        pTargets->DrawShadowCasters(renderParams, false, true);
+        mbStaticValid = false;
+        mDrawCount = renderParams.mDrawCount;
+        return;
+    }
+
+    UINT version = CPUTRenderNode::GetStaticSceneVersion();
+    bool staticRedrawn = !mbStaticValid || version != mStaticVersion;
+    if (staticRedrawn)
+    {
+        renderParams.mDrawNodes = CPUT_DRAW_STATIC_NODES;
+        pTargets->DrawShadowCasters(renderParams, true, true);
+        mStaticVersion = version;
+        mbStaticValid = true;
+    }
+
+    // Unless dynamic casters were drawn into it last frame the shadow map still holds the static ones alone
+    if (staticRedrawn || mbHasDynamic)
+    {
+        pTargets->CopyStaticShadowMap();
+    }
+
+    int staticDrawCount = renderParams.mDrawCount;
+    renderParams.mDrawNodes = CPUT_DRAW_DYNAMIC_NODES;
+    pTargets->DrawShadowCasters(renderParams, false, false);
+    renderParams.mDrawNodes = CPUT_DRAW_ALL_NODES;
+
+    mbHasDynamic = renderParams.mDrawCount > staticDrawCount;
+    mDrawCount = renderParams.mDrawCount;
+}
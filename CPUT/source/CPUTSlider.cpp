@@ -769,10 +769,29 @@ void CPUTSlider::Draw(CPUTGUIVertex *pVertexBufferMirror, UINT *pInsertIndex, UI
     }
 }
 
+// Dirty when the slider or its text is
+//--------------------------------------------------------------------------------
+bool CPUTSlider::IsGeometryDirty()
+{
+    return mbGeometryDirty || (mpControlText && mpControlText->IsGeometryDirty());
+}
+
+//--------------------------------------------------------------------------------
+void CPUTSlider::ClearGeometryDirty()
+{
+    mbGeometryDirty = false;
+    if(mpControlText)
+    {
+        mpControlText->ClearGeometryDirty();
+    }
+}
+
 // This function re-calculates the positions of the various items in the control
 //------------------------------------------------------------------------
 void CPUTSlider::Recalculate()
 {
+    mbGeometryDirty = true;
+
     LocationGuides guides;
     CalculateLocationGuides(guides);
 
@@ -219,6 +219,7 @@ int CPUTText::GetOutputVertexCount()
 //--------------------------------------------------------------------------------
 void CPUTText::Recalculate()
 {
+    mbGeometryDirty = true;
     SAFE_DELETE_ARRAY(mpMirrorBuffer);
 
 	mNumCharsInString = (int) mStaticText.size();
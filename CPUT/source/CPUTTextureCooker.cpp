@@ -0,0 +1,359 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "CPUTTextureCooker.h"
+#include "CPUTHash.h"
+#include "CPUTOSServices.h"
+#include "../middleware/stb/stb_image.h"
+#include <algorithm>
+#include <math.h>
+#include <vector>
+
+#ifdef CPUT_TEXTURE_COOKER_DIRECTXTEX
+#include "DirectXTex.h"
+#endif
+
+// DDS layout, see the DDS_HEADER documentation. Same as DDSHeader in CPUTTextureOGL.cpp,
+// which is what reads the files back on OGL.
+struct CookedDDSPixelFormat
+{
+    UINT mSize;
+    UINT mFlags;
+    UINT mFourCC;
+    UINT mRGBBitCount;
+    UINT mRedBitMask;
+    UINT mGreenBitMask;
+    UINT mBlueBitMask;
+    UINT mAlphaBitMask;
+};
+
+struct CookedDDSHeader
+{
+    char                 mFileType[4];
+    UINT                 mSize;
+    UINT                 mFlags;
+    UINT                 mHeight;
+    UINT                 mWidth;
+    UINT                 mPitchOrLinearSize;
+    UINT                 mDepth;
+    UINT                 mMipMapCount;
+    UINT                 mReserved1[11];
+    CookedDDSPixelFormat mPixelFormat;
+    UINT                 mCaps;
+    UINT                 mCaps2;
+    UINT                 mCaps3;
+    UINT                 mCaps4;
+    UINT                 mReserved2;
+};
+
+static const UINT DDSD_CAPS        = 0x00000001;
+static const UINT DDSD_HEIGHT      = 0x00000002;
+static const UINT DDSD_WIDTH       = 0x00000004;
+static const UINT DDSD_PITCH       = 0x00000008;
+static const UINT DDSD_PIXELFORMAT = 0x00001000;
+static const UINT DDSD_MIPMAPCOUNT = 0x00020000;
+static const UINT DDPF_ALPHAPIXELS = 0x00000001;
+static const UINT DDPF_RGB         = 0x00000040;
+static const UINT DDSCAPS_COMPLEX  = 0x00000008;
+static const UINT DDSCAPS_TEXTURE  = 0x00001000;
+static const UINT DDSCAPS_MIPMAP   = 0x00400000;
+
+// Where the source key goes, see CPUTTextureCooker.h
+struct CookedSourceKey
+{
+    UINT mTag;
+    UINT mVersionAndFlags;
+    UINT mHash[2];
+    UINT mSourceSize[2];
+    UINT mSourceTime[2];
+};
+
+//-----------------------------------------------------------------------------
+static void SplitUINT64(uint64_t value, UINT *pWords)
+{
+    pWords[0] = (UINT)(value & 0xFFFFFFFF);
+    pWords[1] = (UINT)(value >> 32);
+}
+
+//-----------------------------------------------------------------------------
+static uint64_t JoinUINT64(const UINT *pWords)
+{
+    return (uint64_t)pWords[0] | ((uint64_t)pWords[1] << 32);
+}
+
+//-----------------------------------------------------------------------------
+static UINT GetVersionAndFlags(bool sRGB)
+{
+    return CPUT_TEXTURE_COOKER_VERSION | (sRGB ? CPUT_TEXTURE_COOKER_SRGB : 0);
+}
+
+//-----------------------------------------------------------------------------
+static float SRGBToLinear(float value)
+{
+    return (value <= 0.04045f) ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+//-----------------------------------------------------------------------------
+static float LinearToSRGB(float value)
+{
+    return (value <= 0.0031308f) ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// Next mip level of an RGBA8 image: each texel is the average of the (up to) 2x2 texels
+// it covers, odd edges are clamped. Alpha is always filtered as is.
+//-----------------------------------------------------------------------------
+static void DownsampleRGBA8(const unsigned char *pSrc, UINT srcWidth, UINT srcHeight, unsigned char *pDst, UINT dstWidth, UINT dstHeight, const float *pToLinear, bool sRGB)
+{
+    for (UINT y = 0; y < dstHeight; y++)
+    {
+        const UINT y0 = std::min(y * 2, srcHeight - 1);
+        const UINT y1 = std::min(y * 2 + 1, srcHeight - 1);
+        for (UINT x = 0; x < dstWidth; x++)
+        {
+            const UINT x0 = std::min(x * 2, srcWidth - 1);
+            const UINT x1 = std::min(x * 2 + 1, srcWidth - 1);
+            const unsigned char *pTexels[4] = {
+                pSrc + (y0 * srcWidth + x0) * 4, pSrc + (y0 * srcWidth + x1) * 4,
+                pSrc + (y1 * srcWidth + x0) * 4, pSrc + (y1 * srcWidth + x1) * 4
+            };
+            unsigned char *pOut = pDst + (y * dstWidth + x) * 4;
+            for (UINT c = 0; c < 4; c++)
+            {
+                if (sRGB && c < 3)
+                {
+                    float sum = pToLinear[pTexels[0][c]] + pToLinear[pTexels[1][c]] + pToLinear[pTexels[2][c]] + pToLinear[pTexels[3][c]];
+                    pOut[c] = (unsigned char)(LinearToSRGB(sum * 0.25f) * 255.0f + 0.5f);
+                }
+                else
+                {
+                    UINT sum = pTexels[0][c] + pTexels[1][c] + pTexels[2][c] + pTexels[3][c];
+                    pOut[c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+std::string CPUTTextureCooker::GetCookedFileName(const std::string &sourceFileName)
+{
+    return sourceFileName + ".cooked.dds";
+}
+
+//-----------------------------------------------------------------------------
+bool CPUTTextureCooker::IsCookableFile(const std::string &fileName)
+{
+    size_t index = fileName.find_last_of(".");
+    if (index == std::string::npos)
+    {
+        return false;
+    }
+    std::string ext = fileName.substr(index + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == "png" || ext == "jpg" || ext == "jpeg" || ext == "tga" || ext == "bmp";
+}
+
+//-----------------------------------------------------------------------------
+bool CPUTTextureCooker::IsCookedFileUpToDate(const std::string &sourceFileName, const std::string &cookedFileName, bool sRGB)
+{
+    CPUTFileSystem::CPUTFileView cookedView;
+    if (CPUT_SUCCESS != cookedView.Open(cookedFileName, false) || cookedView.GetSize() < sizeof(CookedDDSHeader))
+    {
+        return false;
+    }
+    CookedDDSHeader header;
+    memcpy(&header, cookedView.GetData(), sizeof(header));
+    cookedView.Close();
+
+    CookedSourceKey key;
+    memcpy(&key, header.mReserved1, sizeof(key));
+    if (0 != memcmp(header.mFileType, "DDS ", 4) || key.mTag != CPUT_TEXTURE_COOKER_TAG || key.mVersionAndFlags != GetVersionAndFlags(sRGB))
+    {
+        return false;
+    }
+
+    // No source next to it: the cooked file is all there is
+    uint64_t sourceSize, sourceTime;
+    if (CPUT_SUCCESS != CPUTFileSystem::GetFileInfo(sourceFileName, &sourceSize, &sourceTime))
+    {
+        return true;
+    }
+    if (sourceSize != JoinUINT64(key.mSourceSize))
+    {
+        return false;
+    }
+    if (sourceTime == JoinUINT64(key.mSourceTime))
+    {
+        return true;
+    }
+
+    // Touched but maybe not changed (checkout, copy): compare contents
+    CPUTFileSystem::CPUTFileView sourceView;
+    if (CPUT_SUCCESS != sourceView.Open(sourceFileName))
+    {
+        return false;
+    }
+    return CPUTHash64(sourceView.GetData(), sourceView.GetSize()) == JoinUINT64(key.mHash);
+}
+
+//-----------------------------------------------------------------------------
+CPUTResult CPUTTextureCooker::Cook(const std::string &sourceFileName, const std::string &cookedFileName, bool sRGB, CPUT_TEXTURE_COOK_FORMAT format)
+{
+    std::vector<char> output;
+    CPUTResult result = CookToMemory(sourceFileName, sRGB, format, &output);
+    if (CPUT_SUCCESS != result)
+    {
+        return result;
+    }
+
+    // Write to a temporary and rename, so a loader never sees a half written file
+    const std::string tempFileName = cookedFileName + ".tmp";
+    FILE *pFile = fopen(tempFileName.c_str(), "wb");
+    if (!pFile)
+    {
+        DEBUG_PRINT("CPUTTextureCooker: unable to write %s\n", tempFileName.c_str());
+        return CPUT_ERROR_FILE_ERROR;
+    }
+    bool ok = fwrite(&output[0], 1, output.size(), pFile) == output.size();
+    ok &= fclose(pFile) == 0;
+    remove(cookedFileName.c_str());
+    if (!ok || 0 != rename(tempFileName.c_str(), cookedFileName.c_str()))
+    {
+        remove(tempFileName.c_str());
+        DEBUG_PRINT("CPUTTextureCooker: unable to write %s\n", cookedFileName.c_str());
+        return CPUT_ERROR_FILE_ERROR;
+    }
+    return CPUT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+CPUTResult CPUTTextureCooker::CookToMemory(const std::string &sourceFileName, bool sRGB, CPUT_TEXTURE_COOK_FORMAT format, std::vector<char> *pOutput)
+{
+    CPUTFileSystem::CPUTFileView sourceView;
+    CPUTResult result = sourceView.Open(sourceFileName);
+    if (CPUT_SUCCESS != result)
+    {
+        return result;
+    }
+    uint64_t sourceSize, sourceTime;
+    result = CPUTFileSystem::GetFileInfo(sourceFileName, &sourceSize, &sourceTime);
+    if (CPUT_SUCCESS != result)
+    {
+        return result;
+    }
+
+    int width, height, numComponents;
+    unsigned char *pPixels = stbi_load_from_memory((const unsigned char *)sourceView.GetData(), (int)sourceView.GetSize(), &width, &height, &numComponents, 4);
+    if (!pPixels)
+    {
+        DEBUG_PRINT("CPUTTextureCooker: unable to decode %s\n", sourceFileName.c_str());
+        return CPUT_TEXTURE_LOAD_ERROR;
+    }
+
+    // Whole mip chain, down to 1x1
+    std::vector< std::vector<unsigned char> > mips(1);
+    std::vector<UINT> mipWidths(1, (UINT)width), mipHeights(1, (UINT)height);
+    mips[0].assign(pPixels, pPixels + (size_t)width * height * 4);
+    stbi_image_free(pPixels);
+
+    float toLinear[256];
+    for (int ii = 0; ii < 256; ii++)
+    {
+        toLinear[ii] = SRGBToLinear(ii / 255.0f);
+    }
+    while (mipWidths.back() > 1 || mipHeights.back() > 1)
+    {
+        const UINT srcWidth = mipWidths.back(), srcHeight = mipHeights.back();
+        const UINT dstWidth = std::max(srcWidth / 2, 1u), dstHeight = std::max(srcHeight / 2, 1u);
+        mips.push_back(std::vector<unsigned char>((size_t)dstWidth * dstHeight * 4));
+        DownsampleRGBA8(&mips[mips.size() - 2][0], srcWidth, srcHeight, &mips.back()[0], dstWidth, dstHeight, toLinear, sRGB);
+        mipWidths.push_back(dstWidth);
+        mipHeights.push_back(dstHeight);
+    }
+
+    CookedSourceKey key;
+    key.mTag             = CPUT_TEXTURE_COOKER_TAG;
+    key.mVersionAndFlags = GetVersionAndFlags(sRGB);
+    SplitUINT64(CPUTHash64(sourceView.GetData(), sourceView.GetSize()), key.mHash);
+    SplitUINT64(sourceSize, key.mSourceSize);
+    SplitUINT64(sourceTime, key.mSourceTime);
+    sourceView.Close();
+
+    std::vector<char> output;
+#ifdef CPUT_TEXTURE_COOKER_DIRECTXTEX
+    if (format != CPUT_COOK_RGBA8)
+    {
+        DirectX::ScratchImage image, compressed;
+        HRESULT hr = image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, mips.size());
+        for (size_t mip = 0; SUCCEEDED(hr) && mip < mips.size(); mip++)
+        {
+            const DirectX::Image *pImage = image.GetImage(mip, 0, 0);
+            for (UINT y = 0; y < mipHeights[mip]; y++)
+            {
+                memcpy(pImage->pixels + y * pImage->rowPitch, &mips[mip][y * mipWidths[mip] * 4], mipWidths[mip] * 4);
+            }
+        }
+        DirectX::Blob blob;
+        if (SUCCEEDED(hr))
+        {
+            hr = DirectX::Compress(image.GetImages(), image.GetImageCount(), image.GetMetadata(),
+                (format == CPUT_COOK_BC1) ? DXGI_FORMAT_BC1_UNORM : DXGI_FORMAT_BC3_UNORM, DirectX::TEX_COMPRESS_PARALLEL, 0.5f, compressed);
+        }
+        if (SUCCEEDED(hr))
+        {
+            hr = DirectX::SaveToDDSMemory(compressed.GetImages(), compressed.GetImageCount(), compressed.GetMetadata(), DirectX::DDS_FLAGS_NONE, blob);
+        }
+        if (FAILED(hr) || blob.GetBufferSize() < sizeof(CookedDDSHeader))
+        {
+            DEBUG_PRINT("CPUTTextureCooker: BC compression failed for %s\n", sourceFileName.c_str());
+            return CPUT_ERROR;
+        }
+        output.assign((const char *)blob.GetBufferPointer(), (const char *)blob.GetBufferPointer() + blob.GetBufferSize());
+        memcpy(&output[0] + offsetof(CookedDDSHeader, mReserved1), &key, sizeof(key));
+    }
+#else
+    UNREFERENCED_PARAMETER(format);
+#endif
+    if (output.empty())
+    {
+        CookedDDSHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.mFileType, "DDS ", 4);
+        header.mSize              = sizeof(CookedDDSHeader) - 4; // the magic isn't part of DDS_HEADER
+        header.mFlags             = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PITCH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT;
+        header.mHeight            = height;
+        header.mWidth             = width;
+        header.mPitchOrLinearSize = width * 4;
+        header.mMipMapCount       = (UINT)mips.size();
+        memcpy(header.mReserved1, &key, sizeof(key));
+        header.mPixelFormat.mSize         = sizeof(CookedDDSPixelFormat);
+        header.mPixelFormat.mFlags        = DDPF_RGB | DDPF_ALPHAPIXELS;
+        header.mPixelFormat.mRGBBitCount  = 32;
+        header.mPixelFormat.mRedBitMask   = 0x000000FF;
+        header.mPixelFormat.mGreenBitMask = 0x0000FF00;
+        header.mPixelFormat.mBlueBitMask  = 0x00FF0000;
+        header.mPixelFormat.mAlphaBitMask = 0xFF000000;
+        header.mCaps = DDSCAPS_TEXTURE | (mips.size() > 1 ? (DDSCAPS_COMPLEX | DDSCAPS_MIPMAP) : 0);
+
+        output.assign((const char *)&header, (const char *)&header + sizeof(header));
+        for (size_t mip = 0; mip < mips.size(); mip++)
+        {
+            output.insert(output.end(), mips[mip].begin(), mips[mip].end());
+        }
+    }
+
+    pOutput->swap(output);
+    return CPUT_SUCCESS;
+}
@@ -29,6 +29,7 @@
 #include "CPUTComputeShaderDX11.h"
 #include "CPUTHullShaderDX11.h"
 #include "CPUTDomainShaderDX11.h"
+#include "CPUTShaderCompilerD3D.h"
 
 #define LIBRARY_ASSERT(a, b) ASSERT(a, b)
 
@@ -60,6 +61,10 @@ void CPUTAssetLibraryDX11::ReleaseAllLibraryLists()
     SAFE_RELEASE_LIST(mpGeometryShaderList);
     SAFE_RELEASE_LIST(mpHullShaderList);
     SAFE_RELEASE_LIST(mpDomainShaderList);
+    if (mpShaderCache)
+    {
+        mpShaderCache->ClearMemory();
+    }
 
     // Call base class implementation to clean up the non-DX object lists
     CPUTAssetLibrary::ReleaseAllLibraryLists();
@@ -379,8 +384,42 @@ CPUTResult CPUTAssetLibraryDX11::CreateComputeShaderFromMemory(
     return CPUT_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+CPUTShaderCache *CPUTAssetLibraryDX11::GetShaderCache()
+{
+    if (!mpShaderCache)
+    {
+        std::string executableDirectory;
+        CPUTFileSystem::GetExecutableDirectory(&executableDirectory);
+        mpShaderCache = new CPUTShaderCache(new CPUTShaderCompilerD3D());
+        mpShaderCache->SetCacheDirectory(executableDirectory + "ShaderCacheDX11/");
+    }
+    return mpShaderCache;
+}
+
+// CPUT_SHADER_MACRO lists end with a NULL name
+static void AppendShaderDefines(const CPUT_SHADER_MACRO *pShaderMacros, std::vector<CPUTShaderDefine> *pDefines)
+{
+    for (; pShaderMacros && pShaderMacros->Name; pShaderMacros++)
+    {
+        pDefines->push_back(CPUTShaderDefine(pShaderMacros->Name, pShaderMacros->Definition ? pShaderMacros->Definition : ""));
+    }
+}
+
+static CPUTResult CreateBlob(const std::vector<char> &bytecode, ID3DBlob **ppBlob)
+{
+    HRESULT hr = D3DCreateBlob(bytecode.size(), ppBlob);
+    if (FAILED(hr))
+    {
+        return CPUT_ERROR;
+    }
+    memcpy((*ppBlob)->GetBufferPointer(), &bytecode[0], bytecode.size());
+    return CPUT_SUCCESS;
+}
+
 // If filename ends in .fxo or .cso, then simply read the binary contents to an ID3DBlob.
-// Otherwise, generate the ID3DBlob using D3DCompileFromFile().
+// Otherwise the ID3DBlob comes from the shader cache, which calls D3DCompileFromFile() when
+// it hasn't seen this source, includes and macros before.
 //-----------------------------------------------------------------------------
 CPUTResult CPUTAssetLibraryDX11::CompileShaderFromFile(
     const std::string     &fileName,
@@ -413,67 +452,29 @@ CPUTResult CPUTAssetLibraryDX11::CompileShaderFromFile(
     }
     else
     {
-        char pShaderMainAsChar[128];
-        char pShaderProfileAsChar[128];
-        LIBRARY_ASSERT( shaderMain.length()     < 128, "Shader main name '"    + shaderMain    + "' longer than 128 chars." );
-        LIBRARY_ASSERT( shaderProfile.length()  < 128, "Shader profile name '" + shaderProfile + "' longer than 128 chars." );
-        strcpy_s( pShaderMainAsChar, 128, shaderMain.c_str());
-        strcpy_s( pShaderProfileAsChar, 128, shaderProfile.c_str());
-
-        // Prepare the macros
-        int macroCount = 0;
-        D3D_SHADER_MACRO *pTmp = (D3D_SHADER_MACRO *)pShaderMacros;
-        if( pTmp )
-        {
-            while( (pTmp++)->Name ) { macroCount++; }
-        }
-        const UINT NUM_ADDITIONAL_MACROS = 5;
-        D3D_SHADER_MACRO pAdditionalMacros[NUM_ADDITIONAL_MACROS] = {
-            { "_CPUT", "1" },
-            { "FOG_COLOR", "(float3( 0.89f, 0.92f, 0.88f )*0.5f)" },
-            { "FOG_START", "2000.0f" },
-            { "FOG_END",   "6000.0f" },
-            { NULL, NULL }
-        };
-        const int MAX_DEFINES = 128; // Note: use MAX_DEFINES to avoid dynamic allocation.  Arbitrarily choose 128.  Not sure if there is a real limit.
-        LIBRARY_ASSERT( macroCount<(MAX_DEFINES-NUM_ADDITIONAL_MACROS), "Too many shader macros." );
-        D3D_SHADER_MACRO pFinalShaderMacros[MAX_DEFINES];
-        memcpy( pFinalShaderMacros, pShaderMacros, macroCount*sizeof(D3D_SHADER_MACRO));
-        memcpy( &pFinalShaderMacros[macroCount], pAdditionalMacros, sizeof(pAdditionalMacros));
-
-        ID3DBlob *pErrorBlob = NULL;
-        uint32_t numWChars = MultiByteToWideChar(CP_UTF8, 0, fileName.c_str(), -1, NULL, 0);
-        wchar_t* wstr = new wchar_t[numWChars];
-        MultiByteToWideChar( CP_UTF8 , 0 , fileName.c_str() , -1, wstr , numWChars );
-
-        HRESULT hr = D3DCompileFromFile(
-            wstr,
-            pFinalShaderMacros,
-            D3D_COMPILE_STANDARD_FILE_INCLUDE, // includes
-            pShaderMainAsChar,
-            pShaderProfileAsChar,
-            0,                    // flags 1
-            0,                    // flags 2
-            ppBlob,
-            &pErrorBlob
-        );
-        delete[] wstr;
-        if (FAILED(hr))
+        CPUTShaderCompileRequest request;
+        request.fileName   = fileName;
+        request.entryPoint = shaderMain;
+        request.profile    = shaderProfile;
+        AppendShaderDefines(pShaderMacros, &request.defines);
+        CPUTShaderCompilerD3D::AddFileDefines(&request.defines);
+
+        const std::vector<char> *pBytecode = NULL;
+        std::string errors;
+        CPUTResult result = GetShaderCache()->GetBytecode(request, &pBytecode, &errors);
+        if (CPUTFAILED(result))
         {
-            if (hr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
+            if (result == CPUT_ERROR_FILE_NOT_FOUND)
                 DEBUGMESSAGEBOX("File load error", "File not found: " + fileName + ".")
             else
                 DEBUGMESSAGEBOX("Error Shader Creation", "Could not create shader: " + fileName + ".");
-//            LIBRARY_ASSERT(false, "Failed to load shader: " + fileName)
-  //              return CPUT_ERROR;
         }
-        LIBRARY_ASSERT( SUCCEEDED(hr), "Error compiling shader '" + fileName + "'.\n" + (pErrorBlob ? (char*)pErrorBlob->GetBufferPointer() : "no error message" ) );
-        UNREFERENCED_PARAMETER(hr);
-
-        if(pErrorBlob)
+        LIBRARY_ASSERT( CPUTSUCCESS(result), "Error compiling shader '" + fileName + "'.\n" + (errors.empty() ? "no error message" : errors) );
+        if (CPUTFAILED(result))
         {
-            pErrorBlob->Release();
+            return result;
         }
+        return CreateBlob(*pBytecode, ppBlob);
     } // Compiled from source
     return CPUT_SUCCESS;
 }
@@ -488,45 +489,19 @@ CPUTResult CPUTAssetLibraryDX11::CompileShaderFromMemory(
     CPUT_SHADER_MACRO *pShaderMacros
 )
 {
-    char pShaderMainAsChar[128];
-    char pShaderProfileAsChar[128];
-    LIBRARY_ASSERT( shaderMain.length()     < 128, "Shader main name '"    + shaderMain    + "' longer than 128 chars." );
-    LIBRARY_ASSERT( shaderProfile.length()  < 128, "Shader profile name '" + shaderProfile + "' longer than 128 chars." );
-    strcpy_s( pShaderMainAsChar, 128, shaderMain.c_str());
-    strcpy_s( pShaderProfileAsChar, 128, shaderProfile.c_str());
-
-    // Prepare the macros
-    int macroCount = 0;
-    D3D_SHADER_MACRO *pTmp = (D3D_SHADER_MACRO *)pShaderMacros;
-    if( pTmp )
-    {
-        while( (pTmp++)->Name ) { macroCount++; }
-    }
-
-    const int MAX_DEFINES = 128; // Note: use MAX_DEFINES to avoid dynamic allocation.  Arbitrarily choose 128.  Not sure if there is a real limit.
-    LIBRARY_ASSERT( macroCount<MAX_DEFINES, "Error compiling shader.\nToo many shader macros." );
-    D3D_SHADER_MACRO pFinalShaderMacros[MAX_DEFINES]; 
-    memcpy( pFinalShaderMacros, pShaderMacros, macroCount*sizeof(D3D_SHADER_MACRO));
-
-    ID3DBlob *pErrorBlob = NULL;
-    HRESULT hr = D3DCompile(
-        pShaderSource,
-        strlen( pShaderSource ),
-        shaderMain.c_str(),   // Use entrypoint as file name
-        pFinalShaderMacros,
-        D3D_COMPILE_STANDARD_FILE_INCLUDE, // includes
-        pShaderMainAsChar,
-        pShaderProfileAsChar,
-        0,                    // flags 1
-        0,                    // flags 2
-        ppBlob,
-        &pErrorBlob
-    );
-    LIBRARY_ASSERT( SUCCEEDED(hr), "Error compiling shader '" + shaderMain + "'.\n" + (pErrorBlob ? (char*)pErrorBlob->GetBufferPointer() : "no error message" ) );
-    UNREFERENCED_PARAMETER(hr);
-    if(pErrorBlob)
-    {
-        pErrorBlob->Release();
+    CPUTShaderCompileRequest request;
+    request.pSource    = pShaderSource;
+    request.entryPoint = shaderMain;
+    request.profile    = shaderProfile;
+    AppendShaderDefines(pShaderMacros, &request.defines);
+
+    const std::vector<char> *pBytecode = NULL;
+    std::string errors;
+    CPUTResult result = GetShaderCache()->GetBytecode(request, &pBytecode, &errors);
+    LIBRARY_ASSERT( CPUTSUCCESS(result), "Error compiling shader '" + shaderMain + "'.\n" + (errors.empty() ? "no error message" : errors) );
+    if (CPUTFAILED(result))
+    {
+        return result;
     }
-    return CPUT_SUCCESS;
+    return CreateBlob(*pBytecode, ppBlob);
 }
@@ -133,11 +133,30 @@ void CPUTGuiControllerDX11::UpdateConstantBuffer()
 //
 //------------------------------------------------------------------------
 CPUTResult CPUTGuiControllerDX11::UpdateUberBuffers()
+{
+    if(mUberBufferIndex > 0)
+    {
+        // only the vertices in use, not the whole buffer
+        UpdateUberBufferRange(0, mUberBufferIndex);
+    }
+    mpUberBuffer->SetNumVertices(mUberBufferIndex);
+    return CPUT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+CPUTResult CPUTGuiControllerDX11::UpdateUberBufferRange(UINT firstVertex, UINT numVertices)
 {
     ID3D11DeviceContext* pImmediateContext = CPUT_DX11::GetContext();
-    ASSERT(pImmediateContext, "CPUTGuiControllerDX11::UpdateUberBuffers - Context pointer is NULL");
+    ASSERT(pImmediateContext, "CPUTGuiControllerDX11::UpdateUberBufferRange - Context pointer is NULL");
     ID3D11Buffer* pVB = mpUberBuffer->GetVertexBuffer();
-    pImmediateContext->UpdateSubresource(pVB, 0, NULL, (void *)mpMirrorBuffer, sizeof(CPUTGUIVertex)*mUberBufferIndex+1, 0);
+    D3D11_BOX box;
+    box.left   = firstVertex*sizeof(CPUTGUIVertex);
+    box.right  = (firstVertex + numVertices)*sizeof(CPUTGUIVertex);
+    box.top    = 0;
+    box.bottom = 1;
+    box.front  = 0;
+    box.back   = 1;
+    pImmediateContext->UpdateSubresource(pVB, 0, &box, (void *)&mpMirrorBuffer[firstVertex], 0, 0);
     mpUberBuffer->SetNumVertices(mUberBufferIndex);
     return CPUT_SUCCESS;
 }
@@ -76,6 +76,7 @@ CPUTMaterialDX11::~CPUTMaterialDX11()
     SAFE_RELEASE(mpHullShader);
     SAFE_RELEASE(mpDomainShader);
     SAFE_RELEASE(mpRenderStateBlock);
+    SAFE_RELEASE(mpInstancedMaterial);
     CPUTMaterial::~CPUTMaterial();
 }
 
@@ -591,6 +592,13 @@ CPUTResult CPUTMaterialDX11::LoadMaterial(
         mpRenderStateBlock = pAssetLibrary->GetRenderStateBlock(pValue->ValueAsString());
     }
 
+    // load the instanced variant if there is one
+    pValue = mpConfigBlock->GetValueByName("InstancedMaterial");
+    if (pValue->IsValid())
+    {
+        mpInstancedMaterial = pAssetLibrary->GetMaterial(pValue->ValueAsString());
+    }
+
     OUTPUT_BINDING_DEBUG_INFO(("Bindings for : " + mMaterialName + "\n").c_str());
 
     // For each of the shader stages, bind shaders and buffers
@@ -198,6 +198,29 @@ void CPUTMeshDX11::Draw()
     }
 }
 
+//-----------------------------------------------------------------------------
+void CPUTMeshDX11::DrawInstanced(UINT instanceCount)
+{
+    // Skip empty meshes.
+    if( (mIndexCount == 0 && mVertexCount == 0) || instanceCount == 0 )
+     return; 
+
+    ID3D11DeviceContext *pContext = CPUT_DX11::GetContext();
+
+    pContext->IASetPrimitiveTopology( mD3DMeshTopology );
+    pContext->IASetVertexBuffers(0, 1, &mpVertexBuffer, &mVertexStride, &mVertexBufferOffset);
+
+    if (mIndexCount) 
+    {
+        pContext->IASetIndexBuffer(mpIndexBuffer, mIndexBufferFormat, 0);
+        pContext->DrawIndexedInstanced( mIndexCount, instanceCount, 0, 0, 0 );
+    }
+    else 
+    {
+        pContext->DrawInstanced( mVertexCount, instanceCount, 0, 0 );
+    }
+}
+
 // Sets the mesh topology, and converts it to it's DX format
 //-----------------------------------------------------------------------------
 void CPUTMeshDX11::SetMeshTopology(const eCPUT_MESH_TOPOLOGY meshTopology)
@@ -258,6 +281,28 @@ DXGI_FORMAT CPUTMeshDX11::ConvertToDirectXFormat(CPUT_DATA_FORMAT_TYPE dataForma
 			};
 			return componentCountToFormat[componentCount-1];
 		}
+    case CPUT_F16:
+    {
+        ASSERT( 3 != componentCount, "Invalid vertex element count." );
+        const DXGI_FORMAT componentCountToFormat[4] = {
+            DXGI_FORMAT_R16_FLOAT,
+            DXGI_FORMAT_R16G16_FLOAT,
+            DXGI_FORMAT_UNKNOWN, // Count of 3 is invalid for 16-bit type
+            DXGI_FORMAT_R16G16B16A16_FLOAT
+        };
+        return componentCountToFormat[componentCount-1];
+    }
+    case CPUT_SNORM8:
+    {
+        ASSERT( 3 != componentCount, "Invalid vertex element count." );
+        const DXGI_FORMAT componentCountToFormat[4] = {
+            DXGI_FORMAT_R8_SNORM,
+            DXGI_FORMAT_R8G8_SNORM,
+            DXGI_FORMAT_UNKNOWN, // Count of 3 is invalid for 8-bit type
+            DXGI_FORMAT_R8G8B8A8_SNORM
+        };
+        return componentCountToFormat[componentCount-1];
+    }
     default:
     {
         // todo: add all the other data types you want to support
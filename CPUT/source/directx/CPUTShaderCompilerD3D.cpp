@@ -0,0 +1,97 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "CPUTShaderCompilerD3D.h"
+#include "D3DCompiler.h"
+
+//-----------------------------------------------------------------------------
+std::string CPUTShaderCompilerD3D::GetCompilerId()
+{
+    char id[64];
+    sprintf(id, "D3DCompiler_%d %08x %08x", D3D_COMPILER_VERSION, mFlags1, mFlags2);
+    return id;
+}
+
+//-----------------------------------------------------------------------------
+bool CPUTShaderCompilerD3D::Compile(const CPUTShaderCompileRequest &request, std::vector<char> *pBytecode, std::string *pErrors)
+{
+    std::vector<D3D_SHADER_MACRO> macros(request.defines.size() + 1);
+    for (size_t ii = 0; ii < request.defines.size(); ii++)
+    {
+        macros[ii].Name       = request.defines[ii].name.c_str();
+        macros[ii].Definition = request.defines[ii].definition.c_str();
+    }
+    macros.back().Name       = NULL;
+    macros.back().Definition = NULL;
+
+    ID3DBlob *pBlob = NULL;
+    ID3DBlob *pErrorBlob = NULL;
+    HRESULT hr;
+    if (request.pSource)
+    {
+        hr = D3DCompile(
+            request.pSource,
+            strlen(request.pSource),
+            request.fileName.empty() ? request.entryPoint.c_str() : request.fileName.c_str(),
+            &macros[0],
+            D3D_COMPILE_STANDARD_FILE_INCLUDE,
+            request.entryPoint.c_str(),
+            request.profile.c_str(),
+            mFlags1,
+            mFlags2,
+            &pBlob,
+            &pErrorBlob
+        );
+    }
+    else
+    {
+        uint32_t numWChars = MultiByteToWideChar(CP_UTF8, 0, request.fileName.c_str(), -1, NULL, 0);
+        std::vector<wchar_t> wideFileName(numWChars);
+        MultiByteToWideChar(CP_UTF8, 0, request.fileName.c_str(), -1, &wideFileName[0], numWChars);
+        hr = D3DCompileFromFile(
+            &wideFileName[0],
+            &macros[0],
+            D3D_COMPILE_STANDARD_FILE_INCLUDE,
+            request.entryPoint.c_str(),
+            request.profile.c_str(),
+            mFlags1,
+            mFlags2,
+            &pBlob,
+            &pErrorBlob
+        );
+        if (hr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) && pErrors)
+        {
+            *pErrors = "File not found: " + request.fileName + ".";
+        }
+    }
+
+    if (pErrorBlob)
+    {
+        if (pErrors)
+        {
+            pErrors->assign((const char *)pErrorBlob->GetBufferPointer(), pErrorBlob->GetBufferSize());
+        }
+        pErrorBlob->Release();
+    }
+    if (FAILED(hr) || !pBlob)
+    {
+        SAFE_RELEASE(pBlob);
+        return false;
+    }
+    const char *pBytes = (const char *)pBlob->GetBufferPointer();
+    pBytecode->assign(pBytes, pBytes + pBlob->GetBufferSize());
+    pBlob->Release();
+    return true;
+}
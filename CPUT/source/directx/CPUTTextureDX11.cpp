@@ -15,6 +15,8 @@
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "CPUTTextureDX11.h"
+#include "CPUTOSServices.h"
+#include "CPUTTextureCooker.h"
 
 #include "DDSTextureLoader.h"
 
@@ -154,25 +156,61 @@ CPUTResult CPUTTextureDX11::CreateNativeTexture(
     bool ForceLoadAsSRGB)
 {
     HRESULT hr;
-    uint32_t numWChars = MultiByteToWideChar(CP_UTF8, 0, fileName.c_str(), -1, NULL, 0);
-    wchar_t* wstr = new wchar_t[numWChars];
-    MultiByteToWideChar( CP_UTF8 , 0 , fileName.c_str() , -1, wstr , numWChars );
 
-    hr = DirectX::CreateDDSTextureFromFileEx(
-        pD3dDevice,
-        wstr,
-        0,//maxsize
-        D3D11_USAGE_DEFAULT,
-        D3D11_BIND_SHADER_RESOURCE,
-        0,
-        0,
-        ForceLoadAsSRGB,
-        ppTexture,
-        ppShaderResourceView);
-    delete[] wstr;
+    // Only .dds is loaded here. For a source image use the cooked .dds next to it, see CPUTTextureCooker.h.
+    // When that is stale or missing the source is cooked in memory instead.
+    std::string loadFileName = fileName;
+    std::vector<char> cooked;
+    CPUTResult result = CPUT_SUCCESS;
+    if (CPUTTextureCooker::IsCookableFile(fileName))
+    {
+        loadFileName = CPUTTextureCooker::GetCookedFileName(fileName);
+        if (!CPUTTextureCooker::IsCookedFileUpToDate(fileName, loadFileName, ForceLoadAsSRGB))
+        {
+            DEBUG_PRINT("Cooked texture %s is missing or out of date, loading %s (run TextureCook on it)\n", loadFileName.c_str(), fileName.c_str());
+            result = CPUTTextureCooker::CookToMemory(fileName, ForceLoadAsSRGB, CPUT_COOK_RGBA8, &cooked);
+        }
+    }
+
+    // Map the file and create the texture straight from the view instead of
+    // having the loader read it into a temporary heap copy
+    CPUTFileSystem::CPUTFileView fileView;
+    const uint8_t *pData = NULL;
+    size_t dataSize = 0;
+    if (!cooked.empty())
+    {
+        pData = (const uint8_t *)&cooked[0];
+        dataSize = cooked.size();
+    }
+    else if (CPUTSUCCESS(result))
+    {
+        result = fileView.Open(loadFileName);
+        pData = (const uint8_t *)fileView.GetData();
+        dataSize = (size_t)fileView.GetSize();
+    }
+    if (CPUTSUCCESS(result))
+    {
+        hr = DirectX::CreateDDSTextureFromMemoryEx(
+            pD3dDevice,
+            pData,
+            dataSize,
+            0,//maxsize
+            D3D11_USAGE_DEFAULT,
+            D3D11_BIND_SHADER_RESOURCE,
+            0,
+            0,
+            ForceLoadAsSRGB,
+            ppTexture,
+            ppShaderResourceView);
+    }
+    else
+    {
+        hr = E_FAIL;
+    }
+    fileView.Close();
 	if( FAILED( hr ) )
 	{
-        if (hr == ERROR_FILE_NOT_FOUND)
+        if (result == CPUT_ERROR_FILE_NOT_FOUND)
         {
             DEBUGMESSAGEBOX("File load error", "File not found: " + fileName + ".");
         }
@@ -28,6 +28,7 @@ void CPUT_DX11::ReleaseResources()
 {
     CPUTGuiControllerDX11::DeleteController();
     SAFE_RELEASE(mpPerModelConstantBuffer);
+    SAFE_RELEASE(mpPerInstanceConstantBuffer);
     SAFE_RELEASE(mpPerFrameConstantBuffer);
     SAFE_RELEASE(mpSkinningDataConstantBuffer);
 
@@ -367,6 +368,11 @@ void CPUT_DX11::CreateResources()
     mpPerModelConstantBuffer = CPUTBuffer::Create(name, &desc);
     CPUTAssetLibrary::GetAssetLibrary()->AddConstantBuffer("", name, "", mpPerModelConstantBuffer);
 
+    name = "$cbPerInstanceValues";
+    desc.sizeBytes = sizeof(CPUTInstanceConstantBuffer);
+    mpPerInstanceConstantBuffer = CPUTBuffer::Create(name, &desc);
+    CPUTAssetLibrary::GetAssetLibrary()->AddConstantBuffer("", name, "", mpPerInstanceConstantBuffer);
+
     name = "$cbSkinningValues";
     desc.sizeBytes = sizeof(CPUTAnimationConstantBuffer);
     mpSkinningDataConstantBuffer = CPUTBuffer::Create(name, &desc);
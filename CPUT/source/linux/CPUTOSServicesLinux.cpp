@@ -16,20 +16,25 @@
 #include "CPUTOSServices.h"
 #ifdef CPUT_OS_ANDROID
 #include "CPUTWindowAndroid.h"
-#elif CPUT_OS_LINUX
-#include "CPUTWindowX.h"
-#endif
 #include "CPUT_OGL.h"
+#endif
 
 #include <iostream>
 
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <string.h>
 #include <libgen.h>
 #include <unistd.h>
 #include <stdarg.h>
 
+// Nothing on Linux needs the window or GL, so tools and tests can build this file on its own
+#ifndef DEBUG_ERROR
+#define DEBUG_ERROR(message) DEBUG_PRINT("%s\n", std::string(message).c_str())
+#endif
+
 // Retrieves the current working directory
 //-----------------------------------------------------------------------------
 CPUTResult CPUTFileSystem::GetWorkingDirectory(std::string *pPath)
@@ -296,57 +301,146 @@ CPUTResult CPUTFileSystem::ReadFileContents(const std::string &fileName, UINT *p
     AAssetDir_close(assetDir); 
 
 #else // CPUT_USE_ANDROID_ASSET_MANAGER
-    FILE *pFile = NULL;
-
     DEBUG_PRINT("ReadFileContents: %s", fileName.c_str());
 
-    if (bLoadAsBinary) {
-#if defined (UNICODE) || defined(_UNICODE)
-    	_wfopen_s(&pFile, fileName.c_str(), "rb");
+    // Text and binary mode are the same thing here, so both copy straight out
+    // of a mapped view of the file instead of going through stdio
+    UNREFERENCED_PARAMETER(bLoadAsBinary);
+    CPUTFileView view;
+    CPUTResult result = view.Open(fileName);
+    if (CPUTFAILED(result))
+    {
+        return result;
+    }
+
+    *pSizeInBytes = (UINT)view.GetSize();
+    *ppData = (void*) new char[*pSizeInBytes + 1];
+    ASSERT( *ppData, "Out of memory" );
+    memcpy(*ppData, view.GetData(), *pSizeInBytes);
+    if (bAddTerminator)
+    {
+        ((char *)(*ppData))[*pSizeInBytes] = '\0';
+        (*pSizeInBytes)++;
+    }
+    return CPUT_SUCCESS;
+
+#endif // CPUT_USE_ANDROID_ASSET_MANAGER 
+    // some kind of file error, translate the error code and return it
+    return CPUT_ERROR;
+//    return TranslateFileError(err);
+
+}
+
+// Get the size and last modification time of a file without opening it
+//-----------------------------------------------------------------------------
+CPUTResult CPUTFileSystem::GetFileInfo(const std::string &fileName, uint64_t *pSizeInBytes, uint64_t *pModifiedTime)
+{
+#ifdef CPUT_USE_ANDROID_ASSET_MANAGER
+    // Assets are packed in the APK, there is no modification time to compare against
+    return CPUT_ERROR;
 #else
-    	pFile = fopen(fileName.c_str(), "rb");
+    struct stat fileAttributes;
+    if (stat(fileName.c_str(), &fileAttributes) == -1)
+    {
+        return CPUT_ERROR_FILE_NOT_FOUND;
+    }
+
+    *pSizeInBytes  = (uint64_t)fileAttributes.st_size;
+    *pModifiedTime = (uint64_t)fileAttributes.st_mtim.tv_sec * 10000000 + (uint64_t)fileAttributes.st_mtim.tv_nsec / 100;
+    return CPUT_SUCCESS;
 #endif
-    } else {
-#if defined (UNICODE) || defined(_UNICODE)
-    	_wfopen_s(&pFile, fileName.c_str(), "r");
+}
+
+// Map a file read-only, or read it into memory if it can't be mapped
+//-----------------------------------------------------------------------------
+CPUTResult CPUTFileSystem::CPUTFileView::Open(const std::string &fileName, bool bSequential)
+{
+    Close();
+
+#ifdef CPUT_USE_ANDROID_ASSET_MANAGER
+    UNREFERENCED_PARAMETER(bSequential);
+    UINT sizeInBytes = 0;
+    CPUTResult result = ReadFileContents(fileName, &sizeInBytes, (void **)&mpBuffer, false, true);
+    if (CPUTFAILED(result))
+    {
+        return result;
+    }
+    mpData = mpBuffer;
+    mSize  = sizeInBytes;
+    return CPUT_SUCCESS;
 #else
-    	pFile = fopen(fileName.c_str(), "r");
-#endif
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return TranslateFileError(errno);
+    }
+
+    struct stat fileAttributes;
+    if (fstat(fd, &fileAttributes) == -1 || !S_ISREG(fileAttributes.st_mode))
+    {
+        close(fd);
+        return CPUT_ERROR_FILE_ERROR;
     }
+    mSize = (uint64_t)fileAttributes.st_size;
 
-    if(pFile)
+    if (mSize == 0)
     {
-        // get file size
-        fseek(pFile, 0, SEEK_END);
-        *pSizeInBytes = ftell(pFile);
-        fseek (pFile, 0, SEEK_SET);
-
-        // allocate buffer
-        if (bAddTerminator)
-            *ppData = (void*) new char[*pSizeInBytes + 1];
-        else
-            *ppData = (void*) new char[*pSizeInBytes];
-        ASSERT( *ppData, "Out of memory" );
-
-        // read it all in
-        UINT numBytesRead = (UINT) fread(*ppData, sizeof(char), *pSizeInBytes, pFile);
-        if (bAddTerminator)
+        // mmap refuses empty files, and there is nothing to read anyway
+        close(fd);
+        mpData = "";
+        return CPUT_SUCCESS;
+    }
+
+    void *pMapping = mmap(NULL, (size_t)mSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (pMapping != MAP_FAILED)
+    {
+        if (bSequential)
         {
-            ((char *)(*ppData))[numBytesRead++] = '\0';
-            *pSizeInBytes++;
+            madvise(pMapping, (size_t)mSize, MADV_SEQUENTIAL);
         }
-        ASSERT( numBytesRead == *pSizeInBytes, "File read byte count mismatch." );
-
-        // close and return
-        fclose(pFile);
+        close(fd); // the mapping holds its own reference to the file
+        mpMapping = pMapping;
+        mpData    = (const char *)pMapping;
         return CPUT_SUCCESS;
     }
 
-#endif // CPUT_USE_ANDROID_ASSET_MANAGER 
-    // some kind of file error, translate the error code and return it
-    return CPUT_ERROR;
-//    return TranslateFileError(err);
+    // Some file systems can't be mapped, fall back to reading the file
+    mpBuffer = new char[(size_t)mSize];
+    uint64_t numBytesRead = 0;
+    while (numBytesRead < mSize)
+    {
+        ssize_t count = read(fd, mpBuffer + numBytesRead, (size_t)(mSize - numBytesRead));
+        if (count <= 0)
+        {
+            if (count == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            close(fd);
+            Close();
+            return CPUT_ERROR_FILE_IO_ERROR;
+        }
+        numBytesRead += (uint64_t)count;
+    }
+    close(fd);
+    mpData = mpBuffer;
+    return CPUT_SUCCESS;
+#endif
+}
 
+//-----------------------------------------------------------------------------
+void CPUTFileSystem::CPUTFileView::Close()
+{
+#ifndef CPUT_USE_ANDROID_ASSET_MANAGER
+    if (mpMapping)
+    {
+        munmap(mpMapping, (size_t)mSize);
+    }
+#endif
+    SAFE_DELETE_ARRAY(mpBuffer);
+    mpMapping = NULL;
+    mpData    = NULL;
+    mSize     = 0;
 }
 
 // Open a system dialog box
@@ -531,7 +625,11 @@ void CPUTLog::vLog(int priority, const char *format, va_list args)
     char *sOut;
     int len;
 
-    len = vsnprintf(NULL, 0, format, args) + 1;
+    // Measuring uses up a va_list, so measure with a copy
+    va_list measureArgs;
+    va_copy(measureArgs, args);
+    len = vsnprintf(NULL, 0, format, measureArgs) + 1;
+    va_end(measureArgs);
 
     int outputBufferSize = prefix.size() + len;
     sOut = (char *)malloc(outputBufferSize * sizeof(char));
@@ -548,7 +646,7 @@ void CPUTLog::vLog(int priority, const char *format, va_list args)
 #endif
 
     // Always send to output
-    cout << sOut;
+    std::cout << sOut;
     free(sOut);
 }
 
@@ -15,6 +15,8 @@
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "CPUTBufferOGL.h"
+#include "CPUTStreamingBufferOGL.h"
+#include <vector>
 
 CPUTBuffer* CPUTBuffer::Create(std::string &name, CPUTBufferDesc* pDesc)
 {
@@ -23,12 +25,47 @@ CPUTBuffer* CPUTBuffer::Create(std::string &name, CPUTBufferDesc* pDesc)
 
 CPUTBufferOGL::~CPUTBufferOGL()
 {
+    if (mTarget == BUFFER_UNIFORM)
+    {
+        CPUTStreamingBufferOGL::ForgetUniformBuffer(mBufferID);
+    }
     glDeleteBuffers(1, &mBufferID);
 }
 void CPUTBufferOGL::SetData(UINT offset, UINT size, void* pData)
 {
     if (offset + size <= mSizeBytes)
     {
+        CPUTStreamingBufferOGL *pStreamingBuffer = CPUTStreamingBufferOGL::GetStreamingBuffer();
+
+        // Uniform blocks are bound where they were written in the streaming ring, no copy
+        if (mTarget == BUFFER_UNIFORM)
+        {
+            if (!pStreamingBuffer->IsUniformBufferKnown(mBufferID) && (offset != 0 || size != mSizeBytes))
+            {
+                // The ring gets the whole block, start from what the buffer holds (once)
+                std::vector<char> contents(mSizeBytes);
+                GetData(&contents[0]);
+                memcpy(&contents[offset], pData, size);
+                if (CPUTSUCCESS(pStreamingBuffer->SetUniformData(mBufferID, mSizeBytes, 0, mSizeBytes, &contents[0])))
+                {
+                    return;
+                }
+            }
+            else if (CPUTSUCCESS(pStreamingBuffer->SetUniformData(mBufferID, mSizeBytes, offset, size, pData)))
+            {
+                return;
+            }
+        }
+
+        // Other data that changes every frame goes through the ring too, so the write never
+        // waits on the GPU still reading this buffer's previous contents
+        if (mMemory == BUFFER_DYNAMIC || mMemory == BUFFER_STREAMING || mTarget == BUFFER_UNIFORM)
+        {
+            if (CPUTSUCCESS(pStreamingBuffer->Upload(mBufferID, offset, size, pData)))
+            {
+                return;
+            }
+        }
         GL_CHECK(glBindBuffer(mGLTarget, mBufferID));
         GL_CHECK(glBufferSubData(mGLTarget, offset, size, pData));
         GL_CHECK(glBindBuffer(mGLTarget, 0));
@@ -42,7 +79,7 @@ void CPUTBufferOGL::SetData(UINT offset, UINT size, void* pData)
 void CPUTBufferOGL::GetData(void* pData)
 {
     GL_CHECK(glBindBuffer(mGLTarget, mBufferID));
-    void* pMappedData = glMapBufferRange(mTarget, 0, mSizeBytes, GL_MAP_READ_BIT);
+    void* pMappedData = glMapBufferRange(mGLTarget, 0, mSizeBytes, GL_MAP_READ_BIT);
     memcpy(pData, pMappedData, mSizeBytes);
     glUnmapBuffer(mGLTarget);
     GL_CHECK(glBindBuffer(mGLTarget, 0));
@@ -23,6 +23,8 @@
 #include "CPUTBufferOGL.h"
 #include "CPUTShaderOGL.h"
 #include "CPUTAssetLibraryOGL.h"
+#include "CPUTProgramCacheOGL.h"
+#include "CPUTStreamingBufferOGL.h"
 #define OUTPUT_BINDING_DEBUG_INFO(x)
 
 void ReadMacrosFromConfigBlock(
@@ -33,6 +35,7 @@ void ReadMacrosFromConfigBlock(
     CPUT_SHADER_MACRO **pFinalShaderMacros
     );
 int UniformTypeSize(unsigned int glType);
+static void ApplyProgramReflection(GLuint shaderProgram, const CPUTProgramReflectionOGL &reflection, CPUTShaderParameters *pShaderParameter, ConstantBufferDescription *pConstantBuffer);
 //-----------------------------------------------------------------------------
 CPUTShaderParameters::~CPUTShaderParameters()
 {
@@ -107,7 +110,7 @@ void CPUTMaterialOGL::SetRenderStates()
         for (unsigned int ii=0; ii < mVertexShaderParameters.mConstantBufferCount; ii++ )
         {
             GLint bindPoint = mVertexShaderParameters.mConstantBufferBindPoint[ii];
-	        GL_CHECK(glBindBufferBase(GL_UNIFORM_BUFFER, bindPoint, ((CPUTBufferOGL*)mVertexShaderParameters.mpConstantBuffer[ii])->GetBufferID()));
+	        CPUTStreamingBufferOGL::GetStreamingBuffer()->BindUniformBuffer(bindPoint, ((CPUTBufferOGL*)mVertexShaderParameters.mpConstantBuffer[ii])->GetBufferID());
         }
 #ifdef CPUT_SUPPORT_IMAGE_STORE
     if( mVertexShaderParameters.mUAVCount)
@@ -172,7 +175,7 @@ void SetMaterialStates(CPUTMaterial* pNewBase, CPUTMaterial* pCurrentBase)
     for (unsigned int ii = 0; ii < pNew->mVertexShaderParameters.mConstantBufferCount; ii++)
     {
         GLint bindPoint = pNew->mVertexShaderParameters.mConstantBufferBindPoint[ii];
-        GL_CHECK(glBindBufferBase(GL_UNIFORM_BUFFER, bindPoint, ((CPUTBufferOGL*)pNew->mVertexShaderParameters.mpConstantBuffer[ii])->GetBufferID()));
+        CPUTStreamingBufferOGL::GetStreamingBuffer()->BindUniformBuffer(bindPoint, ((CPUTBufferOGL*)pNew->mVertexShaderParameters.mpConstantBuffer[ii])->GetBufferID());
     }
 #ifdef CPUT_SUPPORT_IMAGE_STORE
     if (mVertexShaderParameters.mUAVCount)
@@ -359,57 +362,37 @@ CPUTResult CPUTMaterialOGL::LoadMaterial(
     }
 
 
-    int IsLinked;
-    char *shaderProgramInfoLog;
-    int maxLength;
-    
-     mShaderProgram = glCreateProgram();
- 
+    GLuint shaders[5];
+    int numShaders = 0;
     if (mpVertexShader) {
-        GL_CHECK(glAttachShader(mShaderProgram, mpVertexShader->GetShaderID()));
+        shaders[numShaders++] = mpVertexShader->GetShaderID();
     }
     if (mpFragmentShader) {
-        GL_CHECK(glAttachShader(mShaderProgram, mpFragmentShader->GetShaderID()));
+        shaders[numShaders++] = mpFragmentShader->GetShaderID();
     }
     if (mpControlShader) {
-        GL_CHECK(glAttachShader(mShaderProgram, mpControlShader->GetShaderID()));
+        shaders[numShaders++] = mpControlShader->GetShaderID();
     }
     if (mpEvaluationShader) {
-        GL_CHECK(glAttachShader(mShaderProgram, mpEvaluationShader->GetShaderID()));
+        shaders[numShaders++] = mpEvaluationShader->GetShaderID();
     }
 	if (mpGeometryShader) {
-		GL_CHECK(glAttachShader(mShaderProgram, mpGeometryShader->GetShaderID()));
+		shaders[numShaders++] = mpGeometryShader->GetShaderID();
 	}
-    // Link our program
-    // At this stage, the vertex and fragment programs are inspected, optimized and a binary code is generated for the shader.
-    // The binary code is uploaded to the GPU, if there is no error.
-    GL_CHECK(glLinkProgram(mShaderProgram));
- 
-    // Again, we must check and make sure that it linked. If it fails, it would mean either there is a mismatch between the vertex
-    // and fragment shaders. It might be that you have surpassed your GPU's abilities. Perhaps too many ALU operations or
-    // too many texel fetch instructions or too many interpolators or dynamic loops.
- 
-    GL_CHECK(glGetProgramiv(mShaderProgram, GL_LINK_STATUS, (int *)&IsLinked));
-    if(IsLinked == false)
+
+    // Compiles and links unless the program binary and its reflection are in the cache
+    CPUTProgramCacheOGL *pProgramCache = CPUTProgramCacheOGL::GetProgramCache();
+    CPUTProgramReflectionOGL reflection;
+    bool bReflected = false;
+    uint64_t programKey = 0;
+    mShaderProgram = pProgramCache->LinkProgram(shaders, numShaders, &reflection, &bReflected, &programKey);
+    if (!bReflected)
     {
-        // Noticed that glGetProgramiv is used to get the length for a shader program, not glGetShaderiv.
-        glGetProgramiv(mShaderProgram, GL_INFO_LOG_LENGTH, &maxLength);
- 
-        // The maxLength includes the NULL character
-        shaderProgramInfoLog = (char *)malloc(maxLength);
- 
-        // Notice that glGetProgramInfoLog, not glGetShaderInfoLog.
-        glGetProgramInfoLog(mShaderProgram, maxLength, &maxLength, shaderProgramInfoLog);
-        DEBUG_PRINT("Failed to link shader program:\n%s\n", shaderProgramInfoLog);
-        ASSERT(false, "glLinkProgram failed");
-
-        // Handle the error in an appropriate way such as displaying a message or writing to a log file.
-        // In this simple program, we'll just leave
-        free(shaderProgramInfoLog);
+        // Shader must be successfully linked before we can query uniform locations
+        CPUTProgramCacheOGL::ReflectProgram(mShaderProgram, &reflection);
+        pProgramCache->StoreProgram(mShaderProgram, programKey, reflection);
     }
-    
-    // Shader must be successfully linked before we can query uniform locations
-    ReadShaderSamplersAndTextures( mShaderProgram, &mVertexShaderParameters );
+    ApplyProgramReflection(mShaderProgram, reflection, &mVertexShaderParameters, &mConstantBuffer);
     glUseProgram(0);
     {
         BindTextures(        mVertexShaderParameters);
@@ -516,120 +499,84 @@ void CheckDebugLog2()
 #endif
 }
 
+// Texture, image and uniform block slots from a reflected (or cached) program, and the
+// buffer behind the material externals block
 //-----------------------------------------------------------------------------
-void CPUTMaterialOGL::ReadShaderSamplersAndTextures( GLuint shaderProgram, CPUTShaderParameters *pShaderParameter )
+static void ApplyProgramReflection(GLuint shaderProgram, const CPUTProgramReflectionOGL &reflection, CPUTShaderParameters *pShaderParameter, ConstantBufferDescription *pConstantBuffer)
 {
-    GLint numActiveUniforms;
-    GLint activeUniformMaxLength;
-    GL_CHECK(glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORMS, &numActiveUniforms));
-    GL_CHECK(glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &activeUniformMaxLength));
-    
-    GLint numActiveUniformBlocks;
-    GLint activeUniformBlockMaxLength = 50;
-    GL_CHECK(glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_BLOCKS, &numActiveUniformBlocks));
-	//
-	// #### This parameter is currently unsupported by Intel OGL drivers.
-	//
-    
-    GLchar* uniformVariableName = new GLchar[activeUniformMaxLength];
-    GLenum  dataType;
-    GLint   size;
-    for (int i = 0; i < numActiveUniforms; i++) {
-        GL_CHECK(glGetActiveUniform(shaderProgram, i, activeUniformMaxLength, NULL, &size, &dataType, uniformVariableName));
-        switch(dataType) {
-#ifndef CPUT_FOR_OGLES
-            case GL_SAMPLER_1D:
-#endif
-        case GL_SAMPLER_2D:
-        case GL_SAMPLER_3D:
-		case GL_SAMPLER_2D_SHADOW:
-        case GL_SAMPLER_CUBE:
-		        pShaderParameter->mpTextureName.push_back(uniformVariableName);
-                pShaderParameter->mpTextureLocation.push_back(glGetUniformLocation(shaderProgram, uniformVariableName));
-                pShaderParameter->mTextureCount++;
-                break;
+    for (size_t i = 0; i < reflection.textureNames.size(); i++)
+    {
+        pShaderParameter->mpTextureName.push_back(reflection.textureNames[i]);
+        pShaderParameter->mpTextureLocation.push_back(glGetUniformLocation(shaderProgram, reflection.textureNames[i].c_str()));
+        pShaderParameter->mTextureCount++;
+    }
 #ifdef CPUT_SUPPORT_IMAGE_STORE
-        case GL_IMAGE_2D:
-            pShaderParameter->mpUAVParameterNames.push_back(uniformVariableName);
-            pShaderParameter->mpUAVParameterLocations.push_back(glGetUniformLocation(shaderProgram, uniformVariableName));
-            pShaderParameter->mUAVParameterCount++;
-            break;
-#endif
-            default:
-                // unsupported uniform type
-            break;
-        }
+    for (size_t i = 0; i < reflection.imageNames.size(); i++)
+    {
+        pShaderParameter->mpUAVParameterNames.push_back(reflection.imageNames[i]);
+        pShaderParameter->mpUAVParameterLocations.push_back(glGetUniformLocation(shaderProgram, reflection.imageNames[i].c_str()));
+        pShaderParameter->mUAVParameterCount++;
     }
-	delete[] uniformVariableName;
+#endif
 
-    GLchar* uniformBlockName = new GLchar[activeUniformBlockMaxLength];
-    for (int i = 0; i < numActiveUniformBlocks; i++) 
+    for (int i = 0; i < (int)reflection.blockNames.size(); i++)
     {
-        GL_CHECK(glGetActiveUniformBlockName(shaderProgram, i, activeUniformBlockMaxLength, NULL, uniformBlockName));
-        pShaderParameter->mConstantBufferName.push_back(uniformBlockName);
-		GL_CHECK(pShaderParameter->mConstantBufferBindPoint.push_back(glGetUniformBlockIndex(shaderProgram, uniformBlockName)));
+        pShaderParameter->mConstantBufferName.push_back(reflection.blockNames[i]);
+		GL_CHECK(pShaderParameter->mConstantBufferBindPoint.push_back(glGetUniformBlockIndex(shaderProgram, reflection.blockNames[i].c_str())));
         pShaderParameter->mConstantBufferCount++;
-		GLsizei numUniforms;
-		GLint blockSize;
-		if (!strcmp(uniformBlockName, EXTERNALS_SHADER_NAME.c_str()))
+		if (i == reflection.externalsBlock)
 		{
-
-			GL_CHECK(glGetActiveUniformBlockiv(shaderProgram, i, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize));
-			mConstantBuffer.pData = new char[blockSize];
-			mConstantBuffer.size = blockSize;
+			const int blockSize = reflection.externalsSize;
+			pConstantBuffer->pData = new char[blockSize];
+			pConstantBuffer->size = blockSize;
             CPUTBufferDesc desc;
             desc.cpuAccess = BUFFER_CPU_WRITE;
             desc.memory = BUFFER_DYNAMIC;
             desc.target = BUFFER_UNIFORM;
-            desc.pData = mConstantBuffer.pData;
+            desc.pData = pConstantBuffer->pData;
             desc.sizeBytes = blockSize;
             std::string buffername = "Material Externals";
 
 			//mConstantBuffer.pBuffer = CPUTBufferOGL::Create("Material Externals", GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW, blockSize, mConstantBuffer.pData);
-            mConstantBuffer.pBuffer = CPUTBuffer::Create(buffername, &desc);
-
-			pShaderParameter->mpConstantBuffer[i] = mConstantBuffer.pBuffer;
-            mConstantBuffer.pBuffer->AddRef();
-			GL_CHECK(glGetActiveUniformBlockiv(shaderProgram, i, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &numUniforms));
-			mConstantBuffer.numUniforms = numUniforms;
-            GLint* uniformArrayLengths = new GLint[numUniforms];
-			GLuint* uniformIndices = new GLuint[numUniforms];
-			GLint* uniformTypes = new GLint[numUniforms];
-			GLint* uniformOffsets = new GLint[numUniforms];
-			GLint* uniformSizes = new int[numUniforms];
-
-            mConstantBuffer.pUniformArrayLengths = (int*)uniformArrayLengths;
-            mConstantBuffer.pUniformIndices = (int*)uniformIndices;
-			mConstantBuffer.pUniformNames = new std::string[numUniforms];
-            mConstantBuffer.pUniformOffsets = (int*)uniformOffsets;
-			mConstantBuffer.pUniformSizes = (int*)uniformSizes;
-            mConstantBuffer.pUniformTypes = (int*)uniformTypes;
-
-			GL_CHECK(glGetActiveUniformBlockiv(shaderProgram, i, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, (GLint*)uniformIndices));
-			glGetActiveUniformsiv(shaderProgram, numUniforms, uniformIndices, GL_UNIFORM_TYPE, uniformTypes);
-			glGetActiveUniformsiv(shaderProgram, numUniforms, uniformIndices, GL_UNIFORM_OFFSET, uniformOffsets);
-            glGetActiveUniformsiv(shaderProgram, numUniforms, uniformIndices, GL_UNIFORM_SIZE, uniformArrayLengths);
-
-
-			GLchar* name = new GLchar[activeUniformMaxLength];
+            pConstantBuffer->pBuffer = CPUTBuffer::Create(buffername, &desc);
+
+			pShaderParameter->mpConstantBuffer[i] = pConstantBuffer->pBuffer;
+            pConstantBuffer->pBuffer->AddRef();
+
+			const int numUniforms = (int)reflection.externals.size();
+			pConstantBuffer->numUniforms = numUniforms;
+            pConstantBuffer->pUniformArrayLengths = new int[numUniforms];
+            pConstantBuffer->pUniformIndices = new int[numUniforms];
+			pConstantBuffer->pUniformNames = new std::string[numUniforms];
+            pConstantBuffer->pUniformOffsets = new int[numUniforms];
+			pConstantBuffer->pUniformSizes = new int[numUniforms];
+            pConstantBuffer->pUniformTypes = new int[numUniforms];
+
+			std::vector<const GLchar*> names(numUniforms);
 			for (int uniform = 0; uniform < numUniforms; uniform++)
 			{
-				GLint size;
-				GLenum type;
-				GL_CHECK(glGetActiveUniform(shaderProgram,
-					uniformIndices[uniform],
-					activeUniformMaxLength,
-					NULL,
-					&size,
-					&type,
-					name));
-				mConstantBuffer.pUniformNames[uniform] = std::string(name);
-                mConstantBuffer.pUniformSizes[uniform] = UniformTypeSize(mConstantBuffer.pUniformTypes[uniform]);
-            }
-            delete[] name;
+				const CPUTProgramReflectionOGL::Uniform &member = reflection.externals[uniform];
+				pConstantBuffer->pUniformNames[uniform] = member.name;
+				pConstantBuffer->pUniformTypes[uniform] = member.type;
+				pConstantBuffer->pUniformOffsets[uniform] = member.offset;
+				pConstantBuffer->pUniformArrayLengths[uniform] = member.arrayLength;
+                pConstantBuffer->pUniformSizes[uniform] = UniformTypeSize(member.type);
+				names[uniform] = member.name.c_str();
+			}
+			if (numUniforms > 0)
+			{
+				glGetUniformIndices(shaderProgram, numUniforms, &names[0], (GLuint*)pConstantBuffer->pUniformIndices);
+			}
 		}       
 	}
-    delete[] uniformBlockName;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTMaterialOGL::ReadShaderSamplersAndTextures( GLuint shaderProgram, CPUTShaderParameters *pShaderParameter )
+{
+    CPUTProgramReflectionOGL reflection;
+    CPUTProgramCacheOGL::ReflectProgram(shaderProgram, &reflection);
+    ApplyProgramReflection(shaderProgram, reflection, pShaderParameter, &mConstantBuffer);
 }
 
 void CPUTMaterialOGL::BindTextures( CPUTShaderParameters &params)
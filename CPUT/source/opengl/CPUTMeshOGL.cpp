@@ -17,6 +17,18 @@
 #include "CPUT_OGL.h"
 #include "CPUTMeshOGL.h"
 #include "CPUTMaterial.h"
+#include "CPUTRangeAllocator.h"
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <vector>
+
+// glDrawElementsBaseVertex is GL 3.2, ES only has it from 3.2
+#ifndef CPUT_FOR_OGLES
+#define CPUT_MESH_ARENA
+#endif
+
+class CPUTMeshArenaPage;
 
 GLenum ConvertToOpenGLFormat(CPUT_DATA_FORMAT_TYPE dataFormatType) {
 
@@ -50,8 +62,12 @@ GLenum ConvertToOpenGLFormat(CPUT_DATA_FORMAT_TYPE dataFormatType) {
             break;
         case CPUT_I8:
         case CPUT_CHAR:
+        case CPUT_SNORM8:
             return GL_BYTE;
             break;
+        case CPUT_F16:
+            return GL_HALF_FLOAT;
+            break;
         case CPUT_BOOL:
             return GL_BOOL;
             break;
@@ -69,19 +85,36 @@ return 0;
 class CPUTVertexArrayOGL
 {
 private:
+    friend class CPUTMeshArenaOGL;
+
 
     CPUTVertexArrayOGL(GLint vertexElementCount) :
-    mIndexBufferID(0), mVertexBufferID(0), mVertexElementCount(vertexElementCount)
+    mIndexBufferID(0), mVertexBufferID(0), mVertexElementCount(vertexElementCount),
+    mpArenaPage(NULL), mBaseVertex(0), mVertexCount(0), mFirstIndex(0), mIndexCount(0)
     {
         GL_CHECK(glGenVertexArrays(1, &mVertexArray)); 
         GL_CHECK(glBindVertexArray(mVertexArray));
     }
+
+    // A mesh packed into an arena page, drawn with the page's vertex array at an offset
+    CPUTVertexArrayOGL(CPUTMeshArenaPage *pPage, GLuint vertexArray, UINT baseVertex, UINT vertexCount, UINT firstIndex, UINT indexCount) :
+    mIndexBufferID(0), mVertexBufferID(0), mVertexElementCount(0), mVertexArray(vertexArray),
+    mpArenaPage(pPage), mBaseVertex(baseVertex), mVertexCount(vertexCount), mFirstIndex(firstIndex), mIndexCount(indexCount)
+    {
+    }
 	
 public:
     GLint mIndexBufferID;
     GLint mVertexBufferID;
     GLint mVertexElementCount;
     GLuint mVertexArray;
+
+    // Only set for meshes living in an arena page, mVertexArray then belongs to the page
+    CPUTMeshArenaPage *mpArenaPage;
+    UINT mBaseVertex;
+    UINT mVertexCount;
+    UINT mFirstIndex;
+    UINT mIndexCount;
         
 public:
     
@@ -90,13 +123,7 @@ public:
             mIndexBufferID = pBuffer->GetBufferID(); } 
     void AddVBO(CPUTBufferOGL *pBuffer) { if(pBuffer) mVertexBufferID = pBuffer->GetBufferID(); } 
     
-    virtual ~CPUTVertexArrayOGL()
-    {
-        if (mVertexArray != 0)
-        {
-            GL_CHECK(glDeleteVertexArrays(1, &mVertexArray));
-        }
-    }
+    virtual ~CPUTVertexArrayOGL();
     
     void AddVertexPointer(GLint index, GLint count, GLenum type, GLboolean norm, GLint stride, void * offset)
     {
@@ -126,6 +153,18 @@ public:
         GL_CHECK(glBindVertexArray(mVertexArray));
     }
     
+    void DrawElements(GLenum mode, GLsizei indexCount)
+    {
+#ifdef CPUT_MESH_ARENA
+        if (mpArenaPage)
+        {
+            GL_CHECK(glDrawElementsBaseVertex(mode, indexCount, GL_UNSIGNED_INT, (void *)(mFirstIndex * sizeof(UINT)), mBaseVertex));
+            return;
+        }
+#endif
+        GL_CHECK(glDrawElements(mode, indexCount, GL_UNSIGNED_INT, NULL));
+    }
+    
     void Disable()
     {
         GL_CHECK(glBindVertexArray(0));
@@ -145,6 +184,14 @@ public:
 				AddVertexPointer(pVertexDataInfo[i].mBindPoint, pVertexDataInfo[i].mElementComponentCount, ConvertToOpenGLFormat(pVertexDataInfo[i].mElementType), GL_FALSE, vertexStride, (void *)(pVertexDataInfo[i].mOffset));
 				break;
 
+			// quantized by CPUTMeshOptimizer, the shader still gets floats
+			case CPUT_F16:
+				AddVertexPointer(pVertexDataInfo[i].mBindPoint, pVertexDataInfo[i].mElementComponentCount, ConvertToOpenGLFormat(pVertexDataInfo[i].mElementType), GL_FALSE, vertexStride, (void *)(pVertexDataInfo[i].mOffset));
+				break;
+			case CPUT_SNORM8:
+				AddVertexPointer(pVertexDataInfo[i].mBindPoint, pVertexDataInfo[i].mElementComponentCount, ConvertToOpenGLFormat(pVertexDataInfo[i].mElementType), GL_TRUE, vertexStride, (void *)(pVertexDataInfo[i].mOffset));
+				break;
+
 #ifndef CPUT_FOR_OGLES
 			case CPUT_DOUBLE:
 				AddVertexLPointer(pVertexDataInfo[i].mBindPoint, pVertexDataInfo[i].mElementComponentCount, ConvertToOpenGLFormat(pVertexDataInfo[i].mElementType), vertexStride, (void *)(pVertexDataInfo[i].mOffset));
@@ -171,8 +218,169 @@ public:
 	{
 		return new CPUTVertexArrayOGL(vertexElementCount);
 	}
+
+    static CPUTVertexArrayOGL* CreateArenaMesh(int vertexElementCount, CPUTBufferElementInfo *pVertexDataInfo, UINT vertexCount, void *pVertexData, UINT indexCount, void *pIndexData);
 };
 
+//
+// Packs meshes with the same vertex layout into shared pages: one big vertex buffer, index
+// buffer and vertex array per page, with each mesh at its own base vertex / first index.
+// Scenes with lots of small meshes then draw from a handful of buffers instead of two per
+// mesh. The range bookkeeping is CPUTRangeAllocator, which doesn't touch GL.
+//
+const UINT MESH_ARENA_PAGE_BYTES = 8 * 1024 * 1024;
+
+class CPUTMeshArenaPage
+{
+public:
+    CPUTMeshArenaPage(const std::string &layout, int vertexElementCount, CPUTBufferElementInfo *pVertexDataInfo, UINT vertexStride) :
+        mLayout(layout),
+        mVertexStride(vertexStride),
+        mVertices(MESH_ARENA_PAGE_BYTES / vertexStride),
+        mIndices(MESH_ARENA_PAGE_BYTES / sizeof(UINT))
+    {
+        CPUTBufferDesc desc;
+        desc.memory    = BUFFER_IMMUTABLE;
+        desc.cpuAccess = BUFFER_CPU_NO_ACCESS;
+        desc.pData     = NULL;
+
+        desc.target    = BUFFER_VERTEX;
+        desc.sizeBytes = mVertices.GetCapacity() * mVertexStride;
+        std::string name = "mesh arena vertex buffer";
+        mpVertexBuffer = CPUTBuffer::Create(name, &desc);
+
+        desc.target    = BUFFER_INDEX;
+        desc.sizeBytes = mIndices.GetCapacity() * sizeof(UINT);
+        name = "mesh arena index buffer";
+        mpIndexBuffer = CPUTBuffer::Create(name, &desc);
+
+        mpVertexArray = CPUTVertexArrayOGL::Create(vertexElementCount);
+        mpVertexArray->AddIBO((CPUTBufferOGL*)mpIndexBuffer);
+        mpVertexArray->AddVBO((CPUTBufferOGL*)mpVertexBuffer);
+        mpVertexArray->AddVertexPointers(vertexElementCount, pVertexDataInfo);
+    }
+
+    ~CPUTMeshArenaPage()
+    {
+        SAFE_DELETE(mpVertexArray);
+        SAFE_RELEASE(mpVertexBuffer);
+        SAFE_RELEASE(mpIndexBuffer);
+    }
+
+    std::string         mLayout;
+    UINT                mVertexStride;
+    CPUTRangeAllocator  mVertices;
+    CPUTRangeAllocator  mIndices;
+    CPUTBuffer         *mpVertexBuffer;
+    CPUTBuffer         *mpIndexBuffer;
+    CPUTVertexArrayOGL *mpVertexArray;
+};
+
+class CPUTMeshArenaOGL
+{
+public:
+    // Returns NULL when the mesh can't be packed, the caller then makes its own buffers
+    CPUTVertexArrayOGL *Allocate(int vertexElementCount, CPUTBufferElementInfo *pVertexDataInfo, UINT vertexCount, void *pVertexData, UINT indexCount, void *pIndexData)
+    {
+        UINT vertexStride = pVertexDataInfo[vertexElementCount-1].mOffset + pVertexDataInfo[vertexElementCount-1].mElementSizeInBytes;
+        if (vertexStride == 0 || vertexCount > MESH_ARENA_PAGE_BYTES / vertexStride || indexCount > MESH_ARENA_PAGE_BYTES / sizeof(UINT))
+        {
+            return NULL; // bigger than a page, gains nothing from sharing anyway
+        }
+
+        std::string layout = GetLayoutKey(vertexElementCount, pVertexDataInfo, vertexStride);
+        std::vector<CPUTMeshArenaPage*> &pages = mPages[layout];
+
+        CPUTMeshArenaPage *pPage = NULL;
+        UINT baseVertex = CPUTRangeAllocator::INVALID_OFFSET;
+        UINT firstIndex = CPUTRangeAllocator::INVALID_OFFSET;
+        for (size_t ii = 0; ii <= pages.size(); ++ii)
+        {
+            if (ii == pages.size())
+            {
+                pages.push_back(new CPUTMeshArenaPage(layout, vertexElementCount, pVertexDataInfo, vertexStride));
+            }
+            pPage = pages[ii];
+            baseVertex = pPage->mVertices.Allocate(vertexCount);
+            if (baseVertex == CPUTRangeAllocator::INVALID_OFFSET)
+            {
+                continue;
+            }
+            firstIndex = pPage->mIndices.Allocate(indexCount);
+            if (firstIndex != CPUTRangeAllocator::INVALID_OFFSET)
+            {
+                break;
+            }
+            pPage->mVertices.Free(baseVertex, vertexCount);
+        }
+
+        pPage->mpVertexBuffer->SetData(baseVertex * vertexStride, vertexCount * vertexStride, pVertexData);
+        pPage->mpIndexBuffer->SetData(firstIndex * sizeof(UINT), indexCount * sizeof(UINT), pIndexData);
+
+        return new CPUTVertexArrayOGL(pPage, pPage->mpVertexArray->mVertexArray, baseVertex, vertexCount, firstIndex, indexCount);
+    }
+
+    void Free(CPUTVertexArrayOGL *pMesh)
+    {
+        CPUTMeshArenaPage *pPage = pMesh->mpArenaPage;
+        pPage->mVertices.Free(pMesh->mBaseVertex, pMesh->mVertexCount);
+        pPage->mIndices.Free(pMesh->mFirstIndex, pMesh->mIndexCount);
+        if (pPage->mVertices.IsEmpty() && pPage->mIndices.IsEmpty())
+        {
+            // Last mesh gone, give the memory back
+            std::vector<CPUTMeshArenaPage*> &pages = mPages[pPage->mLayout];
+            pages.erase(std::find(pages.begin(), pages.end(), pPage));
+            if (pages.empty())
+            {
+                mPages.erase(pPage->mLayout);
+            }
+            delete pPage;
+        }
+    }
+
+protected:
+    // Meshes can only share a vertex array when every attribute is set up the same way
+    static std::string GetLayoutKey(int vertexElementCount, CPUTBufferElementInfo *pVertexDataInfo, UINT vertexStride)
+    {
+        std::ostringstream key;
+        key << vertexStride;
+        for (int ii = 0; ii < vertexElementCount; ++ii)
+        {
+            key << '|' << pVertexDataInfo[ii].mBindPoint << ',' << (int)pVertexDataInfo[ii].mElementType << ','
+                << pVertexDataInfo[ii].mElementComponentCount << ',' << pVertexDataInfo[ii].mOffset;
+        }
+        return key.str();
+    }
+
+    std::map<std::string, std::vector<CPUTMeshArenaPage*> > mPages;
+};
+
+// Pages are freed with their last mesh, so this never owns GL objects at exit
+static CPUTMeshArenaOGL gMeshArena;
+
+//-----------------------------------------------------------------------------
+CPUTVertexArrayOGL::~CPUTVertexArrayOGL()
+{
+    if (mpArenaPage)
+    {
+        gMeshArena.Free(this);
+    }
+    else if (mVertexArray != 0)
+    {
+        GL_CHECK(glDeleteVertexArrays(1, &mVertexArray));
+    }
+}
+
+//-----------------------------------------------------------------------------
+CPUTVertexArrayOGL* CPUTVertexArrayOGL::CreateArenaMesh(int vertexElementCount, CPUTBufferElementInfo *pVertexDataInfo, UINT vertexCount, void *pVertexData, UINT indexCount, void *pIndexData)
+{
+#ifdef CPUT_MESH_ARENA
+    return gMeshArena.Allocate(vertexElementCount, pVertexDataInfo, vertexCount, pVertexData, indexCount, pIndexData);
+#else
+    return NULL;
+#endif
+}
+
 //-----------------------------------------------------------------------------
 CPUTMeshOGL::CPUTMeshOGL() :
 //    mD3DMeshTopology(0),
@@ -206,10 +414,25 @@ CPUTResult CPUTMeshOGL::CreateNativeResources(
     void                   *pIndexData
 )
 {
-    mpVertexArray = CPUTVertexArrayOGL::Create(vertexElementCount);
+    SAFE_DELETE(mpVertexArray);
 	mIndexCount = indexCount;
 	mVertexCount = vertexCount;
 	SAFE_RELEASE(mpIndexBuffer);
+	SAFE_RELEASE(mpVertexBuffer);
+
+    // Static indexed meshes go into the shared arena, anything else (e.g. the GUI's
+    // vertex-only buffer that is rewritten every frame) keeps its own buffers
+    if (vertexCount > 0 && indexCount > 0 && pVertexData && pIndexData && pIndexDataInfo->mElementSizeInBytes == sizeof(UINT))
+    {
+		mVertexStride = pVertexDataInfo[vertexElementCount-1].mOffset + pVertexDataInfo[vertexElementCount-1].mElementSizeInBytes;
+        mpVertexArray = CPUTVertexArrayOGL::CreateArenaMesh(vertexElementCount, pVertexDataInfo, vertexCount, pVertexData, indexCount, pIndexData);
+        if (mpVertexArray)
+        {
+            return CPUT_SUCCESS;
+        }
+    }
+
+    mpVertexArray = CPUTVertexArrayOGL::Create(vertexElementCount);
 	if(indexCount > 0)
 	{
         CPUTBufferDesc desc;
@@ -223,7 +446,6 @@ CPUTResult CPUTMeshOGL::CreateNativeResources(
 	}
     
 	
-	SAFE_RELEASE(mpVertexBuffer);
 	if(vertexCount > 0)
 	{
 		mVertexCount  = vertexCount;
@@ -294,9 +516,9 @@ void CPUTMeshOGL::Draw()
     if(mVertexCount == 0 && mIndexCount == 0)
         return;
     mpVertexArray->Enable();
-    if(mpIndexBuffer != NULL)
+    if(mpIndexBuffer != NULL || mpVertexArray->mpArenaPage != NULL)
 	{
-		GL_CHECK(glDrawElements(GL_TRIANGLES, mIndexCount, GL_UNSIGNED_INT, NULL));
+		mpVertexArray->DrawElements(GL_TRIANGLES, mIndexCount);
 	}
 	else
 	{
@@ -313,9 +535,9 @@ void CPUTMeshOGL::DrawPatches()
     if(mVertexCount == 0 && mIndexCount == 0)
         return;
     mpVertexArray->Enable();
-    if(mpIndexBuffer != NULL)
+    if(mpIndexBuffer != NULL || mpVertexArray->mpArenaPage != NULL)
 	{
-		GL_CHECK(glDrawElements(GL_PATCHES, mIndexCount, GL_UNSIGNED_INT, NULL));
+		mpVertexArray->DrawElements(GL_PATCHES, mIndexCount);
 	}
 	else
 	{
@@ -328,10 +550,20 @@ void CPUTMeshOGL::DrawPatches()
 
 void CPUTMeshOGL::SetIndexSubData( UINT offset, UINT size, void* pData)
 {
+    if (mpVertexArray && mpVertexArray->mpArenaPage)
+    {
+        mpVertexArray->mpArenaPage->mpIndexBuffer->SetData(mpVertexArray->mFirstIndex * sizeof(UINT) + offset, size, pData);
+        return;
+    }
     mpIndexBuffer->SetData(offset, size, pData);
 }
 void CPUTMeshOGL::SetVertexSubData( UINT offset, UINT size, void* pData)
 {
+    if (mpVertexArray && mpVertexArray->mpArenaPage)
+    {
+        mpVertexArray->mpArenaPage->mpVertexBuffer->SetData(mpVertexArray->mBaseVertex * mVertexStride + offset, size, pData);
+        return;
+    }
     mpVertexBuffer->SetData(offset, size, pData);
 }
 
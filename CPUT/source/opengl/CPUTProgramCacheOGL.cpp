@@ -0,0 +1,524 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "CPUTProgramCacheOGL.h"
+#include "CPUTMaterial.h"
+#include "CPUTOSServices.h"
+#include "CPUTHash.h"
+#include "CPUT_OGL.h"
+#ifdef CPUT_OS_WINDOWS
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+CPUTProgramCacheOGL *CPUTProgramCacheOGL::mpProgramCache = NULL;
+
+struct ProgramFileHeader
+{
+    UINT     mTag;
+    UINT     mVersion;
+    uint64_t mKey;
+    UINT     mBinaryFormat;
+    UINT     mBinarySize;
+    UINT     mReflectionSize; // the reflection follows the header, then the binary
+    UINT     mPad;
+};
+
+// Reflection is written as counts and length prefixed strings
+//-----------------------------------------------------------------------------
+static void WriteInt(std::vector<char> &out, int value)
+{
+    out.insert(out.end(), (const char *)&value, (const char *)&value + sizeof(value));
+}
+
+static void WriteString(std::vector<char> &out, const std::string &value)
+{
+    WriteInt(out, (int)value.size());
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+static void WriteStrings(std::vector<char> &out, const std::vector<std::string> &values)
+{
+    WriteInt(out, (int)values.size());
+    for (size_t ii = 0; ii < values.size(); ii++)
+    {
+        WriteString(out, values[ii]);
+    }
+}
+
+class ReflectionReader
+{
+public:
+    ReflectionReader(const char *pData, UINT size) : mpData(pData), mRemaining(size), mbFailed(false) {}
+
+    bool Failed() const { return mbFailed || mRemaining != 0; }
+
+    int ReadInt()
+    {
+        int value = 0;
+        if (mRemaining < sizeof(value))
+        {
+            mbFailed = true;
+            return 0;
+        }
+        memcpy(&value, mpData, sizeof(value));
+        mpData += sizeof(value);
+        mRemaining -= sizeof(value);
+        return value;
+    }
+
+    std::string ReadString()
+    {
+        int length = ReadInt();
+        if (length < 0 || (UINT)length > mRemaining)
+        {
+            mbFailed = true;
+            return std::string();
+        }
+        std::string value(mpData, length);
+        mpData += length;
+        mRemaining -= length;
+        return value;
+    }
+
+    void ReadStrings(std::vector<std::string> *pValues)
+    {
+        int count = ReadInt();
+        for (int ii = 0; ii < count && !mbFailed; ii++)
+        {
+            pValues->push_back(ReadString());
+        }
+    }
+
+private:
+    const char *mpData;
+    UINT        mRemaining;
+    bool        mbFailed;
+};
+
+static void SerializeReflection(const CPUTProgramReflectionOGL &reflection, std::vector<char> &out)
+{
+    WriteStrings(out, reflection.textureNames);
+    WriteStrings(out, reflection.imageNames);
+    WriteStrings(out, reflection.blockNames);
+    WriteInt(out, reflection.externalsBlock);
+    WriteInt(out, reflection.externalsSize);
+    WriteInt(out, (int)reflection.externals.size());
+    for (size_t ii = 0; ii < reflection.externals.size(); ii++)
+    {
+        WriteString(out, reflection.externals[ii].name);
+        WriteInt(out, reflection.externals[ii].type);
+        WriteInt(out, reflection.externals[ii].offset);
+        WriteInt(out, reflection.externals[ii].arrayLength);
+    }
+}
+
+static bool DeserializeReflection(const char *pData, UINT size, CPUTProgramReflectionOGL *pReflection)
+{
+    ReflectionReader reader(pData, size);
+    reader.ReadStrings(&pReflection->textureNames);
+    reader.ReadStrings(&pReflection->imageNames);
+    reader.ReadStrings(&pReflection->blockNames);
+    pReflection->externalsBlock = reader.ReadInt();
+    pReflection->externalsSize  = reader.ReadInt();
+    int count = reader.ReadInt();
+    for (int ii = 0; ii < count && !reader.Failed(); ii++)
+    {
+        CPUTProgramReflectionOGL::Uniform uniform;
+        uniform.name        = reader.ReadString();
+        uniform.type        = reader.ReadInt();
+        uniform.offset      = reader.ReadInt();
+        uniform.arrayLength = reader.ReadInt();
+        pReflection->externals.push_back(uniform);
+    }
+    return !reader.Failed() && pReflection->externalsBlock < (int)pReflection->blockNames.size();
+}
+
+static void CreateDirectoryIfMissing(const std::string &directory)
+{
+    if (CPUT_SUCCESS == CPUTFileSystem::DoesDirectoryExist(directory))
+    {
+        return;
+    }
+#ifdef CPUT_OS_WINDOWS
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+CPUTProgramCacheOGL *CPUTProgramCacheOGL::GetProgramCache()
+{
+    if (!mpProgramCache)
+    {
+        mpProgramCache = new CPUTProgramCacheOGL();
+    }
+    return mpProgramCache;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTProgramCacheOGL::DeleteProgramCache()
+{
+    SAFE_DELETE(mpProgramCache);
+}
+
+//-----------------------------------------------------------------------------
+CPUTProgramCacheOGL::CPUTProgramCacheOGL() :
+    mDriverHash(0),
+    mSupported(-1),
+    mbEnabled(true),
+    mHitCount(0),
+    mMissCount(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+void CPUTProgramCacheOGL::SetCacheDirectory(const std::string &directory)
+{
+    mCacheDirectory = directory;
+    if (!mCacheDirectory.empty() && mCacheDirectory[mCacheDirectory.size() - 1] != '/' && mCacheDirectory[mCacheDirectory.size() - 1] != '\\')
+    {
+        mCacheDirectory += "/";
+    }
+}
+
+//-----------------------------------------------------------------------------
+std::string CPUTProgramCacheOGL::GetCacheDirectory()
+{
+    if (mCacheDirectory.empty())
+    {
+        std::string executableDirectory;
+        CPUTFileSystem::GetExecutableDirectory(&executableDirectory);
+        mCacheDirectory = executableDirectory + "ShaderCacheOGL/";
+    }
+    return mCacheDirectory;
+}
+
+//-----------------------------------------------------------------------------
+bool CPUTProgramCacheOGL::IsSupported()
+{
+    if (mSupported < 0)
+    {
+        GLint numFormats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        mSupported = (numFormats > 0) ? 1 : 0;
+
+        // A binary is only good for the driver that made it
+        std::string driver;
+        const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (int ii = 0; ii < 3; ii++)
+        {
+            const char *pName = (const char *)glGetString(names[ii]);
+            driver += pName ? pName : "";
+            driver += "\n";
+        }
+        mDriverHash = CPUTHash64(driver.c_str(), driver.size());
+    }
+    return mSupported == 1;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTProgramCacheOGL::RegisterShader(GLuint shader, const std::string &name, uint64_t sourceHash)
+{
+    Shader &entry = mShaders[shader];
+    entry.name      = name;
+    entry.hash      = sourceHash;
+    entry.bCompiled = false;
+}
+
+//-----------------------------------------------------------------------------
+bool CPUTProgramCacheOGL::CompileShader(GLuint shader)
+{
+    std::map<GLuint, Shader>::iterator it = mShaders.find(shader);
+    if (it != mShaders.end() && it->second.bCompiled)
+    {
+        return true;
+    }
+
+    GL_CHECK(glCompileShader(shader));
+    GLint isCompiled;
+    GL_CHECK(glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled));
+    if (isCompiled == GL_FALSE)
+    {
+        GLint maxLength = 0;
+        GL_CHECK(glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength));
+        std::vector<char> infoLog(maxLength + 1, 0);
+        glGetShaderInfoLog(shader, maxLength, &maxLength, &infoLog[0]);
+        DEBUG_PRINT("Failed to compile shader: %s\n%s\n", (it != mShaders.end()) ? it->second.name.c_str() : "", &infoLog[0]);
+        ASSERT(false, "Compile shader failed");
+        return false;
+    }
+    if (it != mShaders.end())
+    {
+        it->second.bCompiled = true;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+std::string CPUTProgramCacheOGL::GetProgramFileName(uint64_t key)
+{
+    char name[32];
+    sprintf(name, "%016llx.glprog", (unsigned long long)key);
+    return GetCacheDirectory() + name;
+}
+
+//-----------------------------------------------------------------------------
+GLuint CPUTProgramCacheOGL::LoadProgram(uint64_t key, CPUTProgramReflectionOGL *pReflection)
+{
+    CPUTFileSystem::CPUTFileView view;
+    if (CPUT_SUCCESS != view.Open(GetProgramFileName(key)) || view.GetSize() < sizeof(ProgramFileHeader))
+    {
+        return 0;
+    }
+    ProgramFileHeader header;
+    memcpy(&header, view.GetData(), sizeof(header));
+    if (header.mTag != CPUT_PROGRAM_CACHE_TAG || header.mVersion != CPUT_PROGRAM_CACHE_VERSION || header.mKey != key ||
+        view.GetSize() != sizeof(header) + (uint64_t)header.mReflectionSize + header.mBinarySize)
+    {
+        return 0;
+    }
+    const char *pReflectionData = view.GetData() + sizeof(header);
+    if (!DeserializeReflection(pReflectionData, header.mReflectionSize, pReflection))
+    {
+        *pReflection = CPUTProgramReflectionOGL();
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.mBinaryFormat, pReflectionData + header.mReflectionSize, header.mBinarySize);
+    GLint isLinked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+    if (isLinked == GL_FALSE)
+    {
+        // Not an error: drivers refuse binaries from older versions of themselves
+        glDeleteProgram(program);
+        *pReflection = CPUTProgramReflectionOGL();
+        return 0;
+    }
+    return program;
+}
+
+//-----------------------------------------------------------------------------
+GLuint CPUTProgramCacheOGL::LinkProgram(const GLuint *pShaders, int numShaders, CPUTProgramReflectionOGL *pReflection, bool *pbReflected, uint64_t *pKey)
+{
+    *pbReflected = false;
+    *pKey = 0;
+
+    // Every shader's source has to be known for the key to mean anything
+    bool bUseCache = mbEnabled && IsSupported();
+    std::vector<uint64_t> hashes;
+    hashes.push_back(((uint64_t)CPUT_PROGRAM_CACHE_VERSION << 32) | CPUT_PROGRAM_CACHE_TAG);
+    hashes.push_back(mDriverHash);
+    for (int ii = 0; ii < numShaders && bUseCache; ii++)
+    {
+        std::map<GLuint, Shader>::iterator it = mShaders.find(pShaders[ii]);
+        bUseCache = (it != mShaders.end());
+        hashes.push_back(bUseCache ? it->second.hash : 0);
+    }
+    if (bUseCache)
+    {
+        *pKey = CPUTHash64((const char *)&hashes[0], hashes.size() * sizeof(uint64_t));
+
+        GLuint program = LoadProgram(*pKey, pReflection);
+        if (program)
+        {
+            mHitCount++;
+            *pbReflected = true;
+            return program;
+        }
+        mMissCount++;
+    }
+
+    GLuint program = glCreateProgram();
+    for (int ii = 0; ii < numShaders; ii++)
+    {
+        CompileShader(pShaders[ii]);
+        GL_CHECK(glAttachShader(program, pShaders[ii]));
+    }
+    if (bUseCache)
+    {
+        GL_CHECK(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    }
+    GL_CHECK(glLinkProgram(program));
+
+    GLint isLinked;
+    GL_CHECK(glGetProgramiv(program, GL_LINK_STATUS, &isLinked));
+    if (isLinked == GL_FALSE)
+    {
+        GLint maxLength = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+        std::vector<char> infoLog(maxLength + 1, 0);
+        glGetProgramInfoLog(program, maxLength, &maxLength, &infoLog[0]);
+        DEBUG_PRINT("Failed to link shader program:\n%s\n", &infoLog[0]);
+        ASSERT(false, "glLinkProgram failed");
+        *pKey = 0; // nothing to store
+    }
+    return program;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTProgramCacheOGL::StoreProgram(GLuint program, uint64_t key, const CPUTProgramReflectionOGL &reflection)
+{
+    if (0 == key || !mbEnabled || !IsSupported())
+    {
+        return;
+    }
+    GLint binarySize = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+    if (binarySize <= 0)
+    {
+        return;
+    }
+
+    std::vector<char> reflectionData;
+    SerializeReflection(reflection, reflectionData);
+
+    std::vector<char> output(sizeof(ProgramFileHeader) + reflectionData.size() + binarySize);
+    GLenum binaryFormat = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, binarySize, &written, &binaryFormat, &output[sizeof(ProgramFileHeader) + reflectionData.size()]);
+    if (written != binarySize)
+    {
+        return;
+    }
+    if (!reflectionData.empty())
+    {
+        memcpy(&output[sizeof(ProgramFileHeader)], &reflectionData[0], reflectionData.size());
+    }
+
+    ProgramFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.mTag            = CPUT_PROGRAM_CACHE_TAG;
+    header.mVersion        = CPUT_PROGRAM_CACHE_VERSION;
+    header.mKey            = key;
+    header.mBinaryFormat   = binaryFormat;
+    header.mBinarySize     = (UINT)binarySize;
+    header.mReflectionSize = (UINT)reflectionData.size();
+    memcpy(&output[0], &header, sizeof(header));
+
+    // Write to a temporary and rename, so another instance never loads half a file
+    CreateDirectoryIfMissing(GetCacheDirectory());
+    const std::string fileName = GetProgramFileName(key);
+    const std::string tempFileName = fileName + ".tmp";
+    FILE *pFile = fopen(tempFileName.c_str(), "wb");
+    if (!pFile)
+    {
+        DEBUG_PRINT("CPUTProgramCacheOGL: unable to write %s\n", tempFileName.c_str());
+        return;
+    }
+    bool ok = fwrite(&output[0], 1, output.size(), pFile) == output.size();
+    ok &= fclose(pFile) == 0;
+    remove(fileName.c_str());
+    if (!ok || 0 != rename(tempFileName.c_str(), fileName.c_str()))
+    {
+        remove(tempFileName.c_str());
+        DEBUG_PRINT("CPUTProgramCacheOGL: unable to write %s\n", fileName.c_str());
+    }
+}
+
+// Materials only need it when the program didn't come from the cache
+//-----------------------------------------------------------------------------
+void CPUTProgramCacheOGL::ReflectProgram(GLuint shaderProgram, CPUTProgramReflectionOGL *pReflection)
+{
+    GLint numActiveUniforms;
+    GLint activeUniformMaxLength;
+    GL_CHECK(glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORMS, &numActiveUniforms));
+    GL_CHECK(glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &activeUniformMaxLength));
+    
+    GLint numActiveUniformBlocks;
+    GLint activeUniformBlockMaxLength = 50;
+    GL_CHECK(glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_BLOCKS, &numActiveUniformBlocks));
+	//
+	// #### This parameter is currently unsupported by Intel OGL drivers.
+	//
+    
+    GLchar* uniformVariableName = new GLchar[activeUniformMaxLength];
+    GLenum  dataType;
+    GLint   size;
+    for (int i = 0; i < numActiveUniforms; i++) {
+        GL_CHECK(glGetActiveUniform(shaderProgram, i, activeUniformMaxLength, NULL, &size, &dataType, uniformVariableName));
+        switch(dataType) {
+#ifndef CPUT_FOR_OGLES
+            case GL_SAMPLER_1D:
+#endif
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+		case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_CUBE:
+                pReflection->textureNames.push_back(uniformVariableName);
+                break;
+#ifdef CPUT_SUPPORT_IMAGE_STORE
+        case GL_IMAGE_2D:
+            pReflection->imageNames.push_back(uniformVariableName);
+            break;
+#endif
+            default:
+                // unsupported uniform type
+            break;
+        }
+    }
+	delete[] uniformVariableName;
+
+    GLchar* uniformBlockName = new GLchar[activeUniformBlockMaxLength];
+    for (int i = 0; i < numActiveUniformBlocks; i++) 
+    {
+        GL_CHECK(glGetActiveUniformBlockName(shaderProgram, i, activeUniformBlockMaxLength, NULL, uniformBlockName));
+        pReflection->blockNames.push_back(uniformBlockName);
+		if (!strcmp(uniformBlockName, EXTERNALS_SHADER_NAME.c_str()))
+		{
+			GLint blockSize;
+			GLsizei numUniforms;
+			GL_CHECK(glGetActiveUniformBlockiv(shaderProgram, i, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize));
+			GL_CHECK(glGetActiveUniformBlockiv(shaderProgram, i, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &numUniforms));
+			pReflection->externalsBlock = i;
+			pReflection->externalsSize = blockSize;
+
+			std::vector<GLuint> uniformIndices(numUniforms);
+			std::vector<GLint> uniformTypes(numUniforms), uniformOffsets(numUniforms), uniformArrayLengths(numUniforms);
+			if (numUniforms > 0)
+			{
+				GL_CHECK(glGetActiveUniformBlockiv(shaderProgram, i, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, (GLint*)&uniformIndices[0]));
+				glGetActiveUniformsiv(shaderProgram, numUniforms, &uniformIndices[0], GL_UNIFORM_TYPE, &uniformTypes[0]);
+				glGetActiveUniformsiv(shaderProgram, numUniforms, &uniformIndices[0], GL_UNIFORM_OFFSET, &uniformOffsets[0]);
+				glGetActiveUniformsiv(shaderProgram, numUniforms, &uniformIndices[0], GL_UNIFORM_SIZE, &uniformArrayLengths[0]);
+			}
+
+			GLchar* name = new GLchar[activeUniformMaxLength];
+			for (int uniform = 0; uniform < numUniforms; uniform++)
+			{
+				GLint size;
+				GLenum type;
+				GL_CHECK(glGetActiveUniform(shaderProgram,
+					uniformIndices[uniform],
+					activeUniformMaxLength,
+					NULL,
+					&size,
+					&type,
+					name));
+				CPUTProgramReflectionOGL::Uniform member;
+				member.name = name;
+				member.type = uniformTypes[uniform];
+				member.offset = uniformOffsets[uniform];
+				member.arrayLength = uniformArrayLengths[uniform];
+				pReflection->externals.push_back(member);
+			}
+			delete[] name;
+		}       
+	}
+    delete[] uniformBlockName;
+}
@@ -20,6 +20,8 @@
 #include "CPUTOSServices.h"
 #include "CPUT_OGL.h"
 #include "CPUTAssetLibraryOGL.h"
+#include "CPUTProgramCacheOGL.h"
+#include "CPUTHash.h"
 
 std::string GenerateName(const std::vector<std::string> &fileNames)
 {
@@ -37,9 +39,7 @@ CPUTShaderOGL *CPUTShaderOGL::CreateFromFiles(
     GenerateName(fileNames);
 
     GLuint shader = 0;
-    int maxLength = 0;
     int nBytes = 0;
-    char *infoLog = NULL;
     //NOTE: This will specify shader version and shader type as first two lines of shader
     //TODO: Maybe use the PixelShaderProfile to determine version number or some other mechanism
     size_t files = fileNames.size();
@@ -94,28 +94,17 @@ CPUTShaderOGL *CPUTShaderOGL::CreateFromFiles(
     // Note that the source code is NULL character terminated.
     // GL will automatically detect that therefore the length info can be 0 in this case (the last parameter)
     glShaderSource(shader, (GLsizei)(files+MACRO_FILES), (const GLchar**)&source, 0);
- 
-    
-    // Compile the fragment shader
-    GL_CHECK(glCompileShader(shader));
-    GLint isCompiled;
-    GL_CHECK(glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled));
-    if(isCompiled == false)
-    {
-        GL_CHECK(glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength));
- 
-        // The maxLength includes the NULL character
-        infoLog = (char *)malloc(maxLength*40);
- 
-        glGetShaderInfoLog(shader, maxLength, &maxLength, infoLog);
- 
-        // Handle the error in an appropriate way such as displaying a message or writing to a log file.
-        // In this simple program, we'll just leave
-        DEBUG_PRINT("Failed to compile shader: %s\n%s\n", fileNames[0].c_str(), infoLog);
-		ASSERT(false, "Compile frag shader failed");
 
-        free(infoLog);
+    // The program cache compiles it if the program isn't cached, keyed on everything GL was given
+    std::vector<uint64_t> sourceHashes;
+    sourceHashes.push_back(shaderType);
+    for(unsigned int i = 0; i < files+MACRO_FILES; i++)
+    {
+        const char *pSource = source[i] ? source[i] : "";
+        sourceHashes.push_back(CPUTHash64(pSource, strlen(pSource)));
     }
+    CPUTProgramCacheOGL::GetProgramCache()->RegisterShader(shader, fileNames[0],
+        CPUTHash64((const char *)&sourceHashes[0], sourceHashes.size() * sizeof(uint64_t)));
 
     SAFE_DELETE(source[2]);
     SAFE_DELETE(source[3]);
@@ -0,0 +1,510 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "CPUTStreamingBufferOGL.h"
+#include "CPUT_OGL.h"
+#include <algorithm>
+
+CPUTStreamingBufferOGL *CPUTStreamingBufferOGL::mpStreamingBuffer = NULL;
+
+// Enough for a few frames of per-frame and per-model constants plus GUI geometry
+const UINT STREAMING_BUFFER_SIZE = 4 * 1024 * 1024;
+
+// Copies out of the ring only have to keep memcpy happy; uniform blocks bound in the ring
+// use GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+const UINT STREAMING_UPLOAD_ALIGNMENT = 16;
+
+#if defined(GL_MAP_PERSISTENT_BIT) && !defined(CPUT_FOR_OGLES) && !defined(CPUT_FOR_OGLES3)
+#define CPUT_GL_BUFFER_STORAGE
+#endif
+
+// The real thing, talks to the current context
+//-----------------------------------------------------------------------------
+class CPUTStreamingBufferContextGL : public CPUTStreamingBufferGL
+{
+public:
+    bool SupportsPersistentMapping()
+    {
+#ifdef CPUT_GL_BUFFER_STORAGE
+        return (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) && glBufferStorage != NULL;
+#else
+        return false;
+#endif
+    }
+
+    GLuint CreateBuffer(GLsizeiptr sizeBytes, bool bPersistent, void **ppMapped)
+    {
+        GLuint buffer = 0;
+        GL_CHECK(glGenBuffers(1, &buffer));
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+#ifdef CPUT_GL_BUFFER_STORAGE
+        if (bPersistent)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            GL_CHECK(glBufferStorage(GL_COPY_READ_BUFFER, sizeBytes, NULL, flags));
+            *ppMapped = glMapBufferRange(GL_COPY_READ_BUFFER, 0, sizeBytes, flags);
+        }
+        else
+#endif
+        {
+            GL_CHECK(glBufferData(GL_COPY_READ_BUFFER, sizeBytes, NULL, GL_STREAM_DRAW));
+        }
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+        return buffer;
+    }
+
+    void DeleteBuffer(GLuint buffer, bool bPersistent)
+    {
+        if (bPersistent)
+        {
+            GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+            GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+
+    void *MapRange(GLuint buffer, GLintptr offset, GLsizeiptr sizeBytes)
+    {
+        // Unsynchronized is safe, the ring never hands out a range twice without orphaning first
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+        return glMapBufferRange(GL_COPY_READ_BUFFER, offset, sizeBytes,
+            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    }
+
+    void Unmap(GLuint buffer)
+    {
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    }
+
+    void Orphan(GLuint buffer, GLsizeiptr sizeBytes)
+    {
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+        GL_CHECK(glBufferData(GL_COPY_READ_BUFFER, sizeBytes, NULL, GL_STREAM_DRAW));
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    }
+
+    GLsync InsertFence()
+    {
+        return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    bool WaitFence(GLsync fence, bool bBlock)
+    {
+        // The first wait flushes so the fence is guaranteed to reach the GPU
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for (;;)
+        {
+            GLenum result = glClientWaitSync(fence, flags, bBlock ? 1000000 : 0);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+            {
+                return true;
+            }
+            if (result == GL_WAIT_FAILED)
+            {
+                DEBUG_PRINT("CPUTStreamingBufferOGL: glClientWaitSync failed");
+                return true; // nothing better to do than carry on
+            }
+            if (!bBlock)
+            {
+                return false;
+            }
+            flags = 0;
+        }
+    }
+
+    void DeleteFence(GLsync fence)
+    {
+        glDeleteSync(fence);
+    }
+
+    void CopyBuffer(GLuint srcBuffer, GLintptr srcOffset, GLuint dstBuffer, GLintptr dstOffset, GLsizeiptr sizeBytes)
+    {
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, srcBuffer));
+        GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, dstBuffer));
+        GL_CHECK(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, srcOffset, dstOffset, sizeBytes));
+        GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    }
+
+    void BindUniformBuffer(GLuint bindPoint, GLuint buffer, GLintptr offset, GLsizeiptr sizeBytes)
+    {
+        if (0 == sizeBytes)
+        {
+            GL_CHECK(glBindBufferBase(GL_UNIFORM_BUFFER, bindPoint, buffer));
+        }
+        else
+        {
+            GL_CHECK(glBindBufferRange(GL_UNIFORM_BUFFER, bindPoint, buffer, offset, sizeBytes));
+        }
+    }
+
+    UINT GetUniformOffsetAlignment()
+    {
+        GLint alignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        return (alignment > 0) ? (UINT)alignment : 256;
+    }
+};
+
+//-----------------------------------------------------------------------------
+CPUTStreamingBufferOGL *CPUTStreamingBufferOGL::GetStreamingBuffer()
+{
+    if (NULL == mpStreamingBuffer)
+    {
+        mpStreamingBuffer = new CPUTStreamingBufferOGL(new CPUTStreamingBufferContextGL(), STREAMING_BUFFER_SIZE);
+    }
+    return mpStreamingBuffer;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTStreamingBufferOGL::DeleteStreamingBuffer()
+{
+    SAFE_DELETE(mpStreamingBuffer);
+}
+
+//-----------------------------------------------------------------------------
+CPUTStreamingBufferOGL::CPUTStreamingBufferOGL(CPUTStreamingBufferGL *pGL, UINT sizeBytes)
+    : mpGL(pGL),
+      mBufferID(0),
+      mSize(sizeBytes),
+      mbPersistent(false),
+      mpMapped(NULL),
+      mbRangeMapped(false),
+      mHead(0),
+      mRegionBegin(0)
+{
+    mUniformAlignment = std::max(mpGL->GetUniformOffsetAlignment(), STREAMING_UPLOAD_ALIGNMENT);
+    if (mpGL->SupportsPersistentMapping())
+    {
+        void *pMapped = NULL;
+        mBufferID = mpGL->CreateBuffer(mSize, true, &pMapped);
+        if (pMapped)
+        {
+            mpMapped     = (char*)pMapped;
+            mbPersistent = true;
+            return;
+        }
+        DEBUG_PRINT("CPUTStreamingBufferOGL: persistent mapping failed, falling back to orphaning");
+        mpGL->DeleteBuffer(mBufferID, false);
+    }
+    mBufferID = mpGL->CreateBuffer(mSize, false, NULL);
+}
+
+//-----------------------------------------------------------------------------
+CPUTStreamingBufferOGL::~CPUTStreamingBufferOGL()
+{
+    EndWrite();
+    // Uniform buffers may outlive the ring, give them their contents back
+    WriteBackUniformBuffers(true);
+    while (!mRegions.empty())
+    {
+        if (NULL == mRegions.front().fence)
+        {
+            mRegions.pop_front();
+            continue;
+        }
+        RetireOldestRegion(true);
+    }
+    mpGL->DeleteBuffer(mBufferID, mbPersistent);
+    SAFE_DELETE(mpGL);
+}
+
+//-----------------------------------------------------------------------------
+void *CPUTStreamingBufferOGL::Allocate(UINT sizeBytes, UINT alignment, UINT *pOffset)
+{
+    ASSERT(!mbRangeMapped, "CPUTStreamingBufferOGL: Allocate() called before EndWrite()");
+    if (0 == sizeBytes || sizeBytes > mSize)
+    {
+        return NULL;
+    }
+
+    UINT offset = (alignment > 1) ? (mHead + alignment - 1) / alignment * alignment : mHead;
+    if (offset > mSize || sizeBytes > mSize - offset)
+    {
+        // Doesn't fit before the end, wrap around. What this frame wrote so far stays in flight
+        // until its fence is inserted.
+        if (mbPersistent)
+        {
+            if (mHead > mRegionBegin)
+            {
+                mRegions.push_back(Region(mRegionBegin, mHead));
+            }
+        }
+        else
+        {
+            mpGL->Orphan(mBufferID, mSize);
+        }
+        mHead = mRegionBegin = offset = 0;
+    }
+
+    if (mbPersistent)
+    {
+        WaitForRange(offset, offset + sizeBytes);
+    }
+    mHead    = offset + sizeBytes;
+    *pOffset = offset;
+
+    if (mbPersistent)
+    {
+        return mpMapped + offset;
+    }
+    void *pData = mpGL->MapRange(mBufferID, offset, sizeBytes);
+    mbRangeMapped = (pData != NULL);
+    return pData;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTStreamingBufferOGL::EndWrite()
+{
+    // Persistent mappings are coherent, nothing to flush
+    if (mbRangeMapped)
+    {
+        mpGL->Unmap(mBufferID);
+        mbRangeMapped = false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+CPUTResult CPUTStreamingBufferOGL::Upload(GLuint dstBuffer, UINT dstOffset, UINT sizeBytes, const void *pData)
+{
+    UINT offset = 0;
+    void *pDst = Allocate(sizeBytes, STREAMING_UPLOAD_ALIGNMENT, &offset);
+    if (NULL == pDst)
+    {
+        return CPUT_ERROR_INVALID_PARAMETER;
+    }
+    memcpy(pDst, pData, sizeBytes);
+    EndWrite();
+    mpGL->CopyBuffer(mBufferID, offset, dstBuffer, dstOffset, sizeBytes);
+    return CPUT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+CPUTResult CPUTStreamingBufferOGL::SetUniformData(GLuint buffer, UINT bufferSize, UINT offset, UINT sizeBytes, const void *pData)
+{
+    if (!mbPersistent || 0 == bufferSize || bufferSize > mSize / 4 || offset > bufferSize || sizeBytes > bufferSize - offset)
+    {
+        return CPUT_ERROR_INVALID_PARAMETER;
+    }
+    std::map<GLuint, UniformBuffer>::iterator it = mUniformBuffers.find(buffer);
+    if (it == mUniformBuffers.end())
+    {
+        if (0 != offset || sizeBytes != bufferSize)
+        {
+            return CPUT_ERROR_INVALID_PARAMETER;
+        }
+        it = mUniformBuffers.insert(std::make_pair(buffer, UniformBuffer())).first;
+        it->second.contents.resize(bufferSize);
+        it->second.offset  = 0;
+        it->second.bInRing = false;
+    }
+    UniformBuffer &uniformBuffer = it->second;
+    if (uniformBuffer.contents.size() != bufferSize)
+    {
+        return CPUT_ERROR_INVALID_PARAMETER;
+    }
+    memcpy(&uniformBuffer.contents[offset], pData, sizeBytes);
+    uniformBuffer.bWritten = true;
+    return PlaceUniformBuffer(buffer, uniformBuffer) ? CPUT_SUCCESS : CPUT_ERROR_INVALID_PARAMETER;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTStreamingBufferOGL::BindUniformBuffer(GLuint bindPoint, GLuint buffer)
+{
+    if (bindPoint >= mUniformBindings.size())
+    {
+        mUniformBindings.resize(bindPoint + 1, 0);
+    }
+    mUniformBindings[bindPoint] = buffer;
+
+    std::map<GLuint, UniformBuffer>::const_iterator it = mUniformBuffers.find(buffer);
+    if (it != mUniformBuffers.end() && it->second.bInRing)
+    {
+        mpGL->BindUniformBuffer(bindPoint, mBufferID, it->second.offset, (GLsizeiptr)it->second.contents.size());
+    }
+    else
+    {
+        mpGL->BindUniformBuffer(bindPoint, buffer, 0, 0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void CPUTStreamingBufferOGL::ForgetUniformBuffer(GLuint buffer)
+{
+    if (NULL == mpStreamingBuffer)
+    {
+        return;
+    }
+    mpStreamingBuffer->mUniformBuffers.erase(buffer);
+    std::vector<GLuint> &bindings = mpStreamingBuffer->mUniformBindings;
+    std::replace(bindings.begin(), bindings.end(), buffer, (GLuint)0);
+}
+
+// Copies the whole block into this frame's region and points its bind points there
+//-----------------------------------------------------------------------------
+bool CPUTStreamingBufferOGL::PlaceUniformBuffer(GLuint buffer, UniformBuffer &uniformBuffer)
+{
+    UINT offset = 0;
+    void *pDst = Allocate((UINT)uniformBuffer.contents.size(), mUniformAlignment, &offset);
+    if (NULL == pDst)
+    {
+        return false;
+    }
+    memcpy(pDst, &uniformBuffer.contents[0], uniformBuffer.contents.size());
+    EndWrite();
+    uniformBuffer.offset  = offset;
+    uniformBuffer.bInRing = true;
+    RebindUniformBuffer(buffer, uniformBuffer);
+    return true;
+}
+
+// Queues copies of the blocks in the ring (bAll) or of those not written since the last
+// OnFrameStart() back into their own buffers, and binds those whole again. Has to be called
+// before the region holding the blocks is fenced, so the fence covers the copies.
+//-----------------------------------------------------------------------------
+void CPUTStreamingBufferOGL::WriteBackUniformBuffers(bool bAll)
+{
+    for (std::map<GLuint, UniformBuffer>::iterator it = mUniformBuffers.begin(); it != mUniformBuffers.end(); ++it)
+    {
+        UniformBuffer &uniformBuffer = it->second;
+        if (uniformBuffer.bInRing && (bAll || !uniformBuffer.bWritten))
+        {
+            mpGL->CopyBuffer(mBufferID, uniformBuffer.offset, it->first, 0, (GLsizeiptr)uniformBuffer.contents.size());
+            uniformBuffer.bInRing = false;
+            RebindUniformBuffer(it->first, uniformBuffer);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void CPUTStreamingBufferOGL::RebindUniformBuffer(GLuint buffer, const UniformBuffer &uniformBuffer)
+{
+    for (UINT bindPoint = 0; bindPoint < (UINT)mUniformBindings.size(); bindPoint++)
+    {
+        if (mUniformBindings[bindPoint] != buffer)
+        {
+            continue;
+        }
+        if (uniformBuffer.bInRing)
+        {
+            mpGL->BindUniformBuffer(bindPoint, mBufferID, uniformBuffer.offset, (GLsizeiptr)uniformBuffer.contents.size());
+        }
+        else
+        {
+            mpGL->BindUniformBuffer(bindPoint, buffer, 0, 0);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void CPUTStreamingBufferOGL::OnFrameStart()
+{
+    if (!mbPersistent)
+    {
+        return;
+    }
+    // Blocks the last frame didn't write go home while their region is still unfenced
+    WriteBackUniformBuffers(false);
+    CloseRegion();
+
+    // Drop whatever the GPU has finished with so the list stays a few frames long
+    while (!mRegions.empty() && RetireOldestRegion(false))
+    {
+    }
+
+    // The others may still be bound, so they move into the new region with the frame
+    for (std::map<GLuint, UniformBuffer>::iterator it = mUniformBuffers.begin(); it != mUniformBuffers.end(); ++it)
+    {
+        if (it->second.bInRing)
+        {
+            it->second.bWritten = false;
+            PlaceUniformBuffer(it->first, it->second);
+        }
+    }
+}
+
+// Fences everything written since the last fence
+//-----------------------------------------------------------------------------
+void CPUTStreamingBufferOGL::CloseRegion()
+{
+    if (mHead > mRegionBegin)
+    {
+        mRegions.push_back(Region(mRegionBegin, mHead));
+    }
+    mRegionBegin = mHead;
+
+    if (mRegions.empty() || NULL != mRegions.back().fence)
+    {
+        return;
+    }
+    // A frame that wrapped left more than one region behind, they share the fence
+    GLsync fence = mpGL->InsertFence();
+    for (std::deque<Region>::reverse_iterator it = mRegions.rbegin(); it != mRegions.rend() && NULL == it->fence; ++it)
+    {
+        it->fence = fence;
+    }
+}
+
+// Waits until no region in flight overlaps [begin, end)
+//-----------------------------------------------------------------------------
+void CPUTStreamingBufferOGL::WaitForRange(UINT begin, UINT end)
+{
+    for (;;)
+    {
+        bool overlaps = false;
+        for (std::deque<Region>::iterator it = mRegions.begin(); it != mRegions.end(); ++it)
+        {
+            if (it->begin < end && begin < it->end)
+            {
+                overlaps = true;
+                break;
+            }
+        }
+        if (!overlaps)
+        {
+            return;
+        }
+
+        // Fences complete in order, so retire from the front until the range is free. If the
+        // oldest region has no fence yet this frame has gone all the way around the ring on its
+        // own and has to be fenced now. Blocks bound in the ring could be overwritten before
+        // the draws that use them, so they go back to their own buffers first.
+        if (NULL == mRegions.front().fence)
+        {
+            WriteBackUniformBuffers(true);
+            CloseRegion();
+        }
+        RetireOldestRegion(true);
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool CPUTStreamingBufferOGL::RetireOldestRegion(bool bBlock)
+{
+    GLsync fence = mRegions.front().fence;
+    if (NULL == fence || !mpGL->WaitFence(fence, bBlock))
+    {
+        return false;
+    }
+    mRegions.pop_front();
+    if (mRegions.empty() || mRegions.front().fence != fence)
+    {
+        mpGL->DeleteFence(fence);
+    }
+    return true;
+}
@@ -15,6 +15,7 @@
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "CPUTTextureOGL.h"
+#include "CPUTTextureCooker.h"
 #include "../middleware/stb/stb_image.h"
 #include "../middleware/libktx/ktx.h"
 #include "../middleware/libktx/ktxint.h"
@@ -162,19 +163,18 @@ static GLuint LoadTextureS3TC( const std::string TextureFileName, bool forceSRGB
 #ifdef CPUT_FOR_OGLES3
     forceSRGB = false;
 #endif
-    // Load the texture file
-    char* pData = NULL;
-    unsigned int fileSize = 0;
-    
-    CPUTResult result = CPUTFileSystem::ReadFileContents( TextureFileName, &fileSize, (void **)&pData, false, true);
-    if (result != CPUT_SUCCESS)
+    // Map the texture file, the mip data is uploaded straight from the view
+    CPUTFileSystem::CPUTFileView fileView;
+    CPUTResult result = fileView.Open( TextureFileName );
+    if (result != CPUT_SUCCESS || fileView.GetSize() < sizeof(DDSHeader))
     {
         //DEBUGMESSAGEBOX("File Read Error", "Failed to read file texture: %s\n", TextureFileName.c_str());
         return 0;
     }
+    const char* pData = fileView.GetData();
     
     // Read the header
-    DDSHeader* pHeader = (DDSHeader*)pData;
+    const DDSHeader* pHeader = (const DDSHeader*)pData;
 
     // Determine texture format
     GLenum internalFormat;
@@ -216,7 +216,7 @@ static GLuint LoadTextureS3TC( const std::string TextureFileName, bool forceSRGB
             {
                 //FOURCC_DX10
                 ddsHeaderSize += sizeof(DDSHeaderDX10);
-                DDSHeaderDX10 *pHeaderDX10 = (DDSHeaderDX10 *)((uint8_t *)pData + pHeader->mSize + 4); // add 4 to account for the magic DDS identifier at start of file
+                const DDSHeaderDX10 *pHeaderDX10 = (const DDSHeaderDX10 *)((const uint8_t *)pData + pHeader->mSize + 4); // add 4 to account for the magic DDS identifier at start of file
                 internalFormat = ConvertFormatDXToGL(pHeaderDX10->dxgiFormat);
                 blockSize = 16;
                 if (internalFormat == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) {
@@ -375,7 +375,6 @@ static GLuint LoadTextureS3TC( const std::string TextureFileName, bool forceSRGB
     } while(mip < pHeader->mMipMapCount);
     }
        
-    free( pData );
     return handle;
 }
 
@@ -386,13 +385,21 @@ static GLuint LoadTextureS3TC( const std::string TextureFileName, bool forceSRGB
 static GLuint LoadTexturePNG( const std::string TextureFileName, bool forceSRGB = true )
 {   
     // Load Texture File
-    char* pFileData = NULL;
-    unsigned int fileSize = 0;
-    
-    CPUTResult result = CPUTFileSystem::ReadFileContents( TextureFileName, &fileSize, (void **)&pFileData, false, true );
+    CPUTFileSystem::CPUTFileView fileView;
+    if (CPUTFAILED(fileView.Open( TextureFileName )))
+    {
+        DEBUG_PRINT("Failed to read texture %s\n", TextureFileName.c_str());
+        return 0;
+    }
     
     int width, height, numComponents;
-    unsigned char* pData = stbi_load_from_memory( (unsigned char*)pFileData, fileSize, &width, &height, &numComponents, 0 );
+    unsigned char* pData = stbi_load_from_memory( (const unsigned char*)fileView.GetData(), (int)fileView.GetSize(), &width, &height, &numComponents, 0 );
+    fileView.Close();
+    if (!pData)
+    {
+        DEBUG_PRINT("Failed to decode texture %s\n", TextureFileName.c_str());
+        return 0;
+    }
     
     // Generate handle
     GLuint handle;
@@ -442,7 +449,6 @@ static GLuint LoadTexturePNG( const std::string TextureFileName, bool forceSRGB
             // Unknown format
             assert(0);
             stbi_image_free( pData ); pData = NULL;
-            SAFE_DELETE_ARRAY( pFileData );
             return 0;
         }
     }
@@ -454,7 +460,6 @@ static GLuint LoadTexturePNG( const std::string TextureFileName, bool forceSRGB
     glGenerateMipmap( GL_TEXTURE_2D );
     
     stbi_image_free( pData ); pData = NULL;
-    SAFE_DELETE_ARRAY( pFileData );
 
     // Return handle
     return handle;
@@ -467,18 +472,20 @@ static GLuint LoadTexturePNG( const std::string TextureFileName, bool forceSRGB
 // This uses the KTX/ETC library provided by the Khronos Group (see libktx for details)
 static GLuint LoadTextureETC_KTX(const std::string TextureFileName, bool forceSRGB = true)
 {    
-    // Read/Load Texture File
-    char* pFileData = NULL;
-    unsigned int fileSize = 0;
-    
-	CPUTResult result = CPUTFileSystem::ReadFileContents( TextureFileName, &fileSize, (void **)&pFileData, false, true );
+    // Map/Load Texture File
+    CPUTFileSystem::CPUTFileView fileView;
+    if (CPUTFAILED(fileView.Open( TextureFileName )))
+    {
+        DEBUG_PRINT("Failed to read texture %s\n", TextureFileName.c_str());
+        return 0;
+    }
     
     // Generate handle & Load Texture
     GLuint handle = 0;
     GLenum target;
     GLboolean mipmapped;
         
-    KTX_error_code ktxResult = ktxLoadTextureM( pFileData, fileSize, &handle, &target, NULL, &mipmapped, NULL, NULL, NULL );
+    KTX_error_code ktxResult = ktxLoadTextureM( fileView.GetData(), (GLsizei)fileView.GetSize(), &handle, &target, NULL, &mipmapped, NULL, NULL, NULL );
         
     if( ktxResult != KTX_SUCCESS )
     {
@@ -499,7 +506,7 @@ static GLuint LoadTextureETC_KTX(const std::string TextureFileName, bool forceSR
     }
 
     // clean up
-    free( pFileData );
+    fileView.Close();
     
     // Return handle
     return handle;  
@@ -571,6 +578,22 @@ CPUTResult CPUTTextureOGL::CreateNativeTexture(
     size_t index = fileName.find_last_of(".");
     size_t length = fileName.length();
     std::string ext = fileName.substr(index + 1, (length - 1 - index));
+
+    // A cooked .dds next to the source image already has all the mips, see CPUTTextureCooker.h
+    if (CPUTTextureCooker::IsCookableFile(fileName))
+    {
+        std::string cookedFileName = CPUTTextureCooker::GetCookedFileName(fileName);
+        if (IsS3TCSupported() && CPUTTextureCooker::IsCookedFileUpToDate(fileName, cookedFileName, ForceLoadAsSRGB))
+        {
+            textureName = LoadTextureS3TC(cookedFileName, ForceLoadAsSRGB, textureID, textureType);
+            if (textureName)
+            {
+                *textureID = textureName;
+                return CPUT_SUCCESS;
+            }
+            DEBUG_PRINT("Failed to load cooked texture %s, using the source\n", cookedFileName.c_str());
+        }
+    }
     
     if (!ext.compare("dds"))
     {
@@ -587,7 +610,7 @@ CPUTResult CPUTTextureOGL::CreateNativeTexture(
             return CPUT_ERROR;
         }
     }
-    else if (!ext.compare("png")) {
+    else if (!ext.compare("png") || !ext.compare("jpg") || !ext.compare("jpeg")) {
         textureName = LoadTexturePNG(fileName, ForceLoadAsSRGB);
         *textureType = GL_TEXTURE_2D;
     } else if (!ext.compare("ktx")) {
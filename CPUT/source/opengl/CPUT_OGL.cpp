@@ -17,6 +17,8 @@
 #include "CPUT_OGL.h"
 #include "CPUTRenderStateBlockOGL.h"
 #include "CPUTGuiControllerOGL.h"
+#include "CPUTStreamingBufferOGL.h"
+#include "CPUTProgramCacheOGL.h"
 #include "CPUTCamera.h"
 #include "CPUTInputLayoutCache.h"
 #include <map>
@@ -293,6 +295,9 @@ void CPUT_OGL::ResizeWindowSoft(UINT width, UINT height)
 //-----------------------------------------------------------------------------
 void CPUT_OGL::UpdatePerFrameConstantBuffer( CPUTRenderParameters &renderParams, double totalSeconds )
 {
+    // New frame, fence what the last one streamed. Extra calls within a frame just fence sooner.
+    CPUTStreamingBufferOGL::GetStreamingBuffer()->OnFrameStart();
+
     //NOTE: Issue with using the value of the resultant Uniform Block in shader
     if( mpPerFrameConstantBuffer )
     {
@@ -512,6 +517,8 @@ void CPUT_OGL::ReleaseResources()
     SAFE_RELEASE(mpPerFrameConstantBuffer);
     SAFE_RELEASE(mpPerModelConstantBuffer);
     SAFE_RELEASE(mpSkinningDataConstantBuffer);
+    CPUTStreamingBufferOGL::DeleteStreamingBuffer();
+    CPUTProgramCacheOGL::DeleteProgramCache();
 
 }
 // Actually destroy all 'global' resource handling objects, all asset handlers,
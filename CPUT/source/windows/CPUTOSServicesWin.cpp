@@ -15,6 +15,8 @@
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "CPUTOSServices.h"
+#include <sys/types.h>
+#include <sys/stat.h>
 
 // Retrieves the current working directory
 //-----------------------------------------------------------------------------
@@ -178,6 +180,100 @@ CPUTResult CPUTFileSystem::ReadFileContents(const std::string &fileName, UINT *p
     return TranslateFileError(err);
 }
 
+// Get the size and last modification time of a file without opening it
+//-----------------------------------------------------------------------------
+CPUTResult CPUTFileSystem::GetFileInfo(const std::string &fileName, uint64_t *pSizeInBytes, uint64_t *pModifiedTime)
+{
+    // The FILETIME is already in 100 ns units, st_mtime would only have seconds
+    WIN32_FILE_ATTRIBUTE_DATA fileAttributes;
+    if (!GetFileAttributesExA(fileName.c_str(), GetFileExInfoStandard, &fileAttributes))
+    {
+        DWORD err = GetLastError();
+        return (err == ERROR_FILE_NOT_FOUND || err == ERROR_PATH_NOT_FOUND) ? CPUT_ERROR_FILE_NOT_FOUND : CPUT_ERROR_FILE_ERROR;
+    }
+
+    *pSizeInBytes  = ((uint64_t)fileAttributes.nFileSizeHigh << 32) | fileAttributes.nFileSizeLow;
+    *pModifiedTime = ((uint64_t)fileAttributes.ftLastWriteTime.dwHighDateTime << 32) | fileAttributes.ftLastWriteTime.dwLowDateTime;
+    return CPUT_SUCCESS;
+}
+
+// Map a file read-only, or read it into memory if it can't be mapped
+//-----------------------------------------------------------------------------
+CPUTResult CPUTFileSystem::CPUTFileView::Open(const std::string &fileName, bool bSequential)
+{
+    Close();
+
+    HANDLE hFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | (bSequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0), NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        DWORD err = GetLastError();
+        return (err == ERROR_FILE_NOT_FOUND || err == ERROR_PATH_NOT_FOUND) ? CPUT_ERROR_FILE_NOT_FOUND : CPUT_ERROR_FILE_ERROR;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(hFile, &fileSize))
+    {
+        CloseHandle(hFile);
+        return CPUT_ERROR_FILE_ERROR;
+    }
+    mSize = (uint64_t)fileSize.QuadPart;
+
+    if (mSize == 0)
+    {
+        // Empty files can't be mapped, and there is nothing to read anyway
+        CloseHandle(hFile);
+        mpData = "";
+        return CPUT_SUCCESS;
+    }
+
+    HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (hMapping)
+    {
+        mpMapping = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(hMapping); // the view keeps the mapping and the file alive
+    }
+    if (mpMapping)
+    {
+        CloseHandle(hFile);
+        mpData = (const char *)mpMapping;
+        return CPUT_SUCCESS;
+    }
+
+    // Mapping failed (e.g. out of address space), fall back to reading the file
+    mpBuffer = new char[(size_t)mSize];
+    uint64_t numBytesRead = 0;
+    while (numBytesRead < mSize)
+    {
+        DWORD count = 0;
+        uint64_t remaining = mSize - numBytesRead;
+        DWORD request = (DWORD)(remaining < 0x40000000 ? remaining : 0x40000000);
+        if (!ReadFile(hFile, mpBuffer + numBytesRead, request, &count, NULL) || count == 0)
+        {
+            CloseHandle(hFile);
+            Close();
+            return CPUT_ERROR_FILE_IO_ERROR;
+        }
+        numBytesRead += count;
+    }
+    CloseHandle(hFile);
+    mpData = mpBuffer;
+    return CPUT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+void CPUTFileSystem::CPUTFileView::Close()
+{
+    if (mpMapping)
+    {
+        UnmapViewOfFile(mpMapping);
+    }
+    SAFE_DELETE_ARRAY(mpBuffer);
+    mpMapping = NULL;
+    mpData    = NULL;
+    mSize     = 0;
+}
+
 
 // Translate a file operation error code
 //-----------------------------------------------------------------------------
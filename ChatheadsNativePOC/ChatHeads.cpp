@@ -10,15 +10,16 @@
 #include "CPUTLight.h"
 #include "CPUTTextureDX11.h"
 #include "CPUTRenderTarget.h"
+#include "CPUTMeshOptimizer.h"
 #ifdef _DEBUG
 	#include <DXGIDebug.h>
 #endif
 
-#include "VTuneScopedTask.h"
+#include "Trace.h"
 #include "TheoraException.h"
+#include "YUVConvert.h"
 #include "imgui.h"
 #include "imgui_impl_dx11.h"
-#include "SystemMetrics.h"
 
 #include <algorithm>
 #include <string>
@@ -27,14 +28,42 @@
 
 CPUTLight* GetLight(CPUTScene* pScene, LightType type);
 CPUTCamera* GetCamera(CPUTScene* pScene);
-__itt_domain* g_pDomain = __itt_domain_create(L"Chatheads.Sample");
 const UINT SHADOW_WIDTH_HEIGHT = 2048;
 
 
+// -replay <file.chf> [-replayfps <n>] [-record <file.chf>], or -replay:<file.chf> and so on;
+// call before Create
+void ChatHeads::SetCommandLine(int argc, char **argv)
+{
+	mParsedCommandLine.ParseConfigurationOptions(argc, argv);
+
+	const CommandOption options[] =
+	{
+		CommandOption::String("replay", &mOptions.replayFile),
+		CommandOption::Double("replayfps", &mOptions.replayFps, -1.0, 1000.0),
+		CommandOption::String("record", &mOptions.recordFile),
+	};
+	std::string errors;
+	if (!mParsedCommandLine.ApplyOptions(options, IM_ARRAYSIZE(options), &errors))
+		Log.Log(LOG_ERROR, "%s", errors.c_str());
+}
+
+
 void ChatHeads::Create()
 {
+	TraceSetThreadName("Render");
 	CreateBasicCPUTResources();
 	InitIMGUI();
+
+	// A recording stands in for the camera, so RealSense isn't needed
+	if (!mOptions.replayFile.empty())
+	{
+		mReplaySource.SetFile(mOptions.replayFile);
+		mReplaySource.SetRate(mOptions.replayFps);
+		mpFrameSource = &mReplaySource;
+		return;
+	}
+
 	bool bPreInit = mRSMgr.PreInit(); // need to do this to get the list of valid resolutions when using BGS
 
 	// Exit app if a realsense session wasn't started
@@ -54,7 +83,9 @@ void ChatHeads::Shutdown()
 	
 	mNetLayer.Shutdown();
 
+	mFrameRecorder.Stop();
 	mRSMgr.Shutdown();
+	mReplaySource.Shutdown();
 	ReleaseRSResources();
 
 	ReleaseMovieResources();
@@ -62,6 +93,9 @@ void ChatHeads::Shutdown()
 	mEncoder.Shutdown();
 	for (DecodeTransform& dt : mDecoders) dt.Shutdown();
 
+	mMetricsRecorder.Stop();
+	mMetrics.Shutdown();
+
 	ImGui_ImplDX11_Shutdown();
 }
 
@@ -73,6 +107,17 @@ void ChatHeads::Update(double deltaSeconds)
 
 	mNetLayer.WakeNetworkThread();
 
+	// Give the asset loader a slice of the frame for creating resources of a pending scene load
+	const double LOADER_BUDGET_MS = 4.0;
+	CPUTAssetLoader::GetAssetLoader()->ProcessMainThreadWork(LOADER_BUDGET_MS);
+	if (mpSceneLoadRequest && mpSceneLoadRequest->IsDone())
+	{
+		if (CPUTFAILED(mpSceneLoadRequest->GetResult()))
+			DEBUG_PRINT("Failed to load scene\n");
+		SAFE_RELEASE(mpSceneLoadRequest);
+		OnSceneLoaded();
+	}
+
 
     if (mpWindow->DoesWindowHaveFocus())
     {
@@ -82,7 +127,7 @@ void ChatHeads::Update(double deltaSeconds)
 
 	if (!mbPlayMovie)
 	{
-		if (mpScene)
+		if (mpScene && !mpSceneLoadRequest)
 			mpScene->Update((float)deltaSeconds);
 	}
 
@@ -165,6 +210,7 @@ void ChatHeads::ResizeWindow(UINT width, UINT height)
 void ChatHeads::Render(double deltaSeconds)
 {
 	mFrameRate = (double)(1.0f / deltaSeconds);
+	mMetricsRecorder.AddFrameTime(deltaSeconds * 1000.0);
     
 	CPUTRenderParameters renderParams;
     int windowWidth, windowHeight;
@@ -176,6 +222,7 @@ void ChatHeads::Render(double deltaSeconds)
 	renderParams.mpShadowCamera = mpShadowCamera;
 	renderParams.mpPerFrameConstants = mpPerFrameConstantBuffer;
 	renderParams.mpPerModelConstants = mpPerModelConstantBuffer;
+	renderParams.mpPerInstanceConstants = mpPerInstanceConstantBuffer;
 	renderParams.mpSkinningData = mpSkinningDataConstantBuffer;
   
     // Clear back buffer
@@ -189,6 +236,9 @@ void ChatHeads::Render(double deltaSeconds)
 		mpMovieMgr->update((curTick - mMovieTickCount) / 1000.0f);
 		mMovieTickCount = curTick;
 
+		if (mOptions.bMovieShaderYUV != mbMovieShaderYUV)
+			CreateMovieResources();
+
 		TheoraVideoFrame *pFrame = mpMovieClip->getNextFrame();
 
 		if (pFrame)
@@ -197,14 +247,19 @@ void ChatHeads::Render(double deltaSeconds)
 			mpMovieClip->popFrame();
 		}
 
-		mpMovieSprite->DrawSprite(renderParams);
+		if (mbMovieShaderYUV)
+			mpMovieSprite->DrawSprite(renderParams, *mpMovieYUVMaterial);
+		else
+			mpMovieSprite->DrawSprite(renderParams);
 	}
 	else
 	{
-		if (mpScene)
+		if (mpScene && !mpSceneLoadRequest)
 		{
 			const int DEFAULT_MATERIAL = 0;
-			const int SHADOW_MATERIAL = 1;
+
+			// Levels of detail for the main camera, the shadow pass draws the same ones
+			mpScene->SelectLods(mpCamera, mOptions.bSceneLod ? 1.0f : 0.0f);
 
 			//*******************************
 			// Draw the shadow scene
@@ -212,9 +267,7 @@ void ChatHeads::Render(double deltaSeconds)
 			renderParams.mWidth = SHADOW_WIDTH_HEIGHT;
 			renderParams.mHeight = SHADOW_WIDTH_HEIGHT;
 			UpdatePerFrameConstantBuffer(renderParams, deltaSeconds);
-			mpShadowRenderTarget->SetRenderTarget(renderParams, 0, 0.0f, true);
-			mpScene->Render(renderParams, SHADOW_MATERIAL);
-			mpShadowRenderTarget->RestoreRenderTarget(renderParams);
+			mShadowCache.Render(renderParams, mOptions.bCacheStaticShadows, this);
 
 			//*******************************
 			// Draw the regular scene
@@ -228,7 +281,7 @@ void ChatHeads::Render(double deltaSeconds)
 		}
 	}
 
-	if (mRSMgr.InitSuccess())
+	if (mpFrameSource->InitSuccess())
 		RenderChatheads(renderParams);	
 
 	if (mDisplayGUI)
@@ -236,6 +289,24 @@ void ChatHeads::Render(double deltaSeconds)
 }
 
 
+// With bCacheStaticShadows mShadowCache draws the static casters into mpStaticShadowRenderTarget
+// once and copies it into the shadow map, only dynamic ones are drawn every frame
+void ChatHeads::DrawShadowCasters(CPUTRenderParameters& renderParams, bool bStaticMap, bool bClear)
+{
+	const int SHADOW_MATERIAL = 1;
+
+	CPUTRenderTargetDepth *pTarget = bStaticMap ? mpStaticShadowRenderTarget : mpShadowRenderTarget;
+	pTarget->SetRenderTarget(renderParams, 0, 0.0f, bClear);
+	mpScene->Render(renderParams, SHADOW_MATERIAL);
+	pTarget->RestoreRenderTarget(renderParams);
+}
+
+void ChatHeads::CopyStaticShadowMap()
+{
+	mpContext->CopyResource(mpShadowRenderTarget->GetDepthTexture(), mpStaticShadowRenderTarget->GetDepthTexture());
+}
+
+
 /**************************************************************  CPUT Scene specifics ***************************************************************/
 CPUTLight* GetLight(CPUTScene* pScene, LightType type)
 {
@@ -308,11 +379,27 @@ void ChatHeads::LoadScene(std::string sceneFilename)
 	path = sceneFilename.substr(0, lastSlash + 1);
 	filename = sceneFilename.substr(lastSlash + 1);
 	pAssetLibrary->SetMediaDirectoryName(path);
-	mpScene->LoadScene(sceneFilename);
+
+	// Quantize and reorder the meshes as they load, about 15 ms for the conservatory.
+	// Models cooked with Extras/MeshCook are already done and barely change.
+	CPUTMeshOptimizer::SetLoadFlags(CPUT_MESH_OPTIMIZE_ALL);
+
+	// The scene streams in over the next frames, OnSceneLoaded() finishes the setup
+	mpSceneLoadRequest = mpScene->LoadSceneAsync(sceneFilename);
+}
+
+
+void ChatHeads::OnSceneLoaded()
+{
+	CPUTAssetLibrary *pAssetLibrary = CPUTAssetLibrary::GetAssetLibrary();
+
 	float3 sceneCenterPoint, halfVector;
 	mpScene->GetBoundingBox(&sceneCenterPoint, &halfVector);
 	float  length = halfVector.length();
 
+	// New casters and a new shadow camera below
+	mShadowCache.Invalidate();
+
 	mpCamera = GetCamera(mpScene);
 
 	if (mpCamera == NULL) {
@@ -393,6 +480,8 @@ void ChatHeads::CreateBasicCPUTResources()
 
     mpShadowRenderTarget = CPUTRenderTargetDepth::Create();
     mpShadowRenderTarget->CreateRenderTarget(std::string("$shadow_depth"), SHADOW_WIDTH_HEIGHT, SHADOW_WIDTH_HEIGHT, DXGI_FORMAT_D32_FLOAT);
+    mpStaticShadowRenderTarget = CPUTRenderTargetDepth::Create();
+    mpStaticShadowRenderTarget->CreateRenderTarget(std::string("$shadow_depth_static"), SHADOW_WIDTH_HEIGHT, SHADOW_WIDTH_HEIGHT, DXGI_FORMAT_D32_FLOAT);
     
     mpCameraController = CPUTCameraControllerFPS::Create();
     mpShadowCamera = CPUTCamera::Create(CPUT_ORTHOGRAPHIC);     
@@ -407,6 +496,11 @@ void ChatHeads::ReleaseBasicCPUTResources()
 
 	SAFE_DELETE(mpCameraController);
 	SAFE_DELETE(mpShadowRenderTarget);
+	SAFE_DELETE(mpStaticShadowRenderTarget);
+
+	// Stop the loader before the scene it may still be filling goes away
+	SAFE_RELEASE(mpSceneLoadRequest);
+	CPUTAssetLoader::DeleteAssetLoader();
 	SAFE_DELETE(mpScene);
 	CPUTAssetLibrary::GetAssetLibrary()->ReleaseAllLibraryLists();
 	CPUT_DX11::ReleaseResources();
@@ -416,13 +510,20 @@ void ChatHeads::ReleaseBasicCPUTResources()
 /**************************************************************  Realsense stuff  ***************************************************************/
 void ChatHeads::InitRealsenseAndEncoder()
 {
-	if (mRSMgr.InitSuccess())
+	if (mpFrameSource->InitSuccess())
 		return;
 
-	mRSMgr.SetResolution(mOptions.curResListIndex); // call before Init
+	if (mpFrameSource == &mRSMgr)
+		mRSMgr.SetResolution(mOptions.curResListIndex); // call before Init
 
-	if (mRSMgr.Init())	
-		mEncoder.Init(mRSMgr.VideoWidth(), mRSMgr.VideoHeight());
+	if (mpFrameSource->Init())
+	{
+		mEncoder.Init(mpFrameSource->VideoWidth(), mpFrameSource->VideoHeight());
+		if (!mOptions.recordFile.empty())
+			mFrameRecorder.Start(mOptions.recordFile.c_str(), mpFrameSource->VideoWidth(), mpFrameSource->VideoHeight(), mpFrameSource->FrameRate());
+	}
+	else if (mpFrameSource == &mReplaySource)
+		CPUTOSServices::OpenMessageBox("Error", "Couldn't play the recording " + mOptions.replayFile + ". Is it a .chf file written by -record?");
 	else
 		CPUTOSServices::OpenMessageBox("Error", "Realsense initialization failed. Is your camera plugged in? If so, try another resolution. If that doesn't work, restart the RealsenseDCMF250 service in Task Manager.");
 
@@ -448,6 +549,9 @@ void ChatHeads::ReleaseRSResources()
 	for (auto& rd : mRemoteChatheads)
 		SAFE_DELETE_ARRAY(rd.imgBuffer.pBuffer);
 
+	mChatheadRenderer.Release();
+	SAFE_DELETE(mpChatheadDevice);
+
 	mChatheadSprites.clear();
 	mChatheadTextures.clear();
 	mRemoteChatheads.clear();
@@ -463,10 +567,10 @@ void ChatHeads::CreateDefaultChatheadResources()
 
 	int width = 320, height = 240;
 
-	if (mRSMgr.InitSuccess())
+	if (mpFrameSource->InitSuccess())
 	{
-		width = mRSMgr.VideoWidth();
-		height = mRSMgr.VideoHeight();
+		width = mpFrameSource->VideoWidth();
+		height = mpFrameSource->VideoHeight();
 	}
 
 	std::string textureName("$chathead_texture");
@@ -491,6 +595,14 @@ void ChatHeads::CreateDefaultChatheadResources()
 		mChatheadTextures.push_back(pChatheadTexture);
 	}
 
+	// Texture array + instance buffer for drawing all the chatheads at once. The sprites above stay as the fallback.
+	mpChatheadDevice = new ChatheadRenderDeviceDX11(mpD3dDevice, mpContext);
+	if (!mChatheadRenderer.Init(mpChatheadDevice, mNetLayer.cMaxPlayers, width, height))
+	{
+		Log.Log(LOG_ERROR, "Failed to create the instanced chathead renderer. Falling back to one sprite per chathead.");
+		SAFE_DELETE(mpChatheadDevice);
+	}
+
 	// create buffers to hold remote player chathead data (before it's written to the DX texture)
 	const int maxRemotePlayers = mNetLayer.cMaxPlayers - 1;
 	for (int ii = 0; ii < maxRemotePlayers; ii++) {
@@ -508,6 +620,8 @@ void ChatHeads::CreateDefaultChatheadResources()
 		rd.bWasUpdated = false;
 		rd.bSizeChanged = false;
 		rd.userLock = IL_UNLOCK;
+		rd.flowId = 0;
+		rd.framesReceived = 0;
 				
 		mRemoteChatheads.push_back(rd);
 	}
@@ -606,6 +720,8 @@ void ChatHeads::CreateChatheadSprites()
 		}
 
 		mChatheadSprites.push_back(CPUTSprite::Create(topLeftViewportX, topLeftViewportY, spriteWidth, spriteHeight, pChatheadMaterial));
+		if (mChatheadRenderer.IsInitialized())
+			mChatheadRenderer.SetRect(ii, topLeftViewportX, topLeftViewportY, spriteWidth, spriteHeight);
 
 		if (ii == 0)
 		{
@@ -638,62 +754,45 @@ void ChatHeads::RecreateChatheadSprites()
 
 void ChatHeads::RenderChatheads(CPUTRenderParameters& renderParams)
 {
-	VTUNE_TASK(g_pDomain, "RenderChatheads");
+	TRACE_SCOPE("RenderChatheads");
 
 	// --- update local players chathead & send over n/w ---- 
 	{		
-		VTUNE_TASK(g_pDomain, "LocalPlayer");
+		TRACE_SCOPE("LocalPlayer");
 		
-		if (mRSMgr.mSharedData.bImageUpdated)
+		if (mpFrameSource->mSharedData.bImageUpdated)
 		{
-			if (InterlockedExchange(&mRSMgr.mSharedData.hLock, IL_LOCK) == IL_UNLOCK)
+			if (InterlockedExchange(&mpFrameSource->mSharedData.hLock, IL_LOCK) == IL_UNLOCK)
 			{
-				// lock resource to update on the CPU
-				CPUTRenderTargetColor *mpLocalPlayerChatheadRT = mChatheadTextures[0];
-				D3D11_MAPPED_SUBRESOURCE mappedResource = mpLocalPlayerChatheadRT->MapRenderTarget(renderParams, CPUT_MAP_WRITE_DISCARD, true);
+				RSAppSharedData& data = mpFrameSource->mSharedData;
+				TRACE_FLOW_END("LocalFrame", data.frameId);
 
-				RSAppSharedData& data = mRSMgr.mSharedData;
-
-				// copy the shared data to the mapped resource
-				byte *pDst = (byte*)mappedResource.pData;
 				byte *pSrc = data.segImage.pBuffer;
-
 				const int height = data.segImage.height;
 				const int width = data.segImage.width;
-				const size_t numBytes = width * height * RealsenseMgr::cBytesPerPixel;
-				const size_t dstRowPitch = mappedResource.RowPitch;
-				const size_t srcRowPitch = data.segImage.width * RealsenseMgr::cBytesPerPixel;
-
-				// src pitch can be different from the dst row pitch (latter can have padding)
-				// if so, copy the image row by row
-				if (srcRowPitch != dstRowPitch) {
-					for (int j = 0; j < height; j++)
-					{
-						memcpy(pDst, pSrc, srcRowPitch);
-						pDst += dstRowPitch;
-						pSrc += srcRowPitch;
-					}
-				}
-				else
-					memcpy(pDst, pSrc, numBytes);
+				const size_t numBytes = width * height * FrameSource::cBytesPerPixel;
 
-				mpLocalPlayerChatheadRT->UnmapRenderTarget(renderParams);
+				UploadChatheadFrame(0, pSrc, width, height, renderParams);
+				mFrameRecorder.AddFrame(pSrc);
 
 
 				{					
 					// Encode only when you can send data out on the network
 					if (mNetLayer.InitComplete() && mNetLayer.CanSendData() && mNetLayer.IsConnected())
 					{
+						const double encodeStart = SystemMetrics::GetTimeSeconds();
 						EncoderOutput etn = mEncoder.EncodeData(reinterpret_cast<char*>(pSrc), numBytes);
+						mMetricsRecorder.AddEncodeTime((SystemMetrics::GetTimeSeconds() - encodeStart) * 1000.0);
 						
 						// Encoder returns false when more data is needed, in which case nothing is sent over the n/w
 						if (etn.returnCode == S_OK)
 						{
+							TRACE_COUNTER("EncodedBytes", etn.numBytes);
 							const bool bBroadcast = mNetLayer.IsServer();
 							NetMsgVideoUpdate msg;
 							msg.header.playerId = mNetLayer.PlayerID();
-							msg.header.width = mRSMgr.VideoWidth();
-							msg.header.height = mRSMgr.VideoHeight();
+							msg.header.width = mpFrameSource->VideoWidth();
+							msg.header.height = mpFrameSource->VideoHeight();
 							msg.header.timestamp = etn.timestamp;
 							msg.header.duration = etn.duration;
 							msg.pEncodedData = etn.pEncodedData;
@@ -706,8 +805,8 @@ void ChatHeads::RenderChatheads(CPUTRenderParameters& renderParams)
 					}
 				}
 
-				mRSMgr.mSharedData.bImageUpdated = false;
-				InterlockedExchange(&mRSMgr.mSharedData.hLock, IL_UNLOCK);
+				data.bImageUpdated = false;
+				InterlockedExchange(&data.hLock, IL_UNLOCK);
 			} // got lock
 
 		} // image was updated
@@ -718,7 +817,7 @@ void ChatHeads::RenderChatheads(CPUTRenderParameters& renderParams)
 	// (if the network is updating the buffers, then, we simply show the last texture contents)
 	if (mNetLayer.IsConnected())
 	{	
-		VTUNE_TASK(g_pDomain, "RemotePlayers");
+		TRACE_SCOPE("RemotePlayers");
 
 		// TODO: this should be over # active players, not max
 		const int maxRemotePlayers = mNetLayer.cMaxPlayers - 1;
@@ -734,36 +833,10 @@ void ChatHeads::RenderChatheads(CPUTRenderParameters& renderParams)
 				// If the network thread isn't writing to the buffer and there was an update, update the DX textures
 				if (InterlockedExchange(&userLock, IL_LOCK) == IL_UNLOCK)
 				{
+					TRACE_SCOPE_ARG("UploadRemoteChathead", "player", ii + 1);
+					TRACE_FLOW_END("RemoteFrame", rd.flowId);
 					ASSERT(ii < mNetLayer.cMaxPlayers, "remote player texture out of range");
-					CPUTRenderTargetColor *mpRemotePlayerChatheadRT = mChatheadTextures[ii + 1]; // ii = 0 represents the local player's video texture
-					// lock
-					D3D11_MAPPED_SUBRESOURCE mappedResource = mpRemotePlayerChatheadRT->MapRenderTarget(renderParams, CPUT_MAP_WRITE_DISCARD, true);
-
-					// copy the shared data to the mapped resource
-					byte *pDst = (byte*)mappedResource.pData;
-					byte *pSrc = rd.imgBuffer.pBuffer;
-
-					const int height = rd.imgBuffer.height;
-					const int width = rd.imgBuffer.width;
-					const size_t numBytes = width * height * RealsenseMgr::cBytesPerPixel;
-					const size_t dstRowPitch = mappedResource.RowPitch;
-					const size_t srcRowPitch = width * RealsenseMgr::cBytesPerPixel;
-
-					// src pitch can be different from the dst row pitch (latter can have padding)
-					// if so, copy the image row by row
-					if (srcRowPitch != dstRowPitch) {
-						for (int j = 0; j < height; j++)
-						{
-							memcpy(pDst, pSrc, srcRowPitch);
-							pDst += dstRowPitch;
-							pSrc += srcRowPitch;
-						}
-					}
-					else
-						memcpy(pDst, pSrc, numBytes);
-
-					// unlock
-					mpRemotePlayerChatheadRT->UnmapRenderTarget(renderParams);
+					UploadChatheadFrame(ii + 1, rd.imgBuffer.pBuffer, rd.imgBuffer.width, rd.imgBuffer.height, renderParams); // ii = 0 represents the local player's video texture
 					rd.bWasUpdated = false;
 					InterlockedExchange(&userLock, IL_UNLOCK);
 				}
@@ -779,18 +852,65 @@ void ChatHeads::RenderChatheads(CPUTRenderParameters& renderParams)
 
 void ChatHeads::DrawChatheadSprites(CPUTRenderParameters& rp)
 {
+	if (mOptions.bInstancedChatheads && mChatheadRenderer.IsInitialized())
+	{
+		// Same cutoffs the encoder/decoders use for background pixels: the local frame is the segmented RGBA image, remote ones are decoded
+		mChatheadRenderer.SetAlphaThreshold(0, mOptions.encodingThreshold / 255.0f);
+		for (int ii = 1; ii < mChatheadRenderer.GetChatheadCount(); ii++)
+			mChatheadRenderer.SetAlphaThreshold(ii, mOptions.decodingThreshold / 255.0f);
+
+		mChatheadRenderer.Draw();
+		return;
+	}
+
 	for (auto& sprite : mChatheadSprites)
 		sprite->DrawSprite(rp);
 }
 
 
+// Copy a BGRA frame to the chathead's slice of the instanced renderer's texture array, or to its own texture when drawing sprites
+void ChatHeads::UploadChatheadFrame(int index, byte *pSrc, int width, int height, CPUTRenderParameters& renderParams)
+{
+	const size_t srcRowPitch = width * RealsenseMgr::cBytesPerPixel;
+
+	if (mOptions.bInstancedChatheads && mChatheadRenderer.IsInitialized())
+	{
+		mChatheadRenderer.UpdateFrame(index, pSrc, width, height, (int)srcRowPitch);
+		return;
+	}
+
+	// lock resource to update on the CPU
+	CPUTRenderTargetColor *pChatheadRT = mChatheadTextures[index];
+	D3D11_MAPPED_SUBRESOURCE mappedResource = pChatheadRT->MapRenderTarget(renderParams, CPUT_MAP_WRITE_DISCARD, true);
+
+	// copy the frame to the mapped resource
+	byte *pDst = (byte*)mappedResource.pData;
+	const size_t numBytes = width * height * RealsenseMgr::cBytesPerPixel;
+	const size_t dstRowPitch = mappedResource.RowPitch;
+
+	// src pitch can be different from the dst row pitch (latter can have padding)
+	// if so, copy the image row by row
+	if (srcRowPitch != dstRowPitch) {
+		for (int j = 0; j < height; j++)
+		{
+			memcpy(pDst, pSrc, srcRowPitch);
+			pDst += dstRowPitch;
+			pSrc += srcRowPitch;
+		}
+	}
+	else
+		memcpy(pDst, pSrc, numBytes);
+
+	pChatheadRT->UnmapRenderTarget(renderParams);
+}
+
+
 /**************************************************************  Network stuff  ****************************************************************/
 // Update remote player's texture buffer after decoding the video data
 // Note: This executes on the networking thread (callback during message processing)
 void ChatHeads::UpdateRemoteChatheadBuffer(NetMsgVideoUpdate *pMsg)
 {
-	std::string taskname("ReceiveVideoData : " + std::to_string(pMsg->header.playerId));
-	VTUNE_TASK(g_pDomain, taskname.c_str());
+	TRACE_SCOPE_ARG("ReceiveVideoData", "playerId", pMsg->header.playerId);
 
 	// Since this function is a callback from the network thread, it is possible for it to execute before realsense resource creation
 	if (!mbChatheadResourcesCreated || (!mNetLayer.IsClientConnectedToServer() && !mNetLayer.IsServer()))
@@ -818,10 +938,12 @@ void ChatHeads::UpdateRemoteChatheadBuffer(NetMsgVideoUpdate *pMsg)
 		mDecoders[rpIndex].Init(pMsg->header.width, pMsg->header.height);
 
 	
+	const double decodeStart = SystemMetrics::GetTimeSeconds();
 	DecoderOutput dtn = mDecoders[rpIndex].DecodeData(reinterpret_cast<byte*>(pMsg->pEncodedData),
 															(DWORD)pMsg->sizeBytes,
 															pMsg->header.timestamp,
 															pMsg->header.duration);
+	mMetricsRecorder.AddDecodeTime((SystemMetrics::GetTimeSeconds() - decodeStart) * 1000.0);
 
 	//Log.Log(LOG_INFO, "RCV: Message tiemstamp %lld, duration %lld, size %lu \n", pMsg->header.timestamp, pMsg->header.duration, pMsg->sizeBytes);
 
@@ -832,7 +954,7 @@ void ChatHeads::UpdateRemoteChatheadBuffer(NetMsgVideoUpdate *pMsg)
 
 		if (InterlockedExchange(&userLock, IL_LOCK) == IL_UNLOCK)
 		{
-			VTUNE_TASK(g_pDomain, "UpdateRemoteChatheadTexture");
+			TRACE_SCOPE("UpdateRemoteChatheadTexture");
 
 			// TODO: need a map between client id and remote buffer index
 			ASSERT(rpIndex >= 0, "Bad client ID received");
@@ -841,6 +963,10 @@ void ChatHeads::UpdateRemoteChatheadBuffer(NetMsgVideoUpdate *pMsg)
 			memcpy(buf.pBuffer, dtn.pDecodedData, dtn.numBytes);
 			mRemoteChatheads[rpIndex].bWasUpdated = true;
 
+			// Ids of the local frames are small numbers, keep the remote ones apart
+			mRemoteChatheads[rpIndex].flowId = ((uint64_t)(rpIndex + 1) << 32) | ++mRemoteChatheads[rpIndex].framesReceived;
+			TRACE_FLOW_BEGIN("RemoteFrame", mRemoteChatheads[rpIndex].flowId);
+
 			InterlockedExchange(&userLock, IL_UNLOCK);
 		}
 		else
@@ -876,7 +1002,8 @@ void ChatHeads::InitMovieTexturePlayback(std::string moviePath)
 
 	try
 	{
-		mpMovieClip = mpMovieMgr->createVideoClip(moviePath, TH_RGBX);
+		// YUVX skips the decoder's per pixel YUV->RGB conversion, see CreateMovieResources
+		mpMovieClip = mpMovieMgr->createVideoClip(moviePath, TH_YUVX);
 	}
 	catch (_TheoraGenericException* e)
 	{
@@ -897,10 +1024,20 @@ void ChatHeads::InitMovieTexturePlayback(std::string moviePath)
 }
 
 
+// Frames come in as TH_YUVX. With bMovieShaderYUV they go into a UNORM texture as they are and PSMainYUVX
+// (movietextureyuv material) converts them; otherwise ConvertYUVXToRGBX converts them while they are copied
+// into an sRGB texture, for when the YUV shader isn't available.
 void ChatHeads::CreateMovieResources()
 {
 	CPUTAssetLibrary *pAssetLibrary = CPUTAssetLibrary::GetAssetLibrary();
 
+	if (mOptions.bMovieShaderYUV && mpMovieRenderTarget && !mpMovieYUVMaterial)
+	{
+		mOptions.bMovieShaderYUV = false; // tried before and failed
+	}
+	mbMovieShaderYUV = mOptions.bMovieShaderYUV;
+	DXGI_FORMAT format = mbMovieShaderYUV ? DXGI_FORMAT_R8G8B8A8_UNORM : DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+
 	if (!mpMovieRenderTarget)
 	{
 		mpMovieRenderTarget = CPUTRenderTargetColor::Create();
@@ -908,16 +1045,23 @@ void ChatHeads::CreateMovieResources()
 			"$movie_texture",
 			mpMovieClip->getWidth(),
 			mpMovieClip->getHeight(),
-			DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,
+			format,
 			1,
 			false,
 			false,
 			D3D11_USAGE_DYNAMIC);		// using dynamic here prevents the staging texture creation & extra gpu copy during Map/Unmap
 
 		mpMovieTexMaterial = pAssetLibrary->GetMaterial("%movietexture");
+		mpMovieYUVMaterial = pAssetLibrary->GetMaterial("%movietextureyuv");
 
 		mpMovieSprite = CPUTSprite::Create(-1.0f, -1.0f, 2.0f, 2.0f, mpMovieTexMaterial);
 
+		if (mbMovieShaderYUV && !mpMovieYUVMaterial)
+		{
+			Log.Log(LOG_WARNING, "Movie YUV material unavailable, converting on the CPU");
+			mOptions.bMovieShaderYUV = false;
+			CreateMovieResources();
+		}
 	}
 	else
 	{
@@ -926,7 +1070,7 @@ void ChatHeads::CreateMovieResources()
 			"$movie_texture",
 			mpMovieClip->getWidth(),
 			mpMovieClip->getHeight(),
-			DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,
+			format,
 			1,
 			false,
 			true, // recreate
@@ -948,6 +1092,7 @@ void ChatHeads::ReleaseMovieResources()
 	SAFE_DELETE(mpMovieSprite);
 	SAFE_DELETE(mpMovieRenderTarget);
 	SAFE_RELEASE(mpMovieTexMaterial);
+	SAFE_RELEASE(mpMovieYUVMaterial);
 }
 
 
@@ -970,13 +1115,24 @@ void ChatHeads::UpdateMovieTexture(unsigned char* pframe, CPUTRenderParameters&
 	unsigned char* pvData = (unsigned char*) mappedResource.pData;
 	const int iSize = mpMovieClip->getWidth() * 4; // 4 bytes per pixel
 
-	for (int i = 0; i < mpMovieClip->getHeight();)
+	if (!mbMovieShaderYUV)
+	{
+		ConvertYUVXToRGBX(pframe, iSize, pvData, mappedResource.RowPitch, mpMovieClip->getWidth(), mpMovieClip->getHeight());
+	}
+	else if (mappedResource.RowPitch == (UINT)iSize)
 	{
-		memcpy(pvData, pframe, iSize);
+		memcpy(pvData, pframe, iSize * mpMovieClip->getHeight());
+	}
+	else
+	{
+		for (int i = 0; i < mpMovieClip->getHeight();)
+		{
+			memcpy(pvData, pframe, iSize);
 
-		++i;
-		pvData += mappedResource.RowPitch;
-		pframe += iSize;
+			++i;
+			pvData += mappedResource.RowPitch;
+			pframe += iSize;
+		}
 	}
 
 	mpMovieRenderTarget->UnmapRenderTarget(renderParams);
@@ -989,9 +1145,13 @@ void ChatHeads::InitIMGUI()
 	ImGui_ImplDX11_Init(mpWindow->GetHWnd(), mpD3dDevice, mpContext);
 	Log.Log(LOG_INFO, "Initializing Imgui");
 
+	// The font atlas is built on the first NewFrame(); later runs load it from here
+	CPUTFileSystem::GetExecutableDirectory(&mFontAtlasCacheFile);
+	mFontAtlasCacheFile += "imgui_fonts.cache";
+	ImGui::GetIO().Fonts->CacheFilename = mFontAtlasCacheFile.c_str();
+
 	// System metrics init
-	InitCPUQuery();
-	InitCPUInfo();
+	mMetrics.Init();
 }
 
 
@@ -1030,6 +1190,16 @@ void ChatHeads::PersistentUI()
 	if (ImGui::Button("Load Scene"))
 		SelectScene();
 
+	ImGui::Checkbox("Movie YUV in shader", &mOptions.bMovieShaderYUV);
+	ImGui::SameLine(); ShowHelpMarker("Convert movie frames from YUV in the pixel shader. Off converts them on the CPU (SSE2) while uploading.");
+
+	ImGui::Checkbox("Scene LOD", &mOptions.bSceneLod);
+	ImGui::SameLine(); ShowHelpMarker("Draw scene models that are small on screen with their simplified meshes (<model>_lodN.mdl, written by MeshCook -lod).");
+
+	ImGui::Checkbox("Cache static shadows", &mOptions.bCacheStaticShadows);
+	ImGui::SameLine(); ShowHelpMarker("Draw static shadow casters into a cached map once and only dynamic ones (\"dynamic = true\" in the .set, or animated) every frame. Moving a static model redraws the cache.");
+	ImGui::Text("Shadow pass draws: %d", mShadowCache.GetDrawCount());
+
 	std::vector<VideoResolution>& resolutions = mRSMgr.GetResolutions();
 	ImGui::ListBox("Resolutions", &(mOptions.curResListIndex), GetUIListItem, reinterpret_cast<void*> (&resolutions), (int)resolutions.size(), (int)resolutions.size());
 }
@@ -1073,9 +1243,12 @@ void ChatHeads::NetworkUI()
 void ChatHeads::PostStartUI()
 {
 	// Change local chathead resolution
-	if (ImGui::Button("Set Resolution"))
+	if (mpFrameSource == &mRSMgr && ImGui::Button("Set Resolution"))
 	{
 		// Each time a new profile (resolution) is chosen, unfortunately have to restart the RS camera.			
+		// A recording has one resolution, so it ends here.
+		mFrameRecorder.Stop();
+		mOptions.recordFile.clear();
 		mRSMgr.Shutdown();
 		mRSMgr.PreInit();
 		InitRealsenseAndEncoder();
@@ -1098,25 +1271,29 @@ void ChatHeads::PostStartUI()
 
 	if (ImGui::CollapsingHeader("BGS/Media controls", 0, true, true))
 	{
-		if (mRSMgr.InitSuccess())
+		if (mpFrameSource->InitSuccess())
 		{
 			// these options make sense only if local bgs image exists
 			ImGui::Checkbox("Show BGS Image", &mOptions.bEnableBGS);
 			ImGui::SameLine(); ShowHelpMarker("Show background segmentated image (disabling this doesn't stop the BGS logic from running; it just shows the color stream instead. To compare perf w/ and w/o BGS running, use Pause BGS");
-			mRSMgr.DoSegmentation(mOptions.bEnableBGS);
+			mpFrameSource->DoSegmentation(mOptions.bEnableBGS);
 			mEncoder.mbEncodeBackgroundPixels = mOptions.bEnableBGS;
 			for (DecodeTransform& d : mDecoders) { d.mbEncodeBackgroundPixels = mOptions.bEnableBGS; }
 
-			ImGui::Checkbox("Pause BGS", &mOptions.bPauseBGS);
-			ImGui::SameLine(); ShowHelpMarker("Pause background segmentation. This uses the RSSDK API to stop all algorithmic work for BGS. See the CPU utilization change as a result.");
-			mRSMgr.PauseBGS(mOptions.bPauseBGS);
+			// a recording was segmented when it was made
+			if (mpFrameSource == &mRSMgr)
+			{
+				ImGui::Checkbox("Pause BGS", &mOptions.bPauseBGS);
+				ImGui::SameLine(); ShowHelpMarker("Pause background segmentation. This uses the RSSDK API to stop all algorithmic work for BGS. See the CPU utilization change as a result.");
+				mRSMgr.PauseBGS(mOptions.bPauseBGS);
 
 #if PXC_VERSION_MAJOR >= RSSDK_BGS_FREQ_MAJ_VERSION
-			const char* bgsFreqOptions[] = { "Run every frame", "Run every alternate frame", "Run once in three frames", "Run once in four frames" , "Run once in five frames"};
-			ImGui::Combo("BGS frequency", &mOptions.frameSkipInterval, bgsFreqOptions, IM_ARRAYSIZE(bgsFreqOptions));
-			mRSMgr.SetBGSFrameSkipInterval(mOptions.frameSkipInterval);
-			ImGui::SameLine(); ShowHelpMarker("Coarse control over the frequency at which BGS algorithm runs. SDK allows to skip at most four frames.");
+				const char* bgsFreqOptions[] = { "Run every frame", "Run every alternate frame", "Run once in three frames", "Run once in four frames" , "Run once in five frames"};
+				ImGui::Combo("BGS frequency", &mOptions.frameSkipInterval, bgsFreqOptions, IM_ARRAYSIZE(bgsFreqOptions));
+				mRSMgr.SetBGSFrameSkipInterval(mOptions.frameSkipInterval);
+				ImGui::SameLine(); ShowHelpMarker("Coarse control over the frequency at which BGS algorithm runs. SDK allows to skip at most four frames.");
 #endif
+			}
 
 			ImGui::SliderInt("Encoding Threshold", &mOptions.encodingThreshold, 0, 255);
 			ImGui::SameLine(); ShowHelpMarker("Pre-encoding, RGBA pixels with alpha channel lesser than this represent the background (fully transparent). YUYV is set to 0 for background pixels. (RGBA->YUYV->Encode)");
@@ -1132,7 +1309,7 @@ void ChatHeads::PostStartUI()
 		}
 	}
 
-	if (mRSMgr.InitSuccess() && ImGui::CollapsingHeader("Size/Pos controls", 0, true, true))
+	if (mpFrameSource->InitSuccess() && ImGui::CollapsingHeader("Size/Pos controls", 0, true, true))
 	{
 		bool bSizeChanged = ImGui::DragFloat2("size", (float*)&mOptions.chatHeadSize, 1.0f, 0.1f, 100.0f, "%.0f");
 		ImGui::SameLine(); ShowHelpMarker("Click+Drag to resize local chathead");
@@ -1152,8 +1329,14 @@ void ChatHeads::PostStartUI()
 				CPUTMaterial* pChatheadMaterial = CPUTAssetLibrary::GetAssetLibrary()->GetMaterial("%chathead0");
 				mChatheadSprites[0] = CPUTSprite::Create(vpX, vpY, vpWidth, vpHeight, pChatheadMaterial);
 				SAFE_RELEASE(pChatheadMaterial);
+
+				if (mChatheadRenderer.IsInitialized())
+					mChatheadRenderer.SetRect(0, vpX, vpY, vpWidth, vpHeight);
 			}
 		}
+
+		ImGui::Checkbox("Instanced chatheads", &mOptions.bInstancedChatheads);
+		ImGui::SameLine(); ShowHelpMarker("Draw all chatheads with one instanced draw call from a texture array, instead of a sprite (material, texture and draw call) per chathead");
 	}
 
 	if (mNetLayer.IsConnected() && ImGui::CollapsingHeader("Network control/info", 0, true, true))
@@ -1222,7 +1405,11 @@ void ChatHeads::PostStartUI()
 		
 
 		ImGui::Text("Frame rate: %f ", ImGui::GetIO().Framerate);		
-		ImGui::Text("Chat Head resolution: %dx%d ", mRSMgr.VideoWidth(), mRSMgr.VideoHeight());
+		ImGui::Text("Chat Head resolution: %dx%d ", mpFrameSource->VideoWidth(), mpFrameSource->VideoHeight());
+		if (mpFrameSource == &mReplaySource)
+			ImGui::Text("Replaying %s (%u frames delivered)", mReplaySource.GetFile().c_str(), mReplaySource.FramesDelivered());
+		if (mFrameRecorder.IsRecording())
+			ImGui::Text("Recording %s: %u frames, %u dropped", mOptions.recordFile.c_str(), mFrameRecorder.FramesWritten(), mFrameRecorder.FramesDropped());
 		ImGui::Text("RSSDK version %d.%d ", mRSMgr.SDKVersionMajor(), mRSMgr.SDKVersionMinor());
 		ImGui::Text("DCM version %d.%d ", mRSMgr.DCMVersionMajor(), mRSMgr.DCMVersionMinor());
 		ImGui::Text("IP Address: %s", mNetLayer.GetIPAddress());
@@ -1236,20 +1423,45 @@ void ChatHeads::SystemMetricsUI()
 {
 	ImGui::Begin("Metrics");
 
+	mMetrics.Sample();
+
+	bool bRecording = mMetricsRecorder.IsRecording();
+	if (ImGui::Checkbox("Record to ChatheadsMetrics.csv", &bRecording))
+	{
+		if (bRecording)
+			mMetricsRecorder.Start("ChatheadsMetrics.csv", MetricsRecorder::CSV, 1000);
+		else
+			mMetricsRecorder.Stop();
+	}
+	ImGui::SameLine(); ShowHelpMarker("Once a second: system, per-core and process CPU, RSS, and frame/encode/decode times (count, avg, max)");
+
+	bool bTracing = TraceIsEnabled();
+	if (ImGui::Checkbox("Trace", &bTracing))
+		TraceSetEnabled(bTracing);
+	ImGui::SameLine();
+	if (ImGui::Button("Save ChatheadsTrace.json"))
+	{
+		if (TraceWriteChromeJSON("ChatheadsTrace.json"))
+			Log.Log(LOG_INFO, "Wrote ChatheadsTrace.json");
+		else
+			Log.Log(LOG_ERROR, "Couldn't write ChatheadsTrace.json");
+	}
+	ImGui::SameLine(); ShowHelpMarker("The last few seconds of capture/encode/send/receive/decode/upload on every thread, with arrows following each frame. Open in chrome://tracing or ui.perfetto.dev");
+
 	if (ImGui::CollapsingHeader("System Metrics", 0, true, false))
 	{
-		ImGui::Text("Num Logical Cores: %d", NumProcessors());
-		ImGui::Text("Physical memory total : %ld MB", TotalPhysicalMemory() >> 20);
-		ImGui::Text("Physical memory used  : %ld MB", PhysicalMemoryUsed() >> 20);
-		ImGui::Text("Virtual memory total  : %ld MB", TotalVirtualMemory() >> 20);
-		ImGui::Text("Virtual memory used   : %ld MB", VirtualMemoryUsed() >> 20);
+		ImGui::Text("Num Logical Cores: %d", mMetrics.NumProcessors());
+		ImGui::Text("Physical memory total : %llu MB", mMetrics.TotalPhysicalMemory() >> 20);
+		ImGui::Text("Physical memory used  : %llu MB", mMetrics.PhysicalMemoryUsed() >> 20);
+		ImGui::Text("Virtual memory total  : %llu MB", mMetrics.TotalVirtualMemory() >> 20);
+		ImGui::Text("Virtual memory used   : %llu MB", mMetrics.VirtualMemoryUsed() >> 20);
 
 		static ImVector<float> cpuUsed; if (cpuUsed.empty()) { cpuUsed.resize(90); memset(cpuUsed.Data, 0, cpuUsed.Size*sizeof(float)); }
 		static int cuId = 0;
 		static float totalCPUPercUsage = 0;
 		float avgCPUPercUsage = 0;
 
-		cpuUsed[cuId] = (float)CPUUsed();
+		cpuUsed[cuId] = (float)mMetrics.CPUUsed();
 		cuId = (cuId + 1) % cpuUsed.Size;
 		totalCPUPercUsage += cpuUsed[cuId];		
 
@@ -1268,15 +1480,15 @@ void ChatHeads::SystemMetricsUI()
 	if (ImGui::CollapsingHeader("Process Metrics", 0, true, true))
 	{
 
-		ImGui::Text("Physical memory used  : %lu MB", PhysicalMemoryUsedByProcess() >> 20);
-		ImGui::Text("Virtual memory total  : %lu MB ", VirtualMemoryUsedByProcess() >> 20);
+		ImGui::Text("Physical memory used  : %llu MB", mMetrics.PhysicalMemoryUsedByProcess() >> 20);
+		ImGui::Text("Virtual memory total  : %llu MB ", mMetrics.VirtualMemoryUsedByProcess() >> 20);
 
 		static ImVector<float> cpuUsedProc; if (cpuUsedProc.empty()) { cpuUsedProc.resize(90); memset(cpuUsedProc.Data, 0, cpuUsedProc.Size*sizeof(float)); }
 		static int cuId = 0;
 		static float totalCPUPercUsage = 0;
 		float avgCPUPercUsage = 0;
 		
-		cpuUsedProc[cuId] = (float)CPUUsedByProcess();
+		cpuUsedProc[cuId] = (float)mMetrics.CPUUsedByProcess();
 		totalCPUPercUsage += cpuUsedProc[cuId];
 		cuId = (cuId + 1) % cpuUsedProc.Size;
 
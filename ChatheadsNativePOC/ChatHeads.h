@@ -14,14 +14,21 @@
 #include "CPUTBufferDX11.h"
 #include "CPUTSprite.h"
 #include "CPUTScene.h"
+#include "CPUTShadowCache.h"
 #include "CPUTParser.h"
 
 #include "RealsenseMgr.h"
+#include "ReplayFrameSource.h"
+#include "FrameRecorder.h"
 #undef _WINSOCKAPI_ // prevent redef in winsock2.h included in NetworkLayer.h
 #include "NetworkLayer.h"
 #include "TheoraPlayer.h"
 #include "EncodeTransform.h"
 #include "DecodeTransform.h"
+#include "ChatheadRenderer.h"
+#include "ChatheadRenderDeviceDX11.h"
+#include "SystemMetrics.h"
+#include "MetricsRecorder.h"
 
 // UI options to play with the sample
 struct ChatHeadsOptions
@@ -54,11 +61,18 @@ public:
 	float			chatHeadPos[2]; // wrt 100 units & (0,0) being top left
 	int 			nwSendInterval = 30; // ms
 	bool			bVsync = true; // interval = 1 for swapchain->present
+	bool			bInstancedChatheads = false; // one instanced draw for all chatheads instead of a sprite each; not yet checked on DX11
+	bool			bMovieShaderYUV = true; // convert movie frames from YUV in the pixel shader instead of on the CPU
+	bool			bSceneLod = true; // draw far away scene models with their _lodN.mdl meshes
+	bool			bCacheStaticShadows = true; // draw static shadow casters once, only dynamic ones every frame
+	std::string		replayFile; // -replay <file.chf>: local chathead from a recording instead of the camera
+	double			replayFps = -1.0; // -replayfps <n>: < 0 is the recorded rate, 0 as fast as frames are taken
+	std::string		recordFile; // -record <file.chf>: record the local chathead
 };
 
 
 //-----------------------------------------------------------------------------
-class ChatHeads : public CPUT_DX11
+class ChatHeads : public CPUT_DX11, public CPUTShadowCacheTargets
 {
 	// Remote player shared state between sample and network classes
 	struct RemoteChathead
@@ -69,6 +83,8 @@ class ChatHeads : public CPUT_DX11
 		int					newWidth;
 		int					newHeight;
 		volatile LONG		userLock;
+		uint64_t			flowId;			// trace flow of the frame in imgBuffer
+		uint32_t			framesReceived;
 	};
 
 private:
@@ -76,16 +92,24 @@ private:
 	double								mFrameRate = 0;
     CPUTCameraController				*mpCameraController = nullptr;
 	CPUTScene							*mpScene = nullptr;
+	CPUTLoadRequest						*mpSceneLoadRequest = nullptr; // scene load in flight
     CommandParser						mParsedCommandLine;
 	CPUTRenderTargetDepth				*mpShadowRenderTarget = nullptr;
+	CPUTRenderTargetDepth				*mpStaticShadowRenderTarget = nullptr; // static casters only, copied into mpShadowRenderTarget
+	CPUTShadowCache						mShadowCache;
 	bool								mDisplayGUI = true;
 
 	/*********************************  Realsense stuff  *******************************/
 	RealsenseMgr						mRSMgr;
+	ReplayFrameSource					mReplaySource;
+	FrameSource							*mpFrameSource = &mRSMgr; // whichever of the two feeds the local chathead
+	FrameRecorder						mFrameRecorder;
 	std::vector<CPUTSprite*>			mChatheadSprites;
 	std::vector<CPUTRenderTargetColor*> mChatheadTextures;
 	std::vector<RemoteChathead>			mRemoteChatheads;
 	bool								mbChatheadResourcesCreated = false;
+	ChatheadRenderDeviceDX11			*mpChatheadDevice = nullptr;
+	ChatheadRenderer					mChatheadRenderer;
 
 	/*********************************  Networking stuff  *******************************/
 	NetworkLayer						mNetLayer;
@@ -101,11 +125,18 @@ private:
 	CPUTSprite							*mpMovieSprite = nullptr;
 	CPUTRenderTargetColor				*mpMovieRenderTarget = nullptr;
 	CPUTMaterial						*mpMovieTexMaterial = nullptr;
+	CPUTMaterial						*mpMovieYUVMaterial = nullptr;
 	ULONGLONG							mMovieTickCount = 0;
 	bool								mbPlayMovie = false;
+	bool								mbMovieShaderYUV = false; // what mpMovieRenderTarget was created for
 
 	/*********************************  GUI stuff  ****************************************/
 	ChatHeadsOptions					mOptions;
+	std::string						mFontAtlasCacheFile; // ImFontAtlas::CacheFilename points at this
+
+	/*********************************  Metrics stuff  ************************************/
+	SystemMetrics						mMetrics; // for the UI; the recorder has its own
+	MetricsRecorder						mMetricsRecorder;
 
 public:
 	static void NetMsgCallback(NetworkMsg eMsg, void *pThis, void *pMsg);
@@ -114,9 +145,11 @@ public:
     void CreateBasicCPUTResources();
 	void ReleaseBasicCPUTResources();
     void LoadScene(std::string filename);
+	void OnSceneLoaded();
 
 	virtual CPUTEventHandledCode HandleKeyboardEvent(CPUTKey key, CPUTKeyState state) override;
 	virtual CPUTEventHandledCode HandleMouseEvent(int x, int y, int wheel, CPUTMouseState state, CPUTEventID message) override;    
+	void SetCommandLine(int argc, char **argv);
 	virtual void Create() override;
 	virtual void Render(double deltaSeconds) override;
 	virtual void Update(double deltaSeconds) override;
@@ -132,9 +165,12 @@ private:
 	void CreateChatheadSprites();
 	void RecreateChatheadSprites();
 	void DrawChatheadSprites(CPUTRenderParameters& rp);
+	void UploadChatheadFrame(int index, byte *pSrc, int width, int height, CPUTRenderParameters& renderParams);
 	void CreateDefaultChatheadResources();	
 	void RecreateRemoteResourcesIfNeedBe();
 	void RenderChatheads(CPUTRenderParameters& renderParams);
+	void DrawShadowCasters(CPUTRenderParameters& renderParams, bool bStaticMap, bool bClear);
+	void CopyStaticShadowMap();
 
 	/*********************************  Networking stuff  *******************************/
 	void UpdateRemoteChatheadBuffer(NetMsgVideoUpdate *pMsg);
@@ -0,0 +1,247 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ChatheadRenderDeviceDX11.h"
+#include <d3dcompiler.h>
+#include <stddef.h> // offsetof
+#include <string.h>
+
+#ifndef SAFE_RELEASE
+#define SAFE_RELEASE(p) { if (p) { (p)->Release(); (p) = nullptr; } }
+#endif
+
+// Same placement and sampling as chathead.fx with CPUTSprite's quad, plus the texture array slice and alpha cutoff per instance
+static const char *cChatheadShader =
+	"struct VS_INPUT\n"
+	"{\n"
+	"    float4 rect      : RECT;      // left, top, width, height; y going down\n"
+	"    float4 params    : PARAMS;    // uv scale, slice, alpha threshold\n"
+	"    uint   vertexId  : SV_VertexID;\n"
+	"};\n"
+	"struct PS_INPUT\n"
+	"{\n"
+	"    float4 pos       : SV_POSITION;\n"
+	"    float3 uv        : TEXCOORD0;\n"
+	"    float  threshold : TEXCOORD1;\n"
+	"};\n"
+	"Texture2DArray FRAMES   : register(t0);\n"
+	"SamplerState   SAMPLER0 : register(s0);\n"
+	"PS_INPUT VSMain(VS_INPUT input)\n"
+	"{\n"
+	"    float2 corner = float2(input.vertexId & 1, input.vertexId >> 1); // triangle strip: TL, TR, BL, BR\n"
+	"    PS_INPUT output;\n"
+	"    output.pos = float4(input.rect.x + corner.x * input.rect.z, -(input.rect.y + corner.y * input.rect.w), 1.0f, 1.0f);\n"
+	"    output.uv = float3(corner * input.params.xy, input.params.z);\n"
+	"    output.threshold = input.params.w;\n"
+	"    return output;\n"
+	"}\n"
+	"float4 PSMain(PS_INPUT input) : SV_Target\n"
+	"{\n"
+	"    float4 pix = FRAMES.Sample(SAMPLER0, input.uv);\n"
+	"    clip(pix.a - input.threshold);\n"
+	"    return pix;\n"
+	"}\n";
+
+
+bool ChatheadRenderDeviceDX11::CreateFrameArray(int width, int height, int slices)
+{
+	SAFE_RELEASE(mpFrameArraySRV);
+	SAFE_RELEASE(mpFrameArray);
+	mFrameArraySlices = 0;
+
+	D3D11_TEXTURE2D_DESC desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.Width = width;
+	desc.Height = height;
+	desc.MipLevels = 1;
+	desc.ArraySize = slices;
+	desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB; // same as the per-player chathead textures: RSSDK's RGB32 is BGRA in memory
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	// Start out fully transparent, so chatheads that never got a frame don't show up
+	std::vector<unsigned int> zeros((size_t)width * height, 0);
+	std::vector<D3D11_SUBRESOURCE_DATA> initData(slices);
+	for (int ii = 0; ii < slices; ii++)
+	{
+		initData[ii].pSysMem = &zeros[0];
+		initData[ii].SysMemPitch = width * 4;
+		initData[ii].SysMemSlicePitch = 0;
+	}
+
+	if (FAILED(mpDevice->CreateTexture2D(&desc, &initData[0], &mpFrameArray)))
+		return false;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	memset(&srvDesc, 0, sizeof(srvDesc));
+	srvDesc.Format = desc.Format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MipLevels = 1;
+	srvDesc.Texture2DArray.ArraySize = slices;
+	if (FAILED(mpDevice->CreateShaderResourceView(mpFrameArray, &srvDesc, &mpFrameArraySRV)))
+	{
+		SAFE_RELEASE(mpFrameArray);
+		return false;
+	}
+
+	mFrameArraySlices = slices;
+	return true;
+}
+
+
+bool ChatheadRenderDeviceDX11::CreateInstanceBuffer(int maxInstances)
+{
+	SAFE_RELEASE(mpInstanceBuffer);
+
+	D3D11_BUFFER_DESC desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.ByteWidth = maxInstances * sizeof(ChatheadInstance);
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	if (FAILED(mpDevice->CreateBuffer(&desc, NULL, &mpInstanceBuffer)))
+		return false;
+
+	return mpVertexShader || CreateShadersAndStates();
+}
+
+
+void ChatheadRenderDeviceDX11::UpdateFrame(int slice, const unsigned char *pPixels, int width, int height, int rowPitch)
+{
+	if (!mpFrameArray || slice >= mFrameArraySlices)
+		return;
+
+	// Only the part of the slice the frame covers; the instance's uv scale keeps sampling inside it
+	D3D11_BOX box = { 0, 0, 0, (UINT)width, (UINT)height, 1 };
+	mpContext->UpdateSubresource(mpFrameArray, D3D11CalcSubresource(0, slice, 1), &box, pPixels, rowPitch, 0);
+}
+
+
+void ChatheadRenderDeviceDX11::UpdateInstances(const ChatheadInstance *pInstances, int count)
+{
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(mpContext->Map(mpInstanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+
+	memcpy(mapped.pData, pInstances, count * sizeof(ChatheadInstance));
+	mpContext->Unmap(mpInstanceBuffer, 0);
+}
+
+
+void ChatheadRenderDeviceDX11::DrawInstances(int count)
+{
+	if (!mpFrameArraySRV || !mpInstanceBuffer || !mpVertexShader)
+		return;
+
+	const UINT stride = sizeof(ChatheadInstance);
+	const UINT offset = 0;
+	const float blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	// CPUT materials set all of their states when applied, so nothing needs restoring afterwards
+	mpContext->IASetInputLayout(mpInputLayout);
+	mpContext->IASetVertexBuffers(0, 1, &mpInstanceBuffer, &stride, &offset);
+	mpContext->IASetIndexBuffer(NULL, DXGI_FORMAT_UNKNOWN, 0);
+	mpContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	mpContext->VSSetShader(mpVertexShader, NULL, 0);
+	mpContext->HSSetShader(NULL, NULL, 0);
+	mpContext->DSSetShader(NULL, NULL, 0);
+	mpContext->GSSetShader(NULL, NULL, 0);
+	mpContext->PSSetShader(mpPixelShader, NULL, 0);
+	mpContext->PSSetShaderResources(0, 1, &mpFrameArraySRV);
+	mpContext->PSSetSamplers(0, 1, &mpSampler);
+	mpContext->OMSetBlendState(mpBlendState, blendFactor, 0xffffffff);
+	mpContext->OMSetDepthStencilState(mpDepthStencilState, 0);
+	mpContext->RSSetState(mpRasterizerState);
+
+	mpContext->DrawInstanced(4, count, 0, 0);
+}
+
+
+void ChatheadRenderDeviceDX11::Release()
+{
+	SAFE_RELEASE(mpFrameArraySRV);
+	SAFE_RELEASE(mpFrameArray);
+	SAFE_RELEASE(mpInstanceBuffer);
+	SAFE_RELEASE(mpVertexShader);
+	SAFE_RELEASE(mpPixelShader);
+	SAFE_RELEASE(mpInputLayout);
+	SAFE_RELEASE(mpBlendState);
+	SAFE_RELEASE(mpRasterizerState);
+	SAFE_RELEASE(mpDepthStencilState);
+	SAFE_RELEASE(mpSampler);
+	mFrameArraySlices = 0;
+}
+
+
+bool ChatheadRenderDeviceDX11::CreateShadersAndStates()
+{
+	ID3DBlob *pVSBlob = nullptr, *pPSBlob = nullptr;
+	D3DCompile(cChatheadShader, strlen(cChatheadShader), NULL, NULL, NULL, "VSMain", "vs_4_0", 0, 0, &pVSBlob, NULL);
+	D3DCompile(cChatheadShader, strlen(cChatheadShader), NULL, NULL, NULL, "PSMain", "ps_4_0", 0, 0, &pPSBlob, NULL);
+
+	bool bSuccess = pVSBlob && pPSBlob &&
+		SUCCEEDED(mpDevice->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), NULL, &mpVertexShader)) &&
+		SUCCEEDED(mpDevice->CreatePixelShader(pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize(), NULL, &mpPixelShader));
+
+	if (bSuccess)
+	{
+		const D3D11_INPUT_ELEMENT_DESC layout[] =
+		{
+			{ "RECT",   0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(ChatheadInstance, rect),    D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "PARAMS", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(ChatheadInstance, uvScale), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		};
+		bSuccess = SUCCEEDED(mpDevice->CreateInputLayout(layout, 2, pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), &mpInputLayout));
+	}
+	SAFE_RELEASE(pVSBlob);
+	SAFE_RELEASE(pPSBlob);
+
+	// Same states as chathead.rs
+	if (bSuccess)
+	{
+		D3D11_BLEND_DESC desc;
+		memset(&desc, 0, sizeof(desc));
+		desc.RenderTarget[0].BlendEnable = TRUE;
+		desc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+		desc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+		desc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+		desc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+		desc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+		desc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+		desc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+		bSuccess = SUCCEEDED(mpDevice->CreateBlendState(&desc, &mpBlendState));
+	}
+	if (bSuccess)
+	{
+		D3D11_RASTERIZER_DESC desc;
+		memset(&desc, 0, sizeof(desc));
+		desc.FillMode = D3D11_FILL_SOLID;
+		desc.CullMode = D3D11_CULL_NONE;
+		desc.DepthClipEnable = TRUE;
+		bSuccess = SUCCEEDED(mpDevice->CreateRasterizerState(&desc, &mpRasterizerState));
+	}
+	if (bSuccess)
+	{
+		D3D11_DEPTH_STENCIL_DESC desc;
+		memset(&desc, 0, sizeof(desc));
+		desc.DepthEnable = FALSE;
+		desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+		desc.DepthFunc = D3D11_COMPARISON_GREATER_EQUAL;
+		bSuccess = SUCCEEDED(mpDevice->CreateDepthStencilState(&desc, &mpDepthStencilState));
+	}
+	if (bSuccess)
+	{
+		D3D11_SAMPLER_DESC desc;
+		memset(&desc, 0, sizeof(desc));
+		desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+		desc.AddressU = desc.AddressV = desc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+		desc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+		desc.MaxLOD = D3D11_FLOAT32_MAX;
+		bSuccess = SUCCEEDED(mpDevice->CreateSamplerState(&desc, &mpSampler));
+	}
+
+	return bSuccess;
+}
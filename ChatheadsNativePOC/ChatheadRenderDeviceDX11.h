@@ -0,0 +1,49 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __CHATHEAD_RENDER_DEVICE_DX11_H__
+#define __CHATHEAD_RENDER_DEVICE_DX11_H__
+
+#include <d3d11.h>
+#include "ChatheadRenderer.h"
+
+// DX11 side of ChatheadRenderer. Frames go to a DEFAULT usage BGRA sRGB texture array with UpdateSubresource
+// (dynamic textures can't be arrays), instances to a dynamic per-instance vertex buffer. The quad corners are
+// generated from SV_VertexID, so there is no vertex or index buffer.
+class ChatheadRenderDeviceDX11 : public ChatheadRenderDevice
+{
+public:
+	ChatheadRenderDeviceDX11(ID3D11Device *pDevice, ID3D11DeviceContext *pContext) : mpDevice(pDevice), mpContext(pContext) {}
+	virtual ~ChatheadRenderDeviceDX11() { Release(); }
+
+	virtual bool CreateFrameArray(int width, int height, int slices) override;
+	virtual bool CreateInstanceBuffer(int maxInstances) override;
+	virtual void UpdateFrame(int slice, const unsigned char *pPixels, int width, int height, int rowPitch) override;
+	virtual void UpdateInstances(const ChatheadInstance *pInstances, int count) override;
+	virtual void DrawInstances(int count) override;
+	virtual void Release() override;
+
+private:
+	bool CreateShadersAndStates();
+
+	ID3D11Device				*mpDevice;
+	ID3D11DeviceContext			*mpContext;
+
+	ID3D11Texture2D				*mpFrameArray = nullptr;
+	ID3D11ShaderResourceView	*mpFrameArraySRV = nullptr;
+	int							mFrameArraySlices = 0;
+	ID3D11Buffer				*mpInstanceBuffer = nullptr;
+
+	ID3D11VertexShader			*mpVertexShader = nullptr;
+	ID3D11PixelShader			*mpPixelShader = nullptr;
+	ID3D11InputLayout			*mpInputLayout = nullptr;
+	ID3D11BlendState			*mpBlendState = nullptr;
+	ID3D11RasterizerState		*mpRasterizerState = nullptr;
+	ID3D11DepthStencilState		*mpDepthStencilState = nullptr;
+	ID3D11SamplerState			*mpSampler = nullptr;
+};
+
+#endif // __CHATHEAD_RENDER_DEVICE_DX11_H__
@@ -0,0 +1,129 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ChatheadRenderer.h"
+
+bool ChatheadRenderer::Init(ChatheadRenderDevice *pDevice, int maxChatheads, int frameWidth, int frameHeight)
+{
+	Release();
+
+	if (!pDevice->CreateFrameArray(frameWidth, frameHeight, maxChatheads) || !pDevice->CreateInstanceBuffer(maxChatheads))
+	{
+		pDevice->Release();
+		return false;
+	}
+
+	mpDevice = pDevice;
+	mSliceWidth = frameWidth;
+	mSliceHeight = frameHeight;
+
+	mInstances.resize(maxChatheads);
+	mFrameSizes.resize(maxChatheads);
+	for (int ii = 0; ii < maxChatheads; ii++)
+	{
+		ChatheadInstance& inst = mInstances[ii];
+		inst.rect[0] = inst.rect[1] = inst.rect[2] = inst.rect[3] = 0.0f;
+		inst.slice = (float)ii;
+		inst.alphaThreshold = 0.0f;
+
+		mFrameSizes[ii].width = frameWidth;
+		mFrameSizes[ii].height = frameHeight;
+		UpdateUVScale(ii);
+	}
+	mbInstancesDirty = true;
+
+	return true;
+}
+
+
+void ChatheadRenderer::Release()
+{
+	if (mpDevice)
+		mpDevice->Release();
+
+	mpDevice = nullptr;
+	mInstances.clear();
+	mFrameSizes.clear();
+	mSliceWidth = mSliceHeight = 0;
+	mbInstancesDirty = false;
+}
+
+
+void ChatheadRenderer::SetRect(int index, float x, float y, float width, float height)
+{
+	float *rect = mInstances[index].rect;
+	if (rect[0] != x || rect[1] != y || rect[2] != width || rect[3] != height)
+	{
+		rect[0] = x;
+		rect[1] = y;
+		rect[2] = width;
+		rect[3] = height;
+		mbInstancesDirty = true;
+	}
+}
+
+
+void ChatheadRenderer::SetAlphaThreshold(int index, float threshold)
+{
+	if (mInstances[index].alphaThreshold != threshold)
+	{
+		mInstances[index].alphaThreshold = threshold;
+		mbInstancesDirty = true;
+	}
+}
+
+
+bool ChatheadRenderer::UpdateFrame(int index, const unsigned char *pPixels, int width, int height, int rowPitch)
+{
+	// A frame bigger than the slices: grow the array to fit it. That drops every slice's contents, the other
+	// chatheads come back with their next frame.
+	if (width > mSliceWidth || height > mSliceHeight)
+	{
+		const int sliceWidth = (width > mSliceWidth) ? width : mSliceWidth;
+		const int sliceHeight = (height > mSliceHeight) ? height : mSliceHeight;
+		if (!mpDevice->CreateFrameArray(sliceWidth, sliceHeight, (int)mInstances.size()))
+			return false;
+
+		mSliceWidth = sliceWidth;
+		mSliceHeight = sliceHeight;
+		for (int ii = 0; ii < (int)mInstances.size(); ii++)
+			UpdateUVScale(ii);
+	}
+
+	if (mFrameSizes[index].width != width || mFrameSizes[index].height != height)
+	{
+		mFrameSizes[index].width = width;
+		mFrameSizes[index].height = height;
+		UpdateUVScale(index);
+	}
+
+	mpDevice->UpdateFrame(index, pPixels, width, height, rowPitch);
+	return true;
+}
+
+
+void ChatheadRenderer::Draw()
+{
+	if (mInstances.empty())
+		return;
+
+	if (mbInstancesDirty)
+	{
+		mpDevice->UpdateInstances(&mInstances[0], (int)mInstances.size());
+		mbInstancesDirty = false;
+	}
+
+	mpDevice->DrawInstances((int)mInstances.size());
+}
+
+
+void ChatheadRenderer::UpdateUVScale(int index)
+{
+	ChatheadInstance& inst = mInstances[index];
+	inst.uvScale[0] = (float)mFrameSizes[index].width / mSliceWidth;
+	inst.uvScale[1] = (float)mFrameSizes[index].height / mSliceHeight;
+	mbInstancesDirty = true;
+}
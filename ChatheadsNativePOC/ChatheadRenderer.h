@@ -0,0 +1,79 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __CHATHEAD_RENDERER_H__
+#define __CHATHEAD_RENDERER_H__
+
+#include <vector>
+
+// Per-chathead data for the instanced draw. Matches the per-instance input layout in ChatheadRenderDeviceDX11.
+struct ChatheadInstance
+{
+	float	rect[4];			// left, top, width, height in viewport units, y going down (same as CPUTSprite::Create)
+	float	uvScale[2];			// frame size / slice size. Frames smaller than the array only fill the top-left of their slice
+	float	slice;				// texture array slice holding this chathead's frame
+	float	alphaThreshold;		// [0,1], pixels with a lower alpha are discarded
+};
+
+// What the renderer needs from the GPU. ChatheadRenderDeviceDX11 is the real one; a device that does nothing
+// lets the CPU side (frame and instance bookkeeping, submission) be timed on its own.
+class ChatheadRenderDevice
+{
+public:
+	virtual ~ChatheadRenderDevice() {}
+
+	// (Re)create the frame texture array. Old contents don't need to be kept.
+	virtual bool CreateFrameArray(int width, int height, int slices) = 0;
+	virtual bool CreateInstanceBuffer(int maxInstances) = 0;
+	virtual void UpdateFrame(int slice, const unsigned char *pPixels, int width, int height, int rowPitch) = 0;
+	virtual void UpdateInstances(const ChatheadInstance *pInstances, int count) = 0;
+	virtual void DrawInstances(int count) = 0;
+	virtual void Release() = 0;
+};
+
+// Draws all the chatheads with a single instanced call: every participant's video frame is a slice of one
+// BGRA texture array, and their placement, UV scale and alpha cutoff come from one instance buffer.
+// The instance buffer is only re-uploaded when a rect, threshold or frame size changed.
+class ChatheadRenderer
+{
+public:
+	ChatheadRenderer() {}
+	~ChatheadRenderer() { Release(); }
+
+	// pDevice isn't owned. Slices start at frameWidth x frameHeight and grow when a bigger frame comes in.
+	bool Init(ChatheadRenderDevice *pDevice, int maxChatheads, int frameWidth, int frameHeight);
+	void Release();
+	bool IsInitialized() const { return mpDevice != nullptr; }
+
+	void SetRect(int index, float x, float y, float width, float height);
+	void SetAlphaThreshold(int index, float threshold);
+
+	// BGRA pixels, rowPitch in bytes
+	bool UpdateFrame(int index, const unsigned char *pPixels, int width, int height, int rowPitch);
+
+	void Draw();
+
+	int GetChatheadCount() const { return (int)mInstances.size(); }
+	const ChatheadInstance& GetInstance(int index) const { return mInstances[index]; }
+
+private:
+	void UpdateUVScale(int index);
+
+	struct FrameSize
+	{
+		int		width;
+		int		height;
+	};
+
+	ChatheadRenderDevice			*mpDevice = nullptr;
+	std::vector<ChatheadInstance>	mInstances;
+	std::vector<FrameSize>			mFrameSizes;	// size of the frame last written to each slice
+	int								mSliceWidth = 0;
+	int								mSliceHeight = 0;
+	bool							mbInstancesDirty = false;
+};
+
+#endif // __CHATHEAD_RENDERER_H__
@@ -0,0 +1,222 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FrameFile.h"
+#include <string.h>
+
+// Repeats shorter than this stay in the literal run around them
+static const uint32_t cMinRepeatRun = 3;
+
+static void AppendBytes(std::vector<uint8_t> &out, const void *pData, size_t size)
+{
+	const uint8_t *pBytes = (const uint8_t*)pData;
+	out.insert(out.end(), pBytes, pBytes + size);
+}
+
+static void AppendLiterals(std::vector<uint8_t> &out, const uint32_t *pPixels, uint32_t first, uint32_t end)
+{
+	if (end == first)
+		return;
+	const uint32_t count = end - first;
+	AppendBytes(out, &count, sizeof(count));
+	AppendBytes(out, pPixels + first, count * sizeof(uint32_t));
+}
+
+static void EncodeRuns(const uint32_t *pPixels, uint32_t pixelCount, std::vector<uint8_t> &out)
+{
+	out.clear();
+	uint32_t literalStart = 0;
+	uint32_t i = 0;
+	while (i < pixelCount)
+	{
+		uint32_t run = 1;
+		while (i + run < pixelCount && pPixels[i + run] == pPixels[i])
+			run++;
+
+		if (run >= cMinRepeatRun)
+		{
+			AppendLiterals(out, pPixels, literalStart, i);
+			const uint32_t control = run | cFrameRunRepeat;
+			AppendBytes(out, &control, sizeof(control));
+			AppendBytes(out, pPixels + i, sizeof(uint32_t));
+			literalStart = i + run;
+		}
+		i += run;
+	}
+	AppendLiterals(out, pPixels, literalStart, pixelCount);
+}
+
+static bool DecodeRuns(const uint8_t *pData, size_t size, uint32_t *pPixels, uint32_t pixelCount)
+{
+	size_t pos = 0;
+	uint32_t written = 0;
+	while (pos < size)
+	{
+		uint32_t control;
+		if (size - pos < sizeof(control))
+			return false;
+		memcpy(&control, pData + pos, sizeof(control));
+		pos += sizeof(control);
+
+		const uint32_t count = control & ~cFrameRunRepeat;
+		if (count > pixelCount - written)
+			return false;
+
+		if (control & cFrameRunRepeat)
+		{
+			uint32_t pixel;
+			if (size - pos < sizeof(pixel))
+				return false;
+			memcpy(&pixel, pData + pos, sizeof(pixel));
+			pos += sizeof(pixel);
+			for (uint32_t i = 0; i < count; i++)
+				pPixels[written + i] = pixel;
+		}
+		else
+		{
+			if ((size - pos) / sizeof(uint32_t) < count)
+				return false;
+			memcpy(pPixels + written, pData + pos, count * sizeof(uint32_t));
+			pos += count * sizeof(uint32_t);
+		}
+		written += count;
+	}
+	return written == pixelCount;
+}
+
+
+bool FrameFileWriter::Open(const char *pFileName, int width, int height, double framesPerSecond, bool bCompress)
+{
+	Close();
+	if (width <= 0 || height <= 0)
+		return false;
+
+	mpFile = fopen(pFileName, "wb");
+	if (!mpFile)
+		return false;
+
+	memset(&mHeader, 0, sizeof(mHeader));
+	memcpy(mHeader.magic, "CHF1", 4);
+	mHeader.version = cFrameFileVersion;
+	mHeader.width = (uint32_t)width;
+	mHeader.height = (uint32_t)height;
+	mHeader.framesPerSecond = framesPerSecond;
+	mIndex.clear();
+	mbCompress = bCompress;
+	mbFailed = false;
+
+	// Rewritten with the frame count and index offset by Close
+	mbFailed = fwrite(&mHeader, sizeof(mHeader), 1, mpFile) != 1;
+	mOffset = sizeof(mHeader);
+	return !mbFailed;
+}
+
+bool FrameFileWriter::AddFrame(const uint8_t *pFrame)
+{
+	if (!mpFile || mbFailed)
+		return false;
+
+	const uint32_t pixelCount = mHeader.width * mHeader.height;
+	const size_t rawBytes = pixelCount * sizeof(uint32_t);
+
+	FrameFileIndexEntry entry;
+	entry.offset = mOffset;
+	entry.sizeBytes = (uint32_t)rawBytes;
+	entry.flags = 0;
+	const void *pData = pFrame;
+
+	if (mbCompress)
+	{
+		EncodeRuns(reinterpret_cast<const uint32_t*>(pFrame), pixelCount, mCoded);
+		if (mCoded.size() < rawBytes)
+		{
+			entry.sizeBytes = (uint32_t)mCoded.size();
+			entry.flags = cFrameCoded;
+			pData = mCoded.data();
+		}
+	}
+
+	if (fwrite(pData, 1, entry.sizeBytes, mpFile) != entry.sizeBytes)
+	{
+		mbFailed = true;
+		return false;
+	}
+	mOffset += entry.sizeBytes;
+	mIndex.push_back(entry);
+	return true;
+}
+
+bool FrameFileWriter::Close()
+{
+	if (!mpFile)
+		return false;
+
+	bool ok = !mbFailed;
+	mHeader.frameCount = (uint32_t)mIndex.size();
+	mHeader.indexOffset = mOffset;
+	if (ok && !mIndex.empty())
+		ok = fwrite(mIndex.data(), sizeof(FrameFileIndexEntry), mIndex.size(), mpFile) == mIndex.size();
+	ok = ok && fseek(mpFile, 0, SEEK_SET) == 0 && fwrite(&mHeader, sizeof(mHeader), 1, mpFile) == 1;
+	ok = (fclose(mpFile) == 0) && ok;
+
+	mpFile = nullptr;
+	mIndex.clear();
+	return ok;
+}
+
+
+bool FrameFileReader::Open(const std::string &fileName)
+{
+	Close();
+	if (CPUTFAILED(mView.Open(fileName, false)))
+		return false;
+
+	const uint64_t size = mView.GetSize();
+	if (size < sizeof(mHeader))
+	{
+		Close();
+		return false;
+	}
+	memcpy(&mHeader, mView.GetData(), sizeof(mHeader));
+
+	const uint64_t indexBytes = (uint64_t)mHeader.frameCount * sizeof(FrameFileIndexEntry);
+	if (memcmp(mHeader.magic, "CHF1", 4) != 0 || mHeader.version != cFrameFileVersion ||
+		mHeader.width == 0 || mHeader.height == 0 || mHeader.width > 16384 || mHeader.height > 16384 ||
+		mHeader.indexOffset > size || indexBytes > size - mHeader.indexOffset)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void FrameFileReader::Close()
+{
+	mView.Close();
+	memset(&mHeader, 0, sizeof(mHeader));
+}
+
+bool FrameFileReader::ReadFrame(uint32_t index, uint8_t *pDst) const
+{
+	if (index >= mHeader.frameCount)
+		return false;
+
+	// The index follows frames of any size, so it isn't necessarily aligned
+	FrameFileIndexEntry entry;
+	memcpy(&entry, mView.GetData() + mHeader.indexOffset + index * sizeof(entry), sizeof(entry));
+	if (entry.offset > mHeader.indexOffset || entry.sizeBytes > mHeader.indexOffset - entry.offset)
+		return false;
+
+	const uint8_t *pData = reinterpret_cast<const uint8_t*>(mView.GetData()) + entry.offset;
+	const uint32_t pixelCount = mHeader.width * mHeader.height;
+	if (entry.flags & cFrameCoded)
+		return DecodeRuns(pData, entry.sizeBytes, reinterpret_cast<uint32_t*>(pDst), pixelCount);
+
+	if (entry.sizeBytes != pixelCount * sizeof(uint32_t))
+		return false;
+	memcpy(pDst, pData, entry.sizeBytes);
+	return true;
+}
@@ -0,0 +1,102 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __FRAME_FILE_H__
+#define __FRAME_FILE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "CPUTOSServices.h" // CPUTFileSystem::CPUTFileView
+
+// A .chf file is a recorded chathead: the BGRA frames of one participant the way a FrameSource
+// delivers them. FrameRecorder (ChatHeads -record:<file>) and Extras/ChatheadBench write them,
+// ReplayFrameSource plays them back.
+//
+//   FrameFileHeader
+//   the frames, one after the other, each raw or run-length coded
+//   FrameFileIndexEntry for every frame, at indexOffset
+//
+// The index is at the end so frames can be written as they come. Run-length coding works on
+// whole pixels: a frame is a list of runs, each a uint32_t count with cFrameRunRepeat set for
+// that many copies of the one pixel that follows, or clear for that many pixels following as
+// they are. A background cleared to one value shrinks to a few bytes; frames that don't get
+// smaller are stored raw. Everything is little-endian.
+
+struct FrameFileHeader
+{
+	char		magic[4];			// "CHF1"
+	uint32_t	version;
+	uint32_t	width;
+	uint32_t	height;
+	uint32_t	frameCount;
+	uint32_t	reserved;
+	double		framesPerSecond;	// the rate it was recorded at
+	uint64_t	indexOffset;
+};
+
+struct FrameFileIndexEntry
+{
+	uint64_t	offset;
+	uint32_t	sizeBytes;
+	uint32_t	flags;				// cFrameCoded when run-length coded
+};
+
+static const uint32_t cFrameFileVersion	= 1;
+static const uint32_t cFrameCoded		= 0x1;
+static const uint32_t cFrameRunRepeat	= 0x80000000;
+
+
+class FrameFileWriter
+{
+public:
+	FrameFileWriter() {}
+	~FrameFileWriter() { Close(); }
+
+	bool Open(const char *pFileName, int width, int height, double framesPerSecond, bool bCompress);
+	bool AddFrame(const uint8_t *pFrame);	// width * height BGRA pixels
+	bool Close();							// writes the index and header; false if any write failed
+
+	bool IsOpen() const { return mpFile != nullptr; }
+	uint32_t FrameCount() const { return (uint32_t)mIndex.size(); }
+	uint64_t BytesWritten() const { return mOffset; }
+
+private:
+	FrameFileWriter(const FrameFileWriter&);
+	FrameFileWriter& operator=(const FrameFileWriter&);
+
+	FILE								*mpFile = nullptr;
+	FrameFileHeader						mHeader;
+	std::vector<FrameFileIndexEntry>	mIndex;
+	std::vector<uint8_t>				mCoded;		// scratch for the frame being coded
+	uint64_t							mOffset = 0;
+	bool								mbCompress = true;
+	bool								mbFailed = false;
+};
+
+
+// Maps the file, so any number of readers share one copy of it
+class FrameFileReader
+{
+public:
+	bool Open(const std::string &fileName);
+	void Close();
+
+	int Width() const { return (int)mHeader.width; }
+	int Height() const { return (int)mHeader.height; }
+	uint32_t FrameCount() const { return mHeader.frameCount; }
+	double FrameRate() const { return mHeader.framesPerSecond; }
+
+	// Width() * Height() BGRA pixels into pDst; false if the frame is damaged
+	bool ReadFrame(uint32_t index, uint8_t *pDst) const;
+
+private:
+	CPUTFileSystem::CPUTFileView	mView;
+	FrameFileHeader					mHeader = {};
+};
+
+#endif // __FRAME_FILE_H__
@@ -0,0 +1,115 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FrameRecorder.h"
+#include "Trace.h"
+#include "CPUTOSServices.h" // CPUT logging
+#include <string.h>
+
+extern CPUTLog Log;
+
+bool FrameRecorder::Start(const char *pFileName, int width, int height, double framesPerSecond, bool bCompress)
+{
+	Stop();
+
+	if (!mWriter.Open(pFileName, width, height, framesPerSecond, bCompress))
+	{
+		Log.Log(LOG_ERROR, "Couldn't create recording %s\n", pFileName);
+		return false;
+	}
+
+	const size_t frameBytes = (size_t)width * height * sizeof(uint32_t);
+	mBuffers.assign(cQueueFrames, std::vector<uint8_t>(frameBytes));
+	mFreeBuffers.clear();
+	for (int i = 0; i < cQueueFrames; i++)
+		mFreeBuffers.push_back(i);
+	mQueuedBuffers.clear();
+	mFramesWritten = 0;
+	mFramesDropped = 0;
+
+	mbStop = false;
+	mThread = std::thread(&FrameRecorder::ThreadMain, this);
+	mbRecording = true;
+
+	Log.Log(LOG_INFO, "Recording the local chathead to %s\n", pFileName);
+	return true;
+}
+
+void FrameRecorder::Stop()
+{
+	if (!mbRecording)
+		return;
+
+	mbRecording = false;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mbStop = true;
+	}
+	mCondition.notify_one();
+	mThread.join(); // writes what's still queued
+
+	const uint32_t frameCount = mWriter.FrameCount();
+	if (mWriter.Close())
+		Log.Log(LOG_INFO, "Recorded %u frames, %u dropped\n", frameCount, FramesDropped());
+	else
+		Log.Log(LOG_ERROR, "Writing the recording failed\n");
+	mBuffers.clear();
+}
+
+void FrameRecorder::AddFrame(const uint8_t *pFrame)
+{
+	if (!mbRecording)
+		return;
+
+	int buffer;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mFreeBuffers.empty())
+		{
+			mFramesDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		buffer = mFreeBuffers.back();
+		mFreeBuffers.pop_back();
+	}
+
+	{
+		TRACE_SCOPE("CopyRecordedFrame");
+		memcpy(mBuffers[buffer].data(), pFrame, mBuffers[buffer].size());
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQueuedBuffers.push_back(buffer);
+	}
+	mCondition.notify_one();
+}
+
+void FrameRecorder::ThreadMain()
+{
+	TraceSetThreadName("RecorderThread");
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;)
+	{
+		mCondition.wait(lock, [this] { return mbStop || !mQueuedBuffers.empty(); });
+		if (mQueuedBuffers.empty())
+			break;
+
+		const int buffer = mQueuedBuffers.front();
+		mQueuedBuffers.pop_front();
+		lock.unlock();
+
+		{
+			TRACE_SCOPE("WriteRecordedFrame");
+			if (mWriter.AddFrame(mBuffers[buffer].data()))
+				mFramesWritten.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		lock.lock();
+		mFreeBuffers.push_back(buffer);
+	}
+}
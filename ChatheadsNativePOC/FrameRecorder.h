@@ -0,0 +1,60 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __FRAME_RECORDER_H__
+#define __FRAME_RECORDER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "FrameFile.h"
+
+// Records the local chathead into a .chf file (see FrameFile.h) for ReplayFrameSource. The main
+// thread only copies the frame into one of cQueueFrames buffers; coding and writing happen on
+// the recorder's own thread. When that falls behind, new frames are dropped and counted.
+class FrameRecorder
+{
+public:
+	FrameRecorder() : mFramesWritten(0), mFramesDropped(0) {}
+	~FrameRecorder() { Stop(); }
+
+	bool Start(const char *pFileName, int width, int height, double framesPerSecond, bool bCompress = true);
+	void Stop();
+	bool IsRecording() const { return mbRecording; }
+
+	// width * height BGRA pixels, as in RSAppSharedData::segImage
+	void AddFrame(const uint8_t *pFrame);
+
+	uint32_t FramesWritten() const { return mFramesWritten.load(std::memory_order_relaxed); }
+	uint32_t FramesDropped() const { return mFramesDropped.load(std::memory_order_relaxed); }
+
+private:
+	FrameRecorder(const FrameRecorder&);
+	FrameRecorder& operator=(const FrameRecorder&);
+
+	void ThreadMain();
+
+	static const int					cQueueFrames = 8;
+
+	FrameFileWriter						mWriter;
+	std::vector<std::vector<uint8_t>>	mBuffers;
+	std::vector<int>					mFreeBuffers;
+	std::deque<int>						mQueuedBuffers;		// oldest first
+	bool								mbRecording = false;
+
+	std::thread							mThread;
+	std::mutex							mMutex;
+	std::condition_variable				mCondition;
+	bool								mbStop = false;
+
+	std::atomic<uint32_t>				mFramesWritten;
+	std::atomic<uint32_t>				mFramesDropped;
+};
+
+#endif // __FRAME_RECORDER_H__
@@ -0,0 +1,70 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __FRAME_SOURCE_H__
+#define __FRAME_SOURCE_H__
+
+#include <windows.h> // HANDLE, LONG, byte
+
+#define IL_UNLOCK	0
+#define IL_LOCK		1
+
+struct ImageBuffer
+{
+	int		width;
+	int		height;
+	byte	*pBuffer;
+};
+
+// All data shared between the main thread and the thread of the frame source
+struct RSAppSharedData
+{
+	ImageBuffer		segImage;
+	volatile LONG	hLock;
+	volatile bool	bStayAlive;
+	volatile bool	bDoSegmentation;
+	bool			bImageUpdated;
+	uint32_t		frameId;				// counts the frames copied in, for tracing
+	HANDLE			hThread;
+};
+
+
+// FrameSource is where the local player's chathead comes from: the RealSense camera (RealsenseMgr),
+// or a recording played back by ReplayFrameSource so the encode / network / decode path can run
+// without a camera.
+// A source produces BGRA frames (alpha marks the foreground) from a thread of its own:
+// i)   it takes mSharedData.hLock with InterlockedExchange, copies a frame into mSharedData.segImage,
+//      releases the lock and then sets mSharedData.bImageUpdated
+// ii)  the main thread, when it sees bImageUpdated, takes the same lock, reads the frame, clears
+//      bImageUpdated and unlocks
+// segImage is VideoWidth() x VideoHeight() x cBytesPerPixel and only valid between Init and Shutdown.
+class FrameSource
+{
+public:
+	virtual ~FrameSource() {}
+
+	virtual bool Init() = 0;
+	virtual void Shutdown() = 0;
+
+	// Frames per second the source delivers, for recording
+	virtual double FrameRate() const = 0;
+
+	inline void DoSegmentation(bool bDoBGS) { mSharedData.bDoSegmentation = bDoBGS; }
+	inline int VideoWidth() const { return mVideoWidth; }
+	inline int VideoHeight() const { return mVideoHeight; }
+	inline bool InitSuccess() const { return mbInitSuccess; }
+
+public:
+	static const UINT	cBytesPerPixel = 4;
+	RSAppSharedData		mSharedData;
+
+protected:
+	bool				mbInitSuccess = false;
+	int					mVideoWidth = 0;
+	int					mVideoHeight = 0;
+};
+
+#endif // __FRAME_SOURCE_H__
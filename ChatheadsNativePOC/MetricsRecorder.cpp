@@ -0,0 +1,137 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MetricsRecorder.h"
+#include <chrono>
+
+void MetricsRecorder::Timing::Add(double ms)
+{
+	uint64_t us = (uint64_t)(ms * 1000.0);
+	sumUs.fetch_add(us, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+
+	uint64_t prevMax = maxUs.load(std::memory_order_relaxed);
+	while (us > prevMax && !maxUs.compare_exchange_weak(prevMax, us, std::memory_order_relaxed))
+	{
+	}
+}
+
+void MetricsRecorder::Timing::Take(uint32_t *pCount, double *pAvgMs, double *pMaxMs)
+{
+	*pCount = count.exchange(0, std::memory_order_relaxed);
+	uint64_t sum = sumUs.exchange(0, std::memory_order_relaxed);
+	uint64_t max = maxUs.exchange(0, std::memory_order_relaxed);
+	*pAvgMs = *pCount ? (double)sum / *pCount / 1000.0 : 0.0;
+	*pMaxMs = (double)max / 1000.0;
+}
+
+bool MetricsRecorder::Start(const char *pFileName, Format format, int intervalMs)
+{
+	Stop();
+
+	mpFile = fopen(pFileName, "w");
+	if (!mpFile)
+		return false;
+
+	mFormat = format;
+	mIntervalMs = intervalMs > 0 ? intervalMs : 1000;
+	mbStop = false;
+	mMetrics.Init();
+	mStartTime = SystemMetrics::GetTimeSeconds();
+
+	// Don't report what happened before recording started
+	uint32_t count;
+	double avg, max;
+	mFrame.Take(&count, &avg, &max);
+	mEncode.Take(&count, &avg, &max);
+	mDecode.Take(&count, &avg, &max);
+
+	WriteHeader();
+	mThread = std::thread(&MetricsRecorder::ThreadMain, this);
+	return true;
+}
+
+void MetricsRecorder::Stop()
+{
+	if (!mpFile)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mStopMutex);
+		mbStop = true;
+	}
+	mStopCondition.notify_one();
+	mThread.join();
+
+	fclose(mpFile);
+	mpFile = nullptr;
+	mMetrics.Shutdown();
+}
+
+void MetricsRecorder::ThreadMain()
+{
+	std::unique_lock<std::mutex> lock(mStopMutex);
+	std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+	while (!mbStop)
+	{
+		next += std::chrono::milliseconds(mIntervalMs);
+		if (mStopCondition.wait_until(lock, next, [this] { return mbStop; }))
+			break;
+
+		lock.unlock();
+		WriteSample(SystemMetrics::GetTimeSeconds() - mStartTime);
+		lock.lock();
+	}
+}
+
+void MetricsRecorder::WriteHeader()
+{
+	if (mFormat != CSV)
+		return;
+
+	fprintf(mpFile, "time_s,cpu");
+	for (int core = 0; core < mMetrics.NumProcessors(); core++)
+		fprintf(mpFile, ",cpu%d", core);
+	fprintf(mpFile, ",process_cpu,rss_bytes,frames,frame_ms_avg,frame_ms_max,encodes,encode_ms_avg,encode_ms_max,decodes,decode_ms_avg,decode_ms_max\n");
+	fflush(mpFile);
+}
+
+void MetricsRecorder::WriteSample(double time)
+{
+	mMetrics.Sample();
+	const unsigned long long rss = mMetrics.PhysicalMemoryUsedByProcess();
+
+	uint32_t frames, encodes, decodes;
+	double frameAvg, frameMax, encodeAvg, encodeMax, decodeAvg, decodeMax;
+	mFrame.Take(&frames, &frameAvg, &frameMax);
+	mEncode.Take(&encodes, &encodeAvg, &encodeMax);
+	mDecode.Take(&decodes, &decodeAvg, &decodeMax);
+
+	if (mFormat == CSV)
+	{
+		fprintf(mpFile, "%.3f,%.1f", time, mMetrics.CPUUsed());
+		for (int core = 0; core < mMetrics.NumProcessors(); core++)
+			fprintf(mpFile, ",%.1f", mMetrics.CoreCPUUsed(core));
+		fprintf(mpFile, ",%.1f,%llu,%u,%.3f,%.3f,%u,%.3f,%.3f,%u,%.3f,%.3f\n",
+			mMetrics.CPUUsedByProcess(), rss,
+			frames, frameAvg, frameMax, encodes, encodeAvg, encodeMax, decodes, decodeAvg, decodeMax);
+	}
+	else
+	{
+		// Line protocol wants wall clock nanoseconds
+		const long long timestamp = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+
+		fprintf(mpFile, "chatheads cpu=%.1f", mMetrics.CPUUsed());
+		for (int core = 0; core < mMetrics.NumProcessors(); core++)
+			fprintf(mpFile, ",cpu%d=%.1f", core, mMetrics.CoreCPUUsed(core));
+		fprintf(mpFile, ",process_cpu=%.1f,rss_bytes=%llui,frames=%ui,frame_ms_avg=%.3f,frame_ms_max=%.3f,"
+			"encodes=%ui,encode_ms_avg=%.3f,encode_ms_max=%.3f,decodes=%ui,decode_ms_avg=%.3f,decode_ms_max=%.3f %lld\n",
+			mMetrics.CPUUsedByProcess(), rss,
+			frames, frameAvg, frameMax, encodes, encodeAvg, encodeMax, decodes, decodeAvg, decodeMax, timestamp);
+	}
+	fflush(mpFile);
+}
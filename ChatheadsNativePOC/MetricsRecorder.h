@@ -0,0 +1,79 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __METRICS_RECORDER_H__
+#define __METRICS_RECORDER_H__
+
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "SystemMetrics.h"
+
+// Writes a row of metrics to a file every interval from its own thread, to look at offline (spreadsheet,
+// InfluxDB...): system and per-core CPU, process CPU, RSS, and frame / encode / decode times.
+// The app reports timings with AddFrameTime, AddEncodeTime and AddDecodeTime from any thread. They only
+// touch a few atomics; each row has the count, average and max of what was reported since the previous one.
+class MetricsRecorder
+{
+public:
+	enum Format
+	{
+		CSV,			// header line, then one comma separated line per sample
+		LineProtocol	// InfluxDB line protocol, one "chatheads field=value,... timestamp" line per sample
+	};
+
+	MetricsRecorder() {}
+	~MetricsRecorder() { Stop(); }
+
+	bool Start(const char *pFileName, Format format, int intervalMs);
+	void Stop();
+	bool IsRecording() const { return mpFile != nullptr; }
+
+	// Milliseconds
+	void AddFrameTime(double ms) { mFrame.Add(ms); }
+	void AddEncodeTime(double ms) { mEncode.Add(ms); }
+	void AddDecodeTime(double ms) { mDecode.Add(ms); }
+
+private:
+	MetricsRecorder(const MetricsRecorder&);
+	MetricsRecorder& operator=(const MetricsRecorder&);
+
+	struct Timing
+	{
+		std::atomic<uint32_t>	count;
+		std::atomic<uint64_t>	sumUs;
+		std::atomic<uint64_t>	maxUs;
+
+		Timing() : count(0), sumUs(0), maxUs(0) {}
+		void Add(double ms);
+
+		// Resets. A time added while this runs can land in either row, that's fine for averages.
+		void Take(uint32_t *pCount, double *pAvgMs, double *pMaxMs);
+	};
+
+	void ThreadMain();
+	void WriteHeader();
+	void WriteSample(double time);
+
+	FILE					*mpFile = nullptr;
+	Format					mFormat = CSV;
+	int						mIntervalMs = 1000;
+	std::thread				mThread;
+	std::mutex				mStopMutex;
+	std::condition_variable	mStopCondition;
+	bool					mbStop = false;
+
+	SystemMetrics			mMetrics;	// the recorder thread's own, see SystemMetrics.h
+	double					mStartTime = 0.0;
+
+	Timing					mFrame;
+	Timing					mEncode;
+	Timing					mDecode;
+};
+
+#endif // __METRICS_RECORDER_H__
@@ -9,17 +9,16 @@
 #include "BitStream.h"
 #include "RakNetStatistics.h"
 
-#include "VTuneScopedTask.h"
+#include "Trace.h"
 #include "SetThreadName.h"
 #include "CPUTOSServices.h" // CPUT logging
 
 using namespace CPUTFileSystem;
 extern CPUTLog Log;
-extern __itt_domain* g_pDomain;
 
 void NetworkLayer::Setup(	bool bIsServer, const char* connectIPAddress)
 {
-	VTUNE_TASK(g_pDomain, "Network Setup");
+	TRACE_SCOPE("Network Setup");
 
 	if (bIsServer)
 		mPlayerID = 0;	// server id is 0, client receives its ID from server
@@ -118,7 +117,7 @@ const char* NetworkLayer::GetIPAddress() const
 // Send encoded video data (happens on the app thread)
 bool NetworkLayer::SendVideoData(NetMsgVideoUpdate& msg, bool broadcast)
 {
-	VTUNE_TASK(g_pDomain, "SendVideoData");
+	TRACE_SCOPE("SendVideoData");
 
 	if (!mbInitComplete)
 		return false;
@@ -217,6 +216,7 @@ void NetworkLayer::UpdateBytesRcvdInLastSecond(NetworkLayer *pNet)
 DWORD WINAPI NetworkLayer::NetworkThread(LPVOID lpParam)
 {
 	NetworkLayer *pNet = (NetworkLayer*)lpParam;
+	TraceSetThreadName("NetworkThread");
 
 	// Message handling loop
 	while (pNet->mbStayAlive)
@@ -350,7 +350,7 @@ DWORD WINAPI NetworkLayer::NetworkThread(LPVOID lpParam)
 //		 So, they're all declared as static fns.
 void NetworkLayer::ProcessVideoUpdateMsg(NetworkLayer *pNet, RakNet::Packet *pPacket)
 {
-	VTUNE_TASK(g_pDomain, "ProcessVideoUpdateMsg");
+	TRACE_SCOPE("ProcessVideoUpdateMsg");
 
 	RakNet::BitStream bsIn(pPacket->data, pPacket->length, false);
 
@@ -365,6 +365,7 @@ void NetworkLayer::ProcessVideoUpdateMsg(NetworkLayer *pNet, RakNet::Packet *pPa
 
 	msg.pEncodedData = pPacket->data + headerSize; // point to the right data in the bitstream
 	msg.sizeBytes = pPacket->length - (unsigned int) headerSize; // how big is the data?
+	TRACE_COUNTER("ReceivedBytes", msg.sizeBytes);
 
 	// Call the registered callback
 	NetworkCallbackFn cbFn = pNet->mCallback.cbFn;
@@ -9,7 +9,7 @@
 #include "pxc3dseg.h" // PXC3DSeg
 #include "pxcsensemanager.h" // PXCSession, PXCSenseManager
 
-#include "VTuneScopedTask.h"
+#include "Trace.h"
 #include "SetThreadName.h"
 #include "CPUTOSServices.h" // CPUT logging
 
@@ -18,7 +18,6 @@
 
 using namespace CPUTFileSystem;
 extern CPUTLog Log;
-extern __itt_domain* g_pDomain;
 
 #define RS_STATUS_CHECK(status, log) \
 	if (##status < PXC_STATUS_NO_ERROR) { \
@@ -72,7 +71,7 @@ PXCSession::ImplVersion GetVersion(PXCSession *session, PXCBase *module)
 // Return false if something went wrong
 bool RealsenseMgr::PreInit()
 {
-	VTUNE_TASK(g_pDomain, "RS BasicInit");
+	TRACE_SCOPE("RS BasicInit");
 
 	pxcStatus status;
 
@@ -128,7 +127,7 @@ bool RealsenseMgr::PreInit()
 // Note: Call PreInit() & SetResolution before Init()
 bool RealsenseMgr::Init()
 {
-	VTUNE_TASK(g_pDomain, "RS Init");
+	TRACE_SCOPE("RS Init");
 
 	if (!mpSenseMgr){
 		Log.Log(LOG_ERROR, "Sense manager initialization failed. Did you call PreInit()? \n");
@@ -175,6 +174,7 @@ bool RealsenseMgr::Init()
 	// create userlock (atomic) and thread 
 	mSharedData.hLock = IL_UNLOCK;
 	mSharedData.bImageUpdated = false;
+	mSharedData.frameId = 0;
 	// mutex is expensive, although it does let the thread sleep when it has to wait. going with cheap userlock instead
 	DWORD threadID;
 	mSharedData.hThread = CreateThread(NULL, 0, RealsenseMgr::StaticRSThreadFunc, (void*)this, 0, &threadID);
@@ -188,7 +188,7 @@ bool RealsenseMgr::Init()
 
 void RealsenseMgr::Shutdown()
 {
-	VTUNE_TASK(g_pDomain, "RS Shutdown");
+	TRACE_SCOPE("RS Shutdown");
 
 	if (!mbInitSuccess)
 		return;
@@ -243,6 +243,8 @@ DWORD WINAPI RealsenseMgr::StaticRSThreadFunc(void* t)
 // (this is a non-static member function, so use the static wrapper below to start the thread)
 DWORD RealsenseMgr::RSThread()
 {
+	TraceSetThreadName("RSThread");
+
 	while (mSharedData.bStayAlive)
 	{
 		// We don't use signals/mutex to synchronize with the realsense thread because AcquireFrame blocks until the color buffer is ready
@@ -250,7 +252,7 @@ DWORD RealsenseMgr::RSThread()
 
 		pxcStatus status;
 		{
-			VTUNE_TASK(g_pDomain, "AcquireFrame");
+			TRACE_SCOPE("AcquireFrame");
 			status = mpSenseMgr->AcquireFrame(true);
 		}
 
@@ -273,10 +275,12 @@ DWORD RealsenseMgr::RSThread()
 				pSample->color->AcquireAccess(PXCImage::ACCESS_READ, PXCImage::PIXEL_FORMAT_RGB32, &data);
 
 				// copy the image data to the shared buffer
+				TRACE_SCOPE("CopyColorToSharedBuffer");
 				pxcU16 *pSrc = (pxcU16 *)data.planes[0];
 				byte *pDst = (byte*)mSharedData.segImage.pBuffer;
 				const size_t numBytes = info.width * info.height * cBytesPerPixel;
 				memcpy(pDst, pSrc, numBytes);
+				TRACE_FLOW_BEGIN("LocalFrame", ++mSharedData.frameId);
 
 				pSample->color->ReleaseAccess(&data);
 			}
@@ -285,14 +289,14 @@ DWORD RealsenseMgr::RSThread()
 				// get the segmented image (needs to be deallocated later)
 				PXCImage *pImage = nullptr;
 				{
-					VTUNE_TASK(g_pDomain, "AcquireSegmentedImage");
+					TRACE_SCOPE("AcquireSegmentedImage");
 					pImage = mp3DSeg->AcquireSegmentedImage();
 				}
 				if (!pImage)
 					goto ReleaseFrame;
 
 				{
-					VTUNE_TASK(g_pDomain, "CopyDataToSharedBuffer");
+					TRACE_SCOPE("CopyDataToSharedBuffer");
 					// lock image for read
 					PXCImage::ImageData pImgData;
 					status = pImage->AcquireAccess(PXCImage::ACCESS_READ,
@@ -313,6 +317,7 @@ DWORD RealsenseMgr::RSThread()
 					PXCImage::ImageInfo info = pImage->QueryInfo();
 					const size_t numBytes = info.width * info.height * cBytesPerPixel;
 					memcpy(pDst, pSrc, numBytes);
+					TRACE_FLOW_BEGIN("LocalFrame", ++mSharedData.frameId);
 
 					// unlock image
 					status = pImage->ReleaseAccess(&pImgData);
@@ -0,0 +1,140 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ReplayFrameSource.h"
+#include "Trace.h"
+#include "CPUTOSServices.h" // CPUT logging
+#include <string.h>
+#include <chrono>
+
+extern CPUTLog Log;
+
+bool ReplayFrameSource::Init()
+{
+	TRACE_SCOPE("Replay Init");
+
+	Shutdown();
+	if (!mReader.Open(mFileName))
+	{
+		Log.Log(LOG_ERROR, "Couldn't open recording %s\n", mFileName.c_str());
+		return false;
+	}
+	if (mReader.FrameCount() == 0)
+	{
+		Log.Log(LOG_ERROR, "Recording %s has no frames\n", mFileName.c_str());
+		mReader.Close();
+		return false;
+	}
+
+	mVideoWidth = mReader.Width();
+	mVideoHeight = mReader.Height();
+	mFrame.resize(mVideoWidth * mVideoHeight * cBytesPerPixel);
+	mNextFrame = 0;
+	mFramesDelivered = 0;
+
+	mSharedData.segImage.width = mVideoWidth;
+	mSharedData.segImage.height = mVideoHeight;
+	mSharedData.segImage.pBuffer = new byte[mVideoWidth * mVideoHeight * cBytesPerPixel];
+	mSharedData.hLock = IL_UNLOCK;
+	mSharedData.bImageUpdated = false;
+	mSharedData.bDoSegmentation = true;
+	mSharedData.bStayAlive = true;
+	mSharedData.frameId = 0;
+	mSharedData.hThread = NULL;
+
+	mbStop = false;
+	mThread = std::thread(&ReplayFrameSource::ThreadMain, this);
+	mbInitSuccess = true;
+
+	Log.Log(LOG_INFO, "Replaying %s: %u frames of %dx%d at %.1f fps\n", mFileName.c_str(), mReader.FrameCount(), mVideoWidth, mVideoHeight, FrameRate());
+	return true;
+}
+
+void ReplayFrameSource::Shutdown()
+{
+	if (!mbInitSuccess)
+		return;
+
+	mbInitSuccess = false;
+	{
+		std::lock_guard<std::mutex> lock(mStopMutex);
+		mbStop = true;
+	}
+	mStopCondition.notify_one();
+	mThread.join();
+	mSharedData.bStayAlive = false;
+
+	delete[] mSharedData.segImage.pBuffer;
+	mSharedData.segImage.pBuffer = nullptr;
+	mReader.Close();
+}
+
+double ReplayFrameSource::FrameRate() const
+{
+	if (mRate >= 0.0)
+		return mRate;
+	return mReader.FrameRate() > 0.0 ? mReader.FrameRate() : 30.0;
+}
+
+// Copies mFrame in if the main thread isn't reading the previous one. Returns false if it was.
+bool ReplayFrameSource::Deliver()
+{
+	if (InterlockedExchange(&mSharedData.hLock, IL_LOCK) != IL_UNLOCK)
+		return false;
+
+	{
+		TRACE_SCOPE("CopyReplayToSharedBuffer");
+		memcpy(mSharedData.segImage.pBuffer, mFrame.data(), mFrame.size());
+		++mSharedData.frameId;
+		TRACE_FLOW_BEGIN("LocalFrame", mSharedData.frameId);
+	}
+	InterlockedExchange(&mSharedData.hLock, IL_UNLOCK);
+	mSharedData.bImageUpdated = true;
+	mFramesDelivered.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void ReplayFrameSource::ThreadMain()
+{
+	TraceSetThreadName("ReplayThread");
+
+	const double rate = FrameRate();
+	const std::chrono::steady_clock::duration period = rate > 0.0 ?
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate)) :
+		std::chrono::steady_clock::duration::zero();
+	std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+
+	while (!mbStop)
+	{
+		{
+			TRACE_SCOPE("DecodeReplayFrame");
+			if (!mReader.ReadFrame(mNextFrame, mFrame.data()))
+				Log.Log(LOG_ERROR, "Frame %u of %s is damaged\n", mNextFrame, mFileName.c_str());
+			mNextFrame = (mNextFrame + 1) % mReader.FrameCount();
+		}
+
+		if (rate > 0.0)
+		{
+			// A camera doesn't catch up on frames it missed either
+			next += period;
+			const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (now > next + period)
+				next = now;
+
+			std::unique_lock<std::mutex> lock(mStopMutex);
+			if (mStopCondition.wait_until(lock, next, [this] { return mbStop.load(); }))
+				break;
+			lock.unlock();
+			Deliver();
+		}
+		else
+		{
+			// As fast as possible, but each frame only once it's taken
+			while (!mbStop && (mSharedData.bImageUpdated || !Deliver()))
+				std::this_thread::yield();
+		}
+	}
+}
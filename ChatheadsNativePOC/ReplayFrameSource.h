@@ -0,0 +1,62 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __REPLAY_FRAME_SOURCE_H__
+#define __REPLAY_FRAME_SOURCE_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FrameSource.h"
+#include "FrameFile.h"
+
+// Plays a .chf recording (see FrameFile.h) back as the local chathead, over and over, so the
+// encode / network / decode path runs the same without a camera. Frames go through mSharedData
+// exactly like the camera's.
+// At a fixed rate frames the main thread didn't take in time are replaced by the next one, like
+// a camera's. At rate 0 a frame is delivered as soon as the previous one was taken, for benchmarks.
+class ReplayFrameSource : public FrameSource
+{
+public:
+	ReplayFrameSource() : mFramesDelivered(0), mbStop(false) {}
+	~ReplayFrameSource() { Shutdown(); }
+
+	// Call before Init
+	void SetFile(const std::string &fileName) { mFileName = fileName; }
+	// Frames per second; < 0 is the rate the file was recorded at, 0 as fast as they're taken
+	void SetRate(double framesPerSecond) { mRate = framesPerSecond; }
+
+	virtual bool Init() override;
+	virtual void Shutdown() override;
+	virtual double FrameRate() const override;
+
+	const std::string& GetFile() const { return mFileName; }
+	uint32_t FramesDelivered() const { return mFramesDelivered.load(std::memory_order_relaxed); }
+
+private:
+	ReplayFrameSource(const ReplayFrameSource&);
+	ReplayFrameSource& operator=(const ReplayFrameSource&);
+
+	void ThreadMain();
+	bool Deliver();
+
+	std::string				mFileName;
+	double					mRate = -1.0;
+	FrameFileReader			mReader;
+	std::vector<uint8_t>	mFrame;			// decoded next frame, copied in under the lock
+	uint32_t				mNextFrame = 0;
+	std::atomic<uint32_t>	mFramesDelivered;
+
+	std::thread				mThread;
+	std::mutex				mStopMutex;
+	std::condition_variable	mStopCondition;
+	std::atomic<bool>		mbStop;
+};
+
+#endif // __REPLAY_FRAME_SOURCE_H__
@@ -4,172 +4,67 @@
 // Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-/**************************************************************************************************
-Collection of functions to get Windows system and process specific metrics
-
-Based on: 
-http://stackoverflow.com/questions/63166/how-to-determine-cpu-and-memory-consumption-from-inside-a-process
-
-References:
-MEMORYSTATUSEX https://msdn.microsoft.com/en-us/library/windows/desktop/aa366770(v=vs.85).aspx
-PROCESS_MEMORY_COUNTERS_EX https://msdn.microsoft.com/en-us/library/windows/desktop/ms684874(v=vs.85).aspx
-PdhOpenQuery
-***************************************************************************************************/
-
-#include "windows.h"
-#include "psapi.h" // PROCESS_MEMORY_COUNTERS_EX 
-#include "pdh.h"// PDH_HQUERY, PDH_HCOUNTER 
-
-#pragma comment(lib, "pdh.lib")
-//--------------------------------- SYSTEM SPECIFICS ------------------------------------
-
-static DWORDLONG TotalPhysicalMemory()
-{
-	MEMORYSTATUSEX memInfo;
-	memInfo.dwLength = sizeof(MEMORYSTATUSEX);
-	GlobalMemoryStatusEx(&memInfo);
-
-	DWORDLONG totalPhysMem = memInfo.ullTotalPhys;
-	return totalPhysMem;
-}
-
-
-static DWORDLONG PhysicalMemoryUsed()
-{
-	MEMORYSTATUSEX memInfo;
-	memInfo.dwLength = sizeof(MEMORYSTATUSEX);
-	GlobalMemoryStatusEx(&memInfo);
-
-	DWORDLONG physMemUsed = memInfo.ullTotalPhys - memInfo.ullAvailPhys;
-	return physMemUsed;
-}
-
-// Virtual memory size (in bytes) = Size of swap file + RAM. 
-static DWORDLONG TotalVirtualMemory()
-{
-	MEMORYSTATUSEX memInfo;
-	memInfo.dwLength = sizeof(MEMORYSTATUSEX);
-	GlobalMemoryStatusEx(&memInfo);
-
-	// ullTotalPageFile = The current committed memory limit for the system or the current process, whichever is smaller, in bytes.
-	DWORDLONG totalVirtualMem = memInfo.ullTotalPageFile; 
-	return totalVirtualMem;
-}
-
-// Virtual memory used in bytes
-static DWORDLONG VirtualMemoryUsed()
-{
-	MEMORYSTATUSEX memInfo;
-	memInfo.dwLength = sizeof(MEMORYSTATUSEX);
-	GlobalMemoryStatusEx(&memInfo);
-	DWORDLONG virtualMemoryUsed = memInfo.ullTotalPageFile - memInfo.ullAvailPageFile;
-
-	return virtualMemoryUsed;
-}
-
-
-static PDH_HQUERY cpuQuery;
-static PDH_HCOUNTER cpuTotal;
+#ifndef __SYSTEM_METRICS_H__
+#define __SYSTEM_METRICS_H__
 
+#include <stdint.h>
 
-void InitCPUQuery(){
-	PdhOpenQuery(NULL, NULL, &cpuQuery);
-	PdhAddCounter(cpuQuery, L"\\Processor(_Total)\\% Processor Time", NULL, &cpuTotal);
-	PdhCollectQueryData(cpuQuery);
-}
-
-// Percentage CPU used by system
-// Call InitCPUQuery (just the once) prior to using this.
-double CPUUsed(){
-	PDH_FMT_COUNTERVALUE counterVal;
-
-
-	PdhCollectQueryData(cpuQuery);
-	PdhGetFormattedCounterValue(cpuTotal, PDH_FMT_DOUBLE, NULL, &counterVal);
-	return counterVal.doubleValue;
-}
-
-//--------------------------------- PROCESS SPECIFICS ------------------------------------	
-
-static SIZE_T PhysicalMemoryUsedByProcess()
-{
-	PROCESS_MEMORY_COUNTERS_EX pmc;
+/**************************************************************************************************
+System and process metrics: memory, total and per-core CPU, process CPU and memory.
 
-	// To ensure correct resolution of symbols, add Psapi.lib to TARGETLIBS
-	// and compile with -DPSAPI_VERSION=1
-	GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PPROCESS_MEMORY_COUNTERS> (&pmc), sizeof(pmc));
-	SIZE_T physMemUsedByMe = pmc.WorkingSetSize;
+One implementation per platform:
+SystemMetricsWin.cpp	PDH counters, GlobalMemoryStatusEx, GetProcessMemoryInfo, GetProcessTimes
+SystemMetricsLinux.cpp	/proc/stat, /proc/self/stat, /proc/self/status, /proc/meminfo
 
-	return physMemUsedByMe;
-}
+CPU percentages are averages over the time between the last two Sample() calls on the same instance,
+so everything that reads them on its own schedule (the UI, MetricsRecorder's thread) keeps its own
+SystemMetrics. Memory is read when asked for.
+***************************************************************************************************/
 
+struct SystemMetricsPlatform;
 
-static SIZE_T VirtualMemoryUsedByProcess()
+class SystemMetrics
 {
-	PROCESS_MEMORY_COUNTERS_EX pmc;
-
-	// To ensure correct resolution of symbols, add Psapi.lib to TARGETLIBS
-	// and compile with -DPSAPI_VERSION=1
-	GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PPROCESS_MEMORY_COUNTERS> (&pmc), sizeof(pmc));
-	SIZE_T virtualMemUsedByMe = pmc.PrivateUsage;
-
-	return virtualMemUsedByMe;
-}
+public:
+	static const int cMaxCores = 64;
 
+	SystemMetrics();
+	~SystemMetrics();
 
-static ULARGE_INTEGER lastCPU, lastSysCPU, lastUserCPU;
-static int numProcessors;
-static HANDLE self;
+	// Call (just the once) before anything else. The first Sample() after it measures from here.
+	bool Init();
+	void Shutdown();
 
+	// Updates the CPU percentages below
+	void Sample();
 
-void InitCPUInfo(){
-	SYSTEM_INFO sysInfo;
-	FILETIME ftime, fsys, fuser;
+	int NumProcessors() const { return mNumProcessors; }
 
+	// Percent, [0, 100]
+	double CPUUsed() const { return mCPUUsed; }
+	double CPUUsedByProcess() const { return mCPUUsedByProcess; }
+	double CoreCPUUsed(int core) const { return mCoreCPUUsed[core]; }
 
-	GetSystemInfo(&sysInfo);
-	numProcessors = sysInfo.dwNumberOfProcessors;
+	// Bytes
+	uint64_t TotalPhysicalMemory();
+	uint64_t PhysicalMemoryUsed();
+	uint64_t TotalVirtualMemory();		// RAM + swap / page file
+	uint64_t VirtualMemoryUsed();
+	uint64_t PhysicalMemoryUsedByProcess();	// working set / RSS
+	uint64_t VirtualMemoryUsedByProcess();	// private bytes / VmSize
 
+	// Monotonic clock in seconds, for timing frames and encode/decode
+	static double GetTimeSeconds();
 
-	GetSystemTimeAsFileTime(&ftime);
-	memcpy(&lastCPU, &ftime, sizeof(FILETIME));
+private:
+	SystemMetrics(const SystemMetrics&);
+	SystemMetrics& operator=(const SystemMetrics&);
 
+	SystemMetricsPlatform	*mpPlatform;
+	int						mNumProcessors;
+	double					mCPUUsed;
+	double					mCPUUsedByProcess;
+	double					mCoreCPUUsed[cMaxCores];
+};
 
-	self = GetCurrentProcess();
-	GetProcessTimes(self, &ftime, &ftime, &fsys, &fuser);
-	memcpy(&lastSysCPU, &fsys, sizeof(FILETIME));
-	memcpy(&lastUserCPU, &fuser, sizeof(FILETIME));
-}
-
-// Percentage CPU used by process
-// Call InitCPUInfo (just the once) prior to using this.
-double CPUUsedByProcess(){
-	FILETIME ftime, fsys, fuser;
-	ULARGE_INTEGER now, sys, user;
-	double percent;
-
-
-	GetSystemTimeAsFileTime(&ftime);
-	memcpy(&now, &ftime, sizeof(FILETIME));
-
-
-	GetProcessTimes(self, &ftime, &ftime, &fsys, &fuser);
-	memcpy(&sys, &fsys, sizeof(FILETIME));
-	memcpy(&user, &fuser, sizeof(FILETIME));
-	percent = (sys.QuadPart - lastSysCPU.QuadPart) +
-		(user.QuadPart - lastUserCPU.QuadPart);
-	percent /= (now.QuadPart - lastCPU.QuadPart);
-	percent /= numProcessors;
-	lastCPU = now;
-	lastUserCPU = user;
-	lastSysCPU = sys;
-
-
-	return percent * 100;
-}
-
-
-int NumProcessors()
-{
-	return numProcessors;
-}
\ No newline at end of file
+#endif // __SYSTEM_METRICS_H__
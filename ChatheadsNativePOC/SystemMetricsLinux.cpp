@@ -0,0 +1,239 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+/**************************************************************************************************
+SystemMetrics for Linux, see SystemMetrics.h
+
+The /proc files are opened once in Init() and re-read with pread() from offset 0 into fixed buffers, which
+gets fresh contents each time without reopening. Nothing is allocated per sample.
+***************************************************************************************************/
+
+#include "SystemMetrics.h"
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+struct SystemMetricsPlatform
+{
+	int			statFd;			// /proc/stat
+	int			selfStatFd;		// /proc/self/stat
+	int			selfStatusFd;	// /proc/self/status
+	int			meminfoFd;		// /proc/meminfo
+	long		ticksPerSecond;
+
+	// Jiffies at the last sample: [0] all cores, [1 + n] core n
+	uint64_t	lastBusy[SystemMetrics::cMaxCores + 1];
+	uint64_t	lastTotal[SystemMetrics::cMaxCores + 1];
+	uint64_t	lastProcessTicks;
+	double		lastTime;
+
+	// Only the cpu lines at the start of /proc/stat are needed, the rest (intr...) can be cut off
+	char		buffer[16384];
+};
+
+// Fills p->buffer with the file's current contents, null terminated
+static bool ReadProcFile(SystemMetricsPlatform *p, int fd)
+{
+	if (fd < 0)
+		return false;
+	ssize_t size = pread(fd, p->buffer, sizeof(p->buffer) - 1, 0);
+	if (size <= 0)
+		return false;
+	p->buffer[size] = '\0';
+	return true;
+}
+
+// Value of a "Key:   1234 kB" line in /proc/meminfo or /proc/self/status, in bytes
+static uint64_t FindKilobytes(const char *pText, const char *pKey)
+{
+	const char *pLine = strstr(pText, pKey);
+	if (!pLine)
+		return 0;
+	return strtoull(pLine + strlen(pKey), NULL, 10) * 1024;
+}
+
+// Reads one "cpu..." line of /proc/stat: user nice system idle iowait irq softirq steal
+static const char* ParseCPULine(const char *pLine, uint64_t *pBusy, uint64_t *pTotal)
+{
+	char *pEnd;
+	uint64_t values[8] = {};
+	const char *pCursor = pLine;
+	while (*pCursor && *pCursor != ' ')
+		pCursor++;
+	for (int i = 0; i < 8; i++)
+	{
+		values[i] = strtoull(pCursor, &pEnd, 10);
+		if (pEnd == pCursor)
+			break;
+		pCursor = pEnd;
+	}
+	const uint64_t idle = values[3] + values[4];
+	uint64_t total = 0;
+	for (int i = 0; i < 8; i++)
+		total += values[i];
+	*pBusy = total - idle;
+	*pTotal = total;
+
+	const char *pNext = strchr(pCursor, '\n');
+	return pNext ? pNext + 1 : NULL;
+}
+
+static double Percent(uint64_t busy, uint64_t lastBusy, uint64_t total, uint64_t lastTotal)
+{
+	if (total <= lastTotal)
+		return 0.0;
+	return 100.0 * (double)(busy - lastBusy) / (double)(total - lastTotal);
+}
+
+SystemMetrics::SystemMetrics()
+	: mpPlatform(nullptr), mNumProcessors(0), mCPUUsed(0.0), mCPUUsedByProcess(0.0)
+{
+	memset(mCoreCPUUsed, 0, sizeof(mCoreCPUUsed));
+}
+
+SystemMetrics::~SystemMetrics()
+{
+	Shutdown();
+}
+
+bool SystemMetrics::Init()
+{
+	Shutdown();
+
+	mpPlatform = new SystemMetricsPlatform();
+	memset(mpPlatform, 0, sizeof(*mpPlatform));
+	mpPlatform->statFd = open("/proc/stat", O_RDONLY | O_CLOEXEC);
+	mpPlatform->selfStatFd = open("/proc/self/stat", O_RDONLY | O_CLOEXEC);
+	mpPlatform->selfStatusFd = open("/proc/self/status", O_RDONLY | O_CLOEXEC);
+	mpPlatform->meminfoFd = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+	mpPlatform->ticksPerSecond = sysconf(_SC_CLK_TCK);
+
+	mNumProcessors = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (mNumProcessors > cMaxCores)
+		mNumProcessors = cMaxCores;
+
+	// Starting point for the first Sample()
+	Sample();
+	mCPUUsed = mCPUUsedByProcess = 0.0;
+	memset(mCoreCPUUsed, 0, sizeof(mCoreCPUUsed));
+
+	return mpPlatform->statFd >= 0 && mpPlatform->selfStatFd >= 0 && mpPlatform->selfStatusFd >= 0 && mpPlatform->meminfoFd >= 0;
+}
+
+void SystemMetrics::Shutdown()
+{
+	if (!mpPlatform)
+		return;
+
+	int fds[] = { mpPlatform->statFd, mpPlatform->selfStatFd, mpPlatform->selfStatusFd, mpPlatform->meminfoFd };
+	for (int fd : fds)
+	{
+		if (fd >= 0)
+			close(fd);
+	}
+	delete mpPlatform;
+	mpPlatform = nullptr;
+}
+
+void SystemMetrics::Sample()
+{
+	if (!mpPlatform)
+		return;
+	SystemMetricsPlatform *p = mpPlatform;
+
+	// System: "cpu" for all cores, then "cpu0", "cpu1"...
+	if (ReadProcFile(p, p->statFd))
+	{
+		const char *pLine = p->buffer;
+		for (int slot = 0; pLine && slot <= mNumProcessors && !strncmp(pLine, "cpu", 3); slot++)
+		{
+			uint64_t busy, total;
+			pLine = ParseCPULine(pLine, &busy, &total);
+			double percent = Percent(busy, p->lastBusy[slot], total, p->lastTotal[slot]);
+			if (slot == 0)
+				mCPUUsed = percent;
+			else
+				mCoreCPUUsed[slot - 1] = percent;
+			p->lastBusy[slot] = busy;
+			p->lastTotal[slot] = total;
+		}
+	}
+
+	// Process: utime and stime are fields 14 and 15, counted after the ")" that ends the command name
+	double now = GetTimeSeconds();
+	if (ReadProcFile(p, p->selfStatFd))
+	{
+		const char *pCursor = strrchr(p->buffer, ')');
+		for (int field = 2; pCursor && field < 14; field++)
+			pCursor = strchr(pCursor + 1, ' ');
+		if (pCursor)
+		{
+			char *pEnd;
+			uint64_t utime = strtoull(pCursor + 1, &pEnd, 10);
+			uint64_t stime = strtoull(pEnd, NULL, 10);
+			uint64_t ticks = utime + stime;
+
+			double elapsed = now - p->lastTime;
+			if (p->lastTime > 0.0 && elapsed > 0.0 && mNumProcessors > 0)
+				mCPUUsedByProcess = 100.0 * (double)(ticks - p->lastProcessTicks) / (double)p->ticksPerSecond / elapsed / mNumProcessors;
+			p->lastProcessTicks = ticks;
+			p->lastTime = now;
+		}
+	}
+}
+
+uint64_t SystemMetrics::TotalPhysicalMemory()
+{
+	if (!mpPlatform || !ReadProcFile(mpPlatform, mpPlatform->meminfoFd))
+		return 0;
+	return FindKilobytes(mpPlatform->buffer, "MemTotal:");
+}
+
+uint64_t SystemMetrics::PhysicalMemoryUsed()
+{
+	if (!mpPlatform || !ReadProcFile(mpPlatform, mpPlatform->meminfoFd))
+		return 0;
+	return FindKilobytes(mpPlatform->buffer, "MemTotal:") - FindKilobytes(mpPlatform->buffer, "MemAvailable:");
+}
+
+uint64_t SystemMetrics::TotalVirtualMemory()
+{
+	if (!mpPlatform || !ReadProcFile(mpPlatform, mpPlatform->meminfoFd))
+		return 0;
+	return FindKilobytes(mpPlatform->buffer, "MemTotal:") + FindKilobytes(mpPlatform->buffer, "SwapTotal:");
+}
+
+uint64_t SystemMetrics::VirtualMemoryUsed()
+{
+	if (!mpPlatform || !ReadProcFile(mpPlatform, mpPlatform->meminfoFd))
+		return 0;
+	const char *pText = mpPlatform->buffer;
+	return FindKilobytes(pText, "MemTotal:") - FindKilobytes(pText, "MemAvailable:") +
+		FindKilobytes(pText, "SwapTotal:") - FindKilobytes(pText, "SwapFree:");
+}
+
+uint64_t SystemMetrics::PhysicalMemoryUsedByProcess()
+{
+	if (!mpPlatform || !ReadProcFile(mpPlatform, mpPlatform->selfStatusFd))
+		return 0;
+	return FindKilobytes(mpPlatform->buffer, "VmRSS:");
+}
+
+uint64_t SystemMetrics::VirtualMemoryUsedByProcess()
+{
+	if (!mpPlatform || !ReadProcFile(mpPlatform, mpPlatform->selfStatusFd))
+		return 0;
+	return FindKilobytes(mpPlatform->buffer, "VmSize:");
+}
+
+double SystemMetrics::GetTimeSeconds()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
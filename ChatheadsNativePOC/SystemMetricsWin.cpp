@@ -0,0 +1,214 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+/**************************************************************************************************
+SystemMetrics for Windows, see SystemMetrics.h
+
+Based on: 
+http://stackoverflow.com/questions/63166/how-to-determine-cpu-and-memory-consumption-from-inside-a-process
+
+References:
+MEMORYSTATUSEX https://msdn.microsoft.com/en-us/library/windows/desktop/aa366770(v=vs.85).aspx
+PROCESS_MEMORY_COUNTERS_EX https://msdn.microsoft.com/en-us/library/windows/desktop/ms684874(v=vs.85).aspx
+PdhOpenQuery
+***************************************************************************************************/
+
+#include "SystemMetrics.h"
+#include "windows.h"
+#include "psapi.h" // PROCESS_MEMORY_COUNTERS_EX 
+#include "pdh.h"// PDH_HQUERY, PDH_HCOUNTER 
+#include <stdio.h>
+#include <string.h>
+
+#pragma comment(lib, "pdh.lib")
+
+struct SystemMetricsPlatform
+{
+	PDH_HQUERY		cpuQuery;
+	PDH_HCOUNTER	cpuTotal;
+	PDH_HCOUNTER	cpuCores[SystemMetrics::cMaxCores];
+
+	HANDLE			self;
+	ULARGE_INTEGER	lastCPU, lastSysCPU, lastUserCPU;
+};
+
+static double CounterValue(PDH_HCOUNTER counter)
+{
+	PDH_FMT_COUNTERVALUE counterVal;
+	if (PdhGetFormattedCounterValue(counter, PDH_FMT_DOUBLE, NULL, &counterVal) != ERROR_SUCCESS)
+		return 0.0;
+	return counterVal.doubleValue;
+}
+
+SystemMetrics::SystemMetrics()
+	: mpPlatform(nullptr), mNumProcessors(0), mCPUUsed(0.0), mCPUUsedByProcess(0.0)
+{
+	memset(mCoreCPUUsed, 0, sizeof(mCoreCPUUsed));
+}
+
+SystemMetrics::~SystemMetrics()
+{
+	Shutdown();
+}
+
+bool SystemMetrics::Init()
+{
+	Shutdown();
+
+	mpPlatform = new SystemMetricsPlatform();
+	memset(mpPlatform, 0, sizeof(*mpPlatform));
+	SystemMetricsPlatform *p = mpPlatform;
+
+	SYSTEM_INFO sysInfo;
+	GetSystemInfo(&sysInfo);
+	mNumProcessors = (int)sysInfo.dwNumberOfProcessors;
+	if (mNumProcessors > cMaxCores)
+		mNumProcessors = cMaxCores;
+
+	// System, total and per core
+	if (PdhOpenQuery(NULL, NULL, &p->cpuQuery) != ERROR_SUCCESS)
+		return false;
+	PdhAddCounter(p->cpuQuery, L"\\Processor(_Total)\\% Processor Time", NULL, &p->cpuTotal);
+	for (int core = 0; core < mNumProcessors; core++)
+	{
+		wchar_t counterPath[64];
+		swprintf(counterPath, 64, L"\\Processor(%d)\\%% Processor Time", core);
+		PdhAddCounter(p->cpuQuery, counterPath, NULL, &p->cpuCores[core]);
+	}
+	PdhCollectQueryData(p->cpuQuery);
+
+	// Process
+	FILETIME ftime, fsys, fuser;
+	GetSystemTimeAsFileTime(&ftime);
+	memcpy(&p->lastCPU, &ftime, sizeof(FILETIME));
+
+	p->self = GetCurrentProcess();
+	GetProcessTimes(p->self, &ftime, &ftime, &fsys, &fuser);
+	memcpy(&p->lastSysCPU, &fsys, sizeof(FILETIME));
+	memcpy(&p->lastUserCPU, &fuser, sizeof(FILETIME));
+	return true;
+}
+
+void SystemMetrics::Shutdown()
+{
+	if (!mpPlatform)
+		return;
+
+	if (mpPlatform->cpuQuery)
+		PdhCloseQuery(mpPlatform->cpuQuery);
+	delete mpPlatform;
+	mpPlatform = nullptr;
+}
+
+void SystemMetrics::Sample()
+{
+	if (!mpPlatform)
+		return;
+	SystemMetricsPlatform *p = mpPlatform;
+
+	// Percentage CPU used by system
+	PdhCollectQueryData(p->cpuQuery);
+	mCPUUsed = CounterValue(p->cpuTotal);
+	for (int core = 0; core < mNumProcessors; core++)
+		mCoreCPUUsed[core] = p->cpuCores[core] ? CounterValue(p->cpuCores[core]) : 0.0;
+
+	// Percentage CPU used by process
+	FILETIME ftime, fsys, fuser;
+	ULARGE_INTEGER now, sys, user;
+	double percent;
+
+	GetSystemTimeAsFileTime(&ftime);
+	memcpy(&now, &ftime, sizeof(FILETIME));
+
+	GetProcessTimes(p->self, &ftime, &ftime, &fsys, &fuser);
+	memcpy(&sys, &fsys, sizeof(FILETIME));
+	memcpy(&user, &fuser, sizeof(FILETIME));
+	if (now.QuadPart == p->lastCPU.QuadPart)
+		return;
+	percent = (double)((sys.QuadPart - p->lastSysCPU.QuadPart) +
+		(user.QuadPart - p->lastUserCPU.QuadPart));
+	percent /= (now.QuadPart - p->lastCPU.QuadPart);
+	percent /= mNumProcessors;
+	p->lastCPU = now;
+	p->lastUserCPU = user;
+	p->lastSysCPU = sys;
+
+	mCPUUsedByProcess = percent * 100;
+}
+
+//--------------------------------- SYSTEM SPECIFICS ------------------------------------
+
+uint64_t SystemMetrics::TotalPhysicalMemory()
+{
+	MEMORYSTATUSEX memInfo;
+	memInfo.dwLength = sizeof(MEMORYSTATUSEX);
+	GlobalMemoryStatusEx(&memInfo);
+
+	return memInfo.ullTotalPhys;
+}
+
+uint64_t SystemMetrics::PhysicalMemoryUsed()
+{
+	MEMORYSTATUSEX memInfo;
+	memInfo.dwLength = sizeof(MEMORYSTATUSEX);
+	GlobalMemoryStatusEx(&memInfo);
+
+	return memInfo.ullTotalPhys - memInfo.ullAvailPhys;
+}
+
+// Virtual memory size (in bytes) = Size of swap file + RAM. 
+uint64_t SystemMetrics::TotalVirtualMemory()
+{
+	MEMORYSTATUSEX memInfo;
+	memInfo.dwLength = sizeof(MEMORYSTATUSEX);
+	GlobalMemoryStatusEx(&memInfo);
+
+	// ullTotalPageFile = The current committed memory limit for the system or the current process, whichever is smaller, in bytes.
+	return memInfo.ullTotalPageFile;
+}
+
+// Virtual memory used in bytes
+uint64_t SystemMetrics::VirtualMemoryUsed()
+{
+	MEMORYSTATUSEX memInfo;
+	memInfo.dwLength = sizeof(MEMORYSTATUSEX);
+	GlobalMemoryStatusEx(&memInfo);
+
+	return memInfo.ullTotalPageFile - memInfo.ullAvailPageFile;
+}
+
+//--------------------------------- PROCESS SPECIFICS ------------------------------------	
+
+uint64_t SystemMetrics::PhysicalMemoryUsedByProcess()
+{
+	PROCESS_MEMORY_COUNTERS_EX pmc;
+
+	// To ensure correct resolution of symbols, add Psapi.lib to TARGETLIBS
+	// and compile with -DPSAPI_VERSION=1
+	GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PPROCESS_MEMORY_COUNTERS> (&pmc), sizeof(pmc));
+	return pmc.WorkingSetSize;
+}
+
+uint64_t SystemMetrics::VirtualMemoryUsedByProcess()
+{
+	PROCESS_MEMORY_COUNTERS_EX pmc;
+
+	// To ensure correct resolution of symbols, add Psapi.lib to TARGETLIBS
+	// and compile with -DPSAPI_VERSION=1
+	GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PPROCESS_MEMORY_COUNTERS> (&pmc), sizeof(pmc));
+	return pmc.PrivateUsage;
+}
+
+double SystemMetrics::GetTimeSeconds()
+{
+	static LARGE_INTEGER frequency = {};
+	if (!frequency.QuadPart)
+		QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
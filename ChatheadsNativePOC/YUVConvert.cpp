@@ -0,0 +1,97 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "YUVConvert.h"
+#include <emmintrin.h>
+
+// 8 bit fixed point BT.601: R = (298 (Y - 16) + 409 (V - 128) + 128) >> 8, etc.
+static const int cYScale = 298;
+static const int cVToR = 409;
+static const int cUToG = -100;
+static const int cVToG = -208;
+static const int cUToB = 516;
+
+static inline unsigned char Clamp255(int value)
+{
+	return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+static void ConvertRowScalar(const unsigned char *pSrc, unsigned char *pDst, int width)
+{
+	for (int x = 0; x < width; ++x, pSrc += 4, pDst += 4)
+	{
+		const int c = pSrc[0] - 16;
+		const int d = pSrc[1] - 128;
+		const int e = pSrc[2] - 128;
+		pDst[0] = Clamp255((cYScale * c + cVToR * e + 128) >> 8);
+		pDst[1] = Clamp255((cYScale * c + cUToG * d + cVToG * e + 128) >> 8);
+		pDst[2] = Clamp255((cYScale * c + cUToB * d + 128) >> 8);
+		pDst[3] = 255;
+	}
+}
+
+// Two 16 bit values per 32 bit lane, lo and hi, for _mm_madd_epi16
+static inline __m128i Pair16(int lo, int hi)
+{
+	return _mm_set1_epi32((int)(((unsigned)hi << 16) | ((unsigned)lo & 0xFFFF)));
+}
+
+// R, G and B of 4 pixels as 32 bit lanes, not clamped
+static inline void ConvertQuad(__m128i yuvx, __m128i &r, __m128i &g, __m128i &b)
+{
+	const __m128i byteMask = _mm_set1_epi32(0xFF);
+	const __m128i lowMask = _mm_set1_epi32(0xFFFF);
+	const __m128i c = _mm_sub_epi32(_mm_and_si128(yuvx, byteMask), _mm_set1_epi32(16));
+	const __m128i d = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(yuvx, 8), byteMask), _mm_set1_epi32(128));
+	const __m128i e = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(yuvx, 16), byteMask), _mm_set1_epi32(128));
+
+	// (c, e), (c, d) and (e, 1) pairs: one madd each gives a whole sum of products
+	const __m128i ce = _mm_or_si128(_mm_and_si128(c, lowMask), _mm_slli_epi32(e, 16));
+	const __m128i cd = _mm_or_si128(_mm_and_si128(c, lowMask), _mm_slli_epi32(d, 16));
+	const __m128i e1 = _mm_or_si128(_mm_and_si128(e, lowMask), _mm_set1_epi32(0x10000));
+	const __m128i round = _mm_set1_epi32(128);
+
+	r = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ce, Pair16(cYScale, cVToR)), round), 8);
+	g = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cd, Pair16(cYScale, cUToG)), _mm_madd_epi16(e1, Pair16(cVToG, 128))), 8);
+	b = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cd, Pair16(cYScale, cUToB)), round), 8);
+}
+
+static void ConvertRowSSE2(const unsigned char *pSrc, unsigned char *pDst, int width)
+{
+	const __m128i alpha = _mm_set1_epi16(255);
+	int x = 0;
+	for (; x + 8 <= width; x += 8)
+	{
+		__m128i r0, g0, b0, r1, g1, b1;
+		ConvertQuad(_mm_loadu_si128((const __m128i*)(pSrc + x * 4)), r0, g0, b0);
+		ConvertQuad(_mm_loadu_si128((const __m128i*)(pSrc + x * 4 + 16)), r1, g1, b1);
+
+		// Saturating packs do the clamping: 32 -> 16 signed, then 16 -> 8 unsigned
+		const __m128i rg = _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(g0, g1));	// R0..R7 G0..G7
+		const __m128i ba = _mm_packus_epi16(_mm_packs_epi32(b0, b1), alpha);					// B0..B7 A0..A7
+		const __m128i rgInterleaved = _mm_unpacklo_epi8(rg, _mm_unpackhi_epi64(rg, rg));		// R0 G0 R1 G1 ..
+		const __m128i baInterleaved = _mm_unpacklo_epi8(ba, _mm_unpackhi_epi64(ba, ba));		// B0 A0 B1 A1 ..
+		_mm_storeu_si128((__m128i*)(pDst + x * 4), _mm_unpacklo_epi16(rgInterleaved, baInterleaved));
+		_mm_storeu_si128((__m128i*)(pDst + x * 4 + 16), _mm_unpackhi_epi16(rgInterleaved, baInterleaved));
+	}
+	ConvertRowScalar(pSrc + x * 4, pDst + x * 4, width - x);
+}
+
+void ConvertYUVXToRGBX(const unsigned char *pSrc, int srcPitch, unsigned char *pDst, int dstPitch, int width, int height)
+{
+	for (int y = 0; y < height; ++y, pSrc += srcPitch, pDst += dstPitch)
+	{
+		ConvertRowSSE2(pSrc, pDst, width);
+	}
+}
+
+void ConvertYUVXToRGBXScalar(const unsigned char *pSrc, int srcPitch, unsigned char *pDst, int dstPitch, int width, int height)
+{
+	for (int y = 0; y < height; ++y, pSrc += srcPitch, pDst += dstPitch)
+	{
+		ConvertRowScalar(pSrc, pDst, width);
+	}
+}
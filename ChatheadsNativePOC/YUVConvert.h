@@ -0,0 +1,24 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __YUV_CONVERT_H__
+#define __YUV_CONVERT_H__
+
+// Theora frames requested as TH_YUVX: 4 bytes per pixel, Y U V and an unused byte, chroma already upsampled
+// to full resolution by TheoraPlayer. No color conversion has been done at that point, which is what makes
+// TH_YUVX cheaper to decode than TH_RGBX.
+//
+// The movie texture either keeps those bytes as they are and the pixel shader converts them (PSMainYUVX in
+// chathead.fx), or they are converted here while being copied into the texture. Both use BT.601 with
+// studio swing Y [16..235], U/V [16..240], and the same rounding, so the two paths look the same.
+
+// pDst gets R G B 255. Pitches in bytes. SSE2, 8 pixels at a time; the rest of a row goes through the scalar version.
+void ConvertYUVXToRGBX(const unsigned char *pSrc, int srcPitch, unsigned char *pDst, int dstPitch, int width, int height);
+
+// Plain C, same results
+void ConvertYUVXToRGBXScalar(const unsigned char *pSrc, int srcPitch, unsigned char *pDst, int dstPitch, int width, int height);
+
+#endif // __YUV_CONVERT_H__
@@ -47,6 +47,7 @@ int main(int argc, char **argv)
 	result = pSample->CPUTCreateWindowAndContext(WINDOW_TITLE, params);
     ASSERT(CPUTSUCCESS(result), "CPUT Error creating window and context.");
 
+    pSample->SetCommandLine(argc, argv);
     pSample->Create();
 
     returnCode = pSample->CPUTMessageLoop();
@@ -0,0 +1,222 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// BCFormatBench: times DirectXTex's BC compressors and decompressors on one thread and on
+// several (SetParallelThreadCount, TEX_COMPRESS_PARALLEL), the paths TextureCook and texconv
+// take when cooking textures.
+//
+//   BCFormatBench [-size <pixels>] [-runs <count>] [-threads <count>]
+//
+// The source is a generated <size> x <size> RGBA8 image (default 1024): smooth gradients with
+// noise on top and a varying alpha, so the block encoders don't take their flat-color
+// shortcuts. For BC1, BC2, BC3, BC4, BC5, BC6H and BC7 each run compresses it and decompresses
+// the result, once with one thread and once with -threads (default: one per hardware thread).
+// The report has MPix/s for each format and direction (best of the runs, default 3) and the
+// speedup. The blocks and pixels written with several threads have to be the same as with one.
+//
+// Compress only uses threads with TEX_COMPRESS_PARALLEL; Decompress and Convert only after
+// SetParallelThreadCount() was given a count above 1, which this bench does for its
+// multithreaded pass.
+//
+// BCFormatBench.vcxproj builds it against DirectXTex_Desktop_2012.vcxproj.
+
+#include "DirectXTex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+using namespace DirectX;
+
+struct BenchFormat
+{
+    DXGI_FORMAT mFormat;
+    DXGI_FORMAT mDecompressedFormat;
+    const char *mpName;
+};
+
+static const BenchFormat gFormats[] =
+{
+    { DXGI_FORMAT_BC1_UNORM,     DXGI_FORMAT_R8G8B8A8_UNORM,     "BC1" },
+    { DXGI_FORMAT_BC2_UNORM,     DXGI_FORMAT_R8G8B8A8_UNORM,     "BC2" },
+    { DXGI_FORMAT_BC3_UNORM,     DXGI_FORMAT_R8G8B8A8_UNORM,     "BC3" },
+    { DXGI_FORMAT_BC4_UNORM,     DXGI_FORMAT_R8G8B8A8_UNORM,     "BC4" },
+    { DXGI_FORMAT_BC5_UNORM,     DXGI_FORMAT_R8G8B8A8_UNORM,     "BC5" },
+    { DXGI_FORMAT_BC6H_UF16,     DXGI_FORMAT_R16G16B16A16_FLOAT, "BC6H" },
+    { DXGI_FORMAT_BC7_UNORM,     DXGI_FORMAT_R8G8B8A8_UNORM,     "BC7" },
+};
+
+//-----------------------------------------------------------------------------
+static double NowUs()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------------------------------------
+static uint32_t Hash(uint32_t value)
+{
+    value ^= value >> 16;
+    value *= 0x7feb352d;
+    value ^= value >> 15;
+    value *= 0x846ca68b;
+    value ^= value >> 16;
+    return value;
+}
+
+//-----------------------------------------------------------------------------
+static bool MakeSourceImage(size_t size, ScratchImage &image)
+{
+    if (FAILED(image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, 1, 1)))
+    {
+        return false;
+    }
+    const Image *pImage = image.GetImage(0, 0, 0);
+    for (size_t yy = 0; yy < size; yy++)
+    {
+        uint8_t *pRow = pImage->pixels + yy * pImage->rowPitch;
+        for (size_t xx = 0; xx < size; xx++)
+        {
+            const uint32_t noise = Hash((uint32_t)(yy * size + xx));
+            pRow[xx * 4 + 0] = (uint8_t)((xx * 255 / size + (noise & 15)) & 0xff);
+            pRow[xx * 4 + 1] = (uint8_t)((yy * 255 / size + ((noise >> 4) & 15)) & 0xff);
+            pRow[xx * 4 + 2] = (uint8_t)(((xx + yy) * 127 / size + ((noise >> 8) & 31)) & 0xff);
+            pRow[xx * 4 + 3] = (uint8_t)(((xx ^ yy) & 64) ? 255 : (yy * 255 / size));
+        }
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+static bool SameImage(const ScratchImage &first, const ScratchImage &second)
+{
+    return first.GetPixelsSize() == second.GetPixelsSize() &&
+           !memcmp(first.GetPixels(), second.GetPixels(), first.GetPixelsSize());
+}
+
+//-----------------------------------------------------------------------------
+// Compresses and decompresses the source runCount times with the current thread count and
+// keeps the best time of each. The images of the last run are left in compressed and
+// decompressed.
+static bool TimeFormat(const Image &source, const BenchFormat &format, DWORD compressFlags, int runCount,
+                       double *pCompressUs, double *pDecompressUs, ScratchImage &compressed, ScratchImage &decompressed)
+{
+    *pCompressUs = *pDecompressUs = 0.0;
+    for (int run = 0; run < runCount; run++)
+    {
+        compressed.Release();
+        decompressed.Release();
+
+        double start = NowUs();
+        if (FAILED(Compress(source, format.mFormat, compressFlags, 0.5f, compressed)))
+        {
+            printf("FAILED: %s compress\n", format.mpName);
+            return false;
+        }
+        double elapsed = NowUs() - start;
+        *pCompressUs = run ? std::min(*pCompressUs, elapsed) : elapsed;
+
+        start = NowUs();
+        if (FAILED(Decompress(*compressed.GetImage(0, 0, 0), format.mDecompressedFormat, decompressed)))
+        {
+            printf("FAILED: %s decompress\n", format.mpName);
+            return false;
+        }
+        elapsed = NowUs() - start;
+        *pDecompressUs = run ? std::min(*pDecompressUs, elapsed) : elapsed;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    size_t size = 1024;
+    int runCount = 3;
+    size_t threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 2);
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-size") && ii + 1 < argc)
+        {
+            // Whole blocks, so every row of blocks is work for the threads
+            size = std::max<size_t>((size_t)atoi(argv[++ii]) & ~(size_t)3, 4);
+        }
+        else if (!strcmp(argv[ii], "-runs") && ii + 1 < argc)
+        {
+            runCount = std::max(atoi(argv[++ii]), 1);
+        }
+        else if (!strcmp(argv[ii], "-threads") && ii + 1 < argc)
+        {
+            threadCount = std::max(atoi(argv[++ii]), 2);
+        }
+        else
+        {
+            fprintf(stderr, "usage: BCFormatBench [-size <pixels>] [-runs <count>] [-threads <count>]\n");
+            return 1;
+        }
+    }
+
+    ScratchImage source;
+    if (!MakeSourceImage(size, source))
+    {
+        printf("FAILED: can't allocate a %u x %u image\n", (unsigned)size, (unsigned)size);
+        return 1;
+    }
+    const Image &sourceImage = *source.GetImage(0, 0, 0);
+    const double megaPixels = (double)size * (double)size / 1e6;
+
+    printf("%u x %u, best of %d runs, 1 vs %u threads\n\n", (unsigned)size, (unsigned)size, runCount, (unsigned)threadCount);
+    printf("format    compress MPix/s (1 / %u / speedup)    decompress MPix/s (1 / %u / speedup)\n",
+           (unsigned)threadCount, (unsigned)threadCount);
+
+    bool bSame = true;
+    for (size_t ff = 0; ff < sizeof(gFormats) / sizeof(gFormats[0]); ff++)
+    {
+        const BenchFormat &format = gFormats[ff];
+        double compressUs[2], decompressUs[2];
+        ScratchImage compressed[2], decompressed[2];
+
+        SetParallelThreadCount(1);
+        if (!TimeFormat(sourceImage, format, TEX_COMPRESS_DEFAULT, runCount, &compressUs[0], &decompressUs[0],
+                        compressed[0], decompressed[0]))
+        {
+            return 1;
+        }
+        SetParallelThreadCount(threadCount);
+        if (!TimeFormat(sourceImage, format, TEX_COMPRESS_PARALLEL, runCount, &compressUs[1], &decompressUs[1],
+                        compressed[1], decompressed[1]))
+        {
+            return 1;
+        }
+
+        const bool bFormatSame = SameImage(compressed[0], compressed[1]) && SameImage(decompressed[0], decompressed[1]);
+        bSame = bSame && bFormatSame;
+        printf("%-8s  %8.2f / %8.2f / %5.2fx              %8.2f / %8.2f / %5.2fx%s\n", format.mpName,
+               megaPixels * 1e6 / compressUs[0], megaPixels * 1e6 / compressUs[1], compressUs[0] / compressUs[1],
+               megaPixels * 1e6 / decompressUs[0], megaPixels * 1e6 / decompressUs[1], decompressUs[0] / decompressUs[1],
+               bFormatSame ? "" : "  (output differs)");
+    }
+    SetParallelThreadCount(0);
+
+    if (!bSame)
+    {
+        printf("\nFAILED: the multithreaded output differs from the single-threaded output\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,283 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// ChatheadBench: runs the chathead video path of N participants end to end without cameras,
+// windows or a network. Each participant plays a .chf recording (ChatheadsNativePOC/FrameFile.h)
+// through ReplayFrameSource as fast as its frames are taken, encodes them with EncodeTransform
+// like ChatHeads::RenderChatheads, and packs the result into a video update packet the way
+// NetworkLayer::SendVideoData does. Every other participant unpacks that like
+// NetworkLayer::ProcessVideoUpdateMsg and decodes it with a DecodeTransform per sender, like
+// ChatHeads::UpdateRemoteChatheadBuffer.
+//
+//   ChatheadBench [-participants <count>] [-frames <count>] [-file <recording.chf>]
+//
+// Without -file a 640x480 recording of a synthetic head moving over a cleared background is
+// written to ChatheadBench.chf first. ChatHeads records real ones with -record <file.chf>.
+// Participants take turns on one thread, since the Media Foundation transforms are created for
+// the apartment of the thread that calls Init. At the end there are the frames per second of
+// the whole path, the encode and decode milliseconds per frame and the encoded bytes per frame.
+//
+// ChatheadBench.vcxproj builds it with FrameFile.cpp and ReplayFrameSource.cpp from
+// ChatheadsNativePOC, the VideoStreaming library and CPUTOSServicesWin.cpp; NetworkMsg.h needs
+// RakNet's include directory, but nothing of RakNet is linked.
+
+#include "ReplayFrameSource.h"
+#include "FrameFile.h"
+#include "EncodeTransform.h"
+#include "DecodeTransform.h"
+#include "NetworkMsg.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+typedef unsigned char MessageID; // RakNet::MessageID
+
+struct Participant
+{
+    ReplayFrameSource                             mSource;
+    EncodeTransform                               mEncoder;
+    std::vector<std::unique_ptr<DecodeTransform>> mDecoders;   // by sender, like ChatHeads::mDecoders
+    std::vector<uint8_t>                          mFrame;
+    uint32_t                                      mFramesDecoded;
+};
+
+//-----------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("usage: ChatheadBench [-participants <count>] [-frames <count>] [-file <recording.chf>]\n");
+}
+
+//-----------------------------------------------------------------------------
+static double Milliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//-----------------------------------------------------------------------------
+// An ellipse of noisy skin tones, foreground alpha, that sways over a zero background, so both
+// the segmented edge and the encoder's motion search have something to do.
+static bool WriteSyntheticRecording(const char *pFileName, int width, int height, int frameCount)
+{
+    FrameFileWriter writer;
+    if (!writer.Open(pFileName, width, height, 30.0, true))
+    {
+        return false;
+    }
+    std::vector<uint32_t> frame(width * height);
+    uint32_t seed = 1;
+    for (int ii = 0; ii < frameCount; ii++)
+    {
+        const float centerX = width * (0.5f + 0.1f * sinf(ii * 0.1f));
+        const float centerY = height * (0.55f + 0.03f * sinf(ii * 0.23f));
+        for (int yy = 0; yy < height; yy++)
+        {
+            for (int xx = 0; xx < width; xx++)
+            {
+                const float dx = (xx - centerX) / (width * 0.22f);
+                const float dy = (yy - centerY) / (height * 0.4f);
+                uint32_t pixel = 0;
+                if (dx * dx + dy * dy < 1.0f)
+                {
+                    seed = seed * 1664525u + 1013904223u;
+                    const uint32_t noise = seed >> 28;
+                    pixel = 0xFF000000u | (0xC0 + noise) << 16 | (0x90 + noise) << 8 | (0x70 + noise);
+                }
+                frame[yy * width + xx] = pixel;
+            }
+        }
+        if (!writer.AddFrame(reinterpret_cast<const uint8_t*>(frame.data())))
+        {
+            return false;
+        }
+    }
+    return writer.Close();
+}
+
+//-----------------------------------------------------------------------------
+// Waits for the next frame of the source and copies it, the way ChatHeads::RenderChatheads does
+static void TakeFrame(Participant &participant)
+{
+    RSAppSharedData &data = participant.mSource.mSharedData;
+    for (;;)
+    {
+        if (data.bImageUpdated && InterlockedExchange(&data.hLock, IL_LOCK) == IL_UNLOCK)
+        {
+            memcpy(participant.mFrame.data(), data.segImage.pBuffer, participant.mFrame.size());
+            data.bImageUpdated = false;
+            InterlockedExchange(&data.hLock, IL_UNLOCK);
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int participantCount = 4;
+    int frameCount = 300;
+    std::string fileName;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-participants") && ii + 1 < argc)
+        {
+            participantCount = std::max(atoi(argv[++ii]), 2);
+        }
+        else if (!strcmp(argv[ii], "-frames") && ii + 1 < argc)
+        {
+            frameCount = std::max(atoi(argv[++ii]), 1);
+        }
+        else if (!strcmp(argv[ii], "-file") && ii + 1 < argc)
+        {
+            fileName = argv[++ii];
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (fileName.empty())
+    {
+        fileName = "ChatheadBench.chf";
+        if (!WriteSyntheticRecording(fileName.c_str(), 640, 480, 120))
+        {
+            printf("%s: couldn't write the synthetic recording\n", fileName.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<std::unique_ptr<Participant>> participants;
+    for (int ii = 0; ii < participantCount; ii++)
+    {
+        participants.push_back(std::unique_ptr<Participant>(new Participant()));
+        Participant &participant = *participants.back();
+        participant.mSource.SetFile(fileName);
+        participant.mSource.SetRate(0.0);
+        if (!participant.mSource.Init())
+        {
+            printf("%s: not a recording this can play\n", fileName.c_str());
+            return 1;
+        }
+        const int width = participant.mSource.VideoWidth();
+        const int height = participant.mSource.VideoHeight();
+        participant.mFrame.resize(width * height * FrameSource::cBytesPerPixel);
+        participant.mEncoder.Init(width, height);
+        for (int jj = 0; jj < participantCount; jj++)
+        {
+            participant.mDecoders.push_back(std::unique_ptr<DecodeTransform>(new DecodeTransform()));
+        }
+        participant.mFramesDecoded = 0;
+    }
+    const int width = participants[0]->mSource.VideoWidth();
+    const int height = participants[0]->mSource.VideoHeight();
+    printf("%d participants, %d frames of %dx%d from %s\n", participantCount, frameCount, width, height, fileName.c_str());
+
+    double encodeMs = 0.0;
+    double decodeMs = 0.0;
+    uint64_t encodedBytes = 0;
+    uint32_t packetCount = 0;
+    uint32_t decodeCount = 0;
+    std::vector<uint8_t> packet;
+    const std::chrono::steady_clock::time_point benchStart = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        for (int sender = 0; sender < participantCount; sender++)
+        {
+            Participant &participant = *participants[sender];
+            TakeFrame(participant);
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            EncoderOutput etn = participant.mEncoder.EncodeData(reinterpret_cast<char*>(participant.mFrame.data()), participant.mFrame.size());
+            encodeMs += Milliseconds(start);
+            if (etn.returnCode != S_OK)
+            {
+                continue; // the encoder wants more input first
+            }
+
+            NetMsgVideoUpdate::vuheader header;
+            header.playerId = sender;
+            header.width = width;
+            header.height = height;
+            header.timestamp = etn.timestamp;
+            header.duration = etn.duration;
+            const MessageID messageId = (MessageID)ID_GAME_MESSAGE_VIDEO_UPDATE;
+            packet.resize(sizeof(messageId) + sizeof(header) + etn.numBytes);
+            memcpy(packet.data(), &messageId, sizeof(messageId));
+            memcpy(packet.data() + sizeof(messageId), &header, sizeof(header));
+            memcpy(packet.data() + sizeof(messageId) + sizeof(header), etn.pEncodedData, etn.numBytes);
+            participant.mEncoder.Unlock();
+            encodedBytes += etn.numBytes;
+            packetCount++;
+
+            for (int receiver = 0; receiver < participantCount; receiver++)
+            {
+                if (receiver == sender)
+                {
+                    continue;
+                }
+                NetMsgVideoUpdate msg;
+                const size_t headerSize = sizeof(MessageID) + sizeof(msg.header);
+                memcpy(&msg.header, packet.data() + sizeof(MessageID), sizeof(msg.header));
+                msg.pEncodedData = packet.data() + headerSize;
+                msg.sizeBytes = (unsigned int)(packet.size() - headerSize);
+
+                DecodeTransform &decoder = *participants[receiver]->mDecoders[msg.header.playerId];
+                if (!decoder.mbInitSuccess)
+                {
+                    decoder.Init(msg.header.width, msg.header.height);
+                }
+                start = std::chrono::steady_clock::now();
+                DecoderOutput dtn = decoder.DecodeData(msg.pEncodedData, msg.sizeBytes, msg.header.timestamp, msg.header.duration);
+                decodeMs += Milliseconds(start);
+                decodeCount++;
+                if (dtn.returnCode == S_OK)
+                {
+                    participants[receiver]->mFramesDecoded++;
+                }
+            }
+        }
+    }
+    const double seconds = Milliseconds(benchStart) / 1000.0;
+
+    uint32_t framesDecoded = 0;
+    for (std::unique_ptr<Participant> &participant : participants)
+    {
+        framesDecoded += participant->mFramesDecoded;
+        participant->mSource.Shutdown();
+        participant->mEncoder.Shutdown();
+        for (std::unique_ptr<DecodeTransform> &decoder : participant->mDecoders)
+        {
+            decoder->Shutdown();
+        }
+    }
+
+    const uint32_t framesEncoded = (uint32_t)frameCount * participantCount;
+    printf("%.1f frames per second per participant, %.1f for all of them\n", frameCount / seconds, framesEncoded / seconds);
+    printf("encode: %.2f ms per frame, %u of %u frames gave a packet\n", encodeMs / framesEncoded, packetCount, framesEncoded);
+    printf("decode: %.2f ms per packet, %u of %u packets gave a frame\n", decodeCount ? decodeMs / decodeCount : 0.0, framesDecoded, decodeCount);
+    printf("%.0f encoded bytes per packet, %.1f:1 against the BGRA frames\n",
+        packetCount ? (double)encodedBytes / packetCount : 0.0,
+        encodedBytes ? (double)packetCount * width * height * FrameSource::cBytesPerPixel / encodedBytes : 0.0);
+    return 0;
+}
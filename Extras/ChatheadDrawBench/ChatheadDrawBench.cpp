@@ -0,0 +1,385 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// ChatheadDrawBench: times the CPU side of drawing 4, 16 and 64 chatheads against a null
+// render device, with ChatheadRenderer (ChatheadsNativePOC/ChatheadRenderer.h) and with one
+// sprite per chathead the way ChatHeads did before it.
+//
+//   ChatheadDrawBench [-frames <count>] [-size <width> <height>]
+//
+// Each path runs -frames frames (default 2000) twice: once with a new -size frame (default
+// 320x240 BGRA) for every chathead every frame, like a call where everyone is talking, and once
+// with no new frames, which is just the submission. Nothing reaches a GPU:
+// - NullDevice is a ChatheadRenderDevice that copies frames and instances into memory, like
+//   UpdateSubresource and a mapped buffer would, and makes the calls
+//   ChatheadRenderDeviceDX11::DrawInstances makes to a NullContext
+// - LegacySprites copies each frame into its chathead's own texture in memory, like the old
+//   map/copy/unmap, and makes the calls CPUTSprite::DrawSprite made for every sprite:
+//   SetMaterialStates() and SetRenderStateBlock() with no current material, the input layout
+//   cache lookup and CPUTMeshDX11::Draw()
+// NullContext only counts the calls, so the times are this side's bookkeeping and copies plus a
+// virtual call each, not what a D3D11 runtime or driver does with them.
+//
+// It prints the microseconds per frame both ways, the context calls and draws per frame without
+// new frames, and the instance uploads with them. After each run the frames and instances in
+// memory are checked against what was last sent.
+//
+// ChatheadDrawBench.vcxproj builds it with ChatheadRenderer.cpp from ChatheadsNativePOC; no
+// graphics API is needed.
+
+#include "ChatheadRenderer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Counts what would have been ID3D11DeviceContext calls. Virtual so they aren't optimized out.
+class NullContext
+{
+public:
+    NullContext() : mCallCount(0), mDrawCount(0), mpLastState(NULL) { mLastCounts[0] = mLastCounts[1] = 0; }
+    virtual ~NullContext() {}
+
+    virtual void SetState(const void *pState) { mCallCount++; mpLastState = pState; }
+    virtual void Draw(int vertexCount, int instanceCount) { mCallCount++; mDrawCount++; mLastCounts[0] = vertexCount; mLastCounts[1] = instanceCount; }
+    virtual void *Map(std::vector<unsigned char> &buffer) { mCallCount++; return &buffer[0]; }
+    virtual void Unmap() { mCallCount++; }
+
+    long long   mCallCount;
+    long long   mDrawCount;
+    const void *mpLastState;
+    int         mLastCounts[2];
+};
+
+//-----------------------------------------------------------------------------
+// Copies rows of pSrc into pDst, row by row if the pitches differ, like ChatHeads::UploadChatheadFrame
+static void CopyRows(unsigned char *pDst, int dstRowPitch, const unsigned char *pSrc, int srcRowPitch, int width, int height)
+{
+    if (srcRowPitch == dstRowPitch && srcRowPitch == width * 4)
+    {
+        memcpy(pDst, pSrc, (size_t)srcRowPitch * height);
+        return;
+    }
+    for (int jj = 0; jj < height; jj++)
+    {
+        memcpy(pDst + (size_t)jj * dstRowPitch, pSrc + (size_t)jj * srcRowPitch, (size_t)width * 4);
+    }
+}
+
+// The instanced path's device: a texture array and an instance buffer in memory
+class NullDevice : public ChatheadRenderDevice
+{
+public:
+    NullDevice(NullContext *pContext) : mpContext(pContext), mWidth(0), mHeight(0), mSlices(0), mCreateCount(0), mInstanceUploadCount(0) {}
+
+    bool CreateFrameArray(int width, int height, int slices)
+    {
+        mWidth = width;
+        mHeight = height;
+        mSlices = slices;
+        mFrames.assign((size_t)width * height * 4 * slices, 0);
+        mCreateCount++;
+        return true;
+    }
+    bool CreateInstanceBuffer(int maxInstances)
+    {
+        mInstances.assign(maxInstances * sizeof(ChatheadInstance), 0);
+        return true;
+    }
+    void UpdateFrame(int slice, const unsigned char *pPixels, int width, int height, int rowPitch)
+    {
+        mpContext->SetState(pPixels); // UpdateSubresource
+        CopyRows(&mFrames[(size_t)slice * mWidth * mHeight * 4], mWidth * 4, pPixels, rowPitch, width, height);
+    }
+    void UpdateInstances(const ChatheadInstance *pInstances, int count)
+    {
+        memcpy(mpContext->Map(mInstances), pInstances, count * sizeof(ChatheadInstance));
+        mpContext->Unmap();
+        mInstanceUploadCount++;
+    }
+    void DrawInstances(int count)
+    {
+        // Input layout, instance buffer, index buffer, topology, VS/HS/DS/GS/PS, SRV, sampler, blend, depth, rasterizer
+        for (int ii = 0; ii < 15; ii++)
+        {
+            mpContext->SetState(this);
+        }
+        mpContext->Draw(4, count);
+    }
+    void Release() {}
+
+    const unsigned char *GetFrame(int slice) const { return &mFrames[(size_t)slice * mWidth * mHeight * 4]; }
+    const ChatheadInstance *GetInstances() const { return (const ChatheadInstance *)&mInstances[0]; }
+
+    NullContext               *mpContext;
+    std::vector<unsigned char> mFrames;
+    std::vector<unsigned char> mInstances;
+    int                        mWidth;
+    int                        mHeight;
+    int                        mSlices;
+    int                        mCreateCount;
+    int                        mInstanceUploadCount;
+};
+
+// One texture, material and sprite per chathead, drawn the way CPUTSprite::DrawSprite drew them
+class LegacySprites
+{
+public:
+    LegacySprites(NullContext *pContext, int count, int width, int height)
+        : mpContext(pContext), mWidth(width), mHeight(height), mTextures(count), mMaterials(count)
+    {
+        for (int ii = 0; ii < count; ii++)
+        {
+            mTextures[ii].assign((size_t)width * height * 4, 0);
+            mMaterials[ii] = ii;
+        }
+    }
+
+    void UpdateFrame(int index, const unsigned char *pPixels, int width, int height, int rowPitch)
+    {
+        unsigned char *pDst = (unsigned char *)mpContext->Map(mTextures[index]); // CPUT_MAP_WRITE_DISCARD
+        CopyRows(pDst, mWidth * 4, pPixels, rowPitch, width, height);
+        mpContext->Unmap();
+    }
+
+    void Draw()
+    {
+        for (size_t ii = 0; ii < mTextures.size(); ii++)
+        {
+            const void *pMaterial = &mMaterials[ii];
+            // SetMaterialStates(material, NULL): VS and HS constant buffers, resources and shaders, DS
+            // and GS shaders, PS constant buffers, resources and shader
+            for (int jj = 0; jj < 11; jj++)
+            {
+                mpContext->SetState(pMaterial);
+            }
+            // SetRenderStateBlock(block, NULL): blend, depth stencil, rasterizer, PS/VS/GS samplers
+            for (int jj = 0; jj < 6; jj++)
+            {
+                mpContext->SetState(pMaterial);
+            }
+            // CPUTInputLayoutCache::Apply: a map lookup keyed on the mesh layout and vertex shader
+            std::map<std::pair<const void *, const void *>, int>::iterator layout = mLayouts.find(std::make_pair((const void *)this, pMaterial));
+            if (layout == mLayouts.end())
+            {
+                layout = mLayouts.insert(std::make_pair(std::make_pair((const void *)this, pMaterial), (int)mLayouts.size())).first;
+            }
+            mpContext->SetState(&layout->second);
+            // CPUTMeshDX11::Draw: topology, vertex buffer, index buffer, DrawIndexed
+            for (int jj = 0; jj < 3; jj++)
+            {
+                mpContext->SetState(this);
+            }
+            mpContext->Draw(6, 1);
+        }
+    }
+
+    const unsigned char *GetFrame(int index) const { return &mTextures[index][0]; }
+
+    NullContext                                          *mpContext;
+    int                                                   mWidth;
+    int                                                   mHeight;
+    std::vector<std::vector<unsigned char> >              mTextures;
+    std::vector<int>                                      mMaterials;
+    std::map<std::pair<const void *, const void *>, int>  mLayouts;
+};
+
+struct RunResult
+{
+    double mMicrosecondsPerFrame;
+    double mCallsPerFrame;
+    double mDrawsPerFrame;
+    int    mInstanceUploads;
+    bool   mbOk;
+};
+
+static double Microseconds(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Every chathead gets its own fill, so a frame copied to the wrong slice or texture shows
+static void FillFrame(std::vector<unsigned char> *pFrame, int chathead, int run)
+{
+    memset(&(*pFrame)[0], (chathead * 31 + run * 7 + 1) & 0xFF, pFrame->size());
+}
+
+static bool FrameMatches(const unsigned char *pSlice, int slicePitch, const std::vector<unsigned char> &frame, int width, int height)
+{
+    for (int jj = 0; jj < height; jj++)
+    {
+        if (memcmp(pSlice + (size_t)jj * slicePitch, &frame[(size_t)jj * width * 4], (size_t)width * 4))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+static RunResult RunInstanced(int count, int frameCount, int width, int height, bool bNewFrames, std::vector<std::vector<unsigned char> > &frames)
+{
+    NullContext context;
+    NullDevice device(&context);
+    ChatheadRenderer renderer;
+    RunResult result;
+    result.mbOk = renderer.Init(&device, count, width, height);
+    for (int ii = 0; ii < count && result.mbOk; ii++)
+    {
+        renderer.SetRect(ii, -1.0f + (ii % 8) * 0.25f, -1.0f + (ii / 8) * 0.25f, 0.2f, 0.2f);
+        FillFrame(&frames[ii], ii, 0);
+        renderer.UpdateFrame(ii, &frames[ii][0], width, height, width * 4);
+    }
+    renderer.Draw();
+
+    const long long calls = context.mCallCount;
+    const long long draws = context.mDrawCount;
+    const int uploads = device.mInstanceUploadCount;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (int frame = 1; frame <= frameCount && result.mbOk; frame++)
+    {
+        for (int ii = 0; ii < count; ii++)
+        {
+            // Set every frame, as ChatHeads::DrawChatheadSprites does; only a change re-uploads
+            renderer.SetAlphaThreshold(ii, (ii ? 10 : 12) / 255.0f);
+            if (bNewFrames)
+            {
+                renderer.UpdateFrame(ii, &frames[ii][0], width, height, width * 4);
+            }
+        }
+        renderer.Draw();
+    }
+    result.mMicrosecondsPerFrame = Microseconds(start) / frameCount;
+    result.mCallsPerFrame = (double)(context.mCallCount - calls) / frameCount;
+    result.mDrawsPerFrame = (double)(context.mDrawCount - draws) / frameCount;
+    result.mInstanceUploads = device.mInstanceUploadCount - uploads;
+
+    for (int ii = 0; ii < count && result.mbOk; ii++)
+    {
+        const ChatheadInstance &instance = device.GetInstances()[ii];
+        if (!FrameMatches(device.GetFrame(ii), device.mWidth * 4, frames[ii], width, height)
+            || instance.slice != (float)ii || instance.rect[0] != -1.0f + (ii % 8) * 0.25f
+            || instance.uvScale[0] != 1.0f || instance.alphaThreshold != (ii ? 10 : 12) / 255.0f)
+        {
+            printf("instanced, %d chatheads: chathead %d's frame or instance is wrong\n", count, ii);
+            result.mbOk = false;
+        }
+    }
+    if (context.mLastCounts[0] != 4 || context.mLastCounts[1] != count)
+    {
+        printf("instanced, %d chatheads: last draw was %d vertices x %d instances\n", count, context.mLastCounts[0], context.mLastCounts[1]);
+        result.mbOk = false;
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+static RunResult RunSprites(int count, int frameCount, int width, int height, bool bNewFrames, std::vector<std::vector<unsigned char> > &frames)
+{
+    NullContext context;
+    LegacySprites sprites(&context, count, width, height);
+    RunResult result;
+    result.mbOk = true;
+    result.mInstanceUploads = 0;
+    for (int ii = 0; ii < count; ii++)
+    {
+        FillFrame(&frames[ii], ii, 1);
+        sprites.UpdateFrame(ii, &frames[ii][0], width, height, width * 4);
+    }
+    sprites.Draw();
+
+    const long long calls = context.mCallCount;
+    const long long draws = context.mDrawCount;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (int frame = 1; frame <= frameCount; frame++)
+    {
+        if (bNewFrames)
+        {
+            for (int ii = 0; ii < count; ii++)
+            {
+                sprites.UpdateFrame(ii, &frames[ii][0], width, height, width * 4);
+            }
+        }
+        sprites.Draw();
+    }
+    result.mMicrosecondsPerFrame = Microseconds(start) / frameCount;
+    result.mCallsPerFrame = (double)(context.mCallCount - calls) / frameCount;
+    result.mDrawsPerFrame = (double)(context.mDrawCount - draws) / frameCount;
+
+    for (int ii = 0; ii < count; ii++)
+    {
+        if (!FrameMatches(sprites.GetFrame(ii), width * 4, frames[ii], width, height))
+        {
+            printf("sprites, %d chatheads: chathead %d's texture is wrong\n", count, ii);
+            result.mbOk = false;
+        }
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int frameCount = 2000;
+    int width = 320;
+    int height = 240;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-frames") && ii + 1 < argc && atoi(argv[ii + 1]) > 0)
+        {
+            frameCount = atoi(argv[++ii]);
+        }
+        else if (!strcmp(argv[ii], "-size") && ii + 2 < argc && atoi(argv[ii + 1]) > 0 && atoi(argv[ii + 2]) > 0)
+        {
+            width = atoi(argv[++ii]);
+            height = atoi(argv[++ii]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: ChatheadDrawBench [-frames <count>] [-size <width> <height>]\n");
+            return 1;
+        }
+    }
+
+    bool ok = true;
+    const int counts[] = { 4, 16, 64 };
+    printf("%d frames of %dx%d\n", frameCount, width, height);
+    printf("%-10s %5s  %14s %14s  %12s %8s  %s\n", "", "heads", "us, no frames", "us, frames", "calls/frame", "draws", "instance uploads");
+    for (int cc = 0; cc < 3; cc++)
+    {
+        const int count = counts[cc];
+        std::vector<std::vector<unsigned char> > frames(count, std::vector<unsigned char>((size_t)width * height * 4));
+        const RunResult instancedStatic = RunInstanced(count, frameCount, width, height, false, frames);
+        const RunResult instanced = RunInstanced(count, frameCount, width, height, true, frames);
+        const RunResult spritesStatic = RunSprites(count, frameCount, width, height, false, frames);
+        const RunResult sprites = RunSprites(count, frameCount, width, height, true, frames);
+        ok = ok && instancedStatic.mbOk && instanced.mbOk && spritesStatic.mbOk && sprites.mbOk;
+
+        printf("%-10s %5d  %14.2f %14.2f  %12.1f %8.1f  %d\n", "instanced", count, instancedStatic.mMicrosecondsPerFrame, instanced.mMicrosecondsPerFrame,
+            instancedStatic.mCallsPerFrame, instancedStatic.mDrawsPerFrame, instanced.mInstanceUploads);
+        printf("%-10s %5d  %14.2f %14.2f  %12.1f %8.1f  -\n", "sprites", count, spritesStatic.mMicrosecondsPerFrame, sprites.mMicrosecondsPerFrame,
+            spritesStatic.mCallsPerFrame, spritesStatic.mDrawsPerFrame);
+    }
+    if (!ok)
+    {
+        printf("FAILED\n");
+    }
+    return ok ? 0 : 1;
+}
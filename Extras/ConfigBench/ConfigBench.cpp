@@ -0,0 +1,611 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// ConfigBench: times CPUTConfigFile (CPUT/include/CPUTConfigBlock.h) on the .scene, .set,
+// .mtl and .rs files of a media directory against the two-pass parser it replaced, kept
+// below as LegacyConfigFile, and times CPUTRawMeshData::Read on the .mdl files next to them.
+//
+//   ConfigBench [<file or directory> ...]
+//
+// Directories are searched recursively (default: Media). Every file is read into memory
+// first, so the disk is left out. Then, per extension:
+// - parse: copying a file's contents into a new buffer and parsing it, what LoadFile() does
+//   once ReadFileContents() has the file, in MB/s of file contents
+// - query: GetValueByName() of every name in every block, each value read as a float and
+//   as a string, plus a lookup of a name that isn't there per block, in microseconds per file
+// .mdl files are binary and never went through the config parser, so they only get a
+// parse column: reading every mesh out of the payload, like CPUTModel::LoadMeshes.
+// Times are the mean over passes over all files of the extension, repeated until the
+// clock's resolution doesn't matter.
+//
+// Both config parsers must find the same blocks, names and values in every file. The
+// legacy parser had room for 64 values per block and wrote past it; here it stops at 64,
+// and a block with more is reported instead of compared.
+//
+// ConfigBench.vcxproj builds it with CPUTConfigBlock.cpp, CPUTSceneCache.cpp,
+// CPUTRawMeshData.cpp and CPUTOSServicesWin.cpp; no graphics API is needed.
+
+#include "CPUTConfigBlock.h"
+#include "CPUTMesh.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef CPUT_OS_WINDOWS
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+// The parser as it was: counts the blocks in a first pass, copies every name and value
+// into a std::string, drops duplicate names with a linear search per line, and looks names
+// up with another linear search. Values are converted with sscanf.
+const int LEGACY_MAX_VALUES = 64;
+
+struct LegacyConfigEntry
+{
+    std::string szName;
+    std::string szValue;
+
+    float ValueAsFloat()
+    {
+        float fValue = 0;
+        sscanf(szValue.c_str(), "%g", &fValue);
+        return fValue;
+    }
+};
+
+struct LegacyConfigBlock
+{
+    LegacyConfigBlock() : mnValueCount(0), mbOverflow(false) {}
+
+    LegacyConfigEntry *GetValueByName(const std::string &szName)
+    {
+        static LegacyConfigEntry nullValue;
+        for (int ii = 0; ii < mnValueCount; ++ii)
+        {
+            if (mpValues[ii].szName == szName)
+            {
+                return &mpValues[ii];
+            }
+        }
+        return &nullValue;
+    }
+
+    // Adds the value unless the block has one of that name already
+    void AddValue(const char *pNameStart, const char *pNameEnd, const char *pValStart, const char *pValEnd)
+    {
+        if (mnValueCount == LEGACY_MAX_VALUES)
+        {
+            mbOverflow = true;
+            return;
+        }
+        std::string &name = mpValues[mnValueCount].szName;
+        name.assign(pNameStart, pNameEnd);
+        for (int ii = 0; ii < mnValueCount; ++ii)
+        {
+            if (!mpValues[ii].szName.compare(name))
+            {
+                return;
+            }
+        }
+        mpValues[mnValueCount++].szValue.assign(pValStart, pValEnd);
+    }
+
+    std::string       mszName;
+    LegacyConfigEntry mpValues[LEGACY_MAX_VALUES];
+    int               mnValueCount;
+    bool              mbOverflow;
+};
+
+//-----------------------------------------------------------------------------
+static bool IsWhite(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+//-----------------------------------------------------------------------------
+static void RemoveWhitespace(const char *&start, const char *&end)
+{
+    while (start < end && IsWhite(*start))
+    {
+        ++start;
+    }
+    while (end > start && IsWhite(*(end - 1)))
+    {
+        --end;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static bool ReadLine(const char **ppStart, const char **ppEnd, const char **ppCur)
+{
+    const char *pCur = *ppCur;
+    if (!*pCur)
+    {
+        return false;
+    }
+    while (*pCur == ' ' || *pCur == '\t')
+    {
+        ++pCur;
+    }
+    *ppStart = pCur;
+    const char *pEnd = pCur;
+    for (;;)
+    {
+        char ch = *pCur++;
+        if (!ch)
+        {
+            --pCur;
+            break;
+        }
+        else if (ch == '\n')
+        {
+            break;
+        }
+        else if (!IsWhite(ch))
+        {
+            pEnd = pCur;
+        }
+    }
+    *ppEnd = pEnd;
+    *ppCur = pCur;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+static const char *FindFirst(const char *start, const char *end, char ch)
+{
+    const char *p = start;
+    while (p < end && *p != ch)
+    {
+        ++p;
+    }
+    return p;
+}
+
+//-----------------------------------------------------------------------------
+static const char *FindLast(const char *start, const char *end, char ch)
+{
+    const char *p = end;
+    while (--p >= start && *p != ch)
+    {
+    }
+    return p;
+}
+
+class LegacyConfigFile
+{
+public:
+    LegacyConfigFile() : mpBlocks(NULL), mnBlockCount(0) {}
+    ~LegacyConfigFile() { delete[] mpBlocks; }
+
+    // pFileContents is NUL-terminated
+    void LoadFromMemory(const char *pFileContents)
+    {
+        const char *pCur = pFileContents;
+        const char *pStart, *pEnd;
+        while (ReadLine(&pStart, &pEnd, &pCur))
+        {
+            const char *pOpen = FindFirst(pStart, pEnd, '[');
+            const char *pClose = FindLast(pOpen + 1, pEnd, ']');
+            if (pOpen < pClose)
+            {
+                mnBlockCount++;
+            }
+        }
+        if (mnBlockCount == 0)
+        {
+            mnBlockCount = 1;
+        }
+        mpBlocks = new LegacyConfigBlock[mnBlockCount];
+
+        LegacyConfigBlock *pCurrBlock = mpBlocks;
+        int nCurrBlock = 0;
+        pCur = pFileContents;
+        while (ReadLine(&pStart, &pEnd, &pCur))
+        {
+            if (FindFirst(pStart, pEnd, '#') == pStart)
+            {
+                continue;
+            }
+            const char *pOpen = FindFirst(pStart, pEnd, '[');
+            const char *pClose = FindLast(pOpen + 1, pEnd, ']');
+            if (pOpen < pClose)
+            {
+                pCurrBlock = mpBlocks + nCurrBlock++;
+                pCurrBlock->mszName.assign(pOpen + 1, pClose);
+            }
+            else if (pStart < pEnd)
+            {
+                const char *pEquals = FindFirst(pStart, pEnd, '=');
+                if (pEquals == pEnd)
+                {
+                    pCurrBlock->AddValue(pStart, pEnd, pEnd, pEnd);
+                }
+                else
+                {
+                    const char *pNameStart = pStart, *pNameEnd = pEquals;
+                    const char *pValStart = pEquals + 1, *pValEnd = pEnd;
+                    RemoveWhitespace(pNameStart, pNameEnd);
+                    RemoveWhitespace(pValStart, pValEnd);
+                    pCurrBlock->AddValue(pNameStart, pNameEnd, pValStart, pValEnd);
+                }
+            }
+        }
+    }
+
+    LegacyConfigBlock *mpBlocks;
+    int                mnBlockCount;
+};
+
+struct MediaFile
+{
+    std::string       mName;
+    std::vector<char> mContents; // NUL-terminated
+};
+
+//-----------------------------------------------------------------------------
+static std::string ExtensionOf(const std::string &fileName)
+{
+    size_t dot = fileName.find_last_of('.');
+    size_t slash = fileName.find_last_of("\\/");
+    return (dot == std::string::npos || (slash != std::string::npos && dot < slash)) ? std::string() : fileName.substr(dot);
+}
+
+//-----------------------------------------------------------------------------
+static bool IsBenchedFile(const std::string &fileName)
+{
+    const std::string extension = ExtensionOf(fileName);
+    return extension == ".scene" || extension == ".set" || extension == ".mtl" || extension == ".rs" || extension == ".mdl";
+}
+
+//-----------------------------------------------------------------------------
+static void FindFiles(const std::string &path, std::vector<std::string> *pFiles)
+{
+#ifdef CPUT_OS_WINDOWS
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        pFiles->push_back(path);
+        return;
+    }
+    WIN32_FIND_DATAA findData;
+    HANDLE hFind = FindFirstFileA((path + "\\*").c_str(), &findData);
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    do
+    {
+        std::string name = findData.cFileName;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string child = path + "\\" + name;
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            FindFiles(child, pFiles);
+        }
+        else if (IsBenchedFile(child))
+        {
+            pFiles->push_back(child);
+        }
+    } while (FindNextFileA(hFind, &findData));
+    FindClose(hFind);
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode))
+    {
+        pFiles->push_back(path);
+        return;
+    }
+    DIR *pDir = opendir(path.c_str());
+    if (!pDir)
+    {
+        return;
+    }
+    while (struct dirent *pEntry = readdir(pDir))
+    {
+        std::string name = pEntry->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string child = path + "/" + name;
+        if (stat(child.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+        {
+            FindFiles(child, pFiles);
+        }
+        else if (IsBenchedFile(child))
+        {
+            pFiles->push_back(child);
+        }
+    }
+    closedir(pDir);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+static bool ReadMediaFile(const std::string &fileName, MediaFile *pFile)
+{
+    FILE *pStream = fopen(fileName.c_str(), "rb");
+    if (!pStream)
+    {
+        return false;
+    }
+    fseek(pStream, 0, SEEK_END);
+    long size = ftell(pStream);
+    fseek(pStream, 0, SEEK_SET);
+    pFile->mName = fileName;
+    pFile->mContents.assign(size + 1, '\0');
+    bool ok = size >= 0 && fread(&pFile->mContents[0], 1, size, pStream) == (size_t)size;
+    fclose(pStream);
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+static double NowUs()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------------------------------------
+static void ParseNew(const MediaFile &file, CPUTConfigFile *pConfig)
+{
+    const UINT size = (UINT)file.mContents.size() - 1;
+    char *pContents = new char[size + 1];
+    memcpy(pContents, &file.mContents[0], size + 1);
+    pConfig->LoadFromMemory(pContents, size); // takes the buffer
+}
+
+//-----------------------------------------------------------------------------
+static void ParseOld(const MediaFile &file, LegacyConfigFile *pConfig)
+{
+    std::vector<char> contents(file.mContents);
+    pConfig->LoadFromMemory(&contents[0]);
+}
+
+//-----------------------------------------------------------------------------
+static float QueryNew(CPUTConfigFile &config)
+{
+    float sum = 0.0f;
+    for (int ii = 0; ii < config.BlockCount(); ii++)
+    {
+        CPUTConfigBlock *pBlock = config.GetBlock(ii);
+        for (int jj = 0; jj < pBlock->ValueCount(); jj++)
+        {
+            CPUTConfigEntry *pEntry = pBlock->GetValueByName(pBlock->GetValue(jj)->NameAsString());
+            sum += pEntry->ValueAsFloat() + (float)pEntry->ValueAsString().size();
+        }
+        sum += (float)pBlock->GetValueByName("notThere")->IsValid();
+    }
+    return sum;
+}
+
+//-----------------------------------------------------------------------------
+static float QueryOld(LegacyConfigFile &config)
+{
+    float sum = 0.0f;
+    for (int ii = 0; ii < config.mnBlockCount; ii++)
+    {
+        LegacyConfigBlock &block = config.mpBlocks[ii];
+        for (int jj = 0; jj < block.mnValueCount; jj++)
+        {
+            LegacyConfigEntry *pEntry = block.GetValueByName(block.mpValues[jj].szName);
+            std::string value = pEntry->szValue;
+            sum += pEntry->ValueAsFloat() + (float)value.size();
+        }
+        sum += (float)block.GetValueByName("notThere")->szName.empty();
+    }
+    return sum;
+}
+
+//-----------------------------------------------------------------------------
+static UINT ParseModel(const MediaFile &file)
+{
+    CPUTFileSystem::CPUTmemifstream stream(&file.mContents[0], (uint64_t)(file.mContents.size() - 1));
+    UINT vertexCount = 0;
+    while (stream.good() && !stream.eof())
+    {
+        CPUTRawMeshData mesh;
+        if (!mesh.Read(stream))
+        {
+            break;
+        }
+        vertexCount += mesh.mVertexCount;
+    }
+    return vertexCount;
+}
+
+// Both parsers have to agree on everything in the file. Returns the number of differences.
+//-----------------------------------------------------------------------------
+static int Compare(const MediaFile &file)
+{
+    CPUTConfigFile newConfig;
+    LegacyConfigFile oldConfig;
+    ParseNew(file, &newConfig);
+    ParseOld(file, &oldConfig);
+    if (newConfig.BlockCount() != oldConfig.mnBlockCount)
+    {
+        printf("%s: %d blocks, the legacy parser found %d\n", file.mName.c_str(), newConfig.BlockCount(), oldConfig.mnBlockCount);
+        return 1;
+    }
+    int differences = 0;
+    for (int ii = 0; ii < oldConfig.mnBlockCount; ii++)
+    {
+        CPUTConfigBlock *pBlock = newConfig.GetBlock(ii);
+        LegacyConfigBlock &block = oldConfig.mpBlocks[ii];
+        if (block.mbOverflow)
+        {
+            printf("%s: block [%s] has %d values, more than the legacy parser could hold\n", file.mName.c_str(), pBlock->GetName().c_str(), pBlock->ValueCount());
+            continue;
+        }
+        if (pBlock->GetName() != block.mszName || pBlock->ValueCount() != block.mnValueCount)
+        {
+            printf("%s: block %d is [%s] with %d values, the legacy parser has [%s] with %d\n", file.mName.c_str(), ii,
+                pBlock->GetName().c_str(), pBlock->ValueCount(), block.mszName.c_str(), block.mnValueCount);
+            differences++;
+            continue;
+        }
+        for (int jj = 0; jj < block.mnValueCount; jj++)
+        {
+            CPUTConfigEntry *pEntry = pBlock->GetValue(jj);
+            if (pEntry->NameAsString() != block.mpValues[jj].szName || pEntry->ValueAsString() != block.mpValues[jj].szValue ||
+                pBlock->GetValueByName(block.mpValues[jj].szName) != pEntry)
+            {
+                printf("%s: [%s] value %d is %s = %s, the legacy parser has %s = %s\n", file.mName.c_str(), block.mszName.c_str(), jj,
+                    pEntry->NameAsCString(), pEntry->ValueAsCString(), block.mpValues[jj].szName.c_str(), block.mpValues[jj].szValue.c_str());
+                differences++;
+            }
+        }
+    }
+    return differences;
+}
+
+// Microseconds per pass over the files of one of the steps
+//-----------------------------------------------------------------------------
+enum Step { STEP_PARSE_OLD, STEP_PARSE_NEW, STEP_QUERY_OLD, STEP_QUERY_NEW, STEP_PARSE_MODEL };
+
+static double TimeStep(const std::vector<const MediaFile *> &files, Step step)
+{
+    std::vector<CPUTConfigFile *> newConfigs;
+    std::vector<LegacyConfigFile *> oldConfigs;
+    for (size_t ii = 0; ii < files.size(); ii++)
+    {
+        if (step == STEP_QUERY_NEW)
+        {
+            newConfigs.push_back(new CPUTConfigFile());
+            ParseNew(*files[ii], newConfigs.back());
+        }
+        else if (step == STEP_QUERY_OLD)
+        {
+            oldConfigs.push_back(new LegacyConfigFile());
+            ParseOld(*files[ii], oldConfigs.back());
+        }
+    }
+
+    volatile float sink = 0.0f;
+    int runs = 0;
+    const double start = NowUs();
+    double elapsed = 0.0;
+    do
+    {
+        for (size_t ii = 0; ii < files.size(); ii++)
+        {
+            switch (step)
+            {
+            case STEP_PARSE_OLD: { LegacyConfigFile config; ParseOld(*files[ii], &config); break; }
+            case STEP_PARSE_NEW: { CPUTConfigFile config; ParseNew(*files[ii], &config); break; }
+            case STEP_QUERY_OLD: sink = sink + QueryOld(*oldConfigs[ii]); break;
+            case STEP_QUERY_NEW: sink = sink + QueryNew(*newConfigs[ii]); break;
+            case STEP_PARSE_MODEL: sink = sink + (float)ParseModel(*files[ii]); break;
+            }
+        }
+        runs++;
+        elapsed = NowUs() - start;
+    } while (elapsed < 200000.0 && runs < 100000);
+
+    for (size_t ii = 0; ii < newConfigs.size(); ii++)
+    {
+        delete newConfigs[ii];
+    }
+    for (size_t ii = 0; ii < oldConfigs.size(); ii++)
+    {
+        delete oldConfigs[ii];
+    }
+    return elapsed / runs;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    std::vector<std::string> fileNames;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (argv[ii][0] == '-')
+        {
+            fprintf(stderr, "usage: ConfigBench [<file or directory> ...]\n");
+            return 1;
+        }
+        FindFiles(argv[ii], &fileNames);
+    }
+    if (argc == 1)
+    {
+        FindFiles("Media", &fileNames);
+    }
+
+    std::vector<MediaFile> files(fileNames.size());
+    std::map<std::string, std::vector<const MediaFile *> > filesByExtension;
+    for (size_t ii = 0; ii < fileNames.size(); ii++)
+    {
+        if (!ReadMediaFile(fileNames[ii], &files[ii]))
+        {
+            printf("%s: can't read\n", fileNames[ii].c_str());
+            return 1;
+        }
+        filesByExtension[ExtensionOf(fileNames[ii])].push_back(&files[ii]);
+    }
+    if (files.empty())
+    {
+        printf("no .scene, .set, .mtl, .rs or .mdl files found\n");
+        return 1;
+    }
+
+    int differences = 0;
+    printf("%-6s %5s %9s  %11s %11s  %11s %11s\n", "", "files", "KB", "parse old", "new", "query old", "new");
+    for (std::map<std::string, std::vector<const MediaFile *> >::iterator it = filesByExtension.begin(); it != filesByExtension.end(); ++it)
+    {
+        const std::vector<const MediaFile *> &extensionFiles = it->second;
+        size_t bytes = 0;
+        for (size_t ii = 0; ii < extensionFiles.size(); ii++)
+        {
+            bytes += extensionFiles[ii]->mContents.size() - 1;
+        }
+        const double megabytes = bytes / (1024.0 * 1024.0);
+        const double fileCount = (double)extensionFiles.size();
+        printf("%-6s %5d %9.1f  ", it->first.c_str(), (int)extensionFiles.size(), bytes / 1024.0);
+        if (it->first == ".mdl")
+        {
+            printf("%11s %7.0fMB/s\n", "", megabytes / (TimeStep(extensionFiles, STEP_PARSE_MODEL) * 1e-6));
+            continue;
+        }
+        for (size_t ii = 0; ii < extensionFiles.size(); ii++)
+        {
+            differences += Compare(*extensionFiles[ii]);
+        }
+        const double parseOld = megabytes / (TimeStep(extensionFiles, STEP_PARSE_OLD) * 1e-6);
+        const double parseNew = megabytes / (TimeStep(extensionFiles, STEP_PARSE_NEW) * 1e-6);
+        const double queryOld = TimeStep(extensionFiles, STEP_QUERY_OLD) / fileCount;
+        const double queryNew = TimeStep(extensionFiles, STEP_QUERY_NEW) / fileCount;
+        printf("%7.0fMB/s %7.0fMB/s  %9.2fus %9.2fus  (%.1fx, %.1fx)\n", parseOld, parseNew, queryOld, queryNew,
+            parseNew / parseOld, queryOld / queryNew);
+    }
+
+    if (differences)
+    {
+        printf("%d blocks or values differ between the parsers\n", differences);
+        return 1;
+    }
+    return 0;
+}
@@ -415,6 +415,13 @@ namespace DirectX
             // Compress is free to use multithreading to improve performance (by default it does not use multithreading)
     };
 
+    void SetParallelThreadCount( _In_ size_t threadCount );
+    size_t GetParallelThreadCount();
+        // Threads used by Compress with TEX_COMPRESS_PARALLEL. 0 (default) uses one per hardware thread there.
+        // Decompress, Convert and the scanline passes of GenerateMipMaps stay on the calling thread unless a
+        // count above 1 is set, then they use that many on large enough images. 1 disables multithreading.
+        // Work is split into bands of rows, each thread walks its band top to bottom
+
     HRESULT Compress( _In_ const Image& srcImage, _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float alphaRef,
                       _Out_ ScratchImage& cImage );
     HRESULT Compress( _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
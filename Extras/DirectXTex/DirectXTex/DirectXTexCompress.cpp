@@ -15,11 +15,6 @@
 
 #include "directxtexp.h"
 
-#ifdef _OPENMP
-#include <omp.h>
-#pragma warning(disable : 4616 6001 6993)
-#endif
-
 #include "bc.h"
 
 
@@ -37,8 +32,9 @@ inline static DWORD _GetBCFlags( _In_ DWORD compress )
 
 
 //-------------------------------------------------------------------------------------
-static HRESULT _CompressBC( _In_ const Image& image, _In_ const Image& result, _In_ DWORD bcflags,
-                            _In_ float alphaRef, _In_ bool degenerate )
+// Compresses the rows of blocks [startRow, endRow)
+static HRESULT _CompressBCRows( _In_ const Image& image, _In_ const Image& result, _In_ DWORD bcflags,
+                                _In_ float alphaRef, _In_ bool degenerate, _In_ size_t startRow, _In_ size_t endRow )
 {
     if ( !image.pixels || !result.pixels )
         return E_POINTER;
@@ -60,7 +56,7 @@ static HRESULT _CompressBC( _In_ const Image& image, _In_ const Image& result, _
     // Round to bytes
     sbpp = ( sbpp + 7 ) / 8;
 
-    uint8_t *pDest = result.pixels;
+    uint8_t *pDest = result.pixels + startRow*result.rowPitch;
 
     // Determine BC format encoder
     BC_ENCODE pfEncode;
@@ -86,9 +82,10 @@ static HRESULT _CompressBC( _In_ const Image& image, _In_ const Image& result, _
     }
 
     XMVECTOR temp[16];
-    const uint8_t *pSrc = image.pixels;
     const size_t rowPitch = image.rowPitch;
-    for( size_t h=0; h < image.height; h += 4 )
+    const uint8_t *pSrc = image.pixels + startRow*4*rowPitch;
+    const size_t endHeight = std::min<size_t>( endRow*4, image.height );
+    for( size_t h=startRow*4; h < endHeight; h += 4 )
     {
         const uint8_t *sptr = pSrc;
         uint8_t* dptr = pDest;
@@ -160,102 +157,40 @@ static HRESULT _CompressBC( _In_ const Image& image, _In_ const Image& result, _
 
 
 //-------------------------------------------------------------------------------------
-#ifdef _OPENMP
+static HRESULT _CompressBC( _In_ const Image& image, _In_ const Image& result, _In_ DWORD bcflags,
+                            _In_ float alphaRef, _In_ bool degenerate )
+{
+    return _CompressBCRows( image, result, bcflags, alphaRef, degenerate, 0, ( image.height + 3 ) / 4 );
+}
+
+
+//-------------------------------------------------------------------------------------
 static HRESULT _CompressBC_Parallel( _In_ const Image& image, _In_ const Image& result, _In_ DWORD bcflags,
                                      _In_ float alphaRef )
 {
-    if ( !image.pixels || !result.pixels )
-        return E_POINTER;
-
     // Parallel version doesn't support degenerate case
     assert( ((image.width % 4) == 0) && ((image.height % 4) == 0 ) );
 
-    assert( image.width == result.width );
-    assert( image.height == result.height );
-
-    const DXGI_FORMAT format = image.format;
-    size_t sbpp = BitsPerPixel( format );
-    if ( !sbpp )
-        return E_FAIL;
-
-    if ( sbpp < 8 )
-    {
-        // We don't support compressing from monochrome (DXGI_FORMAT_R1_UNORM)
-        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
-    }
-
-    // Round to bytes
-    sbpp = ( sbpp + 7 ) / 8;
-
-    // Determine BC format encoder
-    BC_ENCODE pfEncode;
-    size_t blocksize;
-    switch(result.format)
+    // BC6H/BC7 are slow enough per block that small bands are worth a thread, the others need many more blocks
+    // to pay for it
+    size_t minBlocks;
+    switch( result.format )
     {
-    case DXGI_FORMAT_BC1_UNORM:
-    case DXGI_FORMAT_BC1_UNORM_SRGB:    pfEncode = nullptr;         blocksize = 8;   break;
-    case DXGI_FORMAT_BC2_UNORM:
-    case DXGI_FORMAT_BC2_UNORM_SRGB:    pfEncode = D3DXEncodeBC2;   blocksize = 16;  break;
-    case DXGI_FORMAT_BC3_UNORM:
-    case DXGI_FORMAT_BC3_UNORM_SRGB:    pfEncode = D3DXEncodeBC3;   blocksize = 16;  break;
-    case DXGI_FORMAT_BC4_UNORM:         pfEncode = D3DXEncodeBC4U;  blocksize = 8;   break;
-    case DXGI_FORMAT_BC4_SNORM:         pfEncode = D3DXEncodeBC4S;  blocksize = 8;   break;
-    case DXGI_FORMAT_BC5_UNORM:         pfEncode = D3DXEncodeBC5U;  blocksize = 16;  break;
-    case DXGI_FORMAT_BC5_SNORM:         pfEncode = D3DXEncodeBC5S;  blocksize = 16;  break;
-    case DXGI_FORMAT_BC6H_UF16:         pfEncode = D3DXEncodeBC6HU; blocksize = 16;  break;
-    case DXGI_FORMAT_BC6H_SF16:         pfEncode = D3DXEncodeBC6HS; blocksize = 16;  break;
+    case DXGI_FORMAT_BC6H_UF16:
+    case DXGI_FORMAT_BC6H_SF16:
     case DXGI_FORMAT_BC7_UNORM:
-    case DXGI_FORMAT_BC7_UNORM_SRGB:    pfEncode = D3DXEncodeBC7;   blocksize = 16;  break;
-    default:
-        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
-    }
-
-    // Refactored version of loop to support parallel independance
-    const size_t nBlocks = std::max<size_t>(1, image.width / 4) * std::max<size_t>(1, image.height / 4);
-
-    bool fail = false;
-
-#pragma omp parallel for
-    for( int nb=0; nb < static_cast<int>( nBlocks ); ++nb )
-    {
-        const size_t nbWidth = std::max<size_t>(1, image.width / 4);
-
-        const size_t y = nb / nbWidth;
-        const size_t x = nb - (y*nbWidth);
-
-        assert( x < image.width && y < image.height );
-
-        size_t rowPitch = image.rowPitch;
-        const uint8_t *pSrc = image.pixels + (y*4*rowPitch) + (x*4*sbpp);
-
-        uint8_t *pDest = result.pixels + (nb*blocksize);
-
-        XMVECTOR temp[16];
-        if ( !_LoadScanline( &temp[0], 4, pSrc, rowPitch, format ) )
-            fail = true;
-
-        if ( !_LoadScanline( &temp[4], 4, pSrc + rowPitch, rowPitch, format ) )
-            fail = true;
-
-        if ( !_LoadScanline( &temp[8], 4, pSrc + rowPitch*2, rowPitch, format ) )
-            fail = true;
-
-        if ( !_LoadScanline( &temp[12], 4, pSrc + rowPitch*3, rowPitch, format ) )
-            fail = true;
-
-        _ConvertScanline( temp, 16, result.format, format, 0 );
-            
-        if ( pfEncode )
-            pfEncode( pDest, temp, bcflags );
-        else
-            D3DXEncodeBC1( pDest, temp, alphaRef, bcflags );
+    case DXGI_FORMAT_BC7_UNORM_SRGB:    minBlocks = 64;    break;
+    default:                            minBlocks = 1024;  break;
     }
+    const size_t blocksPerRow = std::max<size_t>( 1, image.width / 4 );
 
-    return (fail) ? E_FAIL : S_OK;
+    return _ParallelFor( image.height / 4, ( minBlocks + blocksPerRow - 1 ) / blocksPerRow, true,
+                         [&]( size_t startRow, size_t endRow ) -> HRESULT
+                         {
+                             return _CompressBCRows( image, result, bcflags, alphaRef, false, startRow, endRow );
+                         } );
 }
 
-#endif // _OPENMP
-
 
 //-------------------------------------------------------------------------------------
 static DXGI_FORMAT _DefaultDecompress( _In_ DXGI_FORMAT format )
@@ -306,7 +241,8 @@ static DXGI_FORMAT _DefaultDecompress( _In_ DXGI_FORMAT format )
 
 
 //-------------------------------------------------------------------------------------
-static HRESULT _DecompressBC( _In_ const Image& cImage, _In_ const Image& result )
+// Decompresses the rows of blocks [startRow, endRow)
+static HRESULT _DecompressBCRows( _In_ const Image& cImage, _In_ const Image& result, _In_ size_t startRow, _In_ size_t endRow )
 {
     if ( !cImage.pixels || !result.pixels )
         return E_POINTER;
@@ -343,9 +279,7 @@ static HRESULT _DecompressBC( _In_ const Image& cImage, _In_ const Image& result
     // Round to bytes
     dbpp = ( dbpp + 7 ) / 8;
 
-    uint8_t *pDest = result.pixels;
-    if ( !pDest )
-        return E_POINTER;
+    uint8_t *pDest = result.pixels + startRow*4*result.rowPitch;
 
     // Promote "typeless" BC formats
     DXGI_FORMAT cformat;
@@ -385,9 +319,10 @@ static HRESULT _DecompressBC( _In_ const Image& cImage, _In_ const Image& result
     }
 
     XMVECTOR temp[16];
-    const uint8_t *pSrc = cImage.pixels;
+    const uint8_t *pSrc = cImage.pixels + startRow*cImage.rowPitch;
     const size_t rowPitch = result.rowPitch;
-    for( size_t h=0; h < cImage.height; h += 4 )
+    const size_t endHeight = std::min<size_t>( endRow*4, cImage.height );
+    for( size_t h=startRow*4; h < endHeight; h += 4 )
     {
         const uint8_t *sptr = pSrc;
         uint8_t* dptr = pDest;
@@ -426,6 +361,21 @@ static HRESULT _DecompressBC( _In_ const Image& cImage, _In_ const Image& result
 }
 
 
+//-------------------------------------------------------------------------------------
+static HRESULT _DecompressBC( _In_ const Image& cImage, _In_ const Image& result )
+{
+    // Decoding is cheap, only split up images with a good number of blocks per band
+    const size_t MIN_BLOCKS = 4096;
+    const size_t blocksPerRow = std::max<size_t>( 1, ( cImage.width + 3 ) / 4 );
+
+    return _ParallelFor( ( cImage.height + 3 ) / 4, ( MIN_BLOCKS + blocksPerRow - 1 ) / blocksPerRow, false,
+                         [&]( size_t startRow, size_t endRow ) -> HRESULT
+                         {
+                             return _DecompressBCRows( cImage, result, startRow, endRow );
+                         } );
+}
+
+
 //=====================================================================================
 // Entry-points
 //=====================================================================================
@@ -475,11 +425,7 @@ HRESULT Compress( const Image& srcImage, DXGI_FORMAT format, DWORD compress, flo
     // Compress single image
     if ( (compress & TEX_COMPRESS_PARALLEL) && !degenerate )
     {
-#ifndef _OPENMP
-        return E_NOTIMPL;
-#else
         hr = _CompressBC_Parallel( srcImage, *img, _GetBCFlags( compress ), alphaRef );
-#endif // _OPENMP
     }
     else
     {
@@ -556,19 +502,12 @@ HRESULT Compress( const Image* srcImages, size_t nimages, const TexMetadata& met
 
         if ( (compress & TEX_COMPRESS_PARALLEL) && !degenerate)
         {
-#ifndef _OPENMP
-            return E_NOTIMPL;
-#else
-            if ( compress & TEX_COMPRESS_PARALLEL )
+            hr = _CompressBC_Parallel( src, dest[ index ], _GetBCFlags( compress ), alphaRef );
+            if ( FAILED(hr) )
             {
-                hr = _CompressBC_Parallel( src, dest[ index ], _GetBCFlags( compress ), alphaRef );
-                if ( FAILED(hr) )
-                {
-                    cImages.Release();
-                    return  hr;
-                }
+                cImages.Release();
+                return  hr;
             }
-#endif // _OPENMP
         }
         else
         {
@@ -1439,6 +1439,18 @@ bool _StoreScanline( LPVOID pDestination, size_t size, DXGI_FORMAT format,
 }
 
 
+//-------------------------------------------------------------------------------------
+// Minimum rows per band for the multithreaded scanline loops. Conversion is cheap per
+// pixel, so a band has to be fairly big before it is worth another thread
+//-------------------------------------------------------------------------------------
+static inline size_t _MinParallelRows( _In_ size_t width )
+{
+    const size_t MIN_PIXELS = 65536;
+    width = std::max<size_t>( width, 1 );
+    return ( MIN_PIXELS + width - 1 ) / width;
+}
+
+
 //-------------------------------------------------------------------------------------
 // Convert DXGI image to/from GUID_WICPixelFormat128bppRGBAFloat (no range conversions)
 //-------------------------------------------------------------------------------------
@@ -1466,17 +1478,24 @@ HRESULT _ConvertToR32G32B32A32( const Image& srcImage, ScratchImage& image )
         return E_POINTER;
     }
 
-    const uint8_t *pSrc = srcImage.pixels;
-    for( size_t h = 0; h < srcImage.height; ++h )
+    hr = _ParallelFor( srcImage.height, _MinParallelRows( srcImage.width ), false, [&]( size_t startRow, size_t endRow ) -> HRESULT
     {
-        if ( !_LoadScanline( reinterpret_cast<XMVECTOR*>(pDest), srcImage.width, pSrc, srcImage.rowPitch, srcImage.format ) )
+        const uint8_t *pSrc = srcImage.pixels + startRow*srcImage.rowPitch;
+        uint8_t *pRow = pDest + startRow*img->rowPitch;
+        for( size_t h = startRow; h < endRow; ++h )
         {
-            image.Release();
-            return E_FAIL;
-        }
+            if ( !_LoadScanline( reinterpret_cast<XMVECTOR*>(pRow), srcImage.width, pSrc, srcImage.rowPitch, srcImage.format ) )
+                return E_FAIL;
 
-        pSrc += srcImage.rowPitch;
-        pDest += img->rowPitch;
+            pSrc += srcImage.rowPitch;
+            pRow += img->rowPitch;
+        }
+        return S_OK;
+    } );
+    if ( FAILED(hr) )
+    {
+        image.Release();
+        return hr;
     }
 
     return S_OK;
@@ -1493,19 +1512,21 @@ HRESULT _ConvertFromR32G32B32A32( const Image& srcImage, const Image& destImage
     if ( srcImage.width != destImage.width || srcImage.height != destImage.height )
         return E_FAIL;
 
-    const uint8_t *pSrc = srcImage.pixels;
-    uint8_t* pDest = destImage.pixels;
-
-    for( size_t h = 0; h < srcImage.height; ++h )
+    return _ParallelFor( srcImage.height, _MinParallelRows( srcImage.width ), false, [&]( size_t startRow, size_t endRow ) -> HRESULT
     {
-        if ( !_StoreScanline( pDest, destImage.rowPitch, destImage.format, reinterpret_cast<const XMVECTOR*>(pSrc), srcImage.width ) )
-            return E_FAIL;
+        const uint8_t *pSrc = srcImage.pixels + startRow*srcImage.rowPitch;
+        uint8_t* pDest = destImage.pixels + startRow*destImage.rowPitch;
 
-        pSrc += srcImage.rowPitch;
-        pDest += destImage.rowPitch;
-    }
+        for( size_t h = startRow; h < endRow; ++h )
+        {
+            if ( !_StoreScanline( pDest, destImage.rowPitch, destImage.format, reinterpret_cast<const XMVECTOR*>(pSrc), srcImage.width ) )
+                return E_FAIL;
 
-    return S_OK;
+            pSrc += srcImage.rowPitch;
+            pDest += destImage.rowPitch;
+        }
+        return S_OK;
+    } );
 }
 
 _Use_decl_annotations_
@@ -2227,30 +2248,35 @@ static HRESULT _Convert( _In_ const Image& srcImage, _In_ DWORD filter, _In_ con
     assert( srcImage.width == destImage.width );
     assert( srcImage.height == destImage.height );
 
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*srcImage.width), 16 ) ) );
-    if ( !scanline )
-        return E_OUTOFMEMORY;
-
-    const uint8_t *pSrc = srcImage.pixels;
-    uint8_t *pDest = destImage.pixels;
-    if ( !pSrc || !pDest )
+    if ( !srcImage.pixels || !destImage.pixels )
         return E_POINTER;
 
-    for( size_t h = 0; h < srcImage.height; ++h )
+    return _ParallelFor( srcImage.height, _MinParallelRows( srcImage.width ), false, [&]( size_t startRow, size_t endRow ) -> HRESULT
     {
-        if ( !_LoadScanline( scanline.get(), srcImage.width, pSrc, srcImage.rowPitch, srcImage.format ) )
-            return E_FAIL;
+        // Each band has its own scanline buffer
+        ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*srcImage.width), 16 ) ) );
+        if ( !scanline )
+            return E_OUTOFMEMORY;
 
-        _ConvertScanline( scanline.get(), srcImage.width, destImage.format, srcImage.format, filter );
+        const uint8_t *pSrc = srcImage.pixels + startRow*srcImage.rowPitch;
+        uint8_t *pDest = destImage.pixels + startRow*destImage.rowPitch;
 
-        if ( !_StoreScanline( pDest, destImage.rowPitch, destImage.format, scanline.get(), srcImage.width ) )
-            return E_FAIL;
+        for( size_t h = startRow; h < endRow; ++h )
+        {
+            if ( !_LoadScanline( scanline.get(), srcImage.width, pSrc, srcImage.rowPitch, srcImage.format ) )
+                return E_FAIL;
 
-        pSrc += srcImage.rowPitch;
-        pDest += destImage.rowPitch;
-    }
+            _ConvertScanline( scanline.get(), srcImage.width, destImage.format, srcImage.format, filter );
 
-    return S_OK;
+            if ( !_StoreScanline( pDest, destImage.rowPitch, destImage.format, scanline.get(), srcImage.width ) )
+                return E_FAIL;
+
+            pSrc += srcImage.rowPitch;
+            pDest += destImage.rowPitch;
+        }
+
+        return S_OK;
+    } );
 }
 
 
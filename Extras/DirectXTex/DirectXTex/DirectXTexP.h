@@ -30,6 +30,7 @@
 #include <assert.h>
 
 #include <malloc.h>
+#include <functional>
 #include <memory>
 
 #include <vector>
@@ -127,6 +128,15 @@ namespace DirectX
                            _In_ const TexMetadata& metadata, _In_ DWORD cpFlags,
                            _Out_writes_(nImages) Image* images, _In_ size_t nImages );
 
+    //---------------------------------------------------------------------------------
+    // Multithreading helper
+    //   Splits [0,count) into bands of at least minBandSize rows and runs job( begin, end ) on each of them,
+    //   using up to GetParallelThreadCount() threads (including the calling one). requested is true when the
+    //   caller's flags asked for threads (TEX_COMPRESS_PARALLEL); otherwise only a count set with
+    //   SetParallelThreadCount() is used. No new bands are started after a job fails; the first failure is returned
+    HRESULT _ParallelFor( _In_ size_t count, _In_ size_t minBandSize, _In_ bool requested,
+                          _In_ const std::function<HRESULT(size_t, size_t)>& job );
+
     //---------------------------------------------------------------------------------
     // Conversion helper functions
 
@@ -15,6 +15,13 @@
 
 #include "directxtexp.h"
 
+// std::thread needs VS 2012 or later; older toolsets run everything on the calling thread
+#if !defined(_MSC_VER) || (_MSC_VER >= 1700)
+#include <atomic>
+#include <thread>
+#define DXTEX_STD_THREAD
+#endif
+
 //-------------------------------------------------------------------------------------
 // WIC Pixel Format Translation Data
 //-------------------------------------------------------------------------------------
@@ -676,6 +683,96 @@ DXGI_FORMAT MakeTypelessFLOAT( DXGI_FORMAT fmt )
 }
 
 
+//=====================================================================================
+// Multithreading
+//=====================================================================================
+
+static size_t g_ParallelThreadCount = 0;
+
+_Use_decl_annotations_
+void SetParallelThreadCount( size_t threadCount )
+{
+    g_ParallelThreadCount = threadCount;
+}
+
+size_t GetParallelThreadCount()
+{
+#ifdef DXTEX_STD_THREAD
+    if ( g_ParallelThreadCount )
+        return g_ParallelThreadCount;
+
+    size_t count = std::thread::hardware_concurrency();
+    return ( count ) ? count : 1;
+#else
+    return 1;
+#endif
+}
+
+_Use_decl_annotations_
+HRESULT _ParallelFor( size_t count, size_t minBandSize, bool requested, const std::function<HRESULT(size_t, size_t)>& job )
+{
+    if ( !count )
+        return S_OK;
+
+    // Without TEX_COMPRESS_PARALLEL or a thread count from the application, stay on the calling thread
+    if ( !requested && !g_ParallelThreadCount )
+        return job( 0, count );
+
+    // A few bands per thread so threads that finish early can pick up the slack
+    size_t threads = GetParallelThreadCount();
+    size_t bandSize = ( count + threads*4 - 1 ) / ( threads*4 );
+    bandSize = std::max<size_t>( bandSize, std::max<size_t>( minBandSize, 1 ) );
+
+    const size_t bands = ( count + bandSize - 1 ) / bandSize;
+    threads = std::min<size_t>( threads, bands );
+    if ( threads <= 1 )
+        return job( 0, count );
+
+#ifdef DXTEX_STD_THREAD
+    std::atomic<size_t> nextBand( 0 );
+    std::atomic<HRESULT> result( S_OK );
+
+    auto worker = [&]()
+    {
+        for( size_t band = nextBand++; band < bands && SUCCEEDED( result.load() ); band = nextBand++ )
+        {
+            const size_t begin = band * bandSize;
+            HRESULT hr = job( begin, std::min<size_t>( begin + bandSize, count ) );
+            if ( FAILED(hr) )
+            {
+                HRESULT expected = S_OK;
+                result.compare_exchange_strong( expected, hr );
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve( threads - 1 );
+    for( size_t i = 1; i < threads; ++i )
+    {
+        try
+        {
+            pool.push_back( std::thread( worker ) );
+        }
+        catch( ... )
+        {
+            // Couldn't start another thread, the ones we have will get through all the bands
+            break;
+        }
+    }
+
+    worker();
+
+    for( size_t i = 0; i < pool.size(); ++i )
+        pool[ i ].join();
+
+    return result;
+#else
+    return job( 0, count );
+#endif
+}
+
+
 //=====================================================================================
 // TexMetadata
 //=====================================================================================
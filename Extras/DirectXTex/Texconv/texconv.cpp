@@ -39,6 +39,8 @@ enum OPTIONS    // Note: dwOptions below assumes 32 or less options.
     OPT_TYPELESS_UNORM,
     OPT_TYPELESS_FLOAT,
     OPT_PREMUL_ALPHA,
+    OPT_THREADS,
+    OPT_TIMING,
 };
 
 struct SConversion
@@ -82,6 +84,8 @@ SValue g_pOptions[] =
     { L"tu",            OPT_TYPELESS_UNORM },
     { L"tf",            OPT_TYPELESS_FLOAT },
     { L"pmalpha",       OPT_PREMUL_ALPHA },
+    { L"mt",            OPT_THREADS   },
+    { L"timing",        OPT_TIMING    },
     { nullptr,          0             }
 };
 
@@ -343,6 +347,8 @@ void PrintUsage()
     wprintf( L"   -dword              Use DWORD instead of BYTE alignment (DDS input only)\n");
     wprintf( L"   -dx10               Force use of 'DX10' extended header (DDS output only)\n");
     wprintf( L"   -nologo             suppress copyright message\n");
+    wprintf( L"   -mt <n>             compress and convert using n threads (0 for one per hardware thread)\n");
+    wprintf( L"   -timing             report compression throughput in MPix/s\n");
 
     wprintf( L"\n");
     wprintf( L"   <format>: ");
@@ -375,6 +381,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     DWORD dwSRGB = 0;
     DWORD dwFilterOpts = 0;
     DWORD FileType = CODEC_DDS;
+    DWORD dwCompress = TEX_COMPRESS_DEFAULT;
+    size_t threads = 0;
 
     WCHAR szPrefix   [MAX_PATH];
     WCHAR szSuffix   [MAX_PATH];
@@ -424,7 +432,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 && (OPT_SEPALPHA != dwOption) && (OPT_PREMUL_ALPHA != dwOption)
                 && (OPT_SRGB != dwOption) && (OPT_SRGBI != dwOption) && (OPT_SRGBO != dwOption)
                 && (OPT_HFLIP != dwOption) && (OPT_VFLIP != dwOption)
-                && (OPT_DDS_DWORD_ALIGN != dwOption) && (OPT_USE_DX10 != dwOption) )
+                && (OPT_DDS_DWORD_ALIGN != dwOption) && (OPT_USE_DX10 != dwOption)
+                && (OPT_TIMING != dwOption) )
             {
                 if(!*pValue)
                 {
@@ -531,6 +540,19 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     return 1;
                 }
                 break;
+
+            case OPT_THREADS:
+                if (swscanf_s(pValue, L"%Iu", &threads) != 1)
+                {
+                    wprintf( L"Invalid value specified with -mt (%s)\n", pValue);
+                    wprintf( L"\n");
+                    PrintUsage();
+                    return 1;
+                }
+                // An explicit count also lets conversions and decompression use the threads
+                SetParallelThreadCount( threads ? threads : GetParallelThreadCount() );
+                dwCompress |= TEX_COMPRESS_PARALLEL;
+                break;
             }
         }
         else
@@ -1014,7 +1036,10 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 goto LError;
             }
 
-            hr = Compress( img, nimg, info, tformat, TEX_COMPRESS_DEFAULT, 0.5f, *timage );
+            LARGE_INTEGER start, end, frequency;
+            QueryPerformanceCounter( &start );
+
+            hr = Compress( img, nimg, info, tformat, dwCompress, 0.5f, *timage );
             if ( FAILED(hr) )
             {
                 wprintf( L" FAILED [compress] (%x)\n", hr);
@@ -1023,6 +1048,21 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 continue;
             }
 
+            if ( dwOptions & (1 << OPT_TIMING) )
+            {
+                QueryPerformanceCounter( &end );
+                QueryPerformanceFrequency( &frequency );
+
+                size_t pixels = 0;
+                for( size_t i = 0; i < nimg; ++i )
+                    pixels += img[ i ].width * img[ i ].height;
+
+                double seconds = double( end.QuadPart - start.QuadPart ) / double( frequency.QuadPart );
+                wprintf( L"\n      compress %s: %.1f ms, %.2f MPix/s on %Iu threads", LookupByValue(tformat, g_pFormats),
+                         seconds * 1000.0, ( seconds > 0.0 ) ? double( pixels ) / seconds / 1000000.0 : 0.0,
+                         ( dwCompress & TEX_COMPRESS_PARALLEL ) ? GetParallelThreadCount() : 1 );
+            }
+
             const TexMetadata& tinfo = timage->GetMetadata();
 
             info.format = tinfo.format;
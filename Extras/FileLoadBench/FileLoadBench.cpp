@@ -0,0 +1,433 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// FileLoadBench: compares the ways CPUT reads .mdl and texture files: the std::ifstream and
+// fread paths the loaders used before CPUTFileSystem::CPUTFileView, ReadFileContents (which
+// copies out of a view), and the view itself (CPUT/include/CPUTOSServices.h).
+//
+//   FileLoadBench [-runs <count>] [-min <KB>] [-cold] [<file or directory> ...]
+//
+// Directories are searched recursively (default: Media) for .mdl, .dds, .png and .ktx files
+// of at least -min KB (default 256). Each run loads every file once per method:
+// - ifstream  .mdl: CPUTRawMeshData::Read straight from a CPUTifstream, like
+//             CPUTModel::LoadModelPayload did; textures: read whole into a new buffer
+// - fread     fopen / ftell / fread into a new buffer, the old ReadFileContents
+// - Read...   CPUTFileSystem::ReadFileContents(bLoadAsBinary)
+// - view      CPUTFileView, used in place
+// and uses what it loaded: the meshes of an .mdl are read out of it, a texture is summed
+// the way an upload would touch it. The report has MB/s per method (best and median of the
+// runs, default 10), separately for models and textures, and whether the views were mapped.
+// All methods have to produce the same sums.
+//
+// Without -cold the files are in the OS file cache after the first run, so this compares
+// the copies and system calls of each method. With -cold (not on Windows) every file is
+// dropped from the cache with posix_fadvise(POSIX_FADV_DONTNEED) before it is loaded, which
+// puts the disk back in; it drops only clean pages, so run it on files that were not just
+// written.
+//
+// FileLoadBench.vcxproj builds it with CPUTRawMeshData.cpp and CPUTOSServicesWin.cpp; no
+// graphics API is needed.
+
+#include "CPUTMesh.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifdef CPUT_OS_WINDOWS
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+enum LoadMethod { METHOD_IFSTREAM, METHOD_FREAD, METHOD_READ_FILE_CONTENTS, METHOD_VIEW, METHOD_COUNT };
+static const char *gMethodNames[METHOD_COUNT] = { "ifstream", "fread", "ReadFileContents", "view" };
+
+struct BenchFile
+{
+    std::string mName;
+    uint64_t    mSize;
+    bool        mbModel;
+};
+
+//-----------------------------------------------------------------------------
+static bool IsBenchedFile(const std::string &fileName, bool *pbModel)
+{
+    size_t dot = fileName.find_last_of('.');
+    const std::string extension = (dot == std::string::npos) ? std::string() : fileName.substr(dot);
+    *pbModel = extension == ".mdl";
+    return *pbModel || extension == ".dds" || extension == ".png" || extension == ".ktx";
+}
+
+//-----------------------------------------------------------------------------
+static void AddFile(const std::string &fileName, uint64_t size, uint64_t minSize, std::vector<BenchFile> *pFiles)
+{
+    BenchFile file;
+    file.mName = fileName;
+    file.mSize = size;
+    if (IsBenchedFile(fileName, &file.mbModel) && size >= minSize)
+    {
+        pFiles->push_back(file);
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void FindFiles(const std::string &path, uint64_t minSize, std::vector<BenchFile> *pFiles)
+{
+#ifdef CPUT_OS_WINDOWS
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes))
+    {
+        return;
+    }
+    if (!(attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        AddFile(path, ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow, 0, pFiles);
+        return;
+    }
+    WIN32_FIND_DATAA findData;
+    HANDLE hFind = FindFirstFileA((path + "\\*").c_str(), &findData);
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    do
+    {
+        std::string name = findData.cFileName;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string child = path + "\\" + name;
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            FindFiles(child, minSize, pFiles);
+        }
+        else
+        {
+            AddFile(child, ((uint64_t)findData.nFileSizeHigh << 32) | findData.nFileSizeLow, minSize, pFiles);
+        }
+    } while (FindNextFileA(hFind, &findData));
+    FindClose(hFind);
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+    {
+        return;
+    }
+    if (!S_ISDIR(info.st_mode))
+    {
+        AddFile(path, (uint64_t)info.st_size, 0, pFiles);
+        return;
+    }
+    DIR *pDir = opendir(path.c_str());
+    if (!pDir)
+    {
+        return;
+    }
+    while (struct dirent *pEntry = readdir(pDir))
+    {
+        std::string name = pEntry->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string child = path + "/" + name;
+        if (stat(child.c_str(), &info) != 0)
+        {
+            continue;
+        }
+        if (S_ISDIR(info.st_mode))
+        {
+            FindFiles(child, minSize, pFiles);
+        }
+        else
+        {
+            AddFile(child, (uint64_t)info.st_size, minSize, pFiles);
+        }
+    }
+    closedir(pDir);
+#endif
+}
+
+// Drops the file's pages from the OS file cache
+//-----------------------------------------------------------------------------
+static void EvictFile(const std::string &fileName)
+{
+#ifndef CPUT_OS_WINDOWS
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+static uint64_t SumMeshes(CPUTFileSystem::iCPUTifstream &stream)
+{
+    uint64_t sum = 0;
+    while (stream.good() && !stream.eof())
+    {
+        CPUTRawMeshData mesh;
+        if (!mesh.Read(stream))
+        {
+            break;
+        }
+        sum += mesh.mVertexCount + mesh.mIndexCount;
+    }
+    return sum;
+}
+
+// What an upload reads: every byte, a word at a time
+//-----------------------------------------------------------------------------
+static uint64_t SumBytes(const char *pData, uint64_t size)
+{
+    uint64_t sum = 0;
+    uint64_t ii = 0;
+    for (; ii + sizeof(uint64_t) <= size; ii += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, pData + ii, sizeof(word));
+        sum += word;
+    }
+    for (; ii < size; ii++)
+    {
+        sum += (unsigned char)pData[ii];
+    }
+    return sum;
+}
+
+//-----------------------------------------------------------------------------
+static uint64_t Use(const BenchFile &file, const char *pData, uint64_t size)
+{
+    if (file.mbModel)
+    {
+        CPUTFileSystem::CPUTmemifstream stream(pData, size);
+        return SumMeshes(stream);
+    }
+    return SumBytes(pData, size);
+}
+
+// Loads and uses the file, returns its sum; *pbMapped is set if a view was mapped
+//-----------------------------------------------------------------------------
+static bool Load(const BenchFile &file, LoadMethod method, uint64_t *pSum, bool *pbMapped)
+{
+    switch (method)
+    {
+    case METHOD_IFSTREAM:
+    {
+        CPUTFileSystem::CPUTifstream stream(file.mName, std::ios_base::in | std::ios_base::binary);
+        if (stream.fail())
+        {
+            return false;
+        }
+        if (file.mbModel)
+        {
+            *pSum = SumMeshes(stream);
+            return true;
+        }
+        std::vector<char> contents((size_t)file.mSize);
+        stream.read(contents.empty() ? NULL : &contents[0], (int64_t)file.mSize);
+        *pSum = Use(file, contents.empty() ? NULL : &contents[0], file.mSize);
+        return !stream.fail();
+    }
+    case METHOD_FREAD:
+    {
+        FILE *pFile = fopen(file.mName.c_str(), "rb");
+        if (!pFile)
+        {
+            return false;
+        }
+        fseek(pFile, 0, SEEK_END);
+        long size = ftell(pFile);
+        fseek(pFile, 0, SEEK_SET);
+        char *pContents = new char[size + 1];
+        bool ok = fread(pContents, 1, size, pFile) == (size_t)size;
+        fclose(pFile);
+        *pSum = Use(file, pContents, (uint64_t)size);
+        delete[] pContents;
+        return ok;
+    }
+    case METHOD_READ_FILE_CONTENTS:
+    {
+        UINT size = 0;
+        char *pContents = NULL;
+        if (CPUTFAILED(CPUTFileSystem::ReadFileContents(file.mName, &size, (void **)&pContents, false, true)))
+        {
+            return false;
+        }
+        *pSum = Use(file, pContents, size);
+        delete[] pContents;
+        return true;
+    }
+    default:
+    {
+        CPUTFileSystem::CPUTFileView view;
+        if (CPUTFAILED(view.Open(file.mName)))
+        {
+            return false;
+        }
+        *pSum = Use(file, view.GetData(), view.GetSize());
+        *pbMapped = view.IsMapped();
+        return true;
+    }
+    }
+}
+
+//-----------------------------------------------------------------------------
+static double NowSeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("usage: FileLoadBench [-runs <count>] [-min <KB>] [-cold] [<file or directory> ...]\n");
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int runCount = 10;
+    uint64_t minSize = 256 * 1024;
+    bool cold = false;
+    std::vector<std::string> paths;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-runs") && ii + 1 < argc)
+        {
+            runCount = std::max(atoi(argv[++ii]), 1);
+        }
+        else if (!strcmp(argv[ii], "-min") && ii + 1 < argc)
+        {
+            minSize = (uint64_t)std::max(atoi(argv[++ii]), 0) * 1024;
+        }
+        else if (!strcmp(argv[ii], "-cold"))
+        {
+#ifdef CPUT_OS_WINDOWS
+            printf("-cold is not supported on Windows\n");
+            return 1;
+#else
+            cold = true;
+#endif
+        }
+        else if (argv[ii][0] == '-')
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            paths.push_back(argv[ii]);
+        }
+    }
+    if (paths.empty())
+    {
+        paths.push_back("Media");
+    }
+
+    std::vector<BenchFile> files;
+    for (size_t ii = 0; ii < paths.size(); ii++)
+    {
+        FindFiles(paths[ii], minSize, &files);
+    }
+    if (files.empty())
+    {
+        printf("no .mdl, .dds, .png or .ktx files of %u KB or more found\n", (UINT)(minSize / 1024));
+        return 1;
+    }
+
+    // [models, textures]
+    uint64_t bytes[2] = { 0, 0 };
+    UINT fileCount[2] = { 0, 0 };
+    for (size_t ii = 0; ii < files.size(); ii++)
+    {
+        bytes[files[ii].mbModel ? 0 : 1] += files[ii].mSize;
+        fileCount[files[ii].mbModel ? 0 : 1]++;
+    }
+
+    std::vector<double> seconds[METHOD_COUNT][2];
+    std::vector<uint64_t> sums(files.size());
+    UINT mappedCount = 0;
+    for (int run = 0; run < runCount; run++)
+    {
+        for (int method = 0; method < METHOD_COUNT; method++)
+        {
+            double elapsed[2] = { 0.0, 0.0 };
+            for (size_t ii = 0; ii < files.size(); ii++)
+            {
+                if (cold)
+                {
+                    EvictFile(files[ii].mName);
+                }
+                uint64_t sum = 0;
+                bool mapped = false;
+                const double start = NowSeconds();
+                if (!Load(files[ii], (LoadMethod)method, &sum, &mapped))
+                {
+                    printf("%s: can't read\n", files[ii].mName.c_str());
+                    return 1;
+                }
+                elapsed[files[ii].mbModel ? 0 : 1] += NowSeconds() - start;
+
+                if (run == 0 && method == 0)
+                {
+                    sums[ii] = sum;
+                }
+                else if (sum != sums[ii])
+                {
+                    printf("%s: %s loaded something else than %s\n", files[ii].mName.c_str(), gMethodNames[method], gMethodNames[0]);
+                    return 1;
+                }
+                mappedCount += (run == 0 && mapped) ? 1 : 0;
+            }
+            seconds[method][0].push_back(elapsed[0]);
+            seconds[method][1].push_back(elapsed[1]);
+        }
+    }
+
+    printf("%u models (%.1f MB), %u textures (%.1f MB), %s, %u of %u views mapped\n", fileCount[0], bytes[0] / (1024.0 * 1024.0),
+        fileCount[1], bytes[1] / (1024.0 * 1024.0), cold ? "cold" : "warm", mappedCount, (UINT)files.size());
+    printf("%-16s %21s %21s\n", "MB/s", "models best/median", "textures best/median");
+    for (int method = 0; method < METHOD_COUNT; method++)
+    {
+        printf("%-16s", gMethodNames[method]);
+        for (int kind = 0; kind < 2; kind++)
+        {
+            std::vector<double> &times = seconds[method][kind];
+            std::sort(times.begin(), times.end());
+            if (!fileCount[kind])
+            {
+                printf(" %21s", "-");
+                continue;
+            }
+            const double megabytes = bytes[kind] / (1024.0 * 1024.0);
+            printf(" %10.0f %10.0f", megabytes / times[0], megabytes / times[times.size() / 2]);
+        }
+        printf("\n");
+    }
+    return 0;
+}
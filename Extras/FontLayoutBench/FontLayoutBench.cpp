@@ -0,0 +1,499 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// FontLayoutBench: times CPUTFont::LayoutText, which looks glyphs up in a table indexed by
+// character, kerning pairs up in a hash table and keeps the layouts of recent strings
+// (CPUT/include/CPUTFont.h), against the linear searches through the char and kerning
+// blocks it did before.
+//
+//   FontLayoutBench [-runs <count>] [-passes <count>] [-strings <count>] [-pairs <count>] [<.fnt file>]
+//
+// Without a file the bench writes a BMFont file with 95 proportional glyphs and -pairs
+// kerning pairs (default 1000, FontLayoutBench.fnt, deleted at the end). It makes -strings
+// GUI labels (default 64) of 4 to 40 characters out of the glyphs of the font, some with a
+// line feed, and lays each of them out -passes times (default 100) with:
+// - linear      a copy of the old LayoutText, searching both blocks for every character
+// - cold        LayoutText with its cache flushed before every string (SetFontScale to another
+//               scale and back), so every call builds the layout from the lookup tables
+// - warm        LayoutText with every string in the cache, so calls only write vertices
+// The report has microseconds per string and characters per microsecond (best of -runs,
+// default 5) and the speedup over linear. For every string, at scales 1 and 1.5, LayoutText
+// has to write the same vertices, width and height as the old code.
+//
+// FontLayoutBench.vcxproj builds it with CPUTFont.cpp and CPUTOSServicesWin.cpp; no graphics
+// API is needed.
+
+#include "CPUTFont.h"
+#include "CPUTControl.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+static const char *FONT_FILE_NAME = "FontLayoutBench.fnt";
+
+//-----------------------------------------------------------------------------
+static double NowUs()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------------------------------------
+static uint32_t NextRandom(uint32_t *pState)
+{
+    *pState = *pState * 1664525 + 1013904223;
+    return *pState >> 8;
+}
+
+//-----------------------------------------------------------------------------
+static void WriteBlock(FILE *pFile, unsigned char blockType, const void *pData, uint32_t blockSize)
+{
+    fwrite(&blockType, 1, 1, pFile);
+    fwrite(&blockSize, 4, 1, pFile);
+    fwrite(pData, 1, blockSize, pFile);
+}
+
+//-----------------------------------------------------------------------------
+// A BMFont version 3 binary file: a common block, 95 glyphs with their own sizes, offsets
+// and advances, and pairCount kerning pairs between them
+static bool WriteFont(const char *pFileName, uint32_t pairCount)
+{
+    FILE *pFile = fopen(pFileName, "wb");
+    if (!pFile)
+    {
+        return false;
+    }
+    fwrite("BMF\3", 1, 4, pFile);
+
+    unsigned char common[15] = { 0 };
+    const uint16_t commonValues[] = { 26, 20, 512, 512, 1 }; // line height, base, texture size, pages
+    memcpy(common, commonValues, sizeof(commonValues));
+    WriteBlock(pFile, 2, common, sizeof(common));
+
+    uint32_t random = 1;
+    std::vector<unsigned char> chars(20 * 95);
+    for (uint32_t id = 32; id < 127; id++)
+    {
+        unsigned char *pGlyph = &chars[20 * (id - 32)];
+        const uint16_t rect[] = { (uint16_t)((id % 16) * 32), (uint16_t)((id / 16) * 32),
+                                  (uint16_t)(4 + NextRandom(&random) % 16), (uint16_t)(8 + NextRandom(&random) % 18) };
+        const int16_t offsetsAndAdvance[] = { (int16_t)(NextRandom(&random) % 7 - 3), (int16_t)(NextRandom(&random) % 12),
+                                              (int16_t)(rect[2] + 1 + NextRandom(&random) % 3) };
+        memcpy(pGlyph, &id, 4);
+        memcpy(pGlyph + 4, rect, sizeof(rect));
+        memcpy(pGlyph + 12, offsetsAndAdvance, sizeof(offsetsAndAdvance));
+        pGlyph[19] = 15; // all channels
+    }
+    WriteBlock(pFile, 4, &chars[0], (uint32_t)chars.size());
+
+    if (pairCount)
+    {
+        std::vector<unsigned char> pairs(10 * pairCount);
+        for (uint32_t ii = 0; ii < pairCount; ii++)
+        {
+            const uint32_t first = 33 + NextRandom(&random) % 94;
+            const uint32_t second = 33 + NextRandom(&random) % 94;
+            const int16_t amount = (int16_t)(NextRandom(&random) % 7 - 4);
+            memcpy(&pairs[10 * ii], &first, 4);
+            memcpy(&pairs[10 * ii + 4], &second, 4);
+            memcpy(&pairs[10 * ii + 8], &amount, 2);
+        }
+        WriteBlock(pFile, 5, &pairs[0], (uint32_t)pairs.size());
+    }
+    return fclose(pFile) == 0;
+}
+
+//-----------------------------------------------------------------------------
+// The common, char and kerning blocks of a BMFont file, for the old layout code
+struct LinearFont
+{
+    BMFontCommon               mCommon;
+    std::vector<unsigned char> mChars;
+    std::vector<unsigned char> mKerningPairs;
+    uint32_t                   mNumChars;
+    uint32_t                   mNumKerningPairs;
+    float                      mFontScale;
+};
+
+//-----------------------------------------------------------------------------
+static bool ReadLinearFont(const char *pFileName, LinearFont *pFont)
+{
+    FILE *pFile = fopen(pFileName, "rb");
+    if (!pFile)
+    {
+        return false;
+    }
+    std::vector<unsigned char> data;
+    unsigned char buffer[4096];
+    size_t readSize;
+    while ((readSize = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+    {
+        data.insert(data.end(), buffer, buffer + readSize);
+    }
+    fclose(pFile);
+    if (data.size() < 4 || memcmp(&data[0], "BMF\3", 4))
+    {
+        return false;
+    }
+
+    bool bCommon = false;
+    pFont->mNumChars = pFont->mNumKerningPairs = 0;
+    pFont->mFontScale = 1.0f;
+    for (size_t pos = 4; pos + 5 <= data.size(); )
+    {
+        const unsigned char blockType = data[pos];
+        uint32_t blockSize;
+        memcpy(&blockSize, &data[pos + 1], 4);
+        pos += 5;
+        if (blockSize > data.size() - pos)
+        {
+            return false;
+        }
+        if (blockType == 2 && blockSize >= 10)
+        {
+            memset(&pFont->mCommon, 0, sizeof(pFont->mCommon));
+            memcpy(&pFont->mCommon, &data[pos], std::min<size_t>(blockSize, sizeof(pFont->mCommon)));
+            bCommon = true;
+        }
+        else if (blockType == 4)
+        {
+            pFont->mChars.assign(data.begin() + pos, data.begin() + pos + blockSize);
+            pFont->mNumChars = blockSize / 20;
+        }
+        else if (blockType == 5)
+        {
+            pFont->mKerningPairs.assign(data.begin() + pos, data.begin() + pos + blockSize);
+            pFont->mNumKerningPairs = blockSize / 10;
+        }
+        pos += blockSize;
+    }
+    return bCommon && pFont->mNumChars > 0;
+}
+
+//-----------------------------------------------------------------------------
+// CPUTFont::LayoutText before the lookup tables and the layout cache. The records are
+// read with memcpy as they aren't aligned; the strings only use characters the font has.
+static void LinearLayoutText(const LinearFont &font, CPUTGUIVertex *pVtxBuffer, int *pWidth, int *pHeight,
+                             const std::string &text, int tlx, int tly)
+{
+    int currentLine = 0;
+    int x = tlx, y = tly;
+    BMFontChars previousChar;
+    BMFontChars *pPreviousChar = NULL;
+    const float fontScale = font.mFontScale;
+    const float texWidth = (float) font.mCommon.scaleW;
+    const float texHeight = (float) font.mCommon.scaleH;
+    const float lineHeight = (float) font.mCommon.lineHeight;
+
+    *pWidth = x - tlx;
+
+    for (uint32_t j = 0, index = 0; j < text.length(); j++) {
+        int charIndex = -1;
+        for (uint32_t i = 0; i < font.mNumChars; i++) {
+            uint32_t id;
+            memcpy(&id, &font.mChars[20 * i], 4);
+            if (id == (uint32_t)text[j]) {
+                charIndex = i;
+            }
+        }
+
+        if (charIndex == -1)
+        {
+            // Handle special characters
+            switch (text[j])
+            {
+                // Line feed
+                case '\n':
+                    *pWidth = std::max(*pWidth, x - tlx);
+                    x = tlx;
+                    currentLine++;
+                    continue;
+
+                // Carriage return
+                case '\r':
+                    currentLine++;
+                    continue;
+
+                default:
+                    continue;
+            }
+        }
+
+        BMFontChars charRecord;
+        memcpy(&charRecord, &font.mChars[20 * charIndex], 20);
+        BMFontChars *pChar = &charRecord;
+
+        int kernAmount = 0;
+        if (pPreviousChar != NULL) {
+            for (uint32_t i = 0; i < font.mNumKerningPairs; i++) {
+                uint32_t first, second;
+                memcpy(&first, &font.mKerningPairs[10 * i], 4);
+                memcpy(&second, &font.mKerningPairs[10 * i + 4], 4);
+                if (first == pPreviousChar->id && second == pChar->id) {
+                    int16_t amount;
+                    memcpy(&amount, &font.mKerningPairs[10 * i + 8], 2);
+                    kernAmount = amount;
+                }
+            }
+        }
+        previousChar = charRecord;
+        pPreviousChar = &previousChar;
+
+        GUIColor fontColor;
+        fontColor.r = fontColor.a = fontColor.g = fontColor.b = 1.0f;
+
+        if(pVtxBuffer)
+        {
+            pVtxBuffer[index+0].Pos = float3((float)(x + fontScale * (0 + pChar->xoffset + kernAmount)), (float)(y + fontScale * (0 + pChar->yoffset) + lineHeight * fontScale * currentLine), 1.0f);
+            pVtxBuffer[index+0].UV    = float2(pChar->x / texWidth, pChar->y / texHeight);
+            pVtxBuffer[index+0].Color = fontColor;
+
+            pVtxBuffer[index+1].Pos = float3((float)(x + fontScale * (pChar->width + pChar->xoffset + kernAmount)), float(y + fontScale * (0 + pChar->yoffset) + lineHeight * fontScale * currentLine), 1.0f);
+            pVtxBuffer[index+1].UV    = float2((pChar->x + pChar->width) / texWidth, pChar->y / texHeight);
+            pVtxBuffer[index+1].Color = fontColor;
+
+            pVtxBuffer[index+2].Pos = float3((float)(x + fontScale * (0.0f + pChar->xoffset + kernAmount)), (float)(y + fontScale * (pChar->height + pChar->yoffset) + lineHeight * fontScale * currentLine), 1.0f);
+            pVtxBuffer[index+2].UV    = float2(pChar->x / texWidth, (pChar->y + pChar->height) / texHeight);
+            pVtxBuffer[index+2].Color = fontColor;
+
+            pVtxBuffer[index+3].Pos = float3((float)(x + fontScale * (pChar->width + pChar->xoffset + kernAmount)), (float)(y + fontScale * (0 + pChar->yoffset) + lineHeight * fontScale * currentLine), 1.0f);
+            pVtxBuffer[index+3].UV    = float2((pChar->x + pChar->width) / texWidth, pChar->y / texHeight);
+            pVtxBuffer[index+3].Color = fontColor;
+
+            pVtxBuffer[index+4].Pos = float3((float)(x + fontScale * (pChar->width + pChar->xoffset + kernAmount)), (float)(y + fontScale * (pChar->height + pChar->yoffset) + lineHeight * fontScale * currentLine), 1.0f);
+            pVtxBuffer[index+4].UV    = float2((pChar->x + pChar->width) / texWidth, (pChar->y + pChar->height) / texHeight);
+            pVtxBuffer[index+4].Color = fontColor;
+
+            pVtxBuffer[index+5].Pos = float3((float)(x + fontScale * (0 + pChar->xoffset + kernAmount)), (float)(y + fontScale * (pChar->height + pChar->yoffset) + lineHeight * fontScale * currentLine), 1.0f);
+            pVtxBuffer[index+5].UV    = float2(pChar->x / texWidth, (pChar->y + pChar->height) / texHeight);
+            pVtxBuffer[index+5].Color = fontColor;
+        }
+        x += int((pChar->xadvance + kernAmount) * fontScale);
+        index += 6;
+    }
+
+    *pWidth = std::max(*pWidth, x - tlx);
+    *pHeight = int(lineHeight * fontScale * (currentLine + 1));
+}
+
+//-----------------------------------------------------------------------------
+// Labels made of the printable characters the font has glyphs for
+static std::vector<std::string> MakeStrings(const LinearFont &font, int stringCount)
+{
+    std::string alphabet;
+    for (uint32_t ii = 0; ii < font.mNumChars; ii++)
+    {
+        uint32_t id;
+        memcpy(&id, &font.mChars[20 * ii], 4);
+        if (id >= 32 && id < 127 && alphabet.find((char)id) == std::string::npos)
+        {
+            alphabet += (char)id;
+        }
+    }
+
+    std::vector<std::string> strings;
+    uint32_t random = 7;
+    while (!alphabet.empty() && (int)strings.size() < stringCount)
+    {
+        const uint32_t length = 4 + NextRandom(&random) % 37;
+        std::string text;
+        for (uint32_t ii = 0; ii < length; ii++)
+        {
+            text += (ii > 0 && NextRandom(&random) % 32 == 0) ? '\n' : alphabet[NextRandom(&random) % alphabet.size()];
+        }
+        if (std::find(strings.begin(), strings.end(), text) == strings.end())
+        {
+            strings.push_back(text);
+        }
+    }
+    return strings;
+}
+
+//-----------------------------------------------------------------------------
+static bool SameLayouts(CPUTFont *pFont, LinearFont &linearFont, const std::vector<std::string> &strings)
+{
+    const float scales[] = { 1.0f, 1.5f };
+    std::vector<CPUTGUIVertex> linearVertices, vertices;
+    for (size_t ss = 0; ss < sizeof(scales) / sizeof(scales[0]); ss++)
+    {
+        pFont->SetFontScale(scales[ss]);
+        linearFont.mFontScale = scales[ss];
+        for (size_t ii = 0; ii < strings.size(); ii++)
+        {
+            const size_t vertexCount = strings[ii].length() * 6;
+            linearVertices.resize(vertexCount);
+            vertices.resize(vertexCount);
+            memset((void *)&linearVertices[0], 0, vertexCount * sizeof(CPUTGUIVertex));
+            memset((void *)&vertices[0], 0, vertexCount * sizeof(CPUTGUIVertex));
+
+            int linearWidth, linearHeight, width, height;
+            const int tlx = (int)(ii % 37), tly = (int)(ii % 11);
+            LinearLayoutText(linearFont, &linearVertices[0], &linearWidth, &linearHeight, strings[ii], tlx, tly);
+            pFont->LayoutText(&vertices[0], &width, &height, strings[ii], tlx, tly);
+            if (width != linearWidth || height != linearHeight ||
+                memcmp(&vertices[0], &linearVertices[0], vertexCount * sizeof(CPUTGUIVertex)))
+            {
+                printf("FAILED: layout of string %u at scale %.1f differs\n", (unsigned)ii, scales[ss]);
+                return false;
+            }
+        }
+    }
+    pFont->SetFontScale(1.0f);
+    linearFont.mFontScale = 1.0f;
+    return true;
+}
+
+enum LayoutMethod { METHOD_LINEAR, METHOD_COLD, METHOD_WARM, METHOD_COUNT };
+static const char *gMethodNames[METHOD_COUNT] = { "linear", "cold", "warm" };
+
+//-----------------------------------------------------------------------------
+static double TimeMethod(LayoutMethod method, CPUTFont *pFont, const LinearFont &linearFont,
+                         const std::vector<std::string> &strings, int passCount, CPUTGUIVertex *pVertices)
+{
+    int width, height;
+    if (method == METHOD_WARM)
+    {
+        for (size_t ii = 0; ii < strings.size(); ii++)
+        {
+            pFont->LayoutText(NULL, &width, &height, strings[ii], 0, 0);
+        }
+    }
+
+    const double start = NowUs();
+    for (int pass = 0; pass < passCount; pass++)
+    {
+        for (size_t ii = 0; ii < strings.size(); ii++)
+        {
+            if (method == METHOD_LINEAR)
+            {
+                LinearLayoutText(linearFont, pVertices, &width, &height, strings[ii], 10, 10);
+                continue;
+            }
+            if (method == METHOD_COLD)
+            {
+                pFont->SetFontScale(2.0f);
+                pFont->SetFontScale(1.0f);
+            }
+            pFont->LayoutText(pVertices, &width, &height, strings[ii], 10, 10);
+        }
+    }
+    return NowUs() - start;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int runCount = 5;
+    int passCount = 100;
+    int stringCount = 64;
+    int pairCount = 1000;
+    std::string fontFileName;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-runs") && ii + 1 < argc)
+        {
+            runCount = std::max(atoi(argv[++ii]), 1);
+        }
+        else if (!strcmp(argv[ii], "-passes") && ii + 1 < argc)
+        {
+            passCount = std::max(atoi(argv[++ii]), 1);
+        }
+        else if (!strcmp(argv[ii], "-strings") && ii + 1 < argc)
+        {
+            // The layout cache holds 256 strings; warm has to fit in it
+            stringCount = std::min(std::max(atoi(argv[++ii]), 1), 256);
+        }
+        else if (!strcmp(argv[ii], "-pairs") && ii + 1 < argc)
+        {
+            pairCount = std::max(atoi(argv[++ii]), 0);
+        }
+        else if (argv[ii][0] == '-' || !fontFileName.empty())
+        {
+            fprintf(stderr, "usage: FontLayoutBench [-runs <count>] [-passes <count>] [-strings <count>] [-pairs <count>] [<.fnt file>]\n");
+            return 1;
+        }
+        else
+        {
+            fontFileName = argv[ii];
+        }
+    }
+
+    const bool bWrittenFont = fontFileName.empty();
+    if (bWrittenFont)
+    {
+        fontFileName = FONT_FILE_NAME;
+        if (!WriteFont(FONT_FILE_NAME, (uint32_t)pairCount))
+        {
+            printf("FAILED: can't write %s\n", FONT_FILE_NAME);
+            return 1;
+        }
+    }
+
+    LinearFont linearFont;
+    CPUTFont *pFont = ReadLinearFont(fontFileName.c_str(), &linearFont) ? CPUTFont::Create("FontLayoutBench", fontFileName) : NULL;
+    if (bWrittenFont)
+    {
+        remove(FONT_FILE_NAME);
+    }
+    if (!pFont)
+    {
+        printf("FAILED: can't load %s\n", fontFileName.c_str());
+        return 1;
+    }
+
+    const std::vector<std::string> strings = MakeStrings(linearFont, stringCount);
+    size_t characterCount = 0, longest = 0;
+    for (size_t ii = 0; ii < strings.size(); ii++)
+    {
+        characterCount += strings[ii].length();
+        longest = std::max(longest, strings[ii].length());
+    }
+    if (strings.empty() || !SameLayouts(pFont, linearFont, strings))
+    {
+        if (strings.empty())
+        {
+            printf("FAILED: the font has no printable glyphs\n");
+        }
+        pFont->Release();
+        return 1;
+    }
+
+    printf("%u glyphs, %u kerning pairs; %u strings of %.1f characters on average, %d passes, best of %d runs\n\n",
+           linearFont.mNumChars, linearFont.mNumKerningPairs, (unsigned)strings.size(),
+           (double)characterCount / strings.size(), passCount, runCount);
+    printf("method     us/string    chars/us    speedup\n");
+
+    std::vector<CPUTGUIVertex> vertices(longest * 6);
+    double bestUs[METHOD_COUNT];
+    for (int method = 0; method < METHOD_COUNT; method++)
+    {
+        for (int run = 0; run < runCount; run++)
+        {
+            const double elapsed = TimeMethod((LayoutMethod)method, pFont, linearFont, strings, passCount, &vertices[0]);
+            bestUs[method] = run ? std::min(bestUs[method], elapsed) : elapsed;
+        }
+        const double layoutCount = (double)strings.size() * passCount;
+        printf("%-8s  %10.3f  %10.1f  %8.1fx\n", gMethodNames[method], bestUs[method] / layoutCount,
+               characterCount * (double)passCount / bestUs[method], bestUs[METHOD_LINEAR] / bestUs[method]);
+    }
+
+    pFont->Release();
+    return 0;
+}
@@ -0,0 +1,24 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef GLSTUB_CPUT_OGL_H
+#define GLSTUB_CPUT_OGL_H
+
+// GLStub: CPUTStreamingBufferOGL.cpp only needs GL_CHECK from CPUT_OGL.h
+#include "CPUT.h"
+
+#define GL_CHECK(x) x
+
+#endif // GLSTUB_CPUT_OGL_H
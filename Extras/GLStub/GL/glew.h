@@ -0,0 +1,72 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef GLSTUB_GLEW_H
+#define GLSTUB_GLEW_H
+
+// Stands in for glew and the GL headers where an Extras test builds CPUT code without a GL
+// SDK: the types and enums CPUT uses and entry points that do nothing. StreamingBufferTest
+// hands the streaming buffer a fake GL, so none of them is ever called; they only have to
+// link. ShaderCacheTest only needs CPUT.h to compile on Linux, where it includes GL/glew.h.
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int   GLenum;
+typedef unsigned int   GLuint;
+typedef int            GLint;
+typedef int            GLsizei;
+typedef unsigned int   GLbitfield;
+typedef unsigned char  GLboolean;
+typedef uint64_t       GLuint64;
+typedef ptrdiff_t      GLintptr;
+typedef ptrdiff_t      GLsizeiptr;
+typedef struct __GLsync *GLsync;
+
+#define GL_STREAM_DRAW                      0x88E0
+#define GL_UNIFORM_BUFFER                   0x8A11
+#define GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT  0x8A34
+#define GL_COPY_READ_BUFFER                 0x8F36
+#define GL_COPY_WRITE_BUFFER                0x8F37
+#define GL_MAP_WRITE_BIT                    0x0002
+#define GL_MAP_INVALIDATE_RANGE_BIT         0x0004
+#define GL_MAP_UNSYNCHRONIZED_BIT           0x0020
+#define GL_MAP_PERSISTENT_BIT               0x0040
+#define GL_MAP_COHERENT_BIT                 0x0080
+#define GL_SYNC_GPU_COMMANDS_COMPLETE       0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT          0x00000001
+#define GL_ALREADY_SIGNALED                 0x911A
+#define GL_CONDITION_SATISFIED              0x911C
+#define GL_WAIT_FAILED                      0x911D
+
+#define GLEW_VERSION_4_4                    false
+#define GLEW_ARB_buffer_storage             false
+
+inline void      glGenBuffers(GLsizei, GLuint *pBuffers) { *pBuffers = 0; }
+inline void      glDeleteBuffers(GLsizei, const GLuint *) {}
+inline void      glBindBuffer(GLenum, GLuint) {}
+inline void      glBufferData(GLenum, GLsizeiptr, const void *, GLenum) {}
+inline void      glBufferStorage(GLenum, GLsizeiptr, const void *, GLbitfield) {}
+inline void     *glMapBufferRange(GLenum, GLintptr, GLsizeiptr, GLbitfield) { return NULL; }
+inline GLboolean glUnmapBuffer(GLenum) { return 1; }
+inline void      glCopyBufferSubData(GLenum, GLenum, GLintptr, GLintptr, GLsizeiptr) {}
+inline void      glBindBufferBase(GLenum, GLuint, GLuint) {}
+inline void      glBindBufferRange(GLenum, GLuint, GLuint, GLintptr, GLsizeiptr) {}
+inline void      glGetIntegerv(GLenum, GLint *pData) { *pData = 0; }
+inline GLsync    glFenceSync(GLenum, GLbitfield) { return NULL; }
+inline GLenum    glClientWaitSync(GLsync, GLbitfield, GLuint64) { return GL_WAIT_FAILED; }
+inline void      glDeleteSync(GLsync) {}
+
+#endif // GLSTUB_GLEW_H
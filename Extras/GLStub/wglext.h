@@ -0,0 +1,23 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef GLSTUB_WGLEXT_H
+#define GLSTUB_WGLEXT_H
+
+// GLStub: only what CPUT.h declares
+typedef int (__stdcall *PFNWGLSWAPINTERVALEXTPROC)(int interval);
+typedef int (__stdcall *PFNWGLGETSWAPINTERVALEXTPROC)(void);
+
+#endif // GLSTUB_WGLEXT_H
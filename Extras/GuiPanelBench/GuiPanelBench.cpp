@@ -0,0 +1,358 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// GuiPanelBench: runs a settings panel through CPUTGuiController::Update() with a null render
+// device and reports how many vertices it rewrites and how many bytes it uploads per frame,
+// against drawing every control and uploading the whole buffer as Update() did before.
+//
+//   GuiPanelBench [-frames <count>]
+//
+// The panel has an FPS label, 6 sliders, 6 checkboxes, 3 dropdowns and a button. Every frame
+// the label gets a new FPS value; in frames 200-259 a slider is dragged, in frame 400 a
+// checkbox is added. It runs -frames frames (default 600) twice:
+// - ranges      NullGui uploads the ranges Update() asks for, as CPUTGuiControllerDX11 does
+// - whole       NullGui has no range uploads, so Update() sends every vertex in use each
+//               frame it changes anything, as with the OpenGL controller
+// and prints the vertices written, bytes uploaded, controls drawn and uploads per frame, and
+// the microseconds Update() took. The first frames, which lay the panel out, aren't counted.
+// The "rebuild" line is every control drawn again and the whole 5000 vertex buffer uploaded,
+// which is what every frame cost before.
+//
+// After every frame the mirror buffer has to hold what drawing every control again gives, with
+// unused vertices zeroed, and NullGui's copy of the vertex buffer has to match the mirror, so
+// the uploads covered every change. The bytes NullGui received have to be what
+// GetUpdateStats() says.
+//
+// Fonts come from BMFont files; the bench writes one with fixed size glyphs
+// (GuiPanelBench.fnt, deleted at the end) so it needs no media.
+//
+// GuiPanelBench.vcxproj builds it with CPUTGuiController.cpp, the control .cpp files,
+// CPUTFont.cpp and CPUTOSServicesWin.cpp; no graphics API is needed.
+
+#include "CPUTGuiController.h"
+#include "CPUTFont.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+static const char *FONT_FILE_NAME = "GuiPanelBench.fnt";
+static const int   LAYOUT_FRAMES = 5;
+
+//-----------------------------------------------------------------------------
+// A BMFont version 3 binary file: a common block and 95 glyphs of 8x14 pixels
+static bool WriteFont(const char *pFileName)
+{
+    FILE *pFile = fopen(pFileName, "wb");
+    if (!pFile)
+    {
+        return false;
+    }
+    fwrite("BMF\3", 1, 4, pFile);
+
+    unsigned char common[15] = { 0 };
+    const uint16_t commonValues[] = { 16, 12, 256, 256, 1 }; // line height, base, texture size, pages
+    memcpy(common, commonValues, sizeof(commonValues));
+    unsigned char blockType = 2;
+    uint32_t blockSize = sizeof(common);
+    fwrite(&blockType, 1, 1, pFile);
+    fwrite(&blockSize, 4, 1, pFile);
+    fwrite(common, 1, sizeof(common), pFile);
+
+    blockType = 4;
+    blockSize = 20 * 95;
+    fwrite(&blockType, 1, 1, pFile);
+    fwrite(&blockSize, 4, 1, pFile);
+    for (uint32_t id = 32; id < 127; id++)
+    {
+        unsigned char glyph[20] = { 0 };
+        const uint16_t rect[] = { (uint16_t)((id % 16) * 16), (uint16_t)((id / 16) * 16), 8, 14 };
+        const int16_t xAdvance = 9;
+        memcpy(glyph, &id, 4);
+        memcpy(glyph + 4, rect, sizeof(rect));
+        memcpy(glyph + 16, &xAdvance, 2);
+        fwrite(glyph, 1, sizeof(glyph), pFile);
+    }
+    return fclose(pFile) == 0;
+}
+
+// Keeps what would have gone to the GPU in mGpuVertices
+class NullGui : public CPUTGuiController
+{
+public:
+    NullGui(CPUTFont *pFont, bool bRangeUploads)
+        : mbRangeUploads(bRangeUploads), mBytesReceived(0), mGpuVertices(mBufferSize), mRebuildUpload(mBufferSize)
+    {
+        // The controller releases its font
+        pFont->AddRef();
+        mpFont = pFont;
+    }
+
+    CPUTResult Initialize(const std::string &, const std::string &) { return CPUT_SUCCESS; }
+    void Draw() {}
+
+    void SetLayoutDirty() { mRecalculate = true; }
+    UINT GetBufferSize() const { return mBufferSize; }
+    UINT TakeBytesReceived() { UINT bytes = mBytesReceived; mBytesReceived = 0; return bytes; }
+
+    // Every control drawn again into a buffer of its own, then the whole buffer uploaded, like
+    // Update() used to do every frame. Returns the vertices drawn.
+    UINT Rebuild(std::vector<CPUTGUIVertex> &buffer)
+    {
+        buffer.assign(mBufferSize, CPUTGUIVertex());
+        UINT index = 0;
+        for (size_t ii = 0; ii < mDrawOrder.size(); ii++)
+        {
+            mDrawOrder[ii]->Draw(&buffer[0], &index, mBufferSize);
+        }
+        memcpy(&mRebuildUpload[0], &buffer[0], mBufferSize * sizeof(CPUTGUIVertex));
+        return index;
+    }
+
+    // The mirror holds each control's vertices in its range, zeros after them, and the GPU copy
+    // matches it
+    bool Check(const std::vector<CPUTGUIVertex> &rebuilt, UINT rebuiltCount, int frame)
+    {
+        // float3's constructor leaves it uninitialized
+        CPUTGUIVertex zero;
+        memset(&zero, 0, sizeof(zero));
+        UINT at = 0;
+        for (size_t ii = 0; ii < mControlRanges.size(); ii++)
+        {
+            const ControlRange &range = mControlRanges[ii];
+            if (range.count > range.capacity || range.offset + range.capacity > mUberBufferIndex ||
+                memcmp(&mpMirrorBuffer[range.offset], &rebuilt[at], range.count * sizeof(CPUTGUIVertex)))
+            {
+                printf("frame %d: control %d's vertices aren't what drawing it again gives\n", frame, (int)ii);
+                return false;
+            }
+            for (UINT jj = range.count; jj < range.capacity; jj++)
+            {
+                if (memcmp(&mpMirrorBuffer[range.offset + jj], &zero, sizeof(zero)))
+                {
+                    printf("frame %d: control %d has stale vertices after its own\n", frame, (int)ii);
+                    return false;
+                }
+            }
+            at += range.count;
+        }
+        if (at != rebuiltCount)
+        {
+            printf("frame %d: %u vertices in the ranges, %u drawn\n", frame, at, rebuiltCount);
+            return false;
+        }
+        if (memcmp(&mGpuVertices[0], mpMirrorBuffer, mUberBufferIndex * sizeof(CPUTGUIVertex)))
+        {
+            printf("frame %d: the uploads missed a change\n", frame);
+            return false;
+        }
+        return true;
+    }
+
+protected:
+    void UpdateConstantBuffer() {}
+
+    // Like CPUTGuiControllerDX11: the vertices in use
+    CPUTResult UpdateUberBuffers()
+    {
+        Upload(0, mUberBufferIndex);
+        return CPUT_SUCCESS;
+    }
+
+    CPUTResult UpdateUberBufferRange(UINT firstVertex, UINT numVertices)
+    {
+        if (!mbRangeUploads)
+        {
+            return CPUT_ERROR_NOT_IMPLEMENTED;
+        }
+        Upload(firstVertex, numVertices);
+        return CPUT_SUCCESS;
+    }
+
+private:
+    void Upload(UINT firstVertex, UINT numVertices)
+    {
+        memcpy(&mGpuVertices[firstVertex], &mpMirrorBuffer[firstVertex], numVertices * sizeof(CPUTGUIVertex));
+        mBytesReceived += numVertices * sizeof(CPUTGUIVertex);
+    }
+
+    bool                       mbRangeUploads;
+    UINT                       mBytesReceived;
+    std::vector<CPUTGUIVertex> mGpuVertices;
+    std::vector<CPUTGUIVertex> mRebuildUpload;
+};
+
+struct PanelResult
+{
+    bool   mbOk;
+    double mVertices;       // per frame, like the rest
+    double mBytes;
+    double mControlsDrawn;
+    double mUploads;
+    double mUpdateUs;
+    double mRebuildVertices;
+    double mRebuildBytes;
+    double mRebuildUs;
+    int    mControls;
+    int    mRepacks;        // after the first layout
+};
+
+//-----------------------------------------------------------------------------
+static PanelResult RunPanel(CPUTFont *pFont, bool bRangeUploads, int frameCount)
+{
+    PanelResult result;
+    memset(&result, 0, sizeof(result));
+    result.mbOk = true;
+
+    NullGui gui(pFont, bRangeUploads);
+    gui.Resize(1280, 720);
+    CPUTText *pFPS = NULL;
+    gui.CreateText("FPS: 0.0", 1, 0, &pFPS);
+    std::vector<CPUTSlider *> sliders;
+    for (int ii = 0; ii < 6; ii++)
+    {
+        char name[32];
+        sprintf(name, "Slider %d", ii);
+        CPUTSlider *pSlider = NULL;
+        gui.CreateSlider(name, 10 + ii, 0, &pSlider);
+        pSlider->SetScale(0.0f, 1.0f, 11);
+        sliders.push_back(pSlider);
+    }
+    for (int ii = 0; ii < 6; ii++)
+    {
+        char name[32];
+        sprintf(name, "Checkbox option %d", ii);
+        gui.CreateCheckbox(name, 20 + ii, 0);
+    }
+    for (int ii = 0; ii < 3; ii++)
+    {
+        CPUTDropdown *pDropdown = NULL;
+        gui.CreateDropdown("Mode A", 30 + ii, 0, &pDropdown);
+        pDropdown->AddSelectionItem("Mode B");
+        pDropdown->AddSelectionItem("Mode C");
+    }
+    gui.CreateButton("Reset", 40, 0);
+    gui.SetActivePanel(0);
+
+    std::vector<CPUTGUIVertex> rebuilt;
+    double updateSeconds = 0.0, rebuildSeconds = 0.0;
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        char fps[64];
+        sprintf(fps, "FPS: %.1f", 55.0 + (frame * 7 % 100) / 10.0 + (frame % 50 == 0 ? 100.0 : 0.0));
+        pFPS->SetText(fps);
+        if (frame >= 200 && frame < 260)
+        {
+            sliders[2]->SetValue((frame - 200) / 60.0f);
+        }
+        if (frame == 400)
+        {
+            gui.CreateCheckbox("Added late", 50, 0);
+            gui.SetLayoutDirty();
+        }
+
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        gui.Update();
+        const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        const CPUTGuiUpdateStats stats = gui.GetUpdateStats();
+        const UINT bytesReceived = gui.TakeBytesReceived();
+
+        start = std::chrono::high_resolution_clock::now();
+        const UINT rebuiltCount = gui.Rebuild(rebuilt);
+        const double rebuildTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+        if (!gui.Check(rebuilt, rebuiltCount, frame))
+        {
+            result.mbOk = false;
+            break;
+        }
+        if (bytesReceived != stats.bytesUploaded)
+        {
+            printf("frame %d: %u bytes uploaded, GetUpdateStats() says %u\n", frame, bytesReceived, stats.bytesUploaded);
+            result.mbOk = false;
+            break;
+        }
+        if (frame < LAYOUT_FRAMES)
+        {
+            continue;
+        }
+        updateSeconds += seconds;
+        rebuildSeconds += rebuildTime;
+        result.mVertices += stats.verticesWritten;
+        result.mBytes += stats.bytesUploaded;
+        result.mControlsDrawn += stats.controlsDrawn;
+        result.mUploads += stats.uploadCount;
+        result.mRebuildVertices += rebuiltCount;
+        result.mRepacks += stats.repacked ? 1 : 0;
+    }
+
+    const int counted = frameCount - LAYOUT_FRAMES;
+    result.mVertices /= counted;
+    result.mBytes /= counted;
+    result.mControlsDrawn /= counted;
+    result.mUploads /= counted;
+    result.mUpdateUs = updateSeconds / counted * 1e6;
+    result.mRebuildVertices /= counted;
+    result.mRebuildBytes = (double)gui.GetBufferSize() * sizeof(CPUTGUIVertex);
+    result.mRebuildUs = rebuildSeconds / counted * 1e6;
+    result.mControls = gui.GetNumberOfControlsInPanel();
+    gui.DeleteAllControls();
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int frameCount = 600;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-frames") && ii + 1 < argc && atoi(argv[ii + 1]) > LAYOUT_FRAMES)
+        {
+            frameCount = atoi(argv[++ii]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: GuiPanelBench [-frames <count>]\n");
+            return 1;
+        }
+    }
+
+    CPUTFont *pFont = WriteFont(FONT_FILE_NAME) ? CPUTFont::Create("GuiPanelBench", FONT_FILE_NAME) : NULL;
+    remove(FONT_FILE_NAME);
+    if (!pFont)
+    {
+        printf("%s: can't write or load\n", FONT_FILE_NAME);
+        return 1;
+    }
+
+    const PanelResult ranges = RunPanel(pFont, true, frameCount);
+    const PanelResult whole = RunPanel(pFont, false, frameCount);
+    pFont->Release();
+
+    printf("%d controls, %d frames, %u byte vertices\n", ranges.mControls, frameCount - LAYOUT_FRAMES, (UINT)sizeof(CPUTGUIVertex));
+    printf("%-8s %10s %10s %8s %8s %10s %8s\n", "", "vertices", "bytes", "drawn", "uploads", "us", "repacks");
+    printf("%-8s %10.1f %10.1f %8.2f %8.2f %10.2f %8d\n", "ranges", ranges.mVertices, ranges.mBytes, ranges.mControlsDrawn, ranges.mUploads, ranges.mUpdateUs, ranges.mRepacks);
+    printf("%-8s %10.1f %10.1f %8.2f %8.2f %10.2f %8d\n", "whole", whole.mVertices, whole.mBytes, whole.mControlsDrawn, whole.mUploads, whole.mUpdateUs, whole.mRepacks);
+    printf("%-8s %10.1f %10.1f %8d %8d %10.2f\n", "rebuild", ranges.mRebuildVertices, ranges.mRebuildBytes, ranges.mControls, 1, ranges.mRebuildUs);
+    if (!ranges.mbOk || !whole.mbOk)
+    {
+        printf("FAILED: see above\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// ImGuiAtlasBench: times ImFontAtlas::Build() for an application's startup fonts, built on
+// one thread, built on several, and loaded from ImFontAtlas::CacheFilename.
+//
+//   ImGuiAtlasBench [-runs <count>] [-threads <count>] [-cache <file>] <.ttf file>...
+//
+// The atlas holds the default font plus each .ttf at 16 and 26 pixels (the second one
+// oversampled 3x2), for characters 0x20-0x24FF, so large fonts have thousands of glyphs. Each
+// run (default 5) builds it:
+// - serial    BuildThreadCount = 1, no cache
+// - parallel  BuildThreadCount = -threads (default 0, one per core), no cache
+// - cold      with the cache file deleted first, so Build() rasterizes and writes it
+// - cached    with the cache file written by cold
+// and prints the best and median milliseconds of each. Only Build() is timed, not reading the
+// .ttf files. Every build has to give the same pixels and glyphs as the first serial one.
+//
+// The cache file (default ImGuiAtlasBench.cache) is deleted at the end. The threads can only
+// help where there are cores for them; ImGui built with IMGUI_DISABLE_FONT_BUILD_THREADS
+// renders everything on the calling thread whatever -threads says.
+//
+// ImGuiAtlasBench.vcxproj builds it against the Imgui project; no graphics API is needed.
+
+#include "imgui.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+static const ImWchar GLYPH_RANGES[] = { 0x0020, 0x24FF, 0 };
+
+// What a build produced, to compare builds with
+struct AtlasImage
+{
+    int                        mWidth;
+    int                        mHeight;
+    int                        mFontCount;
+    int                        mGlyphCount;
+    std::vector<unsigned char> mPixels;
+    std::vector<float>         mGlyphs;
+};
+
+//-----------------------------------------------------------------------------
+// Builds the atlas and returns the milliseconds Build() took
+static double Build(const std::vector<std::string> &fontFiles, int threadCount, const char *pCacheFileName, AtlasImage *pImage)
+{
+    ImFontAtlas atlas;
+    atlas.BuildThreadCount = threadCount;
+    atlas.CacheFilename = pCacheFileName;
+    atlas.AddFontDefault();
+    for (size_t ii = 0; ii < fontFiles.size(); ii++)
+    {
+        atlas.AddFontFromFileTTF(fontFiles[ii].c_str(), 16.0f, NULL, GLYPH_RANGES);
+        ImFontConfig config;
+        config.OversampleH = 3;
+        config.OversampleV = 2;
+        atlas.AddFontFromFileTTF(fontFiles[ii].c_str(), 26.0f, &config, GLYPH_RANGES);
+    }
+
+    unsigned char *pPixels;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    atlas.GetTexDataAsAlpha8(&pPixels, &pImage->mWidth, &pImage->mHeight);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    pImage->mPixels.assign(pPixels, pPixels + pImage->mWidth * pImage->mHeight);
+    pImage->mGlyphs.clear();
+    pImage->mGlyphs.push_back(atlas.TexUvWhitePixel.x);
+    pImage->mGlyphs.push_back(atlas.TexUvWhitePixel.y);
+    pImage->mFontCount = atlas.Fonts.Size;
+    pImage->mGlyphCount = 0;
+    for (int ii = 0; ii < atlas.Fonts.Size; ii++)
+    {
+        const ImFont *pFont = atlas.Fonts[ii];
+        pImage->mGlyphs.push_back(pFont->Ascent);
+        pImage->mGlyphs.push_back(pFont->Descent);
+        pImage->mGlyphCount += pFont->Glyphs.Size;
+        for (int jj = 0; jj < pFont->Glyphs.Size; jj++)
+        {
+            const ImFont::Glyph &glyph = pFont->Glyphs[jj];
+            const float values[] = { (float)glyph.Codepoint, glyph.XAdvance, glyph.X0, glyph.Y0, glyph.X1, glyph.Y1, glyph.U0, glyph.V0, glyph.U1, glyph.V1 };
+            pImage->mGlyphs.insert(pImage->mGlyphs.end(), values, values + 10);
+        }
+    }
+    return ms;
+}
+
+static bool Same(const AtlasImage &a, const AtlasImage &b)
+{
+    return a.mWidth == b.mWidth && a.mHeight == b.mHeight && a.mPixels == b.mPixels && a.mGlyphs == b.mGlyphs;
+}
+
+//-----------------------------------------------------------------------------
+static void Report(const char *pName, std::vector<double> times)
+{
+    std::sort(times.begin(), times.end());
+    printf("%-10s %10.1f %10.1f\n", pName, times[0], times[times.size() / 2]);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int runCount = 5;
+    int threadCount = 0;
+    const char *pCacheFileName = "ImGuiAtlasBench.cache";
+    std::vector<std::string> fontFiles;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-runs") && ii + 1 < argc && atoi(argv[ii + 1]) > 0)
+        {
+            runCount = atoi(argv[++ii]);
+        }
+        else if (!strcmp(argv[ii], "-threads") && ii + 1 < argc && atoi(argv[ii + 1]) >= 0)
+        {
+            threadCount = atoi(argv[++ii]);
+        }
+        else if (!strcmp(argv[ii], "-cache") && ii + 1 < argc)
+        {
+            pCacheFileName = argv[++ii];
+        }
+        else if (argv[ii][0] != '-')
+        {
+            fontFiles.push_back(argv[ii]);
+        }
+        else
+        {
+            fontFiles.clear();
+            break;
+        }
+    }
+    if (fontFiles.empty())
+    {
+        fprintf(stderr, "usage: ImGuiAtlasBench [-runs <count>] [-threads <count>] [-cache <file>] <.ttf file>...\n");
+        return 1;
+    }
+    for (size_t ii = 0; ii < fontFiles.size(); ii++)
+    {
+        FILE *pFile = fopen(fontFiles[ii].c_str(), "rb");
+        if (!pFile)
+        {
+            printf("%s: can't open\n", fontFiles[ii].c_str());
+            return 1;
+        }
+        fclose(pFile);
+    }
+
+    AtlasImage reference, image;
+    Build(fontFiles, 1, NULL, &reference);
+    printf("%d fonts, %d glyphs, %dx%d atlas\n", reference.mFontCount, reference.mGlyphCount, reference.mWidth, reference.mHeight);
+
+    bool ok = true;
+    std::vector<double> serial, parallel, cold, cached;
+    for (int run = 0; run < runCount; run++)
+    {
+        serial.push_back(Build(fontFiles, 1, NULL, &image));
+        ok = Same(reference, image) && ok;
+        parallel.push_back(Build(fontFiles, threadCount, NULL, &image));
+        ok = Same(reference, image) && ok;
+        remove(pCacheFileName);
+        cold.push_back(Build(fontFiles, threadCount, pCacheFileName, &image));
+        ok = Same(reference, image) && ok;
+        cached.push_back(Build(fontFiles, threadCount, pCacheFileName, &image));
+        ok = Same(reference, image) && ok;
+    }
+    remove(pCacheFileName);
+
+    printf("%-10s %10s %10s\n", "", "best ms", "median ms");
+    Report("serial", serial);
+    Report("parallel", parallel);
+    Report("cold", cold);
+    Report("cached", cached);
+    if (!ok)
+    {
+        printf("FAILED: a build gave different pixels or glyphs\n");
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,324 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// ImGuiStorageBench: creates and queries large numbers of IDs in ImGuiStorage, built with
+// IMGUI_STORAGE_HASHMAP, and in the sorted vector ImGuiStorage is without it.
+//
+//   ImGuiStorageBench [-ids <count>] [-frames <count>] [-nodes <count>]
+//
+// Each storage goes through:
+// - check       200000 random SetInt/GetIntRef/GetInt calls, half of them on a few small keys,
+//               compared against a std::map, then SetAllInt() and Clear()
+// - frames      -ids IDs (default 50000) hashed like ImGui's, each GetIntRef()'d and
+//               incremented once a frame for -frames frames (default 20), so the first frame
+//               creates them all and the others only look them up
+// - descending  -ids SetInt() calls with keys counting down, the sorted vector's worst case
+// Then ImGui itself runs -frames frames of a window with -nodes tree nodes (default 5000), each
+// opened on the first frame, and prints the milliseconds per frame. That part uses whichever
+// ImGuiStorage this was built with, so it has to be built with and without the define to
+// compare.
+//
+// The sorted vector is LegacyStorage below, a copy of imgui.cpp's functions for it, so both are
+// timed by the same build.
+//
+// ImGuiStorageBench.vcxproj compiles imgui.cpp and imgui_draw.cpp itself with
+// IMGUI_STORAGE_HASHMAP defined, as the define changes ImGuiStorage's layout and the Imgui
+// project is built without it.
+
+#include "imgui.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+
+#ifdef IMGUI_STORAGE_HASHMAP
+static const char *STORAGE_NAME = "hashmap";
+#else
+static const char *STORAGE_NAME = "sorted";
+#endif
+
+// ImGuiStorage's int functions as they are without IMGUI_STORAGE_HASHMAP
+struct LegacyStorage
+{
+    typedef ImGuiStorage::Pair Pair;
+    ImVector<Pair> Data;
+
+    void Clear()
+    {
+        Data.clear();
+    }
+
+    ImVector<Pair>::iterator LowerBound(ImGuiID key) const
+    {
+        ImVector<Pair>::iterator first = const_cast<Pair *>(Data.begin());
+        int count = Data.Size;
+        while (count > 0)
+        {
+            int count2 = count / 2;
+            ImVector<Pair>::iterator mid = first + count2;
+            if (mid->key < key)
+            {
+                first = ++mid;
+                count -= count2 + 1;
+            }
+            else
+            {
+                count = count2;
+            }
+        }
+        return first;
+    }
+
+    int GetInt(ImGuiID key, int default_val = 0) const
+    {
+        ImVector<Pair>::iterator it = LowerBound(key);
+        if (it == Data.end() || it->key != key)
+            return default_val;
+        return it->val_i;
+    }
+
+    int *GetIntRef(ImGuiID key, int default_val = 0)
+    {
+        ImVector<Pair>::iterator it = LowerBound(key);
+        if (it == Data.end() || it->key != key)
+            it = Data.insert(it, Pair(key, default_val));
+        return &it->val_i;
+    }
+
+    void SetInt(ImGuiID key, int val)
+    {
+        ImVector<Pair>::iterator it = LowerBound(key);
+        if (it == Data.end() || it->key != key)
+        {
+            Data.insert(it, Pair(key, val));
+            return;
+        }
+        it->val_i = val;
+    }
+
+    void SetAllInt(int v)
+    {
+        for (int i = 0; i < Data.Size; i++)
+            Data[i].val_i = v;
+    }
+};
+
+struct StorageResult
+{
+    bool   mbOk;
+    double mFramesMs;
+    double mDescendingMs;
+};
+
+static double Milliseconds(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//-----------------------------------------------------------------------------
+template <class Storage>
+static bool Check(const char *pName)
+{
+    Storage storage;
+    std::map<ImGuiID, int> reference;
+    unsigned int random = 5;
+    for (int ii = 0; ii < 200000; ii++)
+    {
+        random = random * 1664525u + 1013904223u;
+        const ImGuiID key = (random >> 31) ? (ImGuiID)((random >> 8) % 50) : (ImGuiID)(random * 2654435761u);
+        const int op = (int)((random >> 12) % 3);
+        if (op == 0)
+        {
+            storage.SetInt(key, ii);
+            reference[key] = ii;
+        }
+        else if (op == 1)
+        {
+            int *pValue = storage.GetIntRef(key, -7);
+            if (!reference.count(key))
+            {
+                reference[key] = -7;
+            }
+            if (*pValue != reference[key])
+            {
+                printf("%s: GetIntRef(%08x) is %d, expected %d\n", pName, key, *pValue, reference[key]);
+                return false;
+            }
+        }
+        else
+        {
+            const int value = storage.GetInt(key, -1);
+            const int expected = reference.count(key) ? reference[key] : -1;
+            if (value != expected)
+            {
+                printf("%s: GetInt(%08x) is %d, expected %d\n", pName, key, value, expected);
+                return false;
+            }
+        }
+    }
+    if ((size_t)storage.Data.Size != reference.size())
+    {
+        printf("%s: %d pairs, expected %d\n", pName, storage.Data.Size, (int)reference.size());
+        return false;
+    }
+    storage.SetAllInt(3);
+    for (std::map<ImGuiID, int>::const_iterator it = reference.begin(); it != reference.end(); ++it)
+    {
+        if (storage.GetInt(it->first, -1) != 3)
+        {
+            printf("%s: SetAllInt() missed %08x\n", pName, it->first);
+            return false;
+        }
+    }
+    storage.Clear();
+    if (storage.GetInt(reference.begin()->first, 9) != 9 || storage.Data.Size != 0)
+    {
+        printf("%s: Clear() left pairs behind\n", pName);
+        return false;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+template <class Storage>
+static StorageResult Run(const char *pName, int idCount, int frameCount)
+{
+    StorageResult result;
+    result.mbOk = Check<Storage>(pName);
+
+    Storage frames;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        for (int ii = 0; ii < idCount; ii++)
+        {
+            (*frames.GetIntRef((ImGuiID)(ii * 2654435761u), 0))++;
+        }
+    }
+    result.mFramesMs = Milliseconds(start);
+    for (int ii = 0; ii < idCount && result.mbOk; ii++)
+    {
+        if (frames.GetInt((ImGuiID)(ii * 2654435761u), -1) != frameCount)
+        {
+            printf("%s: ID %d was counted %d times, expected %d\n", pName, ii, frames.GetInt((ImGuiID)(ii * 2654435761u), -1), frameCount);
+            result.mbOk = false;
+        }
+    }
+
+    Storage descending;
+    start = std::chrono::high_resolution_clock::now();
+    for (int ii = idCount; ii > 0; ii--)
+    {
+        descending.SetInt((ImGuiID)ii, ii);
+    }
+    result.mDescendingMs = Milliseconds(start);
+    for (int ii = 1; ii <= idCount && result.mbOk; ii++)
+    {
+        if (descending.GetInt((ImGuiID)ii, -1) != ii)
+        {
+            printf("%s: key %d lost\n", pName, ii);
+            result.mbOk = false;
+        }
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Runs a window of nodeCount tree nodes, opened on the first frame, and returns the
+// milliseconds per frame after that one
+static double TreeFrames(int nodeCount, int frameCount, int *pStorageSize)
+{
+    ImGuiIO &io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(1280, 720);
+    io.DeltaTime = 1.0f / 60.0f;
+    io.IniFilename = NULL;
+    unsigned char *pPixels;
+    int width, height;
+    io.Fonts->GetTexDataAsRGBA32(&pPixels, &width, &height);
+
+    std::chrono::high_resolution_clock::time_point start;
+    for (int frame = 0; frame <= frameCount; frame++)
+    {
+        if (frame == 1)
+        {
+            start = std::chrono::high_resolution_clock::now();
+        }
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos(ImVec2(0, 0));
+        ImGui::SetNextWindowSize(ImVec2(400, 700));
+        ImGui::Begin("Tree");
+        for (int ii = 0; ii < nodeCount; ii++)
+        {
+            ImGui::PushID(ii);
+            if (frame == 0)
+            {
+                ImGui::SetNextTreeNodeOpened(true);
+            }
+            if (ImGui::TreeNode("node"))
+            {
+                ImGui::TreePop();
+            }
+            ImGui::PopID();
+        }
+        *pStorageSize = ImGui::GetStateStorage()->Data.Size;
+        ImGui::End();
+        ImGui::Render();
+    }
+    const double ms = Milliseconds(start) / frameCount;
+    ImGui::Shutdown();
+    return ms;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int idCount = 50000;
+    int frameCount = 20;
+    int nodeCount = 5000;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-ids") && ii + 1 < argc && atoi(argv[ii + 1]) > 0)
+        {
+            idCount = atoi(argv[++ii]);
+        }
+        else if (!strcmp(argv[ii], "-frames") && ii + 1 < argc && atoi(argv[ii + 1]) > 0)
+        {
+            frameCount = atoi(argv[++ii]);
+        }
+        else if (!strcmp(argv[ii], "-nodes") && ii + 1 < argc && atoi(argv[ii + 1]) > 0)
+        {
+            nodeCount = atoi(argv[++ii]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: ImGuiStorageBench [-ids <count>] [-frames <count>] [-nodes <count>]\n");
+            return 1;
+        }
+    }
+
+    const StorageResult sorted = Run<LegacyStorage>("sorted", idCount, frameCount);
+    const StorageResult built = Run<ImGuiStorage>(STORAGE_NAME, idCount, frameCount);
+    printf("%-10s %8s  %12s %14s\n", "", "check", "frames ms", "descending ms");
+    printf("%-10s %8s  %12.1f %14.1f\n", "sorted", sorted.mbOk ? "ok" : "FAILED", sorted.mFramesMs, sorted.mDescendingMs);
+    printf("%-10s %8s  %12.1f %14.1f\n", STORAGE_NAME, built.mbOk ? "ok" : "FAILED", built.mFramesMs, built.mDescendingMs);
+
+    int storageSize = 0;
+    const double treeMs = TreeFrames(nodeCount, frameCount, &storageSize);
+    printf("ImGui, %s storage: %d tree nodes, %d pairs in the window's storage, %.3f ms per frame\n", STORAGE_NAME, nodeCount, storageSize, treeMs);
+    return (sorted.mbOk && built.mbOk) ? 0 : 1;
+}
@@ -0,0 +1,548 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// ImGuiUploadBench: replays ImGui frames through ImGui_ImplUploader (Imgui/imgui_impl_upload.h)
+// and through the upload imgui_impl_dx11.cpp did before it (grow by +5000/+10000, discard and
+// copy every draw list every frame), into buffers in memory, so no device is needed.
+//
+//   ImGuiUploadBench [-frames <count>] [-save <file>] [-load <file>]
+//
+// The frames come from a few generated UIs run through ImGui headless, -frames each
+// (default 600):
+// - static    an options panel like ChatHeads', nothing changes
+// - metrics   the panel plus a metrics window whose numbers and histogram change every frame
+// - toggle    the panel, a counter that changes every 10 frames and a window that comes and
+//             goes every 100
+// - hover     the panel with the mouse moving over it
+// -save writes the captured draw lists to a file and -load replays such a file instead, so
+// frames captured elsewhere can be compared; the file is the draw lists' vertices and indices
+// as they are in memory, so it only loads where ImDrawVert and ImDrawIdx have the same size.
+//
+// For each set of frames it prints the bytes copied per frame, the lists skipped, how often
+// the buffers were discarded or recreated, and the microseconds Upload() took per frame
+// (hashing included). After every frame each draw list is read back from the offsets the
+// uploader returned and has to match; a discard hands out another buffer filled with garbage,
+// like a renamed D3D11 buffer, so anything not written again is caught. The times are CPU
+// only: what a driver does for a map, and what the GPU reads, is not in them.
+//
+// ImGuiUploadBench.vcxproj builds it against the Imgui project; no graphics API is needed.
+
+#include "imgui.h"
+#include "imgui_impl_upload.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// A frame's draw lists as ImGui::Render() left them
+struct CapturedList
+{
+    std::vector<ImDrawVert> mVertices;
+    std::vector<ImDrawIdx>  mIndices;
+};
+
+struct CapturedFrames
+{
+    std::string                            mName;
+    std::vector<std::vector<CapturedList> > mFrames;
+};
+
+// The buffers in memory. A new buffer starts out as garbage, and a discard hands out another
+// buffer of garbage, like the renaming a D3D11 driver does. The garbage is filled in by
+// Refill(), between frames, so it isn't timed as part of the upload.
+struct MemoryBuffers : ImGui_ImplUploadBuffers
+{
+    MemoryBuffers() : mCreateCount(0), mDiscardCount(0), mMapCount(0) {}
+
+    bool Create(int kind, size_t size_bytes)
+    {
+        mBuffers[kind].assign(size_bytes, (char)0xCD);
+        mSpares[kind].assign(size_bytes, (char)0xCD);
+        mCreateCount++;
+        return true;
+    }
+
+    void *Map(int kind, bool discard)
+    {
+        mMapCount++;
+        if (discard)
+        {
+            mBuffers[kind].swap(mSpares[kind]);
+            mDiscardCount++;
+        }
+        return &mBuffers[kind][0];
+    }
+
+    void Unmap(int kind)
+    {
+    }
+
+    void Refill()
+    {
+        for (int kind = 0; kind < 2; kind++)
+        {
+            mSpares[kind].assign(mBuffers[kind].size(), (char)0xCD);
+        }
+    }
+
+    std::vector<char> mBuffers[2];
+    std::vector<char> mSpares[2];
+    int mCreateCount;
+    int mDiscardCount;
+    int mMapCount;
+};
+
+// What imgui_impl_dx11.cpp did before ImGui_ImplUploader
+class FullUploader
+{
+public:
+    FullUploader() : mVertexBufferSize(0), mIndexBufferSize(0), mBytesCopied(0) {}
+
+    bool Upload(ImGui_ImplUploadBuffers *pBuffers, ImDrawData *pDrawData)
+    {
+        if (!mVertexBufferSize || mVertexBufferSize < pDrawData->TotalVtxCount)
+        {
+            mVertexBufferSize = pDrawData->TotalVtxCount + 5000;
+            if (!pBuffers->Create(ImGui_ImplUploadBuffers::Vertices, mVertexBufferSize * sizeof(ImDrawVert)))
+            {
+                return false;
+            }
+        }
+        if (!mIndexBufferSize || mIndexBufferSize < pDrawData->TotalIdxCount)
+        {
+            mIndexBufferSize = pDrawData->TotalIdxCount + 10000;
+            if (!pBuffers->Create(ImGui_ImplUploadBuffers::Indices, mIndexBufferSize * sizeof(ImDrawIdx)))
+            {
+                return false;
+            }
+        }
+        ImDrawVert *pVtxDst = (ImDrawVert *)pBuffers->Map(ImGui_ImplUploadBuffers::Vertices, true);
+        ImDrawIdx *pIdxDst = (ImDrawIdx *)pBuffers->Map(ImGui_ImplUploadBuffers::Indices, true);
+        mBytesCopied = 0;
+        mVtxOffsets.resize(pDrawData->CmdListsCount);
+        mIdxOffsets.resize(pDrawData->CmdListsCount);
+        int vtxOffset = 0, idxOffset = 0;
+        for (int n = 0; n < pDrawData->CmdListsCount; n++)
+        {
+            const ImDrawList *pList = pDrawData->CmdLists[n];
+            memcpy(pVtxDst + vtxOffset, pList->VtxBuffer.Data, pList->VtxBuffer.size() * sizeof(ImDrawVert));
+            memcpy(pIdxDst + idxOffset, pList->IdxBuffer.Data, pList->IdxBuffer.size() * sizeof(ImDrawIdx));
+            mVtxOffsets[n] = vtxOffset;
+            mIdxOffsets[n] = idxOffset;
+            vtxOffset += pList->VtxBuffer.size();
+            idxOffset += pList->IdxBuffer.size();
+            mBytesCopied += pList->VtxBuffer.size() * sizeof(ImDrawVert) + pList->IdxBuffer.size() * sizeof(ImDrawIdx);
+        }
+        pBuffers->Unmap(ImGui_ImplUploadBuffers::Vertices);
+        pBuffers->Unmap(ImGui_ImplUploadBuffers::Indices);
+        return true;
+    }
+
+    int    GetVtxOffset(int list) const { return mVtxOffsets[list]; }
+    int    GetIdxOffset(int list) const { return mIdxOffsets[list]; }
+    size_t GetBytesCopied() const       { return mBytesCopied; }
+
+private:
+    int              mVertexBufferSize;
+    int              mIndexBufferSize;
+    size_t           mBytesCopied;
+    std::vector<int> mVtxOffsets;
+    std::vector<int> mIdxOffsets;
+};
+
+//-----------------------------------------------------------------------------
+static void OptionsPanel(int frame, int counterPeriod)
+{
+    static int scene = 2, resolution = 0, encodingThreshold = 32, decodingThreshold = 32, bgsFrequency = 0;
+    static bool movieYUV = true, sceneLod = true, cacheShadows = true, showBGS = true, pauseBGS = false;
+    const char *pScenes[] = { "League of Legends", "Hearthstone", "CPUT Scene" };
+    const char *pResolutions[] = { "640x480", "960x540", "1280x720", "1920x1080" };
+    const char *pFrequencies[] = { "Run every frame", "Run every alternate frame", "Run once in three frames" };
+
+    ImGui::Begin("Chat Heads Option Panel", NULL, ImGuiWindowFlags_AlwaysAutoResize);
+    ImGui::ListBox("Scenes", &scene, pScenes, 3, 3);
+    ImGui::Button("Load Scene");
+    ImGui::Checkbox("Movie YUV in shader", &movieYUV);
+    ImGui::Checkbox("Scene LOD", &sceneLod);
+    ImGui::Checkbox("Cache static shadows", &cacheShadows);
+    ImGui::Text("Shadow pass draws: %d", counterPeriod ? 40 + (frame / counterPeriod) % 7 : 40);
+    ImGui::ListBox("Resolutions", &resolution, pResolutions, 4, 4);
+    if (ImGui::CollapsingHeader("BGS/Media controls", NULL, true, true))
+    {
+        ImGui::Checkbox("Show BGS Image", &showBGS);
+        ImGui::Checkbox("Pause BGS", &pauseBGS);
+        ImGui::Combo("BGS frequency", &bgsFrequency, pFrequencies, 3);
+        ImGui::SliderInt("Encoding Threshold", &encodingThreshold, 0, 255);
+        ImGui::SliderInt("Decoding Threshold", &decodingThreshold, 0, 255);
+        ImGui::Text("Toggle F2 to show/hide this panel");
+    }
+    ImGui::End();
+}
+
+//-----------------------------------------------------------------------------
+static void MetricsWindow(int frame)
+{
+    float cpuUsed[90];
+    for (int ii = 0; ii < 90; ii++)
+    {
+        cpuUsed[ii] = (float)((ii * 37 + frame * 11) % 100);
+    }
+    ImGui::SetNextWindowPos(ImVec2(700, 20));
+    ImGui::Begin("Metrics");
+    ImGui::Text("Num Logical Cores: %d", 8);
+    ImGui::Text("Physical memory used  : %d MB", 2048 + frame % 97);
+    ImGui::Text("Frame time: %.2f ms", 16.0f + (frame % 13) * 0.11f);
+    ImGui::PlotHistogram("CPU Used", cpuUsed, 90, frame % 90, NULL, 0.0f, 100.0f, ImVec2(0, 80));
+    ImGui::End();
+}
+
+// Runs one of the generated UIs for frameCount frames and captures what it drew
+//-----------------------------------------------------------------------------
+static void Generate(const char *pName, int frameCount, CapturedFrames *pCapture)
+{
+    pCapture->mName = pName;
+    pCapture->mFrames.resize(frameCount);
+    ImGuiIO &io = ImGui::GetIO();
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        const std::string name = pName;
+        io.MousePos = (name == "hover") ? ImVec2(20.0f + (frame * 7) % 300, 40.0f + (frame * 3) % 400) : ImVec2(-1.0f, -1.0f);
+        ImGui::NewFrame();
+        OptionsPanel(frame, (name == "toggle") ? 10 : 0);
+        if (name == "metrics")
+        {
+            MetricsWindow(frame);
+        }
+        if (name == "toggle" && (frame / 100) % 2)
+        {
+            ImGui::SetNextWindowPos(ImVec2(700, 400));
+            ImGui::Begin("Toggle");
+            ImGui::Text("Shown for 100 frames");
+            ImGui::End();
+        }
+        ImGui::Render();
+
+        ImDrawData *pDrawData = ImGui::GetDrawData();
+        std::vector<CapturedList> &lists = pCapture->mFrames[frame];
+        lists.resize(pDrawData->CmdListsCount);
+        for (int n = 0; n < pDrawData->CmdListsCount; n++)
+        {
+            const ImDrawList *pList = pDrawData->CmdLists[n];
+            lists[n].mVertices.assign(pList->VtxBuffer.Data, pList->VtxBuffer.Data + pList->VtxBuffer.size());
+            lists[n].mIndices.assign(pList->IdxBuffer.Data, pList->IdxBuffer.Data + pList->IdxBuffer.size());
+        }
+    }
+}
+
+static const unsigned int CAPTURE_MAGIC = 0x43554749; // 'IGUC'
+
+//-----------------------------------------------------------------------------
+static bool Save(const std::vector<CapturedFrames> &captures, const char *pFileName)
+{
+    FILE *pFile = fopen(pFileName, "wb");
+    if (!pFile)
+    {
+        return false;
+    }
+    unsigned int header[4] = { CAPTURE_MAGIC, (unsigned int)sizeof(ImDrawVert), (unsigned int)sizeof(ImDrawIdx), (unsigned int)captures.size() };
+    bool ok = fwrite(header, sizeof(header), 1, pFile) == 1;
+    for (size_t ii = 0; ii < captures.size(); ii++)
+    {
+        unsigned int counts[2] = { (unsigned int)captures[ii].mName.size(), (unsigned int)captures[ii].mFrames.size() };
+        ok = ok && fwrite(counts, sizeof(counts), 1, pFile) == 1 && fwrite(captures[ii].mName.c_str(), 1, counts[0], pFile) == counts[0];
+        for (size_t frame = 0; frame < captures[ii].mFrames.size(); frame++)
+        {
+            const std::vector<CapturedList> &lists = captures[ii].mFrames[frame];
+            unsigned int listCount = (unsigned int)lists.size();
+            ok = ok && fwrite(&listCount, sizeof(listCount), 1, pFile) == 1;
+            for (size_t n = 0; n < lists.size(); n++)
+            {
+                unsigned int sizes[2] = { (unsigned int)lists[n].mVertices.size(), (unsigned int)lists[n].mIndices.size() };
+                ok = ok && fwrite(sizes, sizeof(sizes), 1, pFile) == 1 &&
+                    fwrite(lists[n].mVertices.data(), sizeof(ImDrawVert), sizes[0], pFile) == sizes[0] &&
+                    fwrite(lists[n].mIndices.data(), sizeof(ImDrawIdx), sizes[1], pFile) == sizes[1];
+            }
+        }
+    }
+    ok = (fclose(pFile) == 0) && ok;
+    return ok;
+}
+
+// Counts are checked against what is left of the file before anything is allocated
+//-----------------------------------------------------------------------------
+static bool Load(const char *pFileName, std::vector<CapturedFrames> *pCaptures)
+{
+    FILE *pFile = fopen(pFileName, "rb");
+    if (!pFile)
+    {
+        return false;
+    }
+    fseek(pFile, 0, SEEK_END);
+    long left = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    unsigned int header[4];
+    bool ok = fread(header, sizeof(header), 1, pFile) == 1 && header[0] == CAPTURE_MAGIC &&
+        header[1] == sizeof(ImDrawVert) && header[2] == sizeof(ImDrawIdx) && header[3] <= (unsigned long)left;
+    left -= (long)sizeof(header);
+    if (ok)
+    {
+        pCaptures->resize(header[3]);
+    }
+    for (unsigned int ii = 0; ok && ii < header[3]; ii++)
+    {
+        unsigned int counts[2];
+        ok = fread(counts, sizeof(counts), 1, pFile) == 1 && counts[0] + (uint64_t)counts[1] * sizeof(unsigned int) <= (unsigned long)left;
+        left -= (long)sizeof(counts);
+        if (!ok)
+        {
+            break;
+        }
+        CapturedFrames &capture = (*pCaptures)[ii];
+        capture.mName.resize(counts[0]);
+        ok = counts[0] == 0 || fread(&capture.mName[0], 1, counts[0], pFile) == counts[0];
+        left -= (long)counts[0];
+        capture.mFrames.resize(ok ? counts[1] : 0);
+        for (unsigned int frame = 0; ok && frame < counts[1]; frame++)
+        {
+            unsigned int listCount;
+            ok = fread(&listCount, sizeof(listCount), 1, pFile) == 1 && (uint64_t)listCount * 2 * sizeof(unsigned int) <= (unsigned long)left;
+            left -= (long)sizeof(listCount);
+            std::vector<CapturedList> &lists = capture.mFrames[frame];
+            lists.resize(ok ? listCount : 0);
+            for (unsigned int n = 0; ok && n < listCount; n++)
+            {
+                unsigned int sizes[2];
+                ok = fread(sizes, sizeof(sizes), 1, pFile) == 1 &&
+                    (uint64_t)sizes[0] * sizeof(ImDrawVert) + (uint64_t)sizes[1] * sizeof(ImDrawIdx) <= (unsigned long)left;
+                if (!ok)
+                {
+                    break;
+                }
+                left -= (long)(sizeof(sizes) + sizes[0] * sizeof(ImDrawVert) + sizes[1] * sizeof(ImDrawIdx));
+                lists[n].mVertices.resize(sizes[0]);
+                lists[n].mIndices.resize(sizes[1]);
+                ok = fread(lists[n].mVertices.data(), sizeof(ImDrawVert), sizes[0], pFile) == sizes[0] &&
+                    fread(lists[n].mIndices.data(), sizeof(ImDrawIdx), sizes[1], pFile) == sizes[1];
+            }
+        }
+    }
+    fclose(pFile);
+    return ok;
+}
+
+// Draw data pointing at the frame's lists, which is all the uploaders look at
+//-----------------------------------------------------------------------------
+static void BuildDrawData(const std::vector<CapturedList> &lists, std::vector<ImDrawList *> *pDrawLists, ImDrawData *pDrawData)
+{
+    while (pDrawLists->size() < lists.size())
+    {
+        pDrawLists->push_back(new ImDrawList());
+    }
+    pDrawData->Valid = true;
+    pDrawData->CmdLists = pDrawLists->empty() ? NULL : &(*pDrawLists)[0];
+    pDrawData->CmdListsCount = (int)lists.size();
+    pDrawData->TotalVtxCount = pDrawData->TotalIdxCount = 0;
+    for (size_t n = 0; n < lists.size(); n++)
+    {
+        ImDrawList *pList = (*pDrawLists)[n];
+        pList->VtxBuffer.resize((int)lists[n].mVertices.size());
+        pList->IdxBuffer.resize((int)lists[n].mIndices.size());
+        if (!lists[n].mVertices.empty())
+        {
+            memcpy(pList->VtxBuffer.Data, lists[n].mVertices.data(), lists[n].mVertices.size() * sizeof(ImDrawVert));
+        }
+        if (!lists[n].mIndices.empty())
+        {
+            memcpy(pList->IdxBuffer.Data, lists[n].mIndices.data(), lists[n].mIndices.size() * sizeof(ImDrawIdx));
+        }
+        pDrawData->TotalVtxCount += (int)lists[n].mVertices.size();
+        pDrawData->TotalIdxCount += (int)lists[n].mIndices.size();
+    }
+}
+
+// Every list has to be where the uploader said it put it
+//-----------------------------------------------------------------------------
+template <class Uploader>
+static bool CheckPlacements(const Uploader &uploader, const MemoryBuffers &buffers, const std::vector<CapturedList> &lists)
+{
+    for (size_t n = 0; n < lists.size(); n++)
+    {
+        const size_t vtxBytes = lists[n].mVertices.size() * sizeof(ImDrawVert);
+        const size_t idxBytes = lists[n].mIndices.size() * sizeof(ImDrawIdx);
+        const size_t vtxStart = (size_t)uploader.GetVtxOffset((int)n) * sizeof(ImDrawVert);
+        const size_t idxStart = (size_t)uploader.GetIdxOffset((int)n) * sizeof(ImDrawIdx);
+        if ((vtxBytes && (vtxStart + vtxBytes > buffers.mBuffers[0].size() || memcmp(&buffers.mBuffers[0][vtxStart], lists[n].mVertices.data(), vtxBytes))) ||
+            (idxBytes && (idxStart + idxBytes > buffers.mBuffers[1].size() || memcmp(&buffers.mBuffers[1][idxStart], lists[n].mIndices.data(), idxBytes))))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct ReplayResult
+{
+    double mBytesPerFrame;
+    double mListsPerFrame;
+    double mSkippedPerFrame;
+    double mMicrosecondsPerFrame;
+    int    mDiscardCount;
+    int    mCreateCount;
+    int    mMapCount;
+};
+
+//-----------------------------------------------------------------------------
+template <class Uploader>
+static size_t UploadFrame(Uploader &uploader, MemoryBuffers *pBuffers, ImDrawData *pDrawData, int *pSkipped);
+
+template <>
+size_t UploadFrame(ImGui_ImplUploader &uploader, MemoryBuffers *pBuffers, ImDrawData *pDrawData, int *pSkipped)
+{
+    if (!uploader.Upload(pBuffers, pDrawData))
+    {
+        return (size_t)-1;
+    }
+    *pSkipped = uploader.GetStats().ListsSkipped;
+    return uploader.GetStats().BytesCopied;
+}
+
+template <>
+size_t UploadFrame(FullUploader &uploader, MemoryBuffers *pBuffers, ImDrawData *pDrawData, int *pSkipped)
+{
+    *pSkipped = 0;
+    return uploader.Upload(pBuffers, pDrawData) ? uploader.GetBytesCopied() : (size_t)-1;
+}
+
+//-----------------------------------------------------------------------------
+template <class Uploader>
+static bool Replay(const CapturedFrames &capture, ReplayResult *pResult)
+{
+    Uploader uploader;
+    MemoryBuffers buffers;
+    std::vector<ImDrawList *> drawLists;
+    ImDrawData drawData;
+    double bytes = 0.0, lists = 0.0, skipped = 0.0, microseconds = 0.0;
+    bool ok = true;
+    for (size_t frame = 0; ok && frame < capture.mFrames.size(); frame++)
+    {
+        BuildDrawData(capture.mFrames[frame], &drawLists, &drawData);
+        int frameSkipped = 0;
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        const size_t frameBytes = UploadFrame(uploader, &buffers, &drawData, &frameSkipped);
+        microseconds += std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+        if (frameBytes == (size_t)-1 || !CheckPlacements(uploader, buffers, capture.mFrames[frame]))
+        {
+            printf("%s: frame %d doesn't read back from the buffers\n", capture.mName.c_str(), (int)frame);
+            ok = false;
+        }
+        buffers.Refill();
+        bytes += (double)frameBytes;
+        lists += (double)capture.mFrames[frame].size();
+        skipped += frameSkipped;
+    }
+    for (size_t n = 0; n < drawLists.size(); n++)
+    {
+        delete drawLists[n];
+    }
+    const double frameCount = capture.mFrames.empty() ? 1.0 : (double)capture.mFrames.size();
+    pResult->mBytesPerFrame        = bytes / frameCount;
+    pResult->mListsPerFrame        = lists / frameCount;
+    pResult->mSkippedPerFrame      = skipped / frameCount;
+    pResult->mMicrosecondsPerFrame = microseconds / frameCount;
+    pResult->mDiscardCount         = buffers.mDiscardCount;
+    pResult->mCreateCount          = buffers.mCreateCount;
+    pResult->mMapCount             = buffers.mMapCount;
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int frameCount = 600;
+    const char *pSaveFileName = NULL;
+    const char *pLoadFileName = NULL;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-frames") && ii + 1 < argc && atoi(argv[ii + 1]) > 0)
+        {
+            frameCount = atoi(argv[++ii]);
+        }
+        else if (!strcmp(argv[ii], "-save") && ii + 1 < argc)
+        {
+            pSaveFileName = argv[++ii];
+        }
+        else if (!strcmp(argv[ii], "-load") && ii + 1 < argc)
+        {
+            pLoadFileName = argv[++ii];
+        }
+        else
+        {
+            fprintf(stderr, "usage: ImGuiUploadBench [-frames <count>] [-save <file>] [-load <file>]\n");
+            return 1;
+        }
+    }
+
+    std::vector<CapturedFrames> captures;
+    if (pLoadFileName)
+    {
+        if (!Load(pLoadFileName, &captures))
+        {
+            printf("%s: not a capture this build can read\n", pLoadFileName);
+            return 1;
+        }
+    }
+    else
+    {
+        ImGuiIO &io = ImGui::GetIO();
+        io.DisplaySize = ImVec2(1280, 720);
+        io.DeltaTime = 1.0f / 60.0f;
+        io.IniFilename = NULL;
+        unsigned char *pPixels;
+        int width, height;
+        io.Fonts->GetTexDataAsRGBA32(&pPixels, &width, &height);
+
+        const char *pNames[] = { "static", "metrics", "toggle", "hover" };
+        captures.resize(sizeof(pNames) / sizeof(pNames[0]));
+        for (size_t ii = 0; ii < captures.size(); ii++)
+        {
+            Generate(pNames[ii], frameCount, &captures[ii]);
+        }
+        ImGui::Shutdown();
+    }
+    if (pSaveFileName && !Save(captures, pSaveFileName))
+    {
+        printf("%s: can't write\n", pSaveFileName);
+        return 1;
+    }
+
+    bool ok = true;
+    printf("%-8s %6s %5s  %12s %12s  %8s  %9s %9s  %s\n", "", "frames", "lists", "bytes full", "uploader", "skipped", "us full", "uploader", "discards/creates/maps");
+    for (size_t ii = 0; ii < captures.size(); ii++)
+    {
+        ReplayResult full, incremental;
+        ok = Replay<FullUploader>(captures[ii], &full) && ok;
+        ok = Replay<ImGui_ImplUploader>(captures[ii], &incremental) && ok;
+        printf("%-8s %6d %5.1f  %12.0f %12.0f  %8.1f  %9.2f %9.2f  %d/%d/%d (full %d/%d/%d)\n", captures[ii].mName.c_str(),
+            (int)captures[ii].mFrames.size(), full.mListsPerFrame, full.mBytesPerFrame, incremental.mBytesPerFrame,
+            incremental.mSkippedPerFrame, full.mMicrosecondsPerFrame, incremental.mMicrosecondsPerFrame,
+            incremental.mDiscardCount, incremental.mCreateCount, incremental.mMapCount, full.mDiscardCount, full.mCreateCount, full.mMapCount);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,495 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// InstanceDrawBench: generates asset sets of repeated props and times
+// CPUTAssetSet::RenderRecursive() against a null render device, drawing every model on its own
+// and drawing the CPUTInstanceGroups with one instanced draw per mesh.
+//
+//   InstanceDrawBench [-frames <count>] [-props <count>]
+//
+// A generated set has -props props (default 8) of 2 meshes, each mesh with a material of its
+// own that has an InstancedMaterial variant. Every prop is placed 1, 4, 16, 64, 256 and 1024
+// times on a grid 2 units apart; the copies share the prop's meshes and materials like copies of
+// one .mdl in a .set file, so CPUTAssetSet::BuildInstanceGroups() groups them. Each set is drawn
+// for -frames frames (default 200):
+// - per model   without a per-instance constant buffer, so every model sets cbPerModelValues
+//               and draws each of its meshes
+// - instanced   with one, so each group puts its world matrices in $cbPerInstanceValues and
+//               draws each mesh once per 512 copies
+// first with no camera, then with a camera in the middle of the grid looking along it, which
+// sees about a quarter of it. The groups cull each copy against the camera; RenderRecursive()
+// doesn't cull the models it draws one at a time, so per model draws every copy either way. It
+// prints the draws, constant buffer kilobytes and microseconds per frame. Then a set with 64
+// copies per prop is drawn with materials that have no instanced variant, and with meshes that
+// can't draw instanced, which both fall back to a draw per copy.
+//
+// Nothing reaches a GPU. The bench supplies what CPUTDX would: NullMesh, NullMaterial and
+// NullBuffer count the draws and keep the constant buffer data, SetMaterialStates() and
+// SetRenderStateBlock() count state changes. So the times are CPUT's side only, not what a D3D11
+// runtime or driver does with the calls. The first frame of each run is checked: every mesh has
+// to be drawn once at each position the models' world matrices give, read back from
+// cbPerModelValues or the instance matrices, and with the camera only the grouped copies in its
+// frustum.
+//
+// InstanceDrawBench.vcxproj builds it with CPUT_FOR_DX11 and the CPUT sources asset sets and
+// models need, without CPUTDX and without a device.
+
+#include "CPUTAssetSet.h"
+#include "CPUTAssetLibrary.h"
+#include "CPUTModel.h"
+#include "CPUTMesh.h"
+#include "CPUTMaterial.h"
+#include "CPUTBuffer.h"
+#include "CPUTTexture.h"
+#include "CPUTRenderStateBlock.h"
+#include "CPUTRenderParams.h"
+#include "CPUTInputLayoutCache.h"
+#include "CPUTInstanceGroup.h"
+#ifdef CPUT_FOR_DX11
+#include "CPUTMaterialDX11.h"
+#include "CPUTMeshDX11.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+static const int MESHES_PER_PROP = 2;
+
+struct Counters
+{
+    UINT mDraws;
+    UINT mInstancedDraws;
+    UINT mMeshesDrawn;      // instanced draws count each copy
+    UINT mMaterialChanges;
+    UINT mBytes;            // constant buffer data
+};
+static Counters gCounters;
+
+// A mesh drawn at a position, what the checked frames record
+struct DrawnMesh
+{
+    int   mMesh;
+    float mX;
+    float mZ;
+
+    bool operator<(const DrawnMesh &other) const
+    {
+        if (mMesh != other.mMesh)
+        {
+            return mMesh < other.mMesh;
+        }
+        return mX < other.mX || (mX == other.mX && mZ < other.mZ);
+    }
+    bool operator==(const DrawnMesh &other) const { return mMesh == other.mMesh && mX == other.mX && mZ == other.mZ; }
+};
+static std::vector<DrawnMesh> *gpDrawn = NULL; // NULL while timing
+
+// Keeps what was written, as a mapped constant buffer would
+class NullBuffer : public CPUTBuffer
+{
+public:
+    NullBuffer(std::string name, UINT sizeBytes) : CPUTBuffer(name, NULL), mData(sizeBytes) {}
+
+    void SetData(UINT offset, UINT sizeBytes, void *pData)
+    {
+        memcpy(&mData[offset], pData, sizeBytes);
+        gCounters.mBytes += sizeBytes;
+    }
+    void GetData(void *pData) { memcpy(pData, &mData[0], mData.size()); }
+
+    // cbPerModelValues starts with World, cbPerInstanceValues is all world matrices
+    const float4x4 *GetMatrices() const { return (const float4x4 *)&mData[0]; }
+
+private:
+    std::vector<unsigned char> mData;
+};
+static NullBuffer *gpPerModelConstants;
+static NullBuffer *gpPerInstanceConstants;
+
+class NullMesh : public CPUTMesh
+{
+public:
+    NullMesh(int id, bool canDrawInstanced) : mId(id), mbCanDrawInstanced(canDrawInstanced) {}
+
+    int  GetId() const { return mId; }
+
+    void Draw()
+    {
+        gCounters.mDraws++;
+        gCounters.mMeshesDrawn++;
+        if (gpDrawn)
+        {
+            Record(gpPerModelConstants->GetMatrices()[0]);
+        }
+    }
+    bool CanDrawInstanced() { return mbCanDrawInstanced; }
+    void DrawInstanced(UINT instanceCount)
+    {
+        gCounters.mDraws++;
+        gCounters.mInstancedDraws++;
+        gCounters.mMeshesDrawn += instanceCount;
+        for (UINT ii = 0; ii < instanceCount && gpDrawn; ii++)
+        {
+            // the instance's world, then cbPerModelValues.World, as the instanced vertex shader does
+            Record(gpPerInstanceConstants->GetMatrices()[ii] * gpPerModelConstants->GetMatrices()[0]);
+        }
+    }
+#ifndef CPUT_FOR_DX11
+    void *MapVertices(CPUTRenderParameters &, eCPUTMapType, bool) { return NULL; }
+    void *MapIndices(CPUTRenderParameters &, eCPUTMapType, bool) { return NULL; }
+#endif
+    void UnmapVertices(CPUTRenderParameters &) {}
+    void UnmapIndices(CPUTRenderParameters &) {}
+    CPUTResult CreateNativeResources(CPUTModel *, UINT, int, CPUTBufferElementInfo *, UINT, void *, CPUTBufferElementInfo *, UINT, void *) { return CPUT_SUCCESS; }
+
+private:
+    void Record(const float4x4 &world)
+    {
+        DrawnMesh drawn = { mId, world.r3.x, world.r3.z };
+        gpDrawn->push_back(drawn);
+    }
+
+    int  mId;
+    bool mbCanDrawInstanced;
+};
+
+class NullRenderStateBlock : public CPUTRenderStateBlock
+{
+public:
+    CPUTResult LoadRenderStateBlock(const std::string &) { return CPUT_SUCCESS; }
+    void SetRenderStates() {}
+    void CreateNativeResources() {}
+};
+
+class NullMaterial : public CPUTMaterial
+{
+public:
+    // Takes pInstancedMaterial's reference
+    NullMaterial(NullMaterial *pInstancedMaterial)
+    {
+        mpRenderStateBlock = new NullRenderStateBlock();
+        mpInstancedMaterial = pInstancedMaterial;
+    }
+    CPUTResult LoadMaterial(const std::string &, CPUT_SHADER_MACRO *) { return CPUT_SUCCESS; }
+
+protected:
+    ~NullMaterial()
+    {
+        SAFE_RELEASE(mpRenderStateBlock);
+        SAFE_RELEASE(mpInstancedMaterial);
+    }
+};
+
+class NullInputLayoutCache : public CPUTInputLayoutCache
+{
+};
+static NullInputLayoutCache *gpInputLayoutCache = NULL;
+
+//-----------------------------------------------------------------------------
+// What CPUTDX supplies for these, without a device
+void SetMaterialStates(CPUTMaterial *pNewMaterial, CPUTMaterial *pCurrent)
+{
+    if (pNewMaterial != pCurrent)
+    {
+        gCounters.mMaterialChanges++;
+    }
+}
+
+void SetRenderStateBlock(CPUTRenderStateBlock *pNew, CPUTRenderStateBlock *pCurrent)
+{
+    if (pNew != pCurrent)
+    {
+        pNew->SetRenderStates();
+    }
+}
+
+CPUTInputLayoutCache *CPUTInputLayoutCache::GetInputLayoutCache()
+{
+    if (!gpInputLayoutCache)
+    {
+        gpInputLayoutCache = new NullInputLayoutCache();
+    }
+    return gpInputLayoutCache;
+}
+
+void CPUTInputLayoutCache::DeleteInputLayoutCache()
+{
+    SAFE_DELETE(gpInputLayoutCache);
+}
+
+// Nothing is loaded from files, so the factories CPUTModel and CPUTAssetLibrary load with are
+// never called
+CPUTAssetLibrary *CPUTAssetLibrary::GetAssetLibrary() { return NULL; }
+CPUTRenderStateBlock *CPUTRenderStateBlock::Create(const std::string &, const std::string &) { return NULL; }
+CPUTTexture *CPUTTexture::Create(const std::string &, const std::string, bool) { return NULL; }
+#ifdef CPUT_FOR_DX11
+CPUTMaterialDX11 *CPUTMaterialDX11::Create() { return NULL; }
+CPUTMeshDX11 *CPUTMeshDX11::Create() { return NULL; }
+#endif
+
+// A copy of a prop, with the prop's meshes and materials like CPUTModel::LoadModel() with a
+// master model
+class SynthModel : public CPUTModel
+{
+public:
+    SynthModel(const std::vector<CPUTMesh *> &meshes, const std::vector<CPUTMaterial *> &materials, const float4x4 &world)
+    {
+        mMeshCount = (int)meshes.size();
+        mpMesh = new CPUTMesh *[mMeshCount];
+        mpMaterialCount = new int[mMeshCount];
+        mpMaterial = new CPUTMaterial **[mMeshCount];
+        for (int ii = 0; ii < mMeshCount; ii++)
+        {
+            mpMesh[ii] = meshes[ii];
+            mpMesh[ii]->AddRef();
+            mpMaterialCount[ii] = 0;
+            mpMaterial[ii] = NULL;
+            CPUTMaterial *pMaterial = materials[ii];
+            SetMaterial(ii, &pMaterial, 1);
+        }
+        mBoundingBoxCenterObjectSpace = float3(0.0f);
+        mBoundingBoxHalfObjectSpace = float3(0.5f);
+        SetParentMatrix(world);
+    }
+};
+
+// The scene generator: propCount props, each placed copiesPerProp times on a square grid
+class SynthSet : public CPUTAssetSet
+{
+public:
+    SynthSet(int propCount, int copiesPerProp, bool instancedMaterials, bool canDrawInstanced)
+    {
+        mpRootNode = CPUTNullNode::Create();
+        mAssetCount = 1 + propCount * copiesPerProp;
+        mppAssetList = new CPUTRenderNode *[mAssetCount];
+        mppAssetList[0] = mpRootNode;
+        mpRootNode->AddRef();
+
+        const int side = (int)ceil(sqrt((double)(propCount * copiesPerProp)));
+        mGridSize = side * 2.0f;
+        UINT index = 1;
+        for (int prop = 0; prop < propCount; prop++)
+        {
+            std::vector<CPUTMesh *> meshes;
+            std::vector<CPUTMaterial *> materials;
+            for (int mesh = 0; mesh < MESHES_PER_PROP; mesh++)
+            {
+                meshes.push_back(new NullMesh(prop * MESHES_PER_PROP + mesh, canDrawInstanced));
+                materials.push_back(new NullMaterial(instancedMaterials ? new NullMaterial(NULL) : NULL));
+            }
+            for (int copy = 0; copy < copiesPerProp; copy++)
+            {
+                // the props take turns, so each one's copies are spread over the grid
+                const int cell = copy * propCount + prop;
+                SynthModel *pModel = new SynthModel(meshes, materials, float4x4Translation((cell % side) * 2.0f, 0.0f, (cell / side) * 2.0f));
+                pModel->SetParent(mpRootNode);
+                mpRootNode->AddChild(pModel);
+                pModel->UpdateBoundsWorldSpace();
+                mppAssetList[index++] = pModel;
+                mModels.push_back(pModel);
+            }
+            for (int mesh = 0; mesh < MESHES_PER_PROP; mesh++)
+            {
+                meshes[mesh]->Release();
+                materials[mesh]->Release();
+            }
+        }
+        BuildInstanceGroups();
+    }
+
+    const std::vector<CPUTModel *> &GetModels() const { return mModels; }
+    float GetGridSize() const { return mGridSize; }
+
+private:
+    std::vector<CPUTModel *> mModels; // mppAssetList holds the references
+    float                    mGridSize;
+};
+
+//-----------------------------------------------------------------------------
+// What a frame of pSet should draw: each mesh of each model, except the grouped models outside
+// pCamera's frustum when the groups draw them
+static void GetExpected(SynthSet *pSet, CPUTCamera *pCamera, bool instanced, std::vector<DrawnMesh> *pExpected)
+{
+    pExpected->clear();
+    const std::vector<CPUTModel *> &models = pSet->GetModels();
+    for (size_t ii = 0; ii < models.size(); ii++)
+    {
+        CPUTModel *pModel = models[ii];
+        if (instanced && pCamera && pModel->IsDrawnInstanced())
+        {
+            float3 center, half;
+            pModel->GetBoundsWorldSpace(&center, &half);
+            if (!pCamera->mFrustum.IsVisible(center, half))
+            {
+                continue;
+            }
+        }
+        const float4x4 *pWorld = pModel->GetWorldMatrix();
+        for (int mesh = 0; mesh < pModel->GetMeshCount(); mesh++)
+        {
+            DrawnMesh drawn = { ((NullMesh *)pModel->GetMesh(mesh))->GetId(), pWorld->r3.x, pWorld->r3.z };
+            pExpected->push_back(drawn);
+        }
+    }
+    std::sort(pExpected->begin(), pExpected->end());
+}
+
+struct RunResult
+{
+    double mDraws;          // per frame, like the rest
+    double mInstancedDraws;
+    double mMeshesDrawn;
+    double mKilobytes;
+    double mMicroseconds;
+};
+
+//-----------------------------------------------------------------------------
+static bool Run(const char *pName, SynthSet *pSet, CPUTCamera *pCamera, bool instanced, int frameCount, RunResult *pResult)
+{
+    CPUTRenderParameters params;
+    params.mpCamera = pCamera;
+    params.mpPerModelConstants = gpPerModelConstants;
+    params.mpPerInstanceConstants = instanced ? gpPerInstanceConstants : NULL;
+    params.mRenderOnlyVisibleModels = true;
+
+    // the first frame is checked, not timed
+    std::vector<DrawnMesh> drawn, expected;
+    gpDrawn = &drawn;
+    pSet->RenderRecursive(params);
+    gpDrawn = NULL;
+    std::sort(drawn.begin(), drawn.end());
+    GetExpected(pSet, pCamera, instanced, &expected);
+    bool ok = true;
+    if (drawn != expected)
+    {
+        printf("%s: drew %d meshes, expected %d%s\n", pName, (int)drawn.size(), (int)expected.size(),
+            drawn.size() == expected.size() ? " at other positions" : "");
+        ok = false;
+    }
+
+    memset(&gCounters, 0, sizeof(gCounters));
+    params.mDrawCount = 0;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        pSet->RenderRecursive(params);
+    }
+    pResult->mMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / frameCount;
+    pResult->mDraws = (double)gCounters.mDraws / frameCount;
+    pResult->mInstancedDraws = (double)gCounters.mInstancedDraws / frameCount;
+    pResult->mMeshesDrawn = (double)gCounters.mMeshesDrawn / frameCount;
+    pResult->mKilobytes = gCounters.mBytes / 1024.0 / frameCount;
+    if ((UINT)params.mDrawCount != gCounters.mDraws || gCounters.mMeshesDrawn != expected.size() * frameCount)
+    {
+        printf("%s: %d draws counted, %u made, %u meshes drawn in %d frames of %d\n", pName, params.mDrawCount, gCounters.mDraws,
+            gCounters.mMeshesDrawn, frameCount, (int)expected.size());
+        ok = false;
+    }
+    return ok;
+}
+
+// In the middle of the grid, looking along it
+static void PlaceCamera(CPUTCamera *pCamera, SynthSet *pSet)
+{
+    const float center = pSet->GetGridSize() * 0.5f;
+    pCamera->SetPosition(center, 2.0f, center);
+    pCamera->LookAt(center + 100.0f, 0.0f, center);
+    pCamera->Update();
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int frameCount = 200;
+    int propCount = 8;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-frames") && ii + 1 < argc && atoi(argv[ii + 1]) > 0)
+        {
+            frameCount = atoi(argv[++ii]);
+        }
+        else if (!strcmp(argv[ii], "-props") && ii + 1 < argc && atoi(argv[ii + 1]) > 0)
+        {
+            propCount = atoi(argv[++ii]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: InstanceDrawBench [-frames <count>] [-props <count>]\n");
+            return 1;
+        }
+    }
+
+    NullBuffer perModelConstants("$cbPerModelValues", sizeof(CPUTModelConstantBuffer));
+    NullBuffer perInstanceConstants("$cbPerInstanceValues", sizeof(CPUTInstanceConstantBuffer));
+    gpPerModelConstants = &perModelConstants;
+    gpPerInstanceConstants = &perInstanceConstants;
+
+    CPUTCamera *pCamera = CPUTCamera::Create(CPUT_PERSPECTIVE);
+    pCamera->SetFov(DegToRad(60.0f));
+    pCamera->SetAspectRatio(16.0f / 9.0f);
+    pCamera->SetNearPlaneDistance(0.1f);
+    pCamera->SetFarPlaneDistance(1000.0f);
+
+    bool ok = true;
+    const int COPIES[] = { 1, 4, 16, 64, 256, 1024 };
+    for (int cull = 0; cull < 2; cull++)
+    {
+        printf("%d props x copies, %d meshes each, %s, %d frames\n", propCount, MESHES_PER_PROP, cull ? "camera in the grid" : "no camera", frameCount);
+        printf("%6s %7s | %-28s | %-37s\n", "", "", "per model", "instanced");
+        printf("%6s %7s | %7s %9s %10s | %7s %9s %10s %8s | %7s\n", "copies", "models", "draws", "cb KB", "us", "draws", "cb KB", "us", "copies", "speedup");
+        for (size_t cc = 0; cc < sizeof(COPIES) / sizeof(COPIES[0]); cc++)
+        {
+            SynthSet *pSet = new SynthSet(propCount, COPIES[cc], true, true);
+            PlaceCamera(pCamera, pSet);
+            CPUTCamera *pRunCamera = cull ? pCamera : NULL;
+            RunResult perModel, instanced;
+            ok = Run("per model", pSet, pRunCamera, false, frameCount, &perModel) && ok;
+            ok = Run("instanced", pSet, pRunCamera, true, frameCount, &instanced) && ok;
+            printf("%6d %7d | %7.0f %9.1f %10.1f | %7.0f %9.1f %10.1f %8.0f | %6.2fx\n", COPIES[cc], propCount * COPIES[cc],
+                perModel.mDraws, perModel.mKilobytes, perModel.mMicroseconds,
+                instanced.mDraws, instanced.mKilobytes, instanced.mMicroseconds, instanced.mMeshesDrawn / MESHES_PER_PROP,
+                perModel.mMicroseconds / instanced.mMicroseconds);
+            pSet->Release();
+        }
+        printf("\n");
+    }
+
+    for (int variant = 0; variant < 2; variant++)
+    {
+        const char *pName = variant ? "no DrawInstanced" : "no instanced material";
+        SynthSet *pSet = new SynthSet(propCount, 64, variant == 1, variant == 0);
+        PlaceCamera(pCamera, pSet);
+        RunResult result;
+        ok = Run(pName, pSet, pCamera, true, frameCount, &result) && ok;
+        printf("%s: %u groups, %.0f draws, %.0f instanced, %.0f meshes drawn per frame, %.1f us\n", pName, pSet->GetInstanceGroupCount(),
+            result.mDraws, result.mInstancedDraws, result.mMeshesDrawn, result.mMicroseconds);
+        pSet->Release();
+    }
+
+    SAFE_RELEASE(pCamera);
+    CPUTInputLayoutCache::DeleteInputLayoutCache();
+    if (!ok)
+    {
+        printf("FAILED: see above\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,337 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// LodBench: walks a camera through a scene and counts the triangles CPUTScene::Render()
+// would submit each frame with and without levels of detail (CPUT/include/CPUTLod.h).
+// Nothing is drawn; it reads the .scene, the .set files and the meshes of each .mdl and
+// its <model>_lodN.mdl files (written by MeshCook -lod), and picks levels the way
+// CPUTModel::SelectLod() does for a 75 degree, 16:9 camera.
+//
+//   LodBench [-frames <count>] [-lodscale <scale>] <.scene file>
+//
+// The set files named in the scene are relative to its directory, the models sit next to
+// their set, as in Media/Conservatory.scene. Every model is counted in every frame, like
+// ChatHeads (which doesn't cull).
+//
+// The camera starts inside the model with the most triangles, circles it, backs away to 16
+// times its radius and circles the whole scene from there. Every 25 frames a line shows the
+// distance, both triangle counts and the level of each model; at the end there are the
+// averages and how often a model changed level.
+//
+// LodBench.vcxproj builds it with CPUTConfigBlock.cpp, CPUTSceneCache.cpp,
+// CPUTRawMeshData.cpp and CPUTOSServicesWin.cpp; no graphics API is needed. On Linux, from this
+// folder, with Extras/GLStub standing in for the GL headers CPUT.h includes:
+//   g++ -std=c++11 -O2 -DCPUT_OS_LINUX -I../../CPUT/include -I../GLStub LodBench.cpp
+//       ../../CPUT/source/CPUTConfigBlock.cpp ../../CPUT/source/CPUTSceneCache.cpp
+//       ../../CPUT/source/CPUTRawMeshData.cpp ../../CPUT/source/linux/CPUTOSServicesLinux.cpp
+//       -o LodBench
+
+#include "CPUTConfigBlock.h"
+#include "CPUTMesh.h"
+#include "CPUTLod.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+struct BenchModel
+{
+    std::string       mName;
+    float3            mCenter;          // world space bounds
+    float3            mHalf;
+    std::vector<UINT> mTriangleCount;   // per level
+    int               mLod;
+    UINT              mLodChanges;
+};
+
+//-----------------------------------------------------------------------------
+static std::string DirectoryOf(const std::string &fileName)
+{
+    size_t slash = fileName.find_last_of("\\/");
+    return slash == std::string::npos ? "." : fileName.substr(0, slash);
+}
+
+// Triangles in a .mdl, 0 if it can't be read
+//-----------------------------------------------------------------------------
+static UINT CountTriangles(const std::string &fileName, bool *pFound)
+{
+    CPUTFileSystem::CPUTFileView fileView;
+    *pFound = CPUTSUCCESS(fileView.Open(fileName));
+    if (!*pFound)
+    {
+        return 0;
+    }
+    CPUTFileSystem::CPUTmemifstream file(fileView.GetData(), fileView.GetSize());
+    UINT triangles = 0;
+    while (file.good() && !file.eof())
+    {
+        CPUTRawMeshData mesh;
+        if (!mesh.Read(file))
+        {
+            break;
+        }
+        triangles += mesh.mIndexCount / 3;
+    }
+    return triangles;
+}
+
+// The parent matrix of a node, as CPUTRenderNode::LoadParentMatrixFromParameterBlock() reads it
+//-----------------------------------------------------------------------------
+static float4x4 ReadMatrix(CPUTConfigBlock *pBlock)
+{
+    const bool columns = pBlock->GetValueByName("matrixColumn0")->IsValid();
+    const char *pPrefix = columns ? "matrixColumn" : "matrixRow";
+    if (!columns && !pBlock->GetValueByName("matrixRow0")->IsValid())
+    {
+        return float4x4Identity();
+    }
+    float values[4][4];
+    for (int ii = 0; ii < 4; ii++)
+    {
+        pBlock->GetValueByName(pPrefix + cput_to_string(ii))->ValueAsFloatArray(&values[ii][0], 4);
+    }
+    float4x4 matrix((float*)&values[0][0]);
+    if (columns)
+    {
+        matrix.transpose();
+    }
+    return matrix;
+}
+
+// The models of a .set with their world space bounds, as CPUTModel::UpdateBoundsWorldSpace()
+// computes them
+//-----------------------------------------------------------------------------
+static bool LoadSet(const std::string &setFileName, std::vector<BenchModel> *pModels)
+{
+    CPUTConfigFile setFile;
+    if (CPUTFAILED(setFile.LoadFile(setFileName)))
+    {
+        printf("%s: can't read\n", setFileName.c_str());
+        return false;
+    }
+    const std::string directory = DirectoryOf(setFileName);
+    std::vector<float4x4> world(setFile.BlockCount());
+    for (int ii = 0; ii < setFile.BlockCount(); ii++)
+    {
+        CPUTConfigBlock *pBlock = setFile.GetBlock(ii);
+        const int parent = pBlock->GetValueByName("parent")->ValueAsInt();
+        world[ii] = ReadMatrix(pBlock);
+        if (parent >= 0 && parent < ii)
+        {
+            world[ii] = world[ii] * world[parent];
+        }
+        if (pBlock->GetValueByName("type")->ValueAsString() != "model")
+        {
+            continue;
+        }
+
+        BenchModel model;
+        model.mName = pBlock->GetValueByName("name")->ValueAsString();
+        model.mLod = 0;
+        model.mLodChanges = 0;
+        const std::string modelFileName = directory + "/" + model.mName + ".mdl";
+        bool found;
+        model.mTriangleCount.push_back(CountTriangles(modelFileName, &found));
+        if (!found)
+        {
+            printf("%s: can't read\n", modelFileName.c_str());
+            return false;
+        }
+        for (int lod = 1; lod < CPUT_MAX_LOD_COUNT; lod++)
+        {
+            UINT triangles = CountTriangles(CPUTLodFileName(modelFileName, lod), &found);
+            if (!found)
+            {
+                break;
+            }
+            model.mTriangleCount.push_back(triangles);
+        }
+
+        float3 center(0.0f), half(0.0f);
+        pBlock->GetValueByName("BoundingBoxCenter")->ValueAsFloatArray(center.f, 3);
+        pBlock->GetValueByName("BoundingBoxHalf")->ValueAsFloatArray(half.f, 3);
+        float3 minimum(FLT_MAX), maximum(-FLT_MAX);
+        for (int corner = 0; corner < 8; corner++)
+        {
+            float4 position(center.x + ((corner & 1) ? half.x : -half.x),
+                            center.y + ((corner & 2) ? half.y : -half.y),
+                            center.z + ((corner & 4) ? half.z : -half.z), 1.0f);
+            position = position * world[ii];
+            minimum = Min(minimum, float3(position.x, position.y, position.z));
+            maximum = Max(maximum, float3(position.x, position.y, position.z));
+        }
+        model.mCenter = (minimum + maximum) * 0.5f;
+        model.mHalf   = (maximum - minimum) * 0.5f;
+        pModels->push_back(model);
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("usage: LodBench [-frames <count>] [-lodscale <scale>] <.scene file>\n");
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int frameCount = 600;
+    float lodScale = 1.0f;
+    std::string sceneFileName;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-frames") && ii + 1 < argc)
+        {
+            frameCount = std::max(atoi(argv[++ii]), 3);
+        }
+        else if (!strcmp(argv[ii], "-lodscale") && ii + 1 < argc)
+        {
+            lodScale = (float)atof(argv[++ii]);
+        }
+        else if (argv[ii][0] == '-' || !sceneFileName.empty())
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            sceneFileName = argv[ii];
+        }
+    }
+    if (sceneFileName.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    CPUTConfigFile sceneFile;
+    CPUTConfigBlock *pAssets = NULL;
+    if (CPUTFAILED(sceneFile.LoadFile(sceneFileName)) || (pAssets = sceneFile.GetBlockByName("Assets")) == NULL)
+    {
+        printf("%s: not a scene this can read\n", sceneFileName.c_str());
+        return 1;
+    }
+    const std::string mediaDirectory = DirectoryOf(sceneFileName);
+    std::vector<BenchModel> models;
+    for (int ii = 0; ii < pAssets->ValueCount(); ii++)
+    {
+        if (!LoadSet(mediaDirectory + "/" + pAssets->GetValue(ii)->NameAsString(), &models))
+        {
+            return 1;
+        }
+    }
+    if (models.empty())
+    {
+        printf("%s: no models\n", sceneFileName.c_str());
+        return 1;
+    }
+
+    printf("%-16s %8s %s\n", "model", "radius", "triangles per level");
+    float3 sceneMinimum(FLT_MAX), sceneMaximum(-FLT_MAX);
+    for (size_t ii = 0; ii < models.size(); ii++)
+    {
+        const BenchModel &model = models[ii];
+        printf("%-16s %8.2f", model.mName.c_str(), model.mHalf.length());
+        for (size_t lod = 0; lod < model.mTriangleCount.size(); lod++)
+        {
+            printf(" %7u", model.mTriangleCount[lod]);
+        }
+        printf("\n");
+        sceneMinimum = Min(sceneMinimum, model.mCenter - model.mHalf);
+        sceneMaximum = Max(sceneMaximum, model.mCenter + model.mHalf);
+    }
+
+    // The path: a circle inside the most detailed model, out to 16 times its radius, a circle there
+    size_t detailed = 0;
+    for (size_t ii = 1; ii < models.size(); ii++)
+    {
+        if (models[ii].mTriangleCount[0] > models[detailed].mTriangleCount[0])
+        {
+            detailed = ii;
+        }
+    }
+    const float3 focus = models[detailed].mCenter;
+    const float innerRadius = models[detailed].mHalf.length() * 0.25f;
+    const float outerRadius = models[detailed].mHalf.length() * 16.0f;
+    const float sceneRadius = ((sceneMaximum - sceneMinimum) * 0.5f).length();
+    const float4x4 projection = float4x4PerspectiveFovLH(DegToRad(75.0f), 16.0f / 9.0f, outerRadius + sceneRadius * 2.0f, 0.1f);
+    printf("\npath around %s (%.1f %.1f %.1f), %.1f to %.1f away, %d frames, LOD scale %.2f\n\n",
+        models[detailed].mName.c_str(), focus.x, focus.y, focus.z, innerRadius, outerRadius, frameCount, lodScale);
+    printf("%6s %8s %10s %10s  levels\n", "frame", "distance", "full", "LOD");
+
+    double totalFull = 0.0, totalLod = 0.0;
+    UINT minimumLod = UINT_MAX, maximumLod = 0, fullPerFrame = 0;
+    const int third = frameCount / 3;
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        float distance, angle;
+        if (frame < third)
+        {
+            distance = innerRadius;
+            angle = 6.2831853f * frame / third;
+        }
+        else if (frame < 2 * third)
+        {
+            distance = innerRadius + (outerRadius - innerRadius) * (frame - third) / third;
+            angle = 0.0f;
+        }
+        else
+        {
+            distance = outerRadius;
+            angle = 6.2831853f * (frame - 2 * third) / (frameCount - 2 * third);
+        }
+        const float3 camera = focus + float3(sinf(angle) * distance, distance * 0.25f, -cosf(angle) * distance);
+
+        UINT full = 0, lodTriangles = 0;
+        std::string levels;
+        for (size_t ii = 0; ii < models.size(); ii++)
+        {
+            BenchModel &model = models[ii];
+            const int lodCount = (int)model.mTriangleCount.size();
+            const float screenSize = CPUTLodScreenSize(model.mCenter, model.mHalf.length(), camera, projection);
+            const int lod = CPUTLodSelect(screenSize, model.mLod, lodCount, lodScale);
+            model.mLodChanges += (lod != model.mLod) ? 1 : 0;
+            model.mLod = lod;
+            full += model.mTriangleCount[0];
+            lodTriangles += model.mTriangleCount[lod];
+            levels += (char)('0' + lod);
+        }
+        totalFull += full;
+        totalLod += lodTriangles;
+        fullPerFrame = full;
+        minimumLod = std::min(minimumLod, lodTriangles);
+        maximumLod = std::max(maximumLod, lodTriangles);
+        if (frame % 25 == 0 || frame == frameCount - 1)
+        {
+            printf("%6d %8.1f %10u %10u  %s\n", frame, distance, full, lodTriangles, levels.c_str());
+        }
+    }
+
+    UINT lodChanges = 0;
+    for (size_t ii = 0; ii < models.size(); ii++)
+    {
+        lodChanges += models[ii].mLodChanges;
+    }
+    printf("\ntriangles per frame: full %u, LOD %.0f on average (%.1f%%), %u to %u\n",
+        fullPerFrame, totalLod / frameCount, 100.0 * totalLod / std::max(totalFull, 1.0), minimumLod, maximumLod);
+    printf("level changes: %u over %d frames\n", lodChanges, frameCount);
+    return 0;
+}
@@ -0,0 +1,456 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// MeshCook: runs CPUTMeshOptimizer over .mdl files, reports what it gained and optionally
+// writes the optimized files. See CPUT/include/CPUTMeshOptimizer.h for the steps.
+//
+//   MeshCook [-out <directory>] [-lod <levels>] [-skip quantize|weld|cache|fetch|index16] ... <file or directory> ...
+//
+// Directories are searched recursively for .mdl. For every file it prints vertices, bytes
+// per vertex, ACMR (16 entry FIFO), file size, the time to parse the file before and after,
+// and the time optimizing took, i.e. what CPUTMeshOptimizer::SetLoadFlags() would add to
+// loading it. Parse times are from memory, so they leave out the disk.
+//
+// With -out the optimized files are written to that directory under their own names; point
+// the asset set's media directory at a copy holding them. They need a CPUT that knows the
+// tHALF / tSNORM8 element types and 16 bit indices in .mdl files.
+//
+// -lod also writes up to <levels> levels of detail per model (see CPUT/include/CPUTLod.h),
+// into the -out directory or else next to the model. Each level is simplified from the one
+// before to half its triangles, as far as CPUT_LOD_ERROR allows, and then optimized the same
+// way. Levels stop early once a level no longer saves a quarter of the triangles; level
+// files left from an earlier run past the last one written are deleted.
+//
+// MeshCook.vcxproj builds it with CPUTMeshOptimizer.cpp, CPUTMeshSimplifier.cpp,
+// CPUTRawMeshData.cpp and CPUTOSServicesWin.cpp; no graphics API is needed.
+
+#include "CPUTMeshOptimizer.h"
+#include "CPUTMeshSimplifier.h"
+#include "CPUTLod.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#ifdef CPUT_OS_WINDOWS
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+struct ModelReport
+{
+    UINT   mMeshCount;
+    UINT   mTriangleCount;
+    CPUTMeshOptimizerStats mStats;      // summed over the meshes, ACMR weighted by triangles
+    size_t mBytesBefore;
+    size_t mBytesAfter;
+    double mParseMsBefore;
+    double mParseMsAfter;
+    double mOptimizeMs;
+};
+
+//-----------------------------------------------------------------------------
+static bool IsModelFile(const std::string &fileName)
+{
+    size_t dot = fileName.find_last_of('.');
+    return dot != std::string::npos && fileName.substr(dot) == ".mdl";
+}
+
+// <model>_lodN.mdl, written by -lod
+//-----------------------------------------------------------------------------
+static bool IsLodFile(const std::string &fileName)
+{
+    for (int lod = 1; lod < CPUT_MAX_LOD_COUNT; lod++)
+    {
+        const std::string suffix = CPUTLodFileName(".mdl", lod);
+        if (fileName.size() > suffix.size() && fileName.compare(fileName.size() - suffix.size(), suffix.size(), suffix) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+static void FindModels(const std::string &path, std::vector<std::string> *pFiles)
+{
+#ifdef CPUT_OS_WINDOWS
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        pFiles->push_back(path);
+        return;
+    }
+    WIN32_FIND_DATAA findData;
+    HANDLE hFind = FindFirstFileA((path + "\\*").c_str(), &findData);
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    do
+    {
+        std::string name = findData.cFileName;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string child = path + "\\" + name;
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            FindModels(child, pFiles);
+        }
+        else if (IsModelFile(child))
+        {
+            pFiles->push_back(child);
+        }
+    } while (FindNextFileA(hFind, &findData));
+    FindClose(hFind);
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode))
+    {
+        pFiles->push_back(path);
+        return;
+    }
+    DIR *pDir = opendir(path.c_str());
+    if (!pDir)
+    {
+        return;
+    }
+    while (struct dirent *pEntry = readdir(pDir))
+    {
+        std::string name = pEntry->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string child = path + "/" + name;
+        if (stat(child.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+        {
+            FindModels(child, pFiles);
+        }
+        else if (IsModelFile(child))
+        {
+            pFiles->push_back(child);
+        }
+    }
+    closedir(pDir);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+static double NowMs()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Reads the meshes the way CPUTModel::LoadModelPayload() does, and optionally optimizes and
+// appends each one to pOutput. Returns the number of meshes, -1 if the file is bad.
+//-----------------------------------------------------------------------------
+static int ParseModel(const char *pData, size_t size, UINT flags, std::vector<char> *pOutput, ModelReport *pReport)
+{
+    CPUTFileSystem::CPUTmemifstream file(pData, (uint64_t)size);
+    int meshCount = 0;
+    while (file.good() && !file.eof())
+    {
+        CPUTRawMeshData mesh;
+        if (!mesh.Read(file))
+        {
+            break;
+        }
+        meshCount++;
+        if (!pOutput)
+        {
+            continue;
+        }
+        CPUTMeshOptimizerStats stats;
+        CPUTMeshOptimizer::Optimize(mesh, flags, &stats);
+        mesh.Write(pOutput);
+        if (pReport)
+        {
+            const UINT triangles = mesh.mIndexCount / 3;
+            pReport->mTriangleCount            += triangles;
+            pReport->mStats.mVertexCountBefore += stats.mVertexCountBefore;
+            pReport->mStats.mVertexCountAfter  += stats.mVertexCountAfter;
+            pReport->mStats.mStrideBefore      += stats.mStrideBefore * stats.mVertexCountBefore;
+            pReport->mStats.mStrideAfter       += stats.mStrideAfter * stats.mVertexCountAfter;
+            pReport->mStats.mACMRBefore        += stats.mACMRBefore * triangles;
+            pReport->mStats.mACMRAfter         += stats.mACMRAfter * triangles;
+        }
+    }
+    return file.eof() ? meshCount : -1;
+}
+
+// Milliseconds per parse, repeated until the clock's resolution doesn't matter
+//-----------------------------------------------------------------------------
+static double TimeParse(const char *pData, size_t size, UINT flags, bool optimize)
+{
+    int runs = 0;
+    const double start = NowMs();
+    double elapsed = 0.0;
+    do
+    {
+        std::vector<char> output;
+        ParseModel(pData, size, flags, optimize ? &output : NULL, NULL);
+        runs++;
+        elapsed = NowMs() - start;
+    } while (elapsed < 200.0 && runs < 1000);
+    return elapsed / runs;
+}
+
+//-----------------------------------------------------------------------------
+static bool WriteModelFile(const std::string &fileName, const std::vector<char> &data)
+{
+    const std::string tempFileName = fileName + ".tmp";
+    FILE *pFile = fopen(tempFileName.c_str(), "wb");
+    if (!pFile)
+    {
+        return false;
+    }
+    bool ok = fwrite(&data[0], 1, data.size(), pFile) == data.size();
+    ok &= fclose(pFile) == 0;
+    remove(fileName.c_str());
+    if (!ok || 0 != rename(tempFileName.c_str(), fileName.c_str()))
+    {
+        remove(tempFileName.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Half the diagonal of the box around all the model's float3 positions
+//-----------------------------------------------------------------------------
+static float ModelRadius(const std::vector<char> &model)
+{
+    float3 minimum(FLT_MAX), maximum(-FLT_MAX);
+    CPUTFileSystem::CPUTmemifstream file(&model[0], (uint64_t)model.size());
+    while (file.good() && !file.eof())
+    {
+        CPUTRawMeshData mesh;
+        if (!mesh.Read(file))
+        {
+            break;
+        }
+        for (UINT ii = 0; ii < mesh.mFormatDescriptorCount; ii++)
+        {
+            const CPUTVertexElementDesc &element = mesh.mpElements[ii];
+            if (element.mVertexElementSemantic != CPUT_VERTEX_ELEMENT_POSITON ||
+                element.mVertexElementType != eCPUT_VERTEX_ELEMENT_TYPE::tFLOAT || element.mElementSizeInBytes < 3 * sizeof(float))
+            {
+                continue;
+            }
+            for (UINT vv = 0; vv < mesh.mVertexCount; vv++)
+            {
+                float position[3];
+                memcpy(position, mesh.mpVertices + (size_t)vv * mesh.mStride + element.mOffset, sizeof(position));
+                minimum = Min(minimum, float3(position[0], position[1], position[2]));
+                maximum = Max(maximum, float3(position[0], position[1], position[2]));
+            }
+            break;
+        }
+    }
+    return minimum.x <= maximum.x ? (maximum - minimum).length() * 0.5f : 0.0f;
+}
+
+// Writes the levels of detail of an optimized model next to modelFileName and prints a line
+// for each. Returns false if one couldn't be written.
+//-----------------------------------------------------------------------------
+static bool CookLods(const std::vector<char> &model, UINT triangleCount, const std::string &modelFileName, int levels, UINT flags)
+{
+    const float radius = ModelRadius(model);
+    std::vector<char> previous = model;
+    UINT previousTriangleCount = triangleCount;
+    bool ok = true;
+    int lod = 1;
+    for (; lod <= levels; lod++)
+    {
+        const float maxError = radius * CPUT_LOD_ERROR * (float)(1 << (lod - 1));
+        const double start = NowMs();
+        std::vector<char> output;
+        UINT triangles = 0;
+        float error = 0.0f;
+        CPUTFileSystem::CPUTmemifstream file(&previous[0], (uint64_t)previous.size());
+        while (file.good() && !file.eof())
+        {
+            CPUTRawMeshData mesh;
+            if (!mesh.Read(file))
+            {
+                break;
+            }
+            error = std::max(error, CPUTMeshSimplifier::Simplify(mesh, mesh.mIndexCount / 6 * 3, maxError));
+            CPUTMeshOptimizer::Optimize(mesh, flags);
+            triangles += mesh.mIndexCount / 3;
+            mesh.Write(&output);
+        }
+        if (triangles > previousTriangleCount / 4 * 3)
+        {
+            break;
+        }
+        const std::string lodFileName = CPUTLodFileName(modelFileName, lod);
+        if (!WriteModelFile(lodFileName, output))
+        {
+            printf("%s: unable to write %s\n", modelFileName.c_str(), lodFileName.c_str());
+            ok = false;
+            break;
+        }
+        printf("  lod%d %8u triangles (%4.1f%%), error %.2f%% of the radius, %.2f ms\n", lod, triangles,
+            100.0 * triangles / std::max(1u, triangleCount), radius > 0.0f ? 100.0 * error / radius : 0.0, NowMs() - start);
+        previous.swap(output);
+        previousTriangleCount = triangles;
+    }
+    for (; lod < CPUT_MAX_LOD_COUNT; lod++)
+    {
+        remove(CPUTLodFileName(modelFileName, lod).c_str());
+    }
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("usage: MeshCook [-out <directory>] [-lod <levels>] [-skip quantize|weld|cache|fetch|index16] ... <file or directory> ...\n");
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    UINT flags = CPUT_MESH_OPTIMIZE_ALL;
+    std::string outDirectory;
+    int lodLevels = 0;
+    std::vector<std::string> files;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-out") && ii + 1 < argc)
+        {
+            outDirectory = argv[++ii];
+        }
+        else if (!strcmp(argv[ii], "-lod") && ii + 1 < argc)
+        {
+            lodLevels = std::min(std::max(atoi(argv[++ii]), 0), CPUT_MAX_LOD_COUNT - 1);
+        }
+        else if (!strcmp(argv[ii], "-skip") && ii + 1 < argc)
+        {
+            const char *pStep = argv[++ii];
+            if (!strcmp(pStep, "quantize"))     { flags &= ~CPUT_MESH_OPTIMIZE_QUANTIZE; }
+            else if (!strcmp(pStep, "weld"))    { flags &= ~CPUT_MESH_OPTIMIZE_WELD; }
+            else if (!strcmp(pStep, "cache"))   { flags &= ~CPUT_MESH_OPTIMIZE_VERTEX_CACHE; }
+            else if (!strcmp(pStep, "fetch"))   { flags &= ~CPUT_MESH_OPTIMIZE_VERTEX_FETCH; }
+            else if (!strcmp(pStep, "index16")) { flags &= ~CPUT_MESH_OPTIMIZE_INDEX16; }
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else if (argv[ii][0] == '-')
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            FindModels(argv[ii], &files);
+        }
+    }
+    if (files.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    printf("%-24s %6s %15s %11s %11s %15s %15s %8s\n", "model", "meshes", "vertices", "bytes/vtx", "ACMR", "KB", "parse ms", "opt ms");
+    ModelReport total;
+    memset(&total, 0, sizeof(total));
+    int failed = 0;
+    for (size_t ii = 0; ii < files.size(); ii++)
+    {
+        const std::string name = CPUTFileSystem::basename(files[ii]);
+        if (lodLevels > 0 && IsLodFile(name))
+        {
+            continue;
+        }
+        CPUTFileSystem::CPUTFileView fileView;
+        if (CPUTFAILED(fileView.Open(files[ii])))
+        {
+            printf("%s: can't open\n", files[ii].c_str());
+            failed++;
+            continue;
+        }
+
+        ModelReport report;
+        memset(&report, 0, sizeof(report));
+        std::vector<char> output;
+        int meshCount = ParseModel(fileView.GetData(), (size_t)fileView.GetSize(), flags, &output, &report);
+        if (meshCount <= 0 || output.empty() || ParseModel(&output[0], output.size(), CPUT_MESH_OPTIMIZE_NONE, NULL, NULL) != meshCount)
+        {
+            printf("%s: not a .mdl this can read, or the result doesn't read back\n", files[ii].c_str());
+            failed++;
+            continue;
+        }
+        report.mMeshCount     = (UINT)meshCount;
+        report.mBytesBefore   = (size_t)fileView.GetSize();
+        report.mBytesAfter    = output.size();
+        report.mParseMsBefore = TimeParse(fileView.GetData(), (size_t)fileView.GetSize(), flags, false);
+        report.mParseMsAfter  = TimeParse(&output[0], output.size(), flags, false);
+        report.mOptimizeMs    = TimeParse(fileView.GetData(), (size_t)fileView.GetSize(), flags, true) - report.mParseMsBefore;
+
+        if (!outDirectory.empty() && !WriteModelFile(outDirectory + "/" + name, output))
+        {
+            printf("%s: unable to write %s/%s\n", files[ii].c_str(), outDirectory.c_str(), name.c_str());
+            failed++;
+        }
+
+        const CPUTMeshOptimizerStats &stats = report.mStats;
+        printf("%-24s %6u %7u->%-7u %5.1f->%-5.1f %5.2f->%-5.2f %7.1f->%-7.1f %7.2f->%-7.2f %8.2f\n", name.c_str(), report.mMeshCount,
+            stats.mVertexCountBefore, stats.mVertexCountAfter,
+            (double)stats.mStrideBefore / std::max(1u, stats.mVertexCountBefore), (double)stats.mStrideAfter / std::max(1u, stats.mVertexCountAfter),
+            stats.mACMRBefore / std::max(1u, report.mTriangleCount), stats.mACMRAfter / std::max(1u, report.mTriangleCount),
+            report.mBytesBefore / 1024.0, report.mBytesAfter / 1024.0,
+            report.mParseMsBefore, report.mParseMsAfter, report.mOptimizeMs);
+
+        if (lodLevels > 0 && !CookLods(output, report.mTriangleCount, outDirectory.empty() ? files[ii] : outDirectory + "/" + name, lodLevels, flags))
+        {
+            failed++;
+        }
+
+        total.mMeshCount     += report.mMeshCount;
+        total.mTriangleCount += report.mTriangleCount;
+        total.mStats.mVertexCountBefore += stats.mVertexCountBefore;
+        total.mStats.mVertexCountAfter  += stats.mVertexCountAfter;
+        total.mStats.mStrideBefore      += stats.mStrideBefore;
+        total.mStats.mStrideAfter       += stats.mStrideAfter;
+        total.mStats.mACMRBefore        += stats.mACMRBefore;
+        total.mStats.mACMRAfter         += stats.mACMRAfter;
+        total.mBytesBefore   += report.mBytesBefore;
+        total.mBytesAfter    += report.mBytesAfter;
+        total.mParseMsBefore += report.mParseMsBefore;
+        total.mParseMsAfter  += report.mParseMsAfter;
+        total.mOptimizeMs    += report.mOptimizeMs;
+    }
+
+    const CPUTMeshOptimizerStats &stats = total.mStats;
+    printf("%-24s %6u %7u->%-7u %5.1f->%-5.1f %5.2f->%-5.2f %7.1f->%-7.1f %7.2f->%-7.2f %8.2f\n", "total", total.mMeshCount,
+        stats.mVertexCountBefore, stats.mVertexCountAfter,
+        (double)stats.mStrideBefore / std::max(1u, stats.mVertexCountBefore), (double)stats.mStrideAfter / std::max(1u, stats.mVertexCountAfter),
+        stats.mACMRBefore / std::max(1u, total.mTriangleCount), stats.mACMRAfter / std::max(1u, total.mTriangleCount),
+        total.mBytesBefore / 1024.0, total.mBytesAfter / 1024.0,
+        total.mParseMsBefore, total.mParseMsAfter, total.mOptimizeMs);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,342 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// MetricsSampler: runs ChatheadsNativePOC's SystemMetrics and MetricsRecorder outside ChatHeads,
+// with a stand-in for its frame loop, and checks the file the recorder wrote.
+//
+//   MetricsSampler [-seconds <count>] [-interval <ms>] [-lp] <output file>
+//
+// It prints what SystemMetrics reads (cores, memory, CPU after some busy work) and how long a
+// Sample() plus PhysicalMemoryUsedByProcess() takes. Then MetricsRecorder writes a row every
+// -interval milliseconds (default 250), as CSV or with -lp as InfluxDB line protocol, while for
+// -seconds seconds (default 5):
+// - the main thread runs 60 frames a second, each with 1 ms of work reported as a decode and
+//   4 ms more, reporting the frame time
+// - another thread does 3 ms of work reported as an encode every 33 ms
+// Afterwards the file is read back: every row has to have the same columns, there has to be a row
+// per interval, and the frames, encodes and decodes in it have to add up to what was reported.
+//
+// MetricsSampler.vcxproj builds it with SystemMetricsWin.cpp and MetricsRecorder.cpp. Elsewhere
+// it builds with SystemMetricsLinux.cpp instead, from this folder:
+//   g++ -std=c++11 -O2 -pthread -I../../ChatheadsNativePOC MetricsSampler.cpp
+//       ../../ChatheadsNativePOC/SystemMetricsLinux.cpp ../../ChatheadsNativePOC/MetricsRecorder.cpp
+
+#include "MetricsRecorder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+static volatile double sBusySink;
+
+// Keeps this thread's core busy for ms milliseconds
+static void Busy(double ms)
+{
+    const double end = SystemMetrics::GetTimeSeconds() + ms / 1000.0;
+    double value = 0.0;
+    while (SystemMetrics::GetTimeSeconds() < end)
+    {
+        for (int ii = 0; ii < 1000; ii++)
+        {
+            value += ii * 0.5;
+        }
+    }
+    sBusySink = value;
+}
+
+static void SleepUntil(double time)
+{
+    const double now = SystemMetrics::GetTimeSeconds();
+    if (time > now)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds((long long)((time - now) * 1e6)));
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void PrintSystem()
+{
+    SystemMetrics metrics;
+    if (!metrics.Init())
+    {
+        printf("SystemMetrics::Init() failed, the numbers below are 0\n");
+    }
+    const double MB = 1024.0 * 1024.0;
+    printf("%d cores, memory %.0f / %.0f MB used, virtual %.0f / %.0f MB, process RSS %.1f MB, virtual %.1f MB\n",
+        metrics.NumProcessors(), metrics.PhysicalMemoryUsed() / MB, metrics.TotalPhysicalMemory() / MB,
+        metrics.VirtualMemoryUsed() / MB, metrics.TotalVirtualMemory() / MB,
+        metrics.PhysicalMemoryUsedByProcess() / MB, metrics.VirtualMemoryUsedByProcess() / MB);
+
+    Busy(300.0);
+    metrics.Sample();
+    printf("after 300 ms busy: CPU %.1f%%, core 0 %.1f%%, process %.1f%%\n", metrics.CPUUsed(), metrics.CoreCPUUsed(0), metrics.CPUUsedByProcess());
+
+    const int sampleCount = 2000;
+    const double start = SystemMetrics::GetTimeSeconds();
+    for (int ii = 0; ii < sampleCount; ii++)
+    {
+        metrics.Sample();
+        metrics.PhysicalMemoryUsedByProcess();
+    }
+    printf("Sample() + PhysicalMemoryUsedByProcess(): %.2f us\n", (SystemMetrics::GetTimeSeconds() - start) / sampleCount * 1e6);
+    metrics.Shutdown();
+}
+
+// What the recorder was told, to check its file against
+struct Reported
+{
+    std::atomic<int> mFrames;
+    std::atomic<int> mEncodes;
+    std::atomic<int> mDecodes;
+
+    Reported() : mFrames(0), mEncodes(0), mDecodes(0) {}
+};
+
+//-----------------------------------------------------------------------------
+static void RunFrames(MetricsRecorder &recorder, double seconds, Reported *pReported)
+{
+    std::atomic<bool> stop(false);
+    std::thread encoder([&]()
+    {
+        double next = SystemMetrics::GetTimeSeconds();
+        while (!stop)
+        {
+            const double start = SystemMetrics::GetTimeSeconds();
+            Busy(3.0);
+            recorder.AddEncodeTime((SystemMetrics::GetTimeSeconds() - start) * 1000.0);
+            pReported->mEncodes++;
+            next += 0.033;
+            SleepUntil(next);
+        }
+    });
+
+    const double end = SystemMetrics::GetTimeSeconds() + seconds;
+    double next = SystemMetrics::GetTimeSeconds();
+    while (SystemMetrics::GetTimeSeconds() < end)
+    {
+        const double frameStart = SystemMetrics::GetTimeSeconds();
+        Busy(1.0);
+        recorder.AddDecodeTime((SystemMetrics::GetTimeSeconds() - frameStart) * 1000.0);
+        pReported->mDecodes++;
+        Busy(4.0);
+        recorder.AddFrameTime((SystemMetrics::GetTimeSeconds() - frameStart) * 1000.0);
+        pReported->mFrames++;
+        next += 1.0 / 60.0;
+        SleepUntil(next);
+    }
+    stop = true;
+    encoder.join();
+}
+
+static void Split(const std::string &line, char separator, std::vector<std::string> *pFields)
+{
+    pFields->clear();
+    size_t start = 0;
+    for (;;)
+    {
+        const size_t end = line.find(separator, start);
+        pFields->push_back(line.substr(start, end == std::string::npos ? std::string::npos : end - start));
+        if (end == std::string::npos)
+        {
+            return;
+        }
+        start = end + 1;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Reads the recorder's file back. Line protocol rows are "chatheads name=value,... timestamp".
+static bool CheckFile(const char *pFileName, bool lineProtocol, int expectedRows, const Reported &reported)
+{
+    FILE *pFile = fopen(pFileName, "r");
+    if (!pFile)
+    {
+        printf("%s: can't open\n", pFileName);
+        return false;
+    }
+    std::vector<std::string> lines;
+    char buffer[4096];
+    while (fgets(buffer, sizeof(buffer), pFile))
+    {
+        std::string line = buffer;
+        while (!line.empty() && (line[line.size() - 1] == '\n' || line[line.size() - 1] == '\r'))
+        {
+            line.erase(line.size() - 1);
+        }
+        lines.push_back(line);
+    }
+    fclose(pFile);
+
+    std::vector<std::string> names;
+    size_t firstRow = 0;
+    if (!lineProtocol)
+    {
+        if (lines.empty())
+        {
+            printf("%s: empty\n", pFileName);
+            return false;
+        }
+        Split(lines[0], ',', &names);
+        firstRow = 1;
+    }
+
+    long long frames = 0, encodes = 0, decodes = 0;
+    double maxProcessCPU = 0.0;
+    std::vector<std::string> fields;
+    for (size_t ii = firstRow; ii < lines.size(); ii++)
+    {
+        std::vector<std::string> values;
+        if (lineProtocol)
+        {
+            std::vector<std::string> parts;
+            Split(lines[ii], ' ', &parts);
+            if (parts.size() != 3 || parts[0] != "chatheads")
+            {
+                printf("%s:%d: not a chatheads line\n", pFileName, (int)ii + 1);
+                return false;
+            }
+            Split(parts[1], ',', &fields);
+            std::vector<std::string> rowNames;
+            for (size_t jj = 0; jj < fields.size(); jj++)
+            {
+                const size_t equals = fields[jj].find('=');
+                rowNames.push_back(fields[jj].substr(0, equals));
+                values.push_back(equals == std::string::npos ? std::string() : fields[jj].substr(equals + 1));
+            }
+            if (names.empty())
+            {
+                names = rowNames;
+            }
+            if (rowNames != names)
+            {
+                printf("%s:%d: different fields from the first line\n", pFileName, (int)ii + 1);
+                return false;
+            }
+        }
+        else
+        {
+            Split(lines[ii], ',', &values);
+            if (values.size() != names.size())
+            {
+                printf("%s:%d: %d values for %d columns\n", pFileName, (int)ii + 1, (int)values.size(), (int)names.size());
+                return false;
+            }
+        }
+        for (size_t jj = 0; jj < names.size(); jj++)
+        {
+            // Line protocol integers end in i
+            const long long count = atoll(values[jj].c_str());
+            if (names[jj] == "frames")
+            {
+                frames += count;
+            }
+            else if (names[jj] == "encodes")
+            {
+                encodes += count;
+            }
+            else if (names[jj] == "decodes")
+            {
+                decodes += count;
+            }
+            else if (names[jj] == "process_cpu" && atof(values[jj].c_str()) > maxProcessCPU)
+            {
+                maxProcessCPU = atof(values[jj].c_str());
+            }
+        }
+    }
+
+    const int rows = (int)(lines.size() - firstRow);
+    printf("%s: %d rows of %d columns, %lld frames, %lld encodes, %lld decodes, process CPU up to %.1f%%\n",
+        pFileName, rows, (int)names.size(), frames, encodes, decodes, maxProcessCPU);
+    bool ok = true;
+    if (rows < expectedRows)
+    {
+        printf("FAILED: %d rows, expected at least %d\n", rows, expectedRows);
+        ok = false;
+    }
+    if (frames != reported.mFrames || encodes != reported.mEncodes || decodes != reported.mDecodes)
+    {
+        printf("FAILED: reported %d frames, %d encodes and %d decodes\n", (int)reported.mFrames, (int)reported.mEncodes, (int)reported.mDecodes);
+        ok = false;
+    }
+    if (maxProcessCPU <= 0.0)
+    {
+        printf("FAILED: the process never used any CPU\n");
+        ok = false;
+    }
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    double seconds = 5.0;
+    int intervalMs = 250;
+    bool lineProtocol = false;
+    const char *pFileName = NULL;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-seconds") && ii + 1 < argc && atof(argv[ii + 1]) > 0.0)
+        {
+            seconds = atof(argv[++ii]);
+        }
+        else if (!strcmp(argv[ii], "-interval") && ii + 1 < argc && atoi(argv[ii + 1]) > 0)
+        {
+            intervalMs = atoi(argv[++ii]);
+        }
+        else if (!strcmp(argv[ii], "-lp"))
+        {
+            lineProtocol = true;
+        }
+        else if (argv[ii][0] != '-' && !pFileName)
+        {
+            pFileName = argv[ii];
+        }
+        else
+        {
+            pFileName = NULL;
+            break;
+        }
+    }
+    if (!pFileName)
+    {
+        fprintf(stderr, "usage: MetricsSampler [-seconds <count>] [-interval <ms>] [-lp] <output file>\n");
+        return 1;
+    }
+
+    PrintSystem();
+
+    MetricsRecorder recorder;
+    if (!recorder.Start(pFileName, lineProtocol ? MetricsRecorder::LineProtocol : MetricsRecorder::CSV, intervalMs))
+    {
+        printf("%s: can't write\n", pFileName);
+        return 1;
+    }
+    Reported reported;
+    RunFrames(recorder, seconds, &reported);
+    // One more row after the last report, so the file has all of them
+    std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs * 3 / 2));
+    recorder.Stop();
+
+    // A row can be late under load, don't count on the last one
+    const int expectedRows = (int)(seconds * 1000.0 / intervalMs);
+    return CheckFile(pFileName, lineProtocol, expectedRows, reported) ? 0 : 1;
+}
@@ -0,0 +1,482 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// MovieDecodeBench: the per frame CPU cost of ChatHeads' movie texture, decoding a clip and
+// copying each frame into texture memory the ways ChatHeads::UpdateMovieTexture can.
+//
+//   MovieDecodeBench [-frames <count>] <.ogv file>
+//   MovieDecodeBench [-frames <count>] -synthetic <width> <height>
+//
+// The clip is decoded on this thread, one frame at a time, four times:
+// - rgbx        TH_RGBX frames copied row by row, as UpdateMovieTexture did before YUV frames
+// - yuvx        TH_YUVX frames copied as they are, for PSMainYUVX to convert (bMovieShaderYUV)
+// - yuvx sse2   TH_YUVX frames converted with ConvertYUVXToRGBX while they're copied, the
+//               fallback without the YUV shader
+// - yuvx scalar the same with ConvertYUVXToRGBXScalar, for comparison
+// For each it prints the milliseconds per frame the decoder took, including its conversion to
+// the output mode, and the copy took. The sse2 frames are checked against the scalar ones, and
+// the first converted frame is compared with the decoder's own RGBX frame (its conversion isn't
+// the same, so that's the largest difference, not a failure).
+//
+// The texture memory has its rows at a 256 byte pitch, as a mapped D3D11 texture may, so the
+// copy is row by row when the width isn't a multiple of 64. At most -frames frames (default 300)
+// are decoded.
+//
+// With -synthetic there's no .ogv: 4:2:0 planes of a moving pattern stand in for libtheora's
+// output, and "decoding" is only TheoraPlayer's last step, converting or repacking them to the
+// output mode (in plain C with the same BT.601 coefficients). That's how it runs where
+// TheoraPlayer isn't; TheoraPlayer only ships Windows libraries, so elsewhere only -synthetic
+// is built.
+//
+// MovieDecodeBench.vcxproj builds it with YUVConvert.cpp from ChatheadsNativePOC and links
+// TheoraPlayer; libtheoraplayer.dll (ChatheadsNativePOC/build/bin) has to be next to it.
+
+#include "YUVConvert.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include "TheoraPlayer.h"
+#include "TheoraException.h"
+#endif
+
+static const int TEXTURE_PITCH_ALIGNMENT = 256;
+
+enum OutputMode
+{
+    OUTPUT_RGBX,
+    OUTPUT_YUVX,
+};
+
+// Where the frames come from. Decode() returns NULL at the end of the clip.
+class MovieSource
+{
+public:
+    virtual ~MovieSource() {}
+    virtual bool Open(OutputMode mode) = 0;
+    // Whatever comes before the decode and isn't timed
+    virtual void PrepareFrame() {}
+    virtual const unsigned char *Decode(int *pPitch) = 0;
+    virtual void Close() = 0;
+
+    int mWidth;
+    int mHeight;
+};
+
+static unsigned char Clamp255(int value)
+{
+    return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// Planes of a pattern that moves every frame, converted or repacked to 4 bytes per pixel the
+// way TheoraPlayer's pixel transforms do
+class SyntheticSource : public MovieSource
+{
+public:
+    SyntheticSource(int width, int height, int frameCount) : mFrameCount(frameCount)
+    {
+        mWidth = width;
+        mHeight = height;
+    }
+
+    bool Open(OutputMode mode)
+    {
+        mMode = mode;
+        mFrame = 0;
+        mY.resize((size_t)mWidth * mHeight);
+        mU.resize((size_t)((mWidth + 1) / 2) * ((mHeight + 1) / 2));
+        mV.resize(mU.size());
+        mOutput.resize((size_t)mWidth * mHeight * 4);
+        return true;
+    }
+
+    // The planes would come out of libtheora, making them isn't part of the decode time
+    void PrepareFrame()
+    {
+        if (mFrame == mFrameCount)
+        {
+            return;
+        }
+        const int chromaWidth = (mWidth + 1) / 2;
+        for (int y = 0; y < mHeight; y++)
+        {
+            for (int x = 0; x < mWidth; x++)
+            {
+                mY[(size_t)y * mWidth + x] = (unsigned char)(16 + ((x + y + mFrame * 3) * 7 + ((x * y) >> 5)) % 220);
+            }
+        }
+        for (size_t ii = 0; ii < mU.size(); ii++)
+        {
+            const int x = (int)(ii % chromaWidth);
+            const int y = (int)(ii / chromaWidth);
+            mU[ii] = (unsigned char)(16 + (x * 3 + mFrame) % 225);
+            mV[ii] = (unsigned char)(16 + (y * 5 + mFrame * 2) % 225);
+        }
+    }
+
+    const unsigned char *Decode(int *pPitch)
+    {
+        if (mFrame == mFrameCount)
+        {
+            return NULL;
+        }
+        mFrame++;
+
+        const int chromaWidth = (mWidth + 1) / 2;
+        for (int y = 0; y < mHeight; y++)
+        {
+            const unsigned char *pY = &mY[(size_t)y * mWidth];
+            const unsigned char *pU = &mU[(size_t)(y / 2) * chromaWidth];
+            const unsigned char *pV = &mV[(size_t)(y / 2) * chromaWidth];
+            unsigned char *pOut = &mOutput[(size_t)y * mWidth * 4];
+            for (int x = 0; x < mWidth; x++, pOut += 4)
+            {
+                if (mMode == OUTPUT_YUVX)
+                {
+                    pOut[0] = pY[x];
+                    pOut[1] = pU[x / 2];
+                    pOut[2] = pV[x / 2];
+                    pOut[3] = 255;
+                    continue;
+                }
+                const int c = pY[x] - 16;
+                const int d = pU[x / 2] - 128;
+                const int e = pV[x / 2] - 128;
+                pOut[0] = Clamp255((298 * c + 409 * e + 128) >> 8);
+                pOut[1] = Clamp255((298 * c - 100 * d - 208 * e + 128) >> 8);
+                pOut[2] = Clamp255((298 * c + 516 * d + 128) >> 8);
+                pOut[3] = 255;
+            }
+        }
+        *pPitch = mWidth * 4;
+        return &mOutput[0];
+    }
+
+    void Close() {}
+
+    int                        mFrameCount;
+    int                        mFrame;
+    OutputMode                 mMode;
+    std::vector<unsigned char> mY;
+    std::vector<unsigned char> mU;
+    std::vector<unsigned char> mV;
+    std::vector<unsigned char> mOutput;
+};
+
+#ifdef _WIN32
+// TheoraPlayer with no worker threads: Decode() does the work the worker thread would, here
+class TheoraSource : public MovieSource
+{
+public:
+    TheoraSource(const char *pFileName, int frameCount) : mFileName(pFileName), mFrameCount(frameCount), mpManager(NULL), mpClip(NULL), mpFrame(NULL) {}
+    ~TheoraSource() { Close(); }
+
+    bool Open(OutputMode mode)
+    {
+        Close();
+        mpManager = new TheoraVideoManager(0);
+        mpManager->setAudioInterfaceFactory(NULL);
+        try
+        {
+            mpClip = mpManager->createVideoClip(mFileName, (mode == OUTPUT_YUVX) ? TH_YUVX : TH_RGBX, 2);
+        }
+        catch (_TheoraGenericException *e)
+        {
+            printf("%s: %s\n", mFileName.c_str(), e->getErrorText().c_str());
+            return false;
+        }
+        mpClip->setAutoRestart(false);
+        mWidth = mpClip->getWidth();
+        mHeight = mpClip->getHeight();
+        mFrame = 0;
+        return true;
+    }
+
+    const unsigned char *Decode(int *pPitch)
+    {
+        if (mpFrame)
+        {
+            mpClip->popFrame();
+            mpFrame = NULL;
+        }
+        if (mFrame == mFrameCount || !mpClip->decodeNextFrame())
+        {
+            return NULL;
+        }
+        mpClip->updateToNextFrame();
+        mpFrame = mpClip->getNextFrame();
+        if (!mpFrame)
+        {
+            return NULL;
+        }
+        mFrame++;
+        *pPitch = mpFrame->getStride() * 4;
+        return mpFrame->getBuffer();
+    }
+
+    void Close()
+    {
+        if (mpClip)
+        {
+            mpManager->destroyVideoClip(mpClip);
+            mpClip = NULL;
+        }
+        delete mpManager;
+        mpManager = NULL;
+        mpFrame = NULL;
+    }
+
+    std::string         mFileName;
+    int                 mFrameCount;
+    int                 mFrame;
+    TheoraVideoManager *mpManager;
+    TheoraVideoClip    *mpClip;
+    TheoraVideoFrame   *mpFrame;
+};
+#endif
+
+enum UploadMode
+{
+    UPLOAD_ROWS,        // the copy UpdateMovieTexture did for RGBX frames
+    UPLOAD_COPY,        // bMovieShaderYUV: one memcpy when the pitches match
+    UPLOAD_SSE2,        // ConvertYUVXToRGBX
+    UPLOAD_SCALAR,      // ConvertYUVXToRGBXScalar
+};
+
+struct ModeResult
+{
+    int    mFrameCount;
+    double mDecodeMs;
+    double mUploadMs;
+};
+
+static double Milliseconds(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//-----------------------------------------------------------------------------
+static void Upload(UploadMode mode, const unsigned char *pFrame, int framePitch, unsigned char *pTexture, int texturePitch, int width, int height)
+{
+    const int rowBytes = width * 4;
+    switch (mode)
+    {
+    case UPLOAD_SSE2:
+        ConvertYUVXToRGBX(pFrame, framePitch, pTexture, texturePitch, width, height);
+        return;
+    case UPLOAD_SCALAR:
+        ConvertYUVXToRGBXScalar(pFrame, framePitch, pTexture, texturePitch, width, height);
+        return;
+    case UPLOAD_COPY:
+        if (framePitch == rowBytes && texturePitch == rowBytes)
+        {
+            memcpy(pTexture, pFrame, (size_t)rowBytes * height);
+            return;
+        }
+        // fall through
+    case UPLOAD_ROWS:
+        for (int y = 0; y < height; y++)
+        {
+            memcpy(pTexture + (size_t)y * texturePitch, pFrame + (size_t)y * framePitch, rowBytes);
+        }
+        return;
+    }
+}
+
+// FNV-1a over the pixels, not the padding at the end of the rows
+static unsigned long long HashPixels(const unsigned char *pTexture, int texturePitch, int width, int height)
+{
+    unsigned long long hash = 14695981039346656037ull;
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char *pRow = pTexture + (size_t)y * texturePitch;
+        for (int x = 0; x < width * 4; x++)
+        {
+            hash = (hash ^ pRow[x]) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+// Decodes the clip in mode and uploads every frame. pFirst gets the first frame as it is in the
+// texture and pHashes a hash of each frame's pixels, when they aren't NULL.
+static bool Run(MovieSource *pSource, OutputMode outputMode, UploadMode uploadMode, ModeResult *pResult,
+    std::vector<unsigned char> *pFirst, std::vector<unsigned long long> *pHashes)
+{
+    if (!pSource->Open(outputMode))
+    {
+        return false;
+    }
+    const int width = pSource->mWidth;
+    const int height = pSource->mHeight;
+    const int texturePitch = (width * 4 + TEXTURE_PITCH_ALIGNMENT - 1) / TEXTURE_PITCH_ALIGNMENT * TEXTURE_PITCH_ALIGNMENT;
+    std::vector<unsigned char> texture((size_t)texturePitch * height);
+
+    pResult->mFrameCount = 0;
+    pResult->mDecodeMs = 0.0;
+    pResult->mUploadMs = 0.0;
+    for (;;)
+    {
+        int framePitch = 0;
+        pSource->PrepareFrame();
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        const unsigned char *pFrame = pSource->Decode(&framePitch);
+        if (!pFrame)
+        {
+            break;
+        }
+        pResult->mDecodeMs += Milliseconds(start);
+
+        start = std::chrono::high_resolution_clock::now();
+        Upload(uploadMode, pFrame, framePitch, &texture[0], texturePitch, width, height);
+        pResult->mUploadMs += Milliseconds(start);
+
+        if (pResult->mFrameCount == 0 && pFirst)
+        {
+            pFirst->assign(texture.begin(), texture.end());
+        }
+        if (pHashes)
+        {
+            pHashes->push_back(HashPixels(&texture[0], texturePitch, width, height));
+        }
+        pResult->mFrameCount++;
+    }
+    pSource->Close();
+    return pResult->mFrameCount > 0;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int frameCount = 300;
+    const char *pFileName = NULL;
+    int syntheticWidth = 0;
+    int syntheticHeight = 0;
+    bool usage = false;
+    for (int ii = 1; ii < argc && !usage; ii++)
+    {
+        if (!strcmp(argv[ii], "-frames") && ii + 1 < argc && atoi(argv[ii + 1]) > 0)
+        {
+            frameCount = atoi(argv[++ii]);
+        }
+        else if (!strcmp(argv[ii], "-synthetic") && ii + 2 < argc && atoi(argv[ii + 1]) > 0 && atoi(argv[ii + 2]) > 0)
+        {
+            syntheticWidth = atoi(argv[++ii]);
+            syntheticHeight = atoi(argv[++ii]);
+        }
+        else if (argv[ii][0] != '-' && !pFileName)
+        {
+            pFileName = argv[ii];
+        }
+        else
+        {
+            usage = true;
+        }
+    }
+#ifndef _WIN32
+    usage = usage || pFileName;
+#endif
+    if (usage || (!pFileName == !syntheticWidth))
+    {
+        fprintf(stderr, "usage: MovieDecodeBench [-frames <count>] <.ogv file>\n");
+        fprintf(stderr, "       MovieDecodeBench [-frames <count>] -synthetic <width> <height>\n");
+#ifndef _WIN32
+        fprintf(stderr, "(only -synthetic without TheoraPlayer)\n");
+#endif
+        return 1;
+    }
+
+    MovieSource *pSource = NULL;
+#ifdef _WIN32
+    if (pFileName)
+    {
+        pSource = new TheoraSource(pFileName, frameCount);
+    }
+#endif
+    if (!pSource)
+    {
+        pSource = new SyntheticSource(syntheticWidth, syntheticHeight, frameCount);
+    }
+
+    struct Mode
+    {
+        const char *pName;
+        OutputMode  mOutput;
+        UploadMode  mUpload;
+    };
+    const Mode modes[] = {
+        { "rgbx",        OUTPUT_RGBX, UPLOAD_ROWS },
+        { "yuvx",        OUTPUT_YUVX, UPLOAD_COPY },
+        { "yuvx sse2",   OUTPUT_YUVX, UPLOAD_SSE2 },
+        { "yuvx scalar", OUTPUT_YUVX, UPLOAD_SCALAR },
+    };
+    ModeResult results[4];
+    std::vector<unsigned char> decoderRGBX, converted;
+    std::vector<unsigned long long> sse2Frames, scalarFrames;
+    bool ok = Run(pSource, modes[0].mOutput, modes[0].mUpload, &results[0], &decoderRGBX, NULL)
+        && Run(pSource, modes[1].mOutput, modes[1].mUpload, &results[1], NULL, NULL)
+        && Run(pSource, modes[2].mOutput, modes[2].mUpload, &results[2], &converted, &sse2Frames)
+        && Run(pSource, modes[3].mOutput, modes[3].mUpload, &results[3], NULL, &scalarFrames);
+    if (!ok)
+    {
+        printf("%s: no frames decoded\n", pFileName ? pFileName : "synthetic");
+        delete pSource;
+        return 1;
+    }
+
+    printf("%dx%d, %d frames\n", pSource->mWidth, pSource->mHeight, results[0].mFrameCount);
+    printf("%-12s %10s %10s %10s\n", "", "decode ms", "upload ms", "total ms");
+    for (int ii = 0; ii < 4; ii++)
+    {
+        const double decodeMs = results[ii].mDecodeMs / results[ii].mFrameCount;
+        const double uploadMs = results[ii].mUploadMs / results[ii].mFrameCount;
+        printf("%-12s %10.2f %10.2f %10.2f\n", modes[ii].pName, decodeMs, uploadMs, decodeMs + uploadMs);
+    }
+
+    if (sse2Frames.size() != scalarFrames.size() || results[0].mFrameCount != results[2].mFrameCount)
+    {
+        printf("FAILED: the modes decoded different numbers of frames\n");
+        ok = false;
+    }
+    for (size_t ii = 0; ii < sse2Frames.size() && ok; ii++)
+    {
+        if (sse2Frames[ii] != scalarFrames[ii])
+        {
+            printf("FAILED: frame %d converted by SSE2 isn't the same as by the scalar version\n", (int)ii);
+            ok = false;
+        }
+    }
+    int largestDifference = 0;
+    for (size_t ii = 0; ii < converted.size(); ii++)
+    {
+        // Only R, G and B; the fourth byte of a decoder RGBX frame is whatever it left there
+        if ((ii & 3) != 3)
+        {
+            largestDifference = std::max(largestDifference, abs((int)converted[ii] - (int)decoderRGBX[ii]));
+        }
+    }
+    printf("largest difference between the decoder's RGBX and ConvertYUVXToRGBX: %d\n", largestDifference);
+
+    delete pSource;
+    return ok ? 0 : 1;
+}
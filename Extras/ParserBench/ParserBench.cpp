@@ -0,0 +1,481 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// ParserBench: times CommandParser (CPUT/include/CPUTParser.h) on synthetic command lines
+// against the std::map / std::stringstream parser it replaced, kept below as LegacyParser.
+//
+//   ParserBench [-seed <number>] [<argument count> ...]
+//
+// For each argument count (8, 64, 512 and 4096 by default) it builds an argv of that many
+// "-nameN:value" arguments, a mix of ints, unsigned ints, doubles, strings with spaces and
+// dashes, and bare flags. It then times three things per parser:
+// - parse: reading the argv
+// - query: one typed GetParameter() per argument plus as many lookups of missing names
+// - launch: parse and query a fresh parser, what a process started by a test harness does
+// Times are microseconds per run, repeated until the clock's resolution doesn't matter.
+// Every query of the new parser is checked against the value it was generated from, and so
+// is every variable ApplyOptions() sets from a CommandOption schema of the same arguments.
+// Every other value is passed as the next argument (-name value) instead of -name:value.
+// Last, the options ChatHeads::SetCommandLine() takes are applied to a few command lines.
+//
+// ParserBench.vcxproj builds it with CPUTParser.cpp; nothing else from CPUT is needed.
+
+#include "CPUTParser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <vector>
+
+// The parser as it was: joins argv, splits it with find / substr / erase and converts
+// every value through a new stringstream.
+class LegacyParser
+{
+public:
+    void ParseConfigurationOptions(int argc, char **argv, std::string delimiter = "-")
+    {
+        std::string commandLine;
+        for (int i = 0; i < argc; i++) {
+            commandLine.append(argv[i]);
+            commandLine.append(" ");
+        }
+        ParseConfigurationOptions(commandLine, delimiter);
+    }
+
+    void ParseConfigurationOptions(std::string arguments, std::string delimiter)
+    {
+        m_Arguments.clear();
+        std::vector<std::string> argumentList;
+        size_t pos;
+        size_t nextPos = arguments.find(delimiter.c_str(), 0);
+        if (nextPos > 0) {
+            m_Arguments.insert(std::make_pair(std::string("default"), arguments.substr(0, nextPos)));
+        }
+        while (nextPos != std::string::npos) {
+            pos = nextPos + delimiter.length();
+            nextPos = arguments.find(delimiter.c_str(), pos);
+            argumentList.push_back(arguments.substr(pos, nextPos - pos));
+        }
+        for (std::vector<std::string>::iterator it = argumentList.begin(); it != argumentList.end(); it++) {
+            std::string::size_type pos = it->find_first_not_of(' ');
+            if (pos != std::string::npos) {
+                it->erase(0, pos);
+            }
+        }
+        for (std::vector<std::string>::iterator it = argumentList.begin(); it != argumentList.end(); it++) {
+            std::string::size_type pos = it->find_last_not_of(' ');
+            if (pos != std::string::npos) {
+                it->erase(pos + 1);
+            }
+        }
+        std::string arg;
+        for (std::vector<std::string>::iterator it = argumentList.begin(); it != argumentList.end(); it++) {
+            arg = *it;
+            pos = arg.find_first_of(":", 0);
+            if (pos != std::string::npos) {
+                m_Arguments.insert(std::make_pair(arg.substr(0, pos), arg.substr(pos + 1, std::string::npos)));
+            } else {
+                m_Arguments.insert(std::make_pair(arg.substr(0, pos), ""));
+            }
+        }
+    }
+
+    bool GetParameter(std::string arg)
+    {
+        return m_Arguments.find(arg) != m_Arguments.end();
+    }
+
+    template <class T>
+    bool GetParameter(std::string arg, T *pOut)
+    {
+        std::map<std::string, std::string>::iterator it = m_Arguments.find(arg);
+        if (it == m_Arguments.end())
+            return false;
+        std::stringstream ss;
+        ss << it->second;
+        ss >> *pOut;
+        return true;
+    }
+
+    bool GetParameter(std::string arg, std::string *pOut)
+    {
+        std::map<std::string, std::string>::iterator it = m_Arguments.find(arg);
+        if (it == m_Arguments.end())
+            return false;
+        std::stringstream ss;
+        ss << it->second;
+        *pOut = ss.str();
+        return true;
+    }
+
+private:
+    std::map<std::string, std::string> m_Arguments;
+};
+
+enum ArgumentType { ARG_INT, ARG_UINT, ARG_DOUBLE, ARG_STRING, ARG_FLAG, ARG_TYPE_COUNT };
+
+struct Argument
+{
+    std::string  mName;
+    ArgumentType mType;
+    int          mInt;
+    unsigned int mUInt;
+    double       mDouble;
+    std::string  mString;
+};
+
+struct CommandLine
+{
+    std::vector<Argument>    mArguments;
+    std::vector<std::string> mText;
+    std::vector<char *>      mArgv;
+    std::vector<std::string> mMissingNames;
+};
+
+//-----------------------------------------------------------------------------
+static double NowUs()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Arguments are shuffled by name so neither parser sees them already sorted
+//-----------------------------------------------------------------------------
+static void BuildCommandLine(int count, unsigned int seed, CommandLine *pLine)
+{
+    srand(seed);
+    pLine->mText.push_back("C:/Program Files/ChatHeads/ChatHeads.exe");
+    for (int i = 0; i < count; i++)
+    {
+        char name[32];
+        sprintf(name, "option%d_%d", rand() % 100000, i);
+        Argument argument;
+        argument.mName = name;
+        argument.mType = (ArgumentType)(i % ARG_TYPE_COUNT);
+        argument.mInt = 0;
+        argument.mUInt = 0;
+        argument.mDouble = 0.0;
+
+        char value[64];
+        switch (argument.mType)
+        {
+        case ARG_INT:
+            argument.mInt = rand() - RAND_MAX / 2;
+            sprintf(value, "%d", argument.mInt);
+            break;
+        case ARG_UINT:
+            argument.mUInt = (unsigned int)rand() * 7u;
+            sprintf(value, "%u", argument.mUInt);
+            break;
+        case ARG_DOUBLE:
+            sprintf(value, "%.3f", (rand() - RAND_MAX / 2) / 64.0);
+            argument.mDouble = atof(value);
+            break;
+        case ARG_STRING:
+            sprintf(value, "C:/Media/scene-%d/asset.set", rand() % 1000);
+            argument.mString = value;
+            break;
+        default:
+            value[0] = '\0';
+            break;
+        }
+        std::string text = "-" + argument.mName;
+        if (argument.mType != ARG_FLAG && (i / ARG_TYPE_COUNT) % 2 == 0)
+        {
+            text += std::string(":") + value;
+        }
+        pLine->mText.push_back(text);
+        if (argument.mType != ARG_FLAG && (i / ARG_TYPE_COUNT) % 2 == 1)
+        {
+            pLine->mText.push_back(value);
+        }
+        pLine->mArguments.push_back(argument);
+
+        sprintf(name, "missing%d", i);
+        pLine->mMissingNames.push_back(name);
+    }
+    for (size_t i = 0; i < pLine->mText.size(); i++)
+    {
+        pLine->mArgv.push_back(&pLine->mText[i][0]);
+    }
+}
+
+// The legacy parser can't tell "-scene-1" from a new parameter, so its string values
+// differ; it's only timed, not checked.
+//-----------------------------------------------------------------------------
+template <class Parser>
+static int Query(Parser &parser, const CommandLine &line, bool check)
+{
+    int errors = 0;
+    for (size_t i = 0; i < line.mArguments.size(); i++)
+    {
+        const Argument &argument = line.mArguments[i];
+        bool ok = false;
+        switch (argument.mType)
+        {
+        case ARG_INT:
+        {
+            int value = 0;
+            ok = parser.GetParameter(argument.mName, &value) && value == argument.mInt;
+            break;
+        }
+        case ARG_UINT:
+        {
+            unsigned int value = 0;
+            ok = parser.GetParameter(argument.mName, &value) && value == argument.mUInt;
+            break;
+        }
+        case ARG_DOUBLE:
+        {
+            double value = 0.0;
+            ok = parser.GetParameter(argument.mName, &value) && value == argument.mDouble;
+            break;
+        }
+        case ARG_STRING:
+        {
+            std::string value;
+            ok = parser.GetParameter(argument.mName, &value) && value == argument.mString;
+            break;
+        }
+        default:
+            ok = parser.GetParameter(argument.mName);
+            break;
+        }
+        errors += (check && !ok) ? 1 : 0;
+    }
+    for (size_t i = 0; i < line.mMissingNames.size(); i++)
+    {
+        errors += (parser.GetParameter(line.mMissingNames[i]) && check) ? 1 : 0;
+    }
+    return errors;
+}
+
+// Applies a schema of all the arguments and compares what it set. Also checks that a value
+// out of the schema's range and a parameter that isn't in it are both reported.
+//-----------------------------------------------------------------------------
+static int CheckOptions(const CommandLine &line)
+{
+    const size_t count = line.mArguments.size();
+    std::vector<int> ints(count, 0);
+    std::vector<unsigned int> uints(count, 0);
+    std::vector<double> doubles(count, 0.0);
+    std::vector<std::string> strings(count);
+    bool *pFlags = new bool[count]();
+    std::vector<CommandOption> options;
+    for (size_t i = 0; i < count; i++)
+    {
+        const Argument &argument = line.mArguments[i];
+        const char *pName = argument.mName.c_str();
+        switch (argument.mType)
+        {
+        case ARG_INT:    options.push_back(CommandOption::Int(pName, &ints[i])); break;
+        case ARG_UINT:   options.push_back(CommandOption::UInt(pName, &uints[i])); break;
+        case ARG_DOUBLE: options.push_back(CommandOption::Double(pName, &doubles[i])); break;
+        case ARG_STRING: options.push_back(CommandOption::String(pName, &strings[i])); break;
+        default:         options.push_back(CommandOption::Flag(pName, &pFlags[i])); break;
+        }
+    }
+
+    int errors = 0;
+    CommandParser parser;
+    parser.ParseConfigurationOptions((int)line.mArgv.size(), const_cast<char **>(&line.mArgv[0]));
+    std::string messages;
+    if (count > 0 && !parser.ApplyOptions(&options[0], (int)count, &messages))
+    {
+        printf("%s", messages.c_str());
+        errors++;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        const Argument &argument = line.mArguments[i];
+        bool ok = false;
+        switch (argument.mType)
+        {
+        case ARG_INT:    ok = ints[i] == argument.mInt; break;
+        case ARG_UINT:   ok = uints[i] == argument.mUInt; break;
+        case ARG_DOUBLE: ok = doubles[i] == argument.mDouble; break;
+        case ARG_STRING: ok = strings[i] == argument.mString; break;
+        default:         ok = pFlags[i]; break;
+        }
+        errors += ok ? 0 : 1;
+    }
+    delete[] pFlags;
+
+    // A schema that leaves out the first argument and caps the first int at its value - 1
+    for (size_t i = 0; i < count; i++)
+    {
+        if (line.mArguments[i].mType != ARG_INT || i == 0)
+        {
+            continue;
+        }
+        int value = 0;
+        const int maxValue = line.mArguments[i].mInt - 1;
+        CommandOption option = CommandOption::Int(line.mArguments[i].mName.c_str(), &value, INT_MIN, maxValue);
+        messages.clear();
+        const bool valid = parser.ApplyOptions(&option, 1, &messages);
+        const bool reportedRange = messages.find("invalid value") != std::string::npos;
+        const bool reportedUnknown = messages.find("unknown parameter -" + line.mArguments[0].mName) != std::string::npos;
+        errors += (!valid && reportedRange && reportedUnknown && value == 0) ? 0 : 1;
+        break;
+    }
+    return errors;
+}
+
+// The schema of ChatHeads::SetCommandLine(), given both ways
+//-----------------------------------------------------------------------------
+static int CheckChatHeadsOptions()
+{
+    struct Case
+    {
+        const char *mpArgs[8];
+        const char *mpReplay;
+        double      mReplayFps;
+        const char *mpRecord;
+        bool        mValid;
+    };
+    const Case cases[] =
+    {
+        { { "ChatHeads.exe", "-replay", "foo.chf", "-replayfps", "30", "-record:bar.chf" }, "foo.chf", 30.0, "bar.chf", true },
+        { { "ChatHeads.exe", "-replay:C:/recordings/my chathead.chf", "-replayfps:0" }, "C:/recordings/my chathead.chf", 0.0, "", true },
+        { { "ChatHeads.exe", "-replay", "foo.chf", "-replayfps", "-1" }, "foo.chf", -1.0, "", true },
+        { { "ChatHeads.exe", "-record", "bar.chf", "-replayfps", "5000" }, "", -1.0, "bar.chf", false },
+    };
+
+    int errors = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        int argc = 0;
+        while (argc < 8 && cases[i].mpArgs[argc])
+        {
+            argc++;
+        }
+        std::string replayFile;
+        double replayFps = -1.0;
+        std::string recordFile;
+        const CommandOption options[] =
+        {
+            CommandOption::String("replay", &replayFile),
+            CommandOption::Double("replayfps", &replayFps, -1.0, 1000.0),
+            CommandOption::String("record", &recordFile),
+        };
+        CommandParser parser;
+        parser.ParseConfigurationOptions(argc, const_cast<char **>(cases[i].mpArgs));
+        const bool valid = parser.ApplyOptions(options, 3);
+        if (valid != cases[i].mValid || replayFile != cases[i].mpReplay || replayFps != cases[i].mReplayFps || recordFile != cases[i].mpRecord)
+        {
+            printf("ChatHeads command line %d: replay '%s' at %g fps, record '%s'\n", (int)i, replayFile.c_str(), replayFps, recordFile.c_str());
+            errors++;
+        }
+    }
+    return errors;
+}
+
+// Microseconds per run of one of the three steps
+//-----------------------------------------------------------------------------
+enum Step { STEP_PARSE, STEP_QUERY, STEP_LAUNCH };
+
+template <class Parser>
+static double Time(CommandLine &line, Step step)
+{
+    const int argc = (int)line.mArgv.size();
+    char **argv = &line.mArgv[0];
+    Parser parsed;
+    parsed.ParseConfigurationOptions(argc, argv);
+
+    int runs = 0;
+    const double start = NowUs();
+    double elapsed = 0.0;
+    do
+    {
+        if (step == STEP_PARSE)
+        {
+            parsed.ParseConfigurationOptions(argc, argv);
+        }
+        else if (step == STEP_QUERY)
+        {
+            Query(parsed, line, false);
+        }
+        else
+        {
+            Parser parser;
+            parser.ParseConfigurationOptions(argc, argv);
+            Query(parser, line, false);
+        }
+        runs++;
+        elapsed = NowUs() - start;
+    } while (elapsed < 200000.0 && runs < 100000);
+    return elapsed / runs;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    unsigned int seed = 1;
+    std::vector<int> counts;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-seed") && ii + 1 < argc)
+        {
+            seed = (unsigned int)atoi(argv[++ii]);
+        }
+        else if (argv[ii][0] == '-' || atoi(argv[ii]) <= 0)
+        {
+            fprintf(stderr, "usage: ParserBench [-seed <number>] [<argument count> ...]\n");
+            return 1;
+        }
+        else
+        {
+            counts.push_back(atoi(argv[ii]));
+        }
+    }
+    if (counts.empty())
+    {
+        const int defaultCounts[] = { 8, 64, 512, 4096 };
+        counts.assign(defaultCounts, defaultCounts + sizeof(defaultCounts) / sizeof(defaultCounts[0]));
+    }
+
+    int errors = 0;
+    printf("%9s  %12s %12s  %12s %12s  %12s %12s\n", "arguments", "parse old", "new", "query old", "new", "launch old", "new");
+    for (size_t ii = 0; ii < counts.size(); ii++)
+    {
+        CommandLine line;
+        BuildCommandLine(counts[ii], seed, &line);
+
+        CommandParser parser;
+        parser.ParseConfigurationOptions((int)line.mArgv.size(), &line.mArgv[0]);
+        errors += Query(parser, line, true);
+        errors += CheckOptions(line);
+
+        const double parseOld  = Time<LegacyParser>(line, STEP_PARSE);
+        const double parseNew  = Time<CommandParser>(line, STEP_PARSE);
+        const double queryOld  = Time<LegacyParser>(line, STEP_QUERY);
+        const double queryNew  = Time<CommandParser>(line, STEP_QUERY);
+        const double launchOld = Time<LegacyParser>(line, STEP_LAUNCH);
+        const double launchNew = Time<CommandParser>(line, STEP_LAUNCH);
+        printf("%9d  %10.2fus %10.2fus  %10.2fus %10.2fus  %10.2fus %10.2fus  (%.1fx)\n", counts[ii],
+               parseOld, parseNew, queryOld, queryNew, launchOld, launchNew, launchOld / launchNew);
+    }
+
+    errors += CheckChatHeadsOptions();
+    if (errors)
+    {
+        printf("%d queries or options of the new parser got the wrong value\n", errors);
+        return 1;
+    }
+    return 0;
+}
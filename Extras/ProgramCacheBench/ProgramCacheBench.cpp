@@ -0,0 +1,463 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// ProgramCacheBench: times creating the OpenGL programs of an asset set's materials with
+// CPUTProgramCacheOGL disabled, with its cache empty, and with the cache the empty run wrote.
+//
+//   ProgramCacheBench [-runs <count>] [-asset <name>] [-cache <directory>] <Media folder>
+//
+// Every .mtl in <Media folder>/<asset>/Material (default Conservatory) gets its program the way
+// CPUTMaterialOGL::LoadMaterial does: the VertexShaderFileOGL_n, GeometryShaderFileOGL_n and
+// FragmentShaderFileOGL_n files are read (% names from System/Shader, others from the asset's
+// Shader folder), each distinct list becomes a shader with CPUTShaderOGL::CreateFromFiles'
+// source and key, and CPUTProgramCacheOGL::LinkProgram() links or loads the program. A miss is
+// reflected and stored. Each run (default 3) does:
+// - no cache  SetEnabled(false): compile, link and reflect everything
+// - cold      an empty cache directory (default ProgramCacheBench.cache), so everything is
+//             compiled, linked, reflected and written
+// - warm      the files cold wrote; every program has to be a hit
+// each in a new context, and prints the best and median milliseconds, with hits and misses. A
+// hit's stored reflection has to match one queried from the program it loaded.
+//
+// Mesa keeps compiled shaders in its own disk cache and only offers program binaries when that
+// cache is on, so each context gets an empty MESA_SHADER_CACHE_DIR under the cache directory:
+// cold is a first launch for Mesa too. The cache directory is deleted at the end.
+//
+// Linux only: the context is a surfaceless EGL one (EGL_MESA_platform_surfaceless), e.g. llvmpipe
+// with LIBGL_ALWAYS_SOFTWARE=1 on a machine with no GPU. Build it where CPUT's OpenGL backend
+// builds, from this folder:
+//   g++ -std=c++11 -O2 -DCPUT_OS_LINUX -DCPUT_FOR_OGL -I../../CPUT/include -I../../CPUT/include/opengl
+//       ProgramCacheBench.cpp ../../CPUT/source/opengl/CPUTProgramCacheOGL.cpp
+//       ../../CPUT/source/CPUTConfigBlock.cpp ../../CPUT/source/CPUTSceneCache.cpp
+//       ../../CPUT/source/linux/CPUTOSServicesLinux.cpp
+//       -lEGL -lGL
+
+#include "CPUT.h"
+#include "CPUT_OGL.h"
+#include "CPUTConfigBlock.h"
+#include "CPUTOSServices.h"
+#include "CPUTProgramCacheOGL.h"
+#include "CPUTHash.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+static const char *GLSL_VERSION = "#version 400 \n"; // CPUT_OGL::GLSL_VERSION without image store
+
+static const struct
+{
+    const char *mpKey;
+    GLenum      mType;
+    const char *mpDefine;
+} SHADER_STAGES[] =
+{
+    { "VertexShaderFileOGL_",   GL_VERTEX_SHADER,   "\n#define GLSL_VERTEX_SHADER\n" },
+    { "FragmentShaderFileOGL_", GL_FRAGMENT_SHADER, "\n#define GLSL_FRAGMENT_SHADER\n" },
+    { "GeometryShaderFileOGL_", GL_GEOMETRY_SHADER, "\n#define GLSL_GEOMETRY_SHADER\n" },
+};
+
+struct RunResult
+{
+    bool        mbOk;
+    double      mMs;
+    int         mPrograms;
+    int         mShaders;
+    UINT        mHits;
+    UINT        mMisses;
+    std::string mRenderer;
+};
+
+//-----------------------------------------------------------------------------
+// A surfaceless context, on a display initialized for it so Mesa reads MESA_SHADER_CACHE_DIR again
+class Context
+{
+public:
+    Context() : mDisplay(EGL_NO_DISPLAY), mContext(EGL_NO_CONTEXT) {}
+    ~Context()
+    {
+        if (mContext != EGL_NO_CONTEXT)
+        {
+            eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(mDisplay, mContext);
+        }
+        if (mDisplay != EGL_NO_DISPLAY)
+        {
+            eglTerminate(mDisplay);
+        }
+    }
+
+    bool Create()
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC pGetPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (!pGetPlatformDisplay)
+        {
+            return false;
+        }
+        mDisplay = pGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (mDisplay == EGL_NO_DISPLAY || !eglInitialize(mDisplay, NULL, NULL) || !eglBindAPI(EGL_OPENGL_API))
+        {
+            return false;
+        }
+        const EGLint attributes[] =
+        {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 2,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        mContext = eglCreateContext(mDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+        return mContext != EGL_NO_CONTEXT && eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, mContext);
+    }
+
+private:
+    EGLDisplay mDisplay;
+    EGLContext mContext;
+};
+
+//-----------------------------------------------------------------------------
+// CPUTShaderOGL::CreateFromFiles without the asset library: the same source, key and registration
+static GLuint CreateShader(const std::vector<std::string> &fileNames, int stage)
+{
+    std::vector<const char *> source;
+    source.push_back(GLSL_VERSION);
+    source.push_back(SHADER_STAGES[stage].mpDefine);
+    source.push_back(""); // CPUT_OGL::DEFAULT_MACROS
+    source.push_back(""); // the material's macros
+    for (size_t ii = 0; ii < fileNames.size(); ii++)
+    {
+        UINT size = 0;
+        char *pContents = NULL;
+        if (CPUTFAILED(CPUTFileSystem::ReadFileContents(fileNames[ii], &size, (void **)&pContents, true)))
+        {
+            printf("%s: can't read\n", fileNames[ii].c_str());
+            for (size_t jj = 4; jj < source.size(); jj++)
+            {
+                delete[] source[jj];
+            }
+            return 0;
+        }
+        source.push_back(pContents);
+    }
+
+    const GLuint shader = glCreateShader(SHADER_STAGES[stage].mType);
+    glShaderSource(shader, (GLsizei)source.size(), &source[0], NULL);
+    std::vector<uint64_t> sourceHashes;
+    sourceHashes.push_back(SHADER_STAGES[stage].mType);
+    for (size_t ii = 0; ii < source.size(); ii++)
+    {
+        sourceHashes.push_back(CPUTHash64(source[ii], strlen(source[ii])));
+    }
+    CPUTProgramCacheOGL::GetProgramCache()->RegisterShader(shader, fileNames[0],
+        CPUTHash64((const char *)&sourceHashes[0], sourceHashes.size() * sizeof(uint64_t)));
+
+    for (size_t ii = 4; ii < source.size(); ii++)
+    {
+        delete[] source[ii];
+    }
+    return shader;
+}
+
+static bool SameReflection(const CPUTProgramReflectionOGL &a, const CPUTProgramReflectionOGL &b)
+{
+    if (a.textureNames != b.textureNames || a.imageNames != b.imageNames || a.blockNames != b.blockNames ||
+        a.externalsBlock != b.externalsBlock || a.externalsSize != b.externalsSize || a.externals.size() != b.externals.size())
+    {
+        return false;
+    }
+    for (size_t ii = 0; ii < a.externals.size(); ii++)
+    {
+        const CPUTProgramReflectionOGL::Uniform &x = a.externals[ii];
+        const CPUTProgramReflectionOGL::Uniform &y = b.externals[ii];
+        if (x.name != y.name || x.type != y.type || x.offset != y.offset || x.arrayLength != y.arrayLength)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Creates every material's program in a new context. Only reading the files and creating the
+// shaders and programs is timed.
+static RunResult Run(const std::vector<std::string> &materials, const std::string &mediaDir, const std::string &assetDir,
+    const std::string &cacheDir, bool bUseCache, const std::string &mesaCacheDir)
+{
+    RunResult result;
+    result.mbOk = true;
+    result.mMs = 0.0;
+    result.mPrograms = result.mShaders = 0;
+    result.mHits = result.mMisses = 0;
+    setenv("MESA_SHADER_CACHE_DIR", mesaCacheDir.c_str(), 1);
+    Context context;
+    if (!context.Create())
+    {
+        printf("can't create a surfaceless EGL context with OpenGL 4.2 core (EGL error 0x%x)\n", eglGetError());
+        result.mbOk = false;
+        return result;
+    }
+    result.mRenderer = std::string((const char *)glGetString(GL_RENDERER)) + ", " + (const char *)glGetString(GL_VERSION);
+
+    CPUTProgramCacheOGL::DeleteProgramCache();
+    CPUTProgramCacheOGL *pCache = CPUTProgramCacheOGL::GetProgramCache();
+    pCache->SetEnabled(bUseCache);
+    pCache->SetCacheDirectory(cacheDir);
+
+    std::map<std::string, GLuint> shaders; // like the asset library's, by stage and files
+    std::vector<GLuint> programs;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (size_t ii = 0; ii < materials.size(); ii++)
+    {
+        CPUTConfigFile file;
+        if (CPUTFAILED(file.LoadFile(materials[ii])) || !file.GetBlock(0))
+        {
+            printf("%s: can't load\n", materials[ii].c_str());
+            result.mbOk = false;
+            continue;
+        }
+        CPUTConfigBlock *pBlock = file.GetBlock(0);
+
+        GLuint programShaders[3];
+        int numShaders = 0;
+        for (int stage = 0; stage < 3; stage++)
+        {
+            std::vector<std::string> fileNames;
+            std::string name = cput_to_string(stage);
+            for (int number = 1; pBlock->GetValueByName(SHADER_STAGES[stage].mpKey + cput_to_string(number))->IsValid(); number++)
+            {
+                const std::string fileName = pBlock->GetValueByName(SHADER_STAGES[stage].mpKey + cput_to_string(number))->ValueAsString();
+                fileNames.push_back(fileName[0] == '%' ? mediaDir + "System/Shader/" + fileName.substr(1) : assetDir + "Shader/" + fileName);
+                name += fileNames.back();
+            }
+            if (fileNames.empty())
+            {
+                continue;
+            }
+            std::map<std::string, GLuint>::iterator it = shaders.find(name);
+            if (it == shaders.end())
+            {
+                it = shaders.insert(std::make_pair(name, CreateShader(fileNames, stage))).first;
+            }
+            if (!it->second)
+            {
+                result.mbOk = false;
+                break;
+            }
+            programShaders[numShaders++] = it->second;
+        }
+        if (!numShaders || !result.mbOk)
+        {
+            continue;
+        }
+
+        CPUTProgramReflectionOGL reflection;
+        bool bReflected = false;
+        uint64_t key = 0;
+        const GLuint program = pCache->LinkProgram(programShaders, numShaders, &reflection, &bReflected, &key);
+        if (!program)
+        {
+            printf("%s: doesn't link\n", materials[ii].c_str());
+            result.mbOk = false;
+            continue;
+        }
+        if (bReflected)
+        {
+            // Not part of what a launch does, so kept out of the time
+            std::chrono::high_resolution_clock::time_point checkStart = std::chrono::high_resolution_clock::now();
+            CPUTProgramReflectionOGL queried;
+            CPUTProgramCacheOGL::ReflectProgram(program, &queried);
+            if (!SameReflection(reflection, queried))
+            {
+                printf("%s: the cached reflection doesn't match the program's\n", materials[ii].c_str());
+                result.mbOk = false;
+            }
+            start += std::chrono::high_resolution_clock::now() - checkStart;
+        }
+        else
+        {
+            CPUTProgramCacheOGL::ReflectProgram(program, &reflection);
+            pCache->StoreProgram(program, key, reflection);
+        }
+        programs.push_back(program);
+    }
+    glFinish();
+    result.mMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    result.mPrograms = (int)programs.size();
+    result.mShaders = (int)shaders.size();
+    result.mHits = pCache->GetHitCount();
+    result.mMisses = pCache->GetMissCount();
+
+    for (size_t ii = 0; ii < programs.size(); ii++)
+    {
+        glDeleteProgram(programs[ii]);
+    }
+    for (std::map<std::string, GLuint>::iterator it = shaders.begin(); it != shaders.end(); ++it)
+    {
+        glDeleteShader(it->second);
+    }
+    CPUTProgramCacheOGL::DeleteProgramCache();
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+static void RemoveDirectory(const std::string &directory)
+{
+    DIR *pDir = opendir(directory.c_str());
+    if (!pDir)
+    {
+        return;
+    }
+    while (dirent *pEntry = readdir(pDir))
+    {
+        if (strcmp(pEntry->d_name, ".") && strcmp(pEntry->d_name, ".."))
+        {
+            const std::string path = directory + "/" + pEntry->d_name;
+            if (remove(path.c_str()))
+            {
+                RemoveDirectory(path);
+            }
+        }
+    }
+    closedir(pDir);
+    rmdir(directory.c_str());
+}
+
+static void Report(const char *pName, std::vector<RunResult> results)
+{
+    std::vector<double> times;
+    for (size_t ii = 0; ii < results.size(); ii++)
+    {
+        times.push_back(results[ii].mMs);
+    }
+    std::sort(times.begin(), times.end());
+    printf("%-10s %10.1f %10.1f %8u %8u\n", pName, times[0], times[times.size() / 2], results.back().mHits, results.back().mMisses);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int runCount = 3;
+    std::string asset = "Conservatory";
+    std::string cacheDir = "ProgramCacheBench.cache";
+    std::string mediaDir;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-runs") && ii + 1 < argc && atoi(argv[ii + 1]) > 0)
+        {
+            runCount = atoi(argv[++ii]);
+        }
+        else if (!strcmp(argv[ii], "-asset") && ii + 1 < argc)
+        {
+            asset = argv[++ii];
+        }
+        else if (!strcmp(argv[ii], "-cache") && ii + 1 < argc)
+        {
+            cacheDir = argv[++ii];
+        }
+        else if (argv[ii][0] != '-' && mediaDir.empty())
+        {
+            mediaDir = argv[ii];
+        }
+        else
+        {
+            mediaDir.clear();
+            break;
+        }
+    }
+    if (mediaDir.empty())
+    {
+        fprintf(stderr, "usage: ProgramCacheBench [-runs <count>] [-asset <name>] [-cache <directory>] <Media folder>\n");
+        return 1;
+    }
+    if (mediaDir[mediaDir.size() - 1] != '/')
+    {
+        mediaDir += '/';
+    }
+    const std::string assetDir = mediaDir + asset + "/";
+
+    std::vector<std::string> materials;
+    DIR *pDir = opendir((assetDir + "Material").c_str());
+    if (!pDir)
+    {
+        printf("%sMaterial: can't open\n", assetDir.c_str());
+        return 1;
+    }
+    while (dirent *pEntry = readdir(pDir))
+    {
+        const size_t length = strlen(pEntry->d_name);
+        if (length > 4 && !strcmp(pEntry->d_name + length - 4, ".mtl"))
+        {
+            materials.push_back(assetDir + "Material/" + pEntry->d_name);
+        }
+    }
+    closedir(pDir);
+    std::sort(materials.begin(), materials.end());
+
+    RemoveDirectory(cacheDir);
+    mkdir(cacheDir.c_str(), 0777);
+    const std::string programDir = cacheDir + "/programs";
+    int contextCount = 0;
+
+    bool ok = true;
+    std::vector<RunResult> noCache, cold, warm;
+    for (int run = 0; run < runCount && ok; run++)
+    {
+        noCache.push_back(Run(materials, mediaDir, assetDir, programDir, false, cacheDir + "/mesa" + cput_to_string(contextCount++)));
+        RemoveDirectory(programDir);
+        cold.push_back(Run(materials, mediaDir, assetDir, programDir, true, cacheDir + "/mesa" + cput_to_string(contextCount++)));
+        warm.push_back(Run(materials, mediaDir, assetDir, programDir, true, cacheDir + "/mesa" + cput_to_string(contextCount++)));
+        ok = noCache.back().mbOk && cold.back().mbOk && warm.back().mbOk;
+        if (ok && (noCache.back().mHits || noCache.back().mMisses))
+        {
+            printf("FAILED: the disabled cache counted %u hits and %u misses\n", noCache.back().mHits, noCache.back().mMisses);
+            ok = false;
+        }
+        if (ok && !cold.back().mMisses)
+        {
+            printf("FAILED: nothing missed with an empty cache; does the context have program binary formats?\n");
+            ok = false;
+        }
+        if (ok && (warm.back().mMisses || (int)warm.back().mHits != warm.back().mPrograms))
+        {
+            printf("FAILED: the warm run had %u hits and %u misses for %d programs\n", warm.back().mHits, warm.back().mMisses, warm.back().mPrograms);
+            ok = false;
+        }
+    }
+    RemoveDirectory(cacheDir);
+    if (!ok)
+    {
+        printf("FAILED: see above\n");
+        return 1;
+    }
+
+    printf("%s\n", warm[0].mRenderer.c_str());
+    printf("%d materials, %d programs, %d shaders\n", (int)materials.size(), warm[0].mPrograms, warm[0].mShaders);
+    printf("%-10s %10s %10s %8s %8s\n", "", "best ms", "median ms", "hits", "misses");
+    Report("no cache", noCache);
+    Report("cold", cold);
+    Report("warm", warm);
+    return 0;
+}
@@ -0,0 +1,282 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// RangeAllocatorTest: allocates and frees random ranges with CPUTRangeAllocator
+// (CPUT/include/CPUTRangeAllocator.h) and checks its bookkeeping after every step.
+//
+//   RangeAllocatorTest [-steps <count>] [-seed <number>] [-capacity <units>]
+//
+// Each step frees a random live range or allocates 1 to 500 units (default 200000 steps in a
+// capacity of 10000). A unit map of what is in use is kept next to the allocator, and after
+// every step:
+// - a new range doesn't overlap a live one and is inside the capacity
+// - the free blocks are exactly the unused units, sorted, and no two of them touch
+// - GetFreeCount() is the number of unused units
+// - an allocation takes the smallest block it fits in, and fails only when no block fits
+// Ten times along the way it prints how fragmented the free space is, and how many
+// allocations failed though there were enough free units in total. At the end everything is
+// freed in random order and has to come back as one block. A few fixed cases check the edges.
+// It prints each failed check and returns the number of failures.
+//
+// RangeAllocatorTest.vcxproj builds it with CPUTRangeAllocator.cpp; nothing else from CPUT is
+// needed.
+
+#include "CPUTRangeAllocator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+static int gFailures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { printf("FAILED line %d: %s\n", __LINE__, #condition); gFailures++; } } while (0)
+
+// Lets the test look at the free list
+class CheckedRangeAllocator : public CPUTRangeAllocator
+{
+public:
+    explicit CheckedRangeAllocator(UINT capacity) : CPUTRangeAllocator(capacity) {}
+
+    // Size of the smallest free block count fits in, 0 when there is none
+    UINT GetBestFitSize(UINT count) const
+    {
+        UINT best = 0;
+        for (std::map<UINT, UINT>::const_iterator it = mFreeBlocks.begin(); it != mFreeBlocks.end(); ++it)
+        {
+            if (it->second >= count && (0 == best || it->second < best))
+            {
+                best = it->second;
+            }
+        }
+        return best;
+    }
+
+    // Size of the free block that starts at offset, 0 when there is none
+    UINT GetFreeBlockAt(UINT offset) const
+    {
+        std::map<UINT, UINT>::const_iterator it = mFreeBlocks.find(offset);
+        return (it == mFreeBlocks.end()) ? 0 : it->second;
+    }
+
+    // True when the free blocks are the runs of unused units, one block per run
+    bool MatchesUsage(const std::vector<char> &used) const
+    {
+        std::map<UINT, UINT>::const_iterator block = mFreeBlocks.begin();
+        UINT freeCount = 0;
+        UINT unit = 0;
+        while (unit < (UINT)used.size())
+        {
+            if (used[unit])
+            {
+                unit++;
+                continue;
+            }
+            UINT end = unit;
+            while (end < (UINT)used.size() && !used[end])
+            {
+                end++;
+            }
+            if (block == mFreeBlocks.end() || block->first != unit || block->second != end - unit)
+            {
+                return false;
+            }
+            freeCount += end - unit;
+            ++block;
+            unit = end;
+        }
+        return block == mFreeBlocks.end() && freeCount == mFreeCount;
+    }
+};
+
+struct Range
+{
+    UINT offset;
+    UINT count;
+};
+
+//-----------------------------------------------------------------------------
+static void MarkUsed(std::vector<char> *pUsed, const Range &range, char value)
+{
+    for (UINT ii = range.offset; ii < range.offset + range.count; ii++)
+    {
+        (*pUsed)[ii] = value;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void PrintFragmentation(const char *pWhen, const CheckedRangeAllocator &allocator, size_t liveCount, UINT refusedCount)
+{
+    printf("%-12s %5u live ranges, %5.1f%% free in %4u blocks, largest %5u, fragmentation %.3f, %u refused\n",
+        pWhen, (UINT)liveCount, 100.0 * allocator.GetFreeCount() / allocator.GetCapacity(), allocator.GetFreeBlockCount(),
+        allocator.GetLargestFreeBlock(), allocator.GetFragmentation(), refusedCount);
+}
+
+//-----------------------------------------------------------------------------
+static void TestRandom(int stepCount, unsigned int seed, UINT capacity)
+{
+    CheckedRangeAllocator allocator(capacity);
+    std::vector<char> used(capacity, 0);
+    std::vector<Range> live;
+    UINT refusedCount = 0; // failed though GetFreeCount() was enough
+    srand(seed);
+
+    for (int step = 0; step < stepCount; step++)
+    {
+        if (!live.empty() && rand() % 2)
+        {
+            const size_t index = rand() % live.size();
+            const Range range = live[index];
+            live[index] = live.back();
+            live.pop_back();
+            allocator.Free(range.offset, range.count);
+            MarkUsed(&used, range, 0);
+        }
+        else
+        {
+            Range range;
+            range.count = 1 + rand() % 500;
+            const UINT bestFitSize = allocator.GetBestFitSize(range.count);
+            range.offset = allocator.Allocate(range.count);
+            if (CPUTRangeAllocator::INVALID_OFFSET == range.offset)
+            {
+                CHECK(0 == bestFitSize);
+                refusedCount += (range.count <= allocator.GetFreeCount()) ? 1 : 0;
+            }
+            else
+            {
+                CHECK(bestFitSize > 0);
+                CHECK(range.offset < capacity && range.count <= capacity - range.offset);
+                bool overlaps = false;
+                for (UINT ii = range.offset; ii < range.offset + range.count && ii < capacity; ii++)
+                {
+                    overlaps = overlaps || used[ii];
+                }
+                CHECK(!overlaps);
+                // Best fit takes the front of the block, the rest stays free behind it
+                CHECK(bestFitSize == range.count || allocator.GetFreeBlockAt(range.offset + range.count) == bestFitSize - range.count);
+                MarkUsed(&used, range, 1);
+                live.push_back(range);
+            }
+        }
+
+        if (!allocator.MatchesUsage(used))
+        {
+            printf("FAILED: the free blocks don't match the units in use after step %d\n", step);
+            gFailures++;
+            return;
+        }
+        if (stepCount >= 10 && (step + 1) % (stepCount / 10) == 0)
+        {
+            char when[32];
+            sprintf(when, "step %d:", step + 1);
+            PrintFragmentation(when, allocator, live.size(), refusedCount);
+        }
+    }
+
+    while (!live.empty())
+    {
+        const size_t index = rand() % live.size();
+        allocator.Free(live[index].offset, live[index].count);
+        MarkUsed(&used, live[index], 0);
+        live[index] = live.back();
+        live.pop_back();
+        CHECK(allocator.MatchesUsage(used));
+    }
+    CHECK(allocator.IsEmpty() && allocator.GetFreeBlockCount() == 1);
+    CHECK(allocator.GetLargestFreeBlock() == capacity && allocator.GetFragmentation() == 0.0f);
+    PrintFragmentation("freed:", allocator, live.size(), refusedCount);
+}
+
+//-----------------------------------------------------------------------------
+static void TestEdges()
+{
+    CheckedRangeAllocator none(0);
+    CHECK(CPUTRangeAllocator::INVALID_OFFSET == none.Allocate(1));
+    CHECK(none.IsEmpty() && none.GetFreeBlockCount() == 0 && none.GetFragmentation() == 0.0f);
+
+    CheckedRangeAllocator allocator(300);
+    CHECK(CPUTRangeAllocator::INVALID_OFFSET == allocator.Allocate(0));
+    CHECK(CPUTRangeAllocator::INVALID_OFFSET == allocator.Allocate(301));
+    const UINT a = allocator.Allocate(100);
+    const UINT b = allocator.Allocate(100);
+    const UINT c = allocator.Allocate(100);
+    CHECK(a == 0 && b == 100 && c == 200);
+    CHECK(allocator.GetFreeCount() == 0 && allocator.GetFreeBlockCount() == 0);
+    CHECK(CPUTRangeAllocator::INVALID_OFFSET == allocator.Allocate(1));
+
+    // Two holes, neither big enough for 150 though 200 are free
+    allocator.Free(a, 100);
+    allocator.Free(c, 100);
+    CHECK(allocator.GetFreeBlockCount() == 2 && allocator.GetFragmentation() == 0.5f);
+    CHECK(CPUTRangeAllocator::INVALID_OFFSET == allocator.Allocate(150));
+
+    // The middle joins both neighbours
+    allocator.Free(b, 100);
+    CHECK(allocator.IsEmpty() && allocator.GetFreeBlockCount() == 1 && allocator.GetFreeBlockAt(0) == 300);
+
+    // Best fit: 20 goes into the 30 hole, not the 50 one in front of it
+    allocator.Allocate(300);
+    allocator.Free(0, 50);
+    allocator.Free(100, 30);
+    CHECK(allocator.Allocate(20) == 100);
+    CHECK(allocator.Allocate(50) == 0);
+    CHECK(allocator.Allocate(10) == 120);
+    CHECK(allocator.GetFreeCount() == 0);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int stepCount = 200000;
+    unsigned int seed = 1;
+    UINT capacity = 10000;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (0 == strcmp(argv[ii], "-steps") && ii + 1 < argc)
+        {
+            stepCount = atoi(argv[++ii]);
+        }
+        else if (0 == strcmp(argv[ii], "-seed") && ii + 1 < argc)
+        {
+            seed = (unsigned int)strtoul(argv[++ii], NULL, 10);
+        }
+        else if (0 == strcmp(argv[ii], "-capacity") && ii + 1 < argc)
+        {
+            capacity = (UINT)strtoul(argv[++ii], NULL, 10);
+        }
+        else
+        {
+            printf("usage: RangeAllocatorTest [-steps <count>] [-seed <number>] [-capacity <units>]\n");
+            return 1;
+        }
+    }
+
+    TestEdges();
+    TestRandom(stepCount, seed, std::max(capacity, 1u));
+
+    if (gFailures)
+    {
+        printf("%d checks failed\n", gFailures);
+    }
+    else
+    {
+        printf("all checks passed\n");
+    }
+    return gFailures;
+}
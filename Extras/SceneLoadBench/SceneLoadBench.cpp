@@ -0,0 +1,379 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// SceneLoadBench: times the reading and parsing CPUTScene::LoadScene does for a scene with and
+// without the scene cache (CPUT/include/CPUTSceneCache.h), without a device.
+//
+//   SceneLoadBench [-runs <count>] [-system <directory>] [-cache <file>] <.scene file>
+//
+// A load reads the .scene, its .set files, the .mtl of every material the models name (and
+// their InstancedMaterial), the .rs of every RenderStateFile, and the .mdl and <model>_lodN.mdl
+// of every model that isn't an instance. Config files go through CPUTConfigFile::LoadFile and
+// models are taken as one payload and parsed with CPUTRawMeshData::Read, like
+// CPUTModel::LoadMeshes; each file is loaded once, like the asset library does. Textures,
+// shaders and GPU buffers are left out.
+// Each run times three loads:
+//   no cache  LoadScene(scene, false)
+//   cold      the cache file is deleted first, everything misses and Save() writes the cache
+//   warm      everything comes from the cache
+// and at the end there are the best and median times of each over the runs (default 10), with
+// the file count, hits and misses (a warm load still misses the first level of detail that
+// isn't there for each model). The OS has the files cached after the first load, so this
+// is what the scene cache saves in parsing and opening files, not in disk reads. Every load
+// also sums what it parsed and the three have to agree.
+//
+// Set files are relative to the scene's directory, "%" materials and render states are in
+// the system directory (default <scene directory>/System). The cache is written to
+// SceneLoadBench.cache (or -cache), not next to the scene, so the one ChatHeads uses is left
+// alone.
+//
+// SceneLoadBench.vcxproj builds it with CPUTConfigBlock.cpp, CPUTSceneCache.cpp,
+// CPUTRawMeshData.cpp and CPUTOSServicesWin.cpp; no graphics API is needed.
+
+#include "CPUTConfigBlock.h"
+#include "CPUTSceneCache.h"
+#include "CPUTMesh.h"
+#include "CPUTLod.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <vector>
+
+// What one load read
+struct LoadStats
+{
+    UINT     configCount;
+    UINT     modelCount;
+    uint64_t modelBytes;
+    uint64_t checksum; // blocks, values, vertices and indices parsed
+    UINT     hitCount;
+    UINT     missCount;
+    double   milliseconds;
+};
+
+class SceneLoader
+{
+public:
+    SceneLoader(const std::string &systemDirectory) : mSystemDirectory(systemDirectory)
+    {
+        memset(&mStats, 0, sizeof(mStats));
+    }
+
+    bool LoadScene(const std::string &sceneFileName);
+
+    LoadStats mStats;
+
+protected:
+    bool LoadConfig(const std::string &fileName, CPUTConfigFile *pFile);
+    void LoadSet(const std::string &setFileName, const std::string &assetDirectory);
+    void LoadMaterial(const std::string &name, const std::string &assetDirectory);
+    void LoadRenderState(const std::string &name, const std::string &assetDirectory);
+    bool LoadModel(const std::string &fileName);
+
+    std::string           mSystemDirectory;
+    std::set<std::string> mLoaded;
+};
+
+//-----------------------------------------------------------------------------
+static std::string DirectoryOf(const std::string &fileName)
+{
+    size_t slash = fileName.find_last_of("\\/");
+    return slash == std::string::npos ? "." : fileName.substr(0, slash);
+}
+
+//-----------------------------------------------------------------------------
+bool SceneLoader::LoadConfig(const std::string &fileName, CPUTConfigFile *pFile)
+{
+    if (CPUTFAILED(pFile->LoadFile(fileName)))
+    {
+        printf("%s: can't read\n", fileName.c_str());
+        return false;
+    }
+    mStats.configCount++;
+    for (int ii = 0; ii < pFile->BlockCount(); ii++)
+    {
+        mStats.checksum += 1 + pFile->GetBlock(ii)->ValueCount();
+    }
+    return true;
+}
+
+// Like CPUTModel::LoadMeshes, without creating the meshes
+//-----------------------------------------------------------------------------
+bool SceneLoader::LoadModel(const std::string &fileName)
+{
+    const char *pPayload = NULL;
+    UINT payloadSize = 0;
+    CPUTFileSystem::CPUTFileView fileView;
+    CPUTSceneCache *pCache = CPUTSceneCache::GetActiveCache();
+    if (!pCache || !pCache->Find(CPUT_CACHE_MODEL, fileName, &pPayload, &payloadSize))
+    {
+        if (CPUTFAILED(fileView.Open(fileName)))
+        {
+            return false;
+        }
+        pPayload = fileView.GetData();
+        payloadSize = (UINT)fileView.GetSize();
+        if (pCache)
+        {
+            pCache->Add(CPUT_CACHE_MODEL, fileName, pPayload, payloadSize);
+        }
+    }
+
+    CPUTFileSystem::CPUTmemifstream file(pPayload, payloadSize);
+    while (file.good() && !file.eof())
+    {
+        CPUTRawMeshData mesh;
+        if (!mesh.Read(file))
+        {
+            break;
+        }
+        mStats.checksum += mesh.mVertexCount + mesh.mIndexCount;
+    }
+    mStats.modelCount++;
+    mStats.modelBytes += payloadSize;
+    return true;
+}
+
+// As CPUTAssetLibrary::GetRenderStateBlock resolves it
+//-----------------------------------------------------------------------------
+void SceneLoader::LoadRenderState(const std::string &name, const std::string &assetDirectory)
+{
+    if (name.empty() || name[0] == '$')
+    {
+        return;
+    }
+    std::string fileName;
+    CPUTFileSystem::ResolveAbsolutePathAndFilename((name[0] == '%') ? mSystemDirectory + "/Shader/" + name.substr(1) : assetDirectory + "Shader/" + name, &fileName);
+    if (mLoaded.insert(fileName).second)
+    {
+        CPUTConfigFile file;
+        LoadConfig(fileName, &file);
+    }
+}
+
+// As CPUTAssetLibrary::GetMaterial resolves it
+//-----------------------------------------------------------------------------
+void SceneLoader::LoadMaterial(const std::string &name, const std::string &assetDirectory)
+{
+    std::string fileName;
+    CPUTFileSystem::ResolveAbsolutePathAndFilename((name[0] == '%') ? mSystemDirectory + "/Material/" + name.substr(1) + ".mtl" : assetDirectory + "Material/" + name + ".mtl", &fileName);
+    if (!mLoaded.insert(fileName).second)
+    {
+        return;
+    }
+    CPUTConfigFile file;
+    if (!LoadConfig(fileName, &file))
+    {
+        return;
+    }
+    for (int ii = 0; ii < file.BlockCount(); ii++)
+    {
+        CPUTConfigBlock *pBlock = file.GetBlock(ii);
+        CPUTConfigEntry *pRenderState = pBlock->GetValueByName("RenderStateFile");
+        if (pRenderState->IsValid())
+        {
+            LoadRenderState(pRenderState->ValueAsString(), assetDirectory);
+        }
+        CPUTConfigEntry *pInstanced = pBlock->GetValueByName("InstancedMaterial");
+        if (pInstanced->IsValid())
+        {
+            LoadMaterial(pInstanced->ValueAsString(), assetDirectory);
+        }
+    }
+}
+
+// The models of a set and their materials, as CPUTAssetSet and CPUTModel load them
+//-----------------------------------------------------------------------------
+void SceneLoader::LoadSet(const std::string &setFileName, const std::string &assetDirectory)
+{
+    CPUTConfigFile setFile;
+    if (!LoadConfig(setFileName, &setFile))
+    {
+        return;
+    }
+    for (int ii = 0; ii < setFile.BlockCount(); ii++)
+    {
+        CPUTConfigBlock *pBlock = setFile.GetBlock(ii);
+        if (pBlock->GetValueByName("type")->ValueAsString() != "model")
+        {
+            continue;
+        }
+        // Instances share the meshes of their master and have no payload of their own
+        CPUTConfigEntry *pInstance = pBlock->GetValueByName("instance");
+        if (!pInstance->IsValid() || pInstance->ValueAsInt() == ii)
+        {
+            std::string modelFileName;
+            CPUTFileSystem::ResolveAbsolutePathAndFilename(assetDirectory + "Asset/" + pBlock->GetValueByName("name")->ValueAsString() + ".mdl", &modelFileName);
+            if (mLoaded.insert(modelFileName).second && LoadModel(modelFileName))
+            {
+                for (int lod = 1; lod < CPUT_MAX_LOD_COUNT && LoadModel(CPUTLodFileName(modelFileName, lod)); lod++)
+                {
+                }
+            }
+        }
+
+        const int meshCount = pBlock->GetValueByName("meshcount")->ValueAsInt();
+        for (int mesh = 0; mesh < meshCount; mesh++)
+        {
+            // "material<n> = name [name ...]", one per effect, NULL for none
+            std::string materials = pBlock->GetValueByName("material" + cput_to_string(mesh))->ValueAsString();
+            size_t first = 0;
+            while (first < materials.size())
+            {
+                size_t last = std::min(materials.find(' ', first), materials.size());
+                const std::string material = materials.substr(first, last - first);
+                if (!material.empty() && material != "NULL")
+                {
+                    LoadMaterial(material, assetDirectory);
+                }
+                first = last + 1;
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool SceneLoader::LoadScene(const std::string &sceneFileName)
+{
+    CPUTConfigFile sceneFile;
+    CPUTConfigBlock *pAssets = NULL;
+    if (!LoadConfig(sceneFileName, &sceneFile) || (pAssets = sceneFile.GetBlockByName("Assets")) == NULL)
+    {
+        printf("%s: not a scene this can read\n", sceneFileName.c_str());
+        return false;
+    }
+    const std::string mediaDirectory = DirectoryOf(sceneFileName) + "/";
+    for (int ii = 0; ii < pAssets->ValueCount(); ii++)
+    {
+        // The asset directory is what comes before the "asset" directory the set is in, as in
+        // CPUTScene::ReadSceneFile
+        std::string setFileName;
+        CPUTFileSystem::ResolveAbsolutePathAndFilename(mediaDirectory + pAssets->GetValue(ii)->NameAsString(), &setFileName);
+        size_t lower = setFileName.rfind("asset"), upper = setFileName.rfind("Asset");
+        size_t asset = (lower != std::string::npos && upper != std::string::npos) ? std::max(lower, upper) : std::min(lower, upper);
+        LoadSet(setFileName, (asset == std::string::npos) ? mediaDirectory : setFileName.substr(0, asset));
+    }
+    return true;
+}
+
+// One load of the scene, with a cache active like LoadScene has it when cacheFileName is set
+//-----------------------------------------------------------------------------
+static bool TimeLoad(const std::string &sceneFileName, const std::string &systemDirectory, const std::string &cacheFileName, LoadStats *pStats)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    SceneLoader loader(systemDirectory);
+    CPUTSceneCache sceneCache;
+    if (!cacheFileName.empty())
+    {
+        sceneCache.Open(cacheFileName);
+        CPUTSceneCache::SetActiveCache(&sceneCache);
+    }
+    const bool loaded = loader.LoadScene(sceneFileName);
+    if (!cacheFileName.empty())
+    {
+        CPUTSceneCache::SetActiveCache(NULL);
+        sceneCache.Save();
+    }
+    *pStats = loader.mStats;
+    pStats->hitCount     = sceneCache.GetHitCount();
+    pStats->missCount    = sceneCache.GetMissCount();
+    pStats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return loaded;
+}
+
+//-----------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("usage: SceneLoadBench [-runs <count>] [-system <directory>] [-cache <file>] <.scene file>\n");
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int runCount = 10;
+    std::string sceneFileName, systemDirectory, cacheFileName = "SceneLoadBench.cache";
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-runs") && ii + 1 < argc)
+        {
+            runCount = std::max(atoi(argv[++ii]), 1);
+        }
+        else if (!strcmp(argv[ii], "-system") && ii + 1 < argc)
+        {
+            systemDirectory = argv[++ii];
+        }
+        else if (!strcmp(argv[ii], "-cache") && ii + 1 < argc)
+        {
+            cacheFileName = argv[++ii];
+        }
+        else if (argv[ii][0] == '-' || !sceneFileName.empty())
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            sceneFileName = argv[ii];
+        }
+    }
+    if (sceneFileName.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+    if (systemDirectory.empty())
+    {
+        systemDirectory = DirectoryOf(sceneFileName) + "/System";
+    }
+
+    const char *pModeNames[] = { "no cache", "cold", "warm" };
+    std::vector<double> times[3];
+    LoadStats stats[3];
+    for (int run = 0; run < runCount; run++)
+    {
+        remove(cacheFileName.c_str());
+        if (!TimeLoad(sceneFileName, systemDirectory, std::string(), &stats[0]) ||
+            !TimeLoad(sceneFileName, systemDirectory, cacheFileName, &stats[1]) ||
+            !TimeLoad(sceneFileName, systemDirectory, cacheFileName, &stats[2]))
+        {
+            return 1;
+        }
+        for (int mode = 0; mode < 3; mode++)
+        {
+            times[mode].push_back(stats[mode].milliseconds);
+            if (stats[mode].checksum != stats[0].checksum || stats[mode].modelBytes != stats[0].modelBytes)
+            {
+                printf("%s: the %s load parsed something else than the load without cache\n", sceneFileName.c_str(), pModeNames[mode]);
+                return 1;
+            }
+        }
+    }
+
+    printf("%s: %u config files, %u models (%.1f MB)\n", sceneFileName.c_str(),
+        stats[0].configCount, stats[0].modelCount, stats[0].modelBytes / (1024.0 * 1024.0));
+    printf("%-9s %10s %10s %6s %6s\n", "", "best ms", "median ms", "hits", "misses");
+    for (int mode = 0; mode < 3; mode++)
+    {
+        std::sort(times[mode].begin(), times[mode].end());
+        printf("%-9s %10.2f %10.2f %6u %6u\n", pModeNames[mode], times[mode][0], times[mode][times[mode].size() / 2],
+            stats[mode].hitCount, stats[mode].missCount);
+    }
+    return 0;
+}
@@ -0,0 +1,332 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// ShaderCacheTest: checks how CPUTShaderCache (CPUT/include/CPUTShaderCache.h) keys shaders and
+// tracks their includes, with a stub compiler instead of D3DCompile, so it runs on any platform.
+//
+//   ShaderCacheTest [<work directory>]
+//
+// It writes a small shader tree into the work directory (default "ShaderCacheTest.work", made
+// if missing) and checks that:
+// - ScanIncludes() finds #include "x" and <x> at the start of a line and skips comments
+// - the key changes with the profile, the entry point, each define and its order, and the
+//   compiler id, and doesn't change for an identical request
+// - dependencies are listed depth first, and a missing include only counts once it exists
+// - editing an include changes the key, editing an unrelated file doesn't, and the same tree
+//   in another directory gets the same key
+// - a shader given as source resolves its includes against the working directory
+// - an include cycle ends, a missing file and a compile error are reported
+// - the disk cache is read back by a new cache, and a damaged .cso is compiled again
+// It prints each failed check and returns the number of failures.
+//
+// ShaderCacheTest.vcxproj builds it with CPUTShaderCache.cpp and CPUTOSServicesWin.cpp. On
+// Linux, from this folder, with Extras/GLStub standing in for the GL headers CPUT.h includes:
+//   g++ -std=c++11 -O2 -DCPUT_OS_LINUX -I../../CPUT/include -I../GLStub
+//       ShaderCacheTest.cpp ../../CPUT/source/CPUTShaderCache.cpp
+//       ../../CPUT/source/linux/CPUTOSServicesLinux.cpp -o ShaderCacheTest
+
+#include "CPUTShaderCache.h"
+#include <stdio.h>
+#include <string.h>
+#ifdef CPUT_OS_WINDOWS
+#include <direct.h>
+#define chdir  _chdir
+#define getcwd _getcwd
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static int gFailures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { printf("FAILED line %d: %s\n", __LINE__, #condition); gFailures++; } } while (0)
+
+// Counts its compiles; the entry point "bad" fails like a syntax error would
+class StubCompiler : public CPUTShaderCompiler
+{
+public:
+    explicit StubCompiler(const char *pId = "stub 1") : mId(pId), mCompileCount(0) {}
+
+    std::string GetCompilerId() { return mId; }
+
+    bool Compile(const CPUTShaderCompileRequest &request, std::vector<char> *pBytecode, std::string *pErrors)
+    {
+        mCompileCount++;
+        if (request.entryPoint == "bad")
+        {
+            *pErrors = "error X3000: syntax error";
+            return false;
+        }
+        const std::string bytecode = "bytecode " + request.entryPoint + " " + request.profile;
+        pBytecode->assign(bytecode.begin(), bytecode.end());
+        return true;
+    }
+
+    std::string mId;
+    int         mCompileCount;
+};
+
+//-----------------------------------------------------------------------------
+static void MakeDirectory(const std::string &directory)
+{
+#ifdef CPUT_OS_WINDOWS
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+static void WriteFile(const std::string &fileName, const char *pText)
+{
+    FILE *pFile = fopen(fileName.c_str(), "wb");
+    CHECK(pFile != NULL);
+    if (pFile)
+    {
+        fputs(pText, pFile);
+        fclose(pFile);
+    }
+}
+
+//-----------------------------------------------------------------------------
+static uint64_t Key(CPUTShaderCache &cache, const CPUTShaderCompileRequest &request, std::vector<std::string> *pDependencies = NULL)
+{
+    uint64_t key = 0;
+    CHECK(CPUT_SUCCESS == cache.ComputeKey(request, &key, pDependencies));
+    return key;
+}
+
+// main.fx -> sub/common.h -> sub/light.h, sub/common.h (itself) and sub/missing.h (in #if 0)
+//-----------------------------------------------------------------------------
+static void WriteTree(const std::string &directory)
+{
+    MakeDirectory(directory);
+    MakeDirectory(directory + "/sub");
+    WriteFile(directory + "/main.fx", "#include \"sub/common.h\"\nfloat4 VSMain() : SV_Position { return 0; }\n");
+    WriteFile(directory + "/sub/common.h", "#include \"light.h\"\n#include \"common.h\"\n#if 0\n#include \"missing.h\"\n#endif\n");
+    WriteFile(directory + "/sub/light.h", "// light\n");
+    WriteFile(directory + "/unrelated.h", "// not included\n");
+    remove((directory + "/sub/missing.h").c_str());
+}
+
+//-----------------------------------------------------------------------------
+static void TestScanIncludes()
+{
+    const char *pSource =
+        "#include \"a.h\"\n"
+        "  #  include <b.h>\n"
+        "// #include \"c.h\"\n"
+        "/* #include \"d.h\"\n"
+        "*/ #include \"e.h\"\n"
+        "x = \"#include \\\"f.h\\\"\";\n"
+        "foo #include \"g.h\"\n"
+        "#includex\n"
+        "#include\t\"h.h\"";
+    std::vector<std::string> includes;
+    CPUTShaderCache::ScanIncludes(pSource, strlen(pSource), &includes);
+    CHECK(includes.size() == 4);
+    CHECK(includes.size() == 4 && includes[0] == "a.h" && includes[1] == "b.h" && includes[2] == "e.h" && includes[3] == "h.h");
+}
+
+//-----------------------------------------------------------------------------
+static void TestKeys(const std::string &work)
+{
+    WriteTree(work);
+    StubCompiler *pCompiler = new StubCompiler();
+    CPUTShaderCache cache(pCompiler);
+    CPUTShaderCompileRequest request;
+    request.fileName = work + "/main.fx";
+    request.entryPoint = "VSMain";
+    request.profile = "vs_4_0";
+
+    std::vector<std::string> dependencies;
+    const uint64_t key = Key(cache, request, &dependencies);
+    CHECK(dependencies.size() == 3);
+    CHECK(dependencies.size() == 3 && dependencies[0] == request.fileName &&
+          dependencies[1] == work + "/sub/common.h" && dependencies[2] == work + "/sub/light.h");
+    CHECK(Key(cache, request) == key);
+
+    CPUTShaderCompileRequest other = request;
+    other.profile = "vs_5_0";
+    CHECK(Key(cache, other) != key);
+    other = request;
+    other.entryPoint = "PSMain";
+    CHECK(Key(cache, other) != key);
+    other = request;
+    other.defines.push_back(CPUTShaderDefine("A", "1"));
+    const uint64_t keyA1 = Key(cache, other);
+    CHECK(keyA1 != key);
+    other.defines[0].definition = "2";
+    CHECK(Key(cache, other) != keyA1);
+    other.defines[0] = CPUTShaderDefine("A1", "");
+    CHECK(Key(cache, other) != keyA1);
+
+    // Later defines can depend on earlier ones, so the order counts
+    CPUTShaderCompileRequest xy = request, yx = request;
+    xy.defines.push_back(CPUTShaderDefine("X", "1"));
+    xy.defines.push_back(CPUTShaderDefine("Y", "1"));
+    yx.defines.push_back(CPUTShaderDefine("Y", "1"));
+    yx.defines.push_back(CPUTShaderDefine("X", "1"));
+    CHECK(Key(cache, xy) != Key(cache, yx));
+
+    CPUTShaderCache otherCompiler(new StubCompiler("stub 2"));
+    CHECK(Key(otherCompiler, request) != key);
+
+    // Compiled once, then served from memory
+    const std::vector<char> *pBytecode = NULL;
+    CHECK(CPUT_SUCCESS == cache.GetBytecode(request, &pBytecode) && pBytecode != NULL);
+    const std::vector<char> *pAgain = NULL;
+    CHECK(CPUT_SUCCESS == cache.GetBytecode(request, &pAgain));
+    CHECK(pAgain == pBytecode && pCompiler->mCompileCount == 1 && cache.GetMemoryHitCount() == 1);
+
+    // Source files are hashed once per ClearMemory()
+    WriteFile(work + "/unrelated.h", "// still not included\n");
+    cache.ClearMemory();
+    CHECK(Key(cache, request) == key);
+    WriteFile(work + "/sub/light.h", "// light 2\n");
+    CHECK(Key(cache, request) == key);
+    cache.ClearMemory();
+    const uint64_t editedKey = Key(cache, request);
+    CHECK(editedKey != key);
+    WriteFile(work + "/sub/missing.h", "// now there\n");
+    cache.ClearMemory();
+    CHECK(Key(cache, request) != editedKey);
+
+    // The same tree somewhere else
+    WriteTree(work + "/moved");
+    WriteTree(work + "/copy");
+    CPUTShaderCompileRequest moved = request, copy = request;
+    moved.fileName = work + "/moved/main.fx";
+    copy.fileName = work + "/copy/main.fx";
+    CHECK(Key(cache, moved) == Key(cache, copy));
+
+    CPUTShaderCompileRequest missing = request;
+    missing.fileName = work + "/none.fx";
+    uint64_t missingKey;
+    CHECK(CPUT_ERROR_FILE_NOT_FOUND == cache.ComputeKey(missing, &missingKey));
+    std::string errors;
+    const std::vector<char> *pMissing = NULL;
+    CHECK(CPUT_SUCCESS != cache.GetBytecode(missing, &pMissing, &errors) && pMissing == NULL);
+
+    CPUTShaderCompileRequest bad = request;
+    bad.entryPoint = "bad";
+    errors.clear();
+    const std::vector<char> *pBad = NULL;
+    CHECK(CPUT_ERROR == cache.GetBytecode(bad, &pBad, &errors) && errors == "error X3000: syntax error");
+
+    WriteFile(work + "/cycle.fx", "#include \"cycle.fx\"\n");
+    CPUTShaderCompileRequest cycle = request;
+    cycle.fileName = work + "/cycle.fx";
+    dependencies.clear();
+    Key(cache, cycle, &dependencies);
+    CHECK(dependencies.size() == 1);
+}
+
+// A shader given as source has no directory of its own, so includes are found from the
+// working directory (changed here with chdir(), CPUTFileSystem doesn't do it on Linux yet)
+//-----------------------------------------------------------------------------
+static void TestSourceRequest(const std::string &work)
+{
+    WriteTree(work);
+    char previousDirectory[4096];
+    CHECK(getcwd(previousDirectory, sizeof(previousDirectory)) != NULL);
+    CHECK(0 == chdir(work.c_str()));
+
+    CPUTShaderCache cache(new StubCompiler());
+    CPUTShaderCompileRequest request;
+    request.pSource = "#include \"sub/light.h\"\nvoid PSMain() {}\n";
+    request.entryPoint = "PSMain";
+    request.profile = "ps_5_0";
+    std::vector<std::string> dependencies;
+    const uint64_t key = Key(cache, request, &dependencies);
+    CHECK(dependencies.size() == 1 && dependencies[0] == "sub/light.h");
+    WriteFile("sub/light.h", "// light 3\n");
+    cache.ClearMemory();
+    CHECK(Key(cache, request) != key);
+
+    CHECK(0 == chdir(previousDirectory));
+}
+
+//-----------------------------------------------------------------------------
+static void TestDiskCache(const std::string &work)
+{
+    WriteTree(work);
+    CPUTShaderCompileRequest request;
+    request.fileName = work + "/main.fx";
+    request.entryPoint = "VSMain";
+    request.profile = "vs_4_0";
+    const std::string cacheDirectory = work + "/cache";
+
+    StubCompiler *pFirstCompiler = new StubCompiler();
+    CPUTShaderCache first(pFirstCompiler);
+    first.SetCacheDirectory(cacheDirectory);
+    const uint64_t key = Key(first, request);
+    remove(first.GetBytecodeFileName(key).c_str()); // from an earlier run
+    const std::vector<char> *pBytecode = NULL;
+    CHECK(CPUT_SUCCESS == first.GetBytecode(request, &pBytecode));
+    CHECK(pFirstCompiler->mCompileCount == 1 && first.GetCompileCount() == 1);
+
+    StubCompiler *pSecondCompiler = new StubCompiler();
+    CPUTShaderCache second(pSecondCompiler);
+    second.SetCacheDirectory(cacheDirectory);
+    const std::vector<char> *pLoaded = NULL;
+    CHECK(CPUT_SUCCESS == second.GetBytecode(request, &pLoaded));
+    CHECK(pSecondCompiler->mCompileCount == 0 && second.GetDiskHitCount() == 1);
+    CHECK(pBytecode && pLoaded && *pLoaded == *pBytecode);
+
+    FILE *pFile = fopen(second.GetBytecodeFileName(key).c_str(), "r+b");
+    CHECK(pFile != NULL);
+    if (pFile)
+    {
+        fseek(pFile, 8, SEEK_SET);
+        fputc('!', pFile);
+        fclose(pFile);
+    }
+    StubCompiler *pThirdCompiler = new StubCompiler();
+    CPUTShaderCache third(pThirdCompiler);
+    third.SetCacheDirectory(cacheDirectory);
+    CHECK(CPUT_SUCCESS == third.GetBytecode(request, &pLoaded));
+    CHECK(pThirdCompiler->mCompileCount == 1);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-'))
+    {
+        printf("usage: ShaderCacheTest [<work directory>]\n");
+        return 1;
+    }
+    const std::string work = (argc == 2) ? argv[1] : "ShaderCacheTest.work";
+    MakeDirectory(work);
+
+    TestScanIncludes();
+    TestKeys(work + "/keys");
+    TestSourceRequest(work + "/source");
+    TestDiskCache(work + "/disk");
+
+    if (gFailures)
+    {
+        printf("%d checks failed\n", gFailures);
+    }
+    else
+    {
+        printf("all checks passed\n");
+    }
+    return gFailures;
+}
@@ -0,0 +1,295 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// ShaderCook: compiles the shaders that .mtl files use into a DX11 shader cache, so CPUT starts
+// without calling D3DCompile. See CPUT/include/CPUTShaderCache.h for how the cache is keyed.
+//
+//   ShaderCook [-out <directory>] [-system <directory>] [-D NAME[=VALUE]] ... [-list] <file or directory> ...
+//
+// Directories are searched recursively for .mtl. Shaders are found the way CPUTAssetLibraryDX11
+// finds them: "<media>/Shader/<file>", <media> being the directory that holds the material's
+// "Material" directory, and "%<file>" in "<system>/Shader/". -D macros come before the ones
+// CPUT adds to every shader, as they would when passed to CPUTAssetLibraryDX11::Get*Shader().
+// The output (default "ShaderCacheDX11") goes next to the executable. Cooked permutations
+// are skipped, so running it again after editing a shader or an include only compiles what
+// changed.
+//
+// -list prints each permutation, its key and the files it depends on without compiling. It
+// runs anywhere; keys are only those the game uses when built with D3DCompiler on Windows.
+// ShaderCook.vcxproj builds it with CPUTShaderCache.cpp, CPUTShaderCompilerD3D.cpp,
+// CPUTConfigBlock.cpp, CPUTSceneCache.cpp and CPUTOSServicesWin.cpp. Extras/ShaderCacheTest checks the cache with a stub compiler.
+
+#include "CPUTShaderCache.h"
+#include "CPUTShaderCompilerD3D.h"
+#include "CPUTConfigBlock.h"
+#include <stdio.h>
+#include <string.h>
+#include <set>
+#include <vector>
+
+#ifdef CPUT_OS_WINDOWS
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+static const char *SHADER_STAGES[] = { "Vertex", "Pixel", "Compute", "Geometry", "Hull", "Domain" };
+
+#ifndef CPUT_OS_WINDOWS
+// Only -list works without D3DCompiler
+class CPUTShaderCompilerNone : public CPUTShaderCompiler
+{
+public:
+    std::string GetCompilerId() { return "none"; }
+    bool        Compile(const CPUTShaderCompileRequest &request, std::vector<char> *pBytecode, std::string *pErrors)
+    {
+        *pErrors = "no shader compiler on this platform";
+        return false;
+    }
+};
+#endif
+
+//-----------------------------------------------------------------------------
+static bool IsMaterialFile(const std::string &fileName)
+{
+    size_t dot = fileName.find_last_of('.');
+    return dot != std::string::npos && fileName.substr(dot) == ".mtl";
+}
+
+//-----------------------------------------------------------------------------
+static void FindMaterials(const std::string &path, std::vector<std::string> *pFiles)
+{
+#ifdef CPUT_OS_WINDOWS
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        pFiles->push_back(path);
+        return;
+    }
+    WIN32_FIND_DATAA findData;
+    HANDLE hFind = FindFirstFileA((path + "\\*").c_str(), &findData);
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    do
+    {
+        std::string name = findData.cFileName;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string child = path + "\\" + name;
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            FindMaterials(child, pFiles);
+        }
+        else if (IsMaterialFile(child))
+        {
+            pFiles->push_back(child);
+        }
+    } while (FindNextFileA(hFind, &findData));
+    FindClose(hFind);
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode))
+    {
+        pFiles->push_back(path);
+        return;
+    }
+    DIR *pDir = opendir(path.c_str());
+    if (!pDir)
+    {
+        return;
+    }
+    while (struct dirent *pEntry = readdir(pDir))
+    {
+        std::string name = pEntry->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string child = path + "/" + name;
+        if (stat(child.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+        {
+            FindMaterials(child, pFiles);
+        }
+        else if (IsMaterialFile(child))
+        {
+            pFiles->push_back(child);
+        }
+    }
+    closedir(pDir);
+#endif
+}
+
+// "<media>/Material/name.mtl" -> "<media>/Shader/"
+//-----------------------------------------------------------------------------
+static std::string GetShaderDirectory(const std::string &materialFileName)
+{
+    size_t separator = materialFileName.find_last_of("/\\");
+    std::string materialDirectory = (separator == std::string::npos) ? std::string() : materialFileName.substr(0, separator);
+    separator = materialDirectory.find_last_of("/\\");
+    std::string mediaDirectory = (separator == std::string::npos) ? std::string() : materialDirectory.substr(0, separator + 1);
+    return mediaDirectory + "Shader/";
+}
+
+//-----------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("usage: ShaderCook [-out <directory>] [-system <directory>] [-D NAME[=VALUE]] ... [-list] <file or directory> ...\n");
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    std::string outDirectory = "ShaderCacheDX11";
+    std::string systemDirectory;
+    bool list = false;
+    std::vector<CPUTShaderDefine> defines;
+
+    std::vector<std::string> files;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-list"))                        { list = true; }
+        else if (!strcmp(argv[ii], "-out") && ii + 1 < argc)    { outDirectory = argv[++ii]; }
+        else if (!strcmp(argv[ii], "-system") && ii + 1 < argc) { systemDirectory = argv[++ii]; }
+        else if (!strcmp(argv[ii], "-D") && ii + 1 < argc)
+        {
+            std::string define = argv[++ii];
+            size_t equals = define.find('=');
+            defines.push_back(equals == std::string::npos ?
+                CPUTShaderDefine(define, "1") :
+                CPUTShaderDefine(define.substr(0, equals), define.substr(equals + 1)));
+        }
+        else if (argv[ii][0] == '-')
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            FindMaterials(argv[ii], &files);
+        }
+    }
+    if (files.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+    CPUTShaderCompilerD3D::AddFileDefines(&defines);
+
+#ifdef CPUT_OS_WINDOWS
+    CPUTShaderCache cache(new CPUTShaderCompilerD3D());
+#else
+    CPUTShaderCache cache(new CPUTShaderCompilerNone());
+#endif
+    if (!list)
+    {
+        cache.SetCacheDirectory(outDirectory);
+    }
+
+    int permutations = 0, failed = 0;
+    std::set<uint64_t> seen;
+    for (size_t ii = 0; ii < files.size(); ii++)
+    {
+        CPUTConfigFile material;
+        CPUTConfigBlock *pBlock = CPUTSUCCESS(material.LoadFile(files[ii])) ? material.GetBlock(0) : NULL;
+        if (!pBlock)
+        {
+            printf("%s: can't read\n", files[ii].c_str());
+            failed++;
+            continue;
+        }
+        for (size_t stage = 0; stage < sizeof(SHADER_STAGES) / sizeof(SHADER_STAGES[0]); stage++)
+        {
+            const std::string prefix = std::string(SHADER_STAGES[stage]) + "Shader";
+            CPUTConfigEntry *pFile = pBlock->GetValueByName(prefix + "File");
+            if (!pFile->IsValid())
+            {
+                continue;
+            }
+            std::string shaderName = pFile->ValueAsString();
+            if (shaderName.empty() || shaderName[0] == '$')
+            {
+                continue; // made at runtime
+            }
+
+            CPUTShaderCompileRequest request;
+            request.entryPoint = pBlock->GetValueByName(prefix + "Main")->ValueAsString();
+            request.profile    = pBlock->GetValueByName(prefix + "Profile")->ValueAsString();
+            request.defines    = defines;
+            if (shaderName[0] == '%')
+            {
+                if (systemDirectory.empty())
+                {
+                    printf("%s: %s needs -system\n", files[ii].c_str(), shaderName.c_str());
+                    failed++;
+                    continue;
+                }
+                request.fileName = systemDirectory + "/Shader/" + shaderName.substr(1);
+            }
+            else
+            {
+                request.fileName = GetShaderDirectory(files[ii]) + shaderName;
+            }
+
+            uint64_t key;
+            std::vector<std::string> dependencies;
+            if (CPUTFAILED(cache.ComputeKey(request, &key, &dependencies)))
+            {
+                printf("%s: %s not found\n", files[ii].c_str(), request.fileName.c_str());
+                failed++;
+                continue;
+            }
+            if (!seen.insert(key).second)
+            {
+                continue;
+            }
+            permutations++;
+
+            if (list)
+            {
+                printf("%08x%08x %s %s %s\n", (UINT)(key >> 32), (UINT)key, request.fileName.c_str(), request.entryPoint.c_str(), request.profile.c_str());
+                for (size_t dd = 1; dd < dependencies.size(); dd++)
+                {
+                    printf("    %s\n", dependencies[dd].c_str());
+                }
+                continue;
+            }
+
+            const std::vector<char> *pBytecode;
+            std::string errors;
+            if (CPUTFAILED(cache.GetBytecode(request, &pBytecode, &errors)))
+            {
+                printf("%s %s %s: failed\n%s\n", request.fileName.c_str(), request.entryPoint.c_str(), request.profile.c_str(), errors.c_str());
+                failed++;
+            }
+        }
+    }
+
+    if (list)
+    {
+        printf("%d permutations in %d materials, %d failed\n", permutations, (int)files.size(), failed);
+    }
+    else
+    {
+        printf("%d permutations in %d materials: %d compiled, %d up to date, %d failed\n",
+            permutations, (int)files.size(), (int)cache.GetCompileCount(), (int)cache.GetDiskHitCount(), failed);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,399 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// ShadowCacheTest: runs CPUTShadowCache, the shadow pass ChatHeads draws with "Cache static
+// shadows", over a few frames of an asset set without a device, and checks which casters each
+// frame draws and what ends up in the shadow map.
+//
+//   ShadowCacheTest
+//
+// The set is drawn with CPUTAssetSet::RenderRecursive(), so which models each pass draws comes
+// from CPUT: CPUTRenderNode::IsDynamic(), the static scene version and the CPUT_DRAW_NODES filter
+// in RenderRecursive() and CPUTInstanceGroup::Render(). NullMesh records each draw into the map
+// the pass draws to; the copy of the static map is a copy of that record. Every frame the shadow
+// map has to hold each caster exactly once.
+//
+// Scene: 5 copies of a static prop, a dynamic model, a static model parented to the dynamic one
+// (which makes it dynamic too) and a camera node. Expected casters drawn and static map copies:
+//   first frame 7 casters, idle 2, camera moved 2, dynamic moved 2, static moved 7, idle 2
+//   without the cache 7 every frame
+// A scene with static models alone only copies when the static map was redrawn, and flagging
+// a model dynamic redraws the static map without it. Each scene runs twice: drawing every model
+// on its own, and with a per-instance constant buffer, so the prop's copies are drawn by a
+// CPUTInstanceGroup. It prints each frame, each failed check, and returns the number of failures.
+//
+// ShadowCacheTest.vcxproj builds it with CPUT_FOR_DX11, CPUTShadowCache.cpp and the CPUT
+// sources asset sets and models need, without CPUTDX and without a device.
+
+#include "CPUTShadowCache.h"
+#include "CPUTAssetSet.h"
+#include "CPUTAssetLibrary.h"
+#include "CPUTModel.h"
+#include "CPUTMesh.h"
+#include "CPUTMaterial.h"
+#include "CPUTBuffer.h"
+#include "CPUTTexture.h"
+#include "CPUTRenderStateBlock.h"
+#include "CPUTRenderParams.h"
+#include "CPUTInputLayoutCache.h"
+#ifdef CPUT_FOR_DX11
+#include "CPUTMaterialDX11.h"
+#include "CPUTMeshDX11.h"
+#endif
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+static int gFailures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { printf("FAILED line %d: %s\n", __LINE__, #condition); gFailures++; } } while (0)
+
+// Mesh ids drawn into the map the pass is drawing to
+static std::vector<int> *gpDrawTarget = NULL;
+static int gCastersDrawn = 0;
+
+class NullBuffer : public CPUTBuffer
+{
+public:
+    NullBuffer(std::string name) : CPUTBuffer(name, NULL) {}
+    void SetData(UINT, UINT, void *) {}
+    void GetData(void *) {}
+};
+
+class NullMesh : public CPUTMesh
+{
+public:
+    NullMesh(int id) : mId(id) {}
+
+    void Draw() { DrawInstanced(1); }
+    bool CanDrawInstanced() { return true; }
+    void DrawInstanced(UINT instanceCount)
+    {
+        gpDrawTarget->insert(gpDrawTarget->end(), instanceCount, mId);
+        gCastersDrawn += instanceCount;
+    }
+#ifndef CPUT_FOR_DX11
+    void *MapVertices(CPUTRenderParameters &, eCPUTMapType, bool) { return NULL; }
+    void *MapIndices(CPUTRenderParameters &, eCPUTMapType, bool) { return NULL; }
+#endif
+    void UnmapVertices(CPUTRenderParameters &) {}
+    void UnmapIndices(CPUTRenderParameters &) {}
+    CPUTResult CreateNativeResources(CPUTModel *, UINT, int, CPUTBufferElementInfo *, UINT, void *, CPUTBufferElementInfo *, UINT, void *) { return CPUT_SUCCESS; }
+
+private:
+    int mId;
+};
+
+class NullRenderStateBlock : public CPUTRenderStateBlock
+{
+public:
+    CPUTResult LoadRenderStateBlock(const std::string &) { return CPUT_SUCCESS; }
+    void SetRenderStates() {}
+    void CreateNativeResources() {}
+};
+
+class NullMaterial : public CPUTMaterial
+{
+public:
+    // Takes pInstancedMaterial's reference
+    NullMaterial(NullMaterial *pInstancedMaterial)
+    {
+        mpRenderStateBlock = new NullRenderStateBlock();
+        mpInstancedMaterial = pInstancedMaterial;
+    }
+    CPUTResult LoadMaterial(const std::string &, CPUT_SHADER_MACRO *) { return CPUT_SUCCESS; }
+
+protected:
+    ~NullMaterial()
+    {
+        SAFE_RELEASE(mpRenderStateBlock);
+        SAFE_RELEASE(mpInstancedMaterial);
+    }
+};
+
+class NullInputLayoutCache : public CPUTInputLayoutCache
+{
+};
+static NullInputLayoutCache *gpInputLayoutCache = NULL;
+
+//-----------------------------------------------------------------------------
+// What CPUTDX supplies for these, without a device
+void SetMaterialStates(CPUTMaterial *, CPUTMaterial *) {}
+void SetRenderStateBlock(CPUTRenderStateBlock *, CPUTRenderStateBlock *) {}
+
+CPUTInputLayoutCache *CPUTInputLayoutCache::GetInputLayoutCache()
+{
+    if (!gpInputLayoutCache)
+    {
+        gpInputLayoutCache = new NullInputLayoutCache();
+    }
+    return gpInputLayoutCache;
+}
+
+void CPUTInputLayoutCache::DeleteInputLayoutCache()
+{
+    SAFE_DELETE(gpInputLayoutCache);
+}
+
+// Nothing is loaded from files, so the factories CPUTModel and CPUTAssetLibrary load with are
+// never called
+CPUTAssetLibrary *CPUTAssetLibrary::GetAssetLibrary() { return NULL; }
+CPUTRenderStateBlock *CPUTRenderStateBlock::Create(const std::string &, const std::string &) { return NULL; }
+CPUTTexture *CPUTTexture::Create(const std::string &, const std::string, bool) { return NULL; }
+#ifdef CPUT_FOR_DX11
+CPUTMaterialDX11 *CPUTMaterialDX11::Create() { return NULL; }
+CPUTMeshDX11 *CPUTMeshDX11::Create() { return NULL; }
+#endif
+
+// One mesh and material, shared by the copies of a prop like CPUTModel::LoadModel() with a
+// master model
+class TestModel : public CPUTModel
+{
+public:
+    TestModel(CPUTMesh *pMesh, CPUTMaterial *pMaterial)
+    {
+        mMeshCount = 1;
+        mpMesh = new CPUTMesh *[1];
+        mpMesh[0] = pMesh;
+        pMesh->AddRef();
+        mpMaterialCount = new int[1];
+        mpMaterialCount[0] = 0;
+        mpMaterial = new CPUTMaterial **[1];
+        mpMaterial[0] = NULL;
+        SetMaterial(0, &pMaterial, 1);
+        mBoundingBoxCenterObjectSpace = float3(0.0f);
+        mBoundingBoxHalfObjectSpace = float3(0.5f);
+    }
+};
+
+// The set the tests build up node by node
+class TestSet : public CPUTAssetSet
+{
+public:
+    TestSet()
+    {
+        mpRootNode = CPUTNullNode::Create();
+        mppAssetList = new CPUTRenderNode *[MAX_NODES];
+        mppAssetList[0] = mpRootNode;
+        mpRootNode->AddRef();
+        mAssetCount = 1;
+    }
+
+    CPUTRenderNode *AddNode(CPUTRenderNode *pNode, CPUTRenderNode *pParent)
+    {
+        pParent = pParent ? pParent : mpRootNode;
+        pParent->AddChild(pNode);
+        pNode->SetParent(pParent);
+        mppAssetList[mAssetCount++] = pNode; // takes the reference
+        return pNode;
+    }
+
+    // A model with a mesh and material of its own
+    CPUTModel *AddModel(int meshId, CPUTRenderNode *pParent = NULL)
+    {
+        NullMesh *pMesh = new NullMesh(meshId);
+        NullMaterial *pMaterial = new NullMaterial(new NullMaterial(NULL));
+        CPUTModel *pModel = AddCopy(pMesh, pMaterial, pParent);
+        pMesh->Release();
+        pMaterial->Release();
+        return pModel;
+    }
+
+    CPUTModel *AddCopy(CPUTMesh *pMesh, CPUTMaterial *pMaterial, CPUTRenderNode *pParent = NULL)
+    {
+        return (CPUTModel *)AddNode(new TestModel(pMesh, pMaterial), pParent);
+    }
+
+    void Finish() { BuildInstanceGroups(); }
+    UINT GetInstanceGroupCount() const { return (UINT)mInstanceGroups.size(); }
+
+private:
+    static const UINT MAX_NODES = 16;
+};
+
+// The shadow pass's render targets, each a record of the meshes drawn into it
+class TestTargets : public CPUTShadowCacheTargets
+{
+public:
+    TestTargets(TestSet *pSet, bool instanced) : mpSet(pSet), mbInstanced(instanced), mCopyCount(0) {}
+
+    void DrawShadowCasters(CPUTRenderParameters &renderParams, bool bStaticMap, bool bClear)
+    {
+        std::vector<int> &target = bStaticMap ? mStaticMap : mShadowMap;
+        if (bClear)
+        {
+            target.clear();
+        }
+        NullBuffer perInstanceConstants("$cbPerInstanceValues");
+        renderParams.mpPerInstanceConstants = mbInstanced ? &perInstanceConstants : NULL;
+        gpDrawTarget = &target;
+        mpSet->RenderRecursive(renderParams, 0);
+        gpDrawTarget = NULL;
+        renderParams.mpPerInstanceConstants = NULL;
+    }
+    void CopyStaticShadowMap()
+    {
+        mShadowMap = mStaticMap;
+        mCopyCount++;
+    }
+
+    std::vector<int> mShadowMap;
+    std::vector<int> mStaticMap;
+    int              mCopyCount;
+
+private:
+    TestSet *mpSet;
+    bool     mbInstanced;
+};
+
+//-----------------------------------------------------------------------------
+static void CheckFrame(CPUTShadowCache &cache, TestTargets &targets, const char *pWhat, bool bCacheStaticShadows,
+    const std::vector<int> &casters, int expectedDrawn, int expectedCopies)
+{
+    CPUTRenderParameters renderParams;
+    gCastersDrawn = 0;
+    targets.mCopyCount = 0;
+    cache.Render(renderParams, bCacheStaticShadows, &targets);
+    printf("  %-20s %d casters in %d shadow draws, %d copies, static scene version %u\n",
+        pWhat, gCastersDrawn, cache.GetDrawCount(), targets.mCopyCount, CPUTRenderNode::GetStaticSceneVersion());
+    if (gCastersDrawn != expectedDrawn || targets.mCopyCount != expectedCopies)
+    {
+        printf("FAILED: expected %d casters and %d copies\n", expectedDrawn, expectedCopies);
+        gFailures++;
+    }
+    std::vector<int> shadowMap = targets.mShadowMap;
+    std::sort(shadowMap.begin(), shadowMap.end());
+    if (shadowMap != casters)
+    {
+        printf("FAILED: the shadow map holds %d casters, not each of the %d once\n", (int)shadowMap.size(), (int)casters.size());
+        gFailures++;
+    }
+    CHECK(renderParams.mDrawNodes == CPUT_DRAW_ALL_NODES);
+}
+
+//-----------------------------------------------------------------------------
+static void TestMixedScene(bool instanced)
+{
+    printf("mixed scene, %s\n", instanced ? "instanced" : "per model");
+    TestSet *pSet = new TestSet();
+    CPUTRenderNode *pCamera = pSet->AddNode(CPUTNullNode::Create(), NULL);
+    NullMesh *pPropMesh = new NullMesh(0);
+    NullMaterial *pPropMaterial = new NullMaterial(new NullMaterial(NULL));
+    CPUTModel *pStatic[5];
+    for (int ii = 0; ii < 5; ii++)
+    {
+        pStatic[ii] = pSet->AddCopy(pPropMesh, pPropMaterial);
+        pStatic[ii]->SetParentMatrix(float4x4Translation(ii * 2.0f, 0.0f, 0.0f));
+    }
+    pPropMesh->Release();
+    pPropMaterial->Release();
+    CPUTModel *pDynamic = pSet->AddModel(1);
+    pDynamic->SetDynamic(true);
+    CPUTModel *pRider = pSet->AddModel(2, pDynamic);
+    pSet->Finish();
+    CHECK(pSet->GetInstanceGroupCount() == 1);
+    CHECK(pDynamic->IsDynamic() && pRider->IsDynamic() && !pStatic[0]->IsDynamic());
+
+    const int meshIds[] = { 0, 0, 0, 0, 0, 1, 2 };
+    const std::vector<int> casters(meshIds, meshIds + 7);
+    CPUTShadowCache cache;
+    TestTargets targets(pSet, instanced);
+    const float4x4 moved = float4x4Translation(1.0f, 0.0f, 0.0f);
+    CheckFrame(cache, targets, "first frame", true, casters, 7, 1);
+    CheckFrame(cache, targets, "idle", true, casters, 2, 1);
+
+    UINT version = CPUTRenderNode::GetStaticSceneVersion();
+    pCamera->SetParentMatrix(moved);
+    CHECK(CPUTRenderNode::GetStaticSceneVersion() == version);
+    CheckFrame(cache, targets, "camera moved", true, casters, 2, 1);
+
+    pDynamic->SetParentMatrix(moved);
+    CHECK(CPUTRenderNode::GetStaticSceneVersion() == version);
+    CheckFrame(cache, targets, "dynamic moved", true, casters, 2, 1);
+
+    pStatic[1]->SetParentMatrix(moved);
+    CHECK(CPUTRenderNode::GetStaticSceneVersion() == version + 1);
+    CheckFrame(cache, targets, "static moved", true, casters, 7, 1);
+    CheckFrame(cache, targets, "idle", true, casters, 2, 1);
+
+    CheckFrame(cache, targets, "without the cache", false, casters, 7, 0);
+    CheckFrame(cache, targets, "cache again", true, casters, 7, 1);
+
+    SAFE_RELEASE(pSet);
+}
+
+//-----------------------------------------------------------------------------
+static void TestStaticScene(bool instanced)
+{
+    printf("static scene, %s\n", instanced ? "instanced" : "per model");
+    TestSet *pSet = new TestSet();
+    NullMesh *pPropMesh = new NullMesh(0);
+    NullMaterial *pPropMaterial = new NullMaterial(new NullMaterial(NULL));
+    CPUTModel *pModels[3];
+    for (int ii = 0; ii < 3; ii++)
+    {
+        pModels[ii] = pSet->AddCopy(pPropMesh, pPropMaterial);
+    }
+    pPropMesh->Release();
+    pPropMaterial->Release();
+    pSet->Finish();
+    CHECK(pSet->GetInstanceGroupCount() == 1);
+
+    const std::vector<int> casters(3, 0);
+    CPUTShadowCache cache;
+    TestTargets targets(pSet, instanced);
+    CheckFrame(cache, targets, "static first frame", true, casters, 3, 1);
+    CheckFrame(cache, targets, "static idle", true, casters, 0, 0);
+    pModels[0]->SetParentMatrix(float4x4Translation(0.0f, 1.0f, 0.0f));
+    CheckFrame(cache, targets, "static moved", true, casters, 3, 1);
+    CheckFrame(cache, targets, "static idle", true, casters, 0, 0);
+
+    // Flagged dynamic, it leaves the static map; the group draws its static and dynamic members apart
+    pModels[2]->SetDynamic(true);
+    CheckFrame(cache, targets, "flagged dynamic", true, casters, 3, 1);
+    CheckFrame(cache, targets, "idle", true, casters, 1, 1);
+
+    SAFE_RELEASE(pSet);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+    {
+        printf("usage: ShadowCacheTest\n");
+        return 1;
+    }
+
+    for (int instanced = 0; instanced < 2; instanced++)
+    {
+        TestMixedScene(instanced != 0);
+        TestStaticScene(instanced != 0);
+    }
+    CPUTInputLayoutCache::DeleteInputLayoutCache();
+
+    if (gFailures)
+    {
+        printf("%d checks failed\n", gFailures);
+    }
+    else
+    {
+        printf("all checks passed\n");
+    }
+    return gFailures;
+}
@@ -0,0 +1,605 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// StreamingBufferTest: runs CPUTStreamingBufferOGL (CPUT/include/opengl/CPUTStreamingBufferOGL.h)
+// against a fake GL whose "GPU" reads each frame's data two frames after it was written, and
+// checks that nothing is overwritten before it has been read.
+//
+//   StreamingBufferTest [-frames <count>] [-seed <number>]
+//
+// The fake keeps the buffer in memory and remembers every range written and the fence that
+// covers it. Each write is filled with one byte value, and when its fence signals the range
+// must still hold it. It also checks that allocations are aligned and inside the buffer, that
+// no fence is waited on or deleted after it was deleted, that the regions in flight stay few,
+// and that the destructor deletes every fence and the buffer. Checked cases:
+// - persistent mapping, random allocations each frame (default 2000 frames)
+// - persistent mapping, a frame that writes more than the whole buffer
+// - Upload() copies what was written, from where it was written
+// - uniform blocks bound in the ring: every "draw" reads the bound block, from the ring or from
+//   the buffer's own storage after it was copied back, and gets what was last written to it;
+//   what it read in the ring has to stay there until the frame's fence signals. Some frames
+//   write nothing, some write more than the whole ring.
+// - orphaning, when persistent mapping isn't supported or fails
+// It prints each failed check and returns the number of failures.
+//
+// StreamingBufferTest.vcxproj builds it with CPUTStreamingBufferOGL.cpp, CPUTOSServicesWin.cpp
+// and CPUT_FOR_OGL, with Extras/GLStub ahead of the CPUT includes: GL types, enums and entry
+// points that do nothing, and GL_CHECK for CPUT_OGL.h. No GL SDK, glew or context is needed.
+
+#include "CPUTStreamingBufferOGL.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+static int gFailures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { printf("FAILED line %d: %s\n", __LINE__, #condition); gFailures++; } } while (0)
+
+// What the fake saw, kept after the streaming buffer has deleted it
+struct FakeGLStats
+{
+    int    maps;
+    int    unmaps;
+    int    orphans;
+    int    fences;
+    int    waits;
+    int    blockingWaits;
+    int    copies;
+    int    binds;
+    UINT   lastCopyOffset;
+    UINT   lastCopySize;
+    size_t liveFencesAtExit;
+    bool   bBufferDeleted;
+
+    FakeGLStats() { memset(this, 0, sizeof(*this)); }
+};
+
+class FakeGL : public CPUTStreamingBufferGL
+{
+public:
+    FakeGL(FakeGLStats *pStats, bool bPersistent, bool bMappingFails = false, int lagFrames = 2)
+        : mpStats(pStats), mbPersistent(bPersistent), mbMappingFails(bMappingFails), mLagFrames(lagFrames),
+          mFrame(0), mCompleted(0), mbMapped(false)
+    {
+        mFenceFrames.push_back(0); // fence ids start at 1
+    }
+
+    ~FakeGL()
+    {
+        mpStats->liveFencesAtExit = mLiveFences.size();
+    }
+
+    bool SupportsPersistentMapping() { return mbPersistent; }
+
+    GLuint CreateBuffer(GLsizeiptr sizeBytes, bool bPersistent, void **ppMapped)
+    {
+        mMemory.assign((size_t)sizeBytes, 0);
+        if (bPersistent && !mbMappingFails)
+        {
+            *ppMapped = &mMemory[0];
+        }
+        return 1;
+    }
+
+    void DeleteBuffer(GLuint buffer, bool bPersistent)
+    {
+        mpStats->bBufferDeleted = true;
+    }
+
+    void *MapRange(GLuint buffer, GLintptr offset, GLsizeiptr sizeBytes)
+    {
+        CHECK(!mbMapped && offset >= 0 && (size_t)(offset + sizeBytes) <= mMemory.size());
+        mbMapped = true;
+        mpStats->maps++;
+        return &mMemory[(size_t)offset];
+    }
+
+    void Unmap(GLuint buffer)
+    {
+        CHECK(mbMapped);
+        mbMapped = false;
+        mpStats->unmaps++;
+    }
+
+    void Orphan(GLuint buffer, GLsizeiptr sizeBytes)
+    {
+        // The driver hands out new storage, whatever was written can't be overwritten any more
+        mWrites.clear();
+        mpStats->orphans++;
+    }
+
+    GLsync InsertFence()
+    {
+        const intptr_t fence = (intptr_t)mFenceFrames.size();
+        mFenceFrames.push_back(mFrame);
+        mLiveFences.insert(fence);
+        for (size_t ii = 0; ii < mWrites.size(); ii++)
+        {
+            if (0 == mWrites[ii].fence)
+            {
+                mWrites[ii].fence = fence;
+            }
+        }
+        for (size_t ii = 0; ii < mReads.size(); ii++)
+        {
+            if (0 == mReads[ii].fence)
+            {
+                mReads[ii].fence = fence;
+            }
+        }
+        mpStats->fences++;
+        return (GLsync)fence;
+    }
+
+    bool WaitFence(GLsync sync, bool bBlock)
+    {
+        const intptr_t fence = (intptr_t)sync;
+        CHECK(mLiveFences.count(fence) == 1);
+        mpStats->waits++;
+        if (fence <= mCompleted)
+        {
+            return true;
+        }
+        if (!bBlock)
+        {
+            return false;
+        }
+        mpStats->blockingWaits++;
+        Signal(fence);
+        return true;
+    }
+
+    void DeleteFence(GLsync sync)
+    {
+        CHECK(mLiveFences.erase((intptr_t)sync) == 1);
+    }
+
+    void CopyBuffer(GLuint srcBuffer, GLintptr srcOffset, GLuint dstBuffer, GLintptr dstOffset, GLsizeiptr sizeBytes)
+    {
+        CHECK(srcBuffer == 1 && srcOffset >= 0 && (size_t)(srcOffset + sizeBytes) <= mMemory.size());
+        mpStats->copies++;
+        mpStats->lastCopyOffset = (UINT)srcOffset;
+        mpStats->lastCopySize   = (UINT)sizeBytes;
+
+        // The copy happens right away, the source has to stay put until the fence anyway
+        std::vector<char> &dst = mBuffers[dstBuffer];
+        dst.resize(std::max(dst.size(), (size_t)(dstOffset + sizeBytes)));
+        memcpy(&dst[(size_t)dstOffset], &mMemory[(size_t)srcOffset], (size_t)sizeBytes);
+        AddRead((UINT)srcOffset, (UINT)(srcOffset + sizeBytes));
+    }
+
+    void BindUniformBuffer(GLuint bindPoint, GLuint buffer, GLintptr offset, GLsizeiptr sizeBytes)
+    {
+        CHECK(sizeBytes == 0 || (buffer == 1 && offset % UNIFORM_ALIGNMENT == 0 && (size_t)(offset + sizeBytes) <= mMemory.size()));
+        Binding binding = { buffer, (UINT)offset, (UINT)sizeBytes };
+        mBindings[bindPoint] = binding;
+        mpStats->binds++;
+    }
+
+    UINT GetUniformOffsetAlignment() { return UNIFORM_ALIGNMENT; }
+
+    // A draw reads the uniform block at bindPoint, which should hold expected
+    void Draw(GLuint bindPoint, const std::vector<char> &expected)
+    {
+        const Binding &binding = mBindings[bindPoint];
+        const char *pData = NULL;
+        if (binding.buffer == 1)
+        {
+            CHECK(binding.size == expected.size());
+            pData = &mMemory[binding.offset];
+            AddRead(binding.offset, binding.offset + binding.size);
+        }
+        else if (mBuffers[binding.buffer].size() >= expected.size())
+        {
+            pData = &mBuffers[binding.buffer][0];
+        }
+        if (NULL == pData || memcmp(pData, &expected[0], expected.size()))
+        {
+            printf("FAILED: bind point %u (buffer %u, %s) doesn't hold what was written\n", bindPoint, binding.buffer,
+                binding.buffer == 1 ? "in the ring" : "own storage");
+            gFailures++;
+        }
+    }
+
+    // The streaming buffer handed out [begin, end) and it was filled with value
+    void AddWrite(UINT begin, UINT end, char value)
+    {
+        CHECK(begin < end && end <= mMemory.size());
+        for (size_t ii = 0; ii < mWrites.size(); ii++)
+        {
+            if (mWrites[ii].begin < end && begin < mWrites[ii].end)
+            {
+                printf("FAILED: [%u, %u) overwrites [%u, %u) before the GPU read it\n", begin, end, mWrites[ii].begin, mWrites[ii].end);
+                gFailures++;
+                break;
+            }
+        }
+        Write write = { begin, end, 0, value };
+        mWrites.push_back(write);
+    }
+
+    const char *GetMemory() const { return &mMemory[0]; }
+
+    // The GPU moves on a frame, finishing the frame mLagFrames before
+    void NextFrame()
+    {
+        mFrame++;
+        intptr_t fence = mCompleted;
+        while (fence + 1 < (intptr_t)mFenceFrames.size() && mFenceFrames[fence + 1] + mLagFrames <= mFrame)
+        {
+            fence++;
+        }
+        Signal(fence);
+    }
+
+    static const UINT UNIFORM_ALIGNMENT = 64;
+
+protected:
+    struct Write
+    {
+        UINT     begin;
+        UINT     end;
+        intptr_t fence; // 0 until a fence covers it
+        char     value;
+    };
+
+    // The GPU reads [begin, end) of the ring some time before fence, it has to hold contents then
+    struct Read
+    {
+        UINT              begin;
+        UINT              end;
+        intptr_t          fence;
+        std::vector<char> contents;
+    };
+
+    struct Binding
+    {
+        GLuint buffer;
+        UINT   offset;
+        UINT   size; // 0 for the whole buffer
+    };
+
+    void AddRead(UINT begin, UINT end)
+    {
+        Read read = { begin, end, 0, std::vector<char>(mMemory.begin() + begin, mMemory.begin() + end) };
+        mReads.push_back(read);
+    }
+
+    // Everything up to fence has been read, check it was still there
+    void Signal(intptr_t fence)
+    {
+        mCompleted = std::max(mCompleted, fence);
+        size_t kept = 0;
+        for (size_t ii = 0; ii < mWrites.size(); ii++)
+        {
+            const Write &write = mWrites[ii];
+            if (0 == write.fence || write.fence > mCompleted)
+            {
+                mWrites[kept++] = write;
+                continue;
+            }
+            for (UINT jj = write.begin; jj < write.end; jj++)
+            {
+                if (mMemory[jj] != write.value)
+                {
+                    printf("FAILED: [%u, %u) was overwritten before fence %d signalled\n", write.begin, write.end, (int)write.fence);
+                    gFailures++;
+                    break;
+                }
+            }
+        }
+        mWrites.resize(kept);
+
+        kept = 0;
+        for (size_t ii = 0; ii < mReads.size(); ii++)
+        {
+            const Read &read = mReads[ii];
+            if (0 == read.fence || read.fence > mCompleted)
+            {
+                mReads[kept++] = read;
+                continue;
+            }
+            if (memcmp(&mMemory[read.begin], &read.contents[0], read.contents.size()))
+            {
+                printf("FAILED: [%u, %u) changed before the GPU read it (fence %d)\n", read.begin, read.end, (int)read.fence);
+                gFailures++;
+            }
+        }
+        mReads.resize(kept);
+    }
+
+    FakeGLStats          *mpStats;
+    bool                  mbPersistent;
+    bool                  mbMappingFails;
+    int                   mLagFrames;
+    int                   mFrame;
+    intptr_t              mCompleted;   // fences up to this one have signalled
+    bool                  mbMapped;
+    std::vector<char>     mMemory;
+    std::vector<int>      mFenceFrames; // frame each fence was inserted in
+    std::set<intptr_t>    mLiveFences;
+    std::vector<Write>    mWrites;      // not read by the GPU yet
+    std::vector<Read>     mReads;       // ring reads of draws and copies not done yet
+    std::map<GLuint, std::vector<char> > mBuffers; // other buffers, what was copied into them
+    std::map<GLuint, Binding> mBindings;
+};
+
+const UINT BUFFER_SIZE = 4096;
+
+// Allocates, fills and records one write, returns its offset
+//-----------------------------------------------------------------------------
+static UINT Write(CPUTStreamingBufferOGL &buffer, FakeGL *pGL, UINT sizeBytes, UINT alignment, char value)
+{
+    UINT offset = 0;
+    char *pData = (char*)buffer.Allocate(sizeBytes, alignment, &offset);
+    CHECK(pData != NULL);
+    if (pData)
+    {
+        CHECK(pData == pGL->GetMemory() + offset);
+        CHECK(offset % alignment == 0 && offset + sizeBytes <= buffer.GetSize());
+        memset(pData, value, sizeBytes);
+        pGL->AddWrite(offset, offset + sizeBytes, value);
+    }
+    buffer.EndWrite();
+    return offset;
+}
+
+//-----------------------------------------------------------------------------
+static void TestPersistent(int frameCount, unsigned int seed)
+{
+    static const UINT alignments[] = { 1, 4, 16, 256 };
+    FakeGLStats stats;
+    FakeGL *pGL = new FakeGL(&stats, true);
+    UINT allocationCount = 0;
+    UINT maxRegions = 0;
+    {
+        CPUTStreamingBufferOGL buffer(pGL, BUFFER_SIZE);
+        CHECK(buffer.IsPersistent());
+        srand(seed);
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            pGL->NextFrame();
+            buffer.OnFrameStart();
+            const int writeCount = rand() % 7;
+            for (int ii = 0; ii < writeCount; ii++)
+            {
+                const UINT sizeBytes = 1 + rand() % 600;
+                Write(buffer, pGL, sizeBytes, alignments[rand() % 4], (char)(1 + allocationCount % 255));
+                allocationCount++;
+            }
+            maxRegions = std::max(maxRegions, buffer.GetRegionsInFlight());
+        }
+        UINT offset;
+        CHECK(buffer.Allocate(BUFFER_SIZE + 1, 1, &offset) == NULL);
+        CHECK(buffer.Allocate(0, 1, &offset) == NULL);
+    }
+    // A region per frame plus one when the frame wraps, for the frames the GPU is behind
+    CHECK(maxRegions <= 6);
+    CHECK(stats.liveFencesAtExit == 0 && stats.bBufferDeleted);
+    printf("persistent: %d frames, %u allocations, %d fences, %d waits (%d blocking), at most %u regions in flight\n",
+        frameCount, allocationCount, stats.fences, stats.waits, stats.blockingWaits, maxRegions);
+}
+
+// One frame writes five times the buffer, so it has to wait for its own earlier writes
+//-----------------------------------------------------------------------------
+static void TestFrameBiggerThanBuffer()
+{
+    FakeGLStats stats;
+    FakeGL *pGL = new FakeGL(&stats, true);
+    {
+        CPUTStreamingBufferOGL buffer(pGL, BUFFER_SIZE);
+        for (int frame = 0; frame < 3; frame++)
+        {
+            pGL->NextFrame();
+            buffer.OnFrameStart();
+            Write(buffer, pGL, 1000, 16, (char)(1 + frame));
+        }
+        pGL->NextFrame();
+        buffer.OnFrameStart();
+        for (int ii = 0; ii < 20; ii++)
+        {
+            Write(buffer, pGL, 1000, 16, (char)(10 + ii));
+        }
+        pGL->NextFrame();
+        buffer.OnFrameStart();
+    }
+    CHECK(stats.blockingWaits > 0);
+    CHECK(stats.liveFencesAtExit == 0 && stats.bBufferDeleted);
+    printf("bigger than the buffer: %d fences, %d blocking waits\n", stats.fences, stats.blockingWaits);
+}
+
+//-----------------------------------------------------------------------------
+static void TestUpload()
+{
+    FakeGLStats stats;
+    FakeGL *pGL = new FakeGL(&stats, true);
+    {
+        CPUTStreamingBufferOGL buffer(pGL, BUFFER_SIZE);
+        std::vector<char> data;
+        for (int ii = 0; ii < 60; ii++)
+        {
+            if (ii % 3 == 0)
+            {
+                pGL->NextFrame();
+                buffer.OnFrameStart();
+            }
+            data.assign(1 + rand() % 900, (char)(1 + ii));
+            CHECK(CPUT_SUCCESS == buffer.Upload(5, 64, (UINT)data.size(), &data[0]));
+            CHECK(stats.copies == ii + 1 && stats.lastCopySize == data.size());
+            CHECK(memcmp(pGL->GetMemory() + stats.lastCopyOffset, &data[0], data.size()) == 0);
+            pGL->AddWrite(stats.lastCopyOffset, stats.lastCopyOffset + (UINT)data.size(), data[0]);
+        }
+        data.resize(BUFFER_SIZE + 1);
+        CHECK(CPUT_ERROR_INVALID_PARAMETER == buffer.Upload(5, 0, (UINT)data.size(), &data[0]));
+    }
+    CHECK(stats.liveFencesAtExit == 0);
+}
+
+// Uniform blocks written into the ring and drawn from, against what was written to them
+//-----------------------------------------------------------------------------
+static void TestUniformBuffers(int frameCount, unsigned int seed)
+{
+    static const GLuint buffers[] = { 10, 11, 12 };
+    static const UINT   sizes[]   = { 48, 200, 700 };
+    const int BUFFER_COUNT = 3, BIND_POINT_COUNT = 4;
+
+    FakeGLStats stats;
+    FakeGL *pGL = new FakeGL(&stats, true);
+    int writeCount = 0;
+    {
+        CPUTStreamingBufferOGL buffer(pGL, BUFFER_SIZE);
+        std::vector<char> contents[BUFFER_COUNT];
+        int bound[BIND_POINT_COUNT];
+        srand(seed);
+
+        // The first write of a buffer has to cover all of it
+        std::vector<char> data(sizes[0], 1);
+        CHECK(CPUT_ERROR_INVALID_PARAMETER == buffer.SetUniformData(buffers[0], sizes[0], 8, 16, &data[0]));
+        CHECK(!buffer.IsUniformBufferKnown(buffers[0]));
+        for (int ii = 0; ii < BUFFER_COUNT; ii++)
+        {
+            contents[ii].assign(sizes[ii], (char)(1 + ii));
+            CHECK(CPUT_SUCCESS == buffer.SetUniformData(buffers[ii], sizes[ii], 0, sizes[ii], &contents[ii][0]));
+        }
+        for (int ii = 0; ii < BIND_POINT_COUNT; ii++)
+        {
+            bound[ii] = ii % BUFFER_COUNT;
+            buffer.BindUniformBuffer(ii, buffers[bound[ii]]);
+        }
+
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            pGL->NextFrame();
+            buffer.OnFrameStart();
+            for (int ii = 0; ii < BIND_POINT_COUNT; ii++)
+            {
+                pGL->Draw(ii, contents[bound[ii]]);
+            }
+
+            // Now and then nothing is written, and now and then more than the whole ring
+            const int frameWrites = (frame % 50 == 49) ? 40 : rand() % 6;
+            for (int write = 0; write < frameWrites; write++)
+            {
+                const int index = rand() % BUFFER_COUNT;
+                UINT offset = 0, sizeBytes = sizes[index];
+                if (rand() % 2)
+                {
+                    offset = rand() % sizes[index];
+                    sizeBytes = 1 + rand() % (sizes[index] - offset);
+                }
+                memset(&contents[index][offset], 1 + writeCount % 255, sizeBytes);
+                CHECK(CPUT_SUCCESS == buffer.SetUniformData(buffers[index], sizes[index], offset, sizeBytes, &contents[index][offset]));
+                writeCount++;
+
+                if (rand() % 4 == 0)
+                {
+                    const int bindPoint = rand() % BIND_POINT_COUNT;
+                    bound[bindPoint] = rand() % BUFFER_COUNT;
+                    buffer.BindUniformBuffer(bindPoint, buffers[bound[bindPoint]]);
+                }
+                for (int ii = 0; ii < BIND_POINT_COUNT; ii++)
+                {
+                    pGL->Draw(ii, contents[bound[ii]]);
+                }
+            }
+        }
+
+        // Two quiet frames send every block back to its own buffer
+        for (int frame = 0; frame < 2; frame++)
+        {
+            pGL->NextFrame();
+            buffer.OnFrameStart();
+        }
+        for (int ii = 0; ii < BIND_POINT_COUNT; ii++)
+        {
+            pGL->Draw(ii, contents[bound[ii]]);
+        }
+
+        buffer.ForgetUniformBuffer(buffers[0]); // no streaming buffer but this one, does nothing
+        CHECK(buffer.IsUniformBufferKnown(buffers[0]));
+    }
+    CHECK(stats.liveFencesAtExit == 0 && stats.bBufferDeleted);
+    printf("uniform blocks: %d frames, %d writes, %d binds, %d copies back, %d blocking waits\n",
+        frameCount, writeCount, stats.binds, stats.copies, stats.blockingWaits);
+}
+
+// Without persistent mapping each allocation is mapped on its own and a wrap orphans
+//-----------------------------------------------------------------------------
+static void TestOrphaning(bool bMappingFails)
+{
+    FakeGLStats stats;
+    FakeGL *pGL = new FakeGL(&stats, bMappingFails, bMappingFails);
+    {
+        CPUTStreamingBufferOGL buffer(pGL, 1000);
+        CHECK(!buffer.IsPersistent());
+        for (int ii = 0; ii < 100; ii++)
+        {
+            Write(buffer, pGL, 300, 16, (char)(1 + ii));
+            buffer.OnFrameStart();
+        }
+    }
+    // 0, 304 and 608 fit, 912 doesn't
+    CHECK(stats.orphans == 33);
+    CHECK(stats.maps == 100 && stats.unmaps == 100 && stats.fences == 0);
+    CHECK(stats.bBufferDeleted);
+    printf("orphaning%s: %d orphans, %d maps\n", bMappingFails ? " (persistent mapping failed)" : "", stats.orphans, stats.maps);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int frameCount = 2000;
+    unsigned int seed = 1;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (0 == strcmp(argv[ii], "-frames") && ii + 1 < argc)
+        {
+            frameCount = atoi(argv[++ii]);
+        }
+        else if (0 == strcmp(argv[ii], "-seed") && ii + 1 < argc)
+        {
+            seed = (unsigned int)strtoul(argv[++ii], NULL, 10);
+        }
+        else
+        {
+            printf("usage: StreamingBufferTest [-frames <count>] [-seed <number>]\n");
+            return 1;
+        }
+    }
+
+    TestPersistent(frameCount, seed);
+    TestFrameBiggerThanBuffer();
+    TestUpload();
+    TestUniformBuffers(frameCount, seed);
+    TestOrphaning(false);
+    TestOrphaning(true);
+
+    if (gFailures)
+    {
+        printf("%d checks failed\n", gFailures);
+    }
+    else
+    {
+        printf("all checks passed\n");
+    }
+    return gFailures;
+}
@@ -0,0 +1,178 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// TextureCook: writes the cooked .dds for source images so CPUT loads them without decoding
+// or generating mips at startup. See CPUT/include/CPUTTextureCooker.h for the format.
+//
+//   TextureCook [-srgb] [-bc1 | -bc3] [-force] <file or directory> ...
+//
+// Directories are searched recursively for .png/.jpg/.tga/.bmp. Up to date cooked files are
+// skipped unless -force is given. TextureCook.vcxproj builds it with CPUTTextureCooker.cpp,
+// CPUTOSServicesWin.cpp and stb_image.c, plus CPUT_TEXTURE_COOKER_DIRECTXTEX and the DirectXTex
+// library for -bc1/-bc3. Elsewhere leave those two out and use CPUTOSServices for the platform.
+
+#include "CPUTTextureCooker.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#ifdef CPUT_OS_WINDOWS
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+struct CookOptions
+{
+    bool                     sRGB;
+    bool                     force;
+    CPUT_TEXTURE_COOK_FORMAT format;
+};
+
+//-----------------------------------------------------------------------------
+static void FindSourceImages(const std::string &path, std::vector<std::string> *pFiles)
+{
+#ifdef CPUT_OS_WINDOWS
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        pFiles->push_back(path);
+        return;
+    }
+    WIN32_FIND_DATAA findData;
+    HANDLE hFind = FindFirstFileA((path + "\\*").c_str(), &findData);
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    do
+    {
+        std::string name = findData.cFileName;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string child = path + "\\" + name;
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            FindSourceImages(child, pFiles);
+        }
+        else if (CPUTTextureCooker::IsCookableFile(child))
+        {
+            pFiles->push_back(child);
+        }
+    } while (FindNextFileA(hFind, &findData));
+    FindClose(hFind);
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode))
+    {
+        pFiles->push_back(path);
+        return;
+    }
+    DIR *pDir = opendir(path.c_str());
+    if (!pDir)
+    {
+        return;
+    }
+    while (struct dirent *pEntry = readdir(pDir))
+    {
+        std::string name = pEntry->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string child = path + "/" + name;
+        if (stat(child.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+        {
+            FindSourceImages(child, pFiles);
+        }
+        else if (CPUTTextureCooker::IsCookableFile(child))
+        {
+            pFiles->push_back(child);
+        }
+    }
+    closedir(pDir);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("usage: TextureCook [-srgb] [-bc1 | -bc3] [-force] <file or directory> ...\n");
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    CookOptions options;
+    options.sRGB   = false;
+    options.force  = false;
+    options.format = CPUT_COOK_RGBA8;
+
+    std::vector<std::string> files;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-srgb"))       { options.sRGB = true; }
+        else if (!strcmp(argv[ii], "-force")) { options.force = true; }
+        else if (!strcmp(argv[ii], "-bc1"))   { options.format = CPUT_COOK_BC1; }
+        else if (!strcmp(argv[ii], "-bc3"))   { options.format = CPUT_COOK_BC3; }
+        else if (argv[ii][0] == '-')
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            FindSourceImages(argv[ii], &files);
+        }
+    }
+    if (files.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+#ifndef CPUT_TEXTURE_COOKER_DIRECTXTEX
+    if (options.format != CPUT_COOK_RGBA8)
+    {
+        printf("built without DirectXTex, writing RGBA8\n");
+    }
+#endif
+
+    int cooked = 0, skipped = 0, failed = 0;
+    for (size_t ii = 0; ii < files.size(); ii++)
+    {
+        const std::string cookedFileName = CPUTTextureCooker::GetCookedFileName(files[ii]);
+        if (!options.force && CPUTTextureCooker::IsCookedFileUpToDate(files[ii], cookedFileName, options.sRGB))
+        {
+            skipped++;
+            continue;
+        }
+        if (CPUTSUCCESS(CPUTTextureCooker::Cook(files[ii], cookedFileName, options.sRGB, options.format)))
+        {
+            printf("%s -> %s\n", files[ii].c_str(), cookedFileName.c_str());
+            cooked++;
+        }
+        else
+        {
+            printf("%s: failed\n", files[ii].c_str());
+            failed++;
+        }
+    }
+    printf("%d cooked, %d up to date, %d failed\n", cooked, skipped, failed);
+    return failed ? 1 : 0;
+}
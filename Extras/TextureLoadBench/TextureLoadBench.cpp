@@ -0,0 +1,356 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// TextureLoadBench: times the CPU side of loading a scene's textures from their source images
+// against loading the cooked .dds files next to them (CPUT/include/CPUTTextureCooker.h).
+//
+//   TextureLoadBench [-runs <count>] [-srgb] [<file or directory> ...]
+//
+// Directories are searched recursively (default: Media) for source images the cooker takes
+// (.png, .jpg, .jpeg, .tga, .bmp). A source without an up to date cooked file is cooked first
+// (RGBA8, like TextureCook without DirectXTex), so this writes <source>.cooked.dds next to
+// those. Each run loads every texture once per method:
+// - decode   the source mapped and decoded with stb_image, what LoadTexturePNG does on OGL
+//            before glGenerateMipmap
+// - cook     CPUTTextureCooker::CookToMemory, decode plus the mip chain on the CPU, what the
+//            DX11 loader does when the cooked file is stale or missing
+// - cooked   IsCookedFileUpToDate, then the cooked file mapped with CPUTFileView and every
+//            byte read the way an upload would, what both loaders do normally
+// The report has the time per run (best and median of the runs, default 10) and how much
+// faster cooked is. The GPU upload itself isn't included; the cooked file uploads the mips
+// that glGenerateMipmap would make. "cook" has to produce the bytes of the cooked file when
+// that was cooked RGBA8 with the same -srgb.
+//
+// The OS has the files cached after the first run, so this compares decoding against reading,
+// not disk speed.
+//
+// TextureLoadBench.vcxproj builds it with CPUTTextureCooker.cpp, stb_image.c and
+// CPUTOSServicesWin.cpp; no graphics API is needed.
+
+#include "CPUTTextureCooker.h"
+#include "CPUTOSServices.h"
+#include "../../CPUT/middleware/stb/stb_image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifdef CPUT_OS_WINDOWS
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+enum LoadMethod { METHOD_DECODE, METHOD_COOK, METHOD_COOKED, METHOD_COUNT };
+static const char *gMethodNames[METHOD_COUNT] = { "decode", "cook", "cooked" };
+
+//-----------------------------------------------------------------------------
+static void FindFiles(const std::string &path, std::vector<std::string> *pFiles)
+{
+#ifdef CPUT_OS_WINDOWS
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES)
+    {
+        return;
+    }
+    if (!(attributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        pFiles->push_back(path);
+        return;
+    }
+    WIN32_FIND_DATAA findData;
+    HANDLE hFind = FindFirstFileA((path + "\\*").c_str(), &findData);
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    do
+    {
+        std::string name = findData.cFileName;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string child = path + "\\" + name;
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            FindFiles(child, pFiles);
+        }
+        else if (CPUTTextureCooker::IsCookableFile(child))
+        {
+            pFiles->push_back(child);
+        }
+    } while (FindNextFileA(hFind, &findData));
+    FindClose(hFind);
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+    {
+        return;
+    }
+    if (!S_ISDIR(info.st_mode))
+    {
+        pFiles->push_back(path);
+        return;
+    }
+    DIR *pDir = opendir(path.c_str());
+    if (!pDir)
+    {
+        return;
+    }
+    while (struct dirent *pEntry = readdir(pDir))
+    {
+        std::string name = pEntry->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string child = path + "/" + name;
+        if (stat(child.c_str(), &info) != 0)
+        {
+            continue;
+        }
+        if (S_ISDIR(info.st_mode))
+        {
+            FindFiles(child, pFiles);
+        }
+        else if (CPUTTextureCooker::IsCookableFile(child))
+        {
+            pFiles->push_back(child);
+        }
+    }
+    closedir(pDir);
+#endif
+}
+
+// What an upload reads: every byte, a word at a time
+//-----------------------------------------------------------------------------
+static uint64_t SumBytes(const char *pData, uint64_t size)
+{
+    uint64_t sum = 0;
+    uint64_t ii = 0;
+    for (; ii + sizeof(uint64_t) <= size; ii += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, pData + ii, sizeof(word));
+        sum += word;
+    }
+    for (; ii < size; ii++)
+    {
+        sum += (unsigned char)pData[ii];
+    }
+    return sum;
+}
+
+// Loads the texture, returns the sum and size of what would be uploaded
+//-----------------------------------------------------------------------------
+static bool Load(const std::string &fileName, LoadMethod method, bool sRGB, uint64_t *pSum, uint64_t *pSize)
+{
+    switch (method)
+    {
+    case METHOD_DECODE:
+    {
+        CPUTFileSystem::CPUTFileView view;
+        if (CPUTFAILED(view.Open(fileName)))
+        {
+            return false;
+        }
+        int width, height, numComponents;
+        unsigned char *pPixels = stbi_load_from_memory((const unsigned char *)view.GetData(), (int)view.GetSize(), &width, &height, &numComponents, 4);
+        if (!pPixels)
+        {
+            return false;
+        }
+        *pSize = (uint64_t)width * height * 4;
+        *pSum = SumBytes((const char *)pPixels, *pSize);
+        stbi_image_free(pPixels);
+        return true;
+    }
+    case METHOD_COOK:
+    {
+        std::vector<char> cooked;
+        if (CPUTFAILED(CPUTTextureCooker::CookToMemory(fileName, sRGB, CPUT_COOK_RGBA8, &cooked)))
+        {
+            return false;
+        }
+        *pSize = cooked.size();
+        *pSum = SumBytes(&cooked[0], cooked.size());
+        return true;
+    }
+    default:
+    {
+        const std::string cookedFileName = CPUTTextureCooker::GetCookedFileName(fileName);
+        if (!CPUTTextureCooker::IsCookedFileUpToDate(fileName, cookedFileName, sRGB))
+        {
+            return false;
+        }
+        CPUTFileSystem::CPUTFileView view;
+        if (CPUTFAILED(view.Open(cookedFileName)))
+        {
+            return false;
+        }
+        *pSize = view.GetSize();
+        *pSum = SumBytes(view.GetData(), view.GetSize());
+        return true;
+    }
+    }
+}
+
+// Whether the cook makes the texels of the cooked file. The headers can differ in the source
+// time, when the source was touched but not changed. A file cooked some other way (BC) passes.
+//-----------------------------------------------------------------------------
+static bool SameTexels(const std::string &fileName, bool sRGB)
+{
+    const size_t headerSize = 128; // "DDS " and the DDS_HEADER
+    std::vector<char> cooked;
+    CPUTFileSystem::CPUTFileView view;
+    if (CPUTFAILED(CPUTTextureCooker::CookToMemory(fileName, sRGB, CPUT_COOK_RGBA8, &cooked)) ||
+        CPUTFAILED(view.Open(CPUTTextureCooker::GetCookedFileName(fileName))))
+    {
+        return false;
+    }
+    if (view.GetSize() != cooked.size() || cooked.size() <= headerSize)
+    {
+        return true;
+    }
+    return 0 == memcmp(&cooked[headerSize], view.GetData() + headerSize, cooked.size() - headerSize);
+}
+
+//-----------------------------------------------------------------------------
+static double NowSeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("usage: TextureLoadBench [-runs <count>] [-srgb] [<file or directory> ...]\n");
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int runCount = 10;
+    bool sRGB = false;
+    std::vector<std::string> paths;
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-runs") && ii + 1 < argc)
+        {
+            runCount = std::max(atoi(argv[++ii]), 1);
+        }
+        else if (!strcmp(argv[ii], "-srgb"))
+        {
+            sRGB = true;
+        }
+        else if (argv[ii][0] == '-')
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            paths.push_back(argv[ii]);
+        }
+    }
+    if (paths.empty())
+    {
+        paths.push_back("Media");
+    }
+
+    std::vector<std::string> files;
+    for (size_t ii = 0; ii < paths.size(); ii++)
+    {
+        FindFiles(paths[ii], &files);
+    }
+    if (files.empty())
+    {
+        printf("no source images (.png, .jpg, .jpeg, .tga, .bmp) found\n");
+        return 1;
+    }
+
+    UINT cookCount = 0;
+    uint64_t sourceBytes = 0;
+    for (size_t ii = 0; ii < files.size(); ii++)
+    {
+        const std::string cookedFileName = CPUTTextureCooker::GetCookedFileName(files[ii]);
+        if (!CPUTTextureCooker::IsCookedFileUpToDate(files[ii], cookedFileName, sRGB))
+        {
+            if (CPUTFAILED(CPUTTextureCooker::Cook(files[ii], cookedFileName, sRGB, CPUT_COOK_RGBA8)))
+            {
+                printf("FAILED: can't cook %s\n", files[ii].c_str());
+                return 1;
+            }
+            cookCount++;
+        }
+        uint64_t size, time;
+        if (CPUTFAILED(CPUTFileSystem::GetFileInfo(files[ii], &size, &time)))
+        {
+            printf("FAILED: can't read %s\n", files[ii].c_str());
+            return 1;
+        }
+        sourceBytes += size;
+    }
+
+    std::vector<double> seconds[METHOD_COUNT];
+    uint64_t bytes[METHOD_COUNT] = { 0, 0, 0 };
+    for (int run = 0; run < runCount; run++)
+    {
+        for (int method = 0; method < METHOD_COUNT; method++)
+        {
+            double elapsed = 0.0;
+            for (size_t ii = 0; ii < files.size(); ii++)
+            {
+                uint64_t sum = 0, size = 0;
+                const double start = NowSeconds();
+                if (!Load(files[ii], (LoadMethod)method, sRGB, &sum, &size))
+                {
+                    printf("FAILED: %s: %s can't load it\n", files[ii].c_str(), gMethodNames[method]);
+                    return 1;
+                }
+                elapsed += NowSeconds() - start;
+                bytes[method] += (run == 0) ? size : 0;
+
+                if (method == METHOD_COOKED && run == 0 && !SameTexels(files[ii], sRGB))
+                {
+                    printf("FAILED: %s: the cooked file differs from what cook makes\n", files[ii].c_str());
+                    return 1;
+                }
+            }
+            seconds[method].push_back(elapsed);
+        }
+    }
+
+    printf("%u source images (%.1f MB), %u cooked first, %s\n", (UINT)files.size(), sourceBytes / (1024.0 * 1024.0), cookCount, sRGB ? "sRGB" : "linear");
+    printf("%-8s %12s %12s %12s %12s\n", "", "output MB", "best ms", "median ms", "vs cooked");
+    std::sort(seconds[METHOD_COOKED].begin(), seconds[METHOD_COOKED].end());
+    const double cookedMedian = seconds[METHOD_COOKED][seconds[METHOD_COOKED].size() / 2];
+    for (int method = 0; method < METHOD_COUNT; method++)
+    {
+        std::vector<double> &times = seconds[method];
+        std::sort(times.begin(), times.end());
+        const double median = times[times.size() / 2];
+        printf("%-8s %12.1f %12.2f %12.2f %11.1fx\n", gMethodNames[method], bytes[method] / (1024.0 * 1024.0),
+            times[0] * 1000.0, median * 1000.0, median / cookedMedian);
+    }
+    return 0;
+}
@@ -0,0 +1,256 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or imlied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// TraceBench: times each kind of VideoStreaming/Trace.h event and TraceWriteChromeJSON(), and
+// checks what the export holds while another thread keeps tracing.
+//
+//   TraceBench [-count <events>] [-out <file>]
+//
+// Each of these runs -count times (default 2000000) in a loop, best of 3 rounds, and the
+// nanoseconds per event are printed:
+// - scope         TRACE_SCOPE, two clock reads and one event
+// - scope arg     TRACE_SCOPE_ARG with an integer argument
+// - counter       TRACE_COUNTER
+// - flow          TRACE_FLOW_BEGIN
+// - disabled      TRACE_SCOPE after TraceSetEnabled(false)
+// - clock         TraceNow() alone
+// - empty         the loop without any of it
+// Then a thread named Worker "2" records a TRACE_SCOPE_ARG per iteration, with the iteration as
+// the argument, while this one exports to -out (default TraceBench.json) five times, and once
+// more after the worker is done. Every export has to be one event per line with the worker's
+// name escaped, its events have to be consecutive iterations (a snapshot may only drop the oldest
+// ones it raced with) and no more than a ring holds, and the last one has to end with the last
+// iteration and hold a ring's worth less one: a full ring's snapshot always leaves out the slot its
+// thread could be writing.
+//
+// TraceBench.vcxproj builds it with Trace.cpp from VideoStreaming.
+
+#include "Trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+
+static const char *WORKER_NAME = "Worker \"2\"";
+static const char *WORKER_NAME_JSON = "\"Worker \\\"2\\\"\"";
+
+static volatile int sSink;
+
+static double Seconds()
+{
+    return (double)TraceNow() / (double)TraceTicksPerSecond();
+}
+
+//-----------------------------------------------------------------------------
+// Runs body count times, 3 rounds, and returns the best nanoseconds per call
+template <class Body>
+static double Time(int count, Body body)
+{
+    double best = 1e30;
+    for (int round = 0; round < 3; round++)
+    {
+        const double start = Seconds();
+        for (int ii = 0; ii < count; ii++)
+        {
+            body(ii);
+        }
+        const double ns = (Seconds() - start) / count * 1e9;
+        best = ns < best ? ns : best;
+    }
+    return best;
+}
+
+// What an export held for the worker thread
+struct WorkerEvents
+{
+    bool      mbOk;
+    int       mCount;
+    long long mFirst;
+    long long mLast;
+};
+
+//-----------------------------------------------------------------------------
+static WorkerEvents CheckExport(const char *pFileName)
+{
+    WorkerEvents result = { false, 0, -1, -1 };
+    FILE *pFile = fopen(pFileName, "r");
+    if (!pFile)
+    {
+        printf("%s: can't open\n", pFileName);
+        return result;
+    }
+
+    // Lines are short; a longer one would be split and fail the checks below
+    char line[1024];
+    int lineNumber = 0;
+    int workerTid = -1;
+    bool bBadLine = false;
+    bool bGap = false;
+    while (fgets(line, sizeof(line), pFile))
+    {
+        lineNumber++;
+        if (lineNumber == 1)
+        {
+            bBadLine = strncmp(line, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 39) != 0;
+            continue;
+        }
+        if (!strcmp(line, "]}\n"))
+        {
+            continue;
+        }
+        if (strncmp(line, "{", 1) || !strstr(line, "}"))
+        {
+            printf("%s:%d: not an event\n", pFileName, lineNumber);
+            bBadLine = true;
+            continue;
+        }
+        const char *pTid = strstr(line, "\"tid\":");
+        const int tid = pTid ? atoi(pTid + 6) : -1;
+        if (strstr(line, "\"thread_name\""))
+        {
+            if (strstr(line, WORKER_NAME_JSON))
+            {
+                workerTid = tid;
+            }
+            continue;
+        }
+        if (tid != workerTid)
+        {
+            continue;
+        }
+        const char *pArg = strstr(line, "\"args\":{\"i\":");
+        if (!pArg || !strstr(line, "\"ph\":\"X\""))
+        {
+            printf("%s:%d: not a Worker scope\n", pFileName, lineNumber);
+            bBadLine = true;
+            continue;
+        }
+        const long long value = atoll(pArg + 12);
+        if (result.mCount && value != result.mLast + 1)
+        {
+            bGap = true;
+        }
+        if (!result.mCount)
+        {
+            result.mFirst = value;
+        }
+        result.mLast = value;
+        result.mCount++;
+    }
+    fclose(pFile);
+
+    if (workerTid < 0)
+    {
+        printf("%s: no thread named %s\n", pFileName, WORKER_NAME_JSON);
+    }
+    if (bGap)
+    {
+        printf("%s: the worker's iterations aren't consecutive\n", pFileName);
+    }
+    if (result.mCount > (int)TraceThreadBuffer::cCapacity)
+    {
+        printf("%s: %d worker events, a ring holds %u\n", pFileName, result.mCount, TraceThreadBuffer::cCapacity);
+    }
+    result.mbOk = !bBadLine && workerTid >= 0 && !bGap && result.mCount <= (int)TraceThreadBuffer::cCapacity;
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int count = 2000000;
+    const char *pFileName = "TraceBench.json";
+    for (int ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-count") && ii + 1 < argc && atoi(argv[ii + 1]) > 0)
+        {
+            count = atoi(argv[++ii]);
+        }
+        else if (!strcmp(argv[ii], "-out") && ii + 1 < argc)
+        {
+            pFileName = argv[++ii];
+        }
+        else
+        {
+            fprintf(stderr, "usage: TraceBench [-count <events>] [-out <file>]\n");
+            return 1;
+        }
+    }
+
+    // Registers this thread's ring, so the first loop doesn't pay for it
+    TraceSetThreadName("Main");
+
+    printf("%-12s %8s\n", "", "ns");
+    printf("%-12s %8.1f\n", "scope", Time(count, [](int) { TRACE_SCOPE("Bench"); }));
+    printf("%-12s %8.1f\n", "scope arg", Time(count, [](int ii) { TRACE_SCOPE_ARG("Bench", "i", ii); }));
+    printf("%-12s %8.1f\n", "counter", Time(count, [](int ii) { TRACE_COUNTER("Counter", ii); }));
+    printf("%-12s %8.1f\n", "flow", Time(count, [](int ii) { TRACE_FLOW_BEGIN("Flow", ii); }));
+    TraceSetEnabled(false);
+    printf("%-12s %8.1f\n", "disabled", Time(count, [](int) { TRACE_SCOPE("Bench"); }));
+    TraceSetEnabled(true);
+    printf("%-12s %8.1f\n", "clock", Time(count, [](int) { sSink = (int)TraceNow(); }));
+    printf("%-12s %8.1f\n", "empty", Time(count, [](int ii) { sSink = ii; }));
+
+    const int workerCount = count * 2;
+    std::atomic<bool> workerNamed(false);
+    std::thread worker([workerCount, &workerNamed]()
+    {
+        TraceSetThreadName(WORKER_NAME);
+        workerNamed = true;
+        for (int ii = 0; ii < workerCount; ii++)
+        {
+            TRACE_SCOPE_ARG("Worker", "i", ii);
+        }
+    });
+
+    while (!workerNamed)
+    {
+        std::this_thread::yield();
+    }
+
+    bool ok = true;
+    const int lastCount = (int)TraceThreadBuffer::cCapacity - 1;
+    for (int exportIndex = 0; exportIndex <= 5; exportIndex++)
+    {
+        if (exportIndex == 5)
+        {
+            worker.join();
+        }
+        const double start = Seconds();
+        if (!TraceWriteChromeJSON(pFileName))
+        {
+            printf("%s: can't write\n", pFileName);
+            return 1;
+        }
+        const double ms = (Seconds() - start) * 1000.0;
+        const WorkerEvents events = CheckExport(pFileName);
+        printf("export %d%s: %.1f ms, %d worker events, iterations %lld to %lld\n",
+            exportIndex + 1, exportIndex == 5 ? " (worker done)" : "", ms, events.mCount, events.mFirst, events.mLast);
+        ok = events.mbOk && ok;
+        if (exportIndex == 5 && (events.mCount != lastCount || events.mLast != workerCount - 1))
+        {
+            printf("FAILED: expected the last %d iterations, ending at %d\n", lastCount, workerCount - 1);
+            ok = false;
+        }
+    }
+    if (!ok)
+    {
+        printf("FAILED: see above\n");
+    }
+    return ok ? 0 : 1;
+}
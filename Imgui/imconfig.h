@@ -29,6 +29,12 @@
 //---- Don't define obsolete functions names
 //#define IMGUI_DISABLE_OBSOLETE_FUNCTIONS
 
+//---- Use a hash map instead of a sorted vector in ImGuiStorage: O(1) lookups and inserts for windows with many thousands of IDs
+//#define IMGUI_STORAGE_HASHMAP
+
+//---- Rasterize font glyphs on the calling thread only in ImFontAtlas::Build() (by default it uses a few std::thread). Also define if your IO.MemAllocFn/MemFreeFn aren't thread-safe.
+//#define IMGUI_DISABLE_FONT_BUILD_THREADS
+
 //---- Implement STB libraries in a namespace to avoid conflicts
 //#define IMGUI_STB_NAMESPACE     ImGuiStb
 
@@ -1193,6 +1193,119 @@ void* ImLoadFileToMemory(const char* filename, const char* file_open_mode, int*
 //-----------------------------------------------------------------------------
 
 // Helper: Key->value storage
+#ifdef IMGUI_STORAGE_HASHMAP
+
+// Pairs are appended to Data and found through Index, an open addressing table with linear probing kept at most half full.
+// Pairs are only ever removed all at once by Clear() so there are no tombstones to deal with.
+void ImGuiStorage::Clear()
+{
+    Data.clear();
+    Index.clear();
+}
+
+// IDs are already hashes but user keys might be small consecutive integers, mix them anyway
+static inline int StorageSlot(ImGuiID key, int mask)
+{
+    key ^= key >> 16;
+    key *= 0x45d9f3bu;
+    key ^= key >> 16;
+    return (int)key & mask;
+}
+
+static int StorageFind(const ImGuiStorage& storage, ImGuiID key)
+{
+    if (storage.Index.Size == 0)
+        return -1;
+    const int mask = storage.Index.Size - 1;
+    for (int slot = StorageSlot(key, mask); ; slot = (slot + 1) & mask)
+    {
+        const int pos = storage.Index.Data[slot];
+        if (pos < 0)
+            return -1;
+        if (storage.Data.Data[pos].key == key)
+            return pos;
+    }
+}
+
+static void StorageIndexPair(ImGuiStorage& storage, int pos)
+{
+    const int mask = storage.Index.Size - 1;
+    int slot = StorageSlot(storage.Data.Data[pos].key, mask);
+    while (storage.Index.Data[slot] >= 0)
+        slot = (slot + 1) & mask;
+    storage.Index.Data[slot] = pos;
+}
+
+// Key must not be in the storage yet. Returns the new pair.
+static ImGuiStorage::Pair* StorageInsert(ImGuiStorage& storage, const ImGuiStorage::Pair& pair)
+{
+    if ((storage.Data.Size + 1) * 2 > storage.Index.Size)
+    {
+        storage.Index.resize(storage.Index.Size ? storage.Index.Size * 2 : 16);
+        for (int slot = 0; slot < storage.Index.Size; slot++)
+            storage.Index.Data[slot] = -1;
+        for (int pos = 0; pos < storage.Data.Size; pos++)
+            StorageIndexPair(storage, pos);
+    }
+    storage.Data.push_back(pair);
+    StorageIndexPair(storage, storage.Data.Size - 1);
+    return &storage.Data.back();
+}
+
+int ImGuiStorage::GetInt(ImU32 key, int default_val) const
+{
+    const int pos = StorageFind(*this, key);
+    return pos < 0 ? default_val : Data[pos].val_i;
+}
+
+float ImGuiStorage::GetFloat(ImU32 key, float default_val) const
+{
+    const int pos = StorageFind(*this, key);
+    return pos < 0 ? default_val : Data[pos].val_f;
+}
+
+void* ImGuiStorage::GetVoidPtr(ImGuiID key) const
+{
+    const int pos = StorageFind(*this, key);
+    return pos < 0 ? NULL : Data[pos].val_p;
+}
+
+// References are only valid until a new value is added to the storage. Calling a Set***() function or a Get***Ref() function invalidates the pointer.
+int* ImGuiStorage::GetIntRef(ImGuiID key, int default_val)
+{
+    const int pos = StorageFind(*this, key);
+    return pos < 0 ? &StorageInsert(*this, Pair(key, default_val))->val_i : &Data[pos].val_i;
+}
+
+float* ImGuiStorage::GetFloatRef(ImGuiID key, float default_val)
+{
+    const int pos = StorageFind(*this, key);
+    return pos < 0 ? &StorageInsert(*this, Pair(key, default_val))->val_f : &Data[pos].val_f;
+}
+
+void** ImGuiStorage::GetVoidPtrRef(ImGuiID key, void* default_val)
+{
+    const int pos = StorageFind(*this, key);
+    return pos < 0 ? &StorageInsert(*this, Pair(key, default_val))->val_p : &Data[pos].val_p;
+}
+
+void ImGuiStorage::SetInt(ImU32 key, int val)
+{
+    *GetIntRef(key) = val;
+}
+
+void ImGuiStorage::SetFloat(ImU32 key, float val)
+{
+    *GetFloatRef(key) = val;
+}
+
+void ImGuiStorage::SetVoidPtr(ImU32 key, void* val)
+{
+    *GetVoidPtrRef(key) = val;
+}
+
+#else // #ifdef IMGUI_STORAGE_HASHMAP
+
 void ImGuiStorage::Clear()
 {
     Data.clear();
@@ -1304,6 +1417,8 @@ void ImGuiStorage::SetVoidPtr(ImU32 key, void* val)
     it->val_p = val;
 }
 
+#endif // #ifdef IMGUI_STORAGE_HASHMAP
+
 void ImGuiStorage::SetAllInt(int v)
 {
     for (int i = 0; i < Data.Size; i++)
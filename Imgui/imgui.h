@@ -913,10 +913,14 @@ struct ImGuiStorage
         Pair(ImGuiID _key, void* _val_p) { key = _key; val_p = _val_p; }
     };
     ImVector<Pair>    Data;
+#ifdef IMGUI_STORAGE_HASHMAP
+    ImVector<int>     Index;    // open addressing table of positions in Data, -1 for an empty slot. Data is then in insertion order, not sorted.
+#endif
 
-    // - Get***() functions find pair, never add/allocate. Pairs are sorted so a query is O(log N)
+    // - Get***() functions find pair, never add/allocate. Pairs are sorted so a query is O(log N) (O(1) with IMGUI_STORAGE_HASHMAP)
     // - Set***() functions find pair, insertion on demand if missing.
     // - Sorted insertion is costly but should amortize. A typical frame shouldn't need to insert any new pair.
+    //   Define IMGUI_STORAGE_HASHMAP in imconfig.h if you create thousands of IDs (big trees, long lists of collapsing headers).
     IMGUI_API void    Clear();
     IMGUI_API int     GetInt(ImGuiID key, int default_val = 0) const;
     IMGUI_API void    SetInt(ImGuiID key, int val);
@@ -1240,6 +1244,8 @@ struct ImFontAtlas
     int                         TexDesiredWidth;    // Texture width desired by user before Build(). Must be a power-of-two. If have many glyphs your graphics API have texture size restrictions you may want to increase texture width to decrease height.
     ImVec2                      TexUvWhitePixel;    // Texture coordinates to a white pixel (part of the TexExtraData block)
     ImVector<ImFont*>           Fonts;
+    const char*                 CacheFilename;      // = NULL   // Path to save the packed texture and glyph placement to after Build(). When the fonts, sizes, oversampling and ranges are unchanged, the next Build() loads it instead of rasterizing. NULL to disable.
+    int                         BuildThreadCount;   // = 0      // Threads Build() renders glyphs on, up to 8. 0 for one per core, 1 to render on the calling thread only. Ignored with IMGUI_DISABLE_FONT_BUILD_THREADS.
 
     // Private
     ImVector<ImFontConfig>      ConfigData;         // Internal data
@@ -18,6 +18,10 @@
 
 #include <stdio.h>      // vsnprintf, sscanf, printf
 #include <new>          // new (ptr)
+#ifndef IMGUI_DISABLE_FONT_BUILD_THREADS
+#include <thread>       // std::thread, for ImFontAtlas::Build()
+#include <atomic>
+#endif
 #if !defined(alloca) && !defined(__FreeBSD__)
 #if _WIN32
 #include <malloc.h>     // alloca
@@ -66,8 +70,10 @@ namespace IMGUI_STB_NAMESPACE
 #endif
 #include "stb_rect_pack.h"
 
-#define STBTT_malloc(x,u)  ((void)(u), ImGui::MemAlloc(x))
-#define STBTT_free(x,u)    ((void)(u), ImGui::MemFree(x))
+// stb_truetype allocates from the glyph rendering threads in ImFontAtlas::Build(), so go to the user allocator
+// directly: ImGui::MemAlloc() also updates IO.MetricsAllocs which isn't thread-safe. (Every stbtt allocation is freed by stbtt.)
+#define STBTT_malloc(x,u)  ((void)(u), GImGui->IO.MemAllocFn(x))
+#define STBTT_free(x,u)    ((void)(u), GImGui->IO.MemFreeFn(x))
 #define STBTT_assert(x)    IM_ASSERT(x)
 #ifndef IMGUI_DISABLE_STB_TRUETYPE_IMPLEMENTATION
 #define STBTT_STATIC
@@ -957,6 +963,8 @@ ImFontAtlas::ImFontAtlas()
     TexPixelsRGBA32 = NULL;
     TexWidth = TexHeight = TexDesiredWidth = 0;
     TexUvWhitePixel = ImVec2(0, 0);
+    CacheFilename = NULL;
+    BuildThreadCount = 0;
 }
 
 ImFontAtlas::~ImFontAtlas()
@@ -1162,6 +1170,137 @@ ImFont* ImFontAtlas::AddFontFromMemoryCompressedBase85TTF(const char* compressed
     return font;
 }
 
+// Build() renders glyphs in slices of this many characters, so a single large range (e.g. CJK) is still spread over the threads
+static const int FONT_BUILD_GLYPHS_PER_TASK = 64;
+static const int FONT_BUILD_MAX_THREADS = 8;
+
+struct ImFontBuildRenderTask
+{
+    stbtt_fontinfo*     FontInfo;
+    stbtt_pack_range    Range;          // Slice of one of the font ranges, writing to its part of the packed chars
+    stbrp_rect*         Rects;          // Packed rectangles for the slice, each task only touches the pixels inside its own
+};
+
+static void ImFontAtlasBuildRenderTask(const stbtt_pack_context& spc, ImFontBuildRenderTask& task)
+{
+    stbtt_pack_context task_spc = spc;  // stbtt_PackFontRangesRenderIntoRects() changes the oversampling fields while it runs
+    stbtt_PackFontRangesRenderIntoRects(&task_spc, task.FontInfo, &task.Range, 1, task.Rects);
+}
+
+static void ImFontAtlasBuildRenderTasks(const stbtt_pack_context& spc, ImVector<ImFontBuildRenderTask>& tasks, int thread_count_wanted)
+{
+#ifndef IMGUI_DISABLE_FONT_BUILD_THREADS
+    if (thread_count_wanted <= 0)
+        thread_count_wanted = (int)std::thread::hardware_concurrency();
+    const int thread_count = ImMin(ImClamp(thread_count_wanted, 1, FONT_BUILD_MAX_THREADS), tasks.Size);
+    if (thread_count > 1)
+    {
+        std::atomic<int> next_task(0);
+        auto worker = [&]()
+        {
+            for (int task_n = next_task++; task_n < tasks.Size; task_n = next_task++)
+                ImFontAtlasBuildRenderTask(spc, tasks[task_n]);
+        };
+        std::thread threads[FONT_BUILD_MAX_THREADS];
+        for (int i = 1; i < thread_count; i++)
+            threads[i] = std::thread(worker);
+        worker();
+        for (int i = 1; i < thread_count; i++)
+            threads[i].join();
+        return;
+    }
+#else
+    (void)thread_count_wanted;
+#endif
+    for (int task_n = 0; task_n < tasks.Size; task_n++)
+        ImFontAtlasBuildRenderTask(spc, tasks[task_n]);
+}
+
+// Atlas cache file: header, packed chars for every glyph of every font (in ConfigData order), then the Alpha8 texture before the custom data is rendered into it.
+static const ImU32 FONT_CACHE_MAGIC = 0x43414649;   // "IFAC"
+static const int FONT_CACHE_VERSION = 1;
+
+struct ImFontAtlasCacheHeader
+{
+    ImU32   Magic;
+    int     Version;
+    ImU32   Key;                // ImFontAtlasBuildCacheKey()
+    int     FontDataBytes;      // Total TTF size and glyph count, cheap checks on top of the key
+    int     GlyphCount;
+    int     PackedCharSize;     // sizeof(stbtt_packedchar)
+    int     TexWidth;
+    int     TexHeight;
+    int     ExtraRectX;
+    int     ExtraRectY;
+};
+
+// Everything the packing and rendering depend on. Call after the glyph ranges were defaulted.
+static ImU32 ImFontAtlasBuildCacheKey(const ImFontAtlas* atlas)
+{
+    ImU32 key = ImHash(&FONT_CACHE_VERSION, sizeof(FONT_CACHE_VERSION));
+    key = ImHash(&atlas->TexDesiredWidth, sizeof(atlas->TexDesiredWidth), key);
+    for (int input_i = 0; input_i < atlas->ConfigData.Size; input_i++)
+    {
+        const ImFontConfig& cfg = atlas->ConfigData[input_i];
+        const int params[3] = { cfg.FontNo, cfg.OversampleH, cfg.OversampleV };
+        key = ImHash(cfg.FontData, cfg.FontDataSize, key);
+        key = ImHash(params, sizeof(params), key);
+        key = ImHash(&cfg.SizePixels, sizeof(cfg.SizePixels), key);
+        int ranges_size = 0;
+        while (cfg.GlyphRanges[ranges_size] && cfg.GlyphRanges[ranges_size + 1])
+            ranges_size += 2;
+        key = ImHash(&ranges_size, sizeof(ranges_size), key);
+        if (ranges_size > 0)
+            key = ImHash(cfg.GlyphRanges, ranges_size * (int)sizeof(ImWchar), key);
+    }
+    return key;
+}
+
+static bool ImFontAtlasBuildLoadCache(ImFontAtlas* atlas, const ImFontAtlasCacheHeader& expected, stbtt_packedchar* packedchars, stbrp_rect* extra_rect)
+{
+    int file_size = 0;
+    unsigned char* file_data = (unsigned char*)ImLoadFileToMemory(atlas->CacheFilename, "rb", &file_size);
+    if (!file_data)
+        return false;
+
+    ImFontAtlasCacheHeader header;
+    const int packedchars_size = expected.GlyphCount * (int)sizeof(stbtt_packedchar);
+    bool valid = (size_t)file_size >= sizeof(header);
+    if (valid)
+    {
+        memcpy(&header, file_data, sizeof(header));
+        valid = header.Magic == expected.Magic && header.Version == expected.Version && header.Key == expected.Key &&
+            header.FontDataBytes == expected.FontDataBytes && header.GlyphCount == expected.GlyphCount && header.PackedCharSize == expected.PackedCharSize &&
+            header.TexWidth == expected.TexWidth && header.TexHeight > 0 && header.TexHeight <= 1024*32 &&
+            file_size == (int)sizeof(header) + packedchars_size + header.TexWidth * header.TexHeight;
+    }
+    if (valid)
+    {
+        memcpy(packedchars, file_data + sizeof(header), packedchars_size);
+        atlas->TexHeight = header.TexHeight;
+        atlas->TexPixelsAlpha8 = (unsigned char*)ImGui::MemAlloc(atlas->TexWidth * atlas->TexHeight);
+        memcpy(atlas->TexPixelsAlpha8, file_data + sizeof(header) + packedchars_size, atlas->TexWidth * atlas->TexHeight);
+        extra_rect->x = (stbrp_coord)header.ExtraRectX;
+        extra_rect->y = (stbrp_coord)header.ExtraRectY;
+        extra_rect->was_packed = 1;
+    }
+    ImGui::MemFree(file_data);
+    return valid;
+}
+
+static void ImFontAtlasBuildSaveCache(const ImFontAtlas* atlas, const ImFontAtlasCacheHeader& header, const stbtt_packedchar* packedchars)
+{
+    FILE* f = fopen(atlas->CacheFilename, "wb");
+    if (!f)
+        return;
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    ok = ok && fwrite(packedchars, sizeof(stbtt_packedchar), (size_t)header.GlyphCount, f) == (size_t)header.GlyphCount;
+    ok = ok && fwrite(atlas->TexPixelsAlpha8, 1, (size_t)(header.TexWidth * header.TexHeight), f) == (size_t)(header.TexWidth * header.TexHeight);
+    fclose(f);
+    if (!ok)
+        remove(atlas->CacheFilename);   // Don't leave a truncated file behind, the size check would reject it anyway
+}
+
 bool    ImFontAtlas::Build()
 {
     IM_ASSERT(ConfigData.Size > 0);
@@ -1183,6 +1322,7 @@ bool    ImFontAtlas::Build()
     // Initialize font information early (so we can error without any cleanup) + count glyphs
     int total_glyph_count = 0;
     int total_glyph_range_count = 0;
+    int total_font_data_bytes = 0;
     for (int input_i = 0; input_i < ConfigData.Size; input_i++)
     {
         ImFontConfig& cfg = ConfigData[input_i];
@@ -1193,6 +1333,7 @@ bool    ImFontAtlas::Build()
         IM_ASSERT(font_offset >= 0);
         if (!stbtt_InitFont(&tmp.FontInfo, (unsigned char*)cfg.FontData, font_offset))
             return false;
+        total_font_data_bytes += cfg.FontDataSize;
 
         // Count glyphs
         if (!cfg.GlyphRanges)
@@ -1204,45 +1345,26 @@ bool    ImFontAtlas::Build()
         }
     }
 
-    // Start packing
     TexWidth = (TexDesiredWidth > 0) ? TexDesiredWidth : (total_glyph_count > 2000) ? 2048 : (total_glyph_count > 1000) ? 1024 : 512;  // Width doesn't actually matters much but some API/GPU have texture size limitations, and increasing width can decrease height.
     TexHeight = 0;
-    const int max_tex_height = 1024*32;
-    stbtt_pack_context spc;
-    stbtt_PackBegin(&spc, NULL, TexWidth, max_tex_height, 0, 1, NULL);
-
-    // Pack our extra data rectangles first, so it will be on the upper-left corner of our texture (UV will have small values).
-    ImVector<stbrp_rect> extra_rects;
-    RenderCustomTexData(0, &extra_rects);
-    stbtt_PackSetOversampling(&spc, 1, 1);
-    stbrp_pack_rects((stbrp_context*)spc.pack_info, &extra_rects[0], extra_rects.Size);
-    for (int i = 0; i < extra_rects.Size; i++)
-        if (extra_rects[i].was_packed)
-            TexHeight = ImMax(TexHeight, extra_rects[i].y + extra_rects[i].h);
 
     // Allocate packing character data and flag packed characters buffer as non-packed (x0=y0=x1=y1=0)
     int buf_packedchars_n = 0, buf_rects_n = 0, buf_ranges_n = 0;
     stbtt_packedchar* buf_packedchars = (stbtt_packedchar*)ImGui::MemAlloc(total_glyph_count * sizeof(stbtt_packedchar));
-    stbrp_rect* buf_rects = (stbrp_rect*)ImGui::MemAlloc(total_glyph_count * sizeof(stbrp_rect));
     stbtt_pack_range* buf_ranges = (stbtt_pack_range*)ImGui::MemAlloc(total_glyph_range_count * sizeof(stbtt_pack_range));
     memset(buf_packedchars, 0, total_glyph_count * sizeof(stbtt_packedchar));
-    memset(buf_rects, 0, total_glyph_count * sizeof(stbrp_rect));              // Unnecessary but let's clear this for the sake of sanity.
     memset(buf_ranges, 0, total_glyph_range_count * sizeof(stbtt_pack_range));
 
-    // First font pass: pack all glyphs (no rendering at this point, we are working with rectangles in an infinitely tall texture at this point)
+    // Setup ranges
     for (int input_i = 0; input_i < ConfigData.Size; input_i++)
     {
         ImFontConfig& cfg = ConfigData[input_i];
         ImFontTempBuildData& tmp = tmp_array[input_i];
 
-        // Setup ranges
-        int glyph_count = 0;
         int glyph_ranges_count = 0;
         for (const ImWchar* in_range = cfg.GlyphRanges; in_range[0] && in_range[1]; in_range += 2)
-        {
-            glyph_count += (in_range[1] - in_range[0]) + 1;
             glyph_ranges_count++;
-        }
+        tmp.Rects = NULL;
         tmp.Ranges = buf_ranges + buf_ranges_n;
         tmp.RangesCount = glyph_ranges_count;
         buf_ranges_n += glyph_ranges_count;
@@ -1256,44 +1378,108 @@ bool    ImFontAtlas::Build()
             range.chardata_for_range = buf_packedchars + buf_packedchars_n;
             buf_packedchars_n += range.num_chars;
         }
-
-        // Pack
-        tmp.Rects = buf_rects + buf_rects_n;
-        buf_rects_n += glyph_count;
-        stbtt_PackSetOversampling(&spc, cfg.OversampleH, cfg.OversampleV);
-        int n = stbtt_PackFontRangesGatherRects(&spc, &tmp.FontInfo, tmp.Ranges, tmp.RangesCount, tmp.Rects);
-        stbrp_pack_rects((stbrp_context*)spc.pack_info, tmp.Rects, n);
-
-        // Extend texture height
-        for (int i = 0; i < n; i++)
-            if (tmp.Rects[i].was_packed)
-                TexHeight = ImMax(TexHeight, tmp.Rects[i].y + tmp.Rects[i].h);
     }
-    IM_ASSERT(buf_rects_n == total_glyph_count);
     IM_ASSERT(buf_packedchars_n == total_glyph_count);
     IM_ASSERT(buf_ranges_n == total_glyph_range_count);
 
-    // Create texture
-    TexHeight = ImUpperPowerOfTwo(TexHeight);
-    TexPixelsAlpha8 = (unsigned char*)ImGui::MemAlloc(TexWidth * TexHeight);
-    memset(TexPixelsAlpha8, 0, TexWidth * TexHeight);
-    spc.pixels = TexPixelsAlpha8;
-    spc.height = TexHeight;
+    // Our extra data rectangles are packed first, so it will be on the upper-left corner of our texture (UV will have small values).
+    ImVector<stbrp_rect> extra_rects;
+    RenderCustomTexData(0, &extra_rects);
 
-    // Second pass: render characters
-    for (int input_i = 0; input_i < ConfigData.Size; input_i++)
+    // Same fonts, sizes and ranges as a previous run: take the packed chars and pixels from the cache and skip straight to the third pass
+    ImFontAtlasCacheHeader cache_header;
+    memset(&cache_header, 0, sizeof(cache_header));
+    cache_header.Magic = FONT_CACHE_MAGIC;
+    cache_header.Version = FONT_CACHE_VERSION;
+    cache_header.FontDataBytes = total_font_data_bytes;
+    cache_header.GlyphCount = total_glyph_count;
+    cache_header.PackedCharSize = (int)sizeof(stbtt_packedchar);
+    cache_header.TexWidth = TexWidth;
+    bool loaded_from_cache = false;
+    if (CacheFilename)
     {
-        ImFontConfig& cfg = ConfigData[input_i];
-        ImFontTempBuildData& tmp = tmp_array[input_i];
-        stbtt_PackSetOversampling(&spc, cfg.OversampleH, cfg.OversampleV);
-        stbtt_PackFontRangesRenderIntoRects(&spc, &tmp.FontInfo, tmp.Ranges, tmp.RangesCount, tmp.Rects);
-        tmp.Rects = NULL;
+        cache_header.Key = ImFontAtlasBuildCacheKey(this);
+        loaded_from_cache = ImFontAtlasBuildLoadCache(this, cache_header, buf_packedchars, &extra_rects[0]);
     }
 
-    // End packing
-    stbtt_PackEnd(&spc);
-    ImGui::MemFree(buf_rects);
-    buf_rects = NULL;
+    if (!loaded_from_cache)
+    {
+        // Start packing
+        const int max_tex_height = 1024*32;
+        stbtt_pack_context spc;
+        stbtt_PackBegin(&spc, NULL, TexWidth, max_tex_height, 0, 1, NULL);
+
+        stbtt_PackSetOversampling(&spc, 1, 1);
+        stbrp_pack_rects((stbrp_context*)spc.pack_info, &extra_rects[0], extra_rects.Size);
+        for (int i = 0; i < extra_rects.Size; i++)
+            if (extra_rects[i].was_packed)
+                TexHeight = ImMax(TexHeight, extra_rects[i].y + extra_rects[i].h);
+
+        stbrp_rect* buf_rects = (stbrp_rect*)ImGui::MemAlloc(total_glyph_count * sizeof(stbrp_rect));
+        memset(buf_rects, 0, total_glyph_count * sizeof(stbrp_rect));              // Unnecessary but let's clear this for the sake of sanity.
+
+        // First font pass: pack all glyphs (no rendering at this point, we are working with rectangles in an infinitely tall texture at this point)
+        for (int input_i = 0; input_i < ConfigData.Size; input_i++)
+        {
+            ImFontConfig& cfg = ConfigData[input_i];
+            ImFontTempBuildData& tmp = tmp_array[input_i];
+
+            tmp.Rects = buf_rects + buf_rects_n;
+            stbtt_PackSetOversampling(&spc, cfg.OversampleH, cfg.OversampleV);
+            int n = stbtt_PackFontRangesGatherRects(&spc, &tmp.FontInfo, tmp.Ranges, tmp.RangesCount, tmp.Rects);
+            stbrp_pack_rects((stbrp_context*)spc.pack_info, tmp.Rects, n);
+            buf_rects_n += n;
+
+            // Extend texture height
+            for (int i = 0; i < n; i++)
+                if (tmp.Rects[i].was_packed)
+                    TexHeight = ImMax(TexHeight, tmp.Rects[i].y + tmp.Rects[i].h);
+        }
+        IM_ASSERT(buf_rects_n == total_glyph_count);
+
+        // Create texture
+        TexHeight = ImUpperPowerOfTwo(TexHeight);
+        TexPixelsAlpha8 = (unsigned char*)ImGui::MemAlloc(TexWidth * TexHeight);
+        memset(TexPixelsAlpha8, 0, TexWidth * TexHeight);
+        spc.pixels = TexPixelsAlpha8;
+        spc.height = TexHeight;
+
+        // Second pass: render characters. Every glyph has its own rectangle and packed char, so slices of the ranges can be rendered in parallel.
+        ImVector<ImFontBuildRenderTask> tasks;
+        for (int input_i = 0; input_i < ConfigData.Size; input_i++)
+        {
+            ImFontTempBuildData& tmp = tmp_array[input_i];
+            for (int i = 0, rect_n = 0; i < tmp.RangesCount; rect_n += tmp.Ranges[i].num_chars, i++)
+            {
+                for (int char_idx = 0; char_idx < tmp.Ranges[i].num_chars; char_idx += FONT_BUILD_GLYPHS_PER_TASK)
+                {
+                    ImFontBuildRenderTask task;
+                    task.FontInfo = &tmp.FontInfo;
+                    task.Range = tmp.Ranges[i];
+                    task.Range.first_unicode_codepoint_in_range += char_idx;
+                    task.Range.num_chars = ImMin(tmp.Ranges[i].num_chars - char_idx, FONT_BUILD_GLYPHS_PER_TASK);
+                    task.Range.chardata_for_range += char_idx;
+                    task.Rects = tmp.Rects + rect_n + char_idx;
+                    tasks.push_back(task);
+                }
+            }
+            tmp.Rects = NULL;
+        }
+        ImFontAtlasBuildRenderTasks(spc, tasks, BuildThreadCount);
+
+        // End packing
+        stbtt_PackEnd(&spc);
+        ImGui::MemFree(buf_rects);
+        buf_rects = NULL;
+
+        if (CacheFilename)
+        {
+            cache_header.TexHeight = TexHeight;
+            cache_header.ExtraRectX = extra_rects[0].x;
+            cache_header.ExtraRectY = extra_rects[0].y;
+            ImFontAtlasBuildSaveCache(this, cache_header, buf_packedchars);
+        }
+    }
 
     // Third pass: setup ImFont and glyphs for runtime
     for (int input_i = 0; input_i < ConfigData.Size; input_i++)
@@ -0,0 +1,204 @@
+// ImGui renderer-agnostic vertex/index upload
+// See imgui_impl_upload.h
+
+#include "imgui_impl_upload.h"
+#include <string.h>
+
+// Initial sizes, in elements. After that the buffers grow to at least twice the largest frame seen.
+static const int    MIN_VTX_CAPACITY = 5000;
+static const int    MIN_IDX_CAPACITY = 10000;
+
+// Lists not seen for this many frames are forgotten. Their bytes stay in use until the next discard.
+static const int    RESIDENT_LIST_MAX_AGE = 120;
+
+// 64-bit multiply/xorshift hash, a word at a time. It only has to tell a list apart from its
+// previous contents, so the counts are folded in by the caller rather than hashed as data.
+static unsigned long long HashBytes(const void* data, size_t size, unsigned long long h)
+{
+    const unsigned long long m = 0xc6a4a7935bd1e995ULL;
+    const unsigned char* p = (const unsigned char*)data;
+    for (; size >= 8; p += 8, size -= 8)
+    {
+        unsigned long long w;
+        memcpy(&w, p, 8);
+        w *= m; w ^= w >> 47; w *= m;
+        h ^= w; h *= m;
+    }
+    if (size > 0)
+    {
+        unsigned long long w = 0;
+        memcpy(&w, p, size);
+        h ^= w; h *= m;
+    }
+    h ^= h >> 47; h *= m; h ^= h >> 47;
+    return h;
+}
+
+static unsigned long long HashDrawList(const ImDrawList* cmd_list)
+{
+    unsigned long long h = ((unsigned long long)cmd_list->VtxBuffer.size() << 32) ^ (unsigned long long)cmd_list->IdxBuffer.size();
+    h = HashBytes(cmd_list->VtxBuffer.Data, (size_t)cmd_list->VtxBuffer.size() * sizeof(ImDrawVert), h);
+    h = HashBytes(cmd_list->IdxBuffer.Data, (size_t)cmd_list->IdxBuffer.size() * sizeof(ImDrawIdx), h);
+    return h;
+}
+
+static int GrowCapacity(int capacity, int required, int minimum)
+{
+    int new_capacity = capacity > minimum ? capacity : minimum;
+    while (new_capacity < required * 2)
+        new_capacity *= 2;
+    return new_capacity;
+}
+
+ImGui_ImplUploader::ImGui_ImplUploader()
+{
+    VtxCapacity = IdxCapacity = 0;
+    VtxHead = IdxHead = 0;
+    Frame = 0;
+    memset(&Stats, 0, sizeof(Stats));
+}
+
+void ImGui_ImplUploader::Invalidate()
+{
+    Resident.resize(0);
+    VtxCapacity = IdxCapacity = 0;
+    VtxHead = IdxHead = 0;
+}
+
+ImGui_ImplUploader::ResidentList* ImGui_ImplUploader::FindResident(unsigned long long hash, int vtx_count, int idx_count)
+{
+    for (int i = 0; i < Resident.Size; i++)
+        if (Resident[i].Hash == hash && Resident[i].VtxCount == vtx_count && Resident[i].IdxCount == idx_count)
+            return &Resident[i];
+    return NULL;
+}
+
+bool ImGui_ImplUploader::Upload(ImGui_ImplUploadBuffers* buffers, ImDrawData* draw_data)
+{
+    memset(&Stats, 0, sizeof(Stats));
+    Frame++;
+
+    const int list_count = draw_data->CmdListsCount;
+    Placements.resize(list_count);
+    Hashes.resize(list_count);
+
+    // Find the lists that are still in the buffers from an earlier frame
+    int new_vtx = 0, new_idx = 0, new_lists = 0;
+    for (int n = 0; n < list_count; n++)
+    {
+        const ImDrawList* cmd_list = draw_data->CmdLists[n];
+        Hashes[n] = HashDrawList(cmd_list);
+        Stats.BytesHashed += cmd_list->VtxBuffer.size() * sizeof(ImDrawVert) + cmd_list->IdxBuffer.size() * sizeof(ImDrawIdx);
+        if (ResidentList* resident = FindResident(Hashes[n], cmd_list->VtxBuffer.size(), cmd_list->IdxBuffer.size()))
+        {
+            Placements[n].VtxOffset = resident->VtxOffset;
+            Placements[n].IdxOffset = resident->IdxOffset;
+            resident->LastUsedFrame = Frame;
+        }
+        else
+        {
+            Placements[n].VtxOffset = Placements[n].IdxOffset = -1;
+            new_vtx += cmd_list->VtxBuffer.size();
+            new_idx += cmd_list->IdxBuffer.size();
+            new_lists++;
+        }
+    }
+
+    // Buffers too small for a whole frame, recreate them bigger. That loses their contents, same as a discard.
+    bool discard = false;
+    if (VtxCapacity < draw_data->TotalVtxCount || VtxCapacity == 0)
+    {
+        int capacity = GrowCapacity(VtxCapacity, draw_data->TotalVtxCount, MIN_VTX_CAPACITY);
+        if (!buffers->Create(ImGui_ImplUploadBuffers::Vertices, (size_t)capacity * sizeof(ImDrawVert)))
+        {
+            Invalidate();
+            return false;
+        }
+        VtxCapacity = capacity;
+        discard = Stats.Grown = true;
+    }
+    if (IdxCapacity < draw_data->TotalIdxCount || IdxCapacity == 0)
+    {
+        int capacity = GrowCapacity(IdxCapacity, draw_data->TotalIdxCount, MIN_IDX_CAPACITY);
+        if (!buffers->Create(ImGui_ImplUploadBuffers::Indices, (size_t)capacity * sizeof(ImDrawIdx)))
+        {
+            Invalidate();
+            return false;
+        }
+        IdxCapacity = capacity;
+        discard = Stats.Grown = true;
+    }
+
+    // Out of room at the end, start over from the beginning of fresh buffers and write everything
+    if (VtxHead + new_vtx > VtxCapacity || IdxHead + new_idx > IdxCapacity)
+        discard = true;
+    if (discard)
+    {
+        Resident.resize(0);
+        VtxHead = IdxHead = 0;
+        for (int n = 0; n < list_count; n++)
+            Placements[n].VtxOffset = Placements[n].IdxOffset = -1;
+        new_lists = list_count;
+        Stats.Discarded = true;
+    }
+    Stats.ListsSkipped = list_count - new_lists;
+
+    // Drop lists that went away a while ago so the lookups stay short
+    for (int i = 0; i < Resident.Size; )
+    {
+        if (Frame - Resident[i].LastUsedFrame > RESIDENT_LIST_MAX_AGE)
+            Resident.erase(Resident.begin() + i);
+        else
+            i++;
+    }
+
+    if (new_lists == 0)
+        return true;
+
+    ImDrawVert* vtx_dst = (ImDrawVert*)buffers->Map(ImGui_ImplUploadBuffers::Vertices, discard);
+    if (!vtx_dst)
+    {
+        Invalidate();
+        return false;
+    }
+    ImDrawIdx* idx_dst = (ImDrawIdx*)buffers->Map(ImGui_ImplUploadBuffers::Indices, discard);
+    if (!idx_dst)
+    {
+        buffers->Unmap(ImGui_ImplUploadBuffers::Vertices);
+        Invalidate();
+        return false;
+    }
+
+    // Only past the head, so nothing a pending draw reads from is touched
+    for (int n = 0; n < list_count; n++)
+    {
+        if (Placements[n].VtxOffset >= 0)
+            continue;
+        const ImDrawList* cmd_list = draw_data->CmdLists[n];
+        const int vtx_count = cmd_list->VtxBuffer.size();
+        const int idx_count = cmd_list->IdxBuffer.size();
+        memcpy(vtx_dst + VtxHead, cmd_list->VtxBuffer.Data, (size_t)vtx_count * sizeof(ImDrawVert));
+        memcpy(idx_dst + IdxHead, cmd_list->IdxBuffer.Data, (size_t)idx_count * sizeof(ImDrawIdx));
+
+        Placements[n].VtxOffset = VtxHead;
+        Placements[n].IdxOffset = IdxHead;
+
+        ResidentList resident;
+        resident.Hash = Hashes[n];
+        resident.VtxCount = vtx_count;
+        resident.IdxCount = idx_count;
+        resident.VtxOffset = VtxHead;
+        resident.IdxOffset = IdxHead;
+        resident.LastUsedFrame = Frame;
+        Resident.push_back(resident);
+
+        VtxHead += vtx_count;
+        IdxHead += idx_count;
+        Stats.ListsUploaded++;
+        Stats.BytesCopied += (size_t)vtx_count * sizeof(ImDrawVert) + (size_t)idx_count * sizeof(ImDrawIdx);
+    }
+
+    buffers->Unmap(ImGui_ImplUploadBuffers::Vertices);
+    buffers->Unmap(ImGui_ImplUploadBuffers::Indices);
+    return true;
+}
@@ -0,0 +1,87 @@
+// ImGui renderer-agnostic vertex/index upload
+// Copies ImDrawData into a pair of dynamic buffers used as rings, skipping draw lists whose contents
+// are already resident from a previous frame. The renderer binding only has to implement
+// ImGui_ImplUploadBuffers (create / map / unmap), see imgui_impl_dx11.cpp.
+//
+// Per frame:
+// - every ImDrawList is hashed. A list whose vertices and indices are already sitting in the
+//   buffers (same hash and counts, uploaded since the last discard) is drawn from there, nothing is copied.
+// - the remaining lists are appended after the data written so far with a no-overwrite map.
+// - when they don't fit, the buffers are mapped with discard and everything is written again from the start.
+// - buffers grow geometrically, to at least twice what a full frame needs, so wrapping stays rare.
+
+#pragma once
+
+#include "imgui.h"
+
+struct ImGui_ImplUploadBuffers
+{
+    enum { Vertices = 0, Indices = 1 };
+
+    virtual ~ImGui_ImplUploadBuffers() {}
+
+    // (Re)create buffer 'kind' with room for size_bytes. The old contents don't need to be kept.
+    virtual bool    Create(int kind, size_t size_bytes) = 0;
+
+    // Map the whole buffer for writing. With 'discard' the previous contents can be thrown away,
+    // otherwise the uploader only writes to bytes that no pending draw uses (D3D11_MAP_WRITE_NO_OVERWRITE).
+    virtual void*   Map(int kind, bool discard) = 0;
+    virtual void    Unmap(int kind) = 0;
+};
+
+struct ImGui_ImplUploadStats
+{
+    int             ListsUploaded;
+    int             ListsSkipped;
+    size_t          BytesCopied;
+    size_t          BytesHashed;
+    bool            Discarded;      // the buffers wrapped (or were recreated) this frame
+    bool            Grown;
+};
+
+class ImGui_ImplUploader
+{
+public:
+    ImGui_ImplUploader();
+
+    // Fills in where each of draw_data->CmdLists ended up. Returns false if the buffers couldn't be created or mapped.
+    bool                            Upload(ImGui_ImplUploadBuffers* buffers, ImDrawData* draw_data);
+
+    // In elements, only valid after a successful Upload() and for the same draw_data
+    int                             GetVtxOffset(int list) const    { return Placements[list].VtxOffset; }
+    int                             GetIdxOffset(int list) const    { return Placements[list].IdxOffset; }
+
+    const ImGui_ImplUploadStats&    GetStats() const                { return Stats; }
+
+    // Forget everything, e.g. after the buffers were released
+    void                            Invalidate();
+
+private:
+    struct Placement
+    {
+        int         VtxOffset;
+        int         IdxOffset;
+    };
+
+    struct ResidentList
+    {
+        unsigned long long Hash;
+        int                VtxCount;
+        int                IdxCount;
+        int                VtxOffset;
+        int                IdxOffset;
+        int                LastUsedFrame;
+    };
+
+    ResidentList*           FindResident(unsigned long long hash, int vtx_count, int idx_count);
+
+    ImVector<Placement>     Placements;
+    ImVector<ResidentList>  Resident;       // lists written since the last discard
+    ImVector<unsigned long long> Hashes;    // scratch, one per list
+    int                     VtxCapacity;    // in elements
+    int                     IdxCapacity;
+    int                     VtxHead;        // next free element
+    int                     IdxHead;
+    int                     Frame;
+    ImGui_ImplUploadStats   Stats;
+};
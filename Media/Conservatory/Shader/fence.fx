@@ -260,6 +260,39 @@ PS_INPUT VSMain( VS_INPUT input )
     return output;
 }
 
+#ifdef _CPUT
+// -------------------------------------
+// Drawn by CPUTInstanceGroup: World is identity, so WorldViewProjection and
+// LightWorldViewProjection are the view-projections, and each instance brings its own world.
+cbuffer cbPerInstanceValues
+{
+    row_major float4x4 InstanceWorld[512]; // CPUT_MAX_INSTANCES_PER_DRAW
+};
+
+PS_INPUT VSMainInstanced( VS_INPUT input, uint instanceID : SV_InstanceID )
+{
+    PS_INPUT output = (PS_INPUT)0;
+
+    float4x4 world         = InstanceWorld[instanceID];
+    float4   worldPosition = mul( float4( input.Position, 1.0f), world );
+    output.Position      = mul( worldPosition, WorldViewProjection );
+    output.WorldPosition = worldPosition.xyz;
+
+    output.Normal   = mul( input.Normal, (float3x3)world );
+#ifdef USE_NORMALMAP
+    output.Tangent  = mul( input.Tangent, (float3x3)world );
+    output.Binormal = mul( input.Binormal, (float3x3)world );
+#endif
+    output.UV0 = input.UV0;
+#ifdef UV_LAYER_1
+    output.UV1 = input.UV1;
+#endif
+    output.LightUV = mul( worldPosition, LightWorldViewProjection );
+
+    return output;
+}
+#endif
+
 float3 ComputeNormal(PS_INPUT input)
 {
     float3 normal;
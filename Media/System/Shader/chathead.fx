@@ -86,6 +86,19 @@ float4 PSMainYUVToRGB( PS_INPUT input ) : SV_Target
 	return pow(pix, 0.2f);
 }
 
+// TEXTURE0 holds Theora TH_YUVX frames as they come out of the decoder (UNORM, not sRGB)
+float4 PSMainYUVX(PS_INPUT input) : SV_Target
+{
+	float3 yuv = TEXTURE0.Sample(SAMPLER0, input.uv).rgb;
+
+	yuv -= float3(0.0625f, 0.5f, 0.5f);
+	float3 rgb = saturate(mul(yuv, yuvCoef));
+
+	// Same as what the sRGB texture of the RGBX path returns
+	rgb = (rgb <= 0.04045f) ? rgb / 12.92f : pow((rgb + 0.055f) / 1.055f, 2.4f);
+	return float4(rgb, 1.0f);
+}
+
 float4 PSMain(PS_INPUT input) : SV_Target
 {
 	float4 pix = TEXTURE0.Sample(SAMPLER0, input.uv*float2(1, 1) /* dont need to flip y*/);
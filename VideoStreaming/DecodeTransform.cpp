@@ -5,9 +5,8 @@
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "DecodeTransform.h"
-#include "VTuneScopedTask.h"
+#include "Trace.h"
 
-extern __itt_domain* g_pDomain;
 
 
 void DecodeTransform::Shutdown()
@@ -277,7 +276,7 @@ HRESULT DecodeTransform::ProcessSample(IMFSample **ppSample, LONGLONG& time, LON
 // Process the output sample for the decoder.
 HRESULT DecodeTransform::ProcessInput(IMFSample **ppSample)
 {
-	VTUNE_TASK(g_pDomain, "ProcessInput");
+	TRACE_SCOPE("ProcessInput");
 
 	mInputCount += 1;
 	HRESULT hr = mpDecoder->ProcessInput(0, *ppSample, 0);
@@ -288,7 +287,7 @@ HRESULT DecodeTransform::ProcessInput(IMFSample **ppSample)
 // Process the output sample for the decoder
 HRESULT DecodeTransform::ProcessOutput(LONGLONG& time, LONGLONG& duration, DecoderOutput& oDtn/*output*/)
 {
-	VTUNE_TASK(g_pDomain, "ProcessOutput");
+	TRACE_SCOPE("ProcessOutput");
 
 
 	IMFMediaBuffer *pBuffer = NULL;
@@ -347,7 +346,7 @@ HRESULT DecodeTransform::ProcessOutput(LONGLONG& time, LONGLONG& duration, Decod
 // Write the decoded sample out to a file
 HRESULT DecodeTransform::GetDecodedBuffer(IMFSample *pMftOutSample, MFT_OUTPUT_DATA_BUFFER& outputDataBuffer, LONGLONG& time, LONGLONG& duration, DecoderOutput& oDtn/*output*/)
 {
-	VTUNE_TASK(g_pDomain, "WriteToFile");
+	TRACE_SCOPE("WriteToFile");
 
 	// ToDo: These two lines are not right. Need to work out where to get timestamp and duration from the H264 decoder MFT.
 	HRESULT hr = outputDataBuffer.pSample->SetSampleTime(time);
@@ -6,9 +6,8 @@
 
 #include "EncodeTransform.h"
 #include "ColorConversion.h"
-#include "VTuneScopedTask.h"
+#include "Trace.h"
 
-extern __itt_domain* g_pDomain;
 
 
 EncodeTransform::EncodeTransform()
@@ -20,7 +19,7 @@ EncodeTransform::EncodeTransform()
 
 void EncodeTransform::Init(int width, int height)
 {
-	VTUNE_TASK(g_pDomain, "Encoder Init");
+	TRACE_SCOPE("Encoder Init");
 
 	mStreamHeight = height;
 	mStreamWidth = width;
@@ -407,7 +406,7 @@ HRESULT EncodeTransform::ProcessInput()
 // Create a new sample for mft input from segemtation image buffer and pass in the timestamp
 HRESULT EncodeTransform::AddSample(const LONGLONG& rtStart)
 {
-	VTUNE_TASK(g_pDomain, "AddSample");
+	TRACE_SCOPE("AddSample");
 
 	const LONG cYUY2WidthBytes = mStreamWidth * 2; // halfwidth * 4
 	const DWORD cbBuffer = cYUY2WidthBytes * mStreamHeight;
@@ -456,7 +455,7 @@ HRESULT EncodeTransform::AddSample(const LONGLONG& rtStart)
 
 HRESULT EncodeTransform::ProcessOutput(EncoderOutput& etn)
 {
-	VTUNE_TASK(g_pDomain, "ProcessOutput");
+	TRACE_SCOPE("ProcessOutput");
 
 	if (mpEncoder == NULL)
 	{
@@ -517,7 +516,7 @@ HRESULT EncodeTransform::ProcessOutput(EncoderOutput& etn)
 
 EncoderOutput EncodeTransform::EncodeData(char *pRGBAData, size_t numBytes)
 {	
-	VTUNE_TASK(g_pDomain, "EncodeData");
+	TRACE_SCOPE("EncodeData");
 
 	const size_t numRGBAPixels = numBytes >> 2; // 4 bytes per pixel (TODO:Cleanup)
 	
@@ -0,0 +1,197 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+std::atomic<bool>					gTraceEnabled(true);
+TRACE_THREAD_LOCAL TraceThreadBuffer	*gpTraceThreadBuffer = nullptr;
+
+#ifdef ENABLE_VTUNE_PROFILING
+__itt_domain *gpTraceITTDomain = __itt_domain_create(L"Chatheads.Sample");
+#endif
+
+// Buffers live until the process exits, so events of threads that are gone can still be exported
+static std::mutex							sTraceRegistryMutex;
+static std::vector<TraceThreadBuffer*>		sTraceBuffers;
+static int64_t								sTraceStartTime = TraceNow();
+
+int64_t TraceNow()
+{
+#ifdef _WIN32
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+int64_t TraceTicksPerSecond()
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return frequency.QuadPart;
+#else
+	return 1000000000;
+#endif
+}
+
+TraceThreadBuffer* TraceRegisterThread()
+{
+	TraceThreadBuffer *pBuffer = new TraceThreadBuffer();
+	pBuffer->head.store(0, std::memory_order_relaxed);
+	pBuffer->name[0] = '\0';
+	{
+		std::lock_guard<std::mutex> lock(sTraceRegistryMutex);
+		pBuffer->threadId = (uint32_t)sTraceBuffers.size() + 1;
+		sTraceBuffers.push_back(pBuffer);
+	}
+	gpTraceThreadBuffer = pBuffer;
+	return pBuffer;
+}
+
+void TraceSetThreadName(const char *pName)
+{
+	TraceThreadBuffer *pBuffer = gpTraceThreadBuffer;
+	if (!pBuffer)
+		pBuffer = TraceRegisterThread();
+
+	std::lock_guard<std::mutex> lock(sTraceRegistryMutex); // the exporter reads it
+	strncpy(pBuffer->name, pName, sizeof(pBuffer->name) - 1);
+	pBuffer->name[sizeof(pBuffer->name) - 1] = '\0';
+}
+
+void TraceSetEnabled(bool bEnabled)
+{
+	gTraceEnabled.store(bEnabled, std::memory_order_relaxed);
+}
+
+// Names are ours, but keep the JSON valid whatever they contain
+static void WriteJSONString(FILE *pFile, const char *pText)
+{
+	fputc('"', pFile);
+	for (; *pText; pText++)
+	{
+		const unsigned char c = (unsigned char)*pText;
+		if (c == '"' || c == '\\')
+			fprintf(pFile, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(pFile, "\\u%04x", c);
+		else
+			fputc(c, pFile);
+	}
+	fputc('"', pFile);
+}
+
+// Copies what a ring holds into 'events'. The owner keeps writing meanwhile: once the copy is done,
+// every event it may have written over (up to and including the slot it could be writing right now)
+// is dropped.
+static void SnapshotBuffer(const TraceThreadBuffer *pBuffer, std::vector<TraceEvent> &events)
+{
+	const uint32_t capacity = TraceThreadBuffer::cCapacity;
+	const uint32_t headBefore = pBuffer->head.load(std::memory_order_acquire);
+	const uint32_t count = headBefore < capacity ? headBefore : capacity;
+	const uint32_t first = headBefore - count;
+
+	events.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+		events[i] = pBuffer->events[(first + i) & (capacity - 1)];
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	const uint32_t headAfter = pBuffer->head.load(std::memory_order_relaxed);
+
+	// Oldest event that is certainly intact is headAfter - capacity + 1
+	const int64_t stale = (int64_t)headAfter - capacity + 1 - first;
+	if (stale >= (int64_t)count)
+		events.clear();
+	else if (stale > 0)
+		events.erase(events.begin(), events.begin() + (size_t)stale);
+}
+
+bool TraceWriteChromeJSON(const char *pFileName)
+{
+	FILE *pFile = fopen(pFileName, "w");
+	if (!pFile)
+		return false;
+
+	std::vector<TraceThreadBuffer*> buffers;
+	std::vector<std::string> names;
+	{
+		std::lock_guard<std::mutex> lock(sTraceRegistryMutex);
+		buffers = sTraceBuffers;
+		for (TraceThreadBuffer *pBuffer : buffers)
+			names.push_back(pBuffer->name);
+	}
+
+	const double usPerTick = 1000000.0 / (double)TraceTicksPerSecond();
+	const char *pSeparator = "\n";
+	fprintf(pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+	std::vector<TraceEvent> events;
+	for (size_t b = 0; b < buffers.size(); b++)
+	{
+		const uint32_t tid = buffers[b]->threadId;
+		if (!names[b].empty())
+		{
+			fprintf(pFile, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", pSeparator, tid);
+			WriteJSONString(pFile, names[b].c_str());
+			fprintf(pFile, "}}");
+			pSeparator = ",\n";
+		}
+
+		SnapshotBuffer(buffers[b], events);
+		for (const TraceEvent &e : events)
+		{
+			const double ts = (double)(e.start - sTraceStartTime) * usPerTick;
+			fprintf(pFile, "%s{\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"name\":", pSeparator, tid, ts);
+			WriteJSONString(pFile, e.pName);
+			pSeparator = ",\n";
+
+			switch (e.type)
+			{
+			case TRACE_EVENT_COMPLETE:
+				fprintf(pFile, ",\"ph\":\"X\",\"dur\":%.3f", (double)e.duration * usPerTick);
+				if (e.pArgName)
+				{
+					fprintf(pFile, ",\"args\":{");
+					WriteJSONString(pFile, e.pArgName);
+					fprintf(pFile, ":%lld}", (long long)e.value);
+				}
+				break;
+			case TRACE_EVENT_COUNTER:
+				fprintf(pFile, ",\"ph\":\"C\",\"args\":{\"value\":%lld}", (long long)e.value);
+				break;
+			case TRACE_EVENT_FLOW_BEGIN:
+				fprintf(pFile, ",\"ph\":\"s\",\"cat\":\"flow\",\"id\":%lld", (long long)e.value);
+				break;
+			case TRACE_EVENT_FLOW_STEP:
+				fprintf(pFile, ",\"ph\":\"t\",\"cat\":\"flow\",\"id\":%lld", (long long)e.value);
+				break;
+			case TRACE_EVENT_FLOW_END:
+				fprintf(pFile, ",\"ph\":\"f\",\"bp\":\"e\",\"cat\":\"flow\",\"id\":%lld", (long long)e.value);
+				break;
+			}
+			fputc('}', pFile);
+		}
+	}
+
+	fprintf(pFile, "\n]}\n");
+	return fclose(pFile) == 0;
+}
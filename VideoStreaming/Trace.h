@@ -0,0 +1,178 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");// you may not use this file except in compliance with the License.// You may obtain a copy of the License at//// http://www.apache.org/licenses/LICENSE-2.0//// Unless required by applicable law or agreed to in writing, software// distributed under the License is distributed on an "AS IS" BASIS,// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.// See the License for the specific language governing permissions and// limitations under the License.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+/**************************************************************************************************
+Low overhead tracing of the capture -> encode -> send -> receive -> decode -> upload pipeline.
+
+Every thread records into its own ring buffer (no locks, no allocation after the thread's first event);
+when a ring is full the oldest events are overwritten, so it always holds the last few seconds.
+TraceWriteChromeJSON() writes what the rings hold as Chrome trace-event JSON, for chrome://tracing or
+https://ui.perfetto.dev.
+
+TRACE_SCOPE("Name")								time the enclosing scope
+TRACE_SCOPE_ARG("Name", "arg", value)			same, with one integer argument
+TRACE_COUNTER("Name", value)					a value over time (bytes sent, queue depth...)
+TRACE_FLOW_BEGIN / _STEP / _END("Name", id)		arrows between the scopes that handle the same frame on
+												different threads; call inside a TRACE_SCOPE
+TraceSetThreadName("Name")						label for the calling thread in the trace
+
+Names must be string literals: events keep the pointer, the text is only looked at when exporting.
+Define CHATHEADS_DISABLE_TRACE to compile all of it out, and ENABLE_VTUNE_PROFILING to also send the
+scopes to VTune/GPA as ITT tasks.
+***************************************************************************************************/
+
+//#define CHATHEADS_DISABLE_TRACE	// uncomment to compile tracing out
+//#define ENABLE_VTUNE_PROFILING		// uncomment to also emit ITT tasks
+
+#include <stdint.h>
+#include <atomic>
+
+#ifdef ENABLE_VTUNE_PROFILING
+#include "ittnotify.h"
+#endif
+
+#ifdef _MSC_VER
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL __thread
+#endif
+
+enum TraceEventType
+{
+	TRACE_EVENT_COMPLETE,	// a scope: start + duration
+	TRACE_EVENT_COUNTER,
+	TRACE_EVENT_FLOW_BEGIN,
+	TRACE_EVENT_FLOW_STEP,
+	TRACE_EVENT_FLOW_END,
+};
+
+struct TraceEvent
+{
+	const char	*pName;
+	const char	*pArgName;	// complete events only, null when there is no argument
+	int64_t		start;		// TraceNow() ticks
+	int64_t		duration;	// ticks, complete events only
+	int64_t		value;		// argument, counter value or flow id
+	int32_t		type;		// TraceEventType
+};
+
+struct TraceThreadBuffer
+{
+	static const uint32_t cCapacity = 16384;	// power of 2
+
+	std::atomic<uint32_t>	head;		// events written so far; only the owning thread writes it
+	uint32_t				threadId;	// small number, in order of the threads' first event
+	char					name[32];
+	TraceEvent				events[cCapacity];
+};
+
+extern std::atomic<bool>					gTraceEnabled;
+extern TRACE_THREAD_LOCAL TraceThreadBuffer	*gpTraceThreadBuffer;
+
+// Ticks of a monotonic clock (QueryPerformanceCounter, CLOCK_MONOTONIC)
+int64_t TraceNow();
+int64_t TraceTicksPerSecond();
+
+// Creates and registers the calling thread's buffer, on its first event
+TraceThreadBuffer* TraceRegisterThread();
+
+void TraceSetThreadName(const char *pName);
+void TraceSetEnabled(bool bEnabled);
+inline bool TraceIsEnabled() { return gTraceEnabled.load(std::memory_order_relaxed); }
+
+// Snapshot of every thread's ring. Can run while the other threads keep tracing.
+bool TraceWriteChromeJSON(const char *pFileName);
+
+inline void TraceWrite(TraceEventType type, const char *pName, int64_t start, int64_t duration, int64_t value, const char *pArgName = nullptr)
+{
+	TraceThreadBuffer *pBuffer = gpTraceThreadBuffer;
+	if (!pBuffer)
+		pBuffer = TraceRegisterThread();
+
+	const uint32_t head = pBuffer->head.load(std::memory_order_relaxed);
+	TraceEvent &e = pBuffer->events[head & (TraceThreadBuffer::cCapacity - 1)];
+	e.pName = pName;
+	e.pArgName = pArgName;
+	e.start = start;
+	e.duration = duration;
+	e.value = value;
+	e.type = type;
+	pBuffer->head.store(head + 1, std::memory_order_release);	// publishes the event to the exporter
+}
+
+inline void TraceMark(TraceEventType type, const char *pName, int64_t value)
+{
+	if (TraceIsEnabled())
+		TraceWrite(type, pName, TraceNow(), 0, value);
+}
+
+class TraceScope
+{
+public:
+	TraceScope(const char *pName, const char *pArgName = nullptr, int64_t arg = 0)
+		: mpName(TraceIsEnabled() ? pName : nullptr), mpArgName(pArgName), mArg(arg), mStart(0)
+	{
+		if (mpName)
+			mStart = TraceNow();
+	}
+	~TraceScope()
+	{
+		if (mpName)
+			TraceWrite(TRACE_EVENT_COMPLETE, mpName, mStart, TraceNow() - mStart, mArg, mpArgName);
+	}
+
+private:
+	TraceScope(const TraceScope&);
+	TraceScope& operator=(const TraceScope&);
+
+	const char	*mpName;
+	const char	*mpArgName;
+	int64_t		mArg;
+	int64_t		mStart;
+};
+
+#ifdef ENABLE_VTUNE_PROFILING
+extern __itt_domain *gpTraceITTDomain;
+
+// The string handle is made once per call site, see TRACE_SCOPE
+class TraceITTScope
+{
+public:
+	TraceITTScope(__itt_string_handle *pHandle) { __itt_task_begin(gpTraceITTDomain, __itt_null, __itt_null, pHandle); }
+	~TraceITTScope() { __itt_task_end(gpTraceITTDomain); }
+};
+
+#define TRACE_ITT_SCOPE(name) \
+	static __itt_string_handle *TRACE_CONCAT(_trace_itt_handle_, __LINE__) = __itt_string_handle_createA(name); \
+	TraceITTScope TRACE_CONCAT(_trace_itt_scope_, __LINE__)(TRACE_CONCAT(_trace_itt_handle_, __LINE__))
+#else
+#define TRACE_ITT_SCOPE(name)
+#endif
+
+#define TRACE_CONCAT_(a, b)	a##b
+#define TRACE_CONCAT(a, b)	TRACE_CONCAT_(a, b)
+
+// "" name: only compiles for string literals
+#ifndef CHATHEADS_DISABLE_TRACE
+#define TRACE_SCOPE(name)					TRACE_ITT_SCOPE("" name); TraceScope TRACE_CONCAT(_trace_scope_, __LINE__)("" name)
+#define TRACE_SCOPE_ARG(name, arg, value)	TRACE_ITT_SCOPE("" name); TraceScope TRACE_CONCAT(_trace_scope_, __LINE__)("" name, "" arg, (int64_t)(value))
+#define TRACE_COUNTER(name, value)			TraceMark(TRACE_EVENT_COUNTER, "" name, (int64_t)(value))
+#define TRACE_FLOW_BEGIN(name, id)			TraceMark(TRACE_EVENT_FLOW_BEGIN, "" name, (int64_t)(id))
+#define TRACE_FLOW_STEP(name, id)			TraceMark(TRACE_EVENT_FLOW_STEP, "" name, (int64_t)(id))
+#define TRACE_FLOW_END(name, id)			TraceMark(TRACE_EVENT_FLOW_END, "" name, (int64_t)(id))
+#else
+#define TRACE_SCOPE(name)					TRACE_ITT_SCOPE("" name)
+#define TRACE_SCOPE_ARG(name, arg, value)	TRACE_ITT_SCOPE("" name)
+#define TRACE_COUNTER(name, value)
+#define TRACE_FLOW_BEGIN(name, id)
+#define TRACE_FLOW_STEP(name, id)
+#define TRACE_FLOW_END(name, id)
+#endif
+
+#endif // _TRACE_H_